@@ -22,12 +22,22 @@
 #include "oph_server_utility.h"
 
 #include <string.h>
+#include <stdlib.h>
 #include <unistd.h>
+#include <endian.h>
 
 #include "oph_network.h"
 
 //TODO poll the tcp socket to discover if the connection was lost
 
+static ssize_t _oph_io_client_readn(oph_io_client_connection * connection, void *buffer, size_t n)
+{
+	//Replies are parsed through the buffered reader of the connection, if available
+	if (connection->reader)
+		return oph_net_reader_readn((oph_net_reader *) connection->reader, buffer, n);
+	return oph_net_readn(connection->socket, buffer, n);
+}
+
 int _oph_io_client_ping_connection(oph_io_client_connection * connection)
 {
 	if (!connection) {
@@ -47,7 +57,7 @@ int _oph_io_client_ping_connection(oph_io_client_connection * connection)
 		}
 		//Get answer
 		pmesg(LOG_DEBUG, __FILE__, __LINE__, "Waiting for answer...\n");
-		res = oph_net_readn(connection->socket, reply, strlen(OPH_IO_CLIENT_MSG_PING));
+		res = _oph_io_client_readn(connection, reply, strlen(OPH_IO_CLIENT_MSG_PING));
 		if (!res) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, "No reply\n");
 			return OPH_IO_CLIENT_INTERFACE_CONN_ERR;
@@ -94,10 +104,13 @@ int oph_io_client_connect(const char *hostname, const char *port, const char *db
 					pmesg(LOG_ERROR, __FILE__, __LINE__, "Error while closing connection!\n");
 					return OPH_IO_CLIENT_INTERFACE_IO_ERR;
 				}
+				oph_net_reader_destroy((oph_net_reader **) & ((*connection)->reader));
 				free(*connection);
 			}
-		} else
+		} else {
+			oph_net_reader_destroy((oph_net_reader **) & ((*connection)->reader));
 			free(*connection);
+		}
 	}
 
 	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Connecting to %s:%s...\n", hostname, port);
@@ -119,6 +132,9 @@ int oph_io_client_connect(const char *hostname, const char *port, const char *db
 	(*connection)->host[OPH_IO_CLIENT_HOST_LEN - 1] = 0;
 	(*connection)->db_name[0] = 0;
 	(*connection)->socket = fd;
+	(*connection)->reader = NULL;
+	if (oph_net_reader_create(fd, 0, (oph_net_reader **) & ((*connection)->reader)))
+		pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to create buffered reader: replies will be read without buffering\n");
 
 	//Set default db
 	if (db_name) {
@@ -186,7 +202,7 @@ int oph_io_client_use_db(const char *db_name, const char *device, oph_io_client_
 	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Waiting for answer...\n");
 	//Decode response
 	char reply[strlen(OPH_IO_CLIENT_MSG_USE_DB) + 1];
-	res = oph_net_readn(connection->socket, reply, strlen(OPH_IO_CLIENT_MSG_USE_DB));
+	res = _oph_io_client_readn(connection, reply, strlen(OPH_IO_CLIENT_MSG_USE_DB));
 	if (!res) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "No reply\n");
 		return OPH_IO_CLIENT_INTERFACE_CONN_ERR;
@@ -224,6 +240,7 @@ int oph_io_client_setup_query(oph_io_client_connection * connection, const char
 	(*query)->args_length = 0;
 	(*query)->tot_run = 0;
 	(*query)->curr_run = 0;
+	(*query)->handle = 0;
 
 	unsigned int m = 0, n = 0;
 	unsigned long long message_len = 0;
@@ -370,7 +387,7 @@ int oph_io_client_execute_query(oph_io_client_connection * connection, oph_io_cl
 		char *query_ptr = NULL;
 		if (arg_len > query->args_length) {
 			//Realloc args array 
-			query_ptr = realloc(query->query, arg_len);
+			query_ptr = realloc(query->query, query->fixed_length + arg_len);
 			if (!query_ptr) {
 				pmesg(LOG_ERROR, __FILE__, __LINE__, "Error allocation memory\n");
 				return OPH_IO_CLIENT_INTERFACE_MEMORY_ERR;
@@ -430,7 +447,7 @@ int oph_io_client_execute_query(oph_io_client_connection * connection, oph_io_cl
 
 	//Decode response
 	char reply[strlen(OPH_IO_CLIENT_MSG_EXEC_QUERY) + 1];
-	res = oph_net_readn(connection->socket, reply, strlen(OPH_IO_CLIENT_MSG_EXEC_QUERY));
+	res = _oph_io_client_readn(connection, reply, strlen(OPH_IO_CLIENT_MSG_EXEC_QUERY));
 	if (!res) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "No reply\n");
 		return OPH_IO_CLIENT_INTERFACE_CONN_ERR;
@@ -447,6 +464,87 @@ int oph_io_client_execute_query(oph_io_client_connection * connection, oph_io_cl
 	return OPH_IO_CLIENT_INTERFACE_OK;
 }
 
+int oph_io_client_prepare_query(oph_io_client_connection * connection, oph_io_client_query * query)
+{
+	if (!connection || !query || !query->query) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Parameters are not given\n");
+		return OPH_IO_CLIENT_INTERFACE_DATA_ERR;
+	}
+
+	if (!connection->socket) {
+		pmesg(LOG_DEBUG, __FILE__, __LINE__, "Connection was closed\n");
+		return OPH_IO_CLIENT_INTERFACE_DATA_ERR;
+	}
+	//Already prepared
+	if (query->handle)
+		return OPH_IO_CLIENT_INTERFACE_OK;
+
+	//Query text is stored in the request as TYPE|ARG_NUMBER|QUERY_LEN|QUERY|...
+	unsigned int offset = strlen(OPH_IO_CLIENT_MSG_EXEC_QUERY) + sizeof(unsigned int);
+	unsigned long long query_len = 0;
+	memcpy((void *) &query_len, query->query + offset, sizeof(unsigned long long));
+	offset += sizeof(unsigned long long);
+
+	//Build request message TYPE|QUERY_LEN|QUERY
+	unsigned int m = strlen(OPH_IO_CLIENT_MSG_SET_QUERY);
+	char request[m + sizeof(unsigned long long)];
+	memcpy(request, OPH_IO_CLIENT_MSG_SET_QUERY, m);
+	memcpy(request + m, (void *) &query_len, sizeof(unsigned long long));
+	m += sizeof(unsigned long long);
+
+	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Sending %d bytes\n", m + query_len);
+	if (write(connection->socket, (void *) request, m) != m || write(connection->socket, query->query + offset, query_len) != query_len) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Error while writing to socket\n");
+		return OPH_IO_CLIENT_INTERFACE_IO_ERR;
+	}
+
+	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Waiting for answer...\n");
+
+	//Decode response TYPE|HANDLE
+	char reply[strlen(OPH_IO_CLIENT_MSG_SET_QUERY) + 1];
+	if (!_oph_io_client_readn(connection, reply, strlen(OPH_IO_CLIENT_MSG_SET_QUERY))) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "No reply\n");
+		return OPH_IO_CLIENT_INTERFACE_CONN_ERR;
+	}
+	reply[strlen(OPH_IO_CLIENT_MSG_SET_QUERY)] = 0;
+	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Response received: %s\n", reply);
+
+	if (STRCMP(OPH_IO_CLIENT_MSG_SET_QUERY, reply) != 0) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Error preparing query\n");
+		return OPH_IO_CLIENT_INTERFACE_QUERY_ERR;
+	}
+	unsigned long long handle = 0;
+	if (!_oph_io_client_readn(connection, (char *) &handle, sizeof(unsigned long long))) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "No reply\n");
+		return OPH_IO_CLIENT_INTERFACE_CONN_ERR;
+	}
+
+	//Rebuild request replacing QUERY_LEN|QUERY with 0|HANDLE
+	unsigned int fixed_length = query->fixed_length - query_len + sizeof(unsigned long long);
+	char *new_query = (char *) calloc(fixed_length + query->args_length, sizeof(char));
+	if (!new_query) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Error allocation memory\n");
+		return OPH_IO_CLIENT_INTERFACE_MEMORY_ERR;
+	}
+	unsigned long long zero = 0;
+	m = offset - sizeof(unsigned long long);
+	memcpy(new_query, query->query, m);
+	memcpy(new_query + m, (void *) &zero, sizeof(unsigned long long));
+	m += sizeof(unsigned long long);
+	memcpy(new_query + m, (void *) &handle, sizeof(unsigned long long));
+	m += sizeof(unsigned long long);
+	memcpy(new_query + m, query->query + offset + query_len, fixed_length - m);
+
+	free(query->query);
+	query->query = (void *) new_query;
+	query->fixed_length = fixed_length;
+	query->handle = handle;
+
+	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Query prepared with handle %llu\n", handle);
+
+	return OPH_IO_CLIENT_INTERFACE_OK;
+}
+
 int oph_io_client_free_query(oph_io_client_query * query)
 {
 	if (!query) {
@@ -461,8 +559,10 @@ int oph_io_client_free_query(oph_io_client_query * query)
 	return OPH_IO_CLIENT_INTERFACE_OK;
 }
 
-int oph_io_client_get_result(oph_io_client_connection * connection, oph_io_client_result ** result_set)
+static int _oph_io_client_get_result(oph_io_client_connection * connection, oph_io_client_result ** result_set, char binary)
 {
+	const char *msg_type = binary ? OPH_IO_CLIENT_MSG_RESULT_BINARY : OPH_IO_CLIENT_MSG_RESULT;
+
 	if (!result_set || !connection) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "Parameters are not given\n");
 		return OPH_IO_CLIENT_INTERFACE_DATA_ERR;
@@ -479,12 +579,12 @@ int oph_io_client_get_result(oph_io_client_connection * connection, oph_io_clien
 		return OPH_IO_CLIENT_INTERFACE_OK;
 	}
 
-	char request[strlen(OPH_IO_CLIENT_MSG_RESULT) + 1];
+	char request[OPH_IO_CLIENT_MSG_TYPE_LEN + 1];
 	unsigned int m = 0;
 	int res = 0;
 
 	//Build request packet TYPE
-	m = snprintf(request, strlen(OPH_IO_CLIENT_MSG_RESULT) + 1, OPH_IO_CLIENT_MSG_RESULT);
+	m = snprintf(request, OPH_IO_CLIENT_MSG_TYPE_LEN + 1, "%s", msg_type);
 
 	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Sending %d bytes\n", m);
 	if (write(connection->socket, (void *) request, m) != m) {
@@ -495,16 +595,16 @@ int oph_io_client_get_result(oph_io_client_connection * connection, oph_io_clien
 	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Waiting for answer...\n");
 	//transfer result + build structure
 
-	char reply_type[strlen(OPH_IO_CLIENT_MSG_RESULT) + 1];
-	res = oph_net_readn(connection->socket, reply_type, strlen(OPH_IO_CLIENT_MSG_RESULT));
+	char reply_type[OPH_IO_CLIENT_MSG_TYPE_LEN + 1];
+	res = _oph_io_client_readn(connection, reply_type, OPH_IO_CLIENT_MSG_TYPE_LEN);
 	if (!res) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "No reply\n");
 		return OPH_IO_CLIENT_INTERFACE_CONN_ERR;
 	}
-	reply_type[strlen(OPH_IO_CLIENT_MSG_RESULT)] = 0;
+	reply_type[OPH_IO_CLIENT_MSG_TYPE_LEN] = 0;
 	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Response received: %s\n", reply_type);
 
-	if (STRCMP(OPH_IO_CLIENT_MSG_RESULT, reply_type) != 0) {
+	if (STRCMP(msg_type, reply_type) != 0) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "Error transfering result\n");
 		return OPH_IO_CLIENT_INTERFACE_QUERY_ERR;
 	}
@@ -513,7 +613,7 @@ int oph_io_client_get_result(oph_io_client_connection * connection, oph_io_clien
 	//Read payload len
 	char reply_info[sizeof(unsigned long long)] = { 0 };
 	unsigned long long payload_len = 0;
-	res = oph_net_readn(connection->socket, reply_info, OPH_IO_CLIENT_MSG_LONG_LEN);
+	res = _oph_io_client_readn(connection, reply_info, OPH_IO_CLIENT_MSG_LONG_LEN);
 	if (!res) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "No reply\n");
 		return OPH_IO_CLIENT_INTERFACE_CONN_ERR;
@@ -522,7 +622,7 @@ int oph_io_client_get_result(oph_io_client_connection * connection, oph_io_clien
 	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Response length: %llu\n", payload_len);
 
 	unsigned long long num_rows = 0;
-	res = oph_net_readn(connection->socket, reply_info, OPH_IO_CLIENT_MSG_LONG_LEN);
+	res = _oph_io_client_readn(connection, reply_info, OPH_IO_CLIENT_MSG_LONG_LEN);
 	if (!res) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "No reply\n");
 		return OPH_IO_CLIENT_INTERFACE_CONN_ERR;
@@ -531,13 +631,17 @@ int oph_io_client_get_result(oph_io_client_connection * connection, oph_io_clien
 	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Number of rows: %llu\n", num_rows);
 
 	unsigned int num_fields = 0;
-	res = oph_net_readn(connection->socket, reply_info, OPH_IO_CLIENT_MSG_SHORT_LEN);
+	res = _oph_io_client_readn(connection, reply_info, OPH_IO_CLIENT_MSG_SHORT_LEN);
 	if (!res) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "No reply\n");
 		return OPH_IO_CLIENT_INTERFACE_CONN_ERR;
 	}
 	memcpy(&num_fields, reply_info, sizeof(unsigned int));
 	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Number of fields: %u\n", num_fields);
+	if (num_fields > OPH_IO_CLIENT_MAX_FIELD_NUM) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Invalid number of fields: %u\n", num_fields);
+		return OPH_IO_CLIENT_INTERFACE_QUERY_ERR;
+	}
 
 	//Rebuild result set struct
 	*result_set = (oph_io_client_result *) calloc(1, sizeof(oph_io_client_result));
@@ -558,6 +662,31 @@ int oph_io_client_get_result(oph_io_client_connection * connection, oph_io_clien
 		*result_set = NULL;
 		return OPH_IO_CLIENT_INTERFACE_MEMORY_ERR;
 	}
+	//Read the type of each field (binary mode only)
+	if (binary) {
+		unsigned char *field_types = (unsigned char *) malloc(num_fields ? num_fields : 1);
+		(*result_set)->field_type = (oph_io_client_field_type *) calloc(num_fields, sizeof(oph_io_client_field_type));
+		if (!field_types || !(*result_set)->field_type) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to alloc memory\n");
+			if (field_types)
+				free(field_types);
+			oph_io_client_free_result(*result_set);
+			*result_set = NULL;
+			return OPH_IO_CLIENT_INTERFACE_MEMORY_ERR;
+		}
+		res = _oph_io_client_readn(connection, field_types, num_fields);
+		if (res < 0 || (unsigned int) res != num_fields) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "No reply\n");
+			free(field_types);
+			oph_io_client_free_result(*result_set);
+			*result_set = NULL;
+			return OPH_IO_CLIENT_INTERFACE_CONN_ERR;
+		}
+		unsigned int k;
+		for (k = 0; k < num_fields; k++)
+			(*result_set)->field_type[k] = (oph_io_client_field_type) field_types[k];
+		free(field_types);
+	}
 	(*result_set)->result_set = (oph_io_client_record **) calloc(num_rows + 1, sizeof(oph_io_client_record *));
 
 	if (!((*result_set)->result_set)) {
@@ -570,34 +699,12 @@ int oph_io_client_get_result(oph_io_client_connection * connection, oph_io_clien
 
 	//If result set does contain rows
 	if (num_rows > 0) {
-		//Read payload (binary format)
-		char *reply = (char *) calloc(payload_len, sizeof(char));
-		if (!reply) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Error allocation memory\n");
-			return OPH_IO_CLIENT_INTERFACE_MEMORY_ERR;
-		}
-		res = oph_net_readn(connection->socket, reply, payload_len);
-		if (!res) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "No reply\n");
-			free(reply);
-			return OPH_IO_CLIENT_INTERFACE_CONN_ERR;
-		}
-
-		char *sub_reply = (char *) calloc(payload_len, sizeof(char));
-		if (!sub_reply) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Error allocation memory\n");
-			free(reply);
-			return OPH_IO_CLIENT_INTERFACE_MEMORY_ERR;
-		}
-		unsigned long long string_head = 0;
-
+		//Payload (binary format) is consumed cell by cell, reading each value directly into its field
 		//Setup each row
 		for (i = 0; i < num_rows; i++) {
 			(*result_set)->result_set[i] = (oph_io_client_record *) calloc(1, sizeof(oph_io_client_record));
 			if (!((*result_set)->result_set[i])) {
 				pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to alloc memory\n");
-				free(reply);
-				free(sub_reply);
 				oph_io_client_free_result(*result_set);
 				*result_set = NULL;
 				return OPH_IO_CLIENT_INTERFACE_MEMORY_ERR;
@@ -606,8 +713,6 @@ int oph_io_client_get_result(oph_io_client_connection * connection, oph_io_clien
 			(*result_set)->result_set[i]->field_length = (unsigned long *) calloc(num_fields, sizeof(unsigned long));
 			if (!((*result_set)->result_set[i]->field_length)) {
 				pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to alloc memory\n");
-				free(reply);
-				free(sub_reply);
 				oph_io_client_free_result(*result_set);
 				*result_set = NULL;
 				return OPH_IO_CLIENT_INTERFACE_MEMORY_ERR;
@@ -616,8 +721,6 @@ int oph_io_client_get_result(oph_io_client_connection * connection, oph_io_clien
 			(*result_set)->result_set[i]->field = (char **) calloc(num_fields + 1, sizeof(char *));
 			if (!((*result_set)->result_set[i]->field)) {
 				pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to alloc memory\n");
-				free(reply);
-				free(sub_reply);
 				oph_io_client_free_result(*result_set);
 				*result_set = NULL;
 				return OPH_IO_CLIENT_INTERFACE_MEMORY_ERR;
@@ -626,31 +729,146 @@ int oph_io_client_get_result(oph_io_client_connection * connection, oph_io_clien
 			for (j = 0; j < num_fields; j++) {
 				//Setup each field
 
-				//Extract field length
-				memcpy(sub_reply, reply + string_head, sizeof(unsigned long));
-				(*result_set)->result_set[i]->field_length[j] = *((unsigned long *) sub_reply);
-				string_head += sizeof(unsigned long);
+				//Extract field length (numeric fields have a fixed length in binary mode)
+				if (binary && ((*result_set)->field_type[j] != OPH_IO_CLIENT_FIELD_STRING))
+					(*result_set)->result_set[i]->field_length[j] = OPH_IO_CLIENT_MSG_BINARY_VALUE_LEN;
+				else {
+					res = _oph_io_client_readn(connection, reply_info, OPH_IO_CLIENT_MSG_LONG_LEN);
+					if (res != OPH_IO_CLIENT_MSG_LONG_LEN) {
+						pmesg(LOG_ERROR, __FILE__, __LINE__, "No reply\n");
+						oph_io_client_free_result(*result_set);
+						*result_set = NULL;
+						return OPH_IO_CLIENT_INTERFACE_CONN_ERR;
+					}
+					memcpy(&((*result_set)->result_set[i]->field_length[j]), reply_info, sizeof(unsigned long));
+				}
 				pmesg(LOG_DEBUG, __FILE__, __LINE__, "Field %llu, row %llu length is: %lu\n", j, i, (*result_set)->result_set[i]->field_length[j]);
 
-				(*result_set)->result_set[i]->field[j] = (char *) calloc((*result_set)->result_set[i]->field_length[j], sizeof(char));
+				//Empty cells are set to an empty string, since the field array is NULL terminated
+				(*result_set)->result_set[i]->field[j] =
+				    (char *) calloc((*result_set)->result_set[i]->field_length[j] ? (*result_set)->result_set[i]->field_length[j] : 1, sizeof(char));
 				if (!((*result_set)->result_set[i]->field[j])) {
 					pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to alloc memory\n");
-					free(reply);
-					free(sub_reply);
 					oph_io_client_free_result(*result_set);
 					*result_set = NULL;
 					return OPH_IO_CLIENT_INTERFACE_MEMORY_ERR;
 				}
-				memcpy((*result_set)->result_set[i]->field[j], reply + string_head, (*result_set)->result_set[i]->field_length[j]);
-				string_head += (*result_set)->result_set[i]->field_length[j];
+				if (!(*result_set)->result_set[i]->field_length[j])
+					continue;
+				res = _oph_io_client_readn(connection, (*result_set)->result_set[i]->field[j], (*result_set)->result_set[i]->field_length[j]);
+				if (res < 0 || (unsigned long) res != (*result_set)->result_set[i]->field_length[j]) {
+					pmesg(LOG_ERROR, __FILE__, __LINE__, "No reply\n");
+					oph_io_client_free_result(*result_set);
+					*result_set = NULL;
+					return OPH_IO_CLIENT_INTERFACE_CONN_ERR;
+				}
+				//Numeric values are sent in little-endian order
+				if (binary && ((*result_set)->field_type[j] != OPH_IO_CLIENT_FIELD_STRING)) {
+					unsigned long long value;
+					memcpy(&value, (*result_set)->result_set[i]->field[j], OPH_IO_CLIENT_MSG_BINARY_VALUE_LEN);
+					value = le64toh(value);
+					memcpy((*result_set)->result_set[i]->field[j], &value, OPH_IO_CLIENT_MSG_BINARY_VALUE_LEN);
+				}
 
 				//Set max field length
 				if ((*result_set)->max_field_length[j] < (*result_set)->result_set[i]->field_length[j])
 					(*result_set)->max_field_length[j] = (*result_set)->result_set[i]->field_length[j];
 			}
 		}
-		free(sub_reply);
-		free(reply);
+	}
+
+	return OPH_IO_CLIENT_INTERFACE_OK;
+}
+
+int oph_io_client_get_result(oph_io_client_connection * connection, oph_io_client_result ** result_set)
+{
+	return _oph_io_client_get_result(connection, result_set, 0);
+}
+
+int oph_io_client_get_binary_result(oph_io_client_connection * connection, oph_io_client_result ** result_set)
+{
+	return _oph_io_client_get_result(connection, result_set, 1);
+}
+
+int oph_io_client_get_field_type(oph_io_client_result * result_set, unsigned int field, oph_io_client_field_type * type)
+{
+	if (!result_set || !type || field >= result_set->num_fields) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Parameters are not given\n");
+		return OPH_IO_CLIENT_INTERFACE_DATA_ERR;
+	}
+
+	*type = result_set->field_type ? result_set->field_type[field] : OPH_IO_CLIENT_FIELD_STRING;
+
+	return OPH_IO_CLIENT_INTERFACE_OK;
+}
+
+static int _oph_io_client_get_text(oph_io_client_record * row, unsigned int field, char *buffer)
+{
+	//Copy the cell in a null-terminated buffer (text cells already include the terminator)
+	unsigned long length = row->field_length[field];
+	if (length >= OPH_IO_CLIENT_MAX_NUMBER_LEN)
+		length = OPH_IO_CLIENT_MAX_NUMBER_LEN - 1;
+	memcpy(buffer, row->field[field], length);
+	buffer[length] = 0;
+
+	return *buffer ? OPH_IO_CLIENT_INTERFACE_OK : OPH_IO_CLIENT_INTERFACE_DATA_ERR;
+}
+
+int oph_io_client_get_long(oph_io_client_result * result_set, oph_io_client_record * row, unsigned int field, long long *value)
+{
+	if (!result_set || !row || !value || field >= result_set->num_fields) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Parameters are not given\n");
+		return OPH_IO_CLIENT_INTERFACE_DATA_ERR;
+	}
+
+	oph_io_client_field_type type = result_set->field_type ? result_set->field_type[field] : OPH_IO_CLIENT_FIELD_STRING;
+	double tmp;
+	char buffer[OPH_IO_CLIENT_MAX_NUMBER_LEN];
+
+	switch (type) {
+		case OPH_IO_CLIENT_FIELD_LONG:
+			memcpy(value, row->field[field], OPH_IO_CLIENT_MSG_BINARY_VALUE_LEN);
+			break;
+		case OPH_IO_CLIENT_FIELD_REAL:
+			memcpy(&tmp, row->field[field], OPH_IO_CLIENT_MSG_BINARY_VALUE_LEN);
+			*value = (long long) tmp;
+			break;
+		default:
+			if (_oph_io_client_get_text(row, field, buffer)) {
+				pmesg(LOG_ERROR, __FILE__, __LINE__, "Field %u is empty\n", field);
+				return OPH_IO_CLIENT_INTERFACE_DATA_ERR;
+			}
+			*value = (long long) strtoull(buffer, NULL, 10);
+	}
+
+	return OPH_IO_CLIENT_INTERFACE_OK;
+}
+
+int oph_io_client_get_double(oph_io_client_result * result_set, oph_io_client_record * row, unsigned int field, double *value)
+{
+	if (!result_set || !row || !value || field >= result_set->num_fields) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Parameters are not given\n");
+		return OPH_IO_CLIENT_INTERFACE_DATA_ERR;
+	}
+
+	oph_io_client_field_type type = result_set->field_type ? result_set->field_type[field] : OPH_IO_CLIENT_FIELD_STRING;
+	long long tmp;
+	char buffer[OPH_IO_CLIENT_MAX_NUMBER_LEN];
+
+	switch (type) {
+		case OPH_IO_CLIENT_FIELD_LONG:
+			memcpy(&tmp, row->field[field], OPH_IO_CLIENT_MSG_BINARY_VALUE_LEN);
+			*value = (double) tmp;
+			break;
+		case OPH_IO_CLIENT_FIELD_REAL:
+			memcpy(value, row->field[field], OPH_IO_CLIENT_MSG_BINARY_VALUE_LEN);
+			break;
+		default:
+			if (_oph_io_client_get_text(row, field, buffer)) {
+				pmesg(LOG_ERROR, __FILE__, __LINE__, "Field %u is empty\n", field);
+				return OPH_IO_CLIENT_INTERFACE_DATA_ERR;
+			}
+			*value = strtod(buffer, NULL);
 	}
 
 	return OPH_IO_CLIENT_INTERFACE_OK;
@@ -684,6 +902,8 @@ int oph_io_client_free_result(oph_io_client_result * result)
 
 	if (result->max_field_length)
 		free(result->max_field_length);
+	if (result->field_type)
+		free(result->field_type);
 
 	unsigned long long i, j;
 
@@ -722,6 +942,7 @@ int oph_io_client_close(oph_io_client_connection * connection)
 	}
 	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Connection closed\n");
 
+	oph_net_reader_destroy((oph_net_reader **) & (connection->reader));
 	free(connection);
 
 	return OPH_IO_CLIENT_INTERFACE_OK;
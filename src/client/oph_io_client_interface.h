@@ -46,13 +46,26 @@
 ----------------------------------------------------------------------------------------------------------
 */
 
+//Binary result set packet format (numeric cells are 8-byte little-endian values)
+/*
+---------------------------------------------------------------------------------------------------------------------------------------
+| uint64 nrows| uint32 nfields| uint8 field1_type| ...| uint8 fieldN_type| char field11[8]| uint64 field12_len| char *field12| ...|
+---------------------------------------------------------------------------------------------------------------------------------------
+*/
+
 //Header type messages
 #define OPH_IO_CLIENT_MSG_TYPE_LEN 2
 #define OPH_IO_CLIENT_MSG_LONG_LEN sizeof(unsigned long long)
 #define OPH_IO_CLIENT_MSG_SHORT_LEN sizeof(unsigned int)
+#define OPH_IO_CLIENT_MSG_BINARY_VALUE_LEN sizeof(unsigned long long)
+
+#define OPH_IO_CLIENT_MAX_NUMBER_LEN 64
+//Maximum number of fields of a result set (fields are counted by an unsigned short on the server)
+#define OPH_IO_CLIENT_MAX_FIELD_NUM 65535
 
 #define OPH_IO_CLIENT_MSG_PING "PG"
 #define OPH_IO_CLIENT_MSG_RESULT "RS"
+#define OPH_IO_CLIENT_MSG_RESULT_BINARY "RB"
 #define OPH_IO_CLIENT_MSG_USE_DB "UD"
 #define OPH_IO_CLIENT_MSG_SET_QUERY "SQ"
 #define OPH_IO_CLIENT_MSG_EXEC_QUERY "EQ"
@@ -71,12 +84,14 @@
  * \param port   Port of the server
  * \param db   	DB to be used on the server
  * \param socket Id of file descriptor of socket associated to connection
+ * \param reader Buffered reader used to parse replies (internal use)
  */
 typedef struct {
 	char host[OPH_IO_CLIENT_HOST_LEN];
 	char port[OPH_IO_CLIENT_PORT_LEN];
 	char db_name[OPH_IO_CLIENT_DB_LEN];
 	int socket;
+	void *reader;
 } oph_io_client_connection;
 
 /**
@@ -89,6 +104,15 @@ typedef struct {
 	char **field;
 } oph_io_client_record;
 
+/**
+ * \brief           Enum with field types of a binary result set (the same codes are used by the server)
+ */
+typedef enum {
+	OPH_IO_CLIENT_FIELD_LONG = 0,
+	OPH_IO_CLIENT_FIELD_REAL,
+	OPH_IO_CLIENT_FIELD_STRING
+} oph_io_client_field_type;
+
 /**
  * \brief			Structure for the result set to be retrieved
  * \param num_rows		Number of rows of the result set
@@ -96,6 +120,7 @@ typedef struct {
  * \param max_field_length 	Array containing the maximum width of the field
  * \param current_row		Index of current row
  * \param result_set		Pointer to NULL terminated result set
+ * \param field_type		Array containing the type of each field (NULL if numeric fields are sent as text)
  */
 typedef struct {
 	unsigned long long num_rows;
@@ -103,6 +128,7 @@ typedef struct {
 	unsigned long long *max_field_length;
 	unsigned long long current_row;
 	oph_io_client_record **result_set;
+	oph_io_client_field_type *field_type;
 } oph_io_client_result;
 
 /**
@@ -140,6 +166,7 @@ typedef struct {
  * \param args_length   Current length or variable message part
  * \param tot_run       Total number of times the query should be executed
  * \param curr_run      Current value of execution counter
+ * \param handle        Handle of the statement prepared on the server (0 if the query is not prepared)
  */
 typedef struct {
 	void *query;
@@ -149,6 +176,7 @@ typedef struct {
 	unsigned int args_length;
 	unsigned long long tot_run;
 	unsigned long long curr_run;
+	unsigned long long handle;
 } oph_io_client_query;
 
 /**
@@ -198,6 +226,15 @@ int oph_io_client_execute_query(oph_io_client_connection * connection, oph_io_cl
 int oph_io_client_setup_query(oph_io_client_connection * connection, const char *operation, const char *device, unsigned long long tot_run, oph_io_client_query_arg ** args,
 			      oph_io_client_query ** query);
 
+/**
+ * \brief               Function to prepare a query on the server: the query is parsed only once and following executions refer to it by handle.
+ *                      The server releases prepared queries when the connection is closed
+ * \param connection    Pointer to server-specific connection structure
+ * \param query         Pointer to query built with oph_io_client_setup_query
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_client_prepare_query(oph_io_client_connection * connection, oph_io_client_query * query);
+
 /**
  * \brief               Function to release resources allocated for query
  * \param query         Pointer to query to be executed
@@ -226,6 +263,43 @@ int oph_io_client_cleanup();
  */
 int oph_io_client_get_result(oph_io_client_connection * connection, oph_io_client_result ** result_set);
 
+/**
+ * \brief               Function to get result set after executing a query: numeric fields are transferred in binary format.
+ * \param connection    Pointer to server-specific connection structure
+ * \param result_set    Pointer to the result set array to be created
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_client_get_binary_result(oph_io_client_connection * connection, oph_io_client_result ** result_set);
+
+/**
+ * \brief               Function to get the type of a field in a result set (fields of text result sets are always strings).
+ * \param result_set    Pointer to the result set structure
+ * \param field         Index of the field
+ * \param type          Pointer to the type to be filled
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_client_get_field_type(oph_io_client_result * result_set, unsigned int field, oph_io_client_field_type * type);
+
+/**
+ * \brief               Function to get the value of a field as integer (text fields are converted).
+ * \param result_set    Pointer to the result set structure
+ * \param row           Pointer to the row structure
+ * \param field         Index of the field
+ * \param value         Pointer to the value to be filled
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_client_get_long(oph_io_client_result * result_set, oph_io_client_record * row, unsigned int field, long long *value);
+
+/**
+ * \brief               Function to get the value of a field as double (text fields are converted).
+ * \param result_set    Pointer to the result set structure
+ * \param row           Pointer to the row structure
+ * \param field         Index of the field
+ * \param value         Pointer to the value to be filled
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_client_get_double(oph_io_client_result * result_set, oph_io_client_record * row, unsigned int field, double *value);
+
 /**
  * \brief               Function to fetch the next row in a result set.
  * \param result        Pointer to the result set structure to scan
@@ -16,6 +16,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#define _GNU_SOURCE
+
 #include "oph-lib-binary-io.h"
 
 
@@ -214,18 +216,69 @@ int oph_iob_bin_array_create(char **bin_array, long long num_values, int oph_iob
 	return OPH_IOB_OK;
 }
 
-int oph_iob_bin_array_shared_create(int *shm_id, long long num_values, int oph_iob_type)
+int oph_iob_bin_array_shared_create(int *shm_fd, char **bin_array, long long num_values, int oph_iob_type)
 {
+	if (!shm_fd || !bin_array) {
+		pmesg(1, __FILE__, __LINE__, "Invalid binary buffer");
+		return OPH_IOB_NOTBUFFER;
+	}
+	*shm_fd = -1;
+	*bin_array = NULL;
+
 	size_t sizeof_num;
 	int res = oph_iob_sizeof_type(oph_iob_type, &sizeof_num);
 	if (res)
 		return res;
+	size_t size = sizeof_num * num_values * sizeof(char);
 
-	*shm_id = shmget(IPC_PRIVATE, sizeof_num * num_values * sizeof(char), IPC_CREAT | IPC_EXCL | S_IRUSR | S_IWUSR);
-	if ((*shm_id) < 0) {
+	//The area has no name, so it cannot outlive the processes using it
+#ifdef MFD_CLOEXEC
+	*shm_fd = memfd_create("oph_iob_bin_array", MFD_CLOEXEC);
+#else
+	static unsigned long shm_counter = 0;
+	char shm_name[64];
+	snprintf(shm_name, sizeof(shm_name), "/oph_iob_%d_%lu", (int) getpid(), __sync_fetch_and_add(&shm_counter, 1));
+	if ((*shm_fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR)) >= 0)
+		shm_unlink(shm_name);
+#endif
+	if ((*shm_fd) < 0) {
 		pmesg(1, __FILE__, __LINE__, "Error in creating shared memory %s\n", strerror(errno));
 		return OPH_IOB_NOMEM;
 	}
+	if (ftruncate(*shm_fd, size ? size : 1)) {
+		pmesg(1, __FILE__, __LINE__, "Error in creating shared memory %s\n", strerror(errno));
+		close(*shm_fd);
+		*shm_fd = -1;
+		return OPH_IOB_NOMEM;
+	}
+	char *area = (char *) mmap(NULL, size ? size : 1, PROT_READ | PROT_WRITE, MAP_SHARED, *shm_fd, 0);
+	if (area == MAP_FAILED) {
+		pmesg(1, __FILE__, __LINE__, "Error in mapping shared memory %s\n", strerror(errno));
+		close(*shm_fd);
+		*shm_fd = -1;
+		return OPH_IOB_NOMEM;
+	}
+	*bin_array = area;
+
+	return OPH_IOB_OK;
+}
+
+int oph_iob_bin_array_shared_free(int *shm_fd, char **bin_array)
+{
+	if (!shm_fd || !bin_array) {
+		pmesg(1, __FILE__, __LINE__, "Invalid binary buffer");
+		return OPH_IOB_NOTBUFFER;
+	}
+	if (*shm_fd < 0)
+		return OPH_IOB_OK;
+
+	struct stat st;
+	if (*bin_array && !fstat(*shm_fd, &st))
+		munmap(*bin_array, st.st_size);
+	close(*shm_fd);
+	*shm_fd = -1;
+	*bin_array = NULL;
+
 	return OPH_IOB_OK;
 }
 
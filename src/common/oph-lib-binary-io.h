@@ -22,9 +22,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/ipc.h>
-#include <sys/shm.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <errno.h>
 #include "debug.h"
 
@@ -221,19 +222,28 @@ int oph_iob_copy_in_numeric_array(const char *bin_array, long long array_length,
 int oph_iob_bin_array_create(char **bin_array, long long num_values, int oph_iob_type);
 
 /**
- * \brief Allocate a shared memory area for storing as binary values a predefined number of numeric (double | float | int | long) values
- * \param shm_id Id of the shared memory to allocate; it may subsequently be deallocated
+ * \brief Allocate an anonymous shared memory area for storing as binary values a predefined number of numeric (double | float | int | long) values. The area is released by the kernel as soon as its descriptor is closed and unmapped by every process using it
+ * \param shm_fd Descriptor of the shared memory, that can be passed to other processes; it may subsequently be deallocated with oph_iob_bin_array_shared_free
+ * \param bin_array Pointer to be filled with the shared memory mapped in the address space of the process
  * \param num_values Number of numeric values to store
  * \return 0 if succes, != 0 otherwise
  */
-#define oph_iob_bin_array_shared_create_i(shm_id, num_values) oph_iob_bin_array_shared_create(shm_id,num_values,OPH_IOB_INT)
-#define oph_iob_bin_array_shared_create_f(shm_id, num_values) oph_iob_bin_array_shared_create(shm_id,num_values,OPH_IOB_FLOAT)
-#define oph_iob_bin_array_shared_create_d(shm_id, num_values) oph_iob_bin_array_shared_create(shm_id,num_values,OPH_IOB_DOUBLE)
-#define oph_iob_bin_array_shared_create_c(shm_id, num_values) oph_iob_bin_array_shared_create(shm_id,num_values,OPH_IOB_CHAR)
-#define oph_iob_bin_array_shared_create_l(shm_id, num_values) oph_iob_bin_array_shared_create(shm_id,num_values,OPH_IOB_LONG)
-#define oph_iob_bin_array_shared_create_s(shm_id, num_values) oph_iob_bin_array_shared_create(shm_id,num_values,OPH_IOB_SHORT)
-#define oph_iob_bin_array_shared_create_b(shm_id, num_values) oph_iob_bin_array_shared_create(shm_id,num_values,OPH_IOB_BYTE)
-int oph_iob_bin_array_shared_create(int *shm_id, long long num_values, int oph_iob_type);
+#define oph_iob_bin_array_shared_create_i(shm_fd, bin_array, num_values) oph_iob_bin_array_shared_create(shm_fd,bin_array,num_values,OPH_IOB_INT)
+#define oph_iob_bin_array_shared_create_f(shm_fd, bin_array, num_values) oph_iob_bin_array_shared_create(shm_fd,bin_array,num_values,OPH_IOB_FLOAT)
+#define oph_iob_bin_array_shared_create_d(shm_fd, bin_array, num_values) oph_iob_bin_array_shared_create(shm_fd,bin_array,num_values,OPH_IOB_DOUBLE)
+#define oph_iob_bin_array_shared_create_c(shm_fd, bin_array, num_values) oph_iob_bin_array_shared_create(shm_fd,bin_array,num_values,OPH_IOB_CHAR)
+#define oph_iob_bin_array_shared_create_l(shm_fd, bin_array, num_values) oph_iob_bin_array_shared_create(shm_fd,bin_array,num_values,OPH_IOB_LONG)
+#define oph_iob_bin_array_shared_create_s(shm_fd, bin_array, num_values) oph_iob_bin_array_shared_create(shm_fd,bin_array,num_values,OPH_IOB_SHORT)
+#define oph_iob_bin_array_shared_create_b(shm_fd, bin_array, num_values) oph_iob_bin_array_shared_create(shm_fd,bin_array,num_values,OPH_IOB_BYTE)
+int oph_iob_bin_array_shared_create(int *shm_fd, char **bin_array, long long num_values, int oph_iob_type);
+
+/**
+ * \brief Release a shared memory area allocated with oph_iob_bin_array_shared_create
+ * \param shm_fd Descriptor of the shared memory; it is set to -1
+ * \param bin_array Pointer to the mapped shared memory; it is set to NULL
+ * \return 0 if succes, != 0 otherwise
+ */
+int oph_iob_bin_array_shared_free(int *shm_fd, char **bin_array);
 
 /**
  * \brief Add (or replace) a binary value in the binary array
@@ -0,0 +1,173 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "oph_server_arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <debug.h>
+
+extern int msglevel;
+
+static oph_server_arena_block *_oph_server_arena_new_block(size_t size)
+{
+	oph_server_arena_block *block = (oph_server_arena_block *) malloc(sizeof(oph_server_arena_block) + size);
+	if (!block)
+		return NULL;
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+	return block;
+}
+
+int oph_server_arena_create(oph_server_arena ** arena, size_t block_size)
+{
+	if (!arena) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		return OPH_SERVER_ARENA_NULL_PARAM;
+	}
+
+	*arena = (oph_server_arena *) malloc(sizeof(oph_server_arena));
+	if (!*arena) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Error allocating arena\n");
+		return OPH_SERVER_ARENA_MEMORY_ERROR;
+	}
+	(*arena)->head = NULL;
+	(*arena)->side = NULL;
+	(*arena)->block_size = (block_size ? block_size : OPH_SERVER_ARENA_BLOCK_SIZE);
+
+	return OPH_SERVER_ARENA_SUCCESS;
+}
+
+void *oph_server_arena_alloc(oph_server_arena * arena, size_t size)
+{
+	if (!arena || !size)
+		return NULL;
+
+	size = (size + OPH_SERVER_ARENA_ALIGNMENT - 1) & ~((size_t) OPH_SERVER_ARENA_ALIGNMENT - 1);
+
+	oph_server_arena_block *block = arena->head;
+	if (size > arena->block_size) {
+		//Oversized requests get a dedicated side block, so that the rest of the current block is still used
+		block = _oph_server_arena_new_block(size);
+		if (!block) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Error allocating arena block\n");
+			return NULL;
+		}
+		block->next = arena->side;
+		arena->side = block;
+	} else if (!block || (block->size - block->used < size)) {
+		block = _oph_server_arena_new_block(arena->block_size);
+		if (!block) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Error allocating arena block\n");
+			return NULL;
+		}
+		block->next = arena->head;
+		arena->head = block;
+	}
+
+	void *ptr = block->data + block->used;
+	block->used += size;
+	memset(ptr, 0, size);
+
+	return ptr;
+}
+
+int oph_server_arena_get_mark(oph_server_arena * arena, oph_server_arena_mark * mark)
+{
+	if (!arena || !mark)
+		return OPH_SERVER_ARENA_NULL_PARAM;
+
+	mark->block = arena->head;
+	mark->used = (arena->head ? arena->head->used : 0);
+	mark->side = arena->side;
+
+	return OPH_SERVER_ARENA_SUCCESS;
+}
+
+int oph_server_arena_rewind(oph_server_arena * arena, oph_server_arena_mark * mark)
+{
+	if (!arena || !mark)
+		return OPH_SERVER_ARENA_NULL_PARAM;
+
+	oph_server_arena_block *tmp = NULL;
+	while (arena->side && (arena->side != mark->side)) {
+		tmp = arena->side->next;
+		free(arena->side);
+		arena->side = tmp;
+	}
+	while (arena->head && (arena->head != mark->block)) {
+		tmp = arena->head->next;
+		free(arena->head);
+		arena->head = tmp;
+	}
+	if (arena->head)
+		arena->head->used = mark->used;
+
+	return OPH_SERVER_ARENA_SUCCESS;
+}
+
+int oph_server_arena_reset(oph_server_arena * arena)
+{
+	if (!arena)
+		return OPH_SERVER_ARENA_NULL_PARAM;
+
+	oph_server_arena_block *tmp = NULL;
+	while (arena->side) {
+		tmp = arena->side->next;
+		free(arena->side);
+		arena->side = tmp;
+	}
+	while (arena->head && arena->head->next) {
+		tmp = arena->head->next;
+		free(arena->head);
+		arena->head = tmp;
+	}
+	//Keep the first block for reuse
+	if (arena->head)
+		arena->head->used = 0;
+
+	return OPH_SERVER_ARENA_SUCCESS;
+}
+
+int oph_server_arena_destroy(oph_server_arena ** arena)
+{
+	if (!arena)
+		return OPH_SERVER_ARENA_NULL_PARAM;
+	if (!*arena)
+		return OPH_SERVER_ARENA_SUCCESS;
+
+	oph_server_arena_block *tmp = NULL;
+	while ((*arena)->side) {
+		tmp = (*arena)->side->next;
+		free((*arena)->side);
+		(*arena)->side = tmp;
+	}
+	while ((*arena)->head) {
+		tmp = (*arena)->head->next;
+		free((*arena)->head);
+		(*arena)->head = tmp;
+	}
+	free(*arena);
+	*arena = NULL;
+
+	return OPH_SERVER_ARENA_SUCCESS;
+}
@@ -0,0 +1,115 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPH_SERVER_ARENA_H
+#define OPH_SERVER_ARENA_H
+
+#include <stddef.h>
+
+#define OPH_SERVER_ARENA_SUCCESS		0
+#define OPH_SERVER_ARENA_NULL_PARAM		1
+#define OPH_SERVER_ARENA_MEMORY_ERROR	2
+
+#define OPH_SERVER_ARENA_BLOCK_SIZE		1048576
+#define OPH_SERVER_ARENA_ALIGNMENT		16
+
+/**
+ * \brief			    Structure of a memory block belonging to an arena
+ * \param next        Previous block of the arena (blocks are chained from the most recent one)
+ * \param size        Size of the data area in bytes
+ * \param used        Bytes of the data area already assigned
+ * \param data        Data area (the header is padded so that it starts at the arena alignment)
+ */
+typedef struct _oph_server_arena_block {
+	struct _oph_server_arena_block *next;
+	size_t size;
+	size_t used;
+	char data[] __attribute__ ((aligned(OPH_SERVER_ARENA_ALIGNMENT)));
+} oph_server_arena_block;
+
+/**
+ * \brief			    Structure of a bump allocator used for transient allocations (it is not thread-safe and should be owned by a single thread)
+ * \param head        Block currently used for allocations
+ * \param side        Blocks allocated for requests larger than block_size, chained from the most recent one
+ * \param block_size  Default size of new blocks in bytes
+ */
+typedef struct {
+	oph_server_arena_block *head;
+	oph_server_arena_block *side;
+	size_t block_size;
+} oph_server_arena;
+
+/**
+ * \brief			    Structure used to save the state of an arena and restore it later
+ * \param block       Block in use when the mark was taken
+ * \param used        Bytes of the block in use when the mark was taken
+ * \param side        Most recent side block when the mark was taken
+ */
+typedef struct {
+	oph_server_arena_block *block;
+	size_t used;
+	oph_server_arena_block *side;
+} oph_server_arena_mark;
+
+/**
+ * \brief			    Function used to create an arena
+ * \param arena       Arena to be created
+ * \param block_size  Size of each memory block in bytes (0 to use the default size)
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_server_arena_create(oph_server_arena ** arena, size_t block_size);
+
+/**
+ * \brief			    Function used to allocate a memory area from an arena. The area must not be freed: it is released with the arena
+ * \param arena       Arena to be used
+ * \param size        Size of the area in bytes
+ * \return            Pointer to the area (zero-filled) or NULL if an error occurred
+ */
+void *oph_server_arena_alloc(oph_server_arena * arena, size_t size);
+
+/**
+ * \brief			    Function used to save the current state of an arena
+ * \param arena       Arena to be considered
+ * \param mark        Mark to be filled
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_server_arena_get_mark(oph_server_arena * arena, oph_server_arena_mark * mark);
+
+/**
+ * \brief			    Function used to release all the areas allocated after a mark
+ * \param arena       Arena to be rewound
+ * \param mark        Mark previously obtained from the same arena
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_server_arena_rewind(oph_server_arena * arena, oph_server_arena_mark * mark);
+
+/**
+ * \brief			    Function used to release all the areas allocated from an arena (only the first block is kept for reuse)
+ * \param arena       Arena to be reset
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_server_arena_reset(oph_server_arena * arena);
+
+/**
+ * \brief			    Function used to destroy an arena and release all its memory
+ * \param arena       Arena to be destroyed
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_server_arena_destroy(oph_server_arena ** arena);
+
+#endif				/* OPH_SERVER_ARENA_H */
@@ -33,14 +33,14 @@
 extern int msglevel;
 extern char *oph_server_conf_file;
 
-int oph_server_conf_load(short unsigned int instance, HASHTBL ** hashtbl)
+int oph_server_conf_load(short unsigned int instance, oph_server_hashmap ** hashtbl)
 {
 	if (!hashtbl) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
 		return OPH_SERVER_CONF_NULL_PARAM;
 	}
 
-	if (!(*hashtbl = hashtbl_create(OPH_SERVER_CONF_LOAD_SIZE, NULL))) {
+	if (!(*hashtbl = oph_server_hashmap_create(OPH_SERVER_CONF_LOAD_SIZE, OPH_SERVER_HASHMAP_OWN_ALL))) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to create hash table\n");
 		return OPH_SERVER_CONF_ERROR;
 	}
@@ -48,7 +48,7 @@ int oph_server_conf_load(short unsigned int instance, HASHTBL ** hashtbl)
 	FILE *file = fopen(oph_server_conf_file, "r");
 	if (file == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "Configuration file not found\n");
-		hashtbl_destroy(*hashtbl);
+		oph_server_hashmap_destroy(*hashtbl);
 		*hashtbl = NULL;
 		return OPH_SERVER_CONF_ERROR;
 	} else {
@@ -74,7 +74,7 @@ int oph_server_conf_load(short unsigned int instance, HASHTBL ** hashtbl)
 				} else {
 					fclose(file);
 					pmesg(LOG_ERROR, __FILE__, __LINE__, "Error while reading configuration file\n");
-					hashtbl_destroy(*hashtbl);
+					oph_server_hashmap_destroy(*hashtbl);
 					return OPH_SERVER_CONF_ERROR;
 				}
 			}
@@ -146,16 +146,22 @@ int oph_server_conf_load(short unsigned int instance, HASHTBL ** hashtbl)
 						if (value == NULL) {
 							pmesg(LOG_ERROR, __FILE__, __LINE__, "Error while copying param %s\n", buffer);
 							fclose(file);
-							hashtbl_destroy(*hashtbl);
+							oph_server_hashmap_destroy(*hashtbl);
 							*hashtbl = NULL;
 							return OPH_SERVER_CONF_ERROR;
 						}
 
-						if (hashtbl_insert(*hashtbl, buffer, value)) {
+						int res = oph_server_hashmap_insert(*hashtbl, buffer, value);
+						if (res == OPH_SERVER_HASHMAP_KEY_EXISTS) {
+							pmesg(LOG_DEBUG, __FILE__, __LINE__, "Configuration param already loaded %s\n", buffer);
+							free(value);
+							continue;
+						}
+						if (res) {
 							pmesg(LOG_ERROR, __FILE__, __LINE__, "Error while loading param %s\n", buffer);
 							fclose(file);
 							free(value);
-							hashtbl_destroy(*hashtbl);
+							oph_server_hashmap_destroy(*hashtbl);
 							*hashtbl = NULL;
 							return OPH_SERVER_CONF_ERROR;
 						}
@@ -176,24 +182,24 @@ int oph_server_conf_load(short unsigned int instance, HASHTBL ** hashtbl)
 	return OPH_SERVER_CONF_SUCCESS;
 }
 
-int oph_server_conf_get_param(HASHTBL * hashtbl, const char *param, char **value)
+int oph_server_conf_get_param(oph_server_hashmap * hashtbl, const char *param, char **value)
 {
 	if (!hashtbl || !param) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
 		return OPH_SERVER_CONF_NULL_PARAM;
 	}
 
-	*value = hashtbl_get(hashtbl, param);
+	*value = oph_server_hashmap_get(hashtbl, param);
 	if (!*value)
 		return OPH_SERVER_CONF_ERROR;
 
 	return OPH_SERVER_CONF_SUCCESS;
 }
 
-int oph_server_conf_unload(HASHTBL ** hashtbl)
+int oph_server_conf_unload(oph_server_hashmap ** hashtbl)
 {
 	if (hashtbl && *hashtbl) {
-		hashtbl_destroy(*hashtbl);
+		oph_server_hashmap_destroy(*hashtbl);
 		*hashtbl = NULL;
 	}
 
@@ -19,7 +19,9 @@
 #ifndef __OPH_SERVER_CONFS_H
 #define __OPH_SERVER_CONFS_H
 
-#include "hashtbl.h"
+#include <stddef.h>
+
+#include "oph_server_hashmap.h"
 
 //IO server defines
 
@@ -70,11 +72,21 @@
 #define OPH_SERVER_CONF_CACHE_LINE_SIZE	  "CACHE_LINE_SIZE"
 #define OPH_SERVER_CONF_CACHE_SIZE     	  "CACHE_SIZE"
 #define OPH_SERVER_CONF_WORKING_DIR    	  "WORKING_DIR"
+#define OPH_SERVER_CONF_PRELOAD_PLUGINS	  "PRELOAD_PLUGINS"
+#define OPH_SERVER_CONF_MEMORY_LIMIT	  "MEMORY_LIMIT"
+#define OPH_SERVER_CONF_MEMORY_CHECK_PERIOD	"MEMORY_CHECK_PERIOD"
+#define OPH_SERVER_CONF_WORKER_THREADS	  "WORKER_THREADS"
+#define OPH_SERVER_CONF_NC_CACHE_SIZE	  "NC_CACHE_SIZE"
+#define OPH_SERVER_CONF_NC_CACHE_IDLE_TIME	"NC_CACHE_IDLE_TIME"
+#define OPH_SERVER_CONF_NC_LOAD_PROCESSES	"NC_LOAD_PROCESSES"
+#define OPH_SERVER_CONF_TRANSPOSE_TUNE	  "TRANSPOSE_TUNE"
 
 
 static const char *const oph_server_conf_params[] =
     { OPH_SERVER_CONF_HOSTNAME, OPH_SERVER_CONF_PORT, OPH_SERVER_CONF_DIR, OPH_SERVER_CONF_MPL, OPH_SERVER_CONF_TTL, OPH_SERVER_CONF_OMP_THREADS, OPH_SERVER_CONF_MEMORY_BUFFER,
-	OPH_SERVER_CONF_CACHE_LINE_SIZE, OPH_SERVER_CONF_CACHE_SIZE, OPH_SERVER_CONF_WORKING_DIR, NULL
+	OPH_SERVER_CONF_CACHE_LINE_SIZE, OPH_SERVER_CONF_CACHE_SIZE, OPH_SERVER_CONF_WORKING_DIR,
+	OPH_SERVER_CONF_PRELOAD_PLUGINS, OPH_SERVER_CONF_MEMORY_LIMIT, OPH_SERVER_CONF_MEMORY_CHECK_PERIOD, OPH_SERVER_CONF_WORKER_THREADS,
+	OPH_SERVER_CONF_NC_CACHE_SIZE, OPH_SERVER_CONF_NC_CACHE_IDLE_TIME, OPH_SERVER_CONF_NC_LOAD_PROCESSES, OPH_SERVER_CONF_TRANSPOSE_TUNE, NULL
 };
 
 /**
@@ -83,7 +95,7 @@ static const char *const oph_server_conf_params[] =
  * \param hashtbl     Pointer to hash table containing param list
  * \return            0 if successfull, non-0 otherwise
  */
-int oph_server_conf_load(short unsigned int instance, HASHTBL ** hashtbl);
+int oph_server_conf_load(short unsigned int instance, oph_server_hashmap ** hashtbl);
 
 /**
  * \brief			        Function to get a param from configuration hash table
@@ -92,13 +104,13 @@ int oph_server_conf_load(short unsigned int instance, HASHTBL ** hashtbl);
  * \param value       Value found
  * \return            0 if successfull, non-0 otherwise
  */
-int oph_server_conf_get_param(HASHTBL * hashtbl, const char *param, char **value);
+int oph_server_conf_get_param(oph_server_hashmap * hashtbl, const char *param, char **value);
 
 /**
  * \brief			        Function to unload parameters from configuration file
  * \param hashtbl     Pointer to hash table containing param list
  * \return            0 if successfull, non-0 otherwise
  */
-int oph_server_conf_unload(HASHTBL ** hashtbl);
+int oph_server_conf_unload(oph_server_hashmap ** hashtbl);
 
 #endif				//__OPH_SERVER_CONFS_H
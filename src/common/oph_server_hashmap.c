@@ -0,0 +1,383 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "oph_server_hashmap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <debug.h>
+
+extern int msglevel;
+
+//Finalizer of MurmurHash3: every input bit affects the low bits used to select the slot
+static inline unsigned long long _oph_server_hashmap_mix(unsigned long long key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+	return key;
+}
+
+//64-bit FNV-1a
+static inline unsigned long long _oph_server_hashmap_hash_string(const char *key)
+{
+	unsigned long long hash = 0xcbf29ce484222325ULL;
+	while (*key) {
+		hash ^= (unsigned char) *key++;
+		hash *= 0x100000001b3ULL;
+	}
+	return _oph_server_hashmap_mix(hash);
+}
+
+static unsigned long long _oph_server_hashmap_capacity(unsigned long long size)
+{
+	unsigned long long capacity = OPH_SERVER_HASHMAP_MIN_CAPACITY;
+	//Keep load factor below 3/4
+	while (capacity * 3 < size * 4)
+		capacity <<= 1;
+	return capacity;
+}
+
+static int _oph_server_hashmap_grow(oph_server_hashmap * map)
+{
+	unsigned long long capacity = map->capacity << 1, mask = capacity - 1, i, h;
+	oph_server_hashmap_entry *entries = (oph_server_hashmap_entry *) calloc(capacity, sizeof(oph_server_hashmap_entry));
+	if (!entries) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Error allocating hash map\n");
+		return OPH_SERVER_HASHMAP_MEMORY_ERROR;
+	}
+
+	for (i = 0; i < map->capacity; i++) {
+		if (!map->entries[i].key)
+			continue;
+		h = map->entries[i].hash & mask;
+		while (entries[h].key)
+			h = (h + 1) & mask;
+		entries[h] = map->entries[i];
+	}
+
+	free(map->entries);
+	map->entries = entries;
+	map->capacity = capacity;
+
+	return OPH_SERVER_HASHMAP_SUCCESS;
+}
+
+static void _oph_server_hashmap_release_entry(oph_server_hashmap * map, oph_server_hashmap_entry * entry)
+{
+	if (!(map->flags & OPH_SERVER_HASHMAP_BORROW_KEYS))
+		free(entry->key);
+	if (!(map->flags & OPH_SERVER_HASHMAP_BORROW_VALUES) && entry->value)
+		free(entry->value);
+}
+
+oph_server_hashmap *oph_server_hashmap_create(unsigned long long size, int flags)
+{
+	oph_server_hashmap *map = (oph_server_hashmap *) malloc(sizeof(oph_server_hashmap));
+	if (!map) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Error allocating hash map\n");
+		return NULL;
+	}
+
+	map->capacity = _oph_server_hashmap_capacity(size);
+	map->count = 0;
+	map->flags = flags;
+	if (!(map->entries = (oph_server_hashmap_entry *) calloc(map->capacity, sizeof(oph_server_hashmap_entry)))) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Error allocating hash map\n");
+		free(map);
+		return NULL;
+	}
+
+	return map;
+}
+
+void oph_server_hashmap_destroy(oph_server_hashmap * map)
+{
+	if (!map)
+		return;
+
+	unsigned long long i;
+	if ((map->flags & (OPH_SERVER_HASHMAP_BORROW_KEYS | OPH_SERVER_HASHMAP_BORROW_VALUES)) != (OPH_SERVER_HASHMAP_BORROW_KEYS | OPH_SERVER_HASHMAP_BORROW_VALUES))
+		for (i = 0; i < map->capacity; i++)
+			if (map->entries[i].key)
+				_oph_server_hashmap_release_entry(map, map->entries + i);
+
+	free(map->entries);
+	free(map);
+}
+
+int oph_server_hashmap_insert(oph_server_hashmap * map, const char *key, void *value)
+{
+	if (!map || !key)
+		return OPH_SERVER_HASHMAP_NULL_PARAM;
+
+	unsigned long long hash = _oph_server_hashmap_hash_string(key), mask = map->capacity - 1, h = hash & mask;
+	while (map->entries[h].key) {
+		if (map->entries[h].hash == hash && !strcmp(map->entries[h].key, key))
+			return OPH_SERVER_HASHMAP_KEY_EXISTS;
+		h = (h + 1) & mask;
+	}
+
+	char *new_key = (char *) key;
+	if (!(map->flags & OPH_SERVER_HASHMAP_BORROW_KEYS) && !(new_key = strdup(key))) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Error allocating hash map key\n");
+		return OPH_SERVER_HASHMAP_MEMORY_ERROR;
+	}
+
+	if ((map->count + 1) * 4 > map->capacity * 3) {
+		if (_oph_server_hashmap_grow(map)) {
+			if (new_key != key)
+				free(new_key);
+			return OPH_SERVER_HASHMAP_MEMORY_ERROR;
+		}
+		mask = map->capacity - 1;
+		h = hash & mask;
+		while (map->entries[h].key)
+			h = (h + 1) & mask;
+	}
+
+	map->entries[h].key = new_key;
+	map->entries[h].hash = hash;
+	map->entries[h].value = value;
+	map->count++;
+
+	return OPH_SERVER_HASHMAP_SUCCESS;
+}
+
+void *oph_server_hashmap_get(oph_server_hashmap * map, const char *key)
+{
+	if (!map || !key)
+		return NULL;
+
+	unsigned long long hash = _oph_server_hashmap_hash_string(key), mask = map->capacity - 1, h = hash & mask;
+	while (map->entries[h].key) {
+		if (map->entries[h].hash == hash && !strcmp(map->entries[h].key, key))
+			return map->entries[h].value;
+		h = (h + 1) & mask;
+	}
+
+	return NULL;
+}
+
+int oph_server_hashmap_remove(oph_server_hashmap * map, const char *key)
+{
+	if (!map || !key)
+		return OPH_SERVER_HASHMAP_NULL_PARAM;
+
+	unsigned long long hash = _oph_server_hashmap_hash_string(key), mask = map->capacity - 1, h = hash & mask, j;
+	while (map->entries[h].key) {
+		if (map->entries[h].hash == hash && !strcmp(map->entries[h].key, key))
+			break;
+		h = (h + 1) & mask;
+	}
+	if (!map->entries[h].key)
+		return OPH_SERVER_HASHMAP_NOT_FOUND;
+
+	_oph_server_hashmap_release_entry(map, map->entries + h);
+	map->count--;
+
+	//Backward shift: move back the following entries of the cluster that could not be placed in their home slot
+	for (j = (h + 1) & mask; map->entries[j].key; j = (j + 1) & mask) {
+		if (((j - (map->entries[j].hash & mask)) & mask) >= ((j - h) & mask)) {
+			map->entries[h] = map->entries[j];
+			h = j;
+		}
+	}
+	map->entries[h].key = NULL;
+	map->entries[h].value = NULL;
+
+	return OPH_SERVER_HASHMAP_SUCCESS;
+}
+
+int oph_server_hashmap_next(oph_server_hashmap * map, unsigned long long *iter, const char **key, void **value)
+{
+	if (!map || !iter)
+		return 0;
+
+	for (; *iter < map->capacity; (*iter)++) {
+		if (map->entries[*iter].key) {
+			if (key)
+				*key = map->entries[*iter].key;
+			if (value)
+				*value = map->entries[*iter].value;
+			(*iter)++;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static int _oph_server_hashmap64_grow(oph_server_hashmap64 * map)
+{
+	unsigned long long capacity = map->capacity << 1, mask = capacity - 1, i, h;
+	long long *keys = (long long *) malloc(capacity * sizeof(long long));
+	long long *values = (long long *) malloc(capacity * sizeof(long long));
+	char *used = (char *) calloc(capacity, sizeof(char));
+	if (!keys || !values || !used) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Error allocating hash map\n");
+		if (keys)
+			free(keys);
+		if (values)
+			free(values);
+		if (used)
+			free(used);
+		return OPH_SERVER_HASHMAP_MEMORY_ERROR;
+	}
+
+	for (i = 0; i < map->capacity; i++) {
+		if (!map->used[i])
+			continue;
+		h = _oph_server_hashmap_mix((unsigned long long) map->keys[i]) & mask;
+		while (used[h])
+			h = (h + 1) & mask;
+		keys[h] = map->keys[i];
+		values[h] = map->values[i];
+		used[h] = 1;
+	}
+
+	free(map->keys);
+	free(map->values);
+	free(map->used);
+	map->keys = keys;
+	map->values = values;
+	map->used = used;
+	map->capacity = capacity;
+
+	return OPH_SERVER_HASHMAP_SUCCESS;
+}
+
+//Slot of the key if it is found, otherwise the empty slot where it should be added
+static inline unsigned long long _oph_server_hashmap64_find(oph_server_hashmap64 * map, long long key)
+{
+	unsigned long long mask = map->capacity - 1, h = _oph_server_hashmap_mix((unsigned long long) key) & mask;
+	while (map->used[h] && map->keys[h] != key)
+		h = (h + 1) & mask;
+	return h;
+}
+
+oph_server_hashmap64 *oph_server_hashmap64_create(unsigned long long size)
+{
+	oph_server_hashmap64 *map = (oph_server_hashmap64 *) calloc(1, sizeof(oph_server_hashmap64));
+	if (!map) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Error allocating hash map\n");
+		return NULL;
+	}
+
+	map->capacity = _oph_server_hashmap_capacity(size);
+	map->keys = (long long *) malloc(map->capacity * sizeof(long long));
+	map->values = (long long *) malloc(map->capacity * sizeof(long long));
+	map->used = (char *) calloc(map->capacity, sizeof(char));
+	if (!map->keys || !map->values || !map->used) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Error allocating hash map\n");
+		oph_server_hashmap64_destroy(map);
+		return NULL;
+	}
+
+	return map;
+}
+
+void oph_server_hashmap64_destroy(oph_server_hashmap64 * map)
+{
+	if (!map)
+		return;
+
+	if (map->keys)
+		free(map->keys);
+	if (map->values)
+		free(map->values);
+	if (map->used)
+		free(map->used);
+	free(map);
+}
+
+int oph_server_hashmap64_get_or_insert(oph_server_hashmap64 * map, long long key, long long *value)
+{
+	if (!map || !value)
+		return OPH_SERVER_HASHMAP_NULL_PARAM;
+
+	unsigned long long h = _oph_server_hashmap64_find(map, key);
+	if (map->used[h]) {
+		*value = map->values[h];
+		return OPH_SERVER_HASHMAP_KEY_EXISTS;
+	}
+
+	if ((map->count + 1) * 4 > map->capacity * 3) {
+		if (_oph_server_hashmap64_grow(map))
+			return OPH_SERVER_HASHMAP_MEMORY_ERROR;
+		h = _oph_server_hashmap64_find(map, key);
+	}
+
+	map->keys[h] = key;
+	map->values[h] = *value;
+	map->used[h] = 1;
+	map->count++;
+
+	return OPH_SERVER_HASHMAP_SUCCESS;
+}
+
+int oph_server_hashmap64_set(oph_server_hashmap64 * map, long long key, long long value)
+{
+	long long tmp = value;
+	int res = oph_server_hashmap64_get_or_insert(map, key, &tmp);
+	if (res == OPH_SERVER_HASHMAP_KEY_EXISTS) {
+		map->values[_oph_server_hashmap64_find(map, key)] = value;
+		return OPH_SERVER_HASHMAP_SUCCESS;
+	}
+
+	return res;
+}
+
+int oph_server_hashmap64_get(oph_server_hashmap64 * map, long long key, long long *value)
+{
+	if (!map || !value)
+		return OPH_SERVER_HASHMAP_NULL_PARAM;
+
+	unsigned long long h = _oph_server_hashmap64_find(map, key);
+	if (!map->used[h])
+		return OPH_SERVER_HASHMAP_NOT_FOUND;
+
+	*value = map->values[h];
+	return OPH_SERVER_HASHMAP_SUCCESS;
+}
+
+int oph_server_hashmap64_remove(oph_server_hashmap64 * map, long long key)
+{
+	if (!map)
+		return OPH_SERVER_HASHMAP_NULL_PARAM;
+
+	unsigned long long mask = map->capacity - 1, h = _oph_server_hashmap64_find(map, key), j;
+	if (!map->used[h])
+		return OPH_SERVER_HASHMAP_NOT_FOUND;
+	map->count--;
+
+	//Backward shift: move back the following keys of the cluster that could not be placed in their home slot
+	for (j = (h + 1) & mask; map->used[j]; j = (j + 1) & mask) {
+		if (((j - (_oph_server_hashmap_mix((unsigned long long) map->keys[j]) & mask)) & mask) >= ((j - h) & mask)) {
+			map->keys[h] = map->keys[j];
+			map->values[h] = map->values[j];
+			h = j;
+		}
+	}
+	map->used[h] = 0;
+
+	return OPH_SERVER_HASHMAP_SUCCESS;
+}
@@ -0,0 +1,176 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPH_SERVER_HASHMAP_H
+#define OPH_SERVER_HASHMAP_H
+
+#define OPH_SERVER_HASHMAP_SUCCESS			0
+#define OPH_SERVER_HASHMAP_NULL_PARAM		1
+#define OPH_SERVER_HASHMAP_MEMORY_ERROR		2
+#define OPH_SERVER_HASHMAP_KEY_EXISTS		3
+#define OPH_SERVER_HASHMAP_NOT_FOUND		4
+
+//Creation flags
+#define OPH_SERVER_HASHMAP_OWN_ALL			0x0
+//Keys are not copied: they must outlive the map
+#define OPH_SERVER_HASHMAP_BORROW_KEYS		0x1
+//Values are not released by remove and destroy
+#define OPH_SERVER_HASHMAP_BORROW_VALUES	0x2
+
+#define OPH_SERVER_HASHMAP_MIN_CAPACITY		8
+
+/**
+ * \brief			    Slot of a map with string keys
+ * \param key         Key of the slot, NULL for empty slots
+ * \param hash        64-bit hash of the key
+ * \param value       Value related to the key
+ */
+typedef struct {
+	char *key;
+	unsigned long long hash;
+	void *value;
+} oph_server_hashmap_entry;
+
+/**
+ * \brief			    Map with string keys based on open addressing with linear probing. The table grows automatically (the capacity is a power of 2) and it is not thread-safe
+ * \param capacity    Number of slots
+ * \param count       Number of keys stored
+ * \param flags       Creation flags (OPH_SERVER_HASHMAP_BORROW_*)
+ * \param entries     Array of slots
+ */
+typedef struct {
+	unsigned long long capacity;
+	unsigned long long count;
+	int flags;
+	oph_server_hashmap_entry *entries;
+} oph_server_hashmap;
+
+/**
+ * \brief			    Map with 64-bit integer keys and 64-bit integer values (e.g. group ids or array indexes) based on open addressing with linear probing. It is not thread-safe
+ * \param capacity    Number of slots (power of 2)
+ * \param count       Number of keys stored
+ * \param keys        Array of keys
+ * \param values      Array of values
+ * \param used        Array of flags set for non-empty slots
+ */
+typedef struct {
+	unsigned long long capacity;
+	unsigned long long count;
+	long long *keys;
+	long long *values;
+	char *used;
+} oph_server_hashmap64;
+
+/**
+ * \brief			    Function used to create a map with string keys
+ * \param size        Expected number of keys (the map grows anyway when needed)
+ * \param flags       Ownership flags: by default keys are copied and values are released with free()
+ * \return            Map created, NULL in case of error
+ */
+oph_server_hashmap *oph_server_hashmap_create(unsigned long long size, int flags);
+
+/**
+ * \brief			    Function used to release a map (owned keys and values are released too)
+ * \param map         Map to be released
+ */
+void oph_server_hashmap_destroy(oph_server_hashmap * map);
+
+/**
+ * \brief			    Function used to add a key to a map. Existing keys are left unchanged and the map does not take ownership of the value
+ * \param map         Map to be updated
+ * \param key         Key to be added
+ * \param value       Value related to the key
+ * \return            0 if successfull, OPH_SERVER_HASHMAP_KEY_EXISTS if the key is already in the map, other non-0 values in case of error
+ */
+int oph_server_hashmap_insert(oph_server_hashmap * map, const char *key, void *value);
+
+/**
+ * \brief			    Function used to find the value related to a key
+ * \param map         Map to be used
+ * \param key         Key to be found
+ * \return            Value related to the key, NULL if the key is not found
+ */
+void *oph_server_hashmap_get(oph_server_hashmap * map, const char *key);
+
+/**
+ * \brief			    Function used to remove a key (owned key and value are released)
+ * \param map         Map to be updated
+ * \param key         Key to be removed
+ * \return            0 if successfull, OPH_SERVER_HASHMAP_NOT_FOUND if the key is not in the map
+ */
+int oph_server_hashmap_remove(oph_server_hashmap * map, const char *key);
+
+/**
+ * \brief			    Function used to iterate over the keys of a map in slot order. The map must not be changed while iterating
+ * \param map         Map to be scanned
+ * \param iter        Iterator: it has to be set to 0 before the first call
+ * \param key         Next key found (can be NULL)
+ * \param value       Value related to the next key (can be NULL)
+ * \return            1 if a key is found, 0 at the end of the map
+ */
+int oph_server_hashmap_next(oph_server_hashmap * map, unsigned long long *iter, const char **key, void **value);
+
+/**
+ * \brief			    Function used to create a map with integer keys
+ * \param size        Expected number of keys (the map grows anyway when needed)
+ * \return            Map created, NULL in case of error
+ */
+oph_server_hashmap64 *oph_server_hashmap64_create(unsigned long long size);
+
+/**
+ * \brief			    Function used to release a map with integer keys
+ * \param map         Map to be released
+ */
+void oph_server_hashmap64_destroy(oph_server_hashmap64 * map);
+
+/**
+ * \brief			    Function used to find the value related to a key or to add it if it is not found
+ * \param map         Map to be updated
+ * \param key         Key to be found
+ * \param value       Value to be related to the key if it is not found; it is set to the value found otherwise
+ * \return            0 if the key has been added, OPH_SERVER_HASHMAP_KEY_EXISTS if the key was already in the map, other non-0 values in case of error
+ */
+int oph_server_hashmap64_get_or_insert(oph_server_hashmap64 * map, long long key, long long *value);
+
+/**
+ * \brief			    Function used to add a key or to update its value
+ * \param map         Map to be updated
+ * \param key         Key to be set
+ * \param value       Value to be related to the key
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_server_hashmap64_set(oph_server_hashmap64 * map, long long key, long long value);
+
+/**
+ * \brief			    Function used to find the value related to a key
+ * \param map         Map to be used
+ * \param key         Key to be found
+ * \param value       Value found
+ * \return            0 if successfull, OPH_SERVER_HASHMAP_NOT_FOUND if the key is not in the map
+ */
+int oph_server_hashmap64_get(oph_server_hashmap64 * map, long long key, long long *value);
+
+/**
+ * \brief			    Function used to remove a key
+ * \param map         Map to be updated
+ * \param key         Key to be removed
+ * \return            0 if successfull, OPH_SERVER_HASHMAP_NOT_FOUND if the key is not in the map
+ */
+int oph_server_hashmap64_remove(oph_server_hashmap64 * map, long long key);
+
+#endif				/* OPH_SERVER_HASHMAP_H */
@@ -0,0 +1,159 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "oph_server_hashmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define OPH_SERVER_HASHMAP_BENCH_KEYS		1000000
+#define OPH_SERVER_HASHMAP_BENCH_GROUPS		1000
+#define OPH_SERVER_HASHMAP_BENCH_KEY_LEN	32
+
+static double _oph_server_hashmap_bench_now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void _oph_server_hashmap_bench_report(const char *name, double start, unsigned long long ops)
+{
+	double elapsed = _oph_server_hashmap_bench_now() - start;
+	printf("%-28s %12llu ops %10.3f s %10.1f ns/op\n", name, ops, elapsed, ops ? elapsed * 1e9 / ops : 0);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long long n = OPH_SERVER_HASHMAP_BENCH_KEYS, i, found = 0;
+	if (argc > 1 && !(n = strtoull(argv[1], NULL, 10))) {
+		fprintf(stderr, "Usage: %s [number of keys]\n", argv[0]);
+		return 1;
+	}
+
+	char *keys = (char *) malloc(n * OPH_SERVER_HASHMAP_BENCH_KEY_LEN);
+	if (!keys) {
+		fprintf(stderr, "Unable to allocate keys\n");
+		return 1;
+	}
+	for (i = 0; i < n; i++)
+		snprintf(keys + i * OPH_SERVER_HASHMAP_BENCH_KEY_LEN, OPH_SERVER_HASHMAP_BENCH_KEY_LEN, "frag_%llu", i);
+
+	double start;
+
+	//String keys: start from a small map to include growth
+	oph_server_hashmap *map = oph_server_hashmap_create(0, OPH_SERVER_HASHMAP_BORROW_VALUES);
+	if (!map) {
+		fprintf(stderr, "Unable to create map\n");
+		free(keys);
+		return 1;
+	}
+
+	start = _oph_server_hashmap_bench_now();
+	for (i = 0; i < n; i++)
+		if (oph_server_hashmap_insert(map, keys + i * OPH_SERVER_HASHMAP_BENCH_KEY_LEN, keys + i * OPH_SERVER_HASHMAP_BENCH_KEY_LEN)) {
+			fprintf(stderr, "Unable to insert key %llu\n", i);
+			oph_server_hashmap_destroy(map);
+			free(keys);
+			return 1;
+		}
+	_oph_server_hashmap_bench_report("string insert", start, n);
+
+	start = _oph_server_hashmap_bench_now();
+	for (i = 0; i < n; i++)
+		if (oph_server_hashmap_get(map, keys + ((i * 7919) % n) * OPH_SERVER_HASHMAP_BENCH_KEY_LEN))
+			found++;
+	_oph_server_hashmap_bench_report("string get (hit)", start, n);
+
+	char miss[OPH_SERVER_HASHMAP_BENCH_KEY_LEN];
+	start = _oph_server_hashmap_bench_now();
+	for (i = 0; i < n; i++) {
+		snprintf(miss, OPH_SERVER_HASHMAP_BENCH_KEY_LEN, "miss_%llu", i);
+		if (oph_server_hashmap_get(map, miss))
+			found++;
+	}
+	_oph_server_hashmap_bench_report("string get (miss)", start, n);
+
+	unsigned long long iter = 0, scanned = 0;
+	start = _oph_server_hashmap_bench_now();
+	while (oph_server_hashmap_next(map, &iter, NULL, NULL))
+		scanned++;
+	_oph_server_hashmap_bench_report("string iterate", start, scanned);
+
+	start = _oph_server_hashmap_bench_now();
+	for (i = 0; i < n; i++)
+		oph_server_hashmap_remove(map, keys + i * OPH_SERVER_HASHMAP_BENCH_KEY_LEN);
+	_oph_server_hashmap_bench_report("string remove", start, n);
+
+	if (found != n || scanned != n || map->count) {
+		fprintf(stderr, "Wrong results: %llu keys found, %llu keys scanned, %llu keys left\n", found, scanned, map->count);
+		oph_server_hashmap_destroy(map);
+		free(keys);
+		return 1;
+	}
+	oph_server_hashmap_destroy(map);
+	free(keys);
+
+	//Integer keys: group ids assigned to n rows with a limited number of distinct keys
+	oph_server_hashmap64 *map64 = oph_server_hashmap64_create(0);
+	if (!map64) {
+		fprintf(stderr, "Unable to create map\n");
+		return 1;
+	}
+
+	long long value = 0, groups = 0;
+	start = _oph_server_hashmap_bench_now();
+	for (i = 0; i < n; i++) {
+		value = groups;
+		if (!oph_server_hashmap64_get_or_insert(map64, (long long) ((i * 2654435761ULL) % OPH_SERVER_HASHMAP_BENCH_GROUPS), &value))
+			groups++;
+	}
+	_oph_server_hashmap_bench_report("int64 group ids", start, n);
+
+	oph_server_hashmap64_destroy(map64);
+	if (!(map64 = oph_server_hashmap64_create(0))) {
+		fprintf(stderr, "Unable to create map\n");
+		return 1;
+	}
+
+	start = _oph_server_hashmap_bench_now();
+	for (i = 0; i < n; i++)
+		oph_server_hashmap64_set(map64, (long long) (i * 2654435761ULL), (long long) i);
+	_oph_server_hashmap_bench_report("int64 insert", start, n);
+
+	found = 0;
+	start = _oph_server_hashmap_bench_now();
+	for (i = 0; i < n; i++)
+		if (!oph_server_hashmap64_get(map64, (long long) (((i * 7919) % n) * 2654435761ULL), &value))
+			found++;
+	_oph_server_hashmap_bench_report("int64 get (hit)", start, n);
+
+	start = _oph_server_hashmap_bench_now();
+	for (i = 0; i < n; i++)
+		oph_server_hashmap64_remove(map64, (long long) (i * 2654435761ULL));
+	_oph_server_hashmap_bench_report("int64 remove", start, n);
+
+	int res = (groups != OPH_SERVER_HASHMAP_BENCH_GROUPS && n >= OPH_SERVER_HASHMAP_BENCH_GROUPS) || found != n || map64->count;
+	if (res)
+		fprintf(stderr, "Wrong results: %lld groups, %llu keys found, %llu keys left\n", groups, found, map64->count);
+	oph_server_hashmap64_destroy(map64);
+
+	return res;
+}
@@ -0,0 +1,253 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "oph_server_hashmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Keys are drawn from a small set, so that removals are interleaved with insertions of the same keys
+#define OPH_SERVER_HASHMAP_TEST_KEYS		4096
+#define OPH_SERVER_HASHMAP_TEST_OPS			500000
+#define OPH_SERVER_HASHMAP_TEST_CHECK		10000
+#define OPH_SERVER_HASHMAP_TEST_KEY_LEN		32
+
+static unsigned long long _oph_server_hashmap_test_seed = 1;
+
+static unsigned long long _oph_server_hashmap_test_rand(unsigned long long max)
+{
+	_oph_server_hashmap_test_seed = _oph_server_hashmap_test_seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return (_oph_server_hashmap_test_seed >> 33) % max;
+}
+
+//Compare the whole map with the reference: every key has to be found once, with the expected value
+static int _oph_server_hashmap_test_check(oph_server_hashmap * map, char *keys, long long *values)
+{
+	unsigned long long i, iter = 0, count = 0;
+	const char *key = NULL;
+	void *value = NULL;
+	char *seen = (char *) calloc(OPH_SERVER_HASHMAP_TEST_KEYS, sizeof(char));
+	if (!seen)
+		return 1;
+
+	for (i = 0; i < OPH_SERVER_HASHMAP_TEST_KEYS; i++) {
+		value = oph_server_hashmap_get(map, keys + i * OPH_SERVER_HASHMAP_TEST_KEY_LEN);
+		if ((values[i] < 0) != !value || (value && *((long long *) value) != values[i])) {
+			fprintf(stderr, "Wrong value of key %s\n", keys + i * OPH_SERVER_HASHMAP_TEST_KEY_LEN);
+			free(seen);
+			return 1;
+		}
+		if (values[i] >= 0)
+			count++;
+	}
+	if (map->count != count) {
+		fprintf(stderr, "Wrong number of keys: %llu instead of %llu\n", map->count, count);
+		free(seen);
+		return 1;
+	}
+	while (oph_server_hashmap_next(map, &iter, &key, &value)) {
+		i = strtoull(key + 4, NULL, 10);
+		if (i >= OPH_SERVER_HASHMAP_TEST_KEYS || seen[i] || values[i] != *((long long *) value)) {
+			fprintf(stderr, "Wrong key found while iterating: %s\n", key);
+			free(seen);
+			return 1;
+		}
+		seen[i] = 1;
+		count--;
+	}
+	free(seen);
+	if (count) {
+		fprintf(stderr, "%llu keys not found while iterating\n", count);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int _oph_server_hashmap_test_string(int flags)
+{
+	char *keys = (char *) malloc(OPH_SERVER_HASHMAP_TEST_KEYS * OPH_SERVER_HASHMAP_TEST_KEY_LEN);
+	long long *values = (long long *) malloc(OPH_SERVER_HASHMAP_TEST_KEYS * sizeof(long long));
+	long long *borrowed = (long long *) malloc(OPH_SERVER_HASHMAP_TEST_KEYS * sizeof(long long));
+	oph_server_hashmap *map = oph_server_hashmap_create(0, flags);
+	if (!keys || !values || !borrowed || !map) {
+		fprintf(stderr, "Unable to allocate the map\n");
+		if (keys)
+			free(keys);
+		if (values)
+			free(values);
+		if (borrowed)
+			free(borrowed);
+		if (map)
+			oph_server_hashmap_destroy(map);
+		return 1;
+	}
+
+	unsigned long long i, k;
+	for (i = 0; i < OPH_SERVER_HASHMAP_TEST_KEYS; i++) {
+		snprintf(keys + i * OPH_SERVER_HASHMAP_TEST_KEY_LEN, OPH_SERVER_HASHMAP_TEST_KEY_LEN, "key_%llu", i);
+		values[i] = -1;
+	}
+
+	int res = 0, ret;
+	char *key = NULL;
+	long long *value = NULL;
+	for (i = 0; !res && i < OPH_SERVER_HASHMAP_TEST_OPS; i++) {
+		k = _oph_server_hashmap_test_rand(OPH_SERVER_HASHMAP_TEST_KEYS);
+		key = keys + k * OPH_SERVER_HASHMAP_TEST_KEY_LEN;
+		//Removals are as frequent as insertions
+		if (_oph_server_hashmap_test_rand(2)) {
+			if (flags & OPH_SERVER_HASHMAP_BORROW_VALUES)
+				value = borrowed + k;
+			else if (!(value = (long long *) malloc(sizeof(long long)))) {
+				fprintf(stderr, "Unable to allocate a value\n");
+				res = 1;
+				break;
+			}
+			*value = (values[k] < 0 ? (long long) i : values[k]);
+			ret = oph_server_hashmap_insert(map, key, value);
+			if (ret != (values[k] < 0 ? OPH_SERVER_HASHMAP_SUCCESS : OPH_SERVER_HASHMAP_KEY_EXISTS)) {
+				fprintf(stderr, "Wrong result of insert of key %s: %d\n", key, ret);
+				res = 1;
+			}
+			if (ret && !(flags & OPH_SERVER_HASHMAP_BORROW_VALUES))
+				free(value);
+			if (!ret)
+				values[k] = (long long) i;
+		} else {
+			ret = oph_server_hashmap_remove(map, key);
+			if (ret != (values[k] < 0 ? OPH_SERVER_HASHMAP_NOT_FOUND : OPH_SERVER_HASHMAP_SUCCESS)) {
+				fprintf(stderr, "Wrong result of remove of key %s: %d\n", key, ret);
+				res = 1;
+			}
+			values[k] = -1;
+		}
+		if (!res && !(i % OPH_SERVER_HASHMAP_TEST_CHECK))
+			res = _oph_server_hashmap_test_check(map, keys, values);
+	}
+	if (!res)
+		res = _oph_server_hashmap_test_check(map, keys, values);
+
+	oph_server_hashmap_destroy(map);
+	free(keys);
+	free(values);
+	free(borrowed);
+
+	return res;
+}
+
+static int _oph_server_hashmap_test_int64()
+{
+	long long *values = (long long *) malloc(OPH_SERVER_HASHMAP_TEST_KEYS * sizeof(long long));
+	char *present = (char *) calloc(OPH_SERVER_HASHMAP_TEST_KEYS, sizeof(char));
+	oph_server_hashmap64 *map = oph_server_hashmap64_create(0);
+	if (!values || !present || !map) {
+		fprintf(stderr, "Unable to allocate the map\n");
+		if (values)
+			free(values);
+		if (present)
+			free(present);
+		if (map)
+			oph_server_hashmap64_destroy(map);
+		return 1;
+	}
+
+	unsigned long long i, k, count = 0;
+	long long key, value;
+	int res = 0, ret;
+	for (i = 0; !res && i < OPH_SERVER_HASHMAP_TEST_OPS; i++) {
+		k = _oph_server_hashmap_test_rand(OPH_SERVER_HASHMAP_TEST_KEYS);
+		//Keys sharing the low bits and negative keys
+		key = (k & 1 ? -1 : 1) * (long long) (k << 32);
+		switch (_oph_server_hashmap_test_rand(4)) {
+			case 0:
+				value = (long long) i;
+				ret = oph_server_hashmap64_get_or_insert(map, key, &value);
+				if (ret != (present[k] ? OPH_SERVER_HASHMAP_KEY_EXISTS : OPH_SERVER_HASHMAP_SUCCESS) || value != (present[k] ? values[k] : (long long) i)) {
+					fprintf(stderr, "Wrong result of get_or_insert of key %lld: %d\n", key, ret);
+					res = 1;
+				}
+				if (!present[k]) {
+					present[k] = 1;
+					values[k] = (long long) i;
+					count++;
+				}
+				break;
+			case 1:
+				if (oph_server_hashmap64_set(map, key, (long long) i)) {
+					fprintf(stderr, "Unable to set key %lld\n", key);
+					res = 1;
+				}
+				if (!present[k])
+					count++;
+				present[k] = 1;
+				values[k] = (long long) i;
+				break;
+			default:
+				ret = oph_server_hashmap64_remove(map, key);
+				if (ret != (present[k] ? OPH_SERVER_HASHMAP_SUCCESS : OPH_SERVER_HASHMAP_NOT_FOUND)) {
+					fprintf(stderr, "Wrong result of remove of key %lld: %d\n", key, ret);
+					res = 1;
+				}
+				if (present[k])
+					count--;
+				present[k] = 0;
+		}
+		if (!res && !(i % OPH_SERVER_HASHMAP_TEST_CHECK)) {
+			for (k = 0; !res && k < OPH_SERVER_HASHMAP_TEST_KEYS; k++) {
+				key = (k & 1 ? -1 : 1) * (long long) (k << 32);
+				ret = oph_server_hashmap64_get(map, key, &value);
+				if (ret != (present[k] ? OPH_SERVER_HASHMAP_SUCCESS : OPH_SERVER_HASHMAP_NOT_FOUND) || (present[k] && value != values[k])) {
+					fprintf(stderr, "Wrong value of key %lld\n", key);
+					res = 1;
+				}
+			}
+			if (!res && map->count != count) {
+				fprintf(stderr, "Wrong number of keys: %llu instead of %llu\n", map->count, count);
+				res = 1;
+			}
+		}
+	}
+
+	oph_server_hashmap64_destroy(map);
+	free(values);
+	free(present);
+
+	return res;
+}
+
+int main()
+{
+	int res = 0;
+
+	if (_oph_server_hashmap_test_string(OPH_SERVER_HASHMAP_OWN_ALL)) {
+		fprintf(stderr, "String map with owned keys and values: FAILED\n");
+		res = 1;
+	}
+	if (_oph_server_hashmap_test_string(OPH_SERVER_HASHMAP_BORROW_VALUES)) {
+		fprintf(stderr, "String map with borrowed values: FAILED\n");
+		res = 1;
+	}
+	if (_oph_server_hashmap_test_int64()) {
+		fprintf(stderr, "Integer map: FAILED\n");
+		res = 1;
+	}
+
+	return res;
+}
@@ -0,0 +1,163 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "oph_server_memory.h"
+#include "oph_server_utility.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/sysinfo.h>
+
+#include <debug.h>
+
+extern int msglevel;
+
+//Memory budget: all the fields are accessed with atomic builtins
+static unsigned long long oph_memory_limit = 0;
+static unsigned long long oph_memory_used = 0;
+static int oph_memory_low = 0;
+static int oph_memory_sampling = 0;
+
+//Background sampler
+static pthread_t oph_memory_sampler;
+static pthread_mutex_t oph_memory_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t oph_memory_cond = PTHREAD_COND_INITIALIZER;
+static unsigned int oph_memory_period = 0;
+static char oph_memory_stop = 0;
+
+static int _oph_server_memory_sample()
+{
+	struct sysinfo info;
+
+	if (sysinfo(&info))
+		return OPH_SERVER_MEMORY_ERROR;
+
+	unsigned long long total_ram = (unsigned long long) info.totalram * info.mem_unit;
+	unsigned long long free_ram = ((unsigned long long) info.freeram + info.bufferram) * info.mem_unit;
+	unsigned long long min_free_mem = (unsigned long long) (OPH_MIN_MEMORY_PERC * (total_ram < OPH_MIN_MEMORY ? OPH_MIN_MEMORY : total_ram));
+
+	return (free_ram < min_free_mem ? OPH_SERVER_MEMORY_LIMIT_ERROR : OPH_SERVER_MEMORY_SUCCESS);
+}
+
+static void *_oph_server_memory_sampler(void *arg)
+{
+	UNUSED(arg);
+
+	struct timespec deadline;
+
+	pthread_mutex_lock(&oph_memory_lock);
+	while (!oph_memory_stop) {
+		__atomic_store_n(&oph_memory_low, _oph_server_memory_sample()? 1 : 0, __ATOMIC_RELAXED);
+
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += oph_memory_period;
+		while (!oph_memory_stop && (pthread_cond_timedwait(&oph_memory_cond, &oph_memory_lock, &deadline) != ETIMEDOUT));
+	}
+	pthread_mutex_unlock(&oph_memory_lock);
+
+	return NULL;
+}
+
+int oph_server_memory_init(unsigned long long limit, unsigned int period)
+{
+	__atomic_store_n(&oph_memory_limit, limit, __ATOMIC_RELAXED);
+
+	if (!period || __atomic_load_n(&oph_memory_sampling, __ATOMIC_RELAXED))
+		return OPH_SERVER_MEMORY_SUCCESS;
+
+	oph_memory_period = period;
+	oph_memory_stop = 0;
+	__atomic_store_n(&oph_memory_low, _oph_server_memory_sample()? 1 : 0, __ATOMIC_RELAXED);
+
+	if (pthread_create(&oph_memory_sampler, NULL, &_oph_server_memory_sampler, NULL)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to start memory sampler\n");
+		return OPH_SERVER_MEMORY_ERROR;
+	}
+	__atomic_store_n(&oph_memory_sampling, 1, __ATOMIC_RELEASE);
+
+	return OPH_SERVER_MEMORY_SUCCESS;
+}
+
+int oph_server_memory_finalize()
+{
+	if (!__atomic_load_n(&oph_memory_sampling, __ATOMIC_ACQUIRE))
+		return OPH_SERVER_MEMORY_SUCCESS;
+
+	pthread_mutex_lock(&oph_memory_lock);
+	oph_memory_stop = 1;
+	pthread_cond_signal(&oph_memory_cond);
+	pthread_mutex_unlock(&oph_memory_lock);
+
+	if (pthread_join(oph_memory_sampler, NULL)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to stop memory sampler\n");
+		return OPH_SERVER_MEMORY_ERROR;
+	}
+	__atomic_store_n(&oph_memory_sampling, 0, __ATOMIC_RELEASE);
+
+	return OPH_SERVER_MEMORY_SUCCESS;
+}
+
+int oph_server_memory_reserve(unsigned long long size)
+{
+	if (!size)
+		return OPH_SERVER_MEMORY_SUCCESS;
+
+	if (__atomic_load_n(&oph_memory_low, __ATOMIC_RELAXED)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Out of memory\n");
+		return OPH_SERVER_MEMORY_LIMIT_ERROR;
+	}
+
+	unsigned long long limit = __atomic_load_n(&oph_memory_limit, __ATOMIC_RELAXED);
+	if (!limit) {
+		__atomic_add_fetch(&oph_memory_used, size, __ATOMIC_RELAXED);
+		return OPH_SERVER_MEMORY_SUCCESS;
+	}
+
+	unsigned long long used = __atomic_load_n(&oph_memory_used, __ATOMIC_RELAXED);
+	do {
+		if ((size > limit) || (used > limit - size)) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Memory limit exceeded: %llu bytes requested, %llu bytes already reserved\n", size, used);
+			return OPH_SERVER_MEMORY_LIMIT_ERROR;
+		}
+	} while (!__atomic_compare_exchange_n(&oph_memory_used, &used, used + size, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	return OPH_SERVER_MEMORY_SUCCESS;
+}
+
+void oph_server_memory_release(unsigned long long size)
+{
+	if (size)
+		__atomic_sub_fetch(&oph_memory_used, size, __ATOMIC_RELAXED);
+}
+
+unsigned long long oph_server_memory_get_used()
+{
+	return __atomic_load_n(&oph_memory_used, __ATOMIC_RELAXED);
+}
+
+int oph_server_memory_check_system()
+{
+	if (__atomic_load_n(&oph_memory_sampling, __ATOMIC_ACQUIRE))
+		return (__atomic_load_n(&oph_memory_low, __ATOMIC_RELAXED) ? OPH_SERVER_MEMORY_LIMIT_ERROR : OPH_SERVER_MEMORY_SUCCESS);
+
+	return _oph_server_memory_sample();
+}
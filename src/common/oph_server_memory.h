@@ -0,0 +1,69 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPH_SERVER_MEMORY_H
+#define OPH_SERVER_MEMORY_H
+
+#define OPH_SERVER_MEMORY_SUCCESS			0
+#define OPH_SERVER_MEMORY_NULL_PARAM		1
+#define OPH_SERVER_MEMORY_ERROR				2
+#define OPH_SERVER_MEMORY_LIMIT_ERROR		3
+
+#define OPH_SERVER_MEMORY_CHECK_PERIOD		1
+#define OPH_SERVER_MEMORY_MB_SIZE			1048576
+
+/**
+ * \brief			        Function used to setup the memory budget shared by all the threads
+ * \param limit       Maximum number of bytes that can be reserved (0 for no limit)
+ * \param period      Period in seconds of the background sampling of system memory (0 to disable sampling)
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_server_memory_init(unsigned long long limit, unsigned int period);
+
+/**
+ * \brief			        Function used to stop the background sampling of system memory
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_server_memory_finalize();
+
+/**
+ * \brief			        Function used to reserve a number of bytes from the memory budget
+ * \param size        Number of bytes to be reserved
+ * \return            0 if successfull, non-0 if the budget is exceeded or the system is low on memory
+ */
+int oph_server_memory_reserve(unsigned long long size);
+
+/**
+ * \brief			        Function used to give back to the memory budget a number of bytes previously reserved
+ * \param size        Number of bytes to be released
+ */
+void oph_server_memory_release(unsigned long long size);
+
+/**
+ * \brief			        Function used to get the number of bytes currently reserved
+ * \return            Number of bytes reserved
+ */
+unsigned long long oph_server_memory_get_used();
+
+/**
+ * \brief			        Function used to check if free system memory is below the threshold. When background sampling is enabled the last sample is used
+ * \return            0 if memory is enough, non-0 otherwise
+ */
+int oph_server_memory_check_system();
+
+#endif				/* OPH_SERVER_MEMORY_H */
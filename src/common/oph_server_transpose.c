@@ -0,0 +1,393 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "oph_server_transpose.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <debug.h>
+
+extern int msglevel;
+
+//Sizes in bytes of a leaf of the recursion and of a cache line: they are set at startup and only read afterwards
+static size_t oph_transpose_leaf_size = OPH_SERVER_TRANSPOSE_LEAF_SIZE;
+static size_t oph_transpose_line_size = OPH_SERVER_TRANSPOSE_LINE_SIZE;
+
+//Kernels applied to the innermost dimensions of a leaf
+#define OPH_TRANSPOSE_KERNEL_RUN		0	//A dimension is contiguous both in source and destination
+#define OPH_TRANSPOSE_KERNEL_TILE		1	//A dimension is contiguous in source and another one in destination
+#define OPH_TRANSPOSE_KERNEL_STRIDED	2	//No dimension is contiguous in source
+
+typedef void (*oph_transpose_tile_kernel) (size_t rows, size_t cols, const char *src, size_t src_ld, char *dst, size_t dst_ld, size_t sizeof_var);
+typedef void (*oph_transpose_strided_kernel) (size_t n, const char *src, size_t src_stride, char *dst, size_t dst_stride, size_t sizeof_var);
+
+typedef struct _oph_transpose_plan {
+	int ndims;
+	size_t *src_stride;
+	size_t *dst_stride;
+	size_t sizeof_var;
+	int kernel;
+	int src_dim;		//Dimension contiguous in source (for tiles) or copied by the kernel (for runs and strided copies)
+	int dst_dim;		//Dimension contiguous in destination (for tiles)
+	oph_transpose_tile_kernel tile;
+	oph_transpose_strided_kernel strided;
+} oph_transpose_plan;
+
+//Scalar kernels: the copy of a value has a constant size, so that it is compiled as a single move
+#define OPH_TRANSPOSE_SCALAR(NAME, SIZE) \
+static void NAME(size_t rows, size_t cols, const char *src, size_t src_ld, char *dst, size_t dst_ld, size_t sizeof_var) \
+{ \
+	size_t i, j; \
+	(void) sizeof_var; \
+	for (j = 0; j < cols; j++) \
+		for (i = 0; i < rows; i++) \
+			memcpy(dst + (j * dst_ld + i) * (SIZE), src + (i * src_ld + j) * (SIZE), (SIZE)); \
+}
+
+#define OPH_TRANSPOSE_STRIDED(NAME, SIZE) \
+static void NAME(size_t n, const char *src, size_t src_stride, char *dst, size_t dst_stride, size_t sizeof_var) \
+{ \
+	size_t k; \
+	(void) sizeof_var; \
+	for (k = 0; k < n; k++) \
+		memcpy(dst + k * dst_stride * (SIZE), src + k * src_stride * (SIZE), (SIZE)); \
+}
+
+OPH_TRANSPOSE_SCALAR(_oph_server_transpose_scalar_1, 1)
+OPH_TRANSPOSE_SCALAR(_oph_server_transpose_scalar_2, 2)
+OPH_TRANSPOSE_SCALAR(_oph_server_transpose_scalar_4, 4)
+OPH_TRANSPOSE_SCALAR(_oph_server_transpose_scalar_8, 8)
+OPH_TRANSPOSE_SCALAR(_oph_server_transpose_scalar_n, sizeof_var)
+
+OPH_TRANSPOSE_STRIDED(_oph_server_transpose_strided_1, 1)
+OPH_TRANSPOSE_STRIDED(_oph_server_transpose_strided_2, 2)
+OPH_TRANSPOSE_STRIDED(_oph_server_transpose_strided_4, 4)
+OPH_TRANSPOSE_STRIDED(_oph_server_transpose_strided_8, 8)
+OPH_TRANSPOSE_STRIDED(_oph_server_transpose_strided_n, sizeof_var)
+
+#ifdef __SSE2__
+//In-register transpose of square blocks: src_ld and dst_ld are in bytes
+static inline void _oph_server_transpose_block_2(const char *src, size_t src_ld, char *dst, size_t dst_ld)
+{
+	__m128i r0 = _mm_loadu_si128((const __m128i *) (src));
+	__m128i r1 = _mm_loadu_si128((const __m128i *) (src + src_ld));
+	__m128i r2 = _mm_loadu_si128((const __m128i *) (src + 2 * src_ld));
+	__m128i r3 = _mm_loadu_si128((const __m128i *) (src + 3 * src_ld));
+	__m128i r4 = _mm_loadu_si128((const __m128i *) (src + 4 * src_ld));
+	__m128i r5 = _mm_loadu_si128((const __m128i *) (src + 5 * src_ld));
+	__m128i r6 = _mm_loadu_si128((const __m128i *) (src + 6 * src_ld));
+	__m128i r7 = _mm_loadu_si128((const __m128i *) (src + 7 * src_ld));
+
+	__m128i a0 = _mm_unpacklo_epi16(r0, r1), a1 = _mm_unpackhi_epi16(r0, r1);
+	__m128i a2 = _mm_unpacklo_epi16(r2, r3), a3 = _mm_unpackhi_epi16(r2, r3);
+	__m128i a4 = _mm_unpacklo_epi16(r4, r5), a5 = _mm_unpackhi_epi16(r4, r5);
+	__m128i a6 = _mm_unpacklo_epi16(r6, r7), a7 = _mm_unpackhi_epi16(r6, r7);
+
+	__m128i b0 = _mm_unpacklo_epi32(a0, a2), b1 = _mm_unpackhi_epi32(a0, a2);
+	__m128i b2 = _mm_unpacklo_epi32(a1, a3), b3 = _mm_unpackhi_epi32(a1, a3);
+	__m128i b4 = _mm_unpacklo_epi32(a4, a6), b5 = _mm_unpackhi_epi32(a4, a6);
+	__m128i b6 = _mm_unpacklo_epi32(a5, a7), b7 = _mm_unpackhi_epi32(a5, a7);
+
+	_mm_storeu_si128((__m128i *) (dst), _mm_unpacklo_epi64(b0, b4));
+	_mm_storeu_si128((__m128i *) (dst + dst_ld), _mm_unpackhi_epi64(b0, b4));
+	_mm_storeu_si128((__m128i *) (dst + 2 * dst_ld), _mm_unpacklo_epi64(b1, b5));
+	_mm_storeu_si128((__m128i *) (dst + 3 * dst_ld), _mm_unpackhi_epi64(b1, b5));
+	_mm_storeu_si128((__m128i *) (dst + 4 * dst_ld), _mm_unpacklo_epi64(b2, b6));
+	_mm_storeu_si128((__m128i *) (dst + 5 * dst_ld), _mm_unpackhi_epi64(b2, b6));
+	_mm_storeu_si128((__m128i *) (dst + 6 * dst_ld), _mm_unpacklo_epi64(b3, b7));
+	_mm_storeu_si128((__m128i *) (dst + 7 * dst_ld), _mm_unpackhi_epi64(b3, b7));
+}
+
+static inline void _oph_server_transpose_block_4(const char *src, size_t src_ld, char *dst, size_t dst_ld)
+{
+	__m128i r0 = _mm_loadu_si128((const __m128i *) (src));
+	__m128i r1 = _mm_loadu_si128((const __m128i *) (src + src_ld));
+	__m128i r2 = _mm_loadu_si128((const __m128i *) (src + 2 * src_ld));
+	__m128i r3 = _mm_loadu_si128((const __m128i *) (src + 3 * src_ld));
+
+	__m128i t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpacklo_epi32(r2, r3);
+	__m128i t2 = _mm_unpackhi_epi32(r0, r1), t3 = _mm_unpackhi_epi32(r2, r3);
+
+	_mm_storeu_si128((__m128i *) (dst), _mm_unpacklo_epi64(t0, t1));
+	_mm_storeu_si128((__m128i *) (dst + dst_ld), _mm_unpackhi_epi64(t0, t1));
+	_mm_storeu_si128((__m128i *) (dst + 2 * dst_ld), _mm_unpacklo_epi64(t2, t3));
+	_mm_storeu_si128((__m128i *) (dst + 3 * dst_ld), _mm_unpackhi_epi64(t2, t3));
+}
+
+static inline void _oph_server_transpose_block_8(const char *src, size_t src_ld, char *dst, size_t dst_ld)
+{
+	__m128i r0 = _mm_loadu_si128((const __m128i *) (src));
+	__m128i r1 = _mm_loadu_si128((const __m128i *) (src + src_ld));
+
+	_mm_storeu_si128((__m128i *) (dst), _mm_unpacklo_epi64(r0, r1));
+	_mm_storeu_si128((__m128i *) (dst + dst_ld), _mm_unpackhi_epi64(r0, r1));
+}
+
+//Tiles are split in square blocks transposed in registers, while the edges are copied by the scalar kernel
+#define OPH_TRANSPOSE_SIMD(SIZE, EDGE) \
+static void _oph_server_transpose_tile_##SIZE(size_t rows, size_t cols, const char *src, size_t src_ld, char *dst, size_t dst_ld, size_t sizeof_var) \
+{ \
+	size_t i, j, r = rows - rows % (EDGE), c = cols - cols % (EDGE); \
+	for (j = 0; j < c; j += (EDGE)) \
+		for (i = 0; i < r; i += (EDGE)) \
+			_oph_server_transpose_block_##SIZE(src + (i * src_ld + j) * (SIZE), src_ld * (SIZE), dst + (j * dst_ld + i) * (SIZE), dst_ld * (SIZE)); \
+	if (c < cols) \
+		_oph_server_transpose_scalar_##SIZE(r, cols - c, src + c * (SIZE), src_ld, dst + c * dst_ld * (SIZE), dst_ld, sizeof_var); \
+	if (r < rows) \
+		_oph_server_transpose_scalar_##SIZE(rows - r, cols, src + r * src_ld * (SIZE), src_ld, dst + r * (SIZE), dst_ld, sizeof_var); \
+}
+
+OPH_TRANSPOSE_SIMD(2, 8)
+OPH_TRANSPOSE_SIMD(4, 4)
+OPH_TRANSPOSE_SIMD(8, 2)
+#else
+#define _oph_server_transpose_tile_2 _oph_server_transpose_scalar_2
+#define _oph_server_transpose_tile_4 _oph_server_transpose_scalar_4
+#define _oph_server_transpose_tile_8 _oph_server_transpose_scalar_8
+#endif
+
+//Copy the values of a leaf: the kernel is applied to each position of the other dimensions
+static void _oph_server_transpose_leaf(oph_transpose_plan * plan, size_t * len, const char *src, char *dst)
+{
+	int i, n = plan->ndims;
+	size_t idx[n];
+	size_t size = plan->sizeof_var;
+
+	for (i = 0; i < n; i++)
+		idx[i] = 0;
+
+	for (;;) {
+		switch (plan->kernel) {
+			case OPH_TRANSPOSE_KERNEL_RUN:
+				memcpy(dst, src, len[plan->src_dim] * size);
+				break;
+			case OPH_TRANSPOSE_KERNEL_TILE:
+				plan->tile(len[plan->dst_dim], len[plan->src_dim], src, plan->src_stride[plan->dst_dim], dst, plan->dst_stride[plan->src_dim], size);
+				break;
+			default:
+				plan->strided(len[plan->src_dim], src, plan->src_stride[plan->src_dim], dst, plan->dst_stride[plan->src_dim], size);
+		}
+
+		//Move to the next position starting from the most internal dimension
+		for (i = n - 1; i >= 0; i--) {
+			if ((i == plan->src_dim) || ((plan->kernel == OPH_TRANSPOSE_KERNEL_TILE) && (i == plan->dst_dim)))
+				continue;
+			if (++idx[i] < len[i]) {
+				src += plan->src_stride[i] * size;
+				dst += plan->dst_stride[i] * size;
+				break;
+			}
+			src -= (len[i] - 1) * plan->src_stride[i] * size;
+			dst -= (len[i] - 1) * plan->dst_stride[i] * size;
+			idx[i] = 0;
+		}
+		if (i < 0)
+			break;
+	}
+}
+
+//Cache-oblivious recursion: the longest dimension is halved until the values of a box fit in a leaf
+static void _oph_server_transpose_rec(oph_transpose_plan * plan, size_t * len, const char *src, char *dst)
+{
+	int i, k = -1;
+	size_t volume = plan->sizeof_var;
+
+	for (i = 0; i < plan->ndims; i++) {
+		volume *= len[i];
+		//Runs are not split
+		if ((plan->kernel == OPH_TRANSPOSE_KERNEL_RUN) && (i == plan->src_dim))
+			continue;
+		if ((len[i] > 1) && ((k < 0) || (len[i] > len[k])))
+			k = i;
+	}
+	if ((k < 0) || (volume <= oph_transpose_leaf_size)) {
+		_oph_server_transpose_leaf(plan, len, src, dst);
+		return;
+	}
+
+	size_t whole = len[k], half = whole / 2;
+	//Contiguous dimensions are split at cache line boundaries
+	size_t line = oph_transpose_line_size / plan->sizeof_var;
+	if ((line > 1) && (half > line) && ((plan->src_stride[k] == 1) || (plan->dst_stride[k] == 1)))
+		half -= half % line;
+
+	len[k] = half;
+	_oph_server_transpose_rec(plan, len, src, dst);
+	len[k] = whole - half;
+	_oph_server_transpose_rec(plan, len, src + half * plan->src_stride[k] * plan->sizeof_var, dst + half * plan->dst_stride[k] * plan->sizeof_var);
+	len[k] = whole;
+}
+
+int oph_server_transpose_init(unsigned long long cache_size, unsigned short line_size)
+{
+	oph_transpose_leaf_size = (cache_size ? cache_size / 2 : OPH_SERVER_TRANSPOSE_LEAF_SIZE);
+	oph_transpose_line_size = (line_size ? line_size : OPH_SERVER_TRANSPOSE_LINE_SIZE);
+
+	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Transpose leaf size: %zu bytes, cache line size: %zu bytes\n", oph_transpose_leaf_size, oph_transpose_line_size);
+
+	return OPH_SERVER_TRANSPOSE_SUCCESS;
+}
+
+int oph_server_transpose_tune()
+{
+	unsigned int side = OPH_SERVER_TRANSPOSE_TUNE_SIDE;
+	size_t size = (size_t) side * side * 4;
+	char *src = (char *) malloc(size);
+	char *dst = (char *) malloc(size);
+	if (!src || !dst) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Out of memory\n");
+		free(src);
+		free(dst);
+		return OPH_SERVER_TRANSPOSE_MEMORY_ERROR;
+	}
+	memset(src, 0, size);
+
+	unsigned int limits[2] = { side, side }, src_products[2] = { 1, side };
+	size_t leaf, best_leaf = oph_transpose_leaf_size;
+	double best_time = -1;
+	struct timespec start, end;
+	int run;
+
+	for (leaf = OPH_SERVER_TRANSPOSE_TUNE_MIN_LEAF; leaf <= OPH_SERVER_TRANSPOSE_TUNE_MAX_LEAF; leaf *= 2) {
+		oph_transpose_leaf_size = leaf;
+		for (run = 0; run < OPH_SERVER_TRANSPOSE_TUNE_RUNS; run++) {
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			oph_server_transpose(2, limits, src_products, src, NULL, dst, 4);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+			if ((best_time < 0) || (elapsed < best_time)) {
+				best_time = elapsed;
+				best_leaf = leaf;
+			}
+		}
+	}
+	oph_transpose_leaf_size = best_leaf;
+
+	free(src);
+	free(dst);
+
+	pmesg(LOG_INFO, __FILE__, __LINE__, "Transpose leaf size tuned to %zu bytes (%f sec for %u x %u values)\n", best_leaf, best_time, side, side);
+
+	return OPH_SERVER_TRANSPOSE_SUCCESS;
+}
+
+int oph_server_transpose(int ndims, const unsigned int *limits, const unsigned int *src_products, const char *src, const unsigned int *dst_products, char *dst, size_t sizeof_var)
+{
+	if ((ndims < 0) || (ndims && (!limits || !src_products)) || !src || !dst || !sizeof_var)
+		return OPH_SERVER_TRANSPOSE_NULL_PARAM;
+
+	int i, j, n = 0;
+	size_t len[ndims + 1], src_stride[ndims + 1], dst_stride[ndims + 1], dense = 1;
+
+	//Unit dimensions are skipped
+	for (i = ndims - 1; i >= 0; i--) {
+		if (!limits[i])
+			return OPH_SERVER_TRANSPOSE_SUCCESS;
+		if (limits[i] > 1) {
+			len[n] = limits[i];
+			src_stride[n] = src_products[i];
+			dst_stride[n] = dst_products ? dst_products[i] : dense;
+			n++;
+		}
+		dense *= limits[i];
+	}
+	//Dimensions were collected from the innermost: restore their order
+	for (i = 0; i < n / 2; i++) {
+		size_t tmp;
+		tmp = len[i], len[i] = len[n - 1 - i], len[n - 1 - i] = tmp;
+		tmp = src_stride[i], src_stride[i] = src_stride[n - 1 - i], src_stride[n - 1 - i] = tmp;
+		tmp = dst_stride[i], dst_stride[i] = dst_stride[n - 1 - i], dst_stride[n - 1 - i] = tmp;
+	}
+
+	//Dimensions which are contiguous both in source and destination are merged
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < n; j++) {
+			if ((i != j) && (src_stride[i] == src_stride[j] * len[j]) && (dst_stride[i] == dst_stride[j] * len[j])) {
+				len[j] *= len[i];
+				memmove(len + i, len + i + 1, (n - i - 1) * sizeof(size_t));
+				memmove(src_stride + i, src_stride + i + 1, (n - i - 1) * sizeof(size_t));
+				memmove(dst_stride + i, dst_stride + i + 1, (n - i - 1) * sizeof(size_t));
+				n--;
+				i = -1;
+				break;
+			}
+		}
+	}
+
+	if (!n) {
+		memcpy(dst, src, sizeof_var);
+		return OPH_SERVER_TRANSPOSE_SUCCESS;
+	}
+
+	oph_transpose_plan plan;
+	plan.ndims = n;
+	plan.src_stride = src_stride;
+	plan.dst_stride = dst_stride;
+	plan.sizeof_var = sizeof_var;
+	plan.src_dim = plan.dst_dim = -1;
+	for (i = 0; i < n; i++) {
+		if ((plan.src_dim < 0) && (src_stride[i] == 1))
+			plan.src_dim = i;
+		if ((plan.dst_dim < 0) && (dst_stride[i] == 1))
+			plan.dst_dim = i;
+	}
+
+	if ((plan.src_dim >= 0) && (plan.src_dim == plan.dst_dim))
+		plan.kernel = OPH_TRANSPOSE_KERNEL_RUN;
+	else if ((plan.src_dim >= 0) && (plan.dst_dim >= 0))
+		plan.kernel = OPH_TRANSPOSE_KERNEL_TILE;
+	else {
+		//Values are copied along the dimension with the smallest stride in destination
+		plan.kernel = OPH_TRANSPOSE_KERNEL_STRIDED;
+		plan.src_dim = 0;
+		for (i = 1; i < n; i++)
+			if (dst_stride[i] < dst_stride[plan.src_dim])
+				plan.src_dim = i;
+	}
+
+	switch (sizeof_var) {
+		case 1:
+			plan.tile = _oph_server_transpose_scalar_1;
+			plan.strided = _oph_server_transpose_strided_1;
+			break;
+		case 2:
+			plan.tile = _oph_server_transpose_tile_2;
+			plan.strided = _oph_server_transpose_strided_2;
+			break;
+		case 4:
+			plan.tile = _oph_server_transpose_tile_4;
+			plan.strided = _oph_server_transpose_strided_4;
+			break;
+		case 8:
+			plan.tile = _oph_server_transpose_tile_8;
+			plan.strided = _oph_server_transpose_strided_8;
+			break;
+		default:
+			plan.tile = _oph_server_transpose_scalar_n;
+			plan.strided = _oph_server_transpose_strided_n;
+	}
+
+	_oph_server_transpose_rec(&plan, len, src, dst);
+
+	return OPH_SERVER_TRANSPOSE_SUCCESS;
+}
@@ -0,0 +1,66 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPH_SERVER_TRANSPOSE_H
+#define OPH_SERVER_TRANSPOSE_H
+
+#include <stddef.h>
+
+#define OPH_SERVER_TRANSPOSE_SUCCESS		0
+#define OPH_SERVER_TRANSPOSE_NULL_PARAM		1
+#define OPH_SERVER_TRANSPOSE_MEMORY_ERROR	2
+
+//Default number of bytes copied by a leaf of the recursion and default size of a cache line
+#define OPH_SERVER_TRANSPOSE_LEAF_SIZE		32768
+#define OPH_SERVER_TRANSPOSE_LINE_SIZE		64
+
+//Autotuner: side of the square matrix of 4-byte values transposed with each leaf size, number of runs per leaf size and range of leaf sizes
+#define OPH_SERVER_TRANSPOSE_TUNE_SIDE		1024
+#define OPH_SERVER_TRANSPOSE_TUNE_RUNS		3
+#define OPH_SERVER_TRANSPOSE_TUNE_MIN_LEAF	4096
+#define OPH_SERVER_TRANSPOSE_TUNE_MAX_LEAF	1048576
+
+/**
+ * \brief			            Function used to setup the transpose kernels. It has to be called before any thread uses them
+ * \param cache_size      Size in bytes of the data cache (half of it is used for a leaf of the recursion; 0 for the default)
+ * \param line_size       Size in bytes of a cache line (0 for the default)
+ * \return                0 if successfull, non-0 otherwise
+ */
+int oph_server_transpose_init(unsigned long long cache_size, unsigned short line_size);
+
+/**
+ * \brief			            Function used to measure the leaf size of the recursion which transposes a test matrix in the shortest time. It has to be called before any thread uses the kernels
+ * \return                0 if successfull, non-0 otherwise
+ */
+int oph_server_transpose_tune();
+
+/**
+ * \brief			            Function used to copy a multidimensional array changing the order of its values. Element (i_0, ..., i_n-1) is copied from
+ *                        position sum(i_k * src_products[k]) of the source to position sum(i_k * dst_products[k]) of the destination
+ * \param ndims           Number of dimensions
+ * \param limits          Array of ndims sizes of the dimensions
+ * \param src_products    Array of ndims strides (in values) of the dimensions in the source
+ * \param src             Source array
+ * \param dst_products    Array of ndims strides (in values) of the dimensions in the destination; if NULL the destination is filled in the order of limits
+ * \param dst             Destination array, which cannot overlap the source
+ * \param sizeof_var      Size in bytes of a value
+ * \return                0 if successfull, non-0 otherwise
+ */
+int oph_server_transpose(int ndims, const unsigned int *limits, const unsigned int *src_products, const char *src, const unsigned int *dst_products, char *dst, size_t sizeof_var);
+
+#endif				/* OPH_SERVER_TRANSPOSE_H */
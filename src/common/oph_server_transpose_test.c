@@ -0,0 +1,152 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "oph_server_transpose.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OPH_SERVER_TRANSPOSE_TEST_RUNS		2000
+#define OPH_SERVER_TRANSPOSE_TEST_MAX_DIMS	5
+
+static unsigned long long _oph_server_transpose_test_seed = 1;
+
+static unsigned int _oph_server_transpose_test_rand(unsigned int max)
+{
+	_oph_server_transpose_test_seed = _oph_server_transpose_test_seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return (unsigned int) ((_oph_server_transpose_test_seed >> 33) % max);
+}
+
+static void _oph_server_transpose_test_shuffle(int ndims, unsigned int *order)
+{
+	int i, j;
+	unsigned int tmp;
+	for (i = 0; i < ndims; i++)
+		order[i] = i;
+	for (i = ndims - 1; i > 0; i--) {
+		j = _oph_server_transpose_test_rand(i + 1);
+		tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+}
+
+//Reference: copy values one by one, visiting the elements in the order of limits
+static void _oph_server_transpose_test_naive(int ndims, const unsigned int *limits, const unsigned int *src_products, const char *src, const unsigned int *dst_products, char *dst,
+					     size_t sizeof_var)
+{
+	unsigned int index[OPH_SERVER_TRANSPOSE_TEST_MAX_DIMS] = { 0 }, dense[OPH_SERVER_TRANSPOSE_TEST_MAX_DIMS];
+	unsigned long long total = 1, k, src_offset, dst_offset;
+	int i;
+
+	for (i = ndims - 1; i >= 0; i--) {
+		dense[i] = (unsigned int) total;
+		total *= limits[i];
+	}
+	for (k = 0; k < total; k++) {
+		src_offset = dst_offset = 0;
+		for (i = 0; i < ndims; i++) {
+			src_offset += (unsigned long long) index[i] * src_products[i];
+			dst_offset += (unsigned long long) index[i] * (dst_products ? dst_products[i] : dense[i]);
+		}
+		memcpy(dst + dst_offset * sizeof_var, src + src_offset * sizeof_var, sizeof_var);
+		for (i = ndims - 1; i >= 0; i--) {
+			if (++index[i] < limits[i])
+				break;
+			index[i] = 0;
+		}
+	}
+}
+
+int main()
+{
+	size_t sizes[] = { 1, 2, 3, 4, 8, 16 };
+	unsigned int limits[OPH_SERVER_TRANSPOSE_TEST_MAX_DIMS], src_products[OPH_SERVER_TRANSPOSE_TEST_MAX_DIMS], dst_products[OPH_SERVER_TRANSPOSE_TEST_MAX_DIMS];
+	unsigned int src_order[OPH_SERVER_TRANSPOSE_TEST_MAX_DIMS], dst_order[OPH_SERVER_TRANSPOSE_TEST_MAX_DIMS], padding[OPH_SERVER_TRANSPOSE_TEST_MAX_DIMS];
+	unsigned long long src_size, dst_size, k;
+	int run, ndims, i, use_dst, res = 0;
+	size_t sizeof_var;
+	char *src = NULL, *expected = NULL, *actual = NULL;
+
+	for (run = 0; run < OPH_SERVER_TRANSPOSE_TEST_RUNS; run++) {
+		//Small leaves are used to exercise the recursion on small arrays
+		if (oph_server_transpose_init(run % 3 ? 1024 : 0, run % 5 ? 64 : 0)) {
+			fprintf(stderr, "Unable to setup transpose kernels\n");
+			return 1;
+		}
+
+		ndims = 1 + _oph_server_transpose_test_rand(OPH_SERVER_TRANSPOSE_TEST_MAX_DIMS);
+		for (i = 0; i < ndims; i++) {
+			limits[i] = 1 + _oph_server_transpose_test_rand(ndims <= 2 ? 70 : 13);
+			if (!_oph_server_transpose_test_rand(7))
+				limits[i] = 1;
+			padding[i] = _oph_server_transpose_test_rand(3) ? 0 : _oph_server_transpose_test_rand(3);
+		}
+
+		//Source dimensions are stored in random order, with optional padding
+		_oph_server_transpose_test_shuffle(ndims, src_order);
+		src_size = 1;
+		for (i = ndims - 1; i >= 0; i--) {
+			src_products[src_order[i]] = (unsigned int) src_size;
+			src_size *= limits[src_order[i]] + padding[src_order[i]];
+		}
+		use_dst = _oph_server_transpose_test_rand(2);
+		for (i = 0; i < ndims; i++)
+			dst_order[i] = i;
+		if (use_dst)
+			_oph_server_transpose_test_shuffle(ndims, dst_order);
+		dst_size = 1;
+		for (i = ndims - 1; i >= 0; i--) {
+			dst_products[dst_order[i]] = (unsigned int) dst_size;
+			dst_size *= limits[dst_order[i]];
+		}
+		sizeof_var = sizes[_oph_server_transpose_test_rand(sizeof(sizes) / sizeof(size_t))];
+
+		src = (char *) malloc(src_size * sizeof_var);
+		expected = (char *) malloc(dst_size * sizeof_var);
+		actual = (char *) malloc(dst_size * sizeof_var);
+		if (!src || !expected || !actual) {
+			fprintf(stderr, "Unable to allocate arrays\n");
+			res = 1;
+		} else {
+			for (k = 0; k < src_size * sizeof_var; k++)
+				src[k] = (char) _oph_server_transpose_test_rand(256);
+			memset(expected, 0, dst_size * sizeof_var);
+			memset(actual, 0, dst_size * sizeof_var);
+
+			_oph_server_transpose_test_naive(ndims, limits, src_products, src, use_dst ? dst_products : NULL, expected, sizeof_var);
+			if (oph_server_transpose(ndims, limits, src_products, src, use_dst ? dst_products : NULL, actual, sizeof_var)
+			    || memcmp(expected, actual, dst_size * sizeof_var)) {
+				fprintf(stderr, "Wrong transpose of %d dimensions with %zu-byte values (run %d)\n", ndims, sizeof_var, run);
+				res = 1;
+			}
+		}
+
+		if (src)
+			free(src);
+		if (expected)
+			free(expected);
+		if (actual)
+			free(actual);
+		if (res)
+			break;
+	}
+
+	return res;
+}
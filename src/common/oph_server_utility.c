@@ -19,13 +19,12 @@
 #define _GNU_SOURCE
 
 #include "oph_server_utility.h"
+#include "oph_server_memory.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
-#include <pthread.h>
-#include <sys/sysinfo.h>
 #include <math.h>
 
 #include "oph-lib-binary-io.h"
@@ -36,8 +35,6 @@
 extern int msglevel;
 extern unsigned short disable_mem_check;
 
-pthread_rwlock_t syslock = PTHREAD_RWLOCK_INITIALIZER;
-
 char oph_util_get_measure_type(char *measure_type)
 {
 	if (!measure_type)
@@ -406,26 +403,10 @@ int is_numeric_string(int array_length, char *array, int *is_string)
 
 int memory_check()		// Check for memory swap
 {
-	if (!disable_mem_check) {
-		struct sysinfo info;
-
-		if (pthread_rwlock_wrlock(&syslock))
-			return OPH_SERVER_UTIL_ERROR;
-
-		if (sysinfo(&info)) {
-			pthread_rwlock_unlock(&syslock);
-			return OPH_SERVER_UTIL_ERROR;
-		}
-
-		if (pthread_rwlock_unlock(&syslock))
-			return OPH_SERVER_UTIL_ERROR;
-
-		unsigned long long min_free_mem = (unsigned long long) (OPH_MIN_MEMORY_PERC * (info.totalram < OPH_MIN_MEMORY ? OPH_MIN_MEMORY : info.totalram));
-
-		if ((info.freeram + info.bufferram < min_free_mem)) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Out of memory\n");
-			return OPH_SERVER_UTIL_ERROR;
-		}
+	//Use the last sample of the memory accountant, if available
+	if (!disable_mem_check && oph_server_memory_check_system()) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Out of memory\n");
+		return OPH_SERVER_UTIL_ERROR;
 	}
 	return OPH_SERVER_UTIL_SUCCESS;
 }
@@ -99,7 +99,7 @@ int trim(char *string);
 int is_numeric_string(int array_length, char *array, int *is_string);
 
 /**
- * \brief			        This function checks if available memory is enough to process data.
+ * \brief			        This function checks if available memory is enough to process data. It does not issue system calls when background sampling of memory is enabled
  * \return            0 if successfull, non-0 otherwise
  */
 int memory_check();
@@ -32,10 +32,325 @@
 #include <errno.h>
 
 #include "oph_server_utility.h"
+#include "oph_server_memory.h"
 
 extern int msglevel;
 
 
+//Alignment of cells stored in slab arena
+#define OPH_IOSTORE_SLAB_ALIGNMENT	8
+
+static char _oph_iostore_slab_owns_cell(oph_iostore_frag_slab * slab, const void *cell)
+{
+	if (!slab || !cell)
+		return 0;
+
+	const char *ptr = (const char *) cell;
+	if (slab->id_column && ptr >= (const char *) slab->id_column && ptr < (const char *) (slab->id_column + slab->row_num))
+		return 1;
+	if (slab->arena && ptr >= slab->arena && ptr < slab->arena + slab->arena_size)
+		return 1;
+
+	return 0;
+}
+
+static char _oph_iostore_slab_owns_record(oph_iostore_frag_slab * slab, const oph_iostore_frag_record * record)
+{
+	if (!slab || !record || !slab->records)
+		return 0;
+
+	return (record >= slab->records && record < slab->records + slab->row_num);
+}
+
+static void _oph_iostore_destroy_slab(oph_iostore_frag_slab ** slab)
+{
+	if (!slab || !*slab)
+		return;
+
+	if ((*slab)->id_column)
+		free((*slab)->id_column);
+	if ((*slab)->arena)
+		free((*slab)->arena);
+	if ((*slab)->cell_offset)
+		free((*slab)->cell_offset);
+	if ((*slab)->records)
+		free((*slab)->records);
+	if ((*slab)->field_length)
+		free((*slab)->field_length);
+	if ((*slab)->field)
+		free((*slab)->field);
+	oph_server_memory_release((*slab)->reserved);
+	free(*slab);
+	*slab = NULL;
+}
+
+static int _oph_iostore_slab_resize_arena(oph_iostore_frag_slab * slab, unsigned long long new_size)
+{
+	if (new_size == slab->arena_size)
+		return OPH_IOSTORAGE_SUCCESS;
+
+	if ((new_size > slab->arena_size) && oph_server_memory_reserve(new_size - slab->arena_size)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	}
+
+	char *tmp = NULL;
+	if (!new_size)
+		free(slab->arena);
+	else if (!(tmp = (char *) realloc(slab->arena, new_size))) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		if (new_size > slab->arena_size)
+			oph_server_memory_release(new_size - slab->arena_size);
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	}
+	if (new_size > slab->arena_size)
+		slab->reserved += new_size - slab->arena_size;
+	else {
+		oph_server_memory_release(slab->arena_size - new_size);
+		slab->reserved -= slab->arena_size - new_size;
+	}
+	//Cells are addressed by offset, so accessors are rebased when arena moves
+	if (tmp && (tmp != slab->arena)) {
+		long long i, cell_num = slab->row_num * slab->field_num;
+		for (i = 0; i < cell_num; i++) {
+			if (slab->cell_offset[i] != OPH_IOSTORE_SLAB_NO_OFFSET)
+				slab->field[i] = tmp + slab->cell_offset[i];
+		}
+	}
+	slab->arena = tmp;
+	slab->arena_size = new_size;
+
+	return OPH_IOSTORAGE_SUCCESS;
+}
+
+static int _oph_iostore_slab_extend_arena(oph_iostore_frag_slab * slab, unsigned long long needed_size)
+{
+	unsigned long long new_size = (slab->arena_size ? slab->arena_size : needed_size);
+	while (new_size < needed_size)
+		new_size *= 2;
+
+	return _oph_iostore_slab_resize_arena(slab, new_size);
+}
+
+//Give back the arena following the last cell in use (e.g. after rows have been removed or the initial size was overestimated)
+static void _oph_iostore_slab_shrink_arena(oph_iostore_frag_slab * slab)
+{
+	if (!slab || !slab->arena)
+		return;
+
+	unsigned long long used = 0, end = 0;
+	long long i, cell_num = slab->row_num * slab->field_num;
+	for (i = 0; i < cell_num; i++) {
+		if ((slab->cell_offset[i] != OPH_IOSTORE_SLAB_NO_OFFSET) && ((end = slab->cell_offset[i] + slab->field_length[i]) > used))
+			used = end;
+	}
+	slab->arena_used = used;
+	//On failure the arena is left as it is
+	_oph_iostore_slab_resize_arena(slab, used);
+}
+
+static inline char _oph_iostore_get_field_storage(oph_iostore_frag_record_set * record_set, unsigned short field)
+{
+	return record_set->field_storage ? record_set->field_storage[field] : OPH_IOSTORE_FIELD_OWN;
+}
+
+//Memory allocated outside the slab is reserved by the record set and given back when it is destroyed
+static int _oph_iostore_reserve(oph_iostore_frag_record_set * record_set, unsigned long long size)
+{
+	if (oph_server_memory_reserve(size)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	}
+	record_set->reserved += size;
+	return OPH_IOSTORAGE_SUCCESS;
+}
+
+static void _oph_iostore_release(oph_iostore_frag_record_set * record_set, unsigned long long size)
+{
+	oph_server_memory_release(size);
+	record_set->reserved -= size;
+}
+
+static void _oph_iostore_release_frag_record(oph_iostore_frag_record_set * record_set, oph_iostore_frag_record ** record)
+{
+	oph_iostore_frag_slab *slab = record_set->slab;
+	char in_slab = _oph_iostore_slab_owns_record(slab, *record);
+
+	if (!in_slab && !record_set->field_storage) {
+		oph_iostore_destroy_frag_record(record, record_set->field_num);
+		return;
+	}
+	//Only own cells allocated outside the slab have to be freed
+	long long j = 0, base = (in_slab ? (*record - slab->records) * slab->field_num : 0);
+	for (j = 0; j < record_set->field_num; j++) {
+		if ((*record)->field[j] && (_oph_iostore_get_field_storage(record_set, j) == OPH_IOSTORE_FIELD_OWN) && !_oph_iostore_slab_owns_cell(slab, (*record)->field[j]))
+			free((*record)->field[j]);
+		(*record)->field[j] = NULL;
+		(*record)->field_length[j] = 0;
+		if (in_slab)
+			slab->cell_offset[base + j] = OPH_IOSTORE_SLAB_NO_OFFSET;
+	}
+	if (!in_slab) {
+		free((*record)->field);
+		free((*record)->field_length);
+		free(*record);
+	}
+	*record = NULL;
+}
+
+static void _oph_iostore_release_field_storage(oph_iostore_frag_record_set * record_set)
+{
+	unsigned short j = 0;
+	if (record_set->field_buffer) {
+		for (j = 0; j < record_set->field_num; j++)
+			if (record_set->field_buffer[j])
+				free(record_set->field_buffer[j]);
+		free(record_set->field_buffer);
+		record_set->field_buffer = NULL;
+	}
+	if (record_set->field_storage) {
+		free(record_set->field_storage);
+		record_set->field_storage = NULL;
+	}
+	if (record_set->source)
+		oph_iostore_destroy_frag_recordset(&(record_set->source));
+}
+
+static int _oph_iostore_alloc_field_storage(oph_iostore_frag_record_set * record_set, char shared)
+{
+	if (!record_set->field_storage && !(record_set->field_storage = (char *) calloc(record_set->field_num, sizeof(char)))) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	}
+	if (shared && !record_set->field_buffer && !(record_set->field_buffer = (void **) calloc(record_set->field_num, sizeof(void *)))) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	}
+	return OPH_IOSTORAGE_SUCCESS;
+}
+
+//Mark a column as own, releasing its shared buffer and the source when no other column references it
+static void _oph_iostore_set_field_own(oph_iostore_frag_record_set * record_set, unsigned short field)
+{
+	if (_oph_iostore_get_field_storage(record_set, field) == OPH_IOSTORE_FIELD_OWN)
+		return;
+
+	if (record_set->field_buffer && record_set->field_buffer[field]) {
+		free(record_set->field_buffer[field]);
+		record_set->field_buffer[field] = NULL;
+	}
+	record_set->field_storage[field] = OPH_IOSTORE_FIELD_OWN;
+
+	unsigned short j = 0;
+	for (j = 0; j < record_set->field_num; j++)
+		if (record_set->field_storage[j] == OPH_IOSTORE_FIELD_BORROWED)
+			return;
+	if (record_set->source)
+		oph_iostore_destroy_frag_recordset(&(record_set->source));
+}
+
+//Replace the borrowed or shared cells of a column with own copies, so that it can be modified
+static int _oph_iostore_copy_shared_column(oph_iostore_frag_record_set * record_set, unsigned short field)
+{
+	long long j = 0, row_num = 0;
+	unsigned long long size = 0;
+	for (row_num = 0; record_set->record_set[row_num]; row_num++)
+		if (record_set->record_set[row_num]->field[field])
+			size += record_set->record_set[row_num]->field_length[field];
+	if (_oph_iostore_reserve(record_set, size))
+		return OPH_IOSTORAGE_MEMORY_ERR;
+
+	//Copy all cells before replacing them, so that the column is unchanged on failure
+	void **cells = (void **) calloc(row_num + 1, sizeof(void *));
+	if (!cells) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		_oph_iostore_release(record_set, size);
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	}
+	for (j = 0; j < row_num; j++) {
+		oph_iostore_frag_record *record = record_set->record_set[j];
+		if (record->field[field] && record->field_length[field] && !(cells[j] = memdup(record->field[field], record->field_length[field]))) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+			while (j-- > 0)
+				if (cells[j])
+					free(cells[j]);
+			free(cells);
+			_oph_iostore_release(record_set, size);
+			return OPH_IOSTORAGE_MEMORY_ERR;
+		}
+	}
+	for (j = 0; j < row_num; j++) {
+		record_set->record_set[j]->field[field] = cells[j];
+		if (!cells[j])
+			record_set->record_set[j]->field_length[field] = 0;
+	}
+	free(cells);
+	_oph_iostore_set_field_own(record_set, field);
+
+	return OPH_IOSTORAGE_SUCCESS;
+}
+
+//Release the cells of a column in the whole record set
+static void _oph_iostore_release_frag_column(oph_iostore_frag_record_set * record_set, unsigned short field)
+{
+	oph_iostore_frag_slab *slab = record_set->slab;
+	char own = (_oph_iostore_get_field_storage(record_set, field) == OPH_IOSTORE_FIELD_OWN);
+	oph_iostore_frag_record *record = NULL;
+	long long j = 0;
+
+	for (j = 0; (record = record_set->record_set[j]); j++) {
+		if (record->field[field] && own && !_oph_iostore_slab_owns_cell(slab, record->field[field]))
+			free(record->field[field]);
+		record->field[field] = NULL;
+		record->field_length[field] = 0;
+		if (_oph_iostore_slab_owns_record(slab, record))
+			slab->cell_offset[(record - slab->records) * slab->field_num + field] = OPH_IOSTORE_SLAB_NO_OFFSET;
+	}
+	_oph_iostore_set_field_own(record_set, field);
+}
+
+//Point the first row_num cells of a column to a buffer of the record set, with cell j at buffer + j * stride
+static int _oph_iostore_set_shared_column(oph_iostore_frag_record_set * record_set, unsigned short field, long long row_num, char *buffer, unsigned long long length,
+					  unsigned long long stride)
+{
+	long long j = 0;
+	for (j = 0; j < row_num; j++) {
+		if (!record_set->record_set[j]) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+			if (buffer)
+				free(buffer);
+			return OPH_IOSTORAGE_NULL_PARAM;
+		}
+	}
+	if (_oph_iostore_alloc_field_storage(record_set, 1)) {
+		if (buffer)
+			free(buffer);
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	}
+
+	_oph_iostore_release_frag_column(record_set, field);
+	record_set->zone_map.valid = 0;
+	if (!buffer)
+		return OPH_IOSTORAGE_SUCCESS;
+
+	record_set->field_buffer[field] = buffer;
+	record_set->field_storage[field] = OPH_IOSTORE_FIELD_SHARED;
+	for (j = 0; j < row_num; j++) {
+		record_set->record_set[j]->field[field] = buffer + j * stride;
+		record_set->record_set[j]->field_length[field] = length;
+	}
+
+	return OPH_IOSTORAGE_SUCCESS;
+}
+
 int oph_iostore_compare_id(oph_iostore_resource_id id1, oph_iostore_resource_id id2)
 {
 	if (!id1.id && !id2.id) {
@@ -170,6 +485,14 @@ int oph_iostore_copy_frag_record_set_only(oph_iostore_frag_record_set * input_re
 	(*output_record_set)->field_num = input_record_set->field_num;
 	(*output_record_set)->field_type = NULL;
 	(*output_record_set)->record_set = NULL;
+	(*output_record_set)->tmp_flag = 0;
+	(*output_record_set)->slab = NULL;
+	memset(&((*output_record_set)->zone_map), 0, sizeof(oph_iostore_frag_zone_map));
+	(*output_record_set)->field_storage = NULL;
+	(*output_record_set)->field_buffer = NULL;
+	(*output_record_set)->source = NULL;
+	(*output_record_set)->ref_count = 1;
+	(*output_record_set)->reserved = 0;
 	(*output_record_set)->field_name = (char **) calloc(input_record_set->field_num, sizeof(char *));
 	if (!(*output_record_set)->field_name) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
@@ -288,15 +611,23 @@ int oph_iostore_destroy_frag_recordset(oph_iostore_frag_record_set ** record_set
 		return OPH_IOSTORAGE_NULL_PARAM;
 	}
 
+	//Cells are still referenced by other record sets: memory is released with the last reference
+	if (__atomic_sub_fetch(&((*record_set)->ref_count), 1, __ATOMIC_ACQ_REL) > 0) {
+		*record_set = NULL;
+		return OPH_IOSTORAGE_SUCCESS;
+	}
+
 	long long i = 0;
 
 	if ((*record_set)->record_set != NULL) {
 		while ((*record_set)->record_set[i]) {
-			oph_iostore_destroy_frag_record(&(*record_set)->record_set[i], (*record_set)->field_num);
+			_oph_iostore_release_frag_record(*record_set, &(*record_set)->record_set[i]);
 			i++;
 		}
 	}
 
+	_oph_iostore_destroy_slab(&(*record_set)->slab);
+
 	oph_iostore_destroy_frag_recordset_only(record_set);
 
 	return OPH_IOSTORAGE_SUCCESS;
@@ -317,6 +648,8 @@ int oph_iostore_destroy_frag_recordset_only(oph_iostore_frag_record_set ** recor
 		(*record_set)->record_set = NULL;
 	}
 
+	_oph_iostore_release_field_storage(*record_set);
+
 	if ((*record_set)->frag_name)
 		free((*record_set)->frag_name);
 
@@ -331,6 +664,7 @@ int oph_iostore_destroy_frag_recordset_only(oph_iostore_frag_record_set ** recor
 	if ((*record_set)->field_type)
 		free((*record_set)->field_type);
 
+	oph_server_memory_release((*record_set)->reserved);
 	free(*record_set);
 	*record_set = NULL;
 
@@ -386,6 +720,13 @@ int oph_iostore_create_frag_recordset_only(oph_iostore_frag_record_set ** record
 	(*record_set)->field_type = NULL;
 	(*record_set)->record_set = NULL;
 	(*record_set)->tmp_flag = 0;
+	(*record_set)->slab = NULL;
+	memset(&((*record_set)->zone_map), 0, sizeof(oph_iostore_frag_zone_map));
+	(*record_set)->field_storage = NULL;
+	(*record_set)->field_buffer = NULL;
+	(*record_set)->source = NULL;
+	(*record_set)->ref_count = 1;
+	(*record_set)->reserved = 0;
 
 	(*record_set)->field_name = (char **) calloc(field_num, sizeof(char *));
 	if (!(*record_set)->field_name) {
@@ -414,6 +755,350 @@ int oph_iostore_create_frag_recordset_only(oph_iostore_frag_record_set ** record
 	return OPH_IOSTORAGE_SUCCESS;
 }
 
+int oph_iostore_create_frag_recordset_slab(oph_iostore_frag_record_set ** record_set, long long set_size, short int field_num, short int id_index, unsigned long long arena_size)
+{
+	if (!record_set || !field_num || (set_size < 0)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+		return OPH_IOSTORAGE_NULL_PARAM;
+	}
+	//Create a null-terminated record set of set_size+1 records (last one is NULL)
+	if (oph_iostore_create_frag_recordset_only(record_set, set_size, field_num)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	}
+
+	if (set_size != 0) {
+		if (oph_iostore_create_frag_slab(*record_set, set_size, id_index, arena_size)) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+			oph_iostore_destroy_frag_recordset(record_set);
+			return OPH_IOSTORAGE_MEMORY_ERR;
+		}
+	}
+	return OPH_IOSTORAGE_SUCCESS;
+}
+
+int oph_iostore_create_frag_slab(oph_iostore_frag_record_set * record_set, long long set_size, short int id_index, unsigned long long arena_size)
+{
+	if (!record_set || !record_set->field_num || (set_size <= 0) || (id_index >= record_set->field_num) || record_set->slab) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+		return OPH_IOSTORAGE_NULL_PARAM;
+	}
+
+	unsigned short field_num = record_set->field_num;
+	oph_iostore_frag_slab *slab = (oph_iostore_frag_slab *) calloc(1, sizeof(oph_iostore_frag_slab));
+	if (!slab) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	}
+	slab->field_num = field_num;
+	slab->id_index = (id_index < 0 ? -1 : id_index);
+
+	//Reserve the whole slab at once from the memory budget
+	unsigned long long slab_size = set_size * (sizeof(oph_iostore_frag_record) + field_num * (2 * sizeof(unsigned long long) + sizeof(void *))) + arena_size;
+	if (slab->id_index >= 0)
+		slab_size += set_size * sizeof(unsigned long long);
+	if (oph_server_memory_reserve(slab_size)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		free(slab);
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	}
+	slab->reserved = slab_size;
+
+	//Allocate contiguous blocks for accessors and cells
+	slab->records = (oph_iostore_frag_record *) malloc(set_size * sizeof(oph_iostore_frag_record));
+	slab->field_length = (unsigned long long *) calloc(set_size * field_num, sizeof(unsigned long long));
+	slab->field = (void **) calloc(set_size * field_num, sizeof(void *));
+	slab->cell_offset = (unsigned long long *) malloc(set_size * field_num * sizeof(unsigned long long));
+	if (slab->id_index >= 0)
+		slab->id_column = (unsigned long long *) calloc(set_size, sizeof(unsigned long long));
+	if (arena_size)
+		slab->arena = (char *) malloc(arena_size);
+	if (!record_set->record_set)
+		record_set->record_set = (oph_iostore_frag_record **) calloc(set_size + 1, sizeof(oph_iostore_frag_record *));
+	if (!slab->records || !slab->field_length || !slab->field || !slab->cell_offset || ((slab->id_index >= 0) && !slab->id_column) || (arena_size && !slab->arena)
+	    || !record_set->record_set) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		_oph_iostore_destroy_slab(&slab);
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	}
+	slab->arena_size = arena_size;
+	slab->arena_used = 0;
+	memset(slab->cell_offset, 0xFF, set_size * field_num * sizeof(unsigned long long));
+	slab->row_num = set_size;
+
+	//Records are accessors to slab memory
+	long long i = 0;
+	for (i = 0; i < set_size; i++) {
+		slab->records[i].field_length = slab->field_length + i * field_num;
+		slab->records[i].field = slab->field + i * field_num;
+		record_set->record_set[i] = &(slab->records[i]);
+	}
+	record_set->record_set[set_size] = NULL;
+	record_set->slab = slab;
+
+	return OPH_IOSTORAGE_SUCCESS;
+}
+
+int oph_iostore_set_frag_cell(oph_iostore_frag_record_set * record_set, long long row, unsigned short field, const void *value, unsigned long long length)
+{
+	if (!record_set || !record_set->record_set || (row < 0) || (field >= record_set->field_num) || (!value && length) || !record_set->record_set[row]) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+		return OPH_IOSTORAGE_NULL_PARAM;
+	}
+
+	//Borrowed and shared cells are referenced by other cells, so the column is copied before being modified
+	if ((_oph_iostore_get_field_storage(record_set, field) != OPH_IOSTORE_FIELD_OWN) && _oph_iostore_copy_shared_column(record_set, field))
+		return OPH_IOSTORAGE_MEMORY_ERR;
+
+	oph_iostore_frag_record *record = record_set->record_set[row];
+	oph_iostore_frag_slab *slab = record_set->slab;
+	record_set->zone_map.valid = 0;
+	char in_slab = _oph_iostore_slab_owns_record(slab, record);
+	long long cell = (in_slab ? (record - slab->records) * slab->field_num + field : 0);
+
+	//Release previous value
+	if (record->field[field] && !_oph_iostore_slab_owns_cell(slab, record->field[field]))
+		free(record->field[field]);
+	record->field[field] = NULL;
+	record->field_length[field] = 0;
+	if (in_slab)
+		slab->cell_offset[cell] = OPH_IOSTORE_SLAB_NO_OFFSET;
+
+	if (!length)
+		return OPH_IOSTORAGE_SUCCESS;
+
+	if (!in_slab) {
+		if (_oph_iostore_reserve(record_set, length))
+			return OPH_IOSTORAGE_MEMORY_ERR;
+		record->field[field] = memdup(value, length);
+		if (!record->field[field]) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+			_oph_iostore_release(record_set, length);
+			return OPH_IOSTORAGE_MEMORY_ERR;
+		}
+		record->field_length[field] = length;
+		return OPH_IOSTORAGE_SUCCESS;
+	}
+
+	if ((field == slab->id_index) && (length == sizeof(unsigned long long))) {
+		long long index = record - slab->records;
+		if (!slab->id_column) {
+			if (oph_server_memory_reserve(slab->row_num * sizeof(unsigned long long))) {
+				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+				return OPH_IOSTORAGE_MEMORY_ERR;
+			}
+			if (!(slab->id_column = (unsigned long long *) calloc(slab->row_num, sizeof(unsigned long long)))) {
+				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+				oph_server_memory_release(slab->row_num * sizeof(unsigned long long));
+				return OPH_IOSTORAGE_MEMORY_ERR;
+			}
+			slab->reserved += slab->row_num * sizeof(unsigned long long);
+		}
+		memcpy(slab->id_column + index, value, length);
+		record->field[field] = slab->id_column + index;
+		record->field_length[field] = length;
+		return OPH_IOSTORAGE_SUCCESS;
+	}
+
+	unsigned long long offset = (slab->arena_used + OPH_IOSTORE_SLAB_ALIGNMENT - 1) & ~((unsigned long long) OPH_IOSTORE_SLAB_ALIGNMENT - 1);
+	if ((offset + length > slab->arena_size) && _oph_iostore_slab_extend_arena(slab, offset + length))
+		return OPH_IOSTORAGE_MEMORY_ERR;
+
+	memcpy(slab->arena + offset, value, length);
+	slab->cell_offset[cell] = offset;
+	slab->arena_used = offset + length;
+	record->field[field] = slab->arena + offset;
+	record->field_length[field] = length;
+
+	return OPH_IOSTORAGE_SUCCESS;
+}
+
+int oph_iostore_borrow_frag_cell(oph_iostore_frag_record_set * record_set, long long row, unsigned short field, oph_iostore_frag_record_set * source, void *value, unsigned long long length)
+{
+	if (!record_set || !record_set->record_set || (row < 0) || (field >= record_set->field_num) || !source || (source == record_set) || (!value && length)
+	    || !record_set->record_set[row]) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+		return OPH_IOSTORAGE_NULL_PARAM;
+	}
+	//Only one source can be referenced and shared columns are copied before being modified
+	char storage = _oph_iostore_get_field_storage(record_set, field);
+	if ((record_set->source && (record_set->source != source)) || (storage == OPH_IOSTORE_FIELD_SHARED))
+		return oph_iostore_set_frag_cell(record_set, row, field, value, length);
+
+	if (storage == OPH_IOSTORE_FIELD_OWN) {
+		//Own cells cannot be mixed with borrowed ones in the same column
+		long long j = 0;
+		for (j = 0; record_set->record_set[j]; j++)
+			if (record_set->record_set[j]->field[field])
+				return oph_iostore_set_frag_cell(record_set, row, field, value, length);
+
+		if (_oph_iostore_alloc_field_storage(record_set, 0))
+			return OPH_IOSTORAGE_MEMORY_ERR;
+		if (!record_set->source) {
+			__atomic_add_fetch(&(source->ref_count), 1, __ATOMIC_ACQ_REL);
+			record_set->source = source;
+		}
+		record_set->field_storage[field] = OPH_IOSTORE_FIELD_BORROWED;
+	}
+
+	oph_iostore_frag_record *record = record_set->record_set[row];
+	record_set->zone_map.valid = 0;
+	record->field[field] = (length ? value : NULL);
+	record->field_length[field] = length;
+
+	return OPH_IOSTORAGE_SUCCESS;
+}
+
+int oph_iostore_set_frag_column_constant(oph_iostore_frag_record_set * record_set, unsigned short field, long long row_num, const void *value, unsigned long long length)
+{
+	if (!record_set || !record_set->record_set || (row_num < 0) || (field >= record_set->field_num) || (!value && length)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+		return OPH_IOSTORAGE_NULL_PARAM;
+	}
+
+	if (_oph_iostore_reserve(record_set, length))
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	char *buffer = NULL;
+	if (length && !(buffer = (char *) memdup(value, length))) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		_oph_iostore_release(record_set, length);
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	}
+
+	int res = _oph_iostore_set_shared_column(record_set, field, row_num, buffer, length, 0);
+	if (res)
+		_oph_iostore_release(record_set, length);
+	return res;
+}
+
+int oph_iostore_set_frag_column_sequence(oph_iostore_frag_record_set * record_set, unsigned short field, long long row_num, long long start, long long step)
+{
+	if (!record_set || !record_set->record_set || (row_num < 0) || (field >= record_set->field_num)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+		return OPH_IOSTORAGE_NULL_PARAM;
+	}
+
+	if (_oph_iostore_reserve(record_set, row_num * sizeof(long long)))
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	long long *buffer = NULL;
+	if (row_num && !(buffer = (long long *) malloc(row_num * sizeof(long long)))) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		_oph_iostore_release(record_set, row_num * sizeof(long long));
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	}
+	long long j = 0;
+	for (j = 0; j < row_num; j++)
+		buffer[j] = start + j * step;
+
+	int res = _oph_iostore_set_shared_column(record_set, field, row_num, (char *) buffer, sizeof(long long), sizeof(long long));
+	if (res)
+		_oph_iostore_release(record_set, row_num * sizeof(long long));
+	return res;
+}
+
+int oph_iostore_trim_frag_recordset(oph_iostore_frag_record_set * record_set, long long row_num)
+{
+	if (!record_set || (row_num < 0)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+		return OPH_IOSTORAGE_NULL_PARAM;
+	}
+
+	if (!record_set->record_set)
+		return OPH_IOSTORAGE_SUCCESS;
+
+	long long j = 0, total_row_num = 0;
+	while (record_set->record_set[total_row_num])
+		total_row_num++;
+
+	if (total_row_num > row_num) {
+		record_set->zone_map.valid = 0;
+
+		for (j = row_num; j < total_row_num; j++)
+			_oph_iostore_release_frag_record(record_set, &(record_set->record_set[j]));
+
+		//Realloc record set array
+		oph_iostore_frag_record **tmp = (oph_iostore_frag_record **) realloc(record_set->record_set, (row_num + 1) * sizeof(oph_iostore_frag_record *));
+		if (tmp == NULL) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+			return OPH_IOSTORAGE_MEMORY_ERR;
+		}
+		//Set last element of record to NULL
+		tmp[row_num] = NULL;
+		record_set->record_set = tmp;
+	}
+	//Unused arena is given back to the memory budget
+	_oph_iostore_slab_shrink_arena(record_set->slab);
+
+	return OPH_IOSTORAGE_SUCCESS;
+}
+
+int oph_iostore_update_frag_zone_map(oph_iostore_frag_record_set * record_set)
+{
+	if (!record_set) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+		return OPH_IOSTORAGE_NULL_PARAM;
+	}
+
+	oph_iostore_frag_zone_map *zone_map = &(record_set->zone_map);
+	memset(zone_map, 0, sizeof(oph_iostore_frag_zone_map));
+	zone_map->id_index = -1;
+
+	short int i;
+	for (i = 0; i < record_set->field_num; i++) {
+		if (record_set->field_name && record_set->field_name[i] && !STRCMP(record_set->field_name[i], OPH_NAME_ID)) {
+			zone_map->id_index = i;
+			break;
+		}
+	}
+	if ((zone_map->id_index < 0) || !record_set->field_type || (record_set->field_type[zone_map->id_index] != OPH_IOSTORE_LONG_TYPE))
+		return OPH_IOSTORAGE_SUCCESS;
+
+	long long j, id = 0;
+	char sorted = 1;
+	oph_iostore_frag_record *record = NULL;
+	for (j = 0; record_set->record_set && (record = record_set->record_set[j]); j++) {
+		if (!record->field[zone_map->id_index] || (record->field_length[zone_map->id_index] != sizeof(long long)))
+			return OPH_IOSTORAGE_SUCCESS;
+		memcpy(&id, record->field[zone_map->id_index], sizeof(long long));
+		if (!j)
+			zone_map->min_id = zone_map->max_id = id;
+		else {
+			if (id <= zone_map->max_id)
+				sorted = 0;
+			if (id < zone_map->min_id)
+				zone_map->min_id = id;
+			if (id > zone_map->max_id)
+				zone_map->max_id = id;
+		}
+	}
+
+	zone_map->row_num = j;
+	zone_map->sorted = sorted;
+	zone_map->dense = sorted && (!j || (zone_map->max_id - zone_map->min_id == j - 1));
+	zone_map->valid = 1;
+
+	return OPH_IOSTORAGE_SUCCESS;
+}
+
 int oph_iostore_create_sample_frag(const long long row_number, const long long array_length, oph_iostore_frag_record_set ** record_set)
 {
 	if (!record_set || !row_number || !array_length) {
@@ -432,6 +1117,14 @@ int oph_iostore_create_sample_frag(const long long row_number, const long long a
 	(*record_set)->field_num = 2;
 	(*record_set)->field_type = NULL;
 	(*record_set)->record_set = NULL;
+	(*record_set)->tmp_flag = 0;
+	(*record_set)->slab = NULL;
+	memset(&((*record_set)->zone_map), 0, sizeof(oph_iostore_frag_zone_map));
+	(*record_set)->field_storage = NULL;
+	(*record_set)->field_buffer = NULL;
+	(*record_set)->source = NULL;
+	(*record_set)->ref_count = 1;
+	(*record_set)->reserved = 0;
 	(*record_set)->field_name = (char **) calloc(2, sizeof(char *));
 	if (!(*record_set)->field_name) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
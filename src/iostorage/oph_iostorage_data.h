@@ -38,6 +38,63 @@ typedef struct {
 	void **field;
 } oph_iostore_frag_record;
 
+#define OPH_IOSTORE_SLAB_NO_OFFSET	((unsigned long long) -1)
+
+/**
+ * \brief			          Structure for storing fragment cells in contiguous memory (slab layout)
+ * \param row_num 	    Number of record accessors available in the slab
+ * \param field_num 	  Number of fields contained in records
+ * \param id_index 	    Index of the field stored in the id column (-1 if not used)
+ * \param id_column 	  Contiguous array with id_dim values of each row
+ * \param arena 	      Contiguous memory area containing the other cells (e.g. measure arrays)
+ * \param arena_size 	  Size of the arena in bytes
+ * \param arena_used 	  Bytes of arena already assigned to cells
+ * \param cell_offset 	Offset of each cell within the arena (row-major, OPH_IOSTORE_SLAB_NO_OFFSET if not in arena)
+ * \param records 	    Contiguous array of record accessors referenced by record_set
+ * \param field_length 	Contiguous array backing the field_length of each record accessor
+ * \param field 	      Contiguous array backing the field of each record accessor
+ * \param reserved 	    Bytes reserved for the slab from the server memory budget
+ */
+typedef struct {
+	long long row_num;
+	unsigned short field_num;
+	short int id_index;
+	unsigned long long *id_column;
+	char *arena;
+	unsigned long long arena_size;
+	unsigned long long arena_used;
+	unsigned long long *cell_offset;
+	oph_iostore_frag_record *records;
+	unsigned long long *field_length;
+	void **field;
+	unsigned long long reserved;
+} oph_iostore_frag_slab;
+
+/**
+ * \brief			          Structure containing summary information (zone map) about the id_dim column of a fragment
+ * \param valid 	      Flag set to 1 if the zone map describes the current rows of the fragment
+ * \param id_index 	    Index of the id_dim field
+ * \param row_num 	    Number of rows summarized
+ * \param min_id 	      Minimum value of id_dim
+ * \param max_id 	      Maximum value of id_dim
+ * \param sorted 	      Flag set to 1 if id_dim values are strictly increasing
+ * \param dense 	      Flag set to 1 if id_dim values are sorted and consecutive (row j has id min_id + j)
+ */
+typedef struct {
+	char valid;
+	short int id_index;
+	long long row_num;
+	long long min_id;
+	long long max_id;
+	char sorted;
+	char dense;
+} oph_iostore_frag_zone_map;
+
+//Storage of the cells of a column
+#define OPH_IOSTORE_FIELD_OWN		0	//Each cell is owned by its record
+#define OPH_IOSTORE_FIELD_BORROWED	1	//Cells reference the cells of the source record set
+#define OPH_IOSTORE_FIELD_SHARED	2	//Cells reference a single buffer of the record set (constant value or generated sequence)
+
 /**
  * \brief			          Structure containing information about a fragment record set (entire table)
  * \param frag_name		  Name of Fragment
@@ -46,14 +103,28 @@ typedef struct {
  * \param field_type		Array containing type of each cell
  * \param record_set		NULL terminated array with pointers to actual records
  * \param tmp_flag			Flag set to 1 if the table is considered as a temporary one (deleted at the end of the operation)
+ * \param slab			    Contiguous storage backing the records (NULL if each record is allocated separately)
+ * \param zone_map		  Summary of id_dim values used to prune rows
+ * \param field_storage	Array with the storage of the cells of each column (NULL if all cells are owned by records)
+ * \param field_buffer	Array with the buffer backing each shared column (NULL if no column is shared)
+ * \param source		    Record set owning the borrowed cells (NULL if no column is borrowed)
+ * \param ref_count		  Number of references to the record set: one for the owner plus one for each record set borrowing its cells
+ * \param reserved		  Bytes reserved from the server memory budget for cells and shared buffers allocated outside the slab
  */
-typedef struct {
+typedef struct _oph_iostore_frag_record_set {
 	char *frag_name;
 	unsigned short field_num;
 	char **field_name;
 	oph_iostore_field_type *field_type;
 	oph_iostore_frag_record **record_set;
 	char tmp_flag;
+	oph_iostore_frag_slab *slab;
+	oph_iostore_frag_zone_map zone_map;
+	char *field_storage;
+	void **field_buffer;
+	struct _oph_iostore_frag_record_set *source;
+	int ref_count;
+	unsigned long long reserved;
 } oph_iostore_frag_record_set;
 
 /**
@@ -137,14 +208,14 @@ int oph_iostore_destroy_frag_record(oph_iostore_frag_record ** record, short int
 int oph_iostore_create_frag_record(oph_iostore_frag_record ** record, short int field_num);
 
 /**
- * \brief			        Destroy a record set and release resources
+ * \brief			        Destroy a record set and release resources. If other record sets still borrow its cells, memory is released with the last reference
  * \param record_set  Record set to be freed
  * \return            0 if successfull, non-0 otherwise
  */
 int oph_iostore_destroy_frag_recordset(oph_iostore_frag_record_set ** record_set);
 
 /**
- * \brief			        Destroy a record set and release resources (it does not destroy internal record set)
+ * \brief			        Destroy a record set and release resources (it does not destroy internal record set and slab)
  * \param record_set  Record set to be freed
  * \return            0 if successfull, non-0 otherwise
  */
@@ -168,6 +239,88 @@ int oph_iostore_create_frag_recordset(oph_iostore_frag_record_set ** record_set,
  */
 int oph_iostore_create_frag_recordset_only(oph_iostore_frag_record_set ** record_set, long long set_size, short int field_num);
 
+/**
+ * \brief			        Create a recordset whose records are stored in a slab (contiguous id column and cell arena)
+ * \param record_set  Record set to be allocated
+ * \param set_size    Number of rows in record set
+ * \param field_num   Number of fields in each record
+ * \param id_index    Index of the id_dim field to be stored in the id column (-1 if not available)
+ * \param arena_size  Initial size of the cell arena in bytes (it is extended if needed)
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_iostore_create_frag_recordset_slab(oph_iostore_frag_record_set ** record_set, long long set_size, short int field_num, short int id_index, unsigned long long arena_size);
+
+/**
+ * \brief			        Attach a slab to a recordset with no records. If the record array is already allocated it must contain at least set_size+1 NULL elements
+ * \param record_set  Record set to be updated
+ * \param set_size    Number of rows in record set
+ * \param id_index    Index of the id_dim field to be stored in the id column (-1 if not available)
+ * \param arena_size  Initial size of the cell arena in bytes (it is extended if needed)
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_iostore_create_frag_slab(oph_iostore_frag_record_set * record_set, long long set_size, short int id_index, unsigned long long arena_size);
+
+/**
+ * \brief			        Set the value of a cell. The value is copied in the slab, if available, or in a new memory area otherwise. A borrowed column is copied before being modified
+ * \param record_set  Record set to be updated
+ * \param row         Index of the row
+ * \param field       Index of the field
+ * \param value       Value to be copied (it can be NULL only if length is 0)
+ * \param length      Length of the value in bytes
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_iostore_set_frag_cell(oph_iostore_frag_record_set * record_set, long long row, unsigned short field, const void *value, unsigned long long length);
+
+/**
+ * \brief			        Set a cell with a reference to a cell of another record set, without copying it. The column is marked as borrowed and source is kept alive until the
+ *                    column is released or copied. A record set borrows from a single source: the value is copied if the column already has own or shared cells, or cells from another source
+ * \param record_set  Record set to be updated
+ * \param row         Index of the row
+ * \param field       Index of the field
+ * \param source      Record set owning the cell (it must not be modified while referenced)
+ * \param value       Cell of source to be referenced
+ * \param length      Length of the value in bytes
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_iostore_borrow_frag_cell(oph_iostore_frag_record_set * record_set, long long row, unsigned short field, oph_iostore_frag_record_set * source, void *value, unsigned long long length);
+
+/**
+ * \brief			        Set the first row_num cells of a column to the same value (cells of other rows are released). The value is stored once and shared by the cells until the column is modified
+ * \param record_set  Record set to be updated
+ * \param field       Index of the field
+ * \param row_num     Number of rows to be set (rows must be already allocated)
+ * \param value       Value to be copied (it can be NULL only if length is 0)
+ * \param length      Length of the value in bytes
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_iostore_set_frag_column_constant(oph_iostore_frag_record_set * record_set, unsigned short field, long long row_num, const void *value, unsigned long long length);
+
+/**
+ * \brief			        Set the first row_num cells of a column to the long values start, start + step, ... (cells of other rows are released). The values are generated in a single buffer
+ * \param record_set  Record set to be updated
+ * \param field       Index of the field
+ * \param row_num     Number of rows to be set (rows must be already allocated)
+ * \param start       Value of the first row
+ * \param step        Difference between the values of consecutive rows
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_iostore_set_frag_column_sequence(oph_iostore_frag_record_set * record_set, unsigned short field, long long row_num, long long start, long long step);
+
+/**
+ * \brief			        Remove the rows following the first 'row_num' ones, releasing their resources. The slab arena not used by the remaining cells is released too
+ * \param record_set  Record set to be updated
+ * \param row_num     Number of rows to be kept
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_iostore_trim_frag_recordset(oph_iostore_frag_record_set * record_set, long long row_num);
+
+/**
+ * \brief			        Compute the zone map of the id_dim column. It should be called once the rows of the record set are final (e.g. before storing it); the zone map is left invalid if id_dim is not available or not integer
+ * \param record_set  Record set to be updated
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_iostore_update_frag_zone_map(oph_iostore_frag_record_set * record_set);
+
 /**
  * \brief			        Create a sample recordset (for test purposes). It does not set the frag_name.
  * \param row_number  Number of rows in record set
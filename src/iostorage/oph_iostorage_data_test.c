@@ -0,0 +1,504 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "oph_iostorage_data.h"
+#include "oph_server_memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Global variables used by the server utilities
+unsigned short disable_mem_check = 1;
+
+#define OPH_IOSTORAGE_DATA_TEST_ROWS	8
+#define OPH_IOSTORAGE_DATA_TEST_FIELDS	2
+
+//Value expected in a cell of the test record sets
+#define OPH_IOSTORAGE_DATA_TEST_VALUE(row, field)	((long long) (field) * 100 + (row))
+
+//Cells are own by default: source memory is reserved and accounted like a fragment loaded by the server
+static int _oph_iostorage_data_test_create(oph_iostore_frag_record_set ** record_set, char slab)
+{
+	if (slab ? oph_iostore_create_frag_recordset_slab(record_set, OPH_IOSTORAGE_DATA_TEST_ROWS, OPH_IOSTORAGE_DATA_TEST_FIELDS, -1, 0)
+	    : oph_iostore_create_frag_recordset(record_set, OPH_IOSTORAGE_DATA_TEST_ROWS, OPH_IOSTORAGE_DATA_TEST_FIELDS)) {
+		fprintf(stderr, "Unable to create a record set\n");
+		return 1;
+	}
+	return 0;
+}
+
+static int _oph_iostorage_data_test_fill(oph_iostore_frag_record_set * record_set)
+{
+	long long j, value;
+	unsigned short i;
+	for (j = 0; j < OPH_IOSTORAGE_DATA_TEST_ROWS; j++)
+		for (i = 0; i < OPH_IOSTORAGE_DATA_TEST_FIELDS; i++) {
+			value = OPH_IOSTORAGE_DATA_TEST_VALUE(j, i);
+			if (oph_iostore_set_frag_cell(record_set, j, i, &value, sizeof(long long))) {
+				fprintf(stderr, "Unable to set a cell\n");
+				return 1;
+			}
+		}
+	return 0;
+}
+
+static int _oph_iostorage_data_test_borrow(oph_iostore_frag_record_set * record_set, unsigned short field, oph_iostore_frag_record_set * source)
+{
+	long long j;
+	for (j = 0; j < OPH_IOSTORAGE_DATA_TEST_ROWS; j++)
+		if (oph_iostore_borrow_frag_cell(record_set, j, field, source, source->record_set[j]->field[field], source->record_set[j]->field_length[field])) {
+			fprintf(stderr, "Unable to borrow a cell\n");
+			return 1;
+		}
+	return 0;
+}
+
+//Check the first row_num cells of a column, except the one of row skip
+static int _oph_iostorage_data_test_check(oph_iostore_frag_record_set * record_set, unsigned short field, long long row_num, long long skip)
+{
+	long long j;
+	for (j = 0; j < row_num; j++) {
+		oph_iostore_frag_record *record = record_set->record_set[j];
+		if (j == skip)
+			continue;
+		if (!record || !record->field[field] || (record->field_length[field] != sizeof(long long))
+		    || (*(long long *) record->field[field] != OPH_IOSTORAGE_DATA_TEST_VALUE(j, field))) {
+			fprintf(stderr, "Wrong value in row %lld of field %d\n", j, field);
+			return 1;
+		}
+	}
+	if (record_set->record_set[row_num]) {
+		fprintf(stderr, "Record set has more than %lld rows\n", row_num);
+		return 1;
+	}
+	return 0;
+}
+
+static int _oph_iostorage_data_test_storage(oph_iostore_frag_record_set * record_set, unsigned short field, char storage)
+{
+	char actual = (record_set->field_storage ? record_set->field_storage[field] : OPH_IOSTORE_FIELD_OWN);
+	if (actual != storage) {
+		fprintf(stderr, "Field %d has storage %d instead of %d\n", field, actual, storage);
+		return 1;
+	}
+	return 0;
+}
+
+//Memory reserved by record sets has to be given back when they are destroyed
+static int _oph_iostorage_data_test_released(unsigned long long used)
+{
+	if (oph_server_memory_get_used() != used) {
+		fprintf(stderr, "Reserved memory is %llu bytes instead of %llu\n", oph_server_memory_get_used(), used);
+		return 1;
+	}
+	return 0;
+}
+
+//Borrowed columns
+static int _oph_iostorage_data_test_borrow_outlive(char slab)
+{
+	oph_iostore_frag_record_set *source = NULL, *record_set = NULL;
+	unsigned long long used = oph_server_memory_get_used(), source_used = 0;
+	int res = 0;
+
+	if (_oph_iostorage_data_test_create(&source, 0) || _oph_iostorage_data_test_fill(source) || _oph_iostorage_data_test_create(&record_set, slab))
+		res = 1;
+	source_used = oph_server_memory_get_used();
+	if (!res && (_oph_iostorage_data_test_borrow(record_set, 0, source) || _oph_iostorage_data_test_borrow(record_set, 1, source)))
+		res = 1;
+	if (!res && ((source->ref_count != 2) || (record_set->source != source) || _oph_iostorage_data_test_storage(record_set, 0, OPH_IOSTORE_FIELD_BORROWED))) {
+		fprintf(stderr, "Borrowing record set does not reference its source\n");
+		res = 1;
+	}
+	//Borrowing cells does not reserve memory
+	if (!res && _oph_iostorage_data_test_released(source_used))
+		res = 1;
+
+	//Cells of the source are kept until the borrowing record set is destroyed
+	if (source)
+		oph_iostore_destroy_frag_recordset(&source);
+	if (!res && source) {
+		fprintf(stderr, "Source is still referenced by the caller\n");
+		res = 1;
+	}
+	if (!res && (_oph_iostorage_data_test_released(source_used) || _oph_iostorage_data_test_check(record_set, 0, OPH_IOSTORAGE_DATA_TEST_ROWS, -1)
+		     || _oph_iostorage_data_test_check(record_set, 1, OPH_IOSTORAGE_DATA_TEST_ROWS, -1)))
+		res = 1;
+
+	if (record_set)
+		oph_iostore_destroy_frag_recordset(&record_set);
+	if (source)
+		oph_iostore_destroy_frag_recordset(&source);
+	if (_oph_iostorage_data_test_released(used))
+		res = 1;
+
+	return res;
+}
+
+static int _oph_iostorage_data_test_borrow_write(char slab)
+{
+	oph_iostore_frag_record_set *source = NULL, *record_set = NULL;
+	unsigned long long used = oph_server_memory_get_used();
+	long long value = -1;
+	int res = 0;
+
+	if (_oph_iostorage_data_test_create(&source, 0) || _oph_iostorage_data_test_fill(source) || _oph_iostorage_data_test_create(&record_set, slab)
+	    || _oph_iostorage_data_test_borrow(record_set, 0, source) || _oph_iostorage_data_test_borrow(record_set, 1, source))
+		res = 1;
+
+	//The column is copied before being modified, so that the source is unchanged
+	if (!res && oph_iostore_set_frag_cell(record_set, 3, 0, &value, sizeof(long long))) {
+		fprintf(stderr, "Unable to write a borrowed cell\n");
+		res = 1;
+	}
+	if (!res && (_oph_iostorage_data_test_storage(record_set, 0, OPH_IOSTORE_FIELD_OWN) || _oph_iostorage_data_test_check(record_set, 0, OPH_IOSTORAGE_DATA_TEST_ROWS, 3)
+		     || _oph_iostorage_data_test_check(source, 0, OPH_IOSTORAGE_DATA_TEST_ROWS, -1)))
+		res = 1;
+	if (!res && (*(long long *) record_set->record_set[3]->field[0] != value)) {
+		fprintf(stderr, "Borrowed cell has not been written\n");
+		res = 1;
+	}
+	if (!res && (record_set->record_set[0]->field[0] == source->record_set[0]->field[0])) {
+		fprintf(stderr, "Modified column still references the source\n");
+		res = 1;
+	}
+	//The other column is still borrowed
+	if (!res && ((source->ref_count != 2) || (record_set->source != source) || _oph_iostorage_data_test_storage(record_set, 1, OPH_IOSTORE_FIELD_BORROWED))) {
+		fprintf(stderr, "Source has been released while a column is still borrowed\n");
+		res = 1;
+	}
+
+	//The source is released as soon as no column is borrowed
+	if (!res && oph_iostore_set_frag_cell(record_set, 5, 1, &value, sizeof(long long))) {
+		fprintf(stderr, "Unable to write a borrowed cell\n");
+		res = 1;
+	}
+	if (!res && ((source->ref_count != 1) || record_set->source)) {
+		fprintf(stderr, "Source has not been released\n");
+		res = 1;
+	}
+	if (!res && (_oph_iostorage_data_test_check(record_set, 1, OPH_IOSTORAGE_DATA_TEST_ROWS, 5) || _oph_iostorage_data_test_check(source, 1, OPH_IOSTORAGE_DATA_TEST_ROWS, -1)))
+		res = 1;
+
+	//Copied cells belong to the record set and outlive the source
+	if (source)
+		oph_iostore_destroy_frag_recordset(&source);
+	if (!res && (_oph_iostorage_data_test_check(record_set, 0, OPH_IOSTORAGE_DATA_TEST_ROWS, 3) || _oph_iostorage_data_test_check(record_set, 1, OPH_IOSTORAGE_DATA_TEST_ROWS, 5)))
+		res = 1;
+
+	if (record_set)
+		oph_iostore_destroy_frag_recordset(&record_set);
+	if (_oph_iostorage_data_test_released(used))
+		res = 1;
+
+	return res;
+}
+
+static int _oph_iostorage_data_test_borrow_trim(char slab)
+{
+	oph_iostore_frag_record_set *source = NULL, *record_set = NULL;
+	unsigned long long used = oph_server_memory_get_used();
+	long long j, value;
+	int res = 0;
+
+	//Field 0 is borrowed and field 1 is own
+	if (_oph_iostorage_data_test_create(&source, 0) || _oph_iostorage_data_test_fill(source) || _oph_iostorage_data_test_create(&record_set, slab)
+	    || _oph_iostorage_data_test_borrow(record_set, 0, source))
+		res = 1;
+	for (j = 0; !res && (j < OPH_IOSTORAGE_DATA_TEST_ROWS); j++) {
+		value = OPH_IOSTORAGE_DATA_TEST_VALUE(j, 1);
+		if (oph_iostore_set_frag_cell(record_set, j, 1, &value, sizeof(long long))) {
+			fprintf(stderr, "Unable to set a cell\n");
+			res = 1;
+		}
+	}
+
+	//Trimmed rows do not free borrowed cells
+	if (!res && oph_iostore_trim_frag_recordset(record_set, 3)) {
+		fprintf(stderr, "Unable to trim a record set\n");
+		res = 1;
+	}
+	if (!res && (_oph_iostorage_data_test_check(record_set, 0, 3, -1) || _oph_iostorage_data_test_check(record_set, 1, 3, -1)
+		     || _oph_iostorage_data_test_check(source, 0, OPH_IOSTORAGE_DATA_TEST_ROWS, -1)))
+		res = 1;
+	if (!res && ((source->ref_count != 2) || _oph_iostorage_data_test_storage(record_set, 0, OPH_IOSTORE_FIELD_BORROWED))) {
+		fprintf(stderr, "Trimmed record set does not reference its source\n");
+		res = 1;
+	}
+
+	//Source cells are freed only once, when both record sets are destroyed
+	if (source)
+		oph_iostore_destroy_frag_recordset(&source);
+	if (!res && _oph_iostorage_data_test_check(record_set, 0, 3, -1))
+		res = 1;
+	if (record_set)
+		oph_iostore_destroy_frag_recordset(&record_set);
+	if (_oph_iostorage_data_test_released(used))
+		res = 1;
+
+	return res;
+}
+
+//Cells are copied when they cannot be borrowed
+static int _oph_iostorage_data_test_borrow_copy()
+{
+	oph_iostore_frag_record_set *source = NULL, *other = NULL, *record_set = NULL, *second = NULL;
+	unsigned long long used = oph_server_memory_get_used();
+	long long value = OPH_IOSTORAGE_DATA_TEST_VALUE(0, 0);
+	int res = 0;
+
+	if (_oph_iostorage_data_test_create(&source, 0) || _oph_iostorage_data_test_fill(source) || _oph_iostorage_data_test_create(&other, 0)
+	    || _oph_iostorage_data_test_fill(other) || _oph_iostorage_data_test_create(&record_set, 0) || _oph_iostorage_data_test_create(&second, 0))
+		res = 1;
+
+	//A record set cannot borrow its own cells
+	if (!res && !oph_iostore_borrow_frag_cell(source, 0, 1, source, source->record_set[0]->field[0], sizeof(long long))) {
+		fprintf(stderr, "Record set has borrowed its own cells\n");
+		res = 1;
+	}
+
+	//Own cells are not mixed with borrowed ones in the same column
+	if (!res && (oph_iostore_set_frag_cell(record_set, 0, 0, &value, sizeof(long long)) || _oph_iostorage_data_test_borrow(record_set, 0, source)))
+		res = 1;
+	if (!res && ((source->ref_count != 1) || record_set->source || _oph_iostorage_data_test_storage(record_set, 0, OPH_IOSTORE_FIELD_OWN))) {
+		fprintf(stderr, "Column with own cells references the source\n");
+		res = 1;
+	}
+	if (!res && (record_set->record_set[1]->field[0] == source->record_set[1]->field[0])) {
+		fprintf(stderr, "Cell has not been copied into a column with own cells\n");
+		res = 1;
+	}
+
+	//Only one source can be referenced
+	if (!res && (_oph_iostorage_data_test_borrow(second, 0, other) || _oph_iostorage_data_test_borrow(second, 1, source)))
+		res = 1;
+	if (!res && ((other->ref_count != 2) || (source->ref_count != 1) || (second->source != other)
+		     || _oph_iostorage_data_test_storage(second, 0, OPH_IOSTORE_FIELD_BORROWED) || _oph_iostorage_data_test_storage(second, 1, OPH_IOSTORE_FIELD_OWN))) {
+		fprintf(stderr, "Record set references more than one source\n");
+		res = 1;
+	}
+	if (!res && (_oph_iostorage_data_test_check(record_set, 0, OPH_IOSTORAGE_DATA_TEST_ROWS, -1) || _oph_iostorage_data_test_check(second, 0, OPH_IOSTORAGE_DATA_TEST_ROWS, -1)
+		     || _oph_iostorage_data_test_check(second, 1, OPH_IOSTORAGE_DATA_TEST_ROWS, -1)))
+		res = 1;
+
+	if (source)
+		oph_iostore_destroy_frag_recordset(&source);
+	if (other)
+		oph_iostore_destroy_frag_recordset(&other);
+	if (record_set)
+		oph_iostore_destroy_frag_recordset(&record_set);
+	if (second)
+		oph_iostore_destroy_frag_recordset(&second);
+	if (_oph_iostorage_data_test_released(used))
+		res = 1;
+
+	return res;
+}
+
+//Shared columns
+static int _oph_iostorage_data_test_constant(oph_iostore_frag_record_set * record_set, unsigned short field, long long row_num, long long value)
+{
+	long long j;
+	for (j = 0; j < row_num; j++) {
+		oph_iostore_frag_record *record = record_set->record_set[j];
+		if (!record->field[field] || (record->field_length[field] != sizeof(long long)) || (*(long long *) record->field[field] != value)) {
+			fprintf(stderr, "Wrong constant in row %lld of field %d\n", j, field);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int _oph_iostorage_data_test_shared_write(char slab)
+{
+	oph_iostore_frag_record_set *record_set = NULL;
+	unsigned long long used = oph_server_memory_get_used();
+	long long constant = 7, value = -1, j;
+	int res = 0;
+
+	//Field 0 is constant and field 1 is the sequence of the expected values
+	if (_oph_iostorage_data_test_create(&record_set, slab) || _oph_iostorage_data_test_fill(record_set))
+		res = 1;
+	if (!res && (oph_iostore_set_frag_column_constant(record_set, 0, OPH_IOSTORAGE_DATA_TEST_ROWS, &constant, sizeof(long long))
+		     || oph_iostore_set_frag_column_sequence(record_set, 1, OPH_IOSTORAGE_DATA_TEST_ROWS, OPH_IOSTORAGE_DATA_TEST_VALUE(0, 1), 1))) {
+		fprintf(stderr, "Unable to set a shared column\n");
+		res = 1;
+	}
+	if (!res && (_oph_iostorage_data_test_storage(record_set, 0, OPH_IOSTORE_FIELD_SHARED) || _oph_iostorage_data_test_storage(record_set, 1, OPH_IOSTORE_FIELD_SHARED)
+		     || _oph_iostorage_data_test_constant(record_set, 0, OPH_IOSTORAGE_DATA_TEST_ROWS, constant) || _oph_iostorage_data_test_check(record_set, 1, OPH_IOSTORAGE_DATA_TEST_ROWS, -1)))
+		res = 1;
+	if (!res && (record_set->record_set[0]->field[0] != record_set->record_set[OPH_IOSTORAGE_DATA_TEST_ROWS - 1]->field[0])) {
+		fprintf(stderr, "Constant column is not backed by a single value\n");
+		res = 1;
+	}
+
+	//Only the written cell changes: the others are copied from the shared buffer
+	if (!res && oph_iostore_set_frag_cell(record_set, 2, 0, &value, sizeof(long long))) {
+		fprintf(stderr, "Unable to write a shared cell\n");
+		res = 1;
+	}
+	if (!res && _oph_iostorage_data_test_storage(record_set, 0, OPH_IOSTORE_FIELD_OWN))
+		res = 1;
+	for (j = 0; !res && (j < OPH_IOSTORAGE_DATA_TEST_ROWS); j++)
+		if ((record_set->record_set[j]->field_length[0] != sizeof(long long)) || (*(long long *) record_set->record_set[j]->field[0] != ((j == 2) ? value : constant))) {
+			fprintf(stderr, "Wrong cell in row %lld after writing a constant column\n", j);
+			res = 1;
+		}
+	if (!res && (record_set->record_set[0]->field[0] == record_set->record_set[1]->field[0])) {
+		fprintf(stderr, "Modified column still references the shared value\n");
+		res = 1;
+	}
+	//The other shared column is unchanged
+	if (!res && (_oph_iostorage_data_test_storage(record_set, 1, OPH_IOSTORE_FIELD_SHARED) || _oph_iostorage_data_test_check(record_set, 1, OPH_IOSTORAGE_DATA_TEST_ROWS, -1)))
+		res = 1;
+
+	if (!res && oph_iostore_set_frag_cell(record_set, 4, 1, &value, sizeof(long long))) {
+		fprintf(stderr, "Unable to write a shared cell\n");
+		res = 1;
+	}
+	if (!res && (_oph_iostorage_data_test_storage(record_set, 1, OPH_IOSTORE_FIELD_OWN) || _oph_iostorage_data_test_check(record_set, 1, OPH_IOSTORAGE_DATA_TEST_ROWS, 4)
+		     || (*(long long *) record_set->record_set[4]->field[1] != value)))
+		res = 1;
+
+	if (record_set)
+		oph_iostore_destroy_frag_recordset(&record_set);
+	if (_oph_iostorage_data_test_released(used))
+		res = 1;
+
+	return res;
+}
+
+static int _oph_iostorage_data_test_shared_trim(char slab)
+{
+	oph_iostore_frag_record_set *record_set = NULL;
+	unsigned long long used = oph_server_memory_get_used();
+	long long constant = 7;
+	int res = 0;
+
+	if (_oph_iostorage_data_test_create(&record_set, slab))
+		res = 1;
+	if (!res && (oph_iostore_set_frag_column_constant(record_set, 0, OPH_IOSTORAGE_DATA_TEST_ROWS, &constant, sizeof(long long))
+		     || oph_iostore_set_frag_column_sequence(record_set, 1, OPH_IOSTORAGE_DATA_TEST_ROWS, OPH_IOSTORAGE_DATA_TEST_VALUE(0, 1), 1))) {
+		fprintf(stderr, "Unable to set a shared column\n");
+		res = 1;
+	}
+
+	//Trimmed rows do not free shared cells
+	if (!res && oph_iostore_trim_frag_recordset(record_set, 3)) {
+		fprintf(stderr, "Unable to trim a record set\n");
+		res = 1;
+	}
+	if (!res && (_oph_iostorage_data_test_storage(record_set, 0, OPH_IOSTORE_FIELD_SHARED) || _oph_iostorage_data_test_storage(record_set, 1, OPH_IOSTORE_FIELD_SHARED)
+		     || _oph_iostorage_data_test_constant(record_set, 0, 3, constant) || _oph_iostorage_data_test_check(record_set, 1, 3, -1)))
+		res = 1;
+
+	//Shared buffers are freed once, when the record set is destroyed
+	if (record_set)
+		oph_iostore_destroy_frag_recordset(&record_set);
+	if (_oph_iostorage_data_test_released(used))
+		res = 1;
+
+	return res;
+}
+
+//Setting a column releases its previous cells, whatever their storage
+static int _oph_iostorage_data_test_shared_reset()
+{
+	oph_iostore_frag_record_set *source = NULL, *record_set = NULL;
+	unsigned long long used = oph_server_memory_get_used();
+	long long constant = 7, j;
+	int res = 0;
+
+	//Field 0 has own cells and field 1 borrowed ones
+	if (_oph_iostorage_data_test_create(&source, 0) || _oph_iostorage_data_test_fill(source) || _oph_iostorage_data_test_create(&record_set, 0)
+	    || _oph_iostorage_data_test_borrow(record_set, 1, source))
+		res = 1;
+	for (j = 0; !res && (j < OPH_IOSTORAGE_DATA_TEST_ROWS); j++)
+		if (oph_iostore_set_frag_cell(record_set, j, 0, &j, sizeof(long long))) {
+			fprintf(stderr, "Unable to set a cell\n");
+			res = 1;
+		}
+	if (!res && (_oph_iostorage_data_test_storage(record_set, 1, OPH_IOSTORE_FIELD_BORROWED) || (source->ref_count != 2)))
+		res = 1;
+
+	if (!res && (oph_iostore_set_frag_column_sequence(record_set, 0, OPH_IOSTORAGE_DATA_TEST_ROWS, 10, -2)
+		     || oph_iostore_set_frag_column_constant(record_set, 1, OPH_IOSTORAGE_DATA_TEST_ROWS, &constant, sizeof(long long)))) {
+		fprintf(stderr, "Unable to set a shared column\n");
+		res = 1;
+	}
+	for (j = 0; !res && (j < OPH_IOSTORAGE_DATA_TEST_ROWS); j++)
+		if (*(long long *) record_set->record_set[j]->field[0] != 10 - 2 * j) {
+			fprintf(stderr, "Wrong sequence in row %lld\n", j);
+			res = 1;
+		}
+	if (!res && ((source->ref_count != 1) || record_set->source || _oph_iostorage_data_test_constant(record_set, 1, OPH_IOSTORAGE_DATA_TEST_ROWS, constant))) {
+		fprintf(stderr, "Source has not been released by a constant column\n");
+		res = 1;
+	}
+
+	//A shared column set on the first rows only leaves the other cells empty
+	if (!res && (oph_iostore_set_frag_column_constant(record_set, 0, 3, &constant, sizeof(long long)) || oph_iostore_set_frag_column_sequence(record_set, 1, 3, 0, 1))) {
+		fprintf(stderr, "Unable to set a shared column\n");
+		res = 1;
+	}
+	for (j = 0; !res && (j < OPH_IOSTORAGE_DATA_TEST_ROWS); j++)
+		if ((j < 3) ? ((*(long long *) record_set->record_set[j]->field[0] != constant) || (*(long long *) record_set->record_set[j]->field[1] != j))
+		    : (record_set->record_set[j]->field[0] || record_set->record_set[j]->field[1])) {
+			fprintf(stderr, "Wrong cell in row %lld\n", j);
+			res = 1;
+		}
+
+	if (source)
+		oph_iostore_destroy_frag_recordset(&source);
+	if (record_set)
+		oph_iostore_destroy_frag_recordset(&record_set);
+	if (_oph_iostorage_data_test_released(used))
+		res = 1;
+
+	return res;
+}
+
+int main()
+{
+	int res = 0;
+	char slab;
+
+	for (slab = 0; slab < 2; slab++) {
+		if (_oph_iostorage_data_test_borrow_outlive(slab) || _oph_iostorage_data_test_borrow_write(slab) || _oph_iostorage_data_test_borrow_trim(slab)) {
+			fprintf(stderr, "Borrowed columns%s: FAILED\n", slab ? " (slab)" : "");
+			res = 1;
+		}
+	}
+	if (_oph_iostorage_data_test_borrow_copy()) {
+		fprintf(stderr, "Copied cells: FAILED\n");
+		res = 1;
+	}
+	for (slab = 0; slab < 2; slab++) {
+		if (_oph_iostorage_data_test_shared_write(slab) || _oph_iostorage_data_test_shared_trim(slab)) {
+			fprintf(stderr, "Shared columns%s: FAILED\n", slab ? " (slab)" : "");
+			res = 1;
+		}
+	}
+	if (_oph_iostorage_data_test_shared_reset()) {
+		fprintf(stderr, "Reset of columns: FAILED\n");
+		res = 1;
+	}
+
+	return res;
+}
@@ -26,6 +26,7 @@
 #include <ctype.h>
 
 #include "debug.h"
+#include "oph_server_hashmap.h"
 #include "oph_iostorage_log_error_codes.h"
 #include "oph_server_confs.h"
 #include "oph_server_utility.h"
@@ -35,8 +36,13 @@
 extern int msglevel;
 extern pthread_mutex_t libtool_lock;
 
+#define OPH_IOSTORAGE_REGISTRY_SIZE	16
+
 static int oph_iostore_find_device(const char *device, char **dyn_lib, unsigned short int *is_persitent);
 
+//Device registry: it is built at startup and then only read by threads
+static oph_server_hashmap *oph_iostore_registry = NULL;
+
 int (*_DEVICE_setup) (oph_iostore_handler * handle);
 int (*_DEVICE_cleanup) (oph_iostore_handler * handle);
 int (*_DEVICE_get_db) (oph_iostore_handler * handle, oph_iostore_resource_id * res_id, oph_iostore_db_record_set ** db_record);
@@ -46,6 +52,206 @@ int (*_DEVICE_get_frag) (oph_iostore_handler * handle, oph_iostore_resource_id *
 int (*_DEVICE_put_frag) (oph_iostore_handler * handle, oph_iostore_frag_record_set * frag_record, oph_iostore_resource_id ** res_id);
 int (*_DEVICE_delete_frag) (oph_iostore_handler * handle, oph_iostore_resource_id * res_id);
 
+static void *_oph_iostore_load_symbol(void *dlh, const char *format, const char *device)
+{
+	char func_name[OPH_IOSTORAGE_BUFLEN] = { '\0' };
+	snprintf(func_name, OPH_IOSTORAGE_BUFLEN, format, device);
+
+	void *symbol = lt_dlsym((lt_dlhandle) dlh, func_name);
+	if (!symbol) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_LOAD_FUNC_ERROR, lt_dlerror());
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_LOAD_FUNC_ERROR, lt_dlerror());
+	}
+	return symbol;
+}
+
+static void _oph_iostore_free_registry_entry(oph_iostore_handler * entry)
+{
+	if (!entry)
+		return;
+	if (entry->dlh)
+		lt_dlclose((lt_dlhandle) entry->dlh);
+	if (entry->device)
+		free(entry->device);
+	if (entry->lib)
+		free(entry->lib);
+	if (entry->functions)
+		free((void *) entry->functions);
+	entry->dlh = NULL;
+	entry->device = NULL;
+	entry->lib = NULL;
+	entry->functions = NULL;
+}
+
+//Called with libtool_lock acquired
+static int _oph_iostore_register_device(const char *device, const char *lib)
+{
+	oph_iostore_handler *entry = (oph_iostore_handler *) calloc(1, sizeof(oph_iostore_handler));
+	oph_iostore_device_functions *functions = (oph_iostore_device_functions *) calloc(1, sizeof(oph_iostore_device_functions));
+	if (!entry || !functions) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		if (entry)
+			free(entry);
+		if (functions)
+			free(functions);
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	}
+	entry->functions = functions;
+
+	entry->device = (char *) strndup(device, OPH_IOSTORAGE_BUFLEN);
+	entry->lib = (char *) strndup(lib, OPH_IOSTORAGE_BUFLEN);
+	if (!entry->device || !entry->lib) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		_oph_iostore_free_registry_entry(entry);
+		free(entry);
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	}
+	//Convert device name to lower case
+	int i = 0;
+	while (entry->device[i]) {
+		entry->device[i] = tolower(entry->device[i]);
+		i++;
+	}
+	entry->is_persistent = (STRCMP(entry->lib, OPH_IOSTORAGE_PERSISTENT_DEV) == 0 ? 1 : 0);
+
+	if (!(entry->dlh = (lt_dlhandle) lt_dlopen(entry->lib))) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_DLOPEN_ERROR, lt_dlerror());
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_DLOPEN_ERROR, lt_dlerror());
+		_oph_iostore_free_registry_entry(entry);
+		free(entry);
+		return OPH_IOSTORAGE_DLOPEN_ERR;
+	}
+
+	if (!(functions->setup = (int (*)(oph_iostore_handler *)) _oph_iostore_load_symbol(entry->dlh, OPH_IOSTORAGE_SETUP_FUNC, entry->device))
+	    || !(functions->cleanup = (int (*)(oph_iostore_handler *)) _oph_iostore_load_symbol(entry->dlh, OPH_IOSTORAGE_CLEANUP_FUNC, entry->device))
+	    || !(functions->get_db =
+		 (int (*)(oph_iostore_handler *, oph_iostore_resource_id *, oph_iostore_db_record_set **)) _oph_iostore_load_symbol(entry->dlh, OPH_IOSTORAGE_GET_DB_FUNC, entry->device))
+	    || !(functions->put_db =
+		 (int (*)(oph_iostore_handler *, oph_iostore_db_record_set *, oph_iostore_resource_id **)) _oph_iostore_load_symbol(entry->dlh, OPH_IOSTORAGE_PUT_DB_FUNC, entry->device))
+	    || !(functions->delete_db = (int (*)(oph_iostore_handler *, oph_iostore_resource_id *)) _oph_iostore_load_symbol(entry->dlh, OPH_IOSTORAGE_DELETE_DB_FUNC, entry->device))
+	    || !(functions->get_frag =
+		 (int (*)(oph_iostore_handler *, oph_iostore_resource_id *, oph_iostore_frag_record_set **)) _oph_iostore_load_symbol(entry->dlh, OPH_IOSTORAGE_GET_FRAG_FUNC,
+														     entry->device))
+	    || !(functions->put_frag =
+		 (int (*)(oph_iostore_handler *, oph_iostore_frag_record_set *, oph_iostore_resource_id **)) _oph_iostore_load_symbol(entry->dlh, OPH_IOSTORAGE_PUT_FRAG_FUNC,
+														     entry->device))
+	    || !(functions->delete_frag = (int (*)(oph_iostore_handler *, oph_iostore_resource_id *)) _oph_iostore_load_symbol(entry->dlh, OPH_IOSTORAGE_DELETE_FRAG_FUNC, entry->device))) {
+		_oph_iostore_free_registry_entry(entry);
+		free(entry);
+		return OPH_IOSTORAGE_DLSYM_ERR;
+	}
+
+	if (oph_server_hashmap_get(oph_iostore_registry, entry->device)) {
+		pmesg(LOG_WARNING, __FILE__, __LINE__, "Device %s already registered: entry skipped\n", entry->device);
+		logging(LOG_WARNING, __FILE__, __LINE__, "Device %s already registered: entry skipped\n", entry->device);
+		_oph_iostore_free_registry_entry(entry);
+		free(entry);
+		return OPH_IOSTORAGE_SUCCESS;
+	}
+	if (oph_server_hashmap_insert(oph_iostore_registry, entry->device, entry)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		_oph_iostore_free_registry_entry(entry);
+		free(entry);
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	}
+
+	return OPH_IOSTORAGE_SUCCESS;
+}
+
+int oph_iostore_load_devices()
+{
+	//If already executed don't procede further
+	if (oph_iostore_registry)
+		return OPH_IOSTORAGE_SUCCESS;
+
+	FILE *fp = NULL;
+	char line[OPH_IOSTORAGE_BUFLEN] = { '\0' };
+	char device[OPH_IOSTORAGE_BUFLEN] = { '\0' };
+	char lib[OPH_IOSTORAGE_BUFLEN] = { '\0' };
+	char dyn_lib_str[OPH_IOSTORAGE_BUFLEN] = { '\0' };
+
+	snprintf(dyn_lib_str, sizeof(dyn_lib_str), OPH_SERVER_DEVICE_FILE_PATH);
+
+	fp = fopen(dyn_lib_str, "r");
+	if (!fp) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_FILE_NOT_FOUND, dyn_lib_str);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_FILE_NOT_FOUND, dyn_lib_str);
+		return OPH_IOSTORAGE_LIB_NOT_FOUND;
+	}
+
+	pthread_mutex_lock(&libtool_lock);
+	if (lt_dlinit() != 0) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_DLINIT_ERROR, lt_dlerror());
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_DLINIT_ERROR, lt_dlerror());
+		pthread_mutex_unlock(&libtool_lock);
+		fclose(fp);
+		return OPH_IOSTORAGE_DLINIT_ERR;
+	}
+
+	if (!(oph_iostore_registry = oph_server_hashmap_create(OPH_IOSTORAGE_REGISTRY_SIZE, OPH_SERVER_HASHMAP_BORROW_KEYS))) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+		lt_dlexit();
+		pthread_mutex_unlock(&libtool_lock);
+		fclose(fp);
+		return OPH_IOSTORAGE_MEMORY_ERR;
+	}
+
+	int res = OPH_IOSTORAGE_SUCCESS;
+	while (fgets(line, OPH_IOSTORAGE_BUFLEN, fp)) {
+		//Each device is described by its name in brackets followed by the library path
+		if (sscanf(line, "[%[^]]", device) < 1)
+			continue;
+		if (!fgets(line, OPH_IOSTORAGE_BUFLEN, fp) || (sscanf(line, "%[^\n]", lib) < 1)) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_READ_LINE_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_READ_LINE_ERROR);
+			res = OPH_IOSTORAGE_LIB_NOT_FOUND;
+			break;
+		}
+		if ((res = _oph_iostore_register_device(device, lib)))
+			break;
+		pmesg(LOG_DEBUG, __FILE__, __LINE__, "Device %s registered\n", device);
+	}
+	pthread_mutex_unlock(&libtool_lock);
+	fclose(fp);
+
+	if (res) {
+		oph_iostore_unload_devices();
+		return res;
+	}
+
+	return OPH_IOSTORAGE_SUCCESS;
+}
+
+int oph_iostore_unload_devices()
+{
+	if (!oph_iostore_registry)
+		return OPH_IOSTORAGE_SUCCESS;
+
+	unsigned long long iter = 0;
+	void *entry = NULL;
+
+	pthread_mutex_lock(&libtool_lock);
+	//Keys are the device names of the entries: entries are released by oph_server_hashmap_destroy
+	while (oph_server_hashmap_next(oph_iostore_registry, &iter, NULL, &entry))
+		_oph_iostore_free_registry_entry((oph_iostore_handler *) entry);
+	oph_server_hashmap_destroy(oph_iostore_registry);
+	oph_iostore_registry = NULL;
+
+	if (lt_dlexit()) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_DLEXIT_ERROR, lt_dlerror());
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_DLEXIT_ERROR, lt_dlerror());
+		pthread_mutex_unlock(&libtool_lock);
+		return OPH_IOSTORAGE_DLEXIT_ERR;
+	}
+	pthread_mutex_unlock(&libtool_lock);
+
+	return OPH_IOSTORAGE_SUCCESS;
+}
+
 int oph_iostore_setup(const char *device, oph_iostore_handler ** handle)
 {
 	if (!handle) {
@@ -57,6 +263,45 @@ int oph_iostore_setup(const char *device, oph_iostore_handler ** handle)
 	if ((*handle) && (*handle)->dlh)
 		return OPH_IOSTORAGE_SUCCESS;
 
+	int i = 0;
+
+	//Use the registered device, if available
+	if (oph_iostore_registry) {
+		if (!device) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_NULL_INPUT_PARAM);
+			return OPH_IOSTORAGE_NULL_PARAM;
+		}
+		char device_name[OPH_IOSTORAGE_BUFLEN] = { '\0' };
+		for (i = 0; device[i] && (i < OPH_IOSTORAGE_BUFLEN - 1); i++)
+			device_name[i] = tolower(device[i]);
+
+		oph_iostore_handler *entry = (oph_iostore_handler *) oph_server_hashmap_get(oph_iostore_registry, device_name);
+		if (!entry) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_LIB_NOT_FOUND);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_LIB_NOT_FOUND);
+			return OPH_IOSTORAGE_LIB_NOT_FOUND;
+		}
+
+		oph_iostore_handler *shared_handle = (oph_iostore_handler *) malloc(sizeof(oph_iostore_handler));
+		if (shared_handle == NULL) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
+			return OPH_IOSTORAGE_MEMORY_ERR;
+		}
+		//Device name, library and functions are owned by the registry
+		*shared_handle = *entry;
+		shared_handle->connection = NULL;
+
+		int res;
+		if ((res = shared_handle->functions->setup(shared_handle))) {
+			free(shared_handle);
+			return res;
+		}
+		*handle = shared_handle;
+		return OPH_IOSTORAGE_SUCCESS;
+	}
+
 	oph_iostore_handler *internal_handle = (oph_iostore_handler *) malloc(sizeof(oph_iostore_handler));
 	if (internal_handle == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_MEMORY_ERROR);
@@ -67,6 +312,8 @@ int oph_iostore_setup(const char *device, oph_iostore_handler ** handle)
 	internal_handle->device = NULL;
 	internal_handle->lib = NULL;
 	internal_handle->dlh = NULL;
+	internal_handle->connection = NULL;
+	internal_handle->functions = NULL;
 
 	//Set storage device type
 	internal_handle->device = (char *) strndup(device, strlen(device));
@@ -77,7 +324,6 @@ int oph_iostore_setup(const char *device, oph_iostore_handler ** handle)
 		return OPH_IOSTORAGE_MEMORY_ERR;
 	}
 	//Convert device name to lower case
-	int i = 0;
 	while (device[i]) {
 		internal_handle->device[i] = tolower(device[i]);
 		i++;
@@ -145,6 +391,19 @@ int oph_iostore_cleanup(oph_iostore_handler * handle)
 		return OPH_IOSTORAGE_DLOPEN_ERR;
 	}
 
+	int res;
+
+	//Registered devices are released with the registry
+	if (handle->functions) {
+		if ((res = handle->functions->cleanup(handle))) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_RELEASE_RES_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_RELEASE_RES_ERROR);
+			return res;
+		}
+		free(handle);
+		return res;
+	}
+
 	char func_name[OPH_IOSTORAGE_BUFLEN] = { '\0' };
 	snprintf(func_name, OPH_IOSTORAGE_BUFLEN, OPH_IOSTORAGE_CLEANUP_FUNC, handle->device);
 
@@ -158,7 +417,6 @@ int oph_iostore_cleanup(oph_iostore_handler * handle)
 	pthread_mutex_unlock(&libtool_lock);
 
 	//Release device resources
-	int res;
 	if ((res = _DEVICE_cleanup(handle))) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_RELEASE_RES_ERROR);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IOSTORAGE_LOG_RELEASE_RES_ERROR);
@@ -213,6 +471,9 @@ int oph_iostore_get_db(oph_iostore_handler * handle, oph_iostore_resource_id * r
 		return OPH_IOSTORAGE_DLOPEN_ERR;
 	}
 
+	if (handle->functions)
+		return handle->functions->get_db(handle, res_id, db_record);
+
 	char func_name[OPH_IOSTORAGE_BUFLEN] = { '\0' };
 	snprintf(func_name, OPH_IOSTORAGE_BUFLEN, OPH_IOSTORAGE_GET_DB_FUNC, handle->device);
 
@@ -242,6 +503,9 @@ int oph_iostore_put_db(oph_iostore_handler * handle, oph_iostore_db_record_set *
 		return OPH_IOSTORAGE_DLOPEN_ERR;
 	}
 
+	if (handle->functions)
+		return handle->functions->put_db(handle, db_record, res_id);
+
 	char func_name[OPH_IOSTORAGE_BUFLEN] = { '\0' };
 	snprintf(func_name, OPH_IOSTORAGE_BUFLEN, OPH_IOSTORAGE_PUT_DB_FUNC, handle->device);
 
@@ -271,6 +535,9 @@ int oph_iostore_delete_db(oph_iostore_handler * handle, oph_iostore_resource_id
 		return OPH_IOSTORAGE_DLOPEN_ERR;
 	}
 
+	if (handle->functions)
+		return handle->functions->delete_db(handle, res_id);
+
 	char func_name[OPH_IOSTORAGE_BUFLEN] = { '\0' };
 	snprintf(func_name, OPH_IOSTORAGE_BUFLEN, OPH_IOSTORAGE_DELETE_DB_FUNC, handle->device);
 
@@ -300,6 +567,9 @@ int oph_iostore_get_frag(oph_iostore_handler * handle, oph_iostore_resource_id *
 		return OPH_IOSTORAGE_DLOPEN_ERR;
 	}
 
+	if (handle->functions)
+		return handle->functions->get_frag(handle, res_id, frag_record);
+
 	char func_name[OPH_IOSTORAGE_BUFLEN] = { '\0' };
 	snprintf(func_name, OPH_IOSTORAGE_BUFLEN, OPH_IOSTORAGE_GET_FRAG_FUNC, handle->device);
 
@@ -329,6 +599,9 @@ int oph_iostore_put_frag(oph_iostore_handler * handle, oph_iostore_frag_record_s
 		return OPH_IOSTORAGE_DLOPEN_ERR;
 	}
 
+	if (handle->functions)
+		return handle->functions->put_frag(handle, frag_record, res_id);
+
 	char func_name[OPH_IOSTORAGE_BUFLEN] = { '\0' };
 	snprintf(func_name, OPH_IOSTORAGE_BUFLEN, OPH_IOSTORAGE_PUT_FRAG_FUNC, handle->device);
 
@@ -358,6 +631,9 @@ int oph_iostore_delete_frag(oph_iostore_handler * handle, oph_iostore_resource_i
 		return OPH_IOSTORAGE_DLOPEN_ERR;
 	}
 
+	if (handle->functions)
+		return handle->functions->delete_frag(handle, res_id);
+
 	char func_name[OPH_IOSTORAGE_BUFLEN] = { '\0' };
 	snprintf(func_name, OPH_IOSTORAGE_BUFLEN, OPH_IOSTORAGE_DELETE_FRAG_FUNC, handle->device);
 
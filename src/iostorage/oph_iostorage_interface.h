@@ -40,6 +40,30 @@
 
 //****************Handle******************//
 
+typedef struct _oph_iostore_handler oph_iostore_handler;
+
+/**
+ * \brief                 Structure with device functions resolved once when the device registry is loaded
+ * \param setup           Function to initialize storage library
+ * \param cleanup         Function to finalize storage library
+ * \param get_db          Function to retrieve a DB record
+ * \param put_db          Function to insert a DB record
+ * \param delete_db       Function to delete a DB
+ * \param get_frag        Function to retrieve a fragment record
+ * \param put_frag        Function to insert a fragment record
+ * \param delete_frag     Function to delete a fragment
+ */
+typedef struct {
+	int (*setup) (oph_iostore_handler * handle);
+	int (*cleanup) (oph_iostore_handler * handle);
+	int (*get_db) (oph_iostore_handler * handle, oph_iostore_resource_id * res_id, oph_iostore_db_record_set ** db_record);
+	int (*put_db) (oph_iostore_handler * handle, oph_iostore_db_record_set * db_record, oph_iostore_resource_id ** res_id);
+	int (*delete_db) (oph_iostore_handler * handle, oph_iostore_resource_id * res_id);
+	int (*get_frag) (oph_iostore_handler * handle, oph_iostore_resource_id * res_id, oph_iostore_frag_record_set ** frag_record);
+	int (*put_frag) (oph_iostore_handler * handle, oph_iostore_frag_record_set * frag_record, oph_iostore_resource_id ** res_id);
+	int (*delete_frag) (oph_iostore_handler * handle, oph_iostore_resource_id * res_id);
+} oph_iostore_device_functions;
+
 /**
  * \brief                 Handle structure with dynamic storage device library parameters
  * \param device          Name of storage device used within the server
@@ -47,14 +71,16 @@
  * \param lib             Dynamic library path
  * \param dlh             Libtool handler to dynamic library
  * \param connection      Variable to hold generic storage device connection status info
+ * \param functions       Device functions shared through the device registry (NULL if the handle loaded the library by itself)
  */
-typedef struct {
+struct _oph_iostore_handler {
 	char *device;
 	short unsigned int is_persistent;
 	char *lib;
 	void *dlh;
 	void *connection;
-} oph_iostore_handler;
+	const oph_iostore_device_functions *functions;
+};
 
 //****************Plugin Interface******************//
 
@@ -84,8 +110,22 @@ extern int (*_DEVICE_delete_frag) (oph_iostore_handler * handle, oph_iostore_res
 
 //*****************Internal Functions (used by query engine library)***************//
 
+/**
+ * \brief               Function to load every device listed in the device file, resolving its functions once. It should be called at server startup, before any thread is created.
+ *                      Handles set up afterwards share the registry entries without further dynamic loading.
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_iostore_load_devices();
+
+/**
+ * \brief               Function to release the device registry and close the related libraries. It should be called when no handle is in use.
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_iostore_unload_devices();
+
 /**
  * \brief               Function to initialize data storage library. This function should be called before any other function to initialize the dynamic library.
+ *                      If the device registry is loaded, the handle refers to the registered device and no library is loaded.
  * \param device        String with the name of storage device plugin to use
  * \param handle        Address to pointer for dynamic device plugin handle
  * \return              0 if successfull, non-0 otherwise
@@ -72,7 +72,7 @@ int main(int argc, char *argv[])
 		pmesg(LOG_INFO, __FILE__, __LINE__, "Using default (first) instance in configuration file\n");
 	}
 
-	HASHTBL *conf_db = NULL;
+	oph_server_hashmap *conf_db = NULL;
 
 	//Load params from conf files
 	if (oph_server_conf_load(instance, &conf_db)) {
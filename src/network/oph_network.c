@@ -20,6 +20,8 @@
 
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -57,6 +59,157 @@ ssize_t oph_net_readn(int fd, void *buffer, size_t n)
 	return (n - nleft);	/* return >= 0 */
 }
 
+int oph_net_reader_create(int fd, size_t size, oph_net_reader ** reader)
+{
+	if (!reader)
+		return OPH_NETWORK_ERROR;
+	*reader = NULL;
+
+	oph_net_reader *tmp = (oph_net_reader *) malloc(sizeof(oph_net_reader));
+	if (!tmp)
+		return OPH_NETWORK_ERROR;
+
+	tmp->size = size ? size : OPH_NET_READER_BUFFER_SIZE;
+	tmp->buffer = (char *) malloc(tmp->size);
+	if (!tmp->buffer) {
+		free(tmp);
+		return OPH_NETWORK_ERROR;
+	}
+	tmp->fd = fd;
+	tmp->head = tmp->tail = 0;
+
+	*reader = tmp;
+	return OPH_NETWORK_SUCCESS;
+}
+
+void oph_net_reader_destroy(oph_net_reader ** reader)
+{
+	if (!reader || !*reader)
+		return;
+
+	free((*reader)->buffer);
+	free(*reader);
+	*reader = NULL;
+}
+
+/* Read "n" bytes through a buffered reader. */
+ssize_t oph_net_reader_readn(oph_net_reader * reader, void *buffer, size_t n)
+{
+	size_t nleft, navail;
+	ssize_t nread;
+	char *ptr;
+
+	ptr = buffer;
+	nleft = n;
+	while (nleft > 0) {
+		navail = reader->tail - reader->head;
+		if (navail > 0) {
+			/* Consume buffered data first */
+			if (navail > nleft)
+				navail = nleft;
+			memcpy(ptr, reader->buffer + reader->head, navail);
+			reader->head += navail;
+			nleft -= navail;
+			ptr += navail;
+			continue;
+		}
+		reader->head = reader->tail = 0;
+
+		if (nleft >= reader->size) {
+			/* Large payloads are read directly into the destination */
+			if ((nread = read(reader->fd, ptr, nleft)) < 0) {
+				if (errno == EINTR)
+					continue;	/* and call read() again */
+				return OPH_NETWORK_ERROR;
+			} else if (nread == 0)
+				break;	/* EOF */
+			nleft -= nread;
+			ptr += nread;
+		} else {
+			/* Refill the buffer with all the data available */
+			if ((nread = read(reader->fd, reader->buffer, reader->size)) < 0) {
+				if (errno == EINTR)
+					continue;	/* and call read() again */
+				return OPH_NETWORK_ERROR;
+			} else if (nread == 0)
+				break;	/* EOF */
+			reader->tail = nread;
+		}
+	}
+	return (n - nleft);	/* return >= 0 */
+}
+
+size_t oph_net_reader_pending(oph_net_reader * reader)
+{
+	return reader ? reader->tail - reader->head : 0;
+}
+
+/* Read without blocking the data available into the buffer of a reader. */
+ssize_t oph_net_reader_fill(oph_net_reader * reader, size_t n)
+{
+	ssize_t nread;
+
+	if (!reader)
+		return OPH_NETWORK_ERROR;
+
+	/* Move pending data to the beginning of the buffer and enlarge it to hold n bytes */
+	if (reader->head && ((reader->size - reader->head < n) || (reader->tail == reader->size))) {
+		memmove(reader->buffer, reader->buffer + reader->head, reader->tail - reader->head);
+		reader->tail -= reader->head;
+		reader->head = 0;
+	}
+	if (reader->size < n) {
+		char *tmp = (char *) realloc(reader->buffer, n);
+		if (!tmp)
+			return OPH_NETWORK_ERROR;
+		reader->buffer = tmp;
+		reader->size = n;
+	}
+	if (reader->tail == reader->size)
+		return 0;
+
+	while ((nread = recv(reader->fd, reader->buffer + reader->tail, reader->size - reader->tail, MSG_DONTWAIT)) < 0) {
+		if (errno == EINTR)
+			continue;	/* and call recv() again */
+		if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+			return 0;
+		return OPH_NETWORK_ERROR;
+	}
+	if (nread == 0)
+		return OPH_NETWORK_EOF;
+	reader->tail += nread;
+
+	return nread;
+}
+
+/* Write all the buffers of an iovec array to a descriptor. */
+ssize_t oph_net_writevn(int fd, struct iovec *iov, int iovcnt)
+{
+	ssize_t nwritten;
+	size_t total = 0;
+
+	while (iovcnt > 0) {
+		if ((nwritten = writev(fd, iov, iovcnt)) < 0) {
+			if (errno == EINTR)
+				continue;	/* and call writev() again */
+			return OPH_NETWORK_ERROR;
+		}
+		total += nwritten;
+
+		/* Skip buffers completely written and move within the partially written one */
+		while (iovcnt > 0 && (size_t) nwritten >= iov->iov_len) {
+			nwritten -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt > 0) {
+			iov->iov_base = (char *) iov->iov_base + nwritten;
+			iov->iov_len -= nwritten;
+		}
+	}
+	return total;
+}
+
 int oph_net_connect(const char *host, const char *port, int *fd)
 {
 	/* Adapted from Stevens et al. UNP Vol. 1, 3rd Ed. source code - http://www.unpbook.com/src.html */
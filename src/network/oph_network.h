@@ -22,8 +22,28 @@
 // error codes
 #define OPH_NETWORK_SUCCESS                             0
 #define OPH_NETWORK_ERROR                              -1
+#define OPH_NETWORK_EOF                                -2
 
 #include <netdb.h>
+#include <sys/uio.h>
+
+#define OPH_NET_READER_BUFFER_SIZE                      65536
+
+/**
+ * \brief               Structure of a buffered reader used to parse frames from a socket with few read syscalls
+ * \param fd            Socket being read
+ * \param buffer        Buffer of data already read from socket
+ * \param size          Size of the buffer
+ * \param head          Offset of the first byte not yet consumed
+ * \param tail          Offset of the end of data available in the buffer
+ */
+typedef struct _oph_net_reader {
+	int fd;
+	char *buffer;
+	size_t size;
+	size_t head;
+	size_t tail;
+} oph_net_reader;
 
 // Prototypes
 
@@ -36,6 +56,54 @@
  */
 ssize_t oph_net_readn(int fd, void *buffer, size_t n);
 
+/**
+ * \brief               Function to create a buffered reader for a socket
+ * \param fd            Socket to be read
+ * \param size          Size of the internal buffer (0 for default size)
+ * \param reader        Pointer to the reader to be created
+ * \return              0 if successfull, -1 otherwise
+ */
+int oph_net_reader_create(int fd, size_t size, oph_net_reader ** reader);
+
+/**
+ * \brief               Function to release a buffered reader (the socket is not closed)
+ * \param reader        Pointer to the reader to be released
+ */
+void oph_net_reader_destroy(oph_net_reader ** reader);
+
+/**
+ * \brief               Function to read n bytes through a buffered reader: data is read from socket in large chunks and large payloads are read directly into the destination
+ * \param reader        Reader to be used
+ * \param buffer        Buffer for result read
+ * \param n             Number of bytes being read
+ * \return              number of bytes read if successfull (less than n only on EOF), -1 otherwise
+ */
+ssize_t oph_net_reader_readn(oph_net_reader * reader, void *buffer, size_t n);
+
+/**
+ * \brief               Function to get the number of bytes already buffered and not yet consumed
+ * \param reader        Reader to be checked
+ * \return              number of bytes available
+ */
+size_t oph_net_reader_pending(oph_net_reader * reader);
+
+/**
+ * \brief               Function to read without blocking the data available on socket into the buffer of a reader
+ * \param reader        Reader to be filled
+ * \param n             Number of pending bytes the buffer has to be able to hold (the buffer is enlarged if needed)
+ * \return              number of bytes read (0 if no data is available), OPH_NETWORK_EOF if the connection has been closed, OPH_NETWORK_ERROR otherwise
+ */
+ssize_t oph_net_reader_fill(oph_net_reader * reader, size_t n);
+
+/**
+ * \brief               Function to write all the buffers described by an iovec array to socket (partial writes are resumed)
+ * \param fd            Socket being written
+ * \param iov           Array of buffers to be written (it is modified by the function)
+ * \param iovcnt        Number of buffers in the array
+ * \return              number of bytes written if successfull, -1 otherwise
+ */
+ssize_t oph_net_writevn(int fd, struct iovec *iov, int iovcnt);
+
 /**
  * \brief               Function to connect to hostname:port 
  * \param host          Server hostname
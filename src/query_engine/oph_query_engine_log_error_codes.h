@@ -39,6 +39,7 @@
 #define OPH_QUERY_ENGINE_LOG_HASHTBL_CREATE_ERROR   "Unable to create hash table\n"
 #define OPH_QUERY_ENGINE_LOG_QUERY_ARG_LOAD_ERROR   "Unable to load query args in table\n"
 #define OPH_QUERY_ENGINE_LOG_PLUGIN_EXEC_ERROR      "Error while executing %s\n"
+#define OPH_QUERY_ENGINE_LOG_PLUGIN_LIB_ERROR       "Unable to load library of plugin %s: %s\n"
 #define OPH_QUERY_ENGINE_LOG_ARG_PARSING_ERROR    	"Unable to parse argument %s\n"
 #define OPH_QUERY_ENGINE_LOG_NO_STRING   			"Argument %s is not a valid string\n"
 
@@ -0,0 +1,653 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "oph_query_expression_compiler.h"
+#include "oph_query_engine_log_error_codes.h"
+#include "oph_query_plugin_loader.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <debug.h>
+
+//Global
+extern int msglevel;
+extern oph_query_expr_symtable *oph_function_table;
+extern oph_server_hashmap *plugin_table;
+
+static int _oph_query_expr_count_instructions(oph_query_expr_node * e)
+{
+	if (e == NULL)
+		return 0;
+	//Argument list nodes are not translated into instructions
+	return (e->type == eARG ? 0 : 1) + _oph_query_expr_count_instructions(e->left) + _oph_query_expr_count_instructions(e->right);
+}
+
+static void _oph_query_expr_free_args(oph_query_expr_value * args, int arg_num)
+{
+	//Remove intermediate computed values
+	int i;
+	for (i = 0; i < arg_num; i++) {
+		if (args[i].free_flag) {
+			switch (args[i].type) {
+				case OPH_QUERY_EXPR_TYPE_STRING:
+#ifdef PLUGIN_RES_COPY
+					free(args[i].data.string_value);
+#endif
+					break;
+				case OPH_QUERY_EXPR_TYPE_BINARY:
+#ifdef PLUGIN_RES_COPY
+					free(args[i].data.binary_value->arg);
+#endif
+					free(args[i].data.binary_value);
+					break;
+				case OPH_QUERY_EXPR_TYPE_DOUBLE:
+				case OPH_QUERY_EXPR_TYPE_LONG:
+				case OPH_QUERY_EXPR_TYPE_NULL:
+					break;
+			}
+		}
+	}
+}
+
+//Emit the instructions of a subtree in post-order: return the register of the subtree result or -1 in case of error
+static int _oph_query_expr_emit(oph_query_expr_node * e, char **var_list, int var_count, oph_query_expr_symtable * table, oph_query_expr_program * program)
+{
+	oph_query_expr_instruction *instr = NULL;
+	int left = -1, right = -1, i;
+
+	switch (e->type) {
+		case eVALUE:
+		case eSTRING:
+			instr = &(program->code[program->code_size]);
+			instr->opcode = OPH_QUERY_EXPR_OP_CONST;
+			instr->value = e->value;
+			return program->code_size++;
+		case eVAR:
+			for (i = 0; i < var_count; i++)
+				if (!strcmp(var_list[i], e->name))
+					break;
+			if (i == var_count) {
+				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_UNKNOWN_SYMBOL, e->name);
+				logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_UNKNOWN_SYMBOL, e->name);
+				return -1;
+			}
+			instr = &(program->code[program->code_size]);
+			instr->opcode = OPH_QUERY_EXPR_OP_VAR;
+			instr->left = i;
+			return program->code_size++;
+		case eFUN:
+			{
+				oph_query_expr_record *r = oph_query_expr_lookup(e->name, oph_function_table);
+				if (r == NULL)
+					r = oph_query_expr_lookup(e->name, table);
+				if (r == NULL || r->type != 2) {
+					pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_UNKNOWN_SYMBOL, e->name);
+					logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_UNKNOWN_SYMBOL, e->name);
+					return -1;
+				}
+
+				int arg_num = 0;
+				oph_query_expr_node *cur = NULL;
+				for (cur = e->left; cur; cur = cur->right)
+					arg_num++;
+				if ((!r->fun_type && arg_num != r->numArgs) || (r->fun_type && arg_num < r->numArgs)) {
+					pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_ARG_NUM_ERROR, e->name, r->numArgs);
+					logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_ARG_NUM_ERROR, e->name, r->numArgs);
+					return -1;
+				}
+
+				int *args = (int *) malloc((arg_num ? arg_num : 1) * sizeof(int));
+				oph_query_expr_value *arg_values = (oph_query_expr_value *) calloc((arg_num ? arg_num : 1), sizeof(oph_query_expr_value));
+				if (!args || !arg_values) {
+					pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_MEMORY_ALLOC_ERROR);
+					logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_MEMORY_ALLOC_ERROR);
+					if (args)
+						free(args);
+					if (arg_values)
+						free(arg_values);
+					return -1;
+				}
+				//Argument list is stored in reverse order
+				for (cur = e->left, i = arg_num - 1; cur; cur = cur->right, i--) {
+					if ((args[i] = _oph_query_expr_emit(cur->left, var_list, var_count, table, program)) < 0) {
+						free(args);
+						free(arg_values);
+						return -1;
+					}
+				}
+
+				instr = &(program->code[program->code_size]);
+				instr->opcode = OPH_QUERY_EXPR_OP_FUN;
+				instr->function = r;
+				instr->node = e;
+				instr->args = args;
+				instr->arg_values = arg_values;
+				instr->arg_num = arg_num;
+				return program->code_size++;
+			}
+		case eNEG:
+		case eNOT:
+			if ((right = _oph_query_expr_emit(e->right, var_list, var_count, table, program)) < 0)
+				return -1;
+			instr = &(program->code[program->code_size]);
+			instr->opcode = (e->type == eNEG ? OPH_QUERY_EXPR_OP_NEG : OPH_QUERY_EXPR_OP_NOT);
+			instr->right = right;
+			return program->code_size++;
+		case eMULTIPLY:
+		case ePLUS:
+		case eMINUS:
+		case eDIVIDE:
+		case eEQUAL:
+		case eMOD:
+		case eAND:
+		case eOR:
+			if ((left = _oph_query_expr_emit(e->left, var_list, var_count, table, program)) < 0)
+				return -1;
+			if ((right = _oph_query_expr_emit(e->right, var_list, var_count, table, program)) < 0)
+				return -1;
+			instr = &(program->code[program->code_size]);
+			switch (e->type) {
+				case eMULTIPLY:
+					instr->opcode = OPH_QUERY_EXPR_OP_MULTIPLY;
+					break;
+				case ePLUS:
+					instr->opcode = OPH_QUERY_EXPR_OP_PLUS;
+					break;
+				case eMINUS:
+					instr->opcode = OPH_QUERY_EXPR_OP_MINUS;
+					break;
+				case eDIVIDE:
+					instr->opcode = OPH_QUERY_EXPR_OP_DIVIDE;
+					break;
+				case eEQUAL:
+					instr->opcode = OPH_QUERY_EXPR_OP_EQUAL;
+					break;
+				case eMOD:
+					instr->opcode = OPH_QUERY_EXPR_OP_MOD;
+					break;
+				case eAND:
+					instr->opcode = OPH_QUERY_EXPR_OP_AND;
+					break;
+				default:
+					instr->opcode = OPH_QUERY_EXPR_OP_OR;
+			}
+			instr->left = left;
+			instr->right = right;
+			return program->code_size++;
+		default:
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
+			return -1;
+	}
+}
+
+int oph_query_expr_compile(oph_query_expr_node * e, char **var_list, int var_count, oph_query_expr_symtable * table, oph_query_expr_program ** program)
+{
+	if (e == NULL || program == NULL || (var_count > 0 && var_list == NULL)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		return OPH_QUERY_ENGINE_NULL_PARAM;
+	}
+	*program = NULL;
+
+	int size = _oph_query_expr_count_instructions(e);
+
+	oph_query_expr_program *p = (oph_query_expr_program *) calloc(1, sizeof(oph_query_expr_program));
+	if (p == NULL) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_MEMORY_ALLOC_ERROR);
+		return OPH_QUERY_ENGINE_MEMORY_ERROR;
+	}
+	p->code = (oph_query_expr_instruction *) calloc(size, sizeof(oph_query_expr_instruction));
+	p->registers = (oph_query_expr_value *) calloc(size, sizeof(oph_query_expr_value));
+	p->vars = (oph_query_expr_value *) calloc((var_count ? var_count : 1), sizeof(oph_query_expr_value));
+	p->columns = (oph_query_expr_column *) calloc(size, sizeof(oph_query_expr_column));
+	p->var_columns = (oph_query_expr_column *) calloc((var_count ? var_count : 1), sizeof(oph_query_expr_column));
+	p->var_num = var_count;
+	if (p->code == NULL || p->registers == NULL || p->vars == NULL || p->columns == NULL || p->var_columns == NULL) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_MEMORY_ALLOC_ERROR);
+		oph_query_expr_destroy_program(p);
+		return OPH_QUERY_ENGINE_MEMORY_ERROR;
+	}
+
+	int i;
+	for (i = 0; i < var_count; i++) {
+		p->vars[i].type = OPH_QUERY_EXPR_TYPE_NULL;
+		p->var_columns[i].type = OPH_QUERY_EXPR_TYPE_NULL;
+	}
+
+	if (_oph_query_expr_emit(e, var_list, var_count, table, p) < 0) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
+		oph_query_expr_destroy_program(p);
+		return OPH_QUERY_ENGINE_PARSE_ERROR;
+	}
+
+	*program = p;
+	return OPH_QUERY_ENGINE_SUCCESS;
+}
+
+int oph_query_expr_destroy_program(oph_query_expr_program * program)
+{
+	if (program == NULL) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		return OPH_QUERY_ENGINE_NULL_PARAM;
+	}
+
+	int i;
+	if (program->code) {
+		for (i = 0; i < program->code_size; i++) {
+			if (program->code[i].args)
+				free(program->code[i].args);
+			if (program->code[i].arg_values)
+				free(program->code[i].arg_values);
+		}
+		free(program->code);
+	}
+	if (program->registers)
+		free(program->registers);
+	if (program->vars)
+		free(program->vars);
+	if (program->columns)
+		free(program->columns);
+	if (program->var_columns)
+		free(program->var_columns);
+	if (program->long_buffer)
+		free(program->long_buffer);
+	if (program->double_buffer)
+		free(program->double_buffer);
+	free(program);
+
+	return OPH_QUERY_ENGINE_SUCCESS;
+}
+
+int oph_query_expr_has_aggregate(oph_query_expr_program * program)
+{
+	if (program == NULL)
+		return 0;
+
+	int i;
+	oph_plugin *plugin = NULL;
+	for (i = 0; i < program->code_size; i++) {
+		if (program->code[i].opcode != OPH_QUERY_EXPR_OP_FUN || !plugin_table)
+			continue;
+		plugin = (oph_plugin *) oph_server_hashmap_get(plugin_table, program->code[i].node->name);
+		if (plugin && plugin->plugin_type == OPH_AGGREGATE_PLUGIN_TYPE)
+			return 1;
+	}
+
+	return 0;
+}
+
+int oph_query_expr_set_long(oph_query_expr_program * program, int slot, long long value)
+{
+	if (program == NULL || slot < 0 || slot >= program->var_num) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		return OPH_QUERY_ENGINE_NULL_PARAM;
+	}
+
+	program->vars[slot].type = OPH_QUERY_EXPR_TYPE_LONG;
+	program->vars[slot].data.long_value = value;
+	return OPH_QUERY_ENGINE_SUCCESS;
+}
+
+int oph_query_expr_set_double(oph_query_expr_program * program, int slot, double value)
+{
+	if (program == NULL || slot < 0 || slot >= program->var_num) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		return OPH_QUERY_ENGINE_NULL_PARAM;
+	}
+
+	program->vars[slot].type = OPH_QUERY_EXPR_TYPE_DOUBLE;
+	program->vars[slot].data.double_value = value;
+	return OPH_QUERY_ENGINE_SUCCESS;
+}
+
+int oph_query_expr_set_binary(oph_query_expr_program * program, int slot, oph_query_arg * value)
+{
+	if (program == NULL || slot < 0 || slot >= program->var_num) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		return OPH_QUERY_ENGINE_NULL_PARAM;
+	}
+
+	program->vars[slot].type = OPH_QUERY_EXPR_TYPE_BINARY;
+	program->vars[slot].data.binary_value = value;
+	return OPH_QUERY_ENGINE_SUCCESS;
+}
+
+int oph_query_expr_run_program(oph_query_expr_program * program, oph_query_expr_value * res)
+{
+	if (program == NULL || res == NULL || !program->code_size) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		return OPH_QUERY_ENGINE_NULL_PARAM;
+	}
+
+	oph_query_expr_instruction *instr = NULL;
+	oph_query_expr_value *reg = program->registers, *out = NULL;
+	double l = 0, r = 0;
+	int pc, i, er = 0;
+	char jump_flag;
+
+	for (pc = 0; pc < program->code_size; pc++) {
+		instr = &(program->code[pc]);
+		out = &(reg[pc]);
+		out->free_flag = 0;
+		out->jump_flag = 0;
+
+		switch (instr->opcode) {
+			case OPH_QUERY_EXPR_OP_CONST:
+				*out = instr->value;
+				break;
+			case OPH_QUERY_EXPR_OP_VAR:
+				*out = program->vars[instr->left];
+				break;
+			case OPH_QUERY_EXPR_OP_MULTIPLY:
+				l = get_double_value(reg[instr->left], &er, "*");
+				r = get_double_value(reg[instr->right], &er, "*");
+				out->type = OPH_QUERY_EXPR_TYPE_DOUBLE;
+				out->data.double_value = l * r;
+				break;
+			case OPH_QUERY_EXPR_OP_PLUS:
+				l = get_double_value(reg[instr->left], &er, "+");
+				r = get_double_value(reg[instr->right], &er, "+");
+				out->type = OPH_QUERY_EXPR_TYPE_DOUBLE;
+				out->data.double_value = l + r;
+				break;
+			case OPH_QUERY_EXPR_OP_MINUS:
+				l = get_double_value(reg[instr->left], &er, "-");
+				r = get_double_value(reg[instr->right], &er, "-");
+				out->type = OPH_QUERY_EXPR_TYPE_DOUBLE;
+				out->data.double_value = l - r;
+				break;
+			case OPH_QUERY_EXPR_OP_DIVIDE:
+				l = get_double_value(reg[instr->left], &er, "/");
+				r = get_double_value(reg[instr->right], &er, "/");
+				out->type = OPH_QUERY_EXPR_TYPE_DOUBLE;
+				out->data.double_value = l / r;
+				break;
+			case OPH_QUERY_EXPR_OP_EQUAL:
+				l = get_double_value(reg[instr->left], &er, "=");
+				r = get_double_value(reg[instr->right], &er, "=");
+				out->type = OPH_QUERY_EXPR_TYPE_LONG;
+				out->data.long_value = (long long) (l == r);
+				break;
+			case OPH_QUERY_EXPR_OP_MOD:
+				l = get_double_value(reg[instr->left], &er, "MOD");
+				r = get_double_value(reg[instr->right], &er, "MOD");
+				out->type = OPH_QUERY_EXPR_TYPE_LONG;
+				out->data.long_value = ((int) l % (int) r);
+				break;
+			case OPH_QUERY_EXPR_OP_AND:
+				l = get_double_value(reg[instr->left], &er, "AND");
+				r = get_double_value(reg[instr->right], &er, "AND");
+				out->type = OPH_QUERY_EXPR_TYPE_LONG;
+				out->data.long_value = (long long) l && r;
+				break;
+			case OPH_QUERY_EXPR_OP_OR:
+				l = get_double_value(reg[instr->left], &er, "OR");
+				r = get_double_value(reg[instr->right], &er, "OR");
+				out->type = OPH_QUERY_EXPR_TYPE_LONG;
+				out->data.long_value = (long long) (l || r);
+				break;
+			case OPH_QUERY_EXPR_OP_NOT:
+				r = get_double_value(reg[instr->right], &er, "NOT");
+				out->type = OPH_QUERY_EXPR_TYPE_LONG;
+				out->data.long_value = (long long) !r;
+				break;
+			case OPH_QUERY_EXPR_OP_NEG:
+				r = get_double_value(reg[instr->right], &er, "NEG");
+				out->type = OPH_QUERY_EXPR_TYPE_DOUBLE;
+				out->data.double_value = -r;
+				break;
+			case OPH_QUERY_EXPR_OP_FUN:
+				jump_flag = 0;
+				for (i = 0; i < instr->arg_num; i++) {
+					instr->arg_values[i] = reg[instr->args[i]];
+					if (instr->arg_values[i].jump_flag)
+						jump_flag = 1;
+				}
+				if (jump_flag) {
+					//Values of aggregating functions are not ready yet
+					_oph_query_expr_free_args(instr->arg_values, instr->arg_num);
+					out->type = OPH_QUERY_EXPR_TYPE_DOUBLE;
+					out->data.double_value = 0;
+					out->jump_flag = 1;
+					break;
+				}
+				*out = instr->function->function(instr->arg_values, instr->arg_num, instr->node->name, &(instr->node->descriptor), 0, &er);
+				_oph_query_expr_free_args(instr->arg_values, instr->arg_num);
+				break;
+			default:
+				er = -1;
+		}
+
+		if (er == -1) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
+			return OPH_QUERY_ENGINE_PARSE_ERROR;
+		}
+	}
+
+	*res = reg[program->code_size - 1];
+	return OPH_QUERY_ENGINE_SUCCESS;
+}
+
+int oph_query_expr_is_batchable(oph_query_expr_program * program)
+{
+	if (program == NULL)
+		return 0;
+
+	int i;
+	for (i = 0; i < program->code_size; i++) {
+		if (program->code[i].opcode == OPH_QUERY_EXPR_OP_FUN)
+			return 0;
+		if (program->code[i].opcode == OPH_QUERY_EXPR_OP_CONST && program->code[i].value.type != OPH_QUERY_EXPR_TYPE_LONG
+		    && program->code[i].value.type != OPH_QUERY_EXPR_TYPE_DOUBLE)
+			return 0;
+	}
+
+	return 1;
+}
+
+int oph_query_expr_set_long_column(oph_query_expr_program * program, int slot, long long *values)
+{
+	if (program == NULL || values == NULL || slot < 0 || slot >= program->var_num) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		return OPH_QUERY_ENGINE_NULL_PARAM;
+	}
+
+	program->var_columns[slot].type = OPH_QUERY_EXPR_TYPE_LONG;
+	program->var_columns[slot].long_value = values;
+	return OPH_QUERY_ENGINE_SUCCESS;
+}
+
+int oph_query_expr_set_double_column(oph_query_expr_program * program, int slot, double *values)
+{
+	if (program == NULL || values == NULL || slot < 0 || slot >= program->var_num) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		return OPH_QUERY_ENGINE_NULL_PARAM;
+	}
+
+	program->var_columns[slot].type = OPH_QUERY_EXPR_TYPE_DOUBLE;
+	program->var_columns[slot].double_value = values;
+	return OPH_QUERY_ENGINE_SUCCESS;
+}
+
+//Return the values of a column register as doubles: long columns are converted into the double storage of the register, which is not used by them
+static double *_oph_query_expr_batch_double(oph_query_expr_program * program, int reg, int row_num)
+{
+	oph_query_expr_column *c = &(program->columns[reg]);
+	if (c->type == OPH_QUERY_EXPR_TYPE_DOUBLE)
+		return c->double_value;
+
+	double *restrict d = program->double_buffer + (size_t) reg * OPH_QUERY_EXPR_BATCH_SIZE;
+	const long long *restrict l = c->long_value;
+	int i;
+	for (i = 0; i < row_num; i++)
+		d[i] = (double) l[i];
+	return d;
+}
+
+int oph_query_expr_run_batch(oph_query_expr_program * program, int row_num, oph_query_expr_column ** res)
+{
+	if (program == NULL || res == NULL || !program->code_size || row_num <= 0 || row_num > OPH_QUERY_EXPR_BATCH_SIZE) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		return OPH_QUERY_ENGINE_NULL_PARAM;
+	}
+	*res = NULL;
+
+	if (!program->long_buffer) {
+		program->long_buffer = (long long *) malloc((size_t) program->code_size * OPH_QUERY_EXPR_BATCH_SIZE * sizeof(long long));
+		program->double_buffer = (double *) malloc((size_t) program->code_size * OPH_QUERY_EXPR_BATCH_SIZE * sizeof(double));
+		if (!program->long_buffer || !program->double_buffer) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_MEMORY_ALLOC_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_MEMORY_ALLOC_ERROR);
+			if (program->long_buffer)
+				free(program->long_buffer);
+			if (program->double_buffer)
+				free(program->double_buffer);
+			program->long_buffer = NULL;
+			program->double_buffer = NULL;
+			return OPH_QUERY_ENGINE_MEMORY_ERROR;
+		}
+	}
+
+	oph_query_expr_instruction *instr = NULL;
+	oph_query_expr_column *out = NULL;
+	const double *restrict l = NULL, *restrict r = NULL;
+	double *restrict d = NULL;
+	long long *restrict o = NULL;
+	int pc, i;
+
+	for (pc = 0; pc < program->code_size; pc++) {
+		instr = &(program->code[pc]);
+		out = &(program->columns[pc]);
+		o = program->long_buffer + (size_t) pc *OPH_QUERY_EXPR_BATCH_SIZE;
+		d = program->double_buffer + (size_t) pc *OPH_QUERY_EXPR_BATCH_SIZE;
+
+		switch (instr->opcode) {
+			case OPH_QUERY_EXPR_OP_CONST:
+				out->type = instr->value.type;
+				out->long_value = o;
+				out->double_value = d;
+				if (out->type == OPH_QUERY_EXPR_TYPE_LONG) {
+					for (i = 0; i < row_num; i++)
+						o[i] = instr->value.data.long_value;
+				} else if (out->type == OPH_QUERY_EXPR_TYPE_DOUBLE) {
+					for (i = 0; i < row_num; i++)
+						d[i] = instr->value.data.double_value;
+				} else {
+					pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
+					logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
+					return OPH_QUERY_ENGINE_PARSE_ERROR;
+				}
+				continue;
+			case OPH_QUERY_EXPR_OP_VAR:
+				if (program->var_columns[instr->left].type != OPH_QUERY_EXPR_TYPE_LONG && program->var_columns[instr->left].type != OPH_QUERY_EXPR_TYPE_DOUBLE) {
+					pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
+					logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
+					return OPH_QUERY_ENGINE_PARSE_ERROR;
+				}
+				*out = program->var_columns[instr->left];
+				continue;
+			case OPH_QUERY_EXPR_OP_FUN:
+				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
+				logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
+				return OPH_QUERY_ENGINE_PARSE_ERROR;
+			default:
+				break;
+		}
+
+		//Operands are evaluated as doubles, as done by the row by row evaluator
+		if (instr->opcode != OPH_QUERY_EXPR_OP_NEG && instr->opcode != OPH_QUERY_EXPR_OP_NOT)
+			l = _oph_query_expr_batch_double(program, instr->left, row_num);
+		r = _oph_query_expr_batch_double(program, instr->right, row_num);
+		out->long_value = o;
+		out->double_value = d;
+
+		switch (instr->opcode) {
+			case OPH_QUERY_EXPR_OP_MULTIPLY:
+				out->type = OPH_QUERY_EXPR_TYPE_DOUBLE;
+				for (i = 0; i < row_num; i++)
+					d[i] = l[i] * r[i];
+				break;
+			case OPH_QUERY_EXPR_OP_PLUS:
+				out->type = OPH_QUERY_EXPR_TYPE_DOUBLE;
+				for (i = 0; i < row_num; i++)
+					d[i] = l[i] + r[i];
+				break;
+			case OPH_QUERY_EXPR_OP_MINUS:
+				out->type = OPH_QUERY_EXPR_TYPE_DOUBLE;
+				for (i = 0; i < row_num; i++)
+					d[i] = l[i] - r[i];
+				break;
+			case OPH_QUERY_EXPR_OP_DIVIDE:
+				out->type = OPH_QUERY_EXPR_TYPE_DOUBLE;
+				for (i = 0; i < row_num; i++)
+					d[i] = l[i] / r[i];
+				break;
+			case OPH_QUERY_EXPR_OP_NEG:
+				out->type = OPH_QUERY_EXPR_TYPE_DOUBLE;
+				for (i = 0; i < row_num; i++)
+					d[i] = -r[i];
+				break;
+			case OPH_QUERY_EXPR_OP_EQUAL:
+				out->type = OPH_QUERY_EXPR_TYPE_LONG;
+				for (i = 0; i < row_num; i++)
+					o[i] = (l[i] == r[i]);
+				break;
+			case OPH_QUERY_EXPR_OP_MOD:
+				out->type = OPH_QUERY_EXPR_TYPE_LONG;
+				for (i = 0; i < row_num; i++)
+					o[i] = ((int) l[i] % (int) r[i]);
+				break;
+			case OPH_QUERY_EXPR_OP_AND:
+				out->type = OPH_QUERY_EXPR_TYPE_LONG;
+				for (i = 0; i < row_num; i++)
+					o[i] = ((l[i] != 0) & (r[i] != 0));
+				break;
+			case OPH_QUERY_EXPR_OP_OR:
+				out->type = OPH_QUERY_EXPR_TYPE_LONG;
+				for (i = 0; i < row_num; i++)
+					o[i] = ((l[i] != 0) | (r[i] != 0));
+				break;
+			case OPH_QUERY_EXPR_OP_NOT:
+				out->type = OPH_QUERY_EXPR_TYPE_LONG;
+				for (i = 0; i < row_num; i++)
+					o[i] = (r[i] == 0);
+				break;
+			default:
+				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
+				logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
+				return OPH_QUERY_ENGINE_PARSE_ERROR;
+		}
+	}
+
+	*res = &(program->columns[program->code_size - 1]);
+	return OPH_QUERY_ENGINE_SUCCESS;
+}
@@ -0,0 +1,212 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __OPH_QUERY_EXPRESSION_COMPILER_H__
+#define __OPH_QUERY_EXPRESSION_COMPILER_H__
+
+#include "oph_query_expression_evaluator.h"
+
+/* Definition of the structure/functions used to compile a syntax tree into a flat program (1),
+to run it row by row (2) and to run it on blocks of rows (3). Variables are resolved to slots and
+functions to symtable records at compile time, so that no name lookup and no allocation is performed
+while running the program.*/
+
+#define OPH_QUERY_EXPR_BATCH_SIZE	1024
+
+
+//---------- 1
+
+//instruction codes
+typedef enum _oph_query_expr_opcode {
+	OPH_QUERY_EXPR_OP_CONST,
+	OPH_QUERY_EXPR_OP_VAR,
+	OPH_QUERY_EXPR_OP_MULTIPLY,
+	OPH_QUERY_EXPR_OP_PLUS,
+	OPH_QUERY_EXPR_OP_MINUS,
+	OPH_QUERY_EXPR_OP_DIVIDE,
+	OPH_QUERY_EXPR_OP_EQUAL,
+	OPH_QUERY_EXPR_OP_MOD,
+	OPH_QUERY_EXPR_OP_AND,
+	OPH_QUERY_EXPR_OP_OR,
+	OPH_QUERY_EXPR_OP_NEG,
+	OPH_QUERY_EXPR_OP_NOT,
+	OPH_QUERY_EXPR_OP_FUN
+} oph_query_expr_opcode;
+
+/**
+* \brief			Instruction structure: the result of each instruction is stored in the register with the same index of the instruction
+* \param opcode		Instruction code
+* \param left		Register of left operand; slot of the variable for OPH_QUERY_EXPR_OP_VAR
+* \param right		Register of right operand (also used for unary operations)
+* \param value		Constant value; valid only for OPH_QUERY_EXPR_OP_CONST
+* \param function	Symtable record of the function; valid only for OPH_QUERY_EXPR_OP_FUN
+* \param node		Syntax tree node of the function, containing name and udf descriptor; valid only for OPH_QUERY_EXPR_OP_FUN
+* \param args		Registers of function arguments; valid only for OPH_QUERY_EXPR_OP_FUN
+* \param arg_values	Buffer used to pass arguments to the function; valid only for OPH_QUERY_EXPR_OP_FUN
+* \param arg_num	Number of function arguments; valid only for OPH_QUERY_EXPR_OP_FUN
+*/
+typedef struct _oph_query_expr_instruction {
+	oph_query_expr_opcode opcode;
+	int left;
+	int right;
+	oph_query_expr_value value;
+	oph_query_expr_record *function;
+	oph_query_expr_node *node;
+	int *args;
+	oph_query_expr_value *arg_values;
+	int arg_num;
+} oph_query_expr_instruction;
+
+/**
+* \brief				Column structure used by batch evaluation: only the array related to type is valid
+* \param type			Type of the column (OPH_QUERY_EXPR_TYPE_LONG or OPH_QUERY_EXPR_TYPE_DOUBLE)
+* \param long_value		Array of values of type long long
+* \param double_value	Array of values of type double
+*/
+typedef struct _oph_query_expr_column {
+	oph_query_expr_value_type type;
+	long long *long_value;
+	double *double_value;
+} oph_query_expr_column;
+
+/**
+* \brief				Program structure
+* \param code			Array of instructions in execution order (the last one computes the result)
+* \param code_size		Number of instructions
+* \param registers		Array of registers (one for each instruction)
+* \param vars			Array of variable values bound to the program before each run
+* \param var_num		Number of variables
+* \param columns		Array of column registers used by batch evaluation (one for each instruction)
+* \param var_columns	Array of variable columns bound to the program before each batch run
+* \param long_buffer	Storage of type long long for column registers (allocated by the first batch run)
+* \param double_buffer	Storage of type double for column registers (allocated by the first batch run)
+*/
+typedef struct _oph_query_expr_program {
+	oph_query_expr_instruction *code;
+	int code_size;
+	oph_query_expr_value *registers;
+	oph_query_expr_value *vars;
+	int var_num;
+	oph_query_expr_column *columns;
+	oph_query_expr_column *var_columns;
+	long long *long_buffer;
+	double *double_buffer;
+} oph_query_expr_program;
+
+/**
+ * \brief               Compiles an AST into a program. Functions are resolved in the global function symtable first and then in the given symtable
+ * \param e             The root of the AST (it must not be deleted before the program, since udf descriptors are kept in the tree)
+ * \param var_list      List of variable names (as returned by oph_query_expr_get_variables): the i-th variable is bound to slot i
+ * \param var_count     Number of variables
+ * \param table         The symtable used to resolve functions not found in the global function symtable (can be NULL)
+ * \param program       A reference to the pointer that will point to the created program
+ * \return              Returns 0 if operation was successfull; non-0 if otherwise;
+ */
+int oph_query_expr_compile(oph_query_expr_node * e, char **var_list, int var_count, oph_query_expr_symtable * table, oph_query_expr_program ** program);
+
+/**
+ * \brief               De-allocates all the resources used by a program (the AST is not deleted)
+ * \param program       The program to be destroyed
+ * \return              Returns 0 if operation was successfull; non-0 if otherwise;
+ */
+int oph_query_expr_destroy_program(oph_query_expr_program * program);
+
+
+/**
+ * \brief               Checks if a program calls an aggregating plugin (i.e. a function keeping state across rows)
+ * \param program       The program to be checked
+ * \return              Returns 1 if the program calls an aggregating plugin; 0 if otherwise;
+ */
+int oph_query_expr_has_aggregate(oph_query_expr_program * program);
+
+
+//---------- 2
+
+/**
+ * \brief               Binds a value of type OPH_QUERY_EXPR_TYPE_LONG to a variable slot
+ * \param program       The target program
+ * \param slot          The slot of the variable
+ * \param value         The long_value of the variable
+ * \return              Returns 0 if operation was successfull; non-0 if otherwise;
+ */
+int oph_query_expr_set_long(oph_query_expr_program * program, int slot, long long value);
+
+/**
+ * \brief               Binds a value of type OPH_QUERY_EXPR_TYPE_DOUBLE to a variable slot
+ * \param program       The target program
+ * \param slot          The slot of the variable
+ * \param value         The double_value of the variable
+ * \return              Returns 0 if operation was successfull; non-0 if otherwise;
+ */
+int oph_query_expr_set_double(oph_query_expr_program * program, int slot, double value);
+
+/**
+ * \brief               Binds a value of type OPH_QUERY_EXPR_TYPE_BINARY to a variable slot
+ * \param program       The target program
+ * \param slot          The slot of the variable
+ * \param value         A pointer to the binary_value of the variable (not copied)
+ * \return              Returns 0 if operation was successfull; non-0 if otherwise;
+ */
+int oph_query_expr_set_binary(oph_query_expr_program * program, int slot, oph_query_arg * value);
+
+/**
+ * \brief               Runs a program with the values currently bound to its variables 
+ * \param program       The program to be run
+ * \param res           The value that will be set equal to the result (allocated by the caller)
+ * \return              Returns 0 if operation was successfull; non-0 if otherwise;
+ */
+int oph_query_expr_run_program(oph_query_expr_program * program, oph_query_expr_value * res);
+
+
+//---------- 3
+
+/**
+ * \brief               Checks if a program can be run on blocks of rows, i.e. it does not call any function (functions may keep state across rows)
+ * \param program       The program to be checked
+ * \return              Returns 1 if the program can be run with oph_query_expr_run_batch; 0 if otherwise;
+ */
+int oph_query_expr_is_batchable(oph_query_expr_program * program);
+
+/**
+ * \brief               Binds a column of values of type OPH_QUERY_EXPR_TYPE_LONG to a variable slot
+ * \param program       The target program
+ * \param slot          The slot of the variable
+ * \param values        Array of at least OPH_QUERY_EXPR_BATCH_SIZE values (not copied)
+ * \return              Returns 0 if operation was successfull; non-0 if otherwise;
+ */
+int oph_query_expr_set_long_column(oph_query_expr_program * program, int slot, long long *values);
+
+/**
+ * \brief               Binds a column of values of type OPH_QUERY_EXPR_TYPE_DOUBLE to a variable slot
+ * \param program       The target program
+ * \param slot          The slot of the variable
+ * \param values        Array of at least OPH_QUERY_EXPR_BATCH_SIZE values (not copied)
+ * \return              Returns 0 if operation was successfull; non-0 if otherwise;
+ */
+int oph_query_expr_set_double_column(oph_query_expr_program * program, int slot, double *values);
+
+/**
+ * \brief               Runs a program on a block of rows with the columns currently bound to its variables
+ * \param program       The program to be run (it must be batchable)
+ * \param row_num       Number of rows of the block (at most OPH_QUERY_EXPR_BATCH_SIZE)
+ * \param res           A reference to the pointer that will point to the result column (owned by the program and valid until the next run)
+ * \return              Returns 0 if operation was successfull; non-0 if otherwise;
+ */
+int oph_query_expr_run_batch(oph_query_expr_program * program, int row_num, oph_query_expr_column ** res);
+
+#endif				// __OPH_QUERY_EXPRESSION_COMPILER_H__
@@ -34,6 +34,20 @@ extern oph_query_expr_symtable *oph_function_table;
 
 #define MIN_VAR_ARRAY_LENGTH 20
 
+//Transient values are taken from the query arena, if any, and released with it
+static void *_oph_query_expr_alloc(oph_query_expr_symtable * table, size_t size)
+{
+	if (table && table->arena)
+		return oph_server_arena_alloc(table->arena, size);
+	return calloc(1, size);
+}
+
+static void _oph_query_expr_free(oph_query_expr_symtable * table, void *ptr)
+{
+	if (!table || !table->arena)
+		free(ptr);
+}
+
 static oph_query_expr_node *allocate_node()
 {
 	oph_query_expr_node *b = (oph_query_expr_node *) malloc(sizeof(oph_query_expr_node));
@@ -224,6 +238,7 @@ int oph_query_expr_create_function_symtable(int additional_size)
      *the paramenter additional_size)
      */
 	oph_function_table->maxSize = MIN_SIZE + additional_size;
+	oph_function_table->arena = NULL;
 
 	oph_function_table->array = (oph_query_expr_record **) calloc(oph_function_table->maxSize, sizeof(oph_query_expr_record *));
 	if ((oph_function_table->array) == NULL) {
@@ -268,6 +283,7 @@ int oph_query_expr_create_symtable(oph_query_expr_symtable ** table, int additio
      *the paramenter additional_size)
      */
 	(*table)->maxSize = MIN_SIZE + additional_size;
+	(*table)->arena = NULL;
 
 	(*table)->array = (oph_query_expr_record **) calloc((*table)->maxSize, sizeof(oph_query_expr_record *));
 	if (((*table)->array) == NULL) {
@@ -621,7 +637,7 @@ oph_query_expr_value evaluate(oph_query_expr_node * e, int *er, oph_query_expr_s
 				double r = get_double_value(right, er, "/");
 				oph_query_expr_value res;
 				res.type = OPH_QUERY_EXPR_TYPE_DOUBLE;
-				res.data.double_value = l * r;
+				res.data.double_value = l / r;
 				res.free_flag = 0;
 				res.jump_flag = 0;
 				return res;
@@ -751,7 +767,7 @@ oph_query_expr_value evaluate(oph_query_expr_node * e, int *er, oph_query_expr_s
 									}
 								}
 							}
-							free(args);
+							_oph_query_expr_free(table, args);
 						}
 						oph_query_expr_value res;
 						res.type = OPH_QUERY_EXPR_TYPE_DOUBLE;
@@ -786,13 +802,13 @@ oph_query_expr_value evaluate(oph_query_expr_node * e, int *er, oph_query_expr_s
 							}
 
 						}
-						free(args);
+						_oph_query_expr_free(table, args);
 						return res;
 					} else {
 						pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
 						logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
 						*er = -1;
-						free(args);
+						_oph_query_expr_free(table, args);
 						oph_query_expr_value res;
 						res.type = OPH_QUERY_EXPR_TYPE_DOUBLE;
 						res.data.double_value = 0;
@@ -849,7 +865,12 @@ oph_query_expr_value *get_array_args(char *name, oph_query_expr_node * e, int fu
 	}
 
 
-	oph_query_expr_value *arr = (oph_query_expr_value *) calloc(num_args_provided, sizeof(oph_query_expr_value));
+	oph_query_expr_value *arr = (oph_query_expr_value *) _oph_query_expr_alloc(table, num_args_provided * sizeof(oph_query_expr_value));
+	if (arr == NULL) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_MEMORY_ALLOC_ERROR);
+		return NULL;
+	}
 	cur = e;
 	//the loop is reversed so they are put in the array in the same order they appeared in the query
 	int i = num_args_provided - 1;
@@ -859,7 +880,7 @@ oph_query_expr_value *get_array_args(char *name, oph_query_expr_node * e, int fu
 		if (*er) {
 			//In this case terminate execution of whole expression    
 			*jump_flag = 0;
-			free(arr);
+			_oph_query_expr_free(table, arr);
 			return NULL;
 		}
 		cur = cur->right;
@@ -880,38 +901,38 @@ int oph_query_expr_eval_expression(oph_query_expr_node * e, oph_query_expr_value
 		return OPH_QUERY_ENGINE_NULL_PARAM;
 	}
 
-	oph_query_expr_value *result = (oph_query_expr_value *) malloc(sizeof(oph_query_expr_value));
-	int *er = (int *) malloc(sizeof(int));
-	if (er == NULL) {
+	oph_query_expr_value *result = (oph_query_expr_value *) _oph_query_expr_alloc(table, sizeof(oph_query_expr_value));
+	if (result == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_MEMORY_ALLOC_ERROR);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_MEMORY_ALLOC_ERROR);
 		return OPH_QUERY_ENGINE_MEMORY_ERROR;
 	}
-	*er = 0;
-
-	if (e != NULL) {
-		*result = evaluate(e, er, table);
-		if (*er != -1) {
-			(*res) = result;
-			free(er);
-			return OPH_QUERY_ENGINE_SUCCESS;
-		} else {
-			free(er);
-			free(result);
-			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
-			logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
-			return OPH_QUERY_ENGINE_PARSE_ERROR;
-		}
+	int er = 0;
 
+	*result = evaluate(e, &er, table);
+	if (er != -1) {
+		(*res) = result;
+		return OPH_QUERY_ENGINE_SUCCESS;
 	} else {
-		free(er);
-		free(result);
+		_oph_query_expr_free(table, result);
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_EVAL_ERROR);
 		return OPH_QUERY_ENGINE_PARSE_ERROR;
 	}
 }
 
+int oph_query_expr_release_value(oph_query_expr_value * value, oph_query_expr_symtable * table)
+{
+	if (value == NULL || table == NULL) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		return OPH_QUERY_ENGINE_NULL_PARAM;
+	}
+
+	_oph_query_expr_free(table, value);
+	return OPH_QUERY_ENGINE_SUCCESS;
+}
+
 int oph_query_expr_change_group(oph_query_expr_node * b)
 {
 	//base case for recursion and error case if null pointer is passed by user
@@ -24,6 +24,7 @@
 #include <ltdl.h>
 
 #include "oph_query_parser.h"
+#include "oph_server_arena.h"
 
 /* Definition of the structure/functions used to contruct and use the symtable (1), 
 build the syntax tree (2), execute type chacks(3) and interact with the library (4).*/
@@ -129,10 +130,12 @@ typedef struct _oph_query_expr_record {
 * \brief			Symble table structure		
 * \param maxSize 	size of symtable array		
 * \param array 		array of pointer to oph_query_expr_records. NULL if pointer is not there		
+* \param arena 		arena used for transient values computed during evaluation (NULL to use the heap)
 */
 typedef struct _oph_query_expr_symtable {
 	int maxSize;
 	oph_query_expr_record **array;
+	oph_server_arena *arena;
 } oph_query_expr_symtable;
 
 //functions to interact with symtable
@@ -392,6 +395,14 @@ int oph_query_expr_get_ast(const char *expr, oph_query_expr_node ** e);
  */
 int oph_query_expr_eval_expression(oph_query_expr_node * e, oph_query_expr_value ** res, oph_query_expr_symtable * table);
 
+/**
+ * \brief               Releases a result returned by oph_query_expr_eval_expression (results taken from the symtable arena are released with the arena)
+ * \param value         The result to be released
+ * \param table         The symtable used during evaluation
+ * \return              Returns 0 if operation was successfull; non-0 if otherwise;
+ */
+int oph_query_expr_release_value(oph_query_expr_value * value, oph_query_expr_symtable * table);
+
 /**
  * \brief               Set the value of all the functions clear flag to 1 
  * \param e             A reference to the AST to evaluate
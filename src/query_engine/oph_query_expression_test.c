@@ -0,0 +1,148 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "oph_query_expression_compiler.h"
+#include "oph_query_plugin_loader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+//Global variables used by the query engine
+oph_server_hashmap *plugin_table = NULL;
+oph_query_expr_symtable *oph_function_table = NULL;
+pthread_mutex_t libtool_lock = PTHREAD_MUTEX_INITIALIZER;
+unsigned short disable_mem_check = 1;
+unsigned long long omp_threads = 1;
+
+#define OPH_QUERY_EXPRESSION_TEST_ROWS	200
+
+//Variables: a is a long, b a double, c a binary array of longs and n is not bound
+static const char *_oph_query_expression_test_exprs[] = {
+	"a + b", "a - b * 2", "a / b", "b / a", "(a + 1) / (b - 3)", "-a / 4", "a * 2.5 / (b + a)", "1 / 0", "0 / 0.0",
+	"a = b", "a = 3", "a % 7", "(a % 3) = 1", "!a", "NOT (a = b)", "a AND b", "a OR b", "a && b = 0", "(a | b) AND !(a % 2)",
+	"oph_is_in_subset(a, 1, 2, 10)", "oph_id(a, 3) / 2", "oph_id_to_index(a, 4, 5)", "oph_id3(a, c, 2)", "oph_id3(a, c, 2) + b / 2",
+	"n + 1", "a / n", "oph_id(n, 2)", "oph_id(b, 2)", "c * 2", "oph_id3(a, b, 2)", "NULL = a"
+};
+
+static unsigned long long _oph_query_expression_test_seed = 1;
+
+static long long _oph_query_expression_test_rand(long long max)
+{
+	_oph_query_expression_test_seed = _oph_query_expression_test_seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return (long long) ((_oph_query_expression_test_seed >> 33) % (unsigned long long) max);
+}
+
+//Results agree if both evaluations fail or if they have the same type and value
+static int _oph_query_expression_test_compare(int tree_res, oph_query_expr_value * tree_value, int program_res, oph_query_expr_value * program_value)
+{
+	if (tree_res || program_res)
+		return !tree_res != !program_res;
+	if (tree_value->type != program_value->type)
+		return 1;
+	switch (tree_value->type) {
+		case OPH_QUERY_EXPR_TYPE_LONG:
+			return tree_value->data.long_value != program_value->data.long_value;
+		case OPH_QUERY_EXPR_TYPE_DOUBLE:
+			if (isnan(tree_value->data.double_value))
+				return !isnan(program_value->data.double_value);
+			return tree_value->data.double_value != program_value->data.double_value;
+		default:
+			return 0;
+	}
+}
+
+static int _oph_query_expression_test_expr(const char *expr, oph_query_arg * binary)
+{
+	oph_query_expr_node *e = NULL;
+	oph_query_expr_symtable *table = NULL;
+	oph_query_expr_program *program = NULL;
+	oph_query_expr_value *tree_value = NULL, program_value;
+	char **var_list = NULL;
+	int var_count = 0, i, j, tree_res, program_res, res = 0;
+
+	if (oph_query_expr_get_ast(expr, &e) || !e || oph_query_expr_create_symtable(&table, 4) || oph_query_expr_get_variables(e, &var_list, &var_count)
+	    || oph_query_expr_compile(e, var_list, var_count, NULL, &program)) {
+		fprintf(stderr, "Unable to compile expression %s\n", expr);
+		res = 1;
+	}
+
+	for (j = 0; !res && j < OPH_QUERY_EXPRESSION_TEST_ROWS; j++) {
+		long long a = _oph_query_expression_test_rand(41) - 20;
+		double b = (j % 5) ? (double) (_oph_query_expression_test_rand(2001) - 1000) / 64 : (double) (j % 3);
+		for (i = 0; i < var_count; i++) {
+			if (!strcmp(var_list[i], "a")) {
+				oph_query_expr_add_long(var_list[i], a, table);
+				oph_query_expr_set_long(program, i, a);
+			} else if (!strcmp(var_list[i], "b")) {
+				oph_query_expr_add_double(var_list[i], b, table);
+				oph_query_expr_set_double(program, i, b);
+			} else if (!strcmp(var_list[i], "c")) {
+				oph_query_expr_add_binary(var_list[i], binary, table);
+				oph_query_expr_set_binary(program, i, binary);
+			}
+			//n is never bound: it is unknown to the tree evaluator and NULL for the program
+		}
+
+		tree_value = NULL;
+		tree_res = oph_query_expr_eval_expression(e, &tree_value, table);
+		program_res = oph_query_expr_run_program(program, &program_value);
+		if (_oph_query_expression_test_compare(tree_res, tree_value, program_res, &program_value)) {
+			fprintf(stderr, "Different results of expression %s with a = %lld and b = %g\n", expr, a, b);
+			res = 1;
+		}
+		if (!tree_res && tree_value)
+			oph_query_expr_release_value(tree_value, table);
+	}
+
+	if (program)
+		oph_query_expr_destroy_program(program);
+	if (var_list)
+		free(var_list);
+	if (e)
+		oph_query_expr_delete_node(e, table);
+	if (table)
+		oph_query_expr_destroy_symtable(table);
+
+	return res;
+}
+
+int main()
+{
+	long long list[3] = { 2, 1, 3 };
+	oph_query_arg binary;
+	binary.arg = (char *) list;
+	binary.arg_length = sizeof(list);
+
+	if (oph_query_expr_create_function_symtable(0)) {
+		fprintf(stderr, "Unable to create the function table\n");
+		return 1;
+	}
+
+	int res = 0;
+	size_t i;
+	for (i = 0; i < sizeof(_oph_query_expression_test_exprs) / sizeof(char *); i++)
+		if (_oph_query_expression_test_expr(_oph_query_expression_test_exprs[i], &binary))
+			res = 1;
+
+	oph_query_expr_destroy_symtable(oph_function_table);
+
+	return res;
+}
@@ -84,7 +84,7 @@ int _oph_query_parser_validate_query(const char *query_string)
 	return OPH_QUERY_ENGINE_SUCCESS;
 }
 
-int _oph_query_parser_load_query_params(const char *query_string, HASHTBL * hashtbl)
+int _oph_query_parser_load_query_params(const char *query_string, oph_server_hashmap * hashtbl)
 {
 	if (!query_string || !hashtbl) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
@@ -128,7 +128,19 @@ int _oph_query_parser_load_query_params(const char *query_string, HASHTBL * hash
 			return OPH_QUERY_ENGINE_MEMORY_ERROR;
 		}
 
-		hashtbl_insert(hashtbl, (char *) param, (char *) real_val);
+		//Only the first occurrence of a param is considered
+		switch (oph_server_hashmap_insert(hashtbl, (char *) param, (char *) real_val)) {
+			case OPH_SERVER_HASHMAP_SUCCESS:
+				break;
+			case OPH_SERVER_HASHMAP_KEY_EXISTS:
+				free(real_val);
+				break;
+			default:
+				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_MEMORY_ALLOC_ERROR);
+				logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_MEMORY_ALLOC_ERROR);
+				free(real_val);
+				return OPH_QUERY_ENGINE_MEMORY_ERROR;
+		}
 		real_val = NULL;
 		ptr_begin = ptr_end + 1;
 		ptr_equal = strchr(ptr_end + 1, OPH_QUERY_ENGINE_LANG_VALUE_SEPARATOR);
@@ -263,7 +275,7 @@ int oph_query_parse_hierarchical_args(char *values, char ***value_list, int *val
 	return OPH_QUERY_ENGINE_SUCCESS;
 }
 
-int _oph_query_check_query_params(HASHTBL * hashtbl)
+int _oph_query_check_query_params(oph_server_hashmap * hashtbl)
 {
 	if (!hashtbl) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
@@ -271,18 +283,12 @@ int _oph_query_check_query_params(HASHTBL * hashtbl)
 		return OPH_QUERY_ENGINE_NULL_PARAM;
 	}
 
-	if (hashtbl_get(hashtbl, OPH_QUERY_ENGINE_LANG_ARG_WHEREL) || hashtbl_get(hashtbl, OPH_QUERY_ENGINE_LANG_ARG_WHEREC) || hashtbl_get(hashtbl, OPH_QUERY_ENGINE_LANG_ARG_WHERER)) {
+	if (oph_server_hashmap_get(hashtbl, OPH_QUERY_ENGINE_LANG_ARG_WHEREL) || oph_server_hashmap_get(hashtbl, OPH_QUERY_ENGINE_LANG_ARG_WHEREC) || oph_server_hashmap_get(hashtbl, OPH_QUERY_ENGINE_LANG_ARG_WHERER)) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "Query not valid: keyword not supported.\n");
 		logging(LOG_ERROR, __FILE__, __LINE__, "Query not valid: keyword not supported.\n");
 		return OPH_QUERY_ENGINE_PARSE_ERROR;
 	}
 
-	char *tmp = hashtbl_get(hashtbl, OPH_QUERY_ENGINE_LANG_ARG_ORDER_DIR);
-	if (tmp && strcasecmp(tmp, "ASC")) {
-		pmesg(LOG_WARNING, __FILE__, __LINE__, "Keyword '%s' skipped.\n", OPH_QUERY_ENGINE_LANG_ARG_ORDER_DIR);
-		logging(LOG_WARNING, __FILE__, __LINE__, "Keyword '%s' skipped.\n", OPH_QUERY_ENGINE_LANG_ARG_ORDER_DIR);
-	}
-
 	return OPH_QUERY_ENGINE_SUCCESS;
 }
 
@@ -305,7 +311,7 @@ int _oph_query_parser_remove_query_tokens(char *query_string)
 	return OPH_QUERY_ENGINE_SUCCESS;
 }
 
-int oph_query_parser(char *query_string, HASHTBL ** query_args)
+int oph_query_parser(char *query_string, oph_server_hashmap ** query_args)
 {
 	if (!query_string || !query_args) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
@@ -336,7 +342,7 @@ int oph_query_parser(char *query_string, HASHTBL ** query_args)
 	//Create hash table for arguments
 	*query_args = NULL;
 
-	if (!(*query_args = hashtbl_create(OPH_QUERY_ENGINE_QUERY_ARGS, NULL))) {
+	if (!(*query_args = oph_server_hashmap_create(OPH_QUERY_ENGINE_QUERY_ARGS, OPH_SERVER_HASHMAP_OWN_ALL))) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_HASHTBL_CREATE_ERROR);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_HASHTBL_CREATE_ERROR);
 		free(updated_query);
@@ -346,7 +352,7 @@ int oph_query_parser(char *query_string, HASHTBL ** query_args)
 	if (_oph_query_parser_load_query_params(updated_query, *query_args)) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_QUERY_ARG_LOAD_ERROR);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_QUERY_ARG_LOAD_ERROR);
-		hashtbl_destroy(*query_args);
+		oph_server_hashmap_destroy(*query_args);
 		*query_args = NULL;
 		free(updated_query);
 		return OPH_QUERY_ENGINE_PARSE_ERROR;
@@ -358,7 +364,7 @@ int oph_query_parser(char *query_string, HASHTBL ** query_args)
 	if (_oph_query_check_query_params(*query_args)) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_QUERY_PARSING_ERROR, query_string);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_QUERY_PARSING_ERROR, query_string);
-		hashtbl_destroy(*query_args);
+		oph_server_hashmap_destroy(*query_args);
 		*query_args = NULL;
 		return OPH_QUERY_ENGINE_PARSE_ERROR;
 	}
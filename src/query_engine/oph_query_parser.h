@@ -19,7 +19,7 @@
 #ifndef OPH_QUERY_PARSER_H
 #define OPH_QUERY_PARSER_H
 
-#include "hashtbl.h"
+#include "oph_server_hashmap.h"
 
 /**
  * \brief           Enum with admissible argument types
@@ -75,7 +75,7 @@ int _oph_query_parser_validate_query(const char *query_string);
  * \param hashtbl       Hash table to be loaded
  * \return              0 if successfull, non-0 otherwise
  */
-int _oph_query_parser_load_query_params(const char *query_string, HASHTBL * hashtbl);
+int _oph_query_parser_load_query_params(const char *query_string, oph_server_hashmap * hashtbl);
 
 /**
  * \brief               Function used to parse query string and load all arguments into hash table 
@@ -83,7 +83,7 @@ int _oph_query_parser_load_query_params(const char *query_string, HASHTBL * hash
  * \param query_args    Hash table containing args to be created
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_query_parser(char *query_string, HASHTBL ** query_args);
+int oph_query_parser(char *query_string, oph_server_hashmap ** query_args);
 
 /**
  * \brief               Function to parse and split multiple-value arguments. It modifies the input "values" string 
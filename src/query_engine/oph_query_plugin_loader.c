@@ -27,14 +27,19 @@
 #include <string.h>
 
 #include <debug.h>
-#include <hashtbl.h>
+#include <oph_server_hashmap.h>
 
 #include <errno.h>
+#include <pthread.h>
+#include <ltdl.h>
 
 #include "oph_server_utility.h"
 #include "oph_server_confs.h"
 
+#define OPH_PLUGIN_SYMBOL_LEN 1024
+
 extern int msglevel;
+extern pthread_mutex_t libtool_lock;
 
 //Setup oph_plugin with default values
 int oph_init_plugin(oph_plugin * plugin)
@@ -49,6 +54,9 @@ int oph_init_plugin(oph_plugin * plugin)
 	plugin->plugin_library = NULL;
 	plugin->plugin_type = OPH_SIMPLE_PLUGIN_TYPE;
 	plugin->plugin_return = OPH_IOSTORE_STRING_TYPE;
+	plugin->plugin_loaded = 0;
+	plugin->plugin_dlh = NULL;
+	memset(&(plugin->plugin_api), 0, sizeof(oph_plugin_api));
 
 	return OPH_QUERY_ENGINE_SUCCESS;
 }
@@ -66,10 +74,98 @@ int oph_free_plugin(oph_plugin * plugin)
 	if (plugin->plugin_library)
 		free(plugin->plugin_library);
 
+	//Close plugin library, if loaded
+	if (plugin->plugin_loaded) {
+		pthread_mutex_lock(&libtool_lock);
+		lt_dlclose((lt_dlhandle) plugin->plugin_dlh);
+		lt_dlexit();
+		pthread_mutex_unlock(&libtool_lock);
+		plugin->plugin_loaded = 0;
+		plugin->plugin_dlh = NULL;
+	}
+
+	return OPH_QUERY_ENGINE_SUCCESS;
+}
+
+int oph_load_plugin_library(oph_plugin * plugin)
+{
+	if (!plugin || !plugin->plugin_name || !plugin->plugin_library) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		return OPH_QUERY_ENGINE_NULL_PARAM;
+	}
+	//Fast path: library already loaded
+	if (__atomic_load_n(&(plugin->plugin_loaded), __ATOMIC_ACQUIRE))
+		return OPH_QUERY_ENGINE_SUCCESS;
+
+	pthread_mutex_lock(&libtool_lock);
+
+	//Check again, since another thread could have loaded the library in the meanwhile
+	if (plugin->plugin_loaded) {
+		pthread_mutex_unlock(&libtool_lock);
+		return OPH_QUERY_ENGINE_SUCCESS;
+	}
+
+	lt_dlinit();
+
+	lt_dlhandle dlh = NULL;
+	if (!(dlh = lt_dlopen(plugin->plugin_library))) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_PLUGIN_LIB_ERROR, plugin->plugin_name, lt_dlerror());
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_PLUGIN_LIB_ERROR, plugin->plugin_name, lt_dlerror());
+		lt_dlexit();
+		pthread_mutex_unlock(&libtool_lock);
+		return OPH_QUERY_ENGINE_ERROR;
+	}
+
+	char symbol_name[OPH_PLUGIN_SYMBOL_LEN];
+
+	snprintf(symbol_name, OPH_PLUGIN_SYMBOL_LEN, "%s_init", plugin->plugin_name);
+	plugin->plugin_api.init_api = lt_dlsym(dlh, symbol_name);
+	plugin->plugin_api.exec_api = lt_dlsym(dlh, plugin->plugin_name);
+	snprintf(symbol_name, OPH_PLUGIN_SYMBOL_LEN, "%s_deinit", plugin->plugin_name);
+	plugin->plugin_api.deinit_api = lt_dlsym(dlh, symbol_name);
+	plugin->plugin_api.clear_api = NULL;
+	plugin->plugin_api.reset_api = NULL;
+	plugin->plugin_api.add_api = NULL;
+	if (plugin->plugin_type == OPH_AGGREGATE_PLUGIN_TYPE) {
+		snprintf(symbol_name, OPH_PLUGIN_SYMBOL_LEN, "%s_clear", plugin->plugin_name);
+		plugin->plugin_api.clear_api = lt_dlsym(dlh, symbol_name);
+		snprintf(symbol_name, OPH_PLUGIN_SYMBOL_LEN, "%s_reset", plugin->plugin_name);
+		plugin->plugin_api.reset_api = lt_dlsym(dlh, symbol_name);
+		snprintf(symbol_name, OPH_PLUGIN_SYMBOL_LEN, "%s_add", plugin->plugin_name);
+		plugin->plugin_api.add_api = lt_dlsym(dlh, symbol_name);
+	}
+	plugin->plugin_dlh = (void *) dlh;
+
+	//Publish the plugin only when all the symbols are set
+	__atomic_store_n(&(plugin->plugin_loaded), 1, __ATOMIC_RELEASE);
+
+	pthread_mutex_unlock(&libtool_lock);
+
 	return OPH_QUERY_ENGINE_SUCCESS;
 }
 
-int oph_load_plugins(HASHTBL ** plugin_htable, oph_query_expr_symtable ** function_table)
+int oph_preload_plugins(oph_server_hashmap * plugin_htable)
+{
+	if (!plugin_htable) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
+		return OPH_QUERY_ENGINE_NULL_PARAM;
+	}
+
+	unsigned long long iter = 0;
+	void *plugin = NULL;
+	int res = OPH_QUERY_ENGINE_SUCCESS;
+
+	//Libraries that cannot be loaded now will be loaded on first use
+	while (oph_server_hashmap_next(plugin_htable, &iter, NULL, &plugin))
+		if (oph_load_plugin_library((oph_plugin *) plugin))
+			res = OPH_QUERY_ENGINE_ERROR;
+
+	return res;
+}
+
+int oph_load_plugins(oph_server_hashmap ** plugin_htable, oph_query_expr_symtable ** function_table)
 {
 	FILE *fp = NULL;
 	char line[OPH_PLUGIN_FILE_LINE] = { 0 };
@@ -120,7 +216,7 @@ int oph_load_plugins(HASHTBL ** plugin_htable, oph_query_expr_symtable ** functi
 
 	rewind(fp);
 
-	if (!(*plugin_htable = hashtbl_create(primitives_number, NULL))) {
+	if (!(*plugin_htable = oph_server_hashmap_create(primitives_number, OPH_SERVER_HASHMAP_BORROW_KEYS | OPH_SERVER_HASHMAP_BORROW_VALUES))) {
 		fclose(fp);
 		oph_query_expr_destroy_symtable(*function_table);
 		*function_table = NULL;
@@ -236,7 +332,24 @@ int oph_load_plugins(HASHTBL ** plugin_htable, oph_query_expr_symtable ** functi
 				}
 			}
 		}
-		hashtbl_insert(*plugin_htable, new->plugin_name, (oph_plugin *) new);
+		switch (oph_server_hashmap_insert(*plugin_htable, new->plugin_name, (oph_plugin *) new)) {
+			case OPH_SERVER_HASHMAP_SUCCESS:
+				break;
+			case OPH_SERVER_HASHMAP_KEY_EXISTS:
+				//Only the first definition of a plugin is considered
+				pmesg(LOG_WARNING, __FILE__, __LINE__, "Plugin %s already loaded: entry skipped\n", new->plugin_name);
+				oph_free_plugin(new);
+				free(new);
+				continue;
+			default:
+				oph_unload_plugins(plugin_htable, function_table);
+				oph_free_plugin(new);
+				free(new);
+				fclose(fp);
+				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_HASHTBL_ERROR);
+				logging(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_HASHTBL_ERROR);
+				return OPH_QUERY_ENGINE_ERROR;
+		}
 		//Load function is symtable     
 		//TODO Set number of args in symtable and add string function
 		switch (new->plugin_return) {
@@ -262,7 +375,7 @@ int oph_load_plugins(HASHTBL ** plugin_htable, oph_query_expr_symtable ** functi
 	return OPH_QUERY_ENGINE_SUCCESS;
 }
 
-int oph_unload_plugins(HASHTBL ** plugin_htable, oph_query_expr_symtable ** function_table)
+int oph_unload_plugins(oph_server_hashmap ** plugin_htable, oph_query_expr_symtable ** function_table)
 {
 	if (!plugin_htable || !function_table) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_QUERY_ENGINE_LOG_NULL_INPUT_PARAM);
@@ -270,26 +383,14 @@ int oph_unload_plugins(HASHTBL ** plugin_htable, oph_query_expr_symtable ** func
 		return OPH_QUERY_ENGINE_NULL_PARAM;
 	}
 
-	hash_size n;
-	oph_plugin *plugin_ptr;
-	struct hashnode_s *node, *oldnode;
-	for (n = 0; n < (*plugin_htable)->size; ++n) {
-		node = (*plugin_htable)->nodes[n];
-		while (node) {
-			//plugin_ptr = (oph_plugin*)hashtbl_get(plugin_htable,node->key);
-			plugin_ptr = (oph_plugin *) node->data;
-			oph_free_plugin(plugin_ptr);
-			free(plugin_ptr);
-			node->data = NULL;
-			free(node->key);
-			free(node->data);
-			oldnode = node;
-			node = node->next;
-			free(oldnode);
-		}
+	//Keys are borrowed from the plugins: they are not accessed by oph_server_hashmap_destroy
+	unsigned long long iter = 0;
+	void *plugin_ptr = NULL;
+	while (oph_server_hashmap_next(*plugin_htable, &iter, NULL, &plugin_ptr)) {
+		oph_free_plugin((oph_plugin *) plugin_ptr);
+		free(plugin_ptr);
 	}
-	free((*plugin_htable)->nodes);
-	free(*plugin_htable);
+	oph_server_hashmap_destroy(*plugin_htable);
 
 	*plugin_htable = NULL;
 	oph_query_expr_destroy_symtable(*function_table);
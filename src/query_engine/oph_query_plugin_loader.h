@@ -19,7 +19,7 @@
 #ifndef OPH_QUERY_PLUGIN_LOADER_H
 #define OPH_QUERY_PLUGIN_LOADER_H
 
-#include <hashtbl.h>
+#include <oph_server_hashmap.h>
 
 #include "oph_iostorage_interface.h"
 #include "oph_query_expression_evaluator.h"
@@ -51,12 +51,18 @@ typedef enum {
  * \param plugin_library Filename with path of plugin
  * \param plugin_type		Type of plugin function (simple or aggragetion)
  * \param plugin_return	Return type of plugin
+ * \param plugin_loaded	Flag set once the plugin library has been loaded (it is read without locks)
+ * \param plugin_dlh		Handler of the plugin library (shared by all the threads)
+ * \param plugin_api		Symbols of the plugin library (shared by all the threads)
  */
 typedef struct {
 	char *plugin_name;
 	char *plugin_library;
 	oph_plugin_type plugin_type;
 	oph_iostore_field_type plugin_return;
+	int plugin_loaded;
+	void *plugin_dlh;
+	oph_plugin_api plugin_api;
 } oph_plugin;
 
 /**
@@ -79,7 +85,21 @@ int oph_free_plugin(oph_plugin * plugin);
  * \param function_htable      Pointer to symtable used to store plugin list
  * \return            0 if successfull, non-0 otherwise
  */
-int oph_load_plugins(HASHTBL ** plugin_htable, oph_query_expr_symtable ** function_table);
+int oph_load_plugins(oph_server_hashmap ** plugin_htable, oph_query_expr_symtable ** function_table);
+
+/**
+ * \brief			        Load the library of a plugin and resolve its symbols. The library is loaded only once per process, further calls only check the plugin state
+ * \param plugin      Pointer to plugin to be loaded
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_load_plugin_library(oph_plugin * plugin);
+
+/**
+ * \brief			        Load the libraries of all the plugins in plugin table
+ * \param plugin_htable      Hash table with plugin list
+ * \return            0 if successfull, non-0 otherwise
+ */
+int oph_preload_plugins(oph_server_hashmap * plugin_htable);
 
 /**
  * \brief			        Clean plugin list in plugin table
@@ -87,6 +107,6 @@ int oph_load_plugins(HASHTBL ** plugin_htable, oph_query_expr_symtable ** functi
  * \param function_htable      Pointer to symtable to be freed
  * \return            0 if successfull, non-0 otherwise
  */
-int oph_unload_plugins(HASHTBL ** plugin_htable, oph_query_expr_symtable ** function_table);
+int oph_unload_plugins(oph_server_hashmap ** plugin_htable, oph_query_expr_symtable ** function_table);
 
 #endif				/* OPH_QUERY_PLUGIN_LOADER_H */
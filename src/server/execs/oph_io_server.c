@@ -17,15 +17,21 @@
 */
 
 #include "oph_io_server_thread.h"
+#include "oph_io_server_pool.h"
 
 #include <signal.h>
 #include <unistd.h>
 #include <malloc.h>
+#include <string.h>
+#include <strings.h>
 #include "debug.h"
 
-#include "hashtbl.h"
+#include "oph_server_hashmap.h"
 
 #include "oph_server_confs.h"
+#include "oph_server_utility.h"
+#include "oph_server_memory.h"
+#include "oph_server_transpose.h"
 #include "oph_metadb_interface.h"
 #include "oph_network.h"
 #include "oph_query_expression_evaluator.h"
@@ -33,6 +39,12 @@
 
 #include "oph_license.h"
 
+#ifdef OPH_IO_SERVER_NETCDF
+#include "oph_io_server_nc_cache.h"
+#ifdef OPH_PAR_NC4
+#include "oph_io_server_nc_loader.h"
+#endif
+#endif
 #ifdef OPH_IO_SERVER_ESDM
 #include <esdm.h>
 #endif
@@ -43,21 +55,25 @@ unsigned long long max_packet_length = 0;
 unsigned short omp_threads = 0;
 unsigned short client_ttl = 0;
 unsigned short disable_mem_check = 0;
+unsigned short disable_batch_eval = 0;
 unsigned long long memory_buffer = 0;
 unsigned short cache_line_size = 0;
 unsigned long long cache_size = 0;
 
+//Number of workers serving a request: OpenMP threads are shared among them
+unsigned int active_workers = 0;
+
 pthread_rwlock_t rwlock = PTHREAD_RWLOCK_INITIALIZER;
 pthread_mutex_t libtool_lock = PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t nc_lock = PTHREAD_MUTEX_INITIALIZER;
 
 oph_metadb_db_row *db_table = NULL;
-HASHTBL *plugin_table = NULL;
+oph_server_hashmap *plugin_table = NULL;
 oph_query_expr_symtable *oph_function_table = NULL;
 
 //Global only in this files (for garbage collection purpose)
-struct sockaddr *cliaddr;
-HASHTBL *conf_db = NULL;
+oph_io_server_pool *server_pool = NULL;
+oph_server_hashmap *conf_db = NULL;
 char *oph_server_conf_file = OPH_SERVER_CONF_FILE_PATH;
 
 int main(int argc, char *argv[])
@@ -68,23 +84,24 @@ int main(int argc, char *argv[])
 	int msglevel = LOG_INFO;
 #endif
 
-	int listenfd, tmpconnfd, *connfd = NULL;
+	int listenfd;
 	void release(int);
-	void *server_child(void *);
-	pthread_t tid;
-	socklen_t clilen, addrlen;
+	socklen_t addrlen;
 
 	int ch;
 	unsigned short int instance = 0;
 
 	static char *USAGE =
-	    "\nUSAGE:\noph_io_server [-i <instance_number>]\n\nOptions:\n-c <conf_file>: set configuration file\n-D: enable debug mode\n-h: show this help\n-i <instance_number>: set number of the instance in configutation file\n-m: disable memory check\n-v: show conditions\n-w: enable warning level messages\n-x: show warrenty\n-z: show license\n";
+	    "\nUSAGE:\noph_io_server [-i <instance_number>]\n\nOptions:\n-b: disable evaluation of expressions on blocks of rows\n-c <conf_file>: set configuration file\n-D: enable debug mode\n-h: show this help\n-i <instance_number>: set number of the instance in configutation file\n-m: disable memory check\n-v: show conditions\n-w: enable warning level messages\n-x: show warrenty\n-z: show license\n";
 
 	fprintf(stdout, "%s", OPH_VERSION);
 	fprintf(stdout, OPH_DISCLAIMER, "oph_io_server", "oph_io_server");
 
-	while ((ch = getopt(argc, argv, "c:dDhi:mvwxz")) != -1) {
+	while ((ch = getopt(argc, argv, "bc:dDhi:mvwxz")) != -1) {
 		switch (ch) {
+			case 'b':
+				disable_batch_eval = 1;
+				break;
 			case 'c':
 				oph_server_conf_file = optarg;
 				break;
@@ -126,6 +143,9 @@ int main(int argc, char *argv[])
 	if (disable_mem_check)
 		pmesg(LOG_INFO, __FILE__, __LINE__, "Disable Memory check\n");
 
+	if (disable_batch_eval)
+		pmesg(LOG_INFO, __FILE__, __LINE__, "Disable evaluation on blocks of rows\n");
+
 	if (!instance)
 		pmesg(LOG_INFO, __FILE__, __LINE__, "Using default (first) instance in configuration file\n");
 
@@ -152,6 +172,11 @@ int main(int argc, char *argv[])
 	char *cache_line = 0;
 	char *cache = 0;
 	char *working_dir = 0;
+	char *preload_plugins = 0;
+	char *transpose_tune = 0;
+	char *mem_limit = 0;
+	char *mem_period = 0;
+	char *workers = 0;
 
 	if (oph_server_conf_get_param(conf_db, OPH_SERVER_CONF_DIR, &dir)) {
 		pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to get server dir param\n");
@@ -198,6 +223,15 @@ int main(int argc, char *argv[])
 
 	omp_threads = strtol(omp, NULL, 10);
 
+	//Number of workers serving client requests: if not set, the number of online CPUs is used
+	unsigned int worker_num = 0;
+	if (!oph_server_conf_get_param(conf_db, OPH_SERVER_CONF_WORKER_THREADS, &workers) && workers)
+		worker_num = (unsigned int) strtoul(workers, NULL, 10);
+	if (!worker_num) {
+		long cpu_num = sysconf(_SC_NPROCESSORS_ONLN);
+		worker_num = (cpu_num > 0 ? (unsigned int) cpu_num : 1);
+	}
+
 	if (oph_server_conf_get_param(conf_db, OPH_SERVER_CONF_MEMORY_BUFFER, &mem_buf)) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to get memory buffer param\n");
 		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to get memory buffer param\n");
@@ -225,6 +259,50 @@ int main(int argc, char *argv[])
 
 	cache_line_size = strtol(cache_line, NULL, 10);
 
+	//Setup the kernels reordering imported data: the leaf size of the recursion is optionally measured at startup
+	oph_server_transpose_init(cache_size, cache_line_size);
+	if (!oph_server_conf_get_param(conf_db, OPH_SERVER_CONF_TRANSPOSE_TUNE, &transpose_tune) && transpose_tune && !STRCMP(transpose_tune, "yes")) {
+		if (oph_server_transpose_tune()) {
+			pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to tune transpose kernels: default leaf size will be used\n");
+			logging(LOG_WARNING, __FILE__, __LINE__, "Unable to tune transpose kernels: default leaf size will be used\n");
+		}
+	}
+
+	//Setup memory budget: both the limit (in MB) and the sampling period (in seconds) are optional
+	unsigned long long memory_limit = 0;
+	unsigned int memory_check_period = OPH_SERVER_MEMORY_CHECK_PERIOD;
+	if (!oph_server_conf_get_param(conf_db, OPH_SERVER_CONF_MEMORY_LIMIT, &mem_limit) && mem_limit)
+		memory_limit = strtoull(mem_limit, NULL, 10) * (unsigned long long) OPH_SERVER_MEMORY_MB_SIZE;
+	if (!oph_server_conf_get_param(conf_db, OPH_SERVER_CONF_MEMORY_CHECK_PERIOD, &mem_period) && mem_period)
+		memory_check_period = (unsigned int) strtoul(mem_period, NULL, 10);
+	if (oph_server_memory_init(memory_limit, disable_mem_check ? 0 : memory_check_period)) {
+		pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to start memory sampling: memory will be checked on demand\n");
+		logging(LOG_WARNING, __FILE__, __LINE__, "Unable to start memory sampling: memory will be checked on demand\n");
+	}
+
+#ifdef OPH_IO_SERVER_NETCDF
+	//Setup cache of open NetCDF files: both the number of unused files kept open and the idle time (in seconds) are optional
+	unsigned int nc_cache_size = OPH_IO_SERVER_NC_CACHE_SIZE;
+	unsigned int nc_cache_idle_time = OPH_IO_SERVER_NC_CACHE_IDLE_TIME;
+	char *nc_cache = 0, *nc_idle_time = 0;
+	if (!oph_server_conf_get_param(conf_db, OPH_SERVER_CONF_NC_CACHE_SIZE, &nc_cache) && nc_cache)
+		nc_cache_size = (unsigned int) strtoul(nc_cache, NULL, 10);
+	if (!oph_server_conf_get_param(conf_db, OPH_SERVER_CONF_NC_CACHE_IDLE_TIME, &nc_idle_time) && nc_idle_time)
+		nc_cache_idle_time = (unsigned int) strtoul(nc_idle_time, NULL, 10);
+	oph_io_server_nc_cache_init(nc_cache_size, nc_cache_idle_time);
+#ifdef OPH_PAR_NC4
+	//Start the processes loading NetCDF4 files: by default one for each worker
+	unsigned int nc_load_num = worker_num;
+	char *nc_load = 0;
+	if (!oph_server_conf_get_param(conf_db, OPH_SERVER_CONF_NC_LOAD_PROCESSES, &nc_load) && nc_load && strtoul(nc_load, NULL, 10))
+		nc_load_num = (unsigned int) strtoul(nc_load, NULL, 10);
+	if (oph_io_server_nc_loader_init(OPH_IO_SERVER_NC_LOADER_EXEC, nc_load_num)) {
+		pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to start NetCDF loader processes\n");
+		logging(LOG_WARNING, __FILE__, __LINE__, "Unable to start NetCDF loader processes\n");
+	}
+#endif
+#endif
+
 	if (!oph_server_conf_get_param(conf_db, OPH_SERVER_CONF_WORKING_DIR, &working_dir) && working_dir) {
 		if (chdir(working_dir)) {
 			pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to set working directory '%s'\n", working_dir);
@@ -239,11 +317,27 @@ int main(int argc, char *argv[])
 		oph_server_conf_unload(&conf_db);
 		return -1;
 	}
+	//Plugin libraries are loaded at startup unless explicitly disabled (otherwise they are loaded on first use)
+	if (oph_server_conf_get_param(conf_db, OPH_SERVER_CONF_PRELOAD_PLUGINS, &preload_plugins) || !preload_plugins || STRCMP(preload_plugins, "no")) {
+		if (oph_preload_plugins(plugin_table)) {
+			pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to preload some plugin libraries\n");
+			logging(LOG_WARNING, __FILE__, __LINE__, "Unable to preload some plugin libraries\n");
+		}
+	}
+	//Load storage devices
+	if (oph_iostore_load_devices()) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to load storage devices\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to load storage devices\n");
+		oph_unload_plugins(&plugin_table, &oph_function_table);
+		oph_server_conf_unload(&conf_db);
+		return -1;
+	}
 	//Setup MetaDB
 	if (oph_metadb_load_schema(&db_table, 1)) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to load MetaDB\n");
 		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to load MetaDB\n");
 		oph_unload_plugins(&plugin_table, &oph_function_table);
+		oph_iostore_unload_devices();
 		oph_metadb_unload_schema(db_table);
 		oph_server_conf_unload(&conf_db);
 		return -1;
@@ -253,20 +347,12 @@ int main(int argc, char *argv[])
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "Error while listening TCP socket\n");
 		logging(LOG_ERROR, __FILE__, __LINE__, "Error while listening TCP socket\n");
 		oph_unload_plugins(&plugin_table, &oph_function_table);
+		oph_iostore_unload_devices();
 		oph_metadb_unload_schema(db_table);
 		oph_server_conf_unload(&conf_db);
 		return -1;
 	}
 
-	cliaddr = (struct sockaddr *) malloc(addrlen);
-	if (cliaddr == NULL) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate buffer for client address\n");
-		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate buffer for client address\n");
-		oph_unload_plugins(&plugin_table, &oph_function_table);
-		oph_metadb_unload_schema(db_table);
-		oph_server_conf_unload(&conf_db);
-		return -1;
-	}
 	//Signal(SIGPIPE, SIG_IGN);
 	oph_net_signal(SIGINT, release);
 	oph_net_signal(SIGABRT, release);
@@ -278,87 +364,67 @@ int main(int argc, char *argv[])
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "ESDM cannot be initialized\n");
 		logging(LOG_ERROR, __FILE__, __LINE__, "ESDM cannot be initialized\n");
 		oph_unload_plugins(&plugin_table, &oph_function_table);
+		oph_iostore_unload_devices();
 		oph_metadb_unload_schema(db_table);
 		oph_server_conf_unload(&conf_db);
 		return -1;
 	}
 #endif
 
-	//Startup client connections
-	for (;;) {
-		clilen = addrlen;
-
-
-		pmesg(LOG_DEBUG, __FILE__, __LINE__, "Waiting for a request...\n");
-		logging(LOG_DEBUG, __FILE__, __LINE__, "Waiting for a request...\n");
-
-		if (oph_net_accept(listenfd, cliaddr, &clilen, &tmpconnfd) != 0) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Error on connection\n");
-			logging(LOG_ERROR, __FILE__, __LINE__, "Error on connection\n");
-			continue;
-		}
-
-		pmesg(LOG_DEBUG, __FILE__, __LINE__, "Connection established on socket %d\n", tmpconnfd);
-		logging(LOG_DEBUG, __FILE__, __LINE__, "Connection established on socket %d\n", tmpconnfd);
-
-		//TODO Manage multiple connections with poll
+	//Startup workers and event loop
+	if (oph_io_server_pool_start(listenfd, worker_num, &server_pool)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to start worker pool\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to start worker pool\n");
+		close(listenfd);
+		oph_unload_plugins(&plugin_table, &oph_function_table);
+		oph_iostore_unload_devices();
+		oph_metadb_unload_schema(db_table);
+		oph_server_conf_unload(&conf_db);
+		oph_server_memory_finalize();
+		return -1;
+	}
 
-		connfd = (int *) malloc(sizeof(int));
-		*connfd = tmpconnfd;
-		if (pthread_create(&tid, NULL, &server_child, (void *) connfd) != 0) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Error creating thread\n");
-			logging(LOG_ERROR, __FILE__, __LINE__, "Error creating thread\n");
-			continue;
-		}
-		connfd = NULL;
+	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Serving requests with %u workers\n", worker_num);
+	logging(LOG_DEBUG, __FILE__, __LINE__, "Serving requests with %u workers\n", worker_num);
 
+	if (oph_io_server_pool_run(server_pool)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Error in event loop\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Error in event loop\n");
 	}
-
 	//Cleanup procedures
-	free(cliaddr);
+	oph_io_server_pool_stop(&server_pool);
+	close(listenfd);
 	oph_metadb_unload_schema(db_table);
 	oph_server_conf_unload(&conf_db);
 	oph_unload_plugins(&plugin_table, &oph_function_table);
+	oph_iostore_unload_devices();
+	oph_server_memory_finalize();
+#ifdef OPH_IO_SERVER_NETCDF
+	oph_io_server_nc_cache_finalize();
+#ifdef OPH_PAR_NC4
+	oph_io_server_nc_loader_finalize();
+#endif
+#endif
 
 	return 0;
 }
 
-void *server_child(void *arg)
-{
-	void oph_io_server_thread(int, pthread_t);
-
-	if (pthread_detach(pthread_self()) != 0)
-		return (NULL);
-
-	pthread_t tid = pthread_self();
-
-	pmesg(LOG_DEBUG, __FILE__, __LINE__, "LAUNCHING THREAD...\n");
-	oph_io_server_thread(*((int *) arg), tid);
-
-	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Closing the connection...\n");
-	logging(LOG_DEBUG, __FILE__, __LINE__, "Closing the connection...\n");
-
-	if (close(*((int *) arg)) == -1)
-		pmesg(LOG_WARNING, __FILE__, __LINE__, "Error while closing connection!\n");
-
-	free((int *) arg);
-
-	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Connection closed\n");
-	logging(LOG_DEBUG, __FILE__, __LINE__, "Connection closed\n");
-
-	pmesg(LOG_DEBUG, __FILE__, __LINE__, "CLOSING THREAD...\n");
-	return (NULL);
-}
-
 //Garbage collecition function
 void release(int signo)
 {
 	//Cleanup procedures
 	logging(LOG_DEBUG, __FILE__, __LINE__, "Catched signal %d\n", signo);
-	free(cliaddr);
 	oph_metadb_unload_schema(db_table);
 	oph_unload_plugins(&plugin_table, &oph_function_table);
+	oph_iostore_unload_devices();
 	oph_server_conf_unload(&conf_db);
+	oph_server_memory_finalize();
+#ifdef OPH_IO_SERVER_NETCDF
+	oph_io_server_nc_cache_finalize();
+#ifdef OPH_PAR_NC4
+	oph_io_server_nc_loader_finalize();
+#endif
+#endif
 
 #ifdef OPH_IO_SERVER_ESDM
 	esdm_finalize();
@@ -20,22 +20,32 @@
 
 #include <stdlib.h>
 #include <stdio.h>
-#include <ltdl.h>
 #include <string.h>
 #include <debug.h>
 #include <errno.h>
 
 #include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/shm.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "oph_server_utility.h"
 #include "oph_io_server_query_manager.h"
+#include "oph_io_server_nc_loader.h"
 #include <netcdf.h>
 
-#define INT_LEN 13
-#define MSG_LEN 4096
+//NetCDF variable kept open between consecutive requests
+typedef struct _oph_io_server_nc_load_handle {
+	char *src_path;
+	char *measure_name;
+	int ncid;
+	int varid;
+	nc_type vartype;
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	time_t mtime;
+} oph_io_server_nc_load_handle;
 
 int _oph_ioserver_nc_get_dimension_id(unsigned long residual, unsigned long total, unsigned int *sizemax, size_t ** id, int i, int n)
 {
@@ -63,244 +73,144 @@ int oph_ioserver_nc_compute_dimension_id(unsigned long ID, unsigned int *sizemax
 	return 0;
 }
 
-int main(int argc, char *argv[])
+static void oph_io_server_nc_load_close(oph_io_server_nc_load_handle * handle)
 {
-#ifdef DEBUG
-	int msglevel = LOG_DEBUG_T;
-#else
-	int msglevel = LOG_INFO_T;
-#endif
-
-	set_debug_level(msglevel);
-
-	if (argc > 1) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Arguments are not correct\n");
-		return OPH_IO_SERVER_EXEC_ERROR;
+	if (handle->src_path) {
+		nc_close(handle->ncid);
+		free(handle->src_path);
+		handle->src_path = NULL;
 	}
-	//Get input values
-	char msg[MSG_LEN] = { '\0' };
-	if (read(STDIN_FILENO, msg, MSG_LEN) == -1) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to get message from master process: %s\n", strerror(errno));
-		return OPH_IO_SERVER_EXEC_ERROR;
+	if (handle->measure_name) {
+		free(handle->measure_name);
+		handle->measure_name = NULL;
 	}
-	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Arguments %s\n", msg);
+}
 
-	//Convert string to input values
-	int i = 0;
-	char *ptr = NULL;
-	if ((ptr = strchr(msg, '|')) == NULL) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to parse message from master process\n");
-		return OPH_IO_SERVER_EXEC_ERROR;
-	}
-	*ptr = 0;
-	int shm_id = strtol(msg, NULL, 10);
-	char *src_path = ptr + 1;
-	if ((ptr = strchr(ptr + 1, '|')) == NULL) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to parse message from master process\n");
-		return OPH_IO_SERVER_EXEC_ERROR;
-	}
-	*ptr = 0;
-	char *measure_name = ptr + 1;
-	if ((ptr = strchr(ptr + 1, '|')) == NULL) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to parse message from master process\n");
-		return OPH_IO_SERVER_EXEC_ERROR;
-	}
-	*ptr = 0;
-	//Check number of values in start and count
-	char *start_msg = ptr + 1;
-	if ((ptr = strchr(ptr + 1, '|')) == NULL) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to parse message from master process\n");
-		return OPH_IO_SERVER_EXEC_ERROR;
-	}
-	*ptr = 0;
-	char *count_msg = ptr + 1;
-	if ((ptr = strchr(ptr + 1, '|')) == NULL) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to parse message from master process\n");
-		return OPH_IO_SERVER_EXEC_ERROR;
-	}
-	*ptr = 0;
-	int offset = strtol(ptr + 1, NULL, 10);
-	if ((ptr = strchr(ptr + 1, '|')) == NULL) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to parse message from master process\n");
+//The file is reopened only if it is different from the previous one or if it has been changed on disk
+static int oph_io_server_nc_load_open(oph_io_server_nc_load_handle * handle, char *src_path, char *measure_name)
+{
+	int retval = 0;
+	struct stat st;
+	if (stat(src_path, &st)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s': %s\n", src_path, strerror(errno));
+		oph_io_server_nc_load_close(handle);
 		return OPH_IO_SERVER_EXEC_ERROR;
 	}
-	*ptr = 0;
-	unsigned long long tuples = strtoll(ptr + 1, NULL, 10);
-	unsigned long long idDim = 0;
-	char *sizemax_msg = NULL;
-	int nexp = 1;
-	char *dims_index_msg = NULL;
-	char *dims_start_msg = NULL;
-	if (tuples > 1) {
-		if ((ptr = strchr(ptr + 1, '|')) == NULL) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to parse message from master process\n");
-			return OPH_IO_SERVER_EXEC_ERROR;
-		}
-		*ptr = 0;
-		idDim = strtoll(ptr + 1, NULL, 10);
-		if ((ptr = strchr(ptr + 1, '|')) == NULL) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to parse message from master process\n");
-			return OPH_IO_SERVER_EXEC_ERROR;
-		}
-		*ptr = 0;
-		nexp = strtol(ptr + 1, NULL, 10);
-		if ((ptr = strchr(ptr + 1, '|')) == NULL) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to parse message from master process\n");
-			return OPH_IO_SERVER_EXEC_ERROR;
-		}
-		*ptr = 0;
-		sizemax_msg = ptr + 1;
-		if ((ptr = strchr(ptr + 1, '|')) == NULL) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to parse message from master process\n");
+
+	if (!handle->src_path || strcmp(handle->src_path, src_path) || (handle->dev != st.st_dev) || (handle->ino != st.st_ino) || (handle->size != st.st_size)
+	    || (handle->mtime != st.st_mtime)) {
+		oph_io_server_nc_load_close(handle);
+		if ((retval = nc_open(src_path, NC_NOWRITE, &(handle->ncid)))) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s': %s\n", src_path, nc_strerror(retval));
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
-		*ptr = 0;
-		dims_index_msg = ptr + 1;
-		if ((ptr = strchr(ptr + 1, '|')) == NULL) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to parse message from master process\n");
-			return OPH_IO_SERVER_EXEC_ERROR;
+		if (!(handle->src_path = strdup(src_path))) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Memory alloc error\n");
+			nc_close(handle->ncid);
+			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
-		*ptr = 0;
-		dims_start_msg = ptr + 1;
-	}
-
-	char *c1 = start_msg;
-	char *c2 = count_msg;
-	int j, n1 = 0, n2 = 0;
-	do {
-		if (*c1 == ';')
-			n1++;
-	}
-	while (*c1++);
-	do {
-		if (*c2 == ';')
-			n2++;
-	}
-	while (*c2++);
-
-	if (n1 != n2) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Arguments are not correct\n");
-		return OPH_IO_SERVER_EXEC_ERROR;
-	}
-	//Convert strings back to arrays of size_t
-	size_t *start = (size_t *) malloc(n1 * sizeof(size_t));
-	size_t *count = (size_t *) malloc(n2 * sizeof(size_t));
-	char *start_ptr = start_msg, *count_ptr = count_msg;
-	for (i = 0; i < n1; i++) {
-		start[i] = (size_t) strtol(start_ptr, &start_ptr, 10);
-		count[i] = (size_t) strtol(count_ptr, &count_ptr, 10);
-		*start_ptr++;
-		*count_ptr++;
+		handle->dev = st.st_dev;
+		handle->ino = st.st_ino;
+		handle->size = st.st_size;
+		handle->mtime = st.st_mtime;
 	}
 
-	unsigned int *sizemax = NULL;
-	int *dims_index = NULL;
-	int *dims_start = NULL;
-	if (tuples > 1) {
-		char *c3 = sizemax_msg;
-		int n3 = 0;
-		do {
-			if (*c3 == ';')
-				n3++;
-		}
-		while (*c3++);
-		if (nexp != n3) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Arguments are not correct\n");
-			return OPH_IO_SERVER_EXEC_ERROR;
+	if (!handle->measure_name || strcmp(handle->measure_name, measure_name)) {
+		if (handle->measure_name) {
+			free(handle->measure_name);
+			handle->measure_name = NULL;
 		}
-		c3 = dims_index_msg;
-		n3 = 0;
-		do {
-			if (*c3 == ';')
-				n3++;
-		}
-		while (*c3++);
-		if (n1 != n3) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Arguments are not correct\n");
+		if ((retval = nc_inq_varid(handle->ncid, measure_name, &(handle->varid)))) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information: %s\n", nc_strerror(retval));
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
-		c3 = dims_start_msg;
-		n3 = 0;
-		do {
-			if (*c3 == ';')
-				n3++;
-		}
-		while (*c3++);
-		if (n1 != n3) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Arguments are not correct\n");
+		//Get information from id
+		if ((retval = nc_inq_vartype(handle->ncid, handle->varid, &(handle->vartype)))) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information: %s\n", nc_strerror(retval));
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
-		sizemax = (unsigned int *) malloc(nexp * sizeof(unsigned int));
-		dims_index = (int *) malloc(n1 * sizeof(int));
-		dims_start = (int *) malloc(n1 * sizeof(int));
-		char *sizemax_ptr = sizemax_msg;
-		char *dims_index_ptr = dims_index_msg;
-		char *dims_start_ptr = dims_start_msg;
-		for (i = 0; i < nexp; i++) {
-			sizemax[i] = (unsigned int) strtol(sizemax_ptr, &sizemax_ptr, 10);
-			*sizemax_ptr++;
-		}
-		for (i = 0; i < n1; i++) {
-			dims_index[i] = (int) strtol(dims_index_ptr, &dims_index_ptr, 10);
-			dims_start[i] = (int) strtol(dims_start_ptr, &dims_start_ptr, 10);
-			*dims_index_ptr++;
-			*dims_start_ptr++;
+		if (!(handle->measure_name = strdup(measure_name))) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Memory alloc error\n");
+			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
 	}
-	//Fill binary cache
-	int res = -1, retval = -1, ncfile_id = 0, varid = 0;
-	char *buffer = NULL;
 
-	//Attach shared memory segment to process
-	if ((buffer = shmat(shm_id, NULL, 0)) == (char *) -1) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to attach shared memory segment\n");
-		return OPH_IO_SERVER_MEMORY_ERROR;
-	}
+	return OPH_IO_SERVER_SUCCESS;
+}
 
-	if ((retval = nc_open(src_path, NC_NOWRITE, &ncfile_id))) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s': %s\n", src_path, nc_strerror(retval));
-		return OPH_IO_SERVER_EXEC_ERROR;
+static size_t oph_io_server_nc_load_sizeof(nc_type vartype)
+{
+	switch (vartype) {
+		case NC_BYTE:
+		case NC_CHAR:
+			return sizeof(char);
+		case NC_SHORT:
+			return sizeof(short);
+		case NC_INT:
+			return sizeof(int);
+		case NC_INT64:
+			return sizeof(long long);
+		case NC_FLOAT:
+			return sizeof(float);
+		default:
+			return sizeof(double);
 	}
+}
 
-	if ((retval = nc_inq_varid(ncfile_id, measure_name, &varid))) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information: %s\n", nc_strerror(retval));
-		nc_close(ncfile_id);
-		return OPH_IO_SERVER_EXEC_ERROR;
-	}
-	//Get information from id
-	nc_type vartype;
-	if ((retval = nc_inq_vartype(ncfile_id, varid, &vartype))) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information: %s\n", nc_strerror(retval));
-		nc_close(ncfile_id);
+static int oph_io_server_nc_load_read(oph_io_server_nc_load_handle * handle, int shm_fd, oph_io_server_nc_loader_request * request)
+{
+	int i = 0, j = 0, res = 0, ndims = request->ndims, nexp = request->nexp;
+	size_t *start = request->start, *count = request->count;
+	unsigned long long offset = request->offset, tuples = request->tuples, idDim = request->id_dim;
+
+	if (oph_io_server_nc_load_open(handle, request->src_path, request->measure_name))
 		return OPH_IO_SERVER_EXEC_ERROR;
-	}
+	nc_type vartype = handle->vartype;
 
-	unsigned int num_elems = 1;
-	for (i = 0; i < n2; ++i)
+	unsigned long long num_elems = 1;
+	for (i = 0; i < ndims; ++i)
 		num_elems *= count[i];
 
-	size_t *start_pointer[nexp];
+	//Map the shared memory area, after checking that the values fit in it
+	struct stat st;
+	if (fstat(shm_fd, &st) || ((offset + num_elems * tuples) * oph_io_server_nc_load_sizeof(vartype) > (unsigned long long) st.st_size)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Shared memory segment is too small\n");
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+	char *buffer = NULL;
+	if ((buffer = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0)) == MAP_FAILED) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to attach shared memory segment\n");
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+
+	size_t *start_pointer[nexp > 0 ? nexp : 1];
 	if (tuples > 1) {
 		for (j = 0; j < nexp; j++) {
-			for (i = 0; i < n1; i++) {
-				if ( /*dims_type[i] && */ dims_index[i] == j) {	// Check on type is useless due to the specific setting of dims_index
+			start_pointer[j] = NULL;
+			for (i = 0; i < ndims; i++) {
+				if ( /*dims_type[i] && */ request->dims_index[i] == j) {	// Check on type is useless due to the specific setting of dims_index
 					start_pointer[j] = &(start[i]);
 					break;
 				}
 			}
+			if (!start_pointer[j]) {
+				pmesg(LOG_ERROR, __FILE__, __LINE__, "Arguments are not correct\n");
+				munmap(buffer, st.st_size);
+				return OPH_IO_SERVER_EXEC_ERROR;
+			}
 		}
 	}
 
 	unsigned long long ii;
-	for (ii = 0; ii < tuples; idDim++) {
+	for (ii = 0; (ii < tuples) && !res; idDim++) {
 
 		if (tuples > 1) {
-			oph_ioserver_nc_compute_dimension_id(idDim, sizemax, nexp, start_pointer);
+			oph_ioserver_nc_compute_dimension_id(idDim, request->sizemax, nexp, start_pointer);
 			for (i = 0; i < nexp; i++) {
 				*(start_pointer[i]) -= 1;
-				for (j = 0; j < n1; j++) {
+				for (j = 0; j < ndims; j++) {
 					if (start_pointer[i] == &(start[j])) {
-						*(start_pointer[i]) += dims_start[j];
+						*(start_pointer[i]) += request->dims_start[j];
 						/* TODO
 						   // Correction due to multiple files
 						   if (j == dim_unlim)
@@ -314,25 +224,25 @@ int main(int argc, char *argv[])
 		switch (vartype) {
 			case NC_BYTE:
 			case NC_CHAR:
-				res = nc_get_vara_uchar(ncfile_id, varid, start, count, (unsigned char *) buffer + offset);
+				res = nc_get_vara_uchar(handle->ncid, handle->varid, start, count, (unsigned char *) buffer + offset);
 				break;
 			case NC_SHORT:
-				res = nc_get_vara_short(ncfile_id, varid, start, count, (short *) buffer + offset);
+				res = nc_get_vara_short(handle->ncid, handle->varid, start, count, (short *) buffer + offset);
 				break;
 			case NC_INT:
-				res = nc_get_vara_int(ncfile_id, varid, start, count, (int *) buffer + offset);
+				res = nc_get_vara_int(handle->ncid, handle->varid, start, count, (int *) buffer + offset);
 				break;
 			case NC_INT64:
-				res = nc_get_vara_longlong(ncfile_id, varid, start, count, (long long *) buffer + offset);
+				res = nc_get_vara_longlong(handle->ncid, handle->varid, start, count, (long long *) buffer + offset);
 				break;
 			case NC_FLOAT:
-				res = nc_get_vara_float(ncfile_id, varid, start, count, (float *) buffer + offset);
+				res = nc_get_vara_float(handle->ncid, handle->varid, start, count, (float *) buffer + offset);
 				break;
 			case NC_DOUBLE:
-				res = nc_get_vara_double(ncfile_id, varid, start, count, (double *) buffer + offset);
+				res = nc_get_vara_double(handle->ncid, handle->varid, start, count, (double *) buffer + offset);
 				break;
 			default:
-				res = nc_get_vara_double(ncfile_id, varid, start, count, (double *) buffer + offset);
+				res = nc_get_vara_double(handle->ncid, handle->varid, start, count, (double *) buffer + offset);
 		}
 
 		ii++;
@@ -340,23 +250,49 @@ int main(int argc, char *argv[])
 			offset += num_elems;
 	}
 
-	nc_close(ncfile_id);
-
 	//Detach shared memory segment
-	shmdt(buffer);
-
-	free(start);
-	free(count);
-	if (tuples > 1) {
-		free(sizemax);
-		free(dims_start);
-	}
+	munmap(buffer, st.st_size);
 
 	if (res != 0) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, "Error in binary array filling: %s\n", nc_strerror(res));
 		return OPH_IO_SERVER_MEMORY_ERROR;
-	} else {
-		pmesg(LOG_DEBUG, __FILE__, __LINE__, "Data correctly loaded in shared memory\n");
-		return OPH_IO_SERVER_SUCCESS;
 	}
+
+	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Data correctly loaded in shared memory\n");
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+#ifdef DEBUG
+	int msglevel = LOG_DEBUG_T;
+#else
+	int msglevel = LOG_INFO_T;
+#endif
+
+	set_debug_level(msglevel);
+
+	if (argc > 1) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Arguments are not correct\n");
+		return OPH_IO_SERVER_EXEC_ERROR;
+	}
+
+	//Serve the requests of the master process, received on STDIN, until it closes the connection
+	size_t msg[OPH_IO_SERVER_NC_LOADER_MSG_LEN / sizeof(size_t)];
+	oph_io_server_nc_loader_request request;
+	oph_io_server_nc_load_handle handle;
+	memset(&handle, 0, sizeof(oph_io_server_nc_load_handle));
+	int shm_fd = -1, res = 0;
+
+	while (!oph_io_server_nc_loader_recv(STDIN_FILENO, msg, sizeof(msg), &shm_fd, &request)) {
+		pmesg(LOG_DEBUG, __FILE__, __LINE__, "Loading '%s' from '%s'\n", request.measure_name, request.src_path);
+		res = oph_io_server_nc_load_read(&handle, shm_fd, &request);
+		close(shm_fd);
+		if (oph_io_server_nc_loader_reply(STDIN_FILENO, res))
+			break;
+	}
+
+	oph_io_server_nc_load_close(&handle);
+
+	return OPH_IO_SERVER_SUCCESS;
 }
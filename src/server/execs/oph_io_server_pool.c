@@ -0,0 +1,418 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "oph_io_server_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "debug.h"
+#include "oph_network.h"
+
+extern int msglevel;
+
+//Global server variables (read-only)
+extern unsigned long long max_packet_length;
+extern unsigned short client_ttl;
+extern unsigned int active_workers;
+
+//Called with pool lock acquired
+static void _oph_io_server_pool_close_connection(oph_io_server_pool * pool, oph_io_server_connection * conn)
+{
+	epoll_ctl(pool->epollfd, EPOLL_CTL_DEL, conn->sockfd, NULL);
+	if (conn->sockfd < pool->table_size)
+		pool->connections[conn->sockfd] = NULL;
+
+	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Closing the connection on socket %d...\n", conn->sockfd);
+	logging(LOG_DEBUG, __FILE__, __LINE__, "Closing the connection on socket %d...\n", conn->sockfd);
+
+	if (close(conn->sockfd) == -1)
+		pmesg(LOG_WARNING, __FILE__, __LINE__, "Error while closing connection!\n");
+
+	oph_io_server_free_status(&(conn->status));
+	oph_net_reader_destroy(&(conn->reader));
+	free(conn);
+}
+
+//Called with pool lock acquired
+static int _oph_io_server_pool_add_connection(oph_io_server_pool * pool, int sockfd)
+{
+	//Grow connection table, if needed
+	if (sockfd >= pool->table_size) {
+		int new_size = pool->table_size;
+		while (new_size <= sockfd)
+			new_size *= 2;
+		oph_io_server_connection **tmp = (oph_io_server_connection **) realloc(pool->connections, new_size * sizeof(oph_io_server_connection *));
+		if (!tmp)
+			return OPH_IO_SERVER_POOL_MEMORY_ERROR;
+		memset(tmp + pool->table_size, 0, (new_size - pool->table_size) * sizeof(oph_io_server_connection *));
+		pool->connections = tmp;
+		pool->table_size = new_size;
+	}
+
+	oph_io_server_connection *conn = (oph_io_server_connection *) malloc(sizeof(oph_io_server_connection));
+	if (!conn)
+		return OPH_IO_SERVER_POOL_MEMORY_ERROR;
+	conn->sockfd = sockfd;
+	if (oph_net_reader_create(sockfd, 0, &(conn->reader))) {
+		free(conn);
+		return OPH_IO_SERVER_POOL_MEMORY_ERROR;
+	}
+	conn->busy = 0;
+	conn->last_access = time(NULL);
+	conn->next = NULL;
+	oph_io_server_init_status(&(conn->status));
+
+	//Workers do not wait for a client for longer than CLIENT_TTL
+	struct timeval timeout;
+	timeout.tv_sec = client_ttl;
+	timeout.tv_usec = 0;
+	if (setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) || setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout))) {
+		pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to set timeout on socket %d\n", sockfd);
+		logging(LOG_WARNING, __FILE__, __LINE__, "Unable to set timeout on socket %d\n", sockfd);
+	}
+
+	struct epoll_event event;
+	memset(&event, 0, sizeof(struct epoll_event));
+	event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+	event.data.fd = sockfd;
+	if (epoll_ctl(pool->epollfd, EPOLL_CTL_ADD, sockfd, &event)) {
+		oph_net_reader_destroy(&(conn->reader));
+		free(conn);
+		return OPH_IO_SERVER_POOL_ERROR;
+	}
+	pool->connections[sockfd] = conn;
+
+	return OPH_IO_SERVER_POOL_SUCCESS;
+}
+
+//Called with pool lock acquired
+static void _oph_io_server_pool_close_idle_connections(oph_io_server_pool * pool)
+{
+	time_t now = time(NULL);
+	int i;
+	for (i = 0; i < pool->table_size; i++) {
+		if (pool->connections[i] && !pool->connections[i]->busy && (now - pool->connections[i]->last_access > (time_t) client_ttl)) {
+			pmesg(LOG_WARNING, __FILE__, __LINE__, "Timeout occured\n");
+			logging(LOG_WARNING, __FILE__, __LINE__, "Timeout occured\n");
+			_oph_io_server_pool_close_connection(pool, pool->connections[i]);
+		}
+	}
+}
+
+//Check the request buffered by the reader of a connection
+static int _oph_io_server_pool_check_frame(oph_io_server_connection * conn, size_t * length)
+{
+	return oph_io_server_check_frame(conn->reader->buffer + conn->reader->head, oph_net_reader_pending(conn->reader), length);
+}
+
+//Called with pool lock acquired: read without blocking the data available on a connection. It returns OPH_IO_SERVER_FRAME_COMPLETE when a whole request has been buffered,
+//OPH_IO_SERVER_FRAME_INCOMPLETE when more data is needed and OPH_IO_SERVER_FRAME_INVALID when the connection has to be closed
+static int _oph_io_server_pool_receive(oph_io_server_connection * conn)
+{
+	size_t length = 0;
+	ssize_t nread;
+	int frame;
+
+	for (;;) {
+		frame = _oph_io_server_pool_check_frame(conn, &length);
+		if (frame == OPH_IO_SERVER_FRAME_COMPLETE)
+			return frame;
+		if (frame == OPH_IO_SERVER_FRAME_INVALID) {
+			pmesg(LOG_WARNING, __FILE__, __LINE__, "Request length is too big ...\n");
+			logging(LOG_WARNING, __FILE__, __LINE__, "Request length is too big ...\n");
+			oph_io_server_send_error(conn->sockfd);
+			return frame;
+		}
+		if (!(nread = oph_net_reader_fill(conn->reader, length)))
+			return OPH_IO_SERVER_FRAME_INCOMPLETE;
+		if (nread < 0) {
+			if (nread != OPH_NETWORK_EOF) {
+				pmesg(LOG_WARNING, __FILE__, __LINE__, "Error while reading from socket %d\n", conn->sockfd);
+				logging(LOG_WARNING, __FILE__, __LINE__, "Error while reading from socket %d\n", conn->sockfd);
+			}
+			return OPH_IO_SERVER_FRAME_INVALID;
+		}
+		conn->last_access = time(NULL);
+	}
+}
+
+//Called with pool lock acquired: wait for the next data on a connection
+static int _oph_io_server_pool_rearm(oph_io_server_pool * pool, oph_io_server_connection * conn)
+{
+	struct epoll_event event;
+	memset(&event, 0, sizeof(struct epoll_event));
+	event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+	event.data.fd = conn->sockfd;
+	if (epoll_ctl(pool->epollfd, EPOLL_CTL_MOD, conn->sockfd, &event)) {
+		pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to wait for requests on socket %d\n", conn->sockfd);
+		logging(LOG_WARNING, __FILE__, __LINE__, "Unable to wait for requests on socket %d\n", conn->sockfd);
+		return OPH_IO_SERVER_POOL_ERROR;
+	}
+	return OPH_IO_SERVER_POOL_SUCCESS;
+}
+
+static void *_oph_io_server_pool_worker(void *arg)
+{
+	oph_io_server_pool *pool = (oph_io_server_pool *) arg;
+	pthread_t tid = pthread_self();
+
+	//Communication buffers and query arena are shared by all the connections served by the worker
+	char *line = (char *) calloc(max_packet_length, sizeof(char));
+	char *result = (char *) calloc(max_packet_length, sizeof(char));
+	if (!line || !result) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate buffer for communications\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate buffer for communications\n");
+		if (line)
+			free(line);
+		if (result)
+			free(result);
+		return NULL;
+	}
+	oph_server_arena *query_arena = NULL;
+	if (oph_server_arena_create(&query_arena, 0)) {
+		pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to create query arena: heap will be used\n");
+		logging(LOG_WARNING, __FILE__, __LINE__, "Unable to create query arena: heap will be used\n");
+		query_arena = NULL;
+	}
+
+	oph_io_server_connection *conn = NULL;
+	int close_connection = 0;
+	size_t length = 0;
+
+	for (;;) {
+		pthread_mutex_lock(&(pool->lock));
+		while (!pool->stop && !pool->queue_head)
+			pthread_cond_wait(&(pool->cond), &(pool->lock));
+		if (pool->stop) {
+			pthread_mutex_unlock(&(pool->lock));
+			break;
+		}
+		conn = pool->queue_head;
+		pool->queue_head = conn->next;
+		if (!pool->queue_head)
+			pool->queue_tail = NULL;
+		conn->next = NULL;
+		pthread_mutex_unlock(&(pool->lock));
+
+		conn->status.query_arena = query_arena;
+		__atomic_add_fetch(&active_workers, 1, __ATOMIC_RELAXED);
+		//Only whole requests are handed to workers, so they are served without waiting for the client. Requests already buffered are not notified by epoll: serve them before re-arming
+		do
+			close_connection = oph_io_server_process_request(conn->sockfd, conn->reader, tid, &(conn->status), line, result);
+		while (!close_connection && (_oph_io_server_pool_check_frame(conn, &length) == OPH_IO_SERVER_FRAME_COMPLETE));
+		__atomic_sub_fetch(&active_workers, 1, __ATOMIC_RELAXED);
+		conn->status.query_arena = NULL;
+
+		pthread_mutex_lock(&(pool->lock));
+		conn->busy = 0;
+		conn->last_access = time(NULL);
+		//Re-arm the connection for the rest of the next request
+		if (!close_connection && ((_oph_io_server_pool_check_frame(conn, &length) == OPH_IO_SERVER_FRAME_INVALID) || _oph_io_server_pool_rearm(pool, conn)))
+			close_connection = 1;
+		if (close_connection)
+			_oph_io_server_pool_close_connection(pool, conn);
+		pthread_mutex_unlock(&(pool->lock));
+	}
+
+	oph_server_arena_destroy(&query_arena);
+	free(result);
+	free(line);
+
+	return NULL;
+}
+
+int oph_io_server_pool_start(int listenfd, unsigned int worker_num, oph_io_server_pool ** pool)
+{
+	if (!pool || !worker_num) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		return OPH_IO_SERVER_POOL_NULL_PARAM;
+	}
+
+	oph_io_server_pool *tmp = (oph_io_server_pool *) calloc(1, sizeof(oph_io_server_pool));
+	if (!tmp) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate worker pool\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate worker pool\n");
+		return OPH_IO_SERVER_POOL_MEMORY_ERROR;
+	}
+	tmp->listenfd = listenfd;
+	tmp->table_size = OPH_IO_SERVER_POOL_TABLE_SIZE;
+	tmp->connections = (oph_io_server_connection **) calloc(tmp->table_size, sizeof(oph_io_server_connection *));
+	tmp->workers = (pthread_t *) calloc(worker_num, sizeof(pthread_t));
+	if (!tmp->connections || !tmp->workers) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate worker pool\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate worker pool\n");
+		if (tmp->connections)
+			free(tmp->connections);
+		if (tmp->workers)
+			free(tmp->workers);
+		free(tmp);
+		return OPH_IO_SERVER_POOL_MEMORY_ERROR;
+	}
+	pthread_mutex_init(&(tmp->lock), NULL);
+	pthread_cond_init(&(tmp->cond), NULL);
+
+	struct epoll_event event;
+	memset(&event, 0, sizeof(struct epoll_event));
+	event.events = EPOLLIN;
+	event.data.fd = listenfd;
+	if (((tmp->epollfd = epoll_create1(EPOLL_CLOEXEC)) < 0) || epoll_ctl(tmp->epollfd, EPOLL_CTL_ADD, listenfd, &event)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to setup event loop: %d\n", errno);
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to setup event loop: %d\n", errno);
+		oph_io_server_pool_stop(&tmp);
+		return OPH_IO_SERVER_POOL_ERROR;
+	}
+
+	for (tmp->worker_num = 0; tmp->worker_num < worker_num; tmp->worker_num++) {
+		if (pthread_create(&(tmp->workers[tmp->worker_num]), NULL, &_oph_io_server_pool_worker, (void *) tmp)) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Error creating thread\n");
+			logging(LOG_ERROR, __FILE__, __LINE__, "Error creating thread\n");
+			oph_io_server_pool_stop(&tmp);
+			return OPH_IO_SERVER_POOL_ERROR;
+		}
+	}
+
+	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Started %u workers\n", worker_num);
+	logging(LOG_DEBUG, __FILE__, __LINE__, "Started %u workers\n", worker_num);
+
+	*pool = tmp;
+	return OPH_IO_SERVER_POOL_SUCCESS;
+}
+
+int oph_io_server_pool_run(oph_io_server_pool * pool)
+{
+	if (!pool) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		return OPH_IO_SERVER_POOL_NULL_PARAM;
+	}
+
+	struct epoll_event events[OPH_IO_SERVER_POOL_MAX_EVENTS];
+	oph_io_server_connection *conn = NULL;
+	int i, nfds, connfd, frame;
+	time_t last_check = time(NULL), now;
+
+	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Waiting for a request...\n");
+	logging(LOG_DEBUG, __FILE__, __LINE__, "Waiting for a request...\n");
+
+	while (!pool->stop) {
+		nfds = epoll_wait(pool->epollfd, events, OPH_IO_SERVER_POOL_MAX_EVENTS, OPH_IO_SERVER_POOL_WAIT_TIMEOUT);
+		if (nfds < 0) {
+			if (errno == EINTR)
+				continue;
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Error in polling sockets: %d\n", errno);
+			logging(LOG_ERROR, __FILE__, __LINE__, "Error in polling sockets: %d\n", errno);
+			return OPH_IO_SERVER_POOL_ERROR;
+		}
+
+		pthread_mutex_lock(&(pool->lock));
+		for (i = 0; i < nfds; i++) {
+			if (events[i].data.fd == pool->listenfd) {
+				if (oph_net_accept(pool->listenfd, NULL, NULL, &connfd) != 0) {
+					pmesg(LOG_ERROR, __FILE__, __LINE__, "Error on connection\n");
+					logging(LOG_ERROR, __FILE__, __LINE__, "Error on connection\n");
+					continue;
+				}
+				if (_oph_io_server_pool_add_connection(pool, connfd)) {
+					pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to handle connection on socket %d\n", connfd);
+					logging(LOG_ERROR, __FILE__, __LINE__, "Unable to handle connection on socket %d\n", connfd);
+					close(connfd);
+					continue;
+				}
+				pmesg(LOG_DEBUG, __FILE__, __LINE__, "Connection established on socket %d\n", connfd);
+				logging(LOG_DEBUG, __FILE__, __LINE__, "Connection established on socket %d\n", connfd);
+				continue;
+			}
+
+			if ((events[i].data.fd >= pool->table_size) || !(conn = pool->connections[events[i].data.fd]) || conn->busy)
+				continue;
+
+			if (!(events[i].events & EPOLLIN)) {
+				pmesg(LOG_WARNING, __FILE__, __LINE__, "Connection closed with error\n");
+				logging(LOG_WARNING, __FILE__, __LINE__, "Connection closed with error\n");
+				_oph_io_server_pool_close_connection(pool, conn);
+				continue;
+			}
+			//Hand the connection to a worker only when a whole request has been received
+			frame = _oph_io_server_pool_receive(conn);
+			if ((frame == OPH_IO_SERVER_FRAME_INCOMPLETE) && !_oph_io_server_pool_rearm(pool, conn))
+				continue;
+			if (frame != OPH_IO_SERVER_FRAME_COMPLETE) {
+				_oph_io_server_pool_close_connection(pool, conn);
+				continue;
+			}
+			conn->busy = 1;
+			if (pool->queue_tail)
+				pool->queue_tail->next = conn;
+			else
+				pool->queue_head = conn;
+			pool->queue_tail = conn;
+			pthread_cond_signal(&(pool->cond));
+		}
+
+		//Apply CLIENT_TTL to idle connections
+		now = time(NULL);
+		if (now != last_check) {
+			_oph_io_server_pool_close_idle_connections(pool);
+			last_check = now;
+		}
+		pthread_mutex_unlock(&(pool->lock));
+	}
+
+	return OPH_IO_SERVER_POOL_SUCCESS;
+}
+
+int oph_io_server_pool_stop(oph_io_server_pool ** pool)
+{
+	if (!pool || !*pool)
+		return OPH_IO_SERVER_POOL_NULL_PARAM;
+
+	oph_io_server_pool *tmp = *pool;
+	unsigned int i;
+
+	pthread_mutex_lock(&(tmp->lock));
+	tmp->stop = 1;
+	pthread_cond_broadcast(&(tmp->cond));
+	pthread_mutex_unlock(&(tmp->lock));
+
+	for (i = 0; i < tmp->worker_num; i++)
+		pthread_join(tmp->workers[i], NULL);
+
+	int j;
+	for (j = 0; j < tmp->table_size; j++)
+		if (tmp->connections[j])
+			_oph_io_server_pool_close_connection(tmp, tmp->connections[j]);
+
+	if (tmp->epollfd >= 0)
+		close(tmp->epollfd);
+	pthread_cond_destroy(&(tmp->cond));
+	pthread_mutex_destroy(&(tmp->lock));
+	free(tmp->connections);
+	free(tmp->workers);
+	free(tmp);
+	*pool = NULL;
+
+	return OPH_IO_SERVER_POOL_SUCCESS;
+}
@@ -20,14 +20,15 @@
 
 #include "oph_io_server_thread.h"
 
-#include <poll.h>
 #include <string.h>
 #include <errno.h>
 #include <stdio.h>
+#include <sys/uio.h>
+#include <endian.h>
 #include "debug.h"
 #include "taketime.h"
 
-#include "hashtbl.h"
+#include "oph_server_hashmap.h"
 #include "oph_server_utility.h"
 #include "oph_io_server_query_manager.h"
 
@@ -45,16 +46,34 @@ extern int msglevel;
 //Global server variables (read-only)
 extern unsigned long long max_packet_length;
 extern unsigned short omp_threads;
-extern unsigned short client_ttl;
-extern HASHTBL *plugin_table;
+extern oph_server_hashmap *plugin_table;
 
 extern pthread_rwlock_t rwlock;
 extern oph_metadb_db_row *db_table;
 
 //#define DEBUG
 
+int oph_io_server_init_status(oph_io_server_thread_status * status)
+{
+	if (!status)
+		return -1;
+
+	status->current_db = NULL;
+	status->last_result_set = NULL;
+	status->delete_only_rs = 0;
+	status->device = NULL;
+	status->curr_stmt = NULL;
+	status->query_arena = NULL;
+	status->prepared_stmts = NULL;
+	status->prepared_stmt_num = 0;
+	status->last_stmt_handle = 0;
+
+	return 0;
+}
+
 int oph_io_server_free_status(oph_io_server_thread_status * status)
 {
+	oph_io_server_free_stmts(status);
 
 	if (status->curr_stmt != NULL) {
 		if (status->curr_stmt->partial_result_set != NULL)
@@ -79,6 +98,9 @@ int oph_io_server_free_status(oph_io_server_thread_status * status)
 	status->last_result_set = NULL;
 	status->delete_only_rs = 0;
 
+	if (status->query_arena != NULL)
+		oph_server_arena_destroy(&(status->query_arena));
+
 	return 0;
 }
 
@@ -98,6 +120,136 @@ int oph_io_server_send_error(int sockfd)
 }
 
 
+static size_t _oph_io_server_format_value(oph_iostore_field_type type, void *value, char *buffer)
+{
+	if (type == OPH_IOSTORE_LONG_TYPE)
+		snprintf(buffer, OPH_IO_SERVER_MAX_LONG_LEN, "%llu", *((unsigned long long *) value));
+	else
+		snprintf(buffer, OPH_IO_SERVER_MAX_DOUBLE_LEN, "%f", *((double *) value));
+
+	return strlen(buffer) + 1;
+}
+
+int oph_io_server_send_result_set(int sockfd, oph_iostore_frag_record_set * rs, char binary)
+{
+	if (!rs)
+		return -1;
+
+	unsigned int num_fields = rs->field_num, j = 0, c = 0;
+	unsigned long long num_rows = 0, payload_len = 0, i = 0, value = 0, k = 0, text_size = 0, text_used = 0;
+	size_t header_len = OPH_IO_SERVER_MSG_TYPE_LEN + 2 * OPH_IO_SERVER_MSG_LONG_LEN + OPH_IO_SERVER_MSG_SHORT_LEN + (binary ? num_fields : 0);
+	int n = 0, res = 0;
+
+	char header[header_len];
+	char values[OPH_IO_SERVER_RS_BATCH_CELLS][OPH_IO_SERVER_MAX_DOUBLE_LEN];
+	unsigned long long lengths[OPH_IO_SERVER_RS_BATCH_CELLS];
+	struct iovec iov[2 * OPH_IO_SERVER_RS_BATCH_CELLS + 1];
+	oph_iostore_frag_record **record_set = rs->record_set;
+	char *text = NULL, *tmp = NULL;
+	unsigned long long *text_lengths = NULL;
+
+	//Payload length has to be sent first: in text mode numeric cells are converted once, before the header, and sent from the text buffer
+	if (record_set) {
+		unsigned int numeric_fields = 0;
+		for (j = 0; j < num_fields; j++)
+			if (rs->field_type[j] != OPH_IOSTORE_STRING_TYPE)
+				numeric_fields++;
+		for (num_rows = 0; record_set[num_rows]; num_rows++);
+
+		if (!binary && numeric_fields && num_rows) {
+			text_size = num_rows * numeric_fields * OPH_IO_SERVER_MAX_LONG_LEN;
+			text = (char *) malloc(text_size);
+			text_lengths = (unsigned long long *) malloc(num_rows * numeric_fields * sizeof(unsigned long long));
+			if (!text || !text_lengths) {
+				pmesg(LOG_ERROR, __FILE__, __LINE__, "Memory alloc error\n");
+				logging(LOG_ERROR, __FILE__, __LINE__, "Memory alloc error\n");
+				res = -1;
+			}
+		}
+
+		for (i = 0; !res && (i < num_rows); i++)
+			for (j = 0; j < num_fields; j++) {
+				if (rs->field_type[j] == OPH_IOSTORE_STRING_TYPE)
+					payload_len += OPH_IO_SERVER_MSG_LONG_LEN + record_set[i]->field_length[j];
+				else if (binary)
+					payload_len += OPH_IO_SERVER_MSG_BINARY_VALUE_LEN;
+				else {
+					if (text_size - text_used < OPH_IO_SERVER_MAX_DOUBLE_LEN) {
+						if (!(tmp = (char *) realloc(text, 2 * text_size))) {
+							pmesg(LOG_ERROR, __FILE__, __LINE__, "Memory alloc error\n");
+							logging(LOG_ERROR, __FILE__, __LINE__, "Memory alloc error\n");
+							res = -1;
+							break;
+						}
+						text = tmp;
+						text_size *= 2;
+					}
+					text_lengths[k] = _oph_io_server_format_value(rs->field_type[j], record_set[i]->field[j], text + text_used);
+					text_used += text_lengths[k];
+					payload_len += OPH_IO_SERVER_MSG_LONG_LEN + text_lengths[k++];
+				}
+			}
+	}
+
+	if (!res) {
+		memcpy(header, binary ? OPH_IO_SERVER_MSG_RESULT_BINARY : OPH_IO_SERVER_MSG_RESULT, OPH_IO_SERVER_MSG_TYPE_LEN);
+		memcpy(header + OPH_IO_SERVER_MSG_TYPE_LEN, &payload_len, OPH_IO_SERVER_MSG_LONG_LEN);
+		memcpy(header + OPH_IO_SERVER_MSG_TYPE_LEN + OPH_IO_SERVER_MSG_LONG_LEN, &num_rows, OPH_IO_SERVER_MSG_LONG_LEN);
+		memcpy(header + OPH_IO_SERVER_MSG_TYPE_LEN + 2 * OPH_IO_SERVER_MSG_LONG_LEN, &num_fields, OPH_IO_SERVER_MSG_SHORT_LEN);
+		if (binary)
+			for (j = 0; j < num_fields; j++)
+				header[OPH_IO_SERVER_MSG_TYPE_LEN + 2 * OPH_IO_SERVER_MSG_LONG_LEN + OPH_IO_SERVER_MSG_SHORT_LEN + j] = (char) rs->field_type[j];
+		iov[n].iov_base = header;
+		iov[n++].iov_len = header_len;
+
+		pmesg(LOG_DEBUG, __FILE__, __LINE__, "Sending %llu bytes\n", header_len + payload_len);
+		logging(LOG_DEBUG, __FILE__, __LINE__, "Sending %llu bytes\n", header_len + payload_len);
+	}
+	//Cells are sent in batches: string, binary and converted values are sent directly from their buffers
+	text_used = k = 0;
+	for (i = 0; !res && (i < num_rows); i++) {
+		for (j = 0; j < num_fields; j++) {
+			if (rs->field_type[j] == OPH_IOSTORE_STRING_TYPE) {
+				lengths[c] = record_set[i]->field_length[j];
+				iov[n].iov_base = &lengths[c];
+				iov[n++].iov_len = OPH_IO_SERVER_MSG_LONG_LEN;
+				iov[n].iov_base = record_set[i]->field[j];
+				iov[n++].iov_len = lengths[c];
+			} else if (binary) {
+				memcpy(&value, record_set[i]->field[j], OPH_IO_SERVER_MSG_BINARY_VALUE_LEN);
+				value = htole64(value);
+				memcpy(values[c], &value, OPH_IO_SERVER_MSG_BINARY_VALUE_LEN);
+				iov[n].iov_base = values[c];
+				iov[n++].iov_len = OPH_IO_SERVER_MSG_BINARY_VALUE_LEN;
+			} else {
+				iov[n].iov_base = &text_lengths[k];
+				iov[n++].iov_len = OPH_IO_SERVER_MSG_LONG_LEN;
+				iov[n].iov_base = text + text_used;
+				iov[n++].iov_len = text_lengths[k];
+				text_used += text_lengths[k++];
+			}
+
+			if (++c == OPH_IO_SERVER_RS_BATCH_CELLS) {
+				if (oph_net_writevn(sockfd, iov, n) < 0) {
+					res = -1;
+					break;
+				}
+				n = 0;
+				c = 0;
+			}
+		}
+	}
+	if (!res && n && (oph_net_writevn(sockfd, iov, n) < 0))
+		res = -1;
+
+	if (text)
+		free(text);
+	if (text_lengths)
+		free(text_lengths);
+
+	return res;
+}
+
 int oph_io_server_free_query_args(oph_query_arg ** args, unsigned int arg_count)
 {
 
@@ -116,23 +268,91 @@ int oph_io_server_free_query_args(oph_query_arg ** args, unsigned int arg_count)
 	return 0;
 }
 
-void oph_io_server_thread(int sockfd, pthread_t tid)
+//Skip a length field followed by the number of bytes it specifies: it returns non-0 if the field is not yet available or too long
+static int _oph_io_server_check_frame_field(const char *buffer, size_t size, size_t * pos, int *invalid)
 {
-	char *line = (char *) calloc(max_packet_length, sizeof(char));
-	if (!line) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate buffer for communications\n");
-		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate buffer for communications\n");
-		return;
+	unsigned long long len;
+
+	if (size < *pos + OPH_IO_SERVER_MSG_LONG_LEN) {
+		*pos += OPH_IO_SERVER_MSG_LONG_LEN;
+		return 1;
 	}
-	char *result = (char *) calloc(max_packet_length, sizeof(char));
-	if (!result) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate buffer for communications\n");
-		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate buffer for communications\n");
-		free(result);
-		return;
+	memcpy(&len, buffer + *pos, OPH_IO_SERVER_MSG_LONG_LEN);
+	if (len >= max_packet_length) {
+		*invalid = 1;
+		return 1;
 	}
+	*pos += OPH_IO_SERVER_MSG_LONG_LEN + len;
+
+	return *pos > size;
+}
+
+int oph_io_server_check_frame(const char *buffer, size_t size, size_t * length)
+{
+	size_t pos = OPH_IO_SERVER_MSG_TYPE_LEN;
+	unsigned long long len = 0;
+	unsigned int arg_count = 0, n;
+	int invalid = 0;
+
+	if (!buffer || !length)
+		return OPH_IO_SERVER_FRAME_INVALID;
+
+	//Fields are checked in the order they are read by oph_io_server_process_request
+	do {
+		if (size < pos)
+			break;
+		if (!strncasecmp(buffer, OPH_IO_SERVER_MSG_USE_DB, OPH_IO_SERVER_MSG_TYPE_LEN)) {
+			//Database and device names
+			if (_oph_io_server_check_frame_field(buffer, size, &pos, &invalid) || _oph_io_server_check_frame_field(buffer, size, &pos, &invalid))
+				break;
+		} else if (!strncasecmp(buffer, OPH_IO_SERVER_MSG_SET_QUERY, OPH_IO_SERVER_MSG_TYPE_LEN)) {
+			//Query or, if its length is 0, handle of the statement to be released
+			if (size < pos + OPH_IO_SERVER_MSG_LONG_LEN) {
+				pos += OPH_IO_SERVER_MSG_LONG_LEN;
+				break;
+			}
+			memcpy(&len, buffer + pos, OPH_IO_SERVER_MSG_LONG_LEN);
+			if (!len)
+				pos += 2 * OPH_IO_SERVER_MSG_LONG_LEN;
+			else if (_oph_io_server_check_frame_field(buffer, size, &pos, &invalid))
+				break;
+		} else if (!strncasecmp(buffer, OPH_IO_SERVER_MSG_EXEC_QUERY, OPH_IO_SERVER_MSG_TYPE_LEN)) {
+			//Number of arguments, query (or handle of a prepared statement) and device
+			if (size < pos + OPH_IO_SERVER_MSG_SHORT_LEN + OPH_IO_SERVER_MSG_LONG_LEN) {
+				pos += OPH_IO_SERVER_MSG_SHORT_LEN + OPH_IO_SERVER_MSG_LONG_LEN;
+				break;
+			}
+			memcpy(&arg_count, buffer + pos, OPH_IO_SERVER_MSG_SHORT_LEN);
+			arg_count--;
+			pos += OPH_IO_SERVER_MSG_SHORT_LEN;
+			memcpy(&len, buffer + pos, OPH_IO_SERVER_MSG_LONG_LEN);
+			if (!len)
+				pos += 2 * OPH_IO_SERVER_MSG_LONG_LEN;
+			else if (_oph_io_server_check_frame_field(buffer, size, &pos, &invalid))
+				break;
+			if (_oph_io_server_check_frame_field(buffer, size, &pos, &invalid))
+				break;
+			if (arg_count > 0) {
+				//Run counters and arguments (length, type and value)
+				pos += 2 * OPH_IO_SERVER_MSG_LONG_LEN;
+				for (n = 0; (n < arg_count) && (pos <= size) && (pos <= OPH_IO_SERVER_MAX_FRAME_PACKETS * max_packet_length); n++) {
+					if (_oph_io_server_check_frame_field(buffer, size, &pos, &invalid))
+						break;
+					pos += OPH_IO_SERVER_MSG_TYPE_LEN;
+				}
+			}
+		}
+	} while (0);
 
-	char header[OPH_IO_SERVER_MSG_TYPE_LEN + 1], buffer[OPH_IO_SERVER_MAX_DOUBLE_LEN];
+	*length = pos;
+	if (invalid || (pos > OPH_IO_SERVER_MAX_FRAME_PACKETS * max_packet_length))
+		return OPH_IO_SERVER_FRAME_INVALID;
+	return pos > size ? OPH_IO_SERVER_FRAME_INCOMPLETE : OPH_IO_SERVER_FRAME_COMPLETE;
+}
+
+int oph_io_server_process_request(int sockfd, oph_net_reader * reader, pthread_t tid, oph_io_server_thread_status * status, char *line, char *result)
+{
+	char header[OPH_IO_SERVER_MSG_TYPE_LEN + 1];
 	int res;
 	int m = 0;
 
@@ -143,60 +363,25 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 	struct timeval s_time, e_time, t_time;
 #endif
 
-	//Status of thread
-	oph_io_server_thread_status global_status;
-	global_status.current_db = NULL;
-	global_status.last_result_set = NULL;
-	global_status.delete_only_rs = 0;
-	global_status.device = NULL;
-	global_status.curr_stmt = NULL;
-
 	oph_metadb_db_row *db_row = NULL;
 
-	//Poll socket 
-	int rv;
-	struct pollfd ufds[1];
-
-	ufds[0].fd = sockfd;
-	ufds[0].events = POLLIN;	// check for normal or out-of-band
-
-	unsigned long long current_threshold = 0;
-	char *result_buffer = NULL;
-	char *tmp_buffer = NULL;
-	unsigned long long k = 0, i = 0;
-	unsigned int j = 0, n = 0;
-	unsigned long long size = 0;
-	unsigned int num_fields = 0;
+	unsigned int n = 0;
 	unsigned long long payload_len = 0;
 	unsigned int arg_count = 0;
 	unsigned long long tot_run = 0, curr_run = 0;
+	unsigned long long stmt_handle = 0;
 
-	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Waiting for a query from socket %d...\n", sockfd);
-	logging(LOG_DEBUG, __FILE__, __LINE__, "Waiting for a query from socket %d...\n", sockfd);
-	for (;;) {
+	//The connection is closed unless the request is completely served
+	int close_connection = 1;
+
+	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Reading a query from socket %d...\n", sockfd);
+	logging(LOG_DEBUG, __FILE__, __LINE__, "Reading a query from socket %d...\n", sockfd);
+	do {
 #ifdef DEBUG
 		//Get time from first call
 		gettimeofday(&start_time, NULL);
 #endif
-		// wait for events on the sockets, ttl second timeout
-		rv = poll(ufds, 1, client_ttl * 1000);
-
-		if (rv == -1) {
-			pmesg(LOG_WARNING, __FILE__, __LINE__, "Error in polling socket: %d\n", errno);
-			logging(LOG_WARNING, __FILE__, __LINE__, "Error in polling socket: %d\n", errno);
-			break;
-		} else if (rv == 0) {
-			pmesg(LOG_WARNING, __FILE__, __LINE__, "Timeout occured\n");
-			logging(LOG_WARNING, __FILE__, __LINE__, "Timeout occured\n");
-			break;
-		}
-		if (ufds[0].revents != POLLIN) {
-			pmesg(LOG_WARNING, __FILE__, __LINE__, "Connection closed with error\n");
-			logging(LOG_WARNING, __FILE__, __LINE__, "Connection closed with error\n");
-			break;
-		}
-
-		res = oph_net_readn(sockfd, line, OPH_IO_SERVER_MSG_TYPE_LEN);
+		res = oph_net_reader_readn(reader, line, OPH_IO_SERVER_MSG_TYPE_LEN);
 		if (res > 0) {
 			//Request Manager section: handle request and call the correct function
 
@@ -229,7 +414,7 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 				pmesg(LOG_DEBUG, __FILE__, __LINE__, "Setting default database...\n");
 				logging(LOG_DEBUG, __FILE__, __LINE__, "Setting default database...\n");
 				//Read payload len
-				res = oph_net_readn(sockfd, line, OPH_IO_SERVER_MSG_LONG_LEN);
+				res = oph_net_reader_readn(reader, line, OPH_IO_SERVER_MSG_LONG_LEN);
 				if (res <= 0)
 					break;
 				line[OPH_IO_SERVER_MSG_LONG_LEN] = 0;
@@ -238,7 +423,7 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 				logging(LOG_DEBUG, __FILE__, __LINE__, "Db name length: %llu\n", payload_len);
 
 				//Read database name
-				res = oph_net_readn(sockfd, line, payload_len);
+				res = oph_net_reader_readn(reader, line, payload_len);
 				if (res <= 0)
 					break;
 				line[payload_len] = 0;
@@ -246,7 +431,7 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 				logging(LOG_DEBUG, __FILE__, __LINE__, "Database name: %s\n", line);
 
 				//Read payload len
-				res = oph_net_readn(sockfd, result, OPH_IO_SERVER_MSG_LONG_LEN);
+				res = oph_net_reader_readn(reader, result, OPH_IO_SERVER_MSG_LONG_LEN);
 				if (res <= 0)
 					break;
 				result[OPH_IO_SERVER_MSG_LONG_LEN] = 0;
@@ -255,7 +440,7 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 				logging(LOG_DEBUG, __FILE__, __LINE__, "Device length: %llu\n", payload_len);
 
 				//Read device name
-				res = oph_net_readn(sockfd, result, payload_len);
+				res = oph_net_reader_readn(reader, result, payload_len);
 				if (res <= 0)
 					break;
 				result[payload_len] = 0;
@@ -263,10 +448,10 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 				logging(LOG_DEBUG, __FILE__, __LINE__, "Device name: %s\n", result);
 
 				//TODO perform coerence check to verify device existance
-				if (global_status.device)
-					free(global_status.device);
-				global_status.device = (char *) strndup(result, strlen(result));
-				if (global_status.device == NULL) {
+				if (status->device)
+					free(status->device);
+				status->device = (char *) strndup(result, strlen(result));
+				if (status->device == NULL) {
 					pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to set default device: %s\n", result);
 					logging(LOG_WARNING, __FILE__, __LINE__, "Unable to set default device: %s\n", result);
 					break;
@@ -280,7 +465,7 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 				}
 
 				if (db_table != NULL) {
-					if (oph_metadb_find_db(db_table, line, global_status.device, &db_row) || db_row == NULL) {
+					if (oph_metadb_find_db(db_table, line, status->device, &db_row) || db_row == NULL) {
 						if (pthread_rwlock_unlock(&rwlock) != 0) {
 							pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to unlock mutex\n");
 							logging(LOG_ERROR, __FILE__, __LINE__, "Unable to unlock mutex\n");
@@ -299,10 +484,10 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 							break;
 						}
 						//Set current db name
-						if (global_status.current_db)
-							free(global_status.current_db);
-						global_status.current_db = (char *) strndup(line, strlen(line));
-						if (global_status.current_db == NULL) {
+						if (status->current_db)
+							free(status->current_db);
+						status->current_db = (char *) strndup(line, strlen(line));
+						if (status->current_db == NULL) {
 							pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to set default device: %s\n", result);
 							logging(LOG_WARNING, __FILE__, __LINE__, "Unable to set default device: %s\n", result);
 							oph_io_server_send_error(sockfd);
@@ -333,133 +518,87 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 				}
 				pmesg(LOG_DEBUG, __FILE__, __LINE__, "Result sent\n");
 				logging(LOG_DEBUG, __FILE__, __LINE__, "Result sent\n");
-			} else if (STRCMP(header, OPH_IO_SERVER_MSG_RESULT) == 0) {
+			} else if ((STRCMP(header, OPH_IO_SERVER_MSG_RESULT) == 0) || (STRCMP(header, OPH_IO_SERVER_MSG_RESULT_BINARY) == 0)) {
 				//Get resultset
 				pmesg(LOG_DEBUG, __FILE__, __LINE__, "Retrieving result set...\n");
 
-				if (global_status.last_result_set == NULL) {
+				if (status->last_result_set == NULL) {
 					pmesg(LOG_WARNING, __FILE__, __LINE__, "Result set of last query is corrupted\n");
 					logging(LOG_WARNING, __FILE__, __LINE__, "Result set of last query is corrupted\n");
 					oph_io_server_send_error(sockfd);
 					break;
 				}
-				//Build request packet TYPE|PAYLOAD_LENGTH|NUM_ROWS|NUM_FIELDS|PAYLOAD
-				current_threshold = max_packet_length;
-				result_buffer = (char *) calloc(current_threshold, sizeof(char));
-				if (!result_buffer) {
-					pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate buffer for communications\n");
-					logging(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate buffer for communications\n");
+				//Stream packet TYPE|PAYLOAD_LENGTH|NUM_ROWS|NUM_FIELDS|[FIELD_TYPES|]PAYLOAD
+				if (oph_io_server_send_result_set(sockfd, status->last_result_set, STRCMP(header, OPH_IO_SERVER_MSG_RESULT_BINARY) == 0)) {
+					pmesg(LOG_ERROR, __FILE__, __LINE__, "Error while writing to socket\n");
+					logging(LOG_ERROR, __FILE__, __LINE__, "Error while writing to socket\n");
+					break;
+				}
+				pmesg(LOG_DEBUG, __FILE__, __LINE__, "Result sent\n");
+				logging(LOG_DEBUG, __FILE__, __LINE__, "Result sent\n");
+			} else if (STRCMP(header, OPH_IO_SERVER_MSG_SET_QUERY) == 0) {
+				//Prepare statement
+				pmesg(LOG_DEBUG, __FILE__, __LINE__, "Preparing statement...\n");
+				logging(LOG_DEBUG, __FILE__, __LINE__, "Preparing statement...\n");
+				//Read payload len
+				res = oph_net_reader_readn(reader, line, OPH_IO_SERVER_MSG_LONG_LEN);
+				if (res <= 0)
+					break;
+				payload_len = *((unsigned long long *) line);
+				pmesg(LOG_DEBUG, __FILE__, __LINE__, "Query length: %llu\n", payload_len);
+				logging(LOG_DEBUG, __FILE__, __LINE__, "Query length: %llu\n", payload_len);
+
+				if (payload_len >= max_packet_length) {
+					//Request too long
+					pmesg(LOG_WARNING, __FILE__, __LINE__, "Request length is too big ...\n");
+					logging(LOG_WARNING, __FILE__, __LINE__, "Request length is too big ...\n");
 					oph_io_server_send_error(sockfd);
 					break;
 				}
-				tmp_buffer = NULL;
-
-				m = snprintf(result_buffer, strlen(OPH_IO_SERVER_MSG_RESULT) + 1, OPH_IO_SERVER_MSG_RESULT);
-				k = m + sizeof(unsigned long long) + sizeof(unsigned long long) + sizeof(unsigned int);
-
-				i = 0;
-				j = 0;
-				size = 0;
-				num_fields = global_status.last_result_set->field_num;
-
-				if (k >= current_threshold) {
-					current_threshold *= 2;
-					tmp_buffer = (char *) realloc(result_buffer, current_threshold * sizeof(char));
-					if (!tmp_buffer) {
-						pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate buffer for communications\n");
-						logging(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate buffer for communications\n");
-						oph_io_server_send_error(sockfd);
-						free(result_buffer);
+
+				if (payload_len == 0) {
+					//Read handle of the statement to be released
+					res = oph_net_reader_readn(reader, line, OPH_IO_SERVER_MSG_LONG_LEN);
+					if (res <= 0)
 						break;
-					}
-					result_buffer = tmp_buffer;
-				}
-				//If non-empty record set
-				if (global_status.last_result_set->record_set != NULL) {
-
-					while (global_status.last_result_set->record_set[i]) {
-						//Send each row of result set
-
-						//TODO send also field name
-						for (j = 0; j < num_fields; j++) {
-							//Check field type
-							if (global_status.last_result_set->field_type[j] != OPH_IOSTORE_STRING_TYPE) {
-								//Convert to string
-								if (global_status.last_result_set->field_type[j] == OPH_IOSTORE_LONG_TYPE) {
-									snprintf(buffer, OPH_IO_SERVER_MAX_LONG_LEN, "%llu",
-										 *((unsigned long long *) global_status.last_result_set->record_set[i]->field[j]));
-								} else {
-									snprintf(buffer, OPH_IO_SERVER_MAX_DOUBLE_LEN, "%f", *((double *) global_status.last_result_set->record_set[i]->field[j]));
-								}
-								size = strlen(buffer) + 1;
-
-								//Check current size
-								if ((k + size + sizeof(unsigned long long)) >= current_threshold) {
-									current_threshold *= 2;
-									tmp_buffer = (char *) realloc(result_buffer, current_threshold * sizeof(char));
-									if (!tmp_buffer) {
-										pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate buffer for communications\n");
-										logging(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate buffer for communications\n");
-										oph_io_server_send_error(sockfd);
-										free(result_buffer);
-										break;
-									}
-									result_buffer = tmp_buffer;
-								}
+					stmt_handle = *((unsigned long long *) line);
+					pmesg(LOG_DEBUG, __FILE__, __LINE__, "Releasing prepared statement %llu\n", stmt_handle);
+					logging(LOG_DEBUG, __FILE__, __LINE__, "Releasing prepared statement %llu\n", stmt_handle);
+					if (oph_io_server_release_stmt(status, stmt_handle))
+						stmt_handle = 0;
+				} else {
+					//Read query
+					res = oph_net_reader_readn(reader, line, payload_len);
+					if (res <= 0)
+						break;
+					line[payload_len] = 0;
+					pmesg(LOG_DEBUG, __FILE__, __LINE__, "Query is: %s - threadID: %lu\n", line, tid);
+					logging(LOG_DEBUG, __FILE__, __LINE__, "Query is: %s\n", line);
 
-								memcpy(result_buffer + k, (void *) &size, sizeof(unsigned long long));
-								k += sizeof(unsigned long long);
-								memcpy(result_buffer + k, (void *) buffer, size);
-								k += size;
-							} else {
-								//String and binary values are already char*
-
-								//Check current size
-								if ((k + global_status.last_result_set->record_set[i]->field_length[j] + sizeof(unsigned long long)) >= current_threshold) {
-									current_threshold *= 2;
-									tmp_buffer = (char *) realloc(result_buffer, current_threshold * sizeof(char));
-									if (!tmp_buffer) {
-										pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate buffer for communications\n");
-										logging(LOG_ERROR, __FILE__, __LINE__, "Unable to allocate buffer for communications\n");
-										oph_io_server_send_error(sockfd);
-										free(result_buffer);
-										break;
-									}
-									result_buffer = tmp_buffer;
-								}
+					if (oph_io_server_prepare_stmt(status, line, &stmt_handle))
+						stmt_handle = 0;
+				}
 
-								memcpy(result_buffer + k, (void *) &(global_status.last_result_set->record_set[i]->field_length[j]), sizeof(unsigned long long));
-								k += sizeof(unsigned long long);
-								memcpy(result_buffer + k, (void *) (global_status.last_result_set->record_set[i]->field[j]),
-								       global_status.last_result_set->record_set[i]->field_length[j]);
-								k += global_status.last_result_set->record_set[i]->field_length[j];
-							}
-							pmesg(LOG_DEBUG, __FILE__, __LINE__, "Arg[%d] progressive length is: %lld\n", j, k);
-						}
-						i++;
-					}
+				//Build response packet TYPE|HANDLE
+				if (stmt_handle) {
+					m = snprintf(result, strlen(OPH_IO_SERVER_MSG_SET_QUERY) + 1, OPH_IO_SERVER_MSG_SET_QUERY);
+					memcpy(result + m, &stmt_handle, OPH_IO_SERVER_MSG_LONG_LEN);
+					m += OPH_IO_SERVER_MSG_LONG_LEN;
+				} else {
+					pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to prepare statement\n");
+					logging(LOG_WARNING, __FILE__, __LINE__, "Unable to prepare statement\n");
+					m = snprintf(result, strlen(OPH_IO_SERVER_REQ_ERROR) + 1, OPH_IO_SERVER_REQ_ERROR);
 				}
-				payload_len = k - (m + sizeof(unsigned long long) + sizeof(unsigned long long) + sizeof(unsigned int));
-				memcpy(result_buffer + m, (void *) &payload_len, sizeof(unsigned long long));
-				m += sizeof(unsigned long long);
-				memcpy(result_buffer + m, (void *) &i, sizeof(unsigned long long));
-				m += sizeof(unsigned long long);
-				memcpy(result_buffer + m, (void *) &num_fields, sizeof(unsigned int));
-				//Transfer result set
-
-				pmesg(LOG_DEBUG, __FILE__, __LINE__, "Sending %d bytes\n", k);
-				logging(LOG_DEBUG, __FILE__, __LINE__, "Sending %d bytes\n", k);
-
-				if (write(sockfd, (void *) result_buffer, k) != (ssize_t) k) {
+
+				pmesg(LOG_DEBUG, __FILE__, __LINE__, "Sending %d bytes\n", m);
+				logging(LOG_DEBUG, __FILE__, __LINE__, "Sending %d bytes\n", m);
+				if (write(sockfd, (void *) result, m) != m) {
 					pmesg(LOG_ERROR, __FILE__, __LINE__, "Error while writing to socket\n");
 					logging(LOG_ERROR, __FILE__, __LINE__, "Error while writing to socket\n");
-					free(result_buffer);
 					break;
 				}
 				pmesg(LOG_DEBUG, __FILE__, __LINE__, "Result sent\n");
 				logging(LOG_DEBUG, __FILE__, __LINE__, "Result sent\n");
-
-				free(result_buffer);
 			} else if (STRCMP(header, OPH_IO_SERVER_MSG_EXEC_QUERY) == 0) {
 
 #ifdef DEBUG
@@ -469,7 +608,7 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 				pmesg(LOG_DEBUG, __FILE__, __LINE__, "Setup query...\n");
 				logging(LOG_DEBUG, __FILE__, __LINE__, "Setup query...\n");
 				//Read payload len
-				res = oph_net_readn(sockfd, line, OPH_IO_SERVER_MSG_SHORT_LEN);
+				res = oph_net_reader_readn(reader, line, OPH_IO_SERVER_MSG_SHORT_LEN);
 				if (res <= 0)
 					break;
 				line[OPH_IO_SERVER_MSG_SHORT_LEN] = 0;
@@ -478,7 +617,7 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 				logging(LOG_DEBUG, __FILE__, __LINE__, "Number of args: %u\n", arg_count);
 
 				//Read payload len
-				res = oph_net_readn(sockfd, line, OPH_IO_SERVER_MSG_LONG_LEN);
+				res = oph_net_reader_readn(reader, line, OPH_IO_SERVER_MSG_LONG_LEN);
 				if (res <= 0)
 					break;
 				line[OPH_IO_SERVER_MSG_LONG_LEN] = 0;
@@ -486,16 +625,32 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 				pmesg(LOG_DEBUG, __FILE__, __LINE__, "Query length: %llu\n", payload_len);
 				logging(LOG_DEBUG, __FILE__, __LINE__, "Query length: %llu\n", payload_len);
 
-				//Read query
-				res = oph_net_readn(sockfd, line, payload_len);
-				if (res <= 0)
-					break;
-				line[payload_len] = 0;
+				oph_io_server_prepared_stmt *stmt = NULL;
+				if (payload_len == 0) {
+					//Read handle of prepared statement
+					res = oph_net_reader_readn(reader, line, OPH_IO_SERVER_MSG_LONG_LEN);
+					if (res <= 0)
+						break;
+					stmt_handle = *((unsigned long long *) line);
+					if (oph_io_server_find_stmt(status, stmt_handle, &stmt)) {
+						pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to find prepared statement %llu\n", stmt_handle);
+						logging(LOG_WARNING, __FILE__, __LINE__, "Unable to find prepared statement %llu\n", stmt_handle);
+						oph_io_server_send_error(sockfd);
+						break;
+					}
+					snprintf(line, max_packet_length, "prepared statement %llu", stmt_handle);
+				} else {
+					//Read query
+					res = oph_net_reader_readn(reader, line, payload_len);
+					if (res <= 0)
+						break;
+					line[payload_len] = 0;
+				}
 				pmesg(LOG_DEBUG, __FILE__, __LINE__, "Query is: %s - threadID: %lu\n", line, tid);
 				logging(LOG_DEBUG, __FILE__, __LINE__, "Query is: %s\n", line);
 
 				//Read payload len
-				res = oph_net_readn(sockfd, result, OPH_IO_SERVER_MSG_LONG_LEN);
+				res = oph_net_reader_readn(reader, result, OPH_IO_SERVER_MSG_LONG_LEN);
 				if (res <= 0)
 					break;
 				result[OPH_IO_SERVER_MSG_LONG_LEN] = 0;
@@ -511,7 +666,7 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 					break;
 				}
 				//Read device name
-				res = oph_net_readn(sockfd, result, payload_len);
+				res = oph_net_reader_readn(reader, result, payload_len);
 				if (res <= 0)
 					break;
 				result[payload_len] = 0;
@@ -519,10 +674,10 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 				logging(LOG_DEBUG, __FILE__, __LINE__, "Device name: %s\n", result);
 
 				//TODO perform coerence check to verify device existance
-				if (global_status.device)
-					free(global_status.device);
-				global_status.device = (char *) strndup(result, strlen(result));
-				if (global_status.device == NULL) {
+				if (status->device)
+					free(status->device);
+				status->device = (char *) strndup(result, strlen(result));
+				if (status->device == NULL) {
 					pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to set default device: %s\n", result);
 					logging(LOG_WARNING, __FILE__, __LINE__, "Unable to set default device: %s\n", result);
 					break;
@@ -538,7 +693,7 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 					//Decode complex part of message ...|N_RUN|CURR_RUN|ARG1_LEN|ARG1_TYPE|ARG1|...
 
 					//Read number of runs
-					res = oph_net_readn(sockfd, result, OPH_IO_SERVER_MSG_LONG_LEN);
+					res = oph_net_reader_readn(reader, result, OPH_IO_SERVER_MSG_LONG_LEN);
 					if (res <= 0)
 						break;
 					result[OPH_IO_SERVER_MSG_LONG_LEN] = 0;
@@ -547,7 +702,7 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 					logging(LOG_DEBUG, __FILE__, __LINE__, "Total runs: %llu\n", tot_run);
 
 					//Read number of runs
-					res = oph_net_readn(sockfd, result, OPH_IO_SERVER_MSG_LONG_LEN);
+					res = oph_net_reader_readn(reader, result, OPH_IO_SERVER_MSG_LONG_LEN);
 					if (res <= 0)
 						break;
 					result[OPH_IO_SERVER_MSG_LONG_LEN] = 0;
@@ -556,7 +711,7 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 					logging(LOG_DEBUG, __FILE__, __LINE__, "Current run: %llu\n", curr_run);
 
 					//Check if current statement is already in progress
-					if (global_status.curr_stmt != NULL) {
+					if (status->curr_stmt != NULL) {
 						if (curr_run > tot_run) {
 							//Corrupted section then exit
 							pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to understand request '%s'...\n", header);
@@ -565,8 +720,8 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 							break;
 						} else {
 							//Decode message and update statement status
-							global_status.curr_stmt->curr_run = curr_run;
-							global_status.curr_stmt->tot_run = tot_run;
+							status->curr_stmt->curr_run = curr_run;
+							status->curr_stmt->tot_run = tot_run;
 
 							args = (oph_query_arg **) calloc(arg_count + 1, sizeof(oph_query_arg *));
 							if (!args) {
@@ -586,7 +741,7 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 									break;
 								}
 								//Read arg length
-								res = oph_net_readn(sockfd, result, OPH_IO_SERVER_MSG_LONG_LEN);
+								res = oph_net_reader_readn(reader, result, OPH_IO_SERVER_MSG_LONG_LEN);
 								if (res <= 0)
 									break;
 								result[OPH_IO_SERVER_MSG_LONG_LEN] = 0;
@@ -598,7 +753,7 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 								args[n]->arg_is_null = 0;
 
 								//Read arg type
-								res = oph_net_readn(sockfd, result, OPH_IO_SERVER_MSG_TYPE_LEN);
+								res = oph_net_reader_readn(reader, result, OPH_IO_SERVER_MSG_TYPE_LEN);
 								if (res <= 0)
 									break;
 								result[OPH_IO_SERVER_MSG_TYPE_LEN] = 0;
@@ -622,7 +777,7 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 								}
 
 								//Read arg
-								res = oph_net_readn(sockfd, result, payload_len);
+								res = oph_net_reader_readn(reader, result, payload_len);
 								if (res <= 0)
 									break;
 								result[payload_len] = 0;
@@ -652,14 +807,14 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 							break;
 						} else {
 							//Create first struct 
-							global_status.curr_stmt = (oph_io_server_running_stmt *) malloc(1 * sizeof(oph_io_server_running_stmt));
-							global_status.curr_stmt->tot_run = tot_run;
-							global_status.curr_stmt->curr_run = curr_run;
-							global_status.curr_stmt->partial_result_set = NULL;
-							global_status.curr_stmt->device = NULL;
-							global_status.curr_stmt->frag = NULL;
-							global_status.curr_stmt->size = 0;
-							global_status.curr_stmt->mi_prev_rows = 0;
+							status->curr_stmt = (oph_io_server_running_stmt *) malloc(1 * sizeof(oph_io_server_running_stmt));
+							status->curr_stmt->tot_run = tot_run;
+							status->curr_stmt->curr_run = curr_run;
+							status->curr_stmt->partial_result_set = NULL;
+							status->curr_stmt->device = NULL;
+							status->curr_stmt->frag = NULL;
+							status->curr_stmt->size = 0;
+							status->curr_stmt->mi_prev_rows = 0;
 
 							args = (oph_query_arg **) calloc(arg_count + 1, sizeof(oph_query_arg *));
 
@@ -672,7 +827,7 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 									break;
 								}
 								//Read arg length
-								res = oph_net_readn(sockfd, result, OPH_IO_SERVER_MSG_LONG_LEN);
+								res = oph_net_reader_readn(reader, result, OPH_IO_SERVER_MSG_LONG_LEN);
 								if (res <= 0)
 									break;
 								result[OPH_IO_SERVER_MSG_LONG_LEN] = 0;
@@ -684,7 +839,7 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 								args[n]->arg_is_null = 0;
 
 								//Read arg type
-								res = oph_net_readn(sockfd, result, OPH_IO_SERVER_MSG_TYPE_LEN);
+								res = oph_net_reader_readn(reader, result, OPH_IO_SERVER_MSG_TYPE_LEN);
 								if (res <= 0)
 									break;
 								result[OPH_IO_SERVER_MSG_TYPE_LEN] = 0;
@@ -708,7 +863,7 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 								}
 
 								//Read arg
-								res = oph_net_readn(sockfd, result, payload_len);
+								res = oph_net_reader_readn(reader, result, payload_len);
 								if (res <= 0)
 									break;
 								result[payload_len] = 0;
@@ -737,9 +892,9 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 				gettimeofday(&s_time, NULL);
 #endif
 				//Define global variables
-				HASHTBL *query_args = NULL;
+				oph_server_hashmap *query_args = NULL;
 
-				if (oph_query_parser(line, &query_args)) {
+				if (stmt ? oph_io_server_bind_stmt(stmt, &query_args) : oph_query_parser(line, &query_args)) {
 					pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to run query\n");
 					logging(LOG_WARNING, __FILE__, __LINE__, "Unable to run query\n");
 					oph_io_server_send_error(sockfd);
@@ -755,8 +910,10 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 
 				oph_iostore_handler *dev_handle = NULL;
 
-				if (oph_iostore_setup(global_status.device, &dev_handle) != 0) {
-					hashtbl_destroy(query_args);
+				if (oph_iostore_setup(status->device, &dev_handle) != 0) {
+					//Args bound to a prepared statement are kept for the next execution
+					if (!stmt)
+						oph_server_hashmap_destroy(query_args);
 					pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to setup iostorage\n");
 					logging(LOG_WARNING, __FILE__, __LINE__, "Unable to setup iostorage\n");
 					oph_io_server_send_error(sockfd);
@@ -764,10 +921,12 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 					break;
 				}
 				//TODO if query is SELECT then set globally last result set
-				if (oph_io_server_dispatcher(&db_table, dev_handle, &global_status, args, query_args, plugin_table)) {
+				if (oph_io_server_dispatcher(&db_table, dev_handle, status, args, query_args, plugin_table, stmt)) {
 
+					oph_server_arena_reset(status->query_arena);
 					oph_iostore_cleanup(dev_handle);
-					hashtbl_destroy(query_args);
+					if (!stmt)
+						oph_server_hashmap_destroy(query_args);
 					pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to run query\n");
 					logging(LOG_WARNING, __FILE__, __LINE__, "Unable to run query\n");
 					oph_io_server_send_error(sockfd);
@@ -775,6 +934,8 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 					break;
 				}
 
+				//Release transient query allocations in one shot
+				oph_server_arena_reset(status->query_arena);
 				oph_iostore_cleanup(dev_handle);
 
 #ifdef DEBUG
@@ -783,7 +944,8 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 				pmesg(LOG_INFO, __FILE__, __LINE__, "Exec query %s:\t Time %d,%06d sec\n", line, (int) t_time.tv_sec, (int) t_time.tv_usec);
 				gettimeofday(&s_time, NULL);
 #endif
-				hashtbl_destroy(query_args);
+				if (!stmt)
+					oph_server_hashmap_destroy(query_args);
 				//Delete temp result set
 				oph_io_server_free_query_args(args, arg_count);
 
@@ -819,10 +981,8 @@ void oph_io_server_thread(int sockfd, pthread_t tid)
 		timeval_subtract(&total_time, &end_time, &start_time);
 		pmesg(LOG_INFO, __FILE__, __LINE__, "Total reply:\t Time %d,%06d sec\n", (int) total_time.tv_sec, (int) total_time.tv_usec);
 #endif
-	}
-
-	oph_io_server_free_status(&global_status);
-	free(result);
-	free(line);
+		close_connection = 0;
+	} while (0);
 
+	return close_connection;
 }
@@ -29,6 +29,7 @@
 #include <pthread.h>
 
 #include "oph_server_utility.h"
+#include "oph_server_transpose.h"
 #include "oph_query_engine_language.h"
 
 #include "oph_query_expression_evaluator.h"
@@ -47,10 +48,8 @@ extern int msglevel;
 //extern pthread_mutex_t metadb_mutex;
 extern pthread_rwlock_t rwlock;
 extern pthread_mutex_t nc_lock;
-extern HASHTBL *plugin_table;
+extern oph_server_hashmap *plugin_table;
 extern unsigned long long memory_buffer;
-extern unsigned short cache_line_size;
-extern unsigned long long cache_size;
 
 #define MB_SIZE 1048576
 
@@ -103,184 +102,6 @@ int oph_ioserver_esdm_compute_dimension_id(unsigned long ID, unsigned int *sizem
 	return 0;
 }
 
-int _oph_ioserver_esdm_cache_to_buffer3(short int tot_dim_number, unsigned int *counters, unsigned int *limits, unsigned int *blocks, unsigned int *src_products, char *src_binary,
-					unsigned int *dst_products, char *dst_binary, size_t sizeof_var)
-{
-	//At lease 1 dim shuld be defined
-
-	short int i = 0, j = 0, last = tot_dim_number - 1;
-	long long k = 0, index = 0;
-	long long dst_addr = 0, src_addr = 0;
-	long long total_iter = 1;
-
-	unsigned int tmp_start[tot_dim_number];
-	unsigned int tmp_end[tot_dim_number];
-
-	for (i = 0; i < tot_dim_number; i++) {
-		if (i != 0)
-			counters[i] = 0;
-		if (i != last)
-			total_iter *= (limits[i] - counters[i]);
-		tmp_start[i] = 0;
-		tmp_end[i] = blocks[i];
-
-		//Extend products to consider size of var
-		src_products[i] *= sizeof_var;
-		dst_products[i] *= sizeof_var;
-	}
-
-	long long src_jump = src_products[last];
-	long long dst_jump = dst_products[last];
-	long long inner_blocks = 0;
-	long long inner_counter = 0;
-
-	total_iter *= ceil((double) (limits[last] - counters[last]) / blocks[last]);
-
-	for (index = 0; index < total_iter; index++) {
-		dst_addr = src_addr = 0;
-
-		//External dimensions
-		for (i = 0; i < last; i++) {
-			src_addr += (long long) counters[i] * src_products[i];
-			dst_addr += (long long) counters[i] * dst_products[i];
-		}
-
-		//Internal dimension
-		inner_counter = tmp_start[last];
-		inner_blocks = tmp_end[last];
-		for (k = inner_counter; k < inner_blocks; k++) {
-			memcpy(dst_binary + (dst_addr + k * dst_jump), src_binary + (src_addr + k * src_jump), sizeof_var);
-		}
-
-		//Increase block counters starting from most internal dimension (excluding the most internal)
-		for (i = tot_dim_number - 2; i >= 0; i--) {
-			counters[i]++;
-			if (counters[i] < tmp_end[i]) {
-				break;
-			} else {
-				counters[i] = tmp_start[i];
-
-				if (i == 0) {
-					for (j = last; j >= 0; j--) {
-						tmp_start[j] += blocks[j];
-						tmp_end[j] += blocks[j];
-
-						if (tmp_start[j] < limits[j]) {
-							counters[j] = tmp_start[j];
-							if (tmp_end[j] > limits[j])
-								tmp_end[j] = limits[j];
-							break;
-						} else {
-							counters[j] = tmp_start[j] = 0;
-							tmp_end[j] = blocks[j];
-						}
-					}
-				}
-			}
-		}
-	}
-
-	return 0;
-}
-
-
-int _oph_ioserver_esdm_cache_to_buffer2(short int tot_dim_number, unsigned int *counters, unsigned int *limits, unsigned int *blocks, unsigned int *src_products, char *src_binary,
-					unsigned int *dst_products, char *dst_binary, size_t sizeof_var)
-{
-	short int i = 0, j = 0, last = tot_dim_number - 1;
-	long long dst_addr = 0, src_addr = 0;
-	long long index = 0;
-	long long total_iter = 1;
-
-	unsigned int tmp_start[tot_dim_number];
-	unsigned int tmp_end[tot_dim_number];
-
-	for (i = 0; i < tot_dim_number; i++) {
-		if (i != 0) {
-			counters[i] = 0;
-		}
-		total_iter *= (limits[i] - counters[i]);
-		tmp_start[i] = 0;
-		tmp_end[i] = blocks[i];
-		src_products[i] *= sizeof_var;
-		dst_products[i] *= sizeof_var;
-	}
-
-	for (index = 0; index < total_iter; index++) {
-		dst_addr = src_addr = 0;
-
-		for (i = 0; i < tot_dim_number; i++) {
-			src_addr += (long long) counters[i] * src_products[i];
-			dst_addr += (long long) counters[i] * dst_products[i];
-		}
-		memcpy(dst_binary + dst_addr, src_binary + src_addr, sizeof_var);
-
-		//Increase block counters starting from most rapidly varying dimension
-		for (i = last; i >= 0; i--) {
-			counters[i]++;
-			if (counters[i] < tmp_end[i]) {
-				break;
-			} else {
-				counters[i] = tmp_start[i];
-
-				if (i == 0) {
-					for (j = last; j >= 0; j--) {
-						tmp_start[j] += blocks[j];
-						tmp_end[j] += blocks[j];
-
-						if (tmp_start[j] < limits[j]) {
-							counters[j] = tmp_start[j];
-							if (tmp_end[j] > limits[j])
-								tmp_end[j] = limits[j];
-							break;
-						} else {
-							counters[j] = tmp_start[j] = 0;
-							tmp_end[j] = blocks[j];
-						}
-					}
-				}
-			}
-		}
-	}
-
-	return 0;
-}
-
-int oph_ioserver_esdm_cache_to_buffer(short int tot_dim_number, unsigned int *counters, unsigned int *limits, unsigned int *products, char *binary_cache, char *binary_insert, size_t sizeof_var)
-{
-	short int i = 0, last = tot_dim_number - 1;
-	long long addr = 0;
-	long long index = 0;
-	long long total_iter = 1;
-
-	for (i = 0; i < tot_dim_number; i++) {
-		if (i != 0)
-			counters[i] = 0;
-		total_iter *= (limits[i] - counters[i]);
-		products[i] *= sizeof_var;
-	}
-
-	for (index = 0; index < total_iter; index++) {
-		addr = 0;
-		for (i = 0; i < tot_dim_number; i++) {
-			addr += (long long) counters[i] * products[i];
-		}
-		memcpy(binary_insert + index * sizeof_var, binary_cache + addr, sizeof_var);
-
-		//Increase counters starting from most rapidly varying dimension
-		for (i = last; i >= 0; i--) {
-			counters[i]++;
-			if (counters[i] < limits[i]) {
-				break;
-			} else {
-				counters[i] = 0;
-			}
-		}
-	}
-
-	return 0;
-}
-
 int _oph_ioserver_esdm_read_v2(char *measure_name, unsigned long long tuplexfrag_number, long long frag_key_start, char compressed_flag, esdm_container_t * container, esdm_dataset_t * dataset,
 			       int ndims, int nimp, int nexp, short int *dims_type, short int *dims_index, int *dims_start, int *dims_end, oph_iostore_frag_record_set * binary_frag,
 			       unsigned long long *frag_size, unsigned long long sizeof_var, esdm_type_t vartype, int id_dim_pos, int measure_pos, unsigned long long array_length, char *sub_operation,
@@ -663,7 +484,6 @@ int _oph_ioserver_esdm_read_v2(char *measure_name, unsigned long long tuplexfrag
 
 		//Prepare structures for buffer insert update
 		unsigned int *dst_products = (unsigned int *) malloc(ndims * sizeof(unsigned));
-		unsigned int *counters = (unsigned int *) malloc(ndims * sizeof(unsigned int));
 		unsigned int *src_products = (unsigned int *) malloc(ndims * sizeof(unsigned));
 		unsigned int *limits = (unsigned int *) malloc(ndims * sizeof(unsigned));
 
@@ -673,24 +493,12 @@ int _oph_ioserver_esdm_read_v2(char *measure_name, unsigned long long tuplexfrag
 
 		//Setup arrays for recursive selection
 		for (i = 0; i < ndims; i++) {
-			counters[dims_index[i]] = 0;
 			src_products[dims_index[i]] = 1;
 			dst_products[dims_index[i]] = 1;
 			limits[dims_index[i]] = check_for_reduce_func ? check_for_reduce_func : count[i];
 			file_indexes[dims_index[i]] = k++;
 		}
 
-		//TODO Better block size management - Activate this only in case internal dimension is out of order and the largest
-		//Make sure most internal dimension (for write-oriented array) is at least multiple of cache line
-		unsigned int *blocks = (unsigned int *) malloc(ndims * sizeof(unsigned));
-		unsigned int line_size = floor(cache_line_size / sizeof_type);
-		unsigned long long max_blocks = floor((cache_size / 2) / (sizeof_type));
-		unsigned int block_size = floor(pow(max_blocks, (float) 1 / ndims));
-		block_size = (block_size <= line_size ? block_size : block_size - block_size % line_size);
-		for (i = ndims - 1; i >= 0; i--) {
-			blocks[i] = (limits[i] < block_size ? limits[i] : block_size);
-		}
-
 		//Compute products
 		for (k = 0; k < ndims; k++) {
 			//Compute products for new buffer
@@ -718,10 +526,8 @@ int _oph_ioserver_esdm_read_v2(char *measure_name, unsigned long long tuplexfrag
 					free(idDim);
 					free(count);
 					free(file_indexes);
-					free(counters);
 					free(src_products);
 					free(limits);
-					free(blocks);
 					free(dst_products);
 					return OPH_IO_SERVER_EXEC_ERROR;
 				}
@@ -732,17 +538,15 @@ int _oph_ioserver_esdm_read_v2(char *measure_name, unsigned long long tuplexfrag
 #ifdef DEBUG
 		gettimeofday(&start_transpose_time, NULL);
 #endif
-		_oph_ioserver_esdm_cache_to_buffer3(ndims, counters, limits, blocks, src_products, binary_cache, dst_products, binary_insert, sizeof_type);
+		oph_server_transpose(ndims, limits, src_products, binary_cache, dst_products, binary_insert, sizeof_type);
 #ifdef DEBUG
 		gettimeofday(&end_transpose_time, NULL);
 		timeval_subtract(&intermediate_transpose_time, &end_transpose_time, &start_transpose_time);
 		timeval_add(&total_transpose_time, &total_transpose_time, &intermediate_transpose_time);
 		pmesg(LOG_INFO, __FILE__, __LINE__, "Fragment %s:  Total transpose :\t Time %d,%06d sec\n", measure_name, (int) total_transpose_time.tv_sec, (int) total_transpose_time.tv_usec);
 #endif
-		free(counters);
 		free(src_products);
 		free(limits);
-		free(blocks);
 		free(dst_products);
 	}
 
@@ -812,7 +616,8 @@ int _oph_ioserver_esdm_read_v2(char *measure_name, unsigned long long tuplexfrag
 		args[id_dim_pos]->arg = (unsigned long long *) (&(idDim[ii]));
 		args[measure_pos]->arg = (char *) (binary_insert + ii * sizeof_var);
 
-		if (_oph_ioserver_query_build_row(arg_count, &row_size, binary_frag, binary_frag->field_name, value_list, args, &new_record)) {
+		if (compressed_flag == 1 ? _oph_ioserver_query_build_row(arg_count, &row_size, binary_frag, binary_frag->field_name, value_list, args, &new_record)
+		    : _oph_ioserver_query_store_row(arg_count, &row_size, binary_frag, args, ii, tuplexfrag_number)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
 			for (i = 0; i < arg_count; i++)
@@ -824,8 +629,9 @@ int _oph_ioserver_esdm_read_v2(char *measure_name, unsigned long long tuplexfrag
 			free(binary_insert);
 			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
-		//Add record to partial record set
-		binary_frag->record_set[ii] = new_record;
+		//Add record to partial record set (rows stored in slab are already attached)
+		if (new_record)
+			binary_frag->record_set[ii] = new_record;
 		//Update current record size
 		cumulative_size += row_size;
 
@@ -1227,7 +1033,6 @@ int _oph_ioserver_esdm_read_v1(char *measure_name, unsigned long long tuplexfrag
 	if (transpose) {
 
 		//Prepare structures for buffer insert update
-		unsigned int *counters = (unsigned int *) malloc(ndims * sizeof(unsigned int));
 		unsigned int *src_products = (unsigned int *) malloc(ndims * sizeof(unsigned));
 		unsigned int *limits = (unsigned int *) malloc(ndims * sizeof(unsigned));
 
@@ -1237,7 +1042,6 @@ int _oph_ioserver_esdm_read_v1(char *measure_name, unsigned long long tuplexfrag
 
 		//Setup arrays for recursive selection
 		for (i = 0; i < ndims; i++) {
-			counters[dims_index[i]] = 0;
 			src_products[dims_index[i]] = 1;
 			limits[dims_index[i]] = check_for_reduce_func ? check_for_reduce_func : count[i];
 			file_indexes[dims_index[i]] = k++;
@@ -1266,7 +1070,6 @@ int _oph_ioserver_esdm_read_v1(char *measure_name, unsigned long long tuplexfrag
 					free(idDim);
 					free(count);
 					free(file_indexes);
-					free(counters);
 					free(src_products);
 					free(limits);
 					return OPH_IO_SERVER_EXEC_ERROR;
@@ -1278,14 +1081,13 @@ int _oph_ioserver_esdm_read_v1(char *measure_name, unsigned long long tuplexfrag
 #ifdef DEBUG
 		gettimeofday(&start_transpose_time, NULL);
 #endif
-		oph_ioserver_esdm_cache_to_buffer(ndims, counters, limits, src_products, binary_cache, binary_insert, sizeof_type);
+		oph_server_transpose(ndims, limits, src_products, binary_cache, NULL, binary_insert, sizeof_type);
 #ifdef DEBUG
 		gettimeofday(&end_transpose_time, NULL);
 		timeval_subtract(&intermediate_transpose_time, &end_transpose_time, &start_transpose_time);
 		timeval_add(&total_transpose_time, &total_transpose_time, &intermediate_transpose_time);
 		pmesg(LOG_INFO, __FILE__, __LINE__, "Fragment %s:  Total transpose :\t Time %d,%06d sec\n", measure_name, (int) total_transpose_time.tv_sec, (int) total_transpose_time.tv_usec);
 #endif
-		free(counters);
 		free(src_products);
 		free(limits);
 	}
@@ -1356,7 +1158,8 @@ int _oph_ioserver_esdm_read_v1(char *measure_name, unsigned long long tuplexfrag
 		args[id_dim_pos]->arg = (unsigned long long *) (&(idDim[ii]));
 		args[measure_pos]->arg = (char *) (binary_insert + ii * sizeof_var);
 
-		if (_oph_ioserver_query_build_row(arg_count, &row_size, binary_frag, binary_frag->field_name, value_list, args, &new_record)) {
+		if (compressed_flag == 1 ? _oph_ioserver_query_build_row(arg_count, &row_size, binary_frag, binary_frag->field_name, value_list, args, &new_record)
+		    : _oph_ioserver_query_store_row(arg_count, &row_size, binary_frag, args, ii, tuplexfrag_number)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
 			for (i = 0; i < arg_count; i++)
@@ -1368,8 +1171,9 @@ int _oph_ioserver_esdm_read_v1(char *measure_name, unsigned long long tuplexfrag
 			free(binary_insert);
 			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
-		//Add record to partial record set
-		binary_frag->record_set[ii] = new_record;
+		//Add record to partial record set (rows stored in slab are already attached)
+		if (new_record)
+			binary_frag->record_set[ii] = new_record;
 		//Update current record size
 		cumulative_size += row_size;
 
@@ -1667,13 +1471,11 @@ int _oph_ioserver_esdm_read_v0(char *measure_name, unsigned long long tuplexfrag
 	//Prepare structures for buffer insert update
 	size_t sizeof_type = (int) sizeof_var / array_length;
 
-	unsigned int *counters = NULL;
 	unsigned int *src_products = NULL;
 	unsigned int *limits = NULL;
 
 	if (transpose) {
 
-		counters = (unsigned int *) malloc(nimp * sizeof(unsigned int));
 		src_products = (unsigned int *) malloc(nimp * sizeof(unsigned));
 		limits = (unsigned int *) malloc(nimp * sizeof(unsigned));
 
@@ -1684,7 +1486,6 @@ int _oph_ioserver_esdm_read_v0(char *measure_name, unsigned long long tuplexfrag
 		for (i = 0; i < ndims; i++) {
 			//Implicit
 			if (!dims_type[i]) {
-				counters[dims_index[i] - nexp] = 0;
 				src_products[dims_index[i] - nexp] = 1;
 				limits[dims_index[i] - nexp] = check_for_reduce_func ? check_for_reduce_func : count[i];
 				file_indexes[dims_index[i] - nexp] = k++;
@@ -1720,7 +1521,6 @@ int _oph_ioserver_esdm_read_v0(char *measure_name, unsigned long long tuplexfrag
 					free(start_pointer);
 					free(sizemax);
 					free(file_indexes);
-					free(counters);
 					free(src_products);
 					free(limits);
 					return OPH_IO_SERVER_EXEC_ERROR;
@@ -1737,7 +1537,6 @@ int _oph_ioserver_esdm_read_v0(char *measure_name, unsigned long long tuplexfrag
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 		if (transpose) {
 			free(binary_cache);
-			free(counters);
 			free(src_products);
 			free(limits);
 		}
@@ -1763,7 +1562,6 @@ int _oph_ioserver_esdm_read_v0(char *measure_name, unsigned long long tuplexfrag
 		free(args);
 		if (transpose) {
 			free(binary_cache);
-			free(counters);
 			free(src_products);
 			free(limits);
 		}
@@ -1798,7 +1596,6 @@ int _oph_ioserver_esdm_read_v0(char *measure_name, unsigned long long tuplexfrag
 			free(value_list);
 			if (transpose) {
 				free(binary_cache);
-				free(counters);
 				free(src_products);
 				free(limits);
 			}
@@ -1870,7 +1667,6 @@ int _oph_ioserver_esdm_read_v0(char *measure_name, unsigned long long tuplexfrag
 			free(value_list);
 			if (transpose) {
 				free(binary_cache);
-				free(counters);
 				free(src_products);
 				free(limits);
 			}
@@ -1906,7 +1702,6 @@ int _oph_ioserver_esdm_read_v0(char *measure_name, unsigned long long tuplexfrag
 				free(value_list);
 				if (transpose) {
 					free(binary_cache);
-					free(counters);
 					free(src_products);
 					free(limits);
 				}
@@ -1934,7 +1729,6 @@ int _oph_ioserver_esdm_read_v0(char *measure_name, unsigned long long tuplexfrag
 			free(value_list);
 			if (transpose) {
 				free(binary_cache);
-				free(counters);
 				free(src_products);
 				free(limits);
 			}
@@ -1951,9 +1745,10 @@ int _oph_ioserver_esdm_read_v0(char *measure_name, unsigned long long tuplexfrag
 		}
 
 		if (transpose)
-			oph_ioserver_esdm_cache_to_buffer(nimp, counters, limits, src_products, binary_cache, binary_insert, sizeof_type);
+			oph_server_transpose(nimp, limits, src_products, binary_cache, NULL, binary_insert, sizeof_type);
 
-		if (_oph_ioserver_query_build_row(arg_count, &row_size, binary_frag, binary_frag->field_name, value_list, args, &new_record)) {
+		if (compressed_flag == 1 ? _oph_ioserver_query_build_row(arg_count, &row_size, binary_frag, binary_frag->field_name, value_list, args, &new_record)
+		    : _oph_ioserver_query_store_row(arg_count, &row_size, binary_frag, args, ii, tuplexfrag_number)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
 			for (i = 0; i < arg_count; i++)
@@ -1963,7 +1758,6 @@ int _oph_ioserver_esdm_read_v0(char *measure_name, unsigned long long tuplexfrag
 			free(value_list);
 			if (transpose) {
 				free(binary_cache);
-				free(counters);
 				free(src_products);
 				free(limits);
 			}
@@ -1980,8 +1774,9 @@ int _oph_ioserver_esdm_read_v0(char *measure_name, unsigned long long tuplexfrag
 		}
 		idDim++;
 
-		//Add record to partial record set
-		binary_frag->record_set[ii] = new_record;
+		//Add record to partial record set (rows stored in slab are already attached)
+		if (new_record)
+			binary_frag->record_set[ii] = new_record;
 		//Update current record size
 		cumulative_size += row_size;
 
@@ -2009,7 +1804,6 @@ int _oph_ioserver_esdm_read_v0(char *measure_name, unsigned long long tuplexfrag
 
 	if (transpose) {
 		free(binary_cache);
-		free(counters);
 		free(src_products);
 		free(limits);
 	}
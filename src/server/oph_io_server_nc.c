@@ -29,13 +29,16 @@
 #include <pthread.h>
 
 #include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/shm.h>
-#include <sys/wait.h>
 #include <unistd.h>
 
 #include "oph_server_utility.h"
+#include "oph_server_memory.h"
+#include "oph_server_transpose.h"
 #include "oph_query_engine_language.h"
+#include "oph_io_server_nc_cache.h"
+#ifdef OPH_PAR_NC4
+#include "oph_io_server_nc_loader.h"
+#endif
 
 #include "oph_query_expression_evaluator.h"
 #include "oph_query_expression_functions.h"
@@ -51,11 +54,8 @@
 extern int msglevel;
 //extern pthread_mutex_t metadb_mutex;
 extern pthread_rwlock_t rwlock;
-extern pthread_mutex_t nc_lock;
-extern HASHTBL *plugin_table;
+extern oph_server_hashmap *plugin_table;
 extern unsigned long long memory_buffer;
-extern unsigned short cache_line_size;
-extern unsigned long long cache_size;
 
 #define MB_SIZE 1048576
 
@@ -63,11 +63,6 @@ extern unsigned long long cache_size;
 
 #ifdef OPH_IO_SERVER_NETCDF
 
-#define OPH_NC_LOAD_EXEC OPH_IO_SERVER_PREFIX "/bin/oph_io_server_nc_load"
-#define INT_LEN 16
-#define LONG_LEN 24
-#define MSG_LEN 4096
-
 #ifdef DEBUG
 #include "taketime.h"
 static int timeval_add(res, x, y)
@@ -86,8 +81,10 @@ struct timeval *res, *x, *y;
 typedef struct Buffer {
 	char *cache;
 	char *insert;
-	int cache_sh;
-	int insert_sh;
+	int cache_sh;		//Descriptor of the shared memory used for cache, -1 if private
+	int insert_sh;		//Descriptor of the shared memory used for insert, -1 if private
+	unsigned long long cache_size;	//Bytes of cache reserved from the memory budget
+	unsigned long long insert_size;	//Bytes of insert reserved from the memory budget
 } Buffer;
 
 #define _oph_ioserver_nc_clear_buffer_cache(buff) _oph_ioserver_nc_clear_buffer_(buff, 1, 0)
@@ -97,64 +94,70 @@ int _oph_ioserver_nc_clear_buffer_(Buffer * buff, char is_cache, char is_all)
 {
 	if (is_cache || is_all) {
 #ifdef OPH_PAR_NC4
-		if (buff->cache_sh) {
-			shmctl(buff->cache_sh, IPC_RMID, NULL);
-			buff->cache_sh = 0;
-		}
+		if (buff->cache_sh >= 0)
+			oph_iob_bin_array_shared_free(&(buff->cache_sh), &(buff->cache));
 #endif
 		if (buff->cache) {
 			free(buff->cache);
 			buff->cache = NULL;
 		}
+		oph_server_memory_release(buff->cache_size);
+		buff->cache_size = 0;
 	}
 	if (!is_cache || is_all) {
 #ifdef OPH_PAR_NC4
-		if (buff->insert_sh) {
-			shmctl(buff->insert_sh, IPC_RMID, NULL);
-			buff->insert_sh = 0;
-		}
+		if (buff->insert_sh >= 0)
+			oph_iob_bin_array_shared_free(&(buff->insert_sh), &(buff->insert));
 #endif
 		if (buff->insert) {
 			free(buff->insert);
 			buff->insert = NULL;
 		}
+		oph_server_memory_release(buff->insert_size);
+		buff->insert_size = 0;
 	}
+	return OPH_IO_SERVER_SUCCESS;
 }
 
 int _oph_ioserver_nc_init_buffer(Buffer * buff)
 {
 	*buff = (Buffer) {
-	NULL, NULL, 0, 0};
+	NULL, NULL, -1, -1, 0, 0};
 	return OPH_IO_SERVER_SUCCESS;
 }
 
+static size_t _oph_ioserver_nc_sizeof_type(nc_type vartype)
+{
+	switch (vartype) {
+		case NC_BYTE:
+		case NC_CHAR:
+			return sizeof(char);
+		case NC_SHORT:
+			return sizeof(short);
+		case NC_INT:
+			return sizeof(int);
+		case NC_INT64:
+			return sizeof(long long);
+		case NC_FLOAT:
+			return sizeof(float);
+		default:
+			return sizeof(double);
+	}
+}
+
 int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, nc_type vartype, long long elems)
 {
+	//Shared buffers are mapped too, so a single check is enough
 	if (transpose) {
-#ifdef OPH_PAR_NC4
-		if (shared) {
-			if (buff->cache_sh)
-				return OPH_IO_SERVER_SUCCESS;
-		} else
-#endif
-		{
-			if (buff->cache)
-				return OPH_IO_SERVER_SUCCESS;
-		}
+		if (buff->cache)
+			return OPH_IO_SERVER_SUCCESS;
 	} else {
-#ifdef OPH_PAR_NC4
-		if (shared) {
-			if (buff->insert_sh)
-				return OPH_IO_SERVER_SUCCESS;
-		} else
-#endif
-		{
-			if (buff->insert)
-				return OPH_IO_SERVER_SUCCESS;
-		}
+		if (buff->insert)
+			return OPH_IO_SERVER_SUCCESS;
 	}
 
 	int res = 0;
+	unsigned long long size = elems * _oph_ioserver_nc_sizeof_type(vartype);
 
 	if (memory_check()) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
@@ -163,12 +166,18 @@ int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, n
 	}
 	//Create a binary array cache to store the whole fragment
 	if (transpose) {
+		if (oph_server_memory_reserve(size)) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			return OPH_IO_SERVER_MEMORY_ERROR;
+		}
+		buff->cache_size = size;
 		switch (vartype) {
 			case NC_BYTE:
 			case NC_CHAR:
 #ifdef OPH_PAR_NC4
 				if (shared)
-					res = oph_iob_bin_array_shared_create_b(&(buff->cache_sh), elems);
+					res = oph_iob_bin_array_shared_create_b(&(buff->cache_sh), &(buff->cache), elems);
 				else
 #endif
 					res = oph_iob_bin_array_create_b(&(buff->cache), elems);
@@ -176,7 +185,7 @@ int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, n
 			case NC_SHORT:
 #ifdef OPH_PAR_NC4
 				if (shared)
-					res = oph_iob_bin_array_shared_create_s(&(buff->cache_sh), elems);
+					res = oph_iob_bin_array_shared_create_s(&(buff->cache_sh), &(buff->cache), elems);
 				else
 #endif
 					res = oph_iob_bin_array_create_s(&(buff->cache), elems);
@@ -184,7 +193,7 @@ int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, n
 			case NC_INT:
 #ifdef OPH_PAR_NC4
 				if (shared)
-					res = oph_iob_bin_array_shared_create_i(&(buff->cache_sh), elems);
+					res = oph_iob_bin_array_shared_create_i(&(buff->cache_sh), &(buff->cache), elems);
 				else
 #endif
 					res = oph_iob_bin_array_create_i(&(buff->cache), elems);
@@ -192,7 +201,7 @@ int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, n
 			case NC_INT64:
 #ifdef OPH_PAR_NC4
 				if (shared)
-					res = oph_iob_bin_array_shared_create_l(&(buff->cache_sh), elems);
+					res = oph_iob_bin_array_shared_create_l(&(buff->cache_sh), &(buff->cache), elems);
 				else
 #endif
 					res = oph_iob_bin_array_create_l(&(buff->cache), elems);
@@ -200,7 +209,7 @@ int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, n
 			case NC_FLOAT:
 #ifdef OPH_PAR_NC4
 				if (shared)
-					res = oph_iob_bin_array_shared_create_f(&(buff->cache_sh), elems);
+					res = oph_iob_bin_array_shared_create_f(&(buff->cache_sh), &(buff->cache), elems);
 				else
 #endif
 					res = oph_iob_bin_array_create_f(&(buff->cache), elems);
@@ -208,7 +217,7 @@ int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, n
 			case NC_DOUBLE:
 #ifdef OPH_PAR_NC4
 				if (shared)
-					res = oph_iob_bin_array_shared_create_d(&(buff->cache_sh), elems);
+					res = oph_iob_bin_array_shared_create_d(&(buff->cache_sh), &(buff->cache), elems);
 				else
 #endif
 					res = oph_iob_bin_array_create_d(&(buff->cache), elems);
@@ -216,7 +225,7 @@ int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, n
 			default:
 #ifdef OPH_PAR_NC4
 				if (shared)
-					res = oph_iob_bin_array_shared_create_d(&(buff->cache_sh), elems);
+					res = oph_iob_bin_array_shared_create_d(&(buff->cache_sh), &(buff->cache), elems);
 				else
 #endif
 					res = oph_iob_bin_array_create_d(&(buff->cache), elems);
@@ -224,18 +233,19 @@ int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, n
 		if (res) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-			_oph_ioserver_nc_clear_buffer(buff);
+			_oph_ioserver_nc_clear_buffer_(buff, 0, 1);
 			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
 	}
 
 
-	if (memory_check()) {
+	if (memory_check() || oph_server_memory_reserve(size)) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-		_oph_ioserver_nc_clear_buffer(buff);
+		_oph_ioserver_nc_clear_buffer_(buff, 0, 1);
 		return OPH_IO_SERVER_MEMORY_ERROR;
 	}
+	buff->insert_size = size;
 	//Create array for rows to be insert
 	res = 0;
 	switch (vartype) {
@@ -244,7 +254,7 @@ int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, n
 #ifdef OPH_PAR_NC4
 			//Memory is shared only if shared flag is enabled and no transpose is requried
 			if (!transpose && shared)
-				res = oph_iob_bin_array_shared_create_b(&(buff->insert_sh), elems);
+				res = oph_iob_bin_array_shared_create_b(&(buff->insert_sh), &(buff->insert), elems);
 			else
 #endif
 				res = oph_iob_bin_array_create_b(&(buff->insert), elems);
@@ -252,7 +262,7 @@ int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, n
 		case NC_SHORT:
 #ifdef OPH_PAR_NC4
 			if (!transpose && shared)
-				res = oph_iob_bin_array_shared_create_s(&(buff->insert_sh), elems);
+				res = oph_iob_bin_array_shared_create_s(&(buff->insert_sh), &(buff->insert), elems);
 			else
 #endif
 				res = oph_iob_bin_array_create_s(&(buff->insert), elems);
@@ -260,7 +270,7 @@ int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, n
 		case NC_INT:
 #ifdef OPH_PAR_NC4
 			if (!transpose && shared)
-				res = oph_iob_bin_array_shared_create_i(&(buff->insert_sh), elems);
+				res = oph_iob_bin_array_shared_create_i(&(buff->insert_sh), &(buff->insert), elems);
 			else
 #endif
 				res = oph_iob_bin_array_create_i(&(buff->insert), elems);
@@ -268,7 +278,7 @@ int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, n
 		case NC_INT64:
 #ifdef OPH_PAR_NC4
 			if (!transpose && shared)
-				res = oph_iob_bin_array_shared_create_l(&(buff->insert_sh), elems);
+				res = oph_iob_bin_array_shared_create_l(&(buff->insert_sh), &(buff->insert), elems);
 			else
 #endif
 				res = oph_iob_bin_array_create_l(&(buff->insert), elems);
@@ -276,7 +286,7 @@ int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, n
 		case NC_FLOAT:
 #ifdef OPH_PAR_NC4
 			if (!transpose && shared)
-				res = oph_iob_bin_array_shared_create_f(&(buff->insert_sh), elems);
+				res = oph_iob_bin_array_shared_create_f(&(buff->insert_sh), &(buff->insert), elems);
 			else
 #endif
 				res = oph_iob_bin_array_create_f(&(buff->insert), elems);
@@ -284,7 +294,7 @@ int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, n
 		case NC_DOUBLE:
 #ifdef OPH_PAR_NC4
 			if (!transpose && shared)
-				res = oph_iob_bin_array_shared_create_d(&(buff->insert_sh), elems);
+				res = oph_iob_bin_array_shared_create_d(&(buff->insert_sh), &(buff->insert), elems);
 			else
 #endif
 				res = oph_iob_bin_array_create_d(&(buff->insert), elems);
@@ -292,7 +302,7 @@ int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, n
 		default:
 #ifdef OPH_PAR_NC4
 			if (!transpose && shared)
-				res = oph_iob_bin_array_shared_create_d(&(buff->insert_sh), elems);
+				res = oph_iob_bin_array_shared_create_d(&(buff->insert_sh), &(buff->insert), elems);
 			else
 #endif
 				res = oph_iob_bin_array_create_d(&(buff->insert), elems);
@@ -300,7 +310,7 @@ int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, n
 	if (res) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-		_oph_ioserver_nc_clear_buffer(buff);
+		_oph_ioserver_nc_clear_buffer_(buff, 0, 1);
 		return OPH_IO_SERVER_MEMORY_ERROR;
 	}
 
@@ -308,107 +318,48 @@ int _oph_ioserver_nc_create_buffer(Buffer * buff, char transpose, char shared, n
 }
 
 
-int _oph_ioserver_nc_read_data_v0(Buffer * buff, int offset, char transpose, char shared, nc_type vartype, int ndims, char *src_path, char *measure_name, size_t * start, size_t * count, int ncid,
-				  int varid, unsigned long long tuples, unsigned long long idDim, int nexp, unsigned int *sizemax, short int *dims_type, short int *dims_index, int *dims_start)
+int _oph_ioserver_nc_read_data_v0(Buffer * buff, int offset, char transpose, char shared, nc_type vartype, int ndims, char *src_path, char *measure_name, size_t * start, size_t * count,
+				  oph_io_server_nc_file * file, int varid, unsigned long long tuples, unsigned long long idDim, int nexp, unsigned int *sizemax, short int *dims_type, short int *dims_index, int *dims_start)
 {
 #ifdef OPH_PAR_NC4
 	if (shared) {
 		pmesg(LOG_DEBUG, __FILE__, __LINE__, "Loading data from binary\n");
 		logging(LOG_DEBUG, __FILE__, __LINE__, "Loading data from binary\n");
 
-		int shm_id = 0;
+		int shm_fd = -1;
 		if (transpose)
-			shm_id = buff->cache_sh;
+			shm_fd = buff->cache_sh;
 		else
-			shm_id = buff->insert_sh;
-
-		//Setup message for child process
-		char msg[MSG_LEN] = { '\0' };
-		int msg_len = strlen(src_path) + strlen(measure_name) + 2 * (ndims + 1) * (INT_LEN + 1) + (LONG_LEN + 1) + (tuples > 1 ? (LONG_LEN + 1) + (2 * ndims + 1) * (INT_LEN + 1) : 0);
-		if (msg_len > MSG_LEN) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to setup message for child process\n");
-			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to setup message for child process\n");
-			return OPH_IO_SERVER_EXEC_ERROR;
-		}
-		int c = snprintf(msg, MSG_LEN, "%d|%s|%s|", shm_id, src_path, measure_name);
-		int i = 0, index = 0;
-		for (i = 0; i < ndims; i++)
-			index += snprintf(&msg[c + index], INT_LEN + 1, "%d;", (size_t *) start[i]);
-		msg[c + index++] = '|';
-		for (i = 0; i < ndims; i++)
-			index += snprintf(&msg[c + index], INT_LEN + 1, "%d;", (size_t *) count[i]);
-		msg[c + index++] = '|';
-		index += snprintf(&msg[c + index], INT_LEN + 1, "%d", offset);
-		msg[c + index++] = '|';
-		index += snprintf(&msg[c + index], LONG_LEN + 1, "%lld", tuples);
+			shm_fd = buff->insert_sh;
+
+		//Setup request for a loader process
+		oph_io_server_nc_loader_request request;
+		request.ndims = ndims;
+		request.nexp = nexp;
+		request.offset = offset;
+		request.tuples = tuples;
+		request.id_dim = idDim;
+		request.start = start;
+		request.count = count;
+		request.sizemax = sizemax;
+		request.dims_index = NULL;
+		request.dims_start = dims_start;
+		request.src_path = src_path;
+		request.measure_name = measure_name;
+
+		int i = 0, dims_index_[ndims];
 		if (tuples > 1) {
-			msg[c + index++] = '|';
-			index += snprintf(&msg[c + index], LONG_LEN + 1, "%lld", idDim);
-			msg[c + index++] = '|';
-			index += snprintf(&msg[c + index], INT_LEN + 1, "%d", nexp);
-			msg[c + index++] = '|';
-			for (i = 0; i < nexp; i++)
-				index += snprintf(&msg[c + index], INT_LEN + 1, "%d;", sizemax[i]);
-			msg[c + index++] = '|';
-			for (i = 0; i < ndims; i++)
-				index += snprintf(&msg[c + index], INT_LEN + 1, "%d;", dims_type[i] ? dims_index[i] : -1);
-			msg[c + index++] = '|';
 			for (i = 0; i < ndims; i++)
-				index += snprintf(&msg[c + index], INT_LEN + 1, "%d;", dims_start[i]);
+				dims_index_[i] = dims_type[i] ? dims_index[i] : -1;
+			request.dims_index = dims_index_;
 		}
 
-		pmesg(LOG_DEBUG, __FILE__, __LINE__, "MESSAGE IS %s\n", msg);
-
-		//Open pipe
-		int fd[2];
-		if (pipe(fd) == -1) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Error in opening pipe: %s\n", strerror(errno));
-			logging(LOG_ERROR, __FILE__, __LINE__, "Error in opening pipe: %s\n", strerror(errno));
-			return OPH_IO_SERVER_EXEC_ERROR;
-		}
-		pid_t child_pid;
-		//Fork process to fill shared memory
-		if ((child_pid = fork()) == 0) {
-			//Replace SDTIN with pipe
-			close(STDIN_FILENO);
-			dup(fd[0]);
-			close(fd[0]);
-			close(fd[1]);
-
-			char *exec_path = OPH_NC_LOAD_EXEC;
-			if (execvp(exec_path, (char *[]) {
-				   exec_path, NULL}) == -1)
-				exit(errno);
-			else
-				exit(0);
-		}
-		//Close read end of pipe
-		close(fd[0]);
-		//Send message to child process
-		if (write(fd[1], msg, msg_len) == -1) {
-			close(fd[1]);
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to send shared memory id to child\n");
-			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to send shared memory id to child\n");
-			return OPH_IO_SERVER_EXEC_ERROR;
-		}
-		close(fd[1]);
-
-		//Wait for child process to end
-		int status;
-		waitpid(child_pid, &status, 0);
-		if ((WIFEXITED(status)) == 0) {
+		if (oph_io_server_nc_loader_read(shm_fd, &request)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, "Error in binary array filling\n");
 			logging(LOG_ERROR, __FILE__, __LINE__, "Error in binary array filling\n");
 			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
-		pmesg(LOG_DEBUG, __FILE__, __LINE__, "Loading process status is: %d\n", status);
-		pmesg(LOG_DEBUG, __FILE__, __LINE__, "Shared cache ID is: %d\n", shm_id);
-
-		if ((status = WEXITSTATUS(status)) != 0) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Error in binary array filling: %s\n", strerror(status));
-			logging(LOG_ERROR, __FILE__, __LINE__, "Error in binary array filling: %s\n", strerror(status));
-			return OPH_IO_SERVER_MEMORY_ERROR;
-		}
+		pmesg(LOG_DEBUG, __FILE__, __LINE__, "Shared cache descriptor is: %d\n", shm_fd);
 	} else {
 #endif
 		pmesg(LOG_DEBUG, __FILE__, __LINE__, "Loading data directly\n");
@@ -422,37 +373,31 @@ int _oph_ioserver_nc_read_data_v0(Buffer * buff, int offset, char transpose, cha
 		else
 			buffer = buff->insert;
 
-		int ncid_int = 0, varid_int = 0;
-		if (ncid == 0 || varid == 0) {
-			if (pthread_mutex_lock(&nc_lock) != 0) {
-				pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
-				logging(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
-				return OPH_IO_SERVER_EXEC_ERROR;
-			}
-			if ((res = nc_open(src_path, NC_NOWRITE, &ncid_int))) {
-				pthread_mutex_unlock(&nc_lock);
-				pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s': %s\n", src_path, nc_strerror(res));
-				logging(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s': %s\n", src_path, nc_strerror(res));
-				return OPH_IO_SERVER_EXEC_ERROR;
-			}
-			if (pthread_mutex_unlock(&nc_lock) != 0) {
-				pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
-				logging(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
+		//Files not opened by the caller are taken from the cache
+		oph_io_server_nc_file *file_int = file;
+		int varid_int = varid;
+		if (!file) {
+			oph_io_server_nc_var *var = NULL;
+			if (oph_io_server_nc_cache_open(src_path, &file_int)) {
+				pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s'\n", src_path);
+				logging(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s'\n", src_path);
 				return OPH_IO_SERVER_EXEC_ERROR;
 			}
 			//Extract measured variable information
-			int varid = 0;
-			if ((res = nc_inq_varid(ncid_int, measure_name, &varid_int))) {
-				pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information: %s\n", nc_strerror(res));
-				logging(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information: %s\n", nc_strerror(res));
-				pthread_mutex_lock(&nc_lock);
-				nc_close(ncid_int);
-				pthread_mutex_unlock(&nc_lock);
+			if (oph_io_server_nc_cache_get_var(file_int, measure_name, &var)) {
+				pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information\n");
+				logging(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information\n");
+				oph_io_server_nc_cache_close(file_int);
 				return OPH_IO_SERVER_EXEC_ERROR;
 			}
-		} else {
-			ncid_int = ncid;
-			varid_int = varid;
+			varid_int = var->varid;
+		}
+		int ncid_int = file_int->ncid;
+
+		if (oph_io_server_nc_cache_lock(file_int)) {
+			if (!file)
+				oph_io_server_nc_cache_close(file_int);
+			return OPH_IO_SERVER_EXEC_ERROR;
 		}
 
 		switch (vartype) {
@@ -479,11 +424,9 @@ int _oph_ioserver_nc_read_data_v0(Buffer * buff, int offset, char transpose, cha
 				res = nc_get_vara_double(ncid_int, varid_int, start, count, (double *) buffer + offset);
 		}
 
-		if (ncid == 0 || varid == 0) {
-			pthread_mutex_lock(&nc_lock);
-			nc_close(ncid_int);
-			pthread_mutex_unlock(&nc_lock);
-		}
+		oph_io_server_nc_cache_unlock(file_int);
+		if (!file)
+			oph_io_server_nc_cache_close(file_int);
 		if (res != 0) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, "Error in binary array filling: %s\n", nc_strerror(res));
 			logging(LOG_ERROR, __FILE__, __LINE__, "Error in binary array filling: %s\n", nc_strerror(res));
@@ -497,22 +440,14 @@ int _oph_ioserver_nc_read_data_v0(Buffer * buff, int offset, char transpose, cha
 
 int _oph_ioserver_nc_read_data(Buffer * buff, int offset, char transpose, char shared, nc_type vartype, int ndims, char *src_path, char *measure_name, size_t * start, size_t * count)
 {
-	return _oph_ioserver_nc_read_data_v0(buff, offset, transpose, shared, vartype, ndims, src_path, measure_name, start, count, 0, 0, 1, 0, 0, NULL, NULL, NULL, NULL);
+	return _oph_ioserver_nc_read_data_v0(buff, offset, transpose, shared, vartype, ndims, src_path, measure_name, start, count, NULL, 0, 1, 0, 0, NULL, NULL, NULL, NULL);
 }
 
 #define _oph_ioserver_nc_release_buffer_cache(buff, buffer) _oph_ioserver_nc_release_buffer(buff, buffer, 1)
 #define _oph_ioserver_nc_release_buffer_insert(buff, buffer) _oph_ioserver_nc_release_buffer(buff, buffer, 0)
 int _oph_ioserver_nc_release_buffer(Buffer * buff, char *buffer, char is_cache)
 {
-#ifdef OPH_PAR_NC4
-	if (is_cache) {
-		if (buff->cache_sh)
-			shmdt(buffer);
-	} else {
-		if (buff->insert_sh)
-			shmdt(buffer);
-	}
-#endif
+	//Shared memory is mapped once, when the buffer is created
 	return OPH_IO_SERVER_SUCCESS;
 }
 
@@ -520,31 +455,10 @@ int _oph_ioserver_nc_release_buffer(Buffer * buff, char *buffer, char is_cache)
 #define _oph_ioserver_nc_get_buffer_insert(buff, buffer) _oph_ioserver_nc_get_buffer(buff, buffer, 0)
 int _oph_ioserver_nc_get_buffer(Buffer * buff, char **buffer, char is_cache)
 {
-	if (is_cache) {
-#ifdef OPH_PAR_NC4
-		if (buff->cache_sh) {
-			//Attach shared memory segment to process
-			if ((*buffer = shmat(buff->cache_sh, NULL, 0)) == (char *) -1) {
-				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-				return OPH_IO_SERVER_MEMORY_ERROR;
-			}
-		} else
-#endif
-			*buffer = buff->cache;
-	} else {
-#ifdef OPH_PAR_NC4
-		if (buff->insert_sh) {
-			//Attach shared memory segment to process
-			if ((*buffer = shmat(buff->insert_sh, NULL, 0)) == (char *) -1) {
-				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-				return OPH_IO_SERVER_MEMORY_ERROR;
-			}
-		} else
-#endif
-			*buffer = buff->insert;
-	}
+	if (is_cache)
+		*buffer = buff->cache;
+	else
+		*buffer = buff->insert;
 	return OPH_IO_SERVER_SUCCESS;
 }
 
@@ -574,182 +488,296 @@ int oph_ioserver_nc_compute_dimension_id(unsigned long ID, unsigned int *sizemax
 	return 0;
 }
 
-int _oph_ioserver_nc_cache_to_buffer3(short int tot_dim_number, unsigned int *counters, unsigned int *limits, unsigned int *blocks, unsigned int *src_products, char *src_binary,
-				      unsigned int *dst_products, char *dst_binary, size_t sizeof_var)
+//Slots of the chunk cache for each chunk it can hold
+#define OPH_IO_SERVER_NC_CHUNK_CACHE_SLOTS 100
+
+static unsigned long long _oph_ioserver_nc_next_prime(unsigned long long n)
 {
-	//At lease 1 dim shuld be defined
+	unsigned long long d;
+	if (n <= 2)
+		return 2;
+	for (n |= 1;; n += 2) {
+		for (d = 3; (d * d <= n) && (n % d); d += 2);
+		if (d * d > n)
+			return n;
+	}
+}
 
-	short int i = 0, j = 0;
-	long long k = 0, index = 0;
-	long long dst_addr = 0, src_addr = 0;
-	long long total_iter = 1;
+//Size the chunk cache of the variable to hold the chunks of a whole slice of the most external explicit dimension, so that chunks shared by the reads of an import (and by the
+//following fragments, since the file is kept open) are decompressed once. Return in chunk_len the chunk length along read_dim (0 if the variable is not chunked)
+static int _oph_ioserver_nc_plan_chunks(char *src_path, char *measure_name, int ndims, short int *dims_type, short int *dims_index, int *dims_start, int *dims_end, int most_extern_id,
+					int read_dim, size_t sizeof_type, size_t * chunk_len)
+{
+	*chunk_len = 0;
 
-	unsigned int tmp_start[tot_dim_number];
-	unsigned int tmp_end[tot_dim_number];
+	oph_io_server_nc_file *nc_file = NULL;
+	oph_io_server_nc_var *nc_var = NULL;
+	if (oph_io_server_nc_cache_open(src_path, &nc_file)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s'\n", src_path);
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s'\n", src_path);
+		return OPH_IO_SERVER_EXEC_ERROR;
+	}
+	if (oph_io_server_nc_cache_get_var(nc_file, measure_name, &nc_var)) {
+		oph_io_server_nc_cache_close(nc_file);
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information\n");
+		return OPH_IO_SERVER_EXEC_ERROR;
+	}
 
-	for (i = 0; i < tot_dim_number; i++) {
-		if (i != 0)
-			counters[i] = 0;
-		if (i != tot_dim_number - 1)
-			total_iter *= (limits[i] - counters[i]);
-		tmp_start[i] = 0;
-		tmp_end[i] = blocks[i];
+	int i;
+	unsigned long long chunk_size = sizeof_type, slice_chunks = 1;
+	for (i = 0; nc_var->chunk_len && (i < ndims); i++) {
+		if (!nc_var->chunk_len[i])
+			break;
+		chunk_size *= nc_var->chunk_len[i];
+		//Explicit dimensions outer than the most external one are not split, slices of the most external one are read in sequence
+		if (!dims_type[i] || (dims_index[i] > most_extern_id))
+			slice_chunks *= dims_end[i] / nc_var->chunk_len[i] - dims_start[i] / nc_var->chunk_len[i] + 1;
+	}
+	if (!nc_var->chunk_len || (nc_var->ndims != ndims) || (i < ndims)) {
+		oph_io_server_nc_cache_close(nc_file);
+		pmesg(LOG_DEBUG, __FILE__, __LINE__, "Variable '%s' of '%s' is not chunked: reads follow the fragment layout\n", measure_name, src_path);
+		logging(LOG_DEBUG, __FILE__, __LINE__, "Variable '%s' of '%s' is not chunked: reads follow the fragment layout\n", measure_name, src_path);
+		return OPH_IO_SERVER_SUCCESS;
+	}
 
-		//Extend products to consider size of var
-		src_products[i] *= sizeof_var;
-		dst_products[i] *= sizeof_var;
+	unsigned long long memory_size = memory_buffer * (unsigned long long) MB_SIZE;
+	unsigned long long cache_size = slice_chunks * chunk_size;
+	char capped = 0;
+	if (cache_size > memory_size / 2) {
+		cache_size = (memory_size / 2 > chunk_size ? memory_size / 2 : chunk_size);
+		capped = 1;
 	}
+	unsigned long long nelems = _oph_ioserver_nc_next_prime(OPH_IO_SERVER_NC_CHUNK_CACHE_SLOTS * (cache_size / chunk_size));
+	oph_io_server_nc_cache_set_chunk_cache(nc_file, nc_var, cache_size, nelems);
 
-	long long src_jump = src_products[tot_dim_number - 1];
-	long long dst_jump = dst_products[tot_dim_number - 1];
-	long long inner_blocks = 0;
-	long long inner_counter = 0;
+	if (read_dim >= 0)
+		*chunk_len = nc_var->chunk_len[read_dim];
 
-	total_iter *= ceil((double) (limits[tot_dim_number - 1] - counters[tot_dim_number - 1]) / blocks[tot_dim_number - 1]);
+	pmesg(LOG_DEBUG, __FILE__, __LINE__,
+	      "Chunk plan of '%s' in '%s': chunks of %llu bytes (deflate level %d, shuffle %d), %llu chunks per slice, chunk cache of %llu bytes with %llu slots%s, reads aligned to %zu values of dimension %d\n",
+	      measure_name, src_path, chunk_size, nc_var->deflate_level, nc_var->shuffle, slice_chunks, cache_size, nelems, capped ? " (limited by memory buffer)" : "", *chunk_len,
+	      read_dim);
+	logging(LOG_DEBUG, __FILE__, __LINE__,
+		"Chunk plan of '%s' in '%s': chunks of %llu bytes (deflate level %d, shuffle %d), %llu chunks per slice, chunk cache of %llu bytes with %llu slots%s, reads aligned to %zu values of dimension %d\n",
+		measure_name, src_path, chunk_size, nc_var->deflate_level, nc_var->shuffle, slice_chunks, cache_size, nelems, capped ? " (limited by memory buffer)" : "", *chunk_len,
+		read_dim);
 
-	for (index = 0; index < total_iter; index++) {
-		dst_addr = src_addr = 0;
+	oph_io_server_nc_cache_close(nc_file);
 
-		//External dimensions
-		for (i = 0; i < tot_dim_number - 1; i++) {
-			src_addr += (long long) counters[i] * src_products[i];
-			dst_addr += (long long) counters[i] * dst_products[i];
-		}
+	return OPH_IO_SERVER_SUCCESS;
+}
 
-		//Internal dimension
-		inner_counter = tmp_start[tot_dim_number - 1];
-		inner_blocks = tmp_end[tot_dim_number - 1];
-		for (k = inner_counter; k < inner_blocks; k++) {
-			memcpy(dst_binary + (dst_addr + k * dst_jump), src_binary + (src_addr + k * src_jump), sizeof_var);
-		}
+//Import a fragment that does not fit in the memory buffer: the hyperslab is read in windows of whole values of the most external explicit dimension, so that the buffers are bounded by the window size
+static int _oph_ioserver_nc_read_v2_stream(char is_netcdf4, char *src_path, char *measure_name, unsigned long long tuplexfrag_number, long long frag_key_start, char compressed_flag, int ndims,
+					   int nexp, short int *dims_type, short int *dims_index, int *dims_start, int *dims_end, oph_iostore_frag_record_set * binary_frag,
+					   unsigned long long *frag_size, unsigned long long sizeof_var, nc_type vartype, int id_dim_pos, int measure_pos, unsigned long long array_length, Buffer * buff,
+					   char transpose, int most_extern_id, long long inner_rows)
+{
+	int i = 0, j = 0, k = 0, ext_dim = -1;
 
-		//Increase block counters starting from most internal dimension (excluding the most internal)
-		for (i = tot_dim_number - 2; i >= 0; i--) {
-			counters[i]++;
-			if (counters[i] < tmp_end[i]) {
+	unsigned long long memory_size = memory_buffer * (unsigned long long) MB_SIZE;
+	unsigned long long window_size = (memory_size / 2) / (sizeof_var * inner_rows);
+	//Inner dimensions are not split, so at least a value of the most external dimension has to fit in memory
+	if (!window_size) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read fragment in memory. Memory required is: %lld\n", tuplexfrag_number * sizeof_var);
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to read fragment in memory. Memory required is: %lld\n", tuplexfrag_number * sizeof_var);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+	unsigned long long window_rows = window_size * inner_rows;
+	if (window_rows > tuplexfrag_number)
+		window_rows = tuplexfrag_number;
+
+	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Importing fragment of %llu rows in windows of %llu rows\n", tuplexfrag_number, window_rows);
+	logging(LOG_DEBUG, __FILE__, __LINE__, "Importing fragment of %llu rows in windows of %llu rows\n", tuplexfrag_number, window_rows);
+
+	//Buffers are allocated once for the largest window
+	if (_oph_ioserver_nc_create_buffer(buff, transpose, is_netcdf4, vartype, array_length * window_rows)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+
+	unsigned long long idDim = frag_key_start;
+
+	unsigned int *sizemax = (unsigned int *) malloc(nexp * sizeof(unsigned int));
+	size_t *start = (size_t *) malloc(ndims * sizeof(size_t));
+	size_t *count = (size_t *) malloc(ndims * sizeof(size_t));
+	size_t **start_pointer = (size_t **) malloc(nexp * sizeof(size_t *));
+	unsigned int *limits = (unsigned int *) malloc(ndims * sizeof(unsigned int));
+	unsigned int *src_products = (unsigned int *) malloc(ndims * sizeof(unsigned int));
+	unsigned int *dst_products = (unsigned int *) malloc(ndims * sizeof(unsigned int));
+	int *file_indexes = (int *) malloc(ndims * sizeof(int));
+	int arg_count = binary_frag->field_num;
+	oph_query_arg **args = (oph_query_arg **) calloc(arg_count, sizeof(oph_query_arg *));
+	char **value_list = (char **) calloc(arg_count, sizeof(char *));
+	int res = !sizemax || !start || !count || !start_pointer || !limits || !src_products || !dst_products || !file_indexes || !args || !value_list;
+	for (i = 0; !res && (i < arg_count); i++)
+		res = !(args[i] = (oph_query_arg *) calloc(1, sizeof(oph_query_arg)));
+	if (res) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		res = OPH_IO_SERVER_MEMORY_ERROR;
+	}
+	//Start of the fragment (dimensions are not split by multiple files)
+	for (j = 0; !res && (j < nexp); j++) {
+		for (i = 0; i < ndims; i++)
+			if (dims_type[i] && (dims_index[i] == j))
 				break;
+		if (i == ndims) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Invalid explicit dimensions in task string \n");
+			logging(LOG_ERROR, __FILE__, __LINE__, "Invalid explicit dimensions in task string \n");
+			res = OPH_IO_SERVER_EXEC_ERROR;
+			break;
+		}
+		sizemax[j] = dims_end[i] - dims_start[i] + 1;
+		start_pointer[j] = &(start[i]);
+		if (j == most_extern_id)
+			ext_dim = i;
+	}
+	if (!res) {
+		oph_ioserver_nc_compute_dimension_id(idDim, sizemax, nexp, start_pointer);
+		for (i = 0; i < ndims; i++) {
+			if (dims_type[i]) {
+				start[i] += dims_start[i] - 1;
+				count[i] = (dims_index[i] == most_extern_id ? tuplexfrag_number / inner_rows : dims_end[i] - dims_start[i] + 1);
 			} else {
-				counters[i] = tmp_start[i];
-
-				if (i == 0) {
-					for (j = tot_dim_number - 1; j >= 0; j--) {
-						tmp_start[j] += blocks[j];
-						tmp_end[j] += blocks[j];
-
-						if (tmp_start[j] < limits[j]) {
-							counters[j] = tmp_start[j];
-							if (tmp_end[j] > limits[j])
-								tmp_end[j] = limits[j];
-							break;
-						} else {
-							counters[j] = tmp_start[j] = 0;
-							tmp_end[j] = blocks[j];
-						}
-					}
-				}
+				start[i] = dims_start[i];
+				count[i] = dims_end[i] - dims_start[i] + 1;
 			}
+			file_indexes[dims_index[i]] = i;
 		}
 	}
 
-	return 0;
-}
+	if (!res) {
+		value_list[id_dim_pos] = DIM_VALUE;
+		value_list[measure_pos] = (compressed_flag == 1 ? COMPRESSED_VALUE : UNCOMPRESSED_VALUE);
+		args[id_dim_pos]->arg_length = sizeof(unsigned long long);
+		args[id_dim_pos]->arg_type = OPH_QUERY_TYPE_LONG;
+		args[id_dim_pos]->arg_is_null = 0;
+		args[id_dim_pos]->arg = (unsigned long long *) (&idDim);
+		args[measure_pos]->arg_length = sizeof_var;
+		args[measure_pos]->arg_type = OPH_QUERY_TYPE_BLOB;
+		args[measure_pos]->arg_is_null = 0;
+	}
 
+	size_t sizeof_type = sizeof_var / array_length;
 
-int _oph_ioserver_nc_cache_to_buffer2(short int tot_dim_number, unsigned int *counters, unsigned int *limits, unsigned int *blocks, unsigned int *src_products, char *src_binary,
-				      unsigned int *dst_products, char *dst_binary, size_t sizeof_var)
-{
-	short int i = 0, j = 0;
-	long long dst_addr = 0, src_addr = 0;
-	long long index = 0;
-	long long total_iter = 1;
+	//Windows larger than a chunk are made of whole chunks, so that no chunk is decompressed by two windows
+	size_t chunk_len = 0;
+	if (!res && _oph_ioserver_nc_plan_chunks(src_path, measure_name, ndims, dims_type, dims_index, dims_start, dims_end, most_extern_id, ext_dim, sizeof_type, &chunk_len))
+		res = OPH_IO_SERVER_EXEC_ERROR;
+	if ((chunk_len > 1) && (window_size >= chunk_len))
+		window_size -= window_size % chunk_len;
+	else
+		chunk_len = 0;
 
-	unsigned int tmp_start[tot_dim_number];
-	unsigned int tmp_end[tot_dim_number];
+	size_t ext_start = ext_dim < 0 ? 0 : start[ext_dim], ext_count = ext_dim < 0 ? 1 : count[ext_dim];
+	unsigned long long row_size = 0, cumulative_size = 0, ii = 0, jj = 0, rows = 0;
+	oph_iostore_frag_record *new_record = NULL;
+	char *buffer_in = NULL, *buffer_out = NULL;
+	size_t w, window = window_size;
 
-	for (i = 0; i < tot_dim_number; i++) {
-		if (i != 0) {
-			counters[i] = 0;
+	for (w = 0; !res && (w < ext_count); w += window) {
+		if (ext_dim >= 0) {
+			start[ext_dim] = ext_start + w;
+			//The first window ends at a chunk boundary
+			window = window_size - (chunk_len ? start[ext_dim] % chunk_len : 0);
+			count[ext_dim] = (ext_count - w < window ? ext_count - w : window);
 		}
-		total_iter *= (limits[i] - counters[i]);
-		tmp_start[i] = 0;
-		tmp_end[i] = blocks[i];
-		src_products[i] *= sizeof_var;
-		dst_products[i] *= sizeof_var;
-	}
+		rows = (ext_dim >= 0 ? count[ext_dim] : 1) * inner_rows;
 
-	for (index = 0; index < total_iter; index++) {
-		dst_addr = src_addr = 0;
+		if (_oph_ioserver_nc_read_data(buff, 0, transpose, is_netcdf4, vartype, ndims, src_path, measure_name, start, count)) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_BINARY_ARRAY_LOAD);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_BINARY_ARRAY_LOAD);
+			res = OPH_IO_SERVER_MEMORY_ERROR;
+			break;
+		}
 
-		for (i = 0; i < tot_dim_number; i++) {
-			src_addr += (long long) counters[i] * src_products[i];
-			dst_addr += (long long) counters[i] * dst_products[i];
+		if (transpose) {
+			//Source follows file order, destination follows oph_level order
+			for (i = 0; i < ndims; i++) {
+				limits[dims_index[i]] = count[i];
+			}
+			for (k = 0; k < ndims; k++) {
+				dst_products[k] = src_products[k] = 1;
+				for (j = k + 1; j < ndims; j++)
+					dst_products[k] *= limits[j];
+				for (i = file_indexes[k] + 1; i < ndims; i++)
+					src_products[k] *= count[i];
+			}
+			if (_oph_ioserver_nc_get_buffer_cache(buff, &buffer_in)) {
+				res = OPH_IO_SERVER_MEMORY_ERROR;
+				break;
+			}
+			if (_oph_ioserver_nc_get_buffer_insert(buff, &buffer_out)) {
+				_oph_ioserver_nc_release_buffer_cache(buff, buffer_in);
+				res = OPH_IO_SERVER_MEMORY_ERROR;
+				break;
+			}
+			oph_server_transpose(ndims, limits, src_products, buffer_in, dst_products, buffer_out, sizeof_type);
+			_oph_ioserver_nc_release_buffer_cache(buff, buffer_in);
+		} else if (_oph_ioserver_nc_get_buffer_insert(buff, &buffer_out)) {
+			res = OPH_IO_SERVER_MEMORY_ERROR;
+			break;
 		}
-		memcpy(dst_binary + dst_addr, src_binary + src_addr, sizeof_var);
 
-		//Increase block counters starting from most rapidly varying dimension
-		for (i = tot_dim_number - 1; i >= 0; i--) {
-			counters[i]++;
-			if (counters[i] < tmp_end[i]) {
+		for (jj = 0; jj < rows; jj++, ii++, idDim++) {
+			args[measure_pos]->arg = (char *) (buffer_out + jj * sizeof_var);
+			if (compressed_flag == 1 ? _oph_ioserver_query_build_row(arg_count, &row_size, binary_frag, binary_frag->field_name, value_list, args, &new_record)
+			    : _oph_ioserver_query_store_row(arg_count, &row_size, binary_frag, args, ii, tuplexfrag_number)) {
+				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
+				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
+				res = OPH_IO_SERVER_MEMORY_ERROR;
 				break;
-			} else {
-				counters[i] = tmp_start[i];
-
-				if (i == 0) {
-					for (j = tot_dim_number - 1; j >= 0; j--) {
-						tmp_start[j] += blocks[j];
-						tmp_end[j] += blocks[j];
-
-						if (tmp_start[j] < limits[j]) {
-							counters[j] = tmp_start[j];
-							if (tmp_end[j] > limits[j])
-								tmp_end[j] = limits[j];
-							break;
-						} else {
-							counters[j] = tmp_start[j] = 0;
-							tmp_end[j] = blocks[j];
-						}
-					}
-				}
 			}
+			//Add record to partial record set (rows stored in slab are already attached)
+			if (new_record)
+				binary_frag->record_set[ii] = new_record;
+			cumulative_size += row_size;
+			new_record = NULL;
+			row_size = 0;
 		}
+		_oph_ioserver_nc_release_buffer_insert(buff, buffer_out);
 	}
 
-	return 0;
-}
-
-int oph_ioserver_nc_cache_to_buffer(short int tot_dim_number, unsigned int *counters, unsigned int *limits, unsigned int *products, char *binary_cache, char *binary_insert, size_t sizeof_var)
-{
-	short int i = 0;
-	long long addr = 0;
-	long long index = 0;
-	long long total_iter = 1;
-
-	for (i = 0; i < tot_dim_number; i++) {
-		if (i != 0)
-			counters[i] = 0;
-		total_iter *= (limits[i] - counters[i]);
-		products[i] *= sizeof_var;
+	if (!res && (ii != tuplexfrag_number)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Only %llu rows of %llu have been imported\n", ii, tuplexfrag_number);
+		logging(LOG_ERROR, __FILE__, __LINE__, "Only %llu rows of %llu have been imported\n", ii, tuplexfrag_number);
+		res = OPH_IO_SERVER_EXEC_ERROR;
 	}
 
-	for (index = 0; index < total_iter; index++) {
-		addr = 0;
-		for (i = 0; i < tot_dim_number; i++) {
-			addr += (long long) counters[i] * products[i];
-		}
-		memcpy(binary_insert + index * sizeof_var, binary_cache + addr, sizeof_var);
-
-		//Increase counters starting from most rapidly varying dimension
-		for (i = tot_dim_number - 1; i >= 0; i--) {
-			counters[i]++;
-			if (counters[i] < limits[i]) {
-				break;
-			} else {
-				counters[i] = 0;
-			}
-		}
+	if (args) {
+		for (i = 0; i < arg_count; i++)
+			if (args[i])
+				free(args[i]);
+		free(args);
 	}
+	if (value_list)
+		free(value_list);
+	if (sizemax)
+		free(sizemax);
+	if (start)
+		free(start);
+	if (count)
+		free(count);
+	if (start_pointer)
+		free(start_pointer);
+	if (limits)
+		free(limits);
+	if (src_products)
+		free(src_products);
+	if (dst_products)
+		free(dst_products);
+	if (file_indexes)
+		free(file_indexes);
+	_oph_ioserver_nc_clear_buffer_cache(buff);
+	_oph_ioserver_nc_clear_buffer_insert(buff);
 
-	return 0;
+	if (!res)
+		*frag_size = cumulative_size;
+
+	return res;
 }
 
 int _oph_ioserver_nc_read_v2(char is_netcdf4, char *src_path, char *measure_name, unsigned long long tuplexfrag_number, long long frag_key_start, char compressed_flag, int ndims, int nimp, int nexp,
@@ -774,11 +802,6 @@ int _oph_ioserver_nc_read_v2(char is_netcdf4, char *src_path, char *measure_name
 	unsigned long long memory_size = memory_buffer * (unsigned long long) MB_SIZE;
 	char whole_fragment = ((tuplexfrag_number * sizeof_var) > memory_size / 2 ? 0 : 1);
 
-	if (!whole_fragment) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read fragment in memory. Memory required is: %lld\n", tuplexfrag_number * sizeof_var);
-		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to read fragment in memory. Memory required is: %lld\n", tuplexfrag_number * sizeof_var);
-		return OPH_IO_SERVER_MEMORY_ERROR;
-	}
 	//If flag is set fragment reordering is required
 	char transpose = !dimension_ordered;
 
@@ -833,6 +856,16 @@ int _oph_ioserver_nc_read_v2(char is_netcdf4, char *src_path, char *measure_name
 		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to create fragment: internal explicit dimensions are fragmented: %d tuple divided by %d\n", _tuplexfrag_number, curr_rows);
 		return OPH_IO_SERVER_EXEC_ERROR;
 	}
+
+	if (!whole_fragment) {
+		//Fragments read from a single file can be imported by windows
+		if (!offset && is_last)
+			return _oph_ioserver_nc_read_v2_stream(is_netcdf4, src_path, measure_name, tuplexfrag_number, frag_key_start, compressed_flag, ndims, nexp, dims_type, dims_index, dims_start,
+							       dims_end, binary_frag, frag_size, sizeof_var, vartype, id_dim_pos, measure_pos, array_length, buff, transpose, most_extern_id, curr_rows);
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read fragment in memory. Memory required is: %lld\n", tuplexfrag_number * sizeof_var);
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to read fragment in memory. Memory required is: %lld\n", tuplexfrag_number * sizeof_var);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
 	//Create binary array
 	long long elems = array_length * tuplexfrag_number;
 	if (_oph_ioserver_nc_create_buffer(buff, transpose, is_netcdf4, vartype, elems)) {
@@ -982,7 +1015,6 @@ int _oph_ioserver_nc_read_v2(char is_netcdf4, char *src_path, char *measure_name
 		size_t sizeof_type = (int) sizeof_var / array_length;
 
 		unsigned int *dst_products = (unsigned int *) malloc(ndims * sizeof(unsigned));
-		unsigned int *counters = (unsigned int *) malloc(ndims * sizeof(unsigned int));
 		unsigned int *src_products = (unsigned int *) malloc(ndims * sizeof(unsigned));
 		unsigned int *limits = (unsigned int *) malloc(ndims * sizeof(unsigned));
 
@@ -990,24 +1022,12 @@ int _oph_ioserver_nc_read_v2(char is_netcdf4, char *src_path, char *measure_name
 
 		//Setup arrays for recursive selection
 		for (i = 0; i < ndims; i++) {
-			counters[dims_index[i]] = 0;
 			src_products[dims_index[i]] = 1;
 			dst_products[dims_index[i]] = 1;
 			limits[dims_index[i]] = dim_unlim_whole && (i == dim_unlim) ? dim_unlim_size : count[i];
 			file_indexes[dims_index[i]] = k++;
 		}
 
-		//TODO Better block size management - Activate this only in case internal dimension is out of order and the largest
-		//Make sure most internal dimension (for write-oriented array) is at least multiple of cache line
-		unsigned int *blocks = (unsigned int *) malloc(ndims * sizeof(unsigned));
-		unsigned int line_size = floor(cache_line_size / sizeof_type);
-		unsigned long long max_blocks = floor((cache_size / 2) / (sizeof_type));
-		unsigned int block_size = floor(pow(max_blocks, (float) 1 / ndims));
-		block_size = (block_size <= line_size ? block_size : block_size - block_size % line_size);
-		for (i = ndims - 1; i >= 0; i--) {
-			blocks[i] = (limits[i] < block_size ? limits[i] : block_size);
-		}
-
 		//Compute products
 		for (k = 0; k < ndims; k++) {
 			//Compute products for new buffer
@@ -1032,10 +1052,8 @@ int _oph_ioserver_nc_read_v2(char is_netcdf4, char *src_path, char *measure_name
 					_oph_ioserver_nc_clear_buffer(buff);
 					free(count);
 					free(file_indexes);
-					free(counters);
 					free(src_products);
 					free(limits);
-					free(blocks);
 					free(dst_products);
 					return OPH_IO_SERVER_EXEC_ERROR;
 				}
@@ -1054,15 +1072,13 @@ int _oph_ioserver_nc_read_v2(char is_netcdf4, char *src_path, char *measure_name
 			_oph_ioserver_nc_clear_buffer(buff);
 			free(count);
 			free(file_indexes);
-			free(counters);
 			free(src_products);
 			free(limits);
-			free(blocks);
 			free(dst_products);
 			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
 
-		_oph_ioserver_nc_cache_to_buffer3(ndims, counters, limits, blocks, src_products, buffer_in, dst_products, buffer_out, sizeof_type);
+		oph_server_transpose(ndims, limits, src_products, buffer_in, dst_products, buffer_out, sizeof_type);
 
 		//Detach shared memory segment
 		_oph_ioserver_nc_release_buffer_cache(buff, buffer_in);
@@ -1073,10 +1089,8 @@ int _oph_ioserver_nc_read_v2(char is_netcdf4, char *src_path, char *measure_name
 		timeval_add(&total_transpose_time, &total_transpose_time, &intermediate_transpose_time);
 		pmesg(LOG_INFO, __FILE__, __LINE__, "Fragment %s:  Total transpose :\t Time %d,%06d sec\n", measure_name, (int) total_transpose_time.tv_sec, (int) total_transpose_time.tv_usec);
 #endif
-		free(counters);
 		free(src_products);
 		free(limits);
-		free(blocks);
 		free(dst_products);
 	}
 
@@ -1157,7 +1171,8 @@ int _oph_ioserver_nc_read_v2(char is_netcdf4, char *src_path, char *measure_name
 
 		args[measure_pos]->arg = (char *) (buffer + ii * sizeof_var);
 
-		if (_oph_ioserver_query_build_row(arg_count, &row_size, binary_frag, binary_frag->field_name, value_list, args, &new_record)) {
+		if (compressed_flag == 1 ? _oph_ioserver_query_build_row(arg_count, &row_size, binary_frag, binary_frag->field_name, value_list, args, &new_record)
+		    : _oph_ioserver_query_store_row(arg_count, &row_size, binary_frag, args, ii, tuplexfrag_number)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
 			for (i = 0; i < arg_count; i++)
@@ -1169,8 +1184,9 @@ int _oph_ioserver_nc_read_v2(char is_netcdf4, char *src_path, char *measure_name
 			_oph_ioserver_nc_clear_buffer_insert(buff);
 			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
-		//Add record to partial record set
-		binary_frag->record_set[ii] = new_record;
+		//Add record to partial record set (rows stored in slab are already attached)
+		if (new_record)
+			binary_frag->record_set[ii] = new_record;
 		//Update current record size
 		cumulative_size += row_size;
 
@@ -1213,11 +1229,6 @@ int _oph_ioserver_nc_read_v1(char is_netcdf4, char *src_path, char *measure_name
 	unsigned long long memory_size = memory_buffer * (unsigned long long) MB_SIZE;
 	char whole_fragment = ((tuplexfrag_number * sizeof_var) > memory_size / 2 ? 0 : 1);
 
-	if (!whole_fragment) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read fragment in memory. Memory required is: %lld\n", tuplexfrag_number * sizeof_var);
-		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to read fragment in memory. Memory required is: %lld\n", tuplexfrag_number * sizeof_var);
-		return OPH_IO_SERVER_MEMORY_ERROR;
-	}
 	//If flag is set fragment reordering is required
 	char transpose = !dimension_ordered;
 
@@ -1272,6 +1283,16 @@ int _oph_ioserver_nc_read_v1(char is_netcdf4, char *src_path, char *measure_name
 		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to create fragment: internal explicit dimensions are fragmented: %d tuple divided by %d\n", _tuplexfrag_number, curr_rows);
 		return OPH_IO_SERVER_EXEC_ERROR;
 	}
+
+	if (!whole_fragment) {
+		//Fragments read from a single file can be imported by windows
+		if (!offset && is_last)
+			return _oph_ioserver_nc_read_v2_stream(is_netcdf4, src_path, measure_name, tuplexfrag_number, frag_key_start, compressed_flag, ndims, nexp, dims_type, dims_index, dims_start,
+							       dims_end, binary_frag, frag_size, sizeof_var, vartype, id_dim_pos, measure_pos, array_length, buff, transpose, most_extern_id, curr_rows);
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read fragment in memory. Memory required is: %lld\n", tuplexfrag_number * sizeof_var);
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to read fragment in memory. Memory required is: %lld\n", tuplexfrag_number * sizeof_var);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
 	//Create binary array
 	long long elems = array_length * tuplexfrag_number;
 	if (_oph_ioserver_nc_create_buffer(buff, transpose, is_netcdf4, vartype, elems)) {
@@ -1420,7 +1441,6 @@ int _oph_ioserver_nc_read_v1(char is_netcdf4, char *src_path, char *measure_name
 		//Prepare structures for buffer insert update
 		size_t sizeof_type = (int) sizeof_var / array_length;
 
-		unsigned int *counters = (unsigned int *) malloc(ndims * sizeof(unsigned int));
 		unsigned int *src_products = (unsigned int *) malloc(ndims * sizeof(unsigned));
 		unsigned int *limits = (unsigned int *) malloc(ndims * sizeof(unsigned));
 
@@ -1430,7 +1450,6 @@ int _oph_ioserver_nc_read_v1(char is_netcdf4, char *src_path, char *measure_name
 
 		//Setup arrays for recursive selection
 		for (i = 0; i < ndims; i++) {
-			counters[dims_index[i]] = 0;
 			src_products[dims_index[i]] = 1;
 			limits[dims_index[i]] = dim_unlim_whole && (i == dim_unlim) ? dim_unlim_size : count[i];
 			file_indexes[dims_index[i]] = k++;
@@ -1456,7 +1475,6 @@ int _oph_ioserver_nc_read_v1(char is_netcdf4, char *src_path, char *measure_name
 					_oph_ioserver_nc_clear_buffer(buff);
 					free(count);
 					free(file_indexes);
-					free(counters);
 					free(src_products);
 					free(limits);
 					return OPH_IO_SERVER_EXEC_ERROR;
@@ -1476,13 +1494,12 @@ int _oph_ioserver_nc_read_v1(char is_netcdf4, char *src_path, char *measure_name
 			_oph_ioserver_nc_clear_buffer(buff);
 			free(count);
 			free(file_indexes);
-			free(counters);
 			free(src_products);
 			free(limits);
 			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
 
-		oph_ioserver_nc_cache_to_buffer(ndims, counters, limits, src_products, buffer_in, buffer_out, sizeof_type);
+		oph_server_transpose(ndims, limits, src_products, buffer_in, NULL, buffer_out, sizeof_type);
 
 		//Detach shared memory segment
 		_oph_ioserver_nc_release_buffer_cache(buff, buffer_in);
@@ -1493,7 +1510,6 @@ int _oph_ioserver_nc_read_v1(char is_netcdf4, char *src_path, char *measure_name
 		timeval_add(&total_transpose_time, &total_transpose_time, &intermediate_transpose_time);
 		pmesg(LOG_INFO, __FILE__, __LINE__, "Fragment %s:  Total transpose :\t Time %d,%06d sec\n", measure_name, (int) total_transpose_time.tv_sec, (int) total_transpose_time.tv_usec);
 #endif
-		free(counters);
 		free(src_products);
 		free(limits);
 	}
@@ -1575,7 +1591,8 @@ int _oph_ioserver_nc_read_v1(char is_netcdf4, char *src_path, char *measure_name
 
 		args[measure_pos]->arg = (char *) (buffer + ii * sizeof_var);
 
-		if (_oph_ioserver_query_build_row(arg_count, &row_size, binary_frag, binary_frag->field_name, value_list, args, &new_record)) {
+		if (compressed_flag == 1 ? _oph_ioserver_query_build_row(arg_count, &row_size, binary_frag, binary_frag->field_name, value_list, args, &new_record)
+		    : _oph_ioserver_query_store_row(arg_count, &row_size, binary_frag, args, ii, tuplexfrag_number)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
 			for (i = 0; i < arg_count; i++)
@@ -1587,8 +1604,9 @@ int _oph_ioserver_nc_read_v1(char is_netcdf4, char *src_path, char *measure_name
 			_oph_ioserver_nc_clear_buffer_insert(buff);
 			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
-		//Add record to partial record set
-		binary_frag->record_set[ii] = new_record;
+		//Add record to partial record set (rows stored in slab are already attached)
+		if (new_record)
+			binary_frag->record_set[ii] = new_record;
 		//Update current record size
 		cumulative_size += row_size;
 
@@ -1780,13 +1798,11 @@ int _oph_ioserver_nc_read_v0_n4(char is_netcdf4, char *src_path, char *measure_n
 	//Prepare structures for buffer insert update
 	size_t sizeof_type = (int) sizeof_var / array_length;
 
-	unsigned int *counters = NULL;
 	unsigned int *src_products = NULL;
 	unsigned int *limits = NULL;
 
 	if (transpose) {
 
-		counters = (unsigned int *) malloc(nimp * sizeof(unsigned int));
 		src_products = (unsigned int *) malloc(nimp * sizeof(unsigned));
 		limits = (unsigned int *) malloc(nimp * sizeof(unsigned));
 
@@ -1797,7 +1813,6 @@ int _oph_ioserver_nc_read_v0_n4(char is_netcdf4, char *src_path, char *measure_n
 		for (i = 0; i < ndims; i++) {
 			//Implicit
 			if (!dims_type[i]) {
-				counters[dims_index[i] - nexp] = 0;
 				src_products[dims_index[i] - nexp] = 1;
 				limits[dims_index[i] - nexp] = count[i];
 				file_indexes[dims_index[i] - nexp] = k++;
@@ -1827,7 +1842,6 @@ int _oph_ioserver_nc_read_v0_n4(char is_netcdf4, char *src_path, char *measure_n
 					free(start_pointer);
 					free(sizemax);
 					free(file_indexes);
-					free(counters);
 					free(src_products);
 					free(limits);
 					return OPH_IO_SERVER_EXEC_ERROR;
@@ -1843,7 +1857,6 @@ int _oph_ioserver_nc_read_v0_n4(char is_netcdf4, char *src_path, char *measure_n
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 		if (transpose) {
-			free(counters);
 			free(src_products);
 			free(limits);
 		}
@@ -1864,7 +1877,6 @@ int _oph_ioserver_nc_read_v0_n4(char is_netcdf4, char *src_path, char *measure_n
 				free(args[i]);
 		free(args);
 		if (transpose) {
-			free(counters);
 			free(src_products);
 			free(limits);
 		}
@@ -1894,7 +1906,6 @@ int _oph_ioserver_nc_read_v0_n4(char is_netcdf4, char *src_path, char *measure_n
 			free(args);
 			free(value_list);
 			if (transpose) {
-				free(counters);
 				free(src_products);
 				free(limits);
 			}
@@ -1927,8 +1938,6 @@ int _oph_ioserver_nc_read_v0_n4(char is_netcdf4, char *src_path, char *measure_n
 
 	gettimeofday(&start_read_time, NULL);
 #endif
-	int ncid = 0, varid = 0;
-
 	char *buffer_in = NULL, *buffer_out = NULL, *_buffer_out = NULL;
 
 	unsigned long long ii, tuplexfrag_number_1 = tuplexfrag_number - 1;
@@ -1954,7 +1963,7 @@ int _oph_ioserver_nc_read_v0_n4(char is_netcdf4, char *src_path, char *measure_n
 		// This version is not optimized in case the unlimited dimension is implicit!!!!! offset is set to 0 for this reason
 		//Fill binary cache
 		if (!ii
-		    && _oph_ioserver_nc_read_data_v0(buff, 0, transpose, 1, vartype, ndims, src_path, measure_name, start, count, ncid, varid, tuplexfrag_number, idDim, nexp, sizemax, dims_type,
+		    && _oph_ioserver_nc_read_data_v0(buff, 0, transpose, 1, vartype, ndims, src_path, measure_name, start, count, NULL, 0, tuplexfrag_number, idDim, nexp, sizemax, dims_type,
 						     dims_index, dims_start)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, "Error in binary array filling\n");
 			logging(LOG_ERROR, __FILE__, __LINE__, "Error in binary array filling\n");
@@ -1965,7 +1974,6 @@ int _oph_ioserver_nc_read_v0_n4(char is_netcdf4, char *src_path, char *measure_n
 			free(args);
 			free(value_list);
 			if (transpose) {
-				free(counters);
 				free(src_products);
 				free(limits);
 			}
@@ -1991,7 +1999,6 @@ int _oph_ioserver_nc_read_v0_n4(char is_netcdf4, char *src_path, char *measure_n
 			free(args);
 			free(value_list);
 			if (transpose) {
-				free(counters);
 				free(src_products);
 				free(limits);
 			}
@@ -2020,7 +2027,6 @@ int _oph_ioserver_nc_read_v0_n4(char is_netcdf4, char *src_path, char *measure_n
 				free(args);
 				free(value_list);
 				if (transpose) {
-					free(counters);
 					free(src_products);
 					free(limits);
 				}
@@ -2031,7 +2037,7 @@ int _oph_ioserver_nc_read_v0_n4(char is_netcdf4, char *src_path, char *measure_n
 				return OPH_IO_SERVER_MEMORY_ERROR;
 			}
 
-			oph_ioserver_nc_cache_to_buffer(nimp, counters, limits, src_products, buffer_in, _buffer_out, sizeof_type);
+			oph_server_transpose(nimp, limits, src_products, buffer_in, NULL, _buffer_out, sizeof_type);
 
 			//Detach shared memory segment
 			_oph_ioserver_nc_release_buffer_cache(buff, buffer_in);
@@ -2044,7 +2050,8 @@ int _oph_ioserver_nc_read_v0_n4(char is_netcdf4, char *src_path, char *measure_n
 
 		args[measure_pos]->arg = (char *) _buffer_out;
 
-		if (_oph_ioserver_query_build_row(arg_count, &row_size, binary_frag, binary_frag->field_name, value_list, args, &new_record)) {
+		if (compressed_flag == 1 ? _oph_ioserver_query_build_row(arg_count, &row_size, binary_frag, binary_frag->field_name, value_list, args, &new_record)
+		    : _oph_ioserver_query_store_row(arg_count, &row_size, binary_frag, args, ii, tuplexfrag_number)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
 			for (i = 0; i < arg_count; i++)
@@ -2053,7 +2060,6 @@ int _oph_ioserver_nc_read_v0_n4(char is_netcdf4, char *src_path, char *measure_n
 			free(args);
 			free(value_list);
 			if (transpose) {
-				free(counters);
 				free(src_products);
 				free(limits);
 			}
@@ -2065,8 +2071,9 @@ int _oph_ioserver_nc_read_v0_n4(char is_netcdf4, char *src_path, char *measure_n
 			free(sizemax);
 			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
-		//Add record to partial record set
-		binary_frag->record_set[ii] = new_record;
+		//Add record to partial record set (rows stored in slab are already attached)
+		if (new_record)
+			binary_frag->record_set[ii] = new_record;
 		//Update current record size
 		cumulative_size += row_size;
 
@@ -2091,7 +2098,6 @@ int _oph_ioserver_nc_read_v0_n4(char is_netcdf4, char *src_path, char *measure_n
 	free(sizemax);
 
 	if (transpose) {
-		free(counters);
 		free(src_products);
 		free(limits);
 	}
@@ -2193,15 +2199,36 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to create fragment: internal explicit dimensions are fragmented: %d tuple divided by %d\n", _tuplexfrag_number, curr_rows);
 		return OPH_IO_SERVER_EXEC_ERROR;
 	}
+	//Rows sharing the chunks of the innermost explicit dimension are read together (only if it is followed by implicit dimensions in the file)
+	int inner_dim = -1;
+	for (i = 0; !transpose && !offset && is_last && (i < ndims); i++)
+		if (dims_type[i] && (dims_index[i] == nexp - 1))
+			inner_dim = i;
+	for (i = inner_dim + 1; (inner_dim >= 0) && (i < ndims); i++)
+		if (dims_type[i])
+			inner_dim = -1;
+	size_t chunk_len = 0;
+	if (_oph_ioserver_nc_plan_chunks(src_path, measure_name, ndims, dims_type, dims_index, dims_start, dims_end, most_extern_id, inner_dim, sizeof_var / array_length, &chunk_len))
+		return OPH_IO_SERVER_EXEC_ERROR;
+	unsigned long long max_rows = 1;
+	if ((inner_dim >= 0) && (chunk_len > 1)) {
+		max_rows = (memory_buffer * (unsigned long long) MB_SIZE / 2) / sizeof_var;
+		if (max_rows > chunk_len)
+			max_rows = chunk_len;
+		if (max_rows > tuplexfrag_number)
+			max_rows = tuplexfrag_number;
+		if (!max_rows)
+			max_rows = 1;
+	}
 	//Create binary array
-	long long elems = array_length;
+	long long elems = array_length * max_rows;
 	if (_oph_ioserver_nc_create_buffer(buff, transpose, is_netcdf4, vartype, elems)) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 		return OPH_IO_SERVER_MEMORY_ERROR;
 	}
 
-	unsigned long long idDim = frag_key_start;
+	unsigned long long idDim = frag_key_start, row_id = idDim;
 
 	//start and count array must be sorted based on the actual order of dimensions in the nc file
 	//sizemax must be sorted based on the actual oph_level value
@@ -2280,13 +2307,11 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 	//Prepare structures for buffer insert update
 	size_t sizeof_type = (int) sizeof_var / array_length;
 
-	unsigned int *counters = NULL;
 	unsigned int *src_products = NULL;
 	unsigned int *limits = NULL;
 
 	if (transpose) {
 
-		counters = (unsigned int *) malloc(nimp * sizeof(unsigned int));
 		src_products = (unsigned int *) malloc(nimp * sizeof(unsigned));
 		limits = (unsigned int *) malloc(nimp * sizeof(unsigned));
 
@@ -2297,7 +2322,6 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 		for (i = 0; i < ndims; i++) {
 			//Implicit
 			if (!dims_type[i]) {
-				counters[dims_index[i] - nexp] = 0;
 				src_products[dims_index[i] - nexp] = 1;
 				limits[dims_index[i] - nexp] = count[i];
 				file_indexes[dims_index[i] - nexp] = k++;
@@ -2327,7 +2351,6 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 					free(start_pointer);
 					free(sizemax);
 					free(file_indexes);
-					free(counters);
 					free(src_products);
 					free(limits);
 					return OPH_IO_SERVER_EXEC_ERROR;
@@ -2343,7 +2366,6 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 		if (transpose) {
-			free(counters);
 			free(src_products);
 			free(limits);
 		}
@@ -2364,7 +2386,6 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 				free(args[i]);
 		free(args);
 		if (transpose) {
-			free(counters);
 			free(src_products);
 			free(limits);
 		}
@@ -2394,7 +2415,6 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 			free(args);
 			free(value_list);
 			if (transpose) {
-				free(counters);
 				free(src_products);
 				free(limits);
 			}
@@ -2410,7 +2430,7 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 	args[id_dim_pos]->arg_length = sizeof(unsigned long long);
 	args[id_dim_pos]->arg_type = OPH_QUERY_TYPE_LONG;
 	args[id_dim_pos]->arg_is_null = 0;
-	args[id_dim_pos]->arg = (unsigned long long *) (&idDim);
+	args[id_dim_pos]->arg = (unsigned long long *) (&row_id);
 	args[measure_pos]->arg_length = sizeof_var;
 	args[measure_pos]->arg_type = OPH_QUERY_TYPE_BLOB;
 	args[measure_pos]->arg_is_null = 0;
@@ -2427,12 +2447,13 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 
 	gettimeofday(&start_read_time, NULL);
 #endif
-	int ncid = 0, varid = 0;
+	oph_io_server_nc_file *nc_file = NULL;
+	int varid = 0;
 	if (!is_netcdf4) {
-		int res = 0;
-		if (pthread_mutex_lock(&nc_lock) != 0) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
-			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
+		oph_io_server_nc_var *nc_var = NULL;
+		if (oph_io_server_nc_cache_open(src_path, &nc_file)) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s'\n", src_path);
+			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s'\n", src_path);
 			_oph_ioserver_nc_clear_buffer(buff);
 			for (i = 0; i < arg_count; i++)
 				if (args[i])
@@ -2440,48 +2461,6 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 			free(args);
 			free(value_list);
 			if (transpose) {
-				free(counters);
-				free(src_products);
-				free(limits);
-			}
-			free(start);
-			free(count);
-			free(start_pointer);
-			free(sizemax);
-			return OPH_IO_SERVER_EXEC_ERROR;
-		}
-		if ((res = nc_open(src_path, NC_NOWRITE, &ncid))) {
-			pthread_mutex_unlock(&nc_lock);
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s': %s\n", src_path, nc_strerror(res));
-			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s': %s\n", src_path, nc_strerror(res));
-			_oph_ioserver_nc_clear_buffer(buff);
-			for (i = 0; i < arg_count; i++)
-				if (args[i])
-					free(args[i]);
-			free(args);
-			free(value_list);
-			if (transpose) {
-				free(counters);
-				free(src_products);
-				free(limits);
-			}
-			free(start);
-			free(count);
-			free(start_pointer);
-			free(sizemax);
-			return OPH_IO_SERVER_EXEC_ERROR;
-		}
-		if (pthread_mutex_unlock(&nc_lock) != 0) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
-			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
-			_oph_ioserver_nc_clear_buffer(buff);
-			for (i = 0; i < arg_count; i++)
-				if (args[i])
-					free(args[i]);
-			free(args);
-			free(value_list);
-			if (transpose) {
-				free(counters);
 				free(src_products);
 				free(limits);
 			}
@@ -2492,12 +2471,10 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
 		//Extract measured variable information
-		if ((res = nc_inq_varid(ncid, measure_name, &varid))) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information: %s\n", nc_strerror(res));
-			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information: %s\n", nc_strerror(res));
-			pthread_mutex_lock(&nc_lock);
-			nc_close(ncid);
-			pthread_mutex_unlock(&nc_lock);
+		if (oph_io_server_nc_cache_get_var(nc_file, measure_name, &nc_var)) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information\n");
+			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information\n");
+			oph_io_server_nc_cache_close(nc_file);
 			_oph_ioserver_nc_clear_buffer(buff);
 			for (i = 0; i < arg_count; i++)
 				if (args[i])
@@ -2505,7 +2482,6 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 			free(args);
 			free(value_list);
 			if (transpose) {
-				free(counters);
 				free(src_products);
 				free(limits);
 			}
@@ -2515,10 +2491,11 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 			free(sizemax);
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
+		varid = nc_var->varid;
 	}
 
-	unsigned long long ii;
-	for (ii = 0; ii < tuplexfrag_number; ii++, idDim++) {
+	unsigned long long ii, jj, rows = 1;
+	for (ii = 0; ii < tuplexfrag_number; ii += rows, idDim += rows) {
 
 		oph_ioserver_nc_compute_dimension_id(idDim, sizemax, nexp, start_pointer);
 
@@ -2534,13 +2511,25 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 			}
 		}
 
+		//Extend the read to the following rows of the same chunk
+		if (max_rows > 1) {
+			rows = sizemax[nexp - 1] - (idDim - 1) % sizemax[nexp - 1];
+			if (rows > tuplexfrag_number - ii)
+				rows = tuplexfrag_number - ii;
+			if (rows > max_rows)
+				rows = max_rows;
+			if (rows > chunk_len - start[inner_dim] % chunk_len)
+				rows = chunk_len - start[inner_dim] % chunk_len;
+			count[inner_dim] = rows;
+		}
+
 #ifdef DEBUG
 		//gettimeofday(&start_read_time, NULL);
 #endif
 		// This version is not optimized in case the unlimited dimension is implicit!!!!! offset is set to 0 for this reason
 		//Fill binary cache
 		if (_oph_ioserver_nc_read_data_v0
-		    (buff, 0, transpose, is_netcdf4, vartype, ndims, src_path, measure_name, start, count, ncid, varid, 1, idDim, nexp, sizemax, dims_type, dims_index, dims_start)) {
+		    (buff, 0, transpose, is_netcdf4, vartype, ndims, src_path, measure_name, start, count, nc_file, varid, 1, idDim, nexp, sizemax, dims_type, dims_index, dims_start)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, "Error in binary array filling\n");
 			logging(LOG_ERROR, __FILE__, __LINE__, "Error in binary array filling\n");
 			_oph_ioserver_nc_clear_buffer(buff);
@@ -2550,7 +2539,6 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 			free(args);
 			free(value_list);
 			if (transpose) {
-				free(counters);
 				free(src_products);
 				free(limits);
 			}
@@ -2558,11 +2546,8 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 			free(count);
 			free(start_pointer);
 			free(sizemax);
-			if (!is_netcdf4) {
-				pthread_mutex_lock(&nc_lock);
-				nc_close(ncid);
-				pthread_mutex_unlock(&nc_lock);
-			}
+			if (nc_file)
+				oph_io_server_nc_cache_close(nc_file);
 			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
 #ifdef DEBUG
@@ -2582,7 +2567,6 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 			free(args);
 			free(value_list);
 			if (transpose) {
-				free(counters);
 				free(src_products);
 				free(limits);
 			}
@@ -2590,11 +2574,8 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 			free(count);
 			free(start_pointer);
 			free(sizemax);
-			if (!is_netcdf4) {
-				pthread_mutex_lock(&nc_lock);
-				nc_close(ncid);
-				pthread_mutex_unlock(&nc_lock);
-			}
+			if (nc_file)
+				oph_io_server_nc_cache_close(nc_file);
 			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
 
@@ -2612,7 +2593,6 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 				free(args);
 				free(value_list);
 				if (transpose) {
-					free(counters);
 					free(src_products);
 					free(limits);
 				}
@@ -2620,15 +2600,12 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 				free(count);
 				free(start_pointer);
 				free(sizemax);
-				if (!is_netcdf4) {
-					pthread_mutex_lock(&nc_lock);
-					nc_close(ncid);
-					pthread_mutex_unlock(&nc_lock);
-				}
+				if (nc_file)
+					oph_io_server_nc_cache_close(nc_file);
 				return OPH_IO_SERVER_MEMORY_ERROR;
 			}
 
-			oph_ioserver_nc_cache_to_buffer(nimp, counters, limits, src_products, buffer_in, buffer_out, sizeof_type);
+			oph_server_transpose(nimp, limits, src_products, buffer_in, NULL, buffer_out, sizeof_type);
 
 			//Detach shared memory segment
 			_oph_ioserver_nc_release_buffer_cache(buff, buffer_in);
@@ -2639,41 +2616,42 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 #endif
 		}
 
-		args[measure_pos]->arg = (char *) buffer_out;
+		for (jj = 0; jj < rows; jj++) {
+			row_id = idDim + jj;
+			args[measure_pos]->arg = (char *) buffer_out + jj * sizeof_var;
 
-		if (_oph_ioserver_query_build_row(arg_count, &row_size, binary_frag, binary_frag->field_name, value_list, args, &new_record)) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
-			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
-			for (i = 0; i < arg_count; i++)
-				if (args[i])
-					free(args[i]);
-			free(args);
-			free(value_list);
-			if (transpose) {
-				free(counters);
-				free(src_products);
-				free(limits);
-			}
-			_oph_ioserver_nc_release_buffer_insert(buff, buffer_out);
-			_oph_ioserver_nc_clear_buffer(buff);
-			free(start);
-			free(count);
-			free(start_pointer);
-			free(sizemax);
-			if (!is_netcdf4) {
-				pthread_mutex_lock(&nc_lock);
-				nc_close(ncid);
-				pthread_mutex_unlock(&nc_lock);
+			if (compressed_flag == 1 ? _oph_ioserver_query_build_row(arg_count, &row_size, binary_frag, binary_frag->field_name, value_list, args, &new_record)
+			    : _oph_ioserver_query_store_row(arg_count, &row_size, binary_frag, args, ii + jj, tuplexfrag_number)) {
+				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
+				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
+				for (i = 0; i < arg_count; i++)
+					if (args[i])
+						free(args[i]);
+				free(args);
+				free(value_list);
+				if (transpose) {
+					free(src_products);
+					free(limits);
+				}
+				_oph_ioserver_nc_release_buffer_insert(buff, buffer_out);
+				_oph_ioserver_nc_clear_buffer(buff);
+				free(start);
+				free(count);
+				free(start_pointer);
+				free(sizemax);
+				if (nc_file)
+					oph_io_server_nc_cache_close(nc_file);
+				return OPH_IO_SERVER_MEMORY_ERROR;
 			}
-			return OPH_IO_SERVER_MEMORY_ERROR;
-		}
-		//Add record to partial record set
-		binary_frag->record_set[ii] = new_record;
-		//Update current record size
-		cumulative_size += row_size;
+			//Add record to partial record set (rows stored in slab are already attached)
+			if (new_record)
+				binary_frag->record_set[ii + jj] = new_record;
+			//Update current record size
+			cumulative_size += row_size;
 
-		new_record = NULL;
-		row_size = 0;
+			new_record = NULL;
+			row_size = 0;
+		}
 		_oph_ioserver_nc_release_buffer_insert(buff, buffer_out);
 	}
 #ifdef DEBUG
@@ -2685,18 +2663,14 @@ int _oph_ioserver_nc_read_v0(char is_netcdf4, char *src_path, char *measure_name
 		printf("Fragment %s:  Total transpose :\t Time %d,%06d sec\n", measure_name, (int) total_transpose_time.tv_sec, (int) total_transpose_time.tv_usec);
 #endif
 
-	if (!is_netcdf4) {
-		pthread_mutex_lock(&nc_lock);
-		nc_close(ncid);
-		pthread_mutex_unlock(&nc_lock);
-	}
+	if (nc_file)
+		oph_io_server_nc_cache_close(nc_file);
 	free(count);
 	free(start);
 	free(start_pointer);
 	free(sizemax);
 
 	if (transpose) {
-		free(counters);
 		free(src_products);
 		free(limits);
 	}
@@ -2793,90 +2767,38 @@ int _oph_ioserver_nc_read(char *src_path, char *measure_name, unsigned long long
 			logging(LOG_ERROR, __FILE__, __LINE__, "Error while matching fields to fragment\n");
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
-		//Open netcdf file
-		int ncid = 0;
-		int retval, j = 0;
+		//Open netcdf file (metadata are read once for all the fragments of the same file)
+		oph_io_server_nc_file *nc_file = NULL;
+		oph_io_server_nc_var *nc_var = NULL;
 
-		if (pthread_mutex_lock(&nc_lock) != 0) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
-			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
-			return OPH_IO_SERVER_EXEC_ERROR;
-		}
-		if ((retval = nc_open(src_path, NC_NOWRITE, &ncid))) {
-			pthread_mutex_unlock(&nc_lock);
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s': %s\n", src_path, nc_strerror(retval));
-			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s': %s\n", src_path, nc_strerror(retval));
+		if (oph_io_server_nc_cache_open(src_path, &nc_file)) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s'\n", src_path);
+			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s'\n", src_path);
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
 		//Extract measured variable information
-		int varid = 0;
-		if ((retval = nc_inq_varid(ncid, measure_name, &varid))) {
-			nc_close(ncid);
-			pthread_mutex_unlock(&nc_lock);
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information: %s\n", nc_strerror(retval));
-			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information: %s\n", nc_strerror(retval));
-			return OPH_IO_SERVER_EXEC_ERROR;
-		}
-		//Get information from id
-		nc_type vartype;
-		if ((retval = nc_inq_vartype(ncid, varid, &vartype))) {
-			nc_close(ncid);
-			pthread_mutex_unlock(&nc_lock);
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information: %s\n", nc_strerror(retval));
-			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information: %s\n", nc_strerror(retval));
+		if (oph_io_server_nc_cache_get_var(nc_file, measure_name, &nc_var)) {
+			oph_io_server_nc_cache_close(nc_file);
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information\n");
+			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information\n");
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
+		nc_type vartype = nc_var->vartype;
 		//Check ndims value
-		int ndims;
-		if ((retval = nc_inq_varndims(ncid, varid, &ndims))) {
-			nc_close(ncid);
-			pthread_mutex_unlock(&nc_lock);
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information: %s\n", nc_strerror(retval));
-			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information: %s\n", nc_strerror(retval));
-			return OPH_IO_SERVER_EXEC_ERROR;
-		}
+		int ndims = nc_var->ndims;
 		if (ndims != dim_num) {
-			nc_close(ncid);
-			pthread_mutex_unlock(&nc_lock);
+			oph_io_server_nc_cache_close(nc_file);
 			pmesg(LOG_ERROR, __FILE__, __LINE__, "Dimension in variable not matching those provided in query\n");
 			logging(LOG_ERROR, __FILE__, __LINE__, "Dimension in variable not matching those provided in query\n");
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
 #ifdef OPH_PAR_NC4
-		//Read format metadata
-		int format = 0;
-		if ((retval = nc_inq_format(ncid, &format))) {
-			nc_close(ncid);
-			pthread_mutex_unlock(&nc_lock);
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read format information: %s\n", nc_strerror(retval));
-			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to read format information: %s\n", nc_strerror(retval));
-			return OPH_IO_SERVER_EXEC_ERROR;
-		}
+		int format = nc_file->format;
 #endif
-		int dim_id[dim_num];
-		if (src_paths_num > 1) {
-			if ((retval = nc_inq_vardimid(ncid, varid, dim_id))) {
-				nc_close(ncid);
-				pthread_mutex_unlock(&nc_lock);
-				pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to extract dimension ids\n");
-				logging(LOG_ERROR, __FILE__, __LINE__, "Unable to extract dimension ids\n");
-				return OPH_IO_SERVER_EXEC_ERROR;
-			}
-			if ((retval = nc_inq_dimlen(ncid, dim_id[dim_unlim], &lenp))) {
-				nc_close(ncid);
-				pthread_mutex_unlock(&nc_lock);
-				pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to extract dimension real size\n");
-				logging(LOG_ERROR, __FILE__, __LINE__, "Unable to extract dimension real size\n");
-				return OPH_IO_SERVER_EXEC_ERROR;
-			}
-		}
+		if (src_paths_num > 1)
+			lenp = nc_var->dim_len[dim_unlim];
 
-		nc_close(ncid);
-		if (pthread_mutex_unlock(&nc_lock) != 0) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
-			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
-			return OPH_IO_SERVER_EXEC_ERROR;
-		}
+		oph_io_server_nc_cache_close(nc_file);
 
 		_tuplexfrag_number = tuplexfrag_number;
 		_frag_key_start = frag_key_start;
@@ -3210,7 +3132,8 @@ int _oph_ioserver_rand_data(long long tuplexfrag_number, long long frag_key_star
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
 
-		if (_oph_ioserver_query_build_row(arg_count, &row_size, binary_frag, binary_frag->field_name, value_list, args, &new_record)) {
+		if (compressed_flag == 1 ? _oph_ioserver_query_build_row(arg_count, &row_size, binary_frag, binary_frag->field_name, value_list, args, &new_record)
+		    : _oph_ioserver_query_store_row(arg_count, &row_size, binary_frag, args, i, tuplexfrag_number)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ROW_CREATE_ERROR);
 			for (i = 0; i < arg_count; i++)
@@ -3221,8 +3144,9 @@ int _oph_ioserver_rand_data(long long tuplexfrag_number, long long frag_key_star
 			free(binary);
 			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
-		//Add record to partial record set
-		binary_frag->record_set[i] = new_record;
+		//Add record to partial record set (rows stored in slab are already attached)
+		if (new_record)
+			binary_frag->record_set[i] = new_record;
 		//Update current record size
 		cumulative_size += row_size;
 
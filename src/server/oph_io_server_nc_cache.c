@@ -0,0 +1,451 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "oph_io_server_nc_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "debug.h"
+
+extern int msglevel;
+//Serialize every call to the NetCDF library, which (as well as HDF5 for NetCDF4 files) shares global state among the open files
+extern pthread_mutex_t nc_lock;
+
+//Files are listed from the most to the least recently used
+static pthread_mutex_t nc_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static oph_io_server_nc_file *nc_cache_head = NULL;
+static oph_io_server_nc_file *nc_cache_tail = NULL;
+static unsigned int nc_cache_count = 0;
+static unsigned int nc_cache_capacity = 0;
+static unsigned int nc_cache_idle_time = 0;
+
+//Called with cache lock acquired
+static void _oph_io_server_nc_cache_unlink(oph_io_server_nc_file * file)
+{
+	if (file->prev)
+		file->prev->next = file->next;
+	else
+		nc_cache_head = file->next;
+	if (file->next)
+		file->next->prev = file->prev;
+	else
+		nc_cache_tail = file->prev;
+	file->prev = file->next = NULL;
+}
+
+//Called with cache lock acquired
+static void _oph_io_server_nc_cache_push(oph_io_server_nc_file * file)
+{
+	file->prev = NULL;
+	file->next = nc_cache_head;
+	if (nc_cache_head)
+		nc_cache_head->prev = file;
+	else
+		nc_cache_tail = file;
+	nc_cache_head = file;
+}
+
+//Called with cache lock acquired: the file is moved to the list of files to be closed once the lock is released
+static void _oph_io_server_nc_cache_detach(oph_io_server_nc_file * file, oph_io_server_nc_file ** victims)
+{
+	if (file->cached) {
+		_oph_io_server_nc_cache_unlink(file);
+		file->cached = 0;
+		nc_cache_count--;
+	}
+	if (!file->ref_count) {
+		file->next = *victims;
+		*victims = file;
+	}
+}
+
+//Called with cache lock acquired
+static void _oph_io_server_nc_cache_evict(time_t now, oph_io_server_nc_file ** victims)
+{
+	oph_io_server_nc_file *file = nc_cache_tail, *prev = NULL;
+	for (; file; file = prev) {
+		prev = file->prev;
+		if (file->ref_count)
+			continue;
+		if ((nc_cache_count > nc_cache_capacity) || (nc_cache_idle_time && (now - file->last_use >= nc_cache_idle_time)))
+			_oph_io_server_nc_cache_detach(file, victims);
+	}
+}
+
+static void _oph_io_server_nc_cache_free_file(oph_io_server_nc_file * file)
+{
+	oph_io_server_nc_var *var = NULL;
+	while ((var = file->vars)) {
+		file->vars = var->next;
+		free(var->name);
+		if (var->dim_len)
+			free(var->dim_len);
+		if (var->chunk_len)
+			free(var->chunk_len);
+		free(var);
+	}
+	pthread_mutex_destroy(&(file->lock));
+	free(file->path);
+	free(file);
+}
+
+//Called without cache lock
+static void _oph_io_server_nc_cache_release(oph_io_server_nc_file * victims)
+{
+	oph_io_server_nc_file *file = NULL;
+	int res = 0;
+	while ((file = victims)) {
+		victims = file->next;
+		if (file->valid) {
+			pmesg(LOG_DEBUG, __FILE__, __LINE__, "Closing netcdf file '%s'\n", file->path);
+			logging(LOG_DEBUG, __FILE__, __LINE__, "Closing netcdf file '%s'\n", file->path);
+			pthread_mutex_lock(&nc_lock);
+			if ((res = nc_close(file->ncid))) {
+				pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to close netcdf file '%s': %s\n", file->path, nc_strerror(res));
+				logging(LOG_WARNING, __FILE__, __LINE__, "Unable to close netcdf file '%s': %s\n", file->path, nc_strerror(res));
+			}
+			pthread_mutex_unlock(&nc_lock);
+		}
+		_oph_io_server_nc_cache_free_file(file);
+	}
+}
+
+int oph_io_server_nc_cache_init(unsigned int capacity, unsigned int idle_time)
+{
+	oph_io_server_nc_file *victims = NULL;
+
+	if (pthread_mutex_lock(&nc_cache_lock) != 0) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
+		return OPH_IO_SERVER_NC_CACHE_ERROR;
+	}
+	nc_cache_capacity = capacity;
+	nc_cache_idle_time = idle_time;
+	_oph_io_server_nc_cache_evict(time(NULL), &victims);
+	pthread_mutex_unlock(&nc_cache_lock);
+
+	_oph_io_server_nc_cache_release(victims);
+
+	return OPH_IO_SERVER_NC_CACHE_SUCCESS;
+}
+
+int oph_io_server_nc_cache_finalize()
+{
+	oph_io_server_nc_file *victims = NULL, *file = NULL;
+
+	if (pthread_mutex_lock(&nc_cache_lock) != 0) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
+		return OPH_IO_SERVER_NC_CACHE_ERROR;
+	}
+	//Files still in use are closed by their last user
+	while ((file = nc_cache_head))
+		_oph_io_server_nc_cache_detach(file, &victims);
+	nc_cache_capacity = 0;
+	nc_cache_idle_time = 0;
+	pthread_mutex_unlock(&nc_cache_lock);
+
+	_oph_io_server_nc_cache_release(victims);
+
+	return OPH_IO_SERVER_NC_CACHE_SUCCESS;
+}
+
+int oph_io_server_nc_cache_open(const char *path, oph_io_server_nc_file ** file)
+{
+	if (!path || !file) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		return OPH_IO_SERVER_NC_CACHE_NULL_PARAM;
+	}
+	*file = NULL;
+
+	//Remote datasets cannot be checked for changes
+	struct stat st;
+	char has_stat = !stat(path, &st);
+
+	oph_io_server_nc_file *victims = NULL, *tmp = NULL;
+	time_t now = time(NULL);
+
+	if (pthread_mutex_lock(&nc_cache_lock) != 0) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
+		return OPH_IO_SERVER_NC_CACHE_ERROR;
+	}
+	_oph_io_server_nc_cache_evict(now, &victims);
+
+	for (tmp = nc_cache_head; tmp; tmp = tmp->next)
+		if (!strcmp(tmp->path, path))
+			break;
+	if (tmp && has_stat && ((tmp->dev != st.st_dev) || (tmp->ino != st.st_ino) || (tmp->size != st.st_size) || (tmp->mtime != st.st_mtime))) {
+		pmesg(LOG_DEBUG, __FILE__, __LINE__, "Netcdf file '%s' has been changed: it will be reopened\n", path);
+		logging(LOG_DEBUG, __FILE__, __LINE__, "Netcdf file '%s' has been changed: it will be reopened\n", path);
+		_oph_io_server_nc_cache_detach(tmp, &victims);
+		tmp = NULL;
+	}
+
+	if (tmp) {
+		tmp->ref_count++;
+		_oph_io_server_nc_cache_unlink(tmp);
+		_oph_io_server_nc_cache_push(tmp);
+		pthread_mutex_unlock(&nc_cache_lock);
+		_oph_io_server_nc_cache_release(victims);
+
+		//Wait for the file to be opened by the request that added it
+		if (oph_io_server_nc_cache_lock(tmp))
+			return OPH_IO_SERVER_NC_CACHE_ERROR;
+		char valid = tmp->valid;
+		oph_io_server_nc_cache_unlock(tmp);
+		if (!valid) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s'\n", path);
+			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s'\n", path);
+			oph_io_server_nc_cache_close(tmp);
+			return OPH_IO_SERVER_NC_CACHE_ERROR;
+		}
+		*file = tmp;
+		return OPH_IO_SERVER_NC_CACHE_SUCCESS;
+	}
+
+	if (!(tmp = (oph_io_server_nc_file *) calloc(1, sizeof(oph_io_server_nc_file))) || !(tmp->path = strdup(path)) || pthread_mutex_init(&(tmp->lock), NULL)) {
+		pthread_mutex_unlock(&nc_cache_lock);
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Memory alloc error\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Memory alloc error\n");
+		if (tmp) {
+			if (tmp->path)
+				free(tmp->path);
+			free(tmp);
+		}
+		_oph_io_server_nc_cache_release(victims);
+		return OPH_IO_SERVER_NC_CACHE_MEMORY_ERROR;
+	}
+	if (has_stat) {
+		tmp->dev = st.st_dev;
+		tmp->ino = st.st_ino;
+		tmp->size = st.st_size;
+		tmp->mtime = st.st_mtime;
+	}
+	tmp->ref_count = 1;
+	tmp->last_use = now;
+	//The file is published locked: other requests wait for it to be opened
+	pthread_mutex_lock(&(tmp->lock));
+	_oph_io_server_nc_cache_push(tmp);
+	tmp->cached = 1;
+	nc_cache_count++;
+	pthread_mutex_unlock(&nc_cache_lock);
+
+	_oph_io_server_nc_cache_release(victims);
+
+	int res = 0;
+	pthread_mutex_lock(&nc_lock);
+	if (!(res = nc_open(path, NC_NOWRITE, &(tmp->ncid))) && (res = nc_inq_format(tmp->ncid, &(tmp->format))))
+		nc_close(tmp->ncid);
+	pthread_mutex_unlock(&nc_lock);
+	if (res) {
+		pthread_mutex_unlock(&(tmp->lock));
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s': %s\n", path, nc_strerror(res));
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to open netcdf file '%s': %s\n", path, nc_strerror(res));
+		oph_io_server_nc_cache_close(tmp);
+		return OPH_IO_SERVER_NC_CACHE_ERROR;
+	}
+	tmp->valid = 1;
+	pthread_mutex_unlock(&(tmp->lock));
+
+	*file = tmp;
+
+	return OPH_IO_SERVER_NC_CACHE_SUCCESS;
+}
+
+int oph_io_server_nc_cache_get_var(oph_io_server_nc_file * file, const char *name, oph_io_server_nc_var ** var)
+{
+	if (!file || !name || !var) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		return OPH_IO_SERVER_NC_CACHE_NULL_PARAM;
+	}
+	*var = NULL;
+
+	if (oph_io_server_nc_cache_lock(file))
+		return OPH_IO_SERVER_NC_CACHE_ERROR;
+
+	oph_io_server_nc_var *tmp = NULL;
+	for (tmp = file->vars; tmp; tmp = tmp->next)
+		if (!strcmp(tmp->name, name))
+			break;
+	if (tmp) {
+		oph_io_server_nc_cache_unlock(file);
+		*var = tmp;
+		return OPH_IO_SERVER_NC_CACHE_SUCCESS;
+	}
+
+	if (!(tmp = (oph_io_server_nc_var *) calloc(1, sizeof(oph_io_server_nc_var))) || !(tmp->name = strdup(name))) {
+		oph_io_server_nc_cache_unlock(file);
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Memory alloc error\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Memory alloc error\n");
+		if (tmp)
+			free(tmp);
+		return OPH_IO_SERVER_NC_CACHE_MEMORY_ERROR;
+	}
+
+	int res = 0, i;
+	if ((res = nc_inq_varid(file->ncid, name, &(tmp->varid))) || (res = nc_inq_vartype(file->ncid, tmp->varid, &(tmp->vartype)))
+	    || (res = nc_inq_varndims(file->ncid, tmp->varid, &(tmp->ndims)))) {
+		oph_io_server_nc_cache_unlock(file);
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information: %s\n", nc_strerror(res));
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to read variable information: %s\n", nc_strerror(res));
+		free(tmp->name);
+		free(tmp);
+		return OPH_IO_SERVER_NC_CACHE_ERROR;
+	}
+
+	if (tmp->ndims > 0) {
+		int dim_id[tmp->ndims];
+		if (!(tmp->dim_len = (size_t *) malloc(tmp->ndims * sizeof(size_t)))) {
+			oph_io_server_nc_cache_unlock(file);
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Memory alloc error\n");
+			logging(LOG_ERROR, __FILE__, __LINE__, "Memory alloc error\n");
+			free(tmp->name);
+			free(tmp);
+			return OPH_IO_SERVER_NC_CACHE_MEMORY_ERROR;
+		}
+		res = nc_inq_vardimid(file->ncid, tmp->varid, dim_id);
+		for (i = 0; !res && (i < tmp->ndims); i++)
+			res = nc_inq_dimlen(file->ncid, dim_id[i], tmp->dim_len + i);
+		if (res) {
+			oph_io_server_nc_cache_unlock(file);
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to extract dimension real size: %s\n", nc_strerror(res));
+			logging(LOG_ERROR, __FILE__, __LINE__, "Unable to extract dimension real size: %s\n", nc_strerror(res));
+			free(tmp->dim_len);
+			free(tmp->name);
+			free(tmp);
+			return OPH_IO_SERVER_NC_CACHE_ERROR;
+		}
+	}
+	//Only NetCDF4 variables can be chunked and compressed
+	if ((tmp->ndims > 0) && ((file->format == NC_FORMAT_NETCDF4) || (file->format == NC_FORMAT_NETCDF4_CLASSIC))) {
+		int storage = NC_CONTIGUOUS, deflate = 0;
+		size_t chunk_len[tmp->ndims];
+		if (!nc_inq_var_chunking(file->ncid, tmp->varid, &storage, chunk_len) && (storage == NC_CHUNKED)) {
+			if ((tmp->chunk_len = (size_t *) malloc(tmp->ndims * sizeof(size_t))))
+				memcpy(tmp->chunk_len, chunk_len, tmp->ndims * sizeof(size_t));
+			if (!nc_inq_var_deflate(file->ncid, tmp->varid, &(tmp->shuffle), &deflate, &(tmp->deflate_level)) && !deflate)
+				tmp->deflate_level = 0;
+		}
+	}
+
+	tmp->next = file->vars;
+	file->vars = tmp;
+	oph_io_server_nc_cache_unlock(file);
+
+	*var = tmp;
+
+	return OPH_IO_SERVER_NC_CACHE_SUCCESS;
+}
+
+int oph_io_server_nc_cache_set_chunk_cache(oph_io_server_nc_file * file, oph_io_server_nc_var * var, size_t size, size_t nelems)
+{
+	if (!file || !var) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		return OPH_IO_SERVER_NC_CACHE_NULL_PARAM;
+	}
+
+	if (oph_io_server_nc_cache_lock(file))
+		return OPH_IO_SERVER_NC_CACHE_ERROR;
+
+	int res = 0;
+	if (size > var->chunk_cache) {
+		if ((res = nc_set_var_chunk_cache(file->ncid, var->varid, size, nelems, OPH_IO_SERVER_NC_CACHE_PREEMPTION))) {
+			pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to set chunk cache of variable '%s': %s\n", var->name, nc_strerror(res));
+			logging(LOG_WARNING, __FILE__, __LINE__, "Unable to set chunk cache of variable '%s': %s\n", var->name, nc_strerror(res));
+		} else
+			var->chunk_cache = size;
+	}
+	oph_io_server_nc_cache_unlock(file);
+
+	return res ? OPH_IO_SERVER_NC_CACHE_ERROR : OPH_IO_SERVER_NC_CACHE_SUCCESS;
+}
+
+int oph_io_server_nc_cache_lock(oph_io_server_nc_file * file)
+{
+	if (!file) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		return OPH_IO_SERVER_NC_CACHE_NULL_PARAM;
+	}
+	if (pthread_mutex_lock(&(file->lock)) != 0) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
+		return OPH_IO_SERVER_NC_CACHE_ERROR;
+	}
+	//The global lock is always acquired after the lock of the file
+	if (pthread_mutex_lock(&nc_lock) != 0) {
+		pthread_mutex_unlock(&(file->lock));
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
+		return OPH_IO_SERVER_NC_CACHE_ERROR;
+	}
+	return OPH_IO_SERVER_NC_CACHE_SUCCESS;
+}
+
+int oph_io_server_nc_cache_unlock(oph_io_server_nc_file * file)
+{
+	if (!file) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		return OPH_IO_SERVER_NC_CACHE_NULL_PARAM;
+	}
+	pthread_mutex_unlock(&nc_lock);
+	if (pthread_mutex_unlock(&(file->lock)) != 0) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to unlock mutex\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to unlock mutex\n");
+		return OPH_IO_SERVER_NC_CACHE_ERROR;
+	}
+	return OPH_IO_SERVER_NC_CACHE_SUCCESS;
+}
+
+int oph_io_server_nc_cache_close(oph_io_server_nc_file * file)
+{
+	if (!file) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		return OPH_IO_SERVER_NC_CACHE_NULL_PARAM;
+	}
+
+	oph_io_server_nc_file *victims = NULL;
+	time_t now = time(NULL);
+
+	if (pthread_mutex_lock(&nc_cache_lock) != 0) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to lock mutex\n");
+		return OPH_IO_SERVER_NC_CACHE_ERROR;
+	}
+	file->ref_count--;
+	file->last_use = now;
+	//Files that could not be opened or that have been replaced on disk are not kept
+	if (!file->ref_count && (!file->cached || !file->valid))
+		_oph_io_server_nc_cache_detach(file, &victims);
+	_oph_io_server_nc_cache_evict(now, &victims);
+	pthread_mutex_unlock(&nc_cache_lock);
+
+	_oph_io_server_nc_cache_release(victims);
+
+	return OPH_IO_SERVER_NC_CACHE_SUCCESS;
+}
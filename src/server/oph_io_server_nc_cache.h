@@ -0,0 +1,163 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPH_IO_SERVER_NC_CACHE_H
+#define OPH_IO_SERVER_NC_CACHE_H
+
+#include <pthread.h>
+#include <time.h>
+#include <sys/types.h>
+#include <netcdf.h>
+
+#define OPH_IO_SERVER_NC_CACHE_SUCCESS			0
+#define OPH_IO_SERVER_NC_CACHE_NULL_PARAM		1
+#define OPH_IO_SERVER_NC_CACHE_MEMORY_ERROR		2
+#define OPH_IO_SERVER_NC_CACHE_ERROR			3
+
+//Default number of unused NetCDF files kept open
+#define OPH_IO_SERVER_NC_CACHE_SIZE				16
+//Default time (in seconds) after which an unused NetCDF file is closed
+#define OPH_IO_SERVER_NC_CACHE_IDLE_TIME		60
+//Preemption policy of the chunk caches: fully read chunks are evicted first
+#define OPH_IO_SERVER_NC_CACHE_PREEMPTION		0.75
+
+/**
+ * \brief			            Metadata of a variable of a cached NetCDF file
+ * \param name            Name of the variable
+ * \param varid           Id of the variable
+ * \param vartype         Type of the variable
+ * \param ndims           Number of dimensions of the variable
+ * \param dim_len         Array of ndims dimension lengths
+ * \param chunk_len       Array of ndims chunk lengths, NULL if the variable is not chunked
+ * \param shuffle         Flag set if the shuffle filter is applied to the chunks
+ * \param deflate_level   Deflate level of the chunks, 0 if they are not compressed
+ * \param chunk_cache     Size (in bytes) of the chunk cache set for the variable, 0 if the library default is used
+ * \param next            Next variable of the same file
+ */
+typedef struct _oph_io_server_nc_var {
+	char *name;
+	int varid;
+	nc_type vartype;
+	int ndims;
+	size_t *dim_len;
+	size_t *chunk_len;
+	int shuffle;
+	int deflate_level;
+	size_t chunk_cache;
+	struct _oph_io_server_nc_var *next;
+} oph_io_server_nc_var;
+
+/**
+ * \brief			            Open NetCDF file shared by the requests reading it
+ * \param path            Path of the file
+ * \param ncid            Id returned by nc_open
+ * \param format          Format of the file
+ * \param valid           Flag set once the file has been successfully opened
+ * \param cached          Flag set while the file can be found in the cache
+ * \param ref_count       Number of requests using the file
+ * \param last_use        Time of the last release (used to close idle files)
+ * \param dev             Device of the file when it was opened
+ * \param ino             Inode of the file when it was opened
+ * \param size            Size of the file when it was opened
+ * \param mtime           Modification time of the file when it was opened
+ * \param lock            Mutex protecting the state and the variable metadata of the file
+ * \param vars            List of variable metadata already read
+ * \param prev            Previous (more recently used) file of the cache
+ * \param next            Next (less recently used) file of the cache
+ */
+typedef struct _oph_io_server_nc_file {
+	char *path;
+	int ncid;
+	int format;
+	char valid;
+	char cached;
+	unsigned int ref_count;
+	time_t last_use;
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	time_t mtime;
+	pthread_mutex_t lock;
+	oph_io_server_nc_var *vars;
+	struct _oph_io_server_nc_file *prev;
+	struct _oph_io_server_nc_file *next;
+} oph_io_server_nc_file;
+
+/**
+ * \brief               Function used to setup the cache of open NetCDF files
+ * \param capacity      Maximum number of unused files kept open (0 to close a file as soon as it is no more used)
+ * \param idle_time     Time (in seconds) after which an unused file is closed (0 to disable)
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_nc_cache_init(unsigned int capacity, unsigned int idle_time);
+
+/**
+ * \brief               Function used to close all the cached files
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_nc_cache_finalize();
+
+/**
+ * \brief               Function used to get an open NetCDF file from the cache, opening it if it is not cached or if it has been changed on disk. It has to be released with oph_io_server_nc_cache_close
+ * \param path          Path of the file
+ * \param file          Pointer to be filled with the open file
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_nc_cache_open(const char *path, oph_io_server_nc_file ** file);
+
+/**
+ * \brief               Function used to get the metadata of a variable of an open NetCDF file. Metadata are read once and remain valid until the file is released
+ * \param file          File opened with oph_io_server_nc_cache_open
+ * \param name          Name of the variable
+ * \param var           Pointer to be filled with the variable metadata
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_nc_cache_get_var(oph_io_server_nc_file * file, const char *name, oph_io_server_nc_var ** var);
+
+/**
+ * \brief               Function used to enlarge the chunk cache of a variable, which is kept while the file remains open. The cache is never shrunk, since it can be shared by concurrent imports
+ * \param file          File opened with oph_io_server_nc_cache_open
+ * \param var           Variable returned by oph_io_server_nc_cache_get_var
+ * \param size          Size (in bytes) of the chunk cache
+ * \param nelems        Number of slots of the chunk cache
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_nc_cache_set_chunk_cache(oph_io_server_nc_file * file, oph_io_server_nc_var * var, size_t size, size_t nelems);
+
+/**
+ * \brief               Function used to lock a file before calling the NetCDF library on its ncid. Since the library is not thread-safe, the global nc_lock is acquired too, so calls on different files are serialized as well
+ * \param file          File opened with oph_io_server_nc_cache_open
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_nc_cache_lock(oph_io_server_nc_file * file);
+
+/**
+ * \brief               Function used to unlock a file locked with oph_io_server_nc_cache_lock
+ * \param file          File to be unlocked
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_nc_cache_unlock(oph_io_server_nc_file * file);
+
+/**
+ * \brief               Function used to release a file opened with oph_io_server_nc_cache_open. The file is kept open unless the cache is full or it has been changed on disk
+ * \param file          File to be released
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_nc_cache_close(oph_io_server_nc_file * file);
+
+#endif				/* OPH_IO_SERVER_NC_CACHE_H */
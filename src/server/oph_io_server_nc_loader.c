@@ -0,0 +1,411 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "oph_io_server_nc_loader.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "debug.h"
+
+extern int msglevel;
+
+typedef struct _oph_io_server_nc_loader {
+	pid_t pid;
+	int sock;
+	char busy;
+} oph_io_server_nc_loader;
+
+//Loader processes are shared by all the server threads: an idle loader is reserved for a whole request
+static pthread_mutex_t nc_loader_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t nc_loader_cond = PTHREAD_COND_INITIALIZER;
+static oph_io_server_nc_loader *nc_loaders = NULL;
+static unsigned int nc_loader_num = 0;
+static char *nc_loader_exec = NULL;
+
+//Message layout: fixed header, size_t arrays, int arrays, strings
+typedef struct _oph_io_server_nc_loader_header {
+	int ndims;
+	int nexp;
+	unsigned long long offset;
+	unsigned long long tuples;
+	unsigned long long id_dim;
+	size_t path_len;
+	size_t measure_len;
+} oph_io_server_nc_loader_header;
+
+static size_t _oph_io_server_nc_loader_msg_len(oph_io_server_nc_loader_header * header)
+{
+	size_t len = sizeof(oph_io_server_nc_loader_header) + 2 * header->ndims * sizeof(size_t);
+	if (header->tuples > 1)
+		len += header->nexp * sizeof(unsigned int) + 2 * header->ndims * sizeof(int);
+	return len + header->path_len + header->measure_len + 2;
+}
+
+static int _oph_io_server_nc_loader_pack(oph_io_server_nc_loader_request * request, size_t * msg, size_t msg_size, size_t * msg_len)
+{
+	oph_io_server_nc_loader_header header;
+	header.ndims = request->ndims;
+	header.nexp = request->tuples > 1 ? request->nexp : 0;
+	header.offset = request->offset;
+	header.tuples = request->tuples;
+	header.id_dim = request->id_dim;
+	header.path_len = strlen(request->src_path);
+	header.measure_len = strlen(request->measure_name);
+
+	if ((header.ndims <= 0) || (header.nexp < 0) || ((*msg_len = _oph_io_server_nc_loader_msg_len(&header)) > msg_size))
+		return OPH_IO_SERVER_NC_LOADER_ERROR;
+
+	char *ptr = (char *) msg;
+	memcpy(ptr, &header, sizeof(oph_io_server_nc_loader_header));
+	ptr += sizeof(oph_io_server_nc_loader_header);
+	memcpy(ptr, request->start, header.ndims * sizeof(size_t));
+	ptr += header.ndims * sizeof(size_t);
+	memcpy(ptr, request->count, header.ndims * sizeof(size_t));
+	ptr += header.ndims * sizeof(size_t);
+	if (header.tuples > 1) {
+		memcpy(ptr, request->sizemax, header.nexp * sizeof(unsigned int));
+		ptr += header.nexp * sizeof(unsigned int);
+		memcpy(ptr, request->dims_index, header.ndims * sizeof(int));
+		ptr += header.ndims * sizeof(int);
+		memcpy(ptr, request->dims_start, header.ndims * sizeof(int));
+		ptr += header.ndims * sizeof(int);
+	}
+	memcpy(ptr, request->src_path, header.path_len + 1);
+	ptr += header.path_len + 1;
+	memcpy(ptr, request->measure_name, header.measure_len + 1);
+
+	return OPH_IO_SERVER_NC_LOADER_SUCCESS;
+}
+
+static int _oph_io_server_nc_loader_unpack(size_t * msg, size_t msg_len, oph_io_server_nc_loader_request * request)
+{
+	oph_io_server_nc_loader_header header;
+	if (msg_len < sizeof(oph_io_server_nc_loader_header))
+		return OPH_IO_SERVER_NC_LOADER_ERROR;
+	memcpy(&header, msg, sizeof(oph_io_server_nc_loader_header));
+	if ((header.ndims <= 0) || (header.nexp < 0) || (header.path_len >= msg_len) || (header.measure_len >= msg_len) || (header.ndims > (int) msg_len)
+	    || (header.nexp > (int) msg_len) || (_oph_io_server_nc_loader_msg_len(&header) != msg_len))
+		return OPH_IO_SERVER_NC_LOADER_ERROR;
+
+	char *ptr = (char *) msg + sizeof(oph_io_server_nc_loader_header);
+	request->ndims = header.ndims;
+	request->nexp = header.nexp;
+	request->offset = header.offset;
+	request->tuples = header.tuples;
+	request->id_dim = header.id_dim;
+	request->start = (size_t *) ptr;
+	ptr += header.ndims * sizeof(size_t);
+	request->count = (size_t *) ptr;
+	ptr += header.ndims * sizeof(size_t);
+	request->sizemax = NULL;
+	request->dims_index = request->dims_start = NULL;
+	if (header.tuples > 1) {
+		request->sizemax = (unsigned int *) ptr;
+		ptr += header.nexp * sizeof(unsigned int);
+		request->dims_index = (int *) ptr;
+		ptr += header.ndims * sizeof(int);
+		request->dims_start = (int *) ptr;
+		ptr += header.ndims * sizeof(int);
+	}
+	request->src_path = ptr;
+	ptr += header.path_len + 1;
+	request->measure_name = ptr;
+	if (request->src_path[header.path_len] || request->measure_name[header.measure_len])
+		return OPH_IO_SERVER_NC_LOADER_ERROR;
+
+	return OPH_IO_SERVER_NC_LOADER_SUCCESS;
+}
+
+//Called with the loader reserved by the caller
+static int _oph_io_server_nc_loader_spawn(oph_io_server_nc_loader * loader)
+{
+	int fd[2];
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fd)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to create socket for loader process: %s\n", strerror(errno));
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to create socket for loader process: %s\n", strerror(errno));
+		return OPH_IO_SERVER_NC_LOADER_ERROR;
+	}
+
+	int i, max_fd = (int) sysconf(_SC_OPEN_MAX);
+	pid_t pid = fork();
+	if (pid < 0) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to start loader process: %s\n", strerror(errno));
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to start loader process: %s\n", strerror(errno));
+		close(fd[0]);
+		close(fd[1]);
+		return OPH_IO_SERVER_NC_LOADER_ERROR;
+	}
+	if (!pid) {
+		//Only async-signal-safe calls are allowed here: the child replaces STDIN with the socket and drops the other descriptors of the server
+		if (fd[1] == STDIN_FILENO) {
+			if (fcntl(STDIN_FILENO, F_SETFD, 0))
+				_exit(errno);
+		} else if (dup2(fd[1], STDIN_FILENO) < 0)
+			_exit(errno);
+		for (i = STDERR_FILENO + 1; i < max_fd; i++)
+			close(i);
+		execl(nc_loader_exec, nc_loader_exec, (char *) NULL);
+		_exit(errno);
+	}
+	close(fd[1]);
+
+	pmesg(LOG_DEBUG, __FILE__, __LINE__, "Started loader process %d\n", (int) pid);
+	logging(LOG_DEBUG, __FILE__, __LINE__, "Started loader process %d\n", (int) pid);
+
+	loader->pid = pid;
+	loader->sock = fd[0];
+
+	return OPH_IO_SERVER_NC_LOADER_SUCCESS;
+}
+
+//Called with the loader reserved by the caller or with the pool lock acquired
+static void _oph_io_server_nc_loader_stop(oph_io_server_nc_loader * loader, char force)
+{
+	if (loader->sock >= 0) {
+		//Closing the socket makes the loader exit as soon as it is idle
+		close(loader->sock);
+		loader->sock = -1;
+	}
+	if (loader->pid > 0) {
+		if (force)
+			kill(loader->pid, SIGKILL);
+		waitpid(loader->pid, NULL, 0);
+		loader->pid = 0;
+	}
+}
+
+int oph_io_server_nc_loader_init(const char *exec_path, unsigned int loader_num)
+{
+	if (!exec_path || !loader_num) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		return OPH_IO_SERVER_NC_LOADER_NULL_PARAM;
+	}
+
+	pthread_mutex_lock(&nc_loader_lock);
+	if (nc_loaders) {
+		pthread_mutex_unlock(&nc_loader_lock);
+		return OPH_IO_SERVER_NC_LOADER_SUCCESS;
+	}
+	nc_loaders = (oph_io_server_nc_loader *) calloc(loader_num, sizeof(oph_io_server_nc_loader));
+	nc_loader_exec = strdup(exec_path);
+	if (!nc_loaders || !nc_loader_exec) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Memory alloc error\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Memory alloc error\n");
+		if (nc_loaders)
+			free(nc_loaders);
+		if (nc_loader_exec)
+			free(nc_loader_exec);
+		nc_loaders = NULL;
+		nc_loader_exec = NULL;
+		pthread_mutex_unlock(&nc_loader_lock);
+		return OPH_IO_SERVER_NC_LOADER_MEMORY_ERROR;
+	}
+	nc_loader_num = loader_num;
+
+	//Loaders which cannot be started now are started on their first use
+	unsigned int i;
+	for (i = 0; i < nc_loader_num; i++) {
+		nc_loaders[i].sock = -1;
+		_oph_io_server_nc_loader_spawn(nc_loaders + i);
+	}
+	pthread_mutex_unlock(&nc_loader_lock);
+
+	return OPH_IO_SERVER_NC_LOADER_SUCCESS;
+}
+
+int oph_io_server_nc_loader_finalize()
+{
+	pthread_mutex_lock(&nc_loader_lock);
+	if (!nc_loaders) {
+		pthread_mutex_unlock(&nc_loader_lock);
+		return OPH_IO_SERVER_NC_LOADER_SUCCESS;
+	}
+	unsigned int i;
+	for (i = 0; i < nc_loader_num; i++)
+		_oph_io_server_nc_loader_stop(nc_loaders + i, 0);
+	free(nc_loaders);
+	free(nc_loader_exec);
+	nc_loaders = NULL;
+	nc_loader_exec = NULL;
+	nc_loader_num = 0;
+	pthread_cond_broadcast(&nc_loader_cond);
+	pthread_mutex_unlock(&nc_loader_lock);
+
+	return OPH_IO_SERVER_NC_LOADER_SUCCESS;
+}
+
+static int _oph_io_server_nc_loader_send(oph_io_server_nc_loader * loader, int shm_fd, size_t * msg, size_t msg_len)
+{
+	struct iovec iov = { msg, msg_len };
+	char control[CMSG_SPACE(sizeof(int))];
+	memset(control, 0, sizeof(control));
+	struct msghdr header;
+	memset(&header, 0, sizeof(struct msghdr));
+	header.msg_iov = &iov;
+	header.msg_iovlen = 1;
+	header.msg_control = control;
+	header.msg_controllen = sizeof(control);
+
+	//The descriptor of the shared memory is duplicated into the loader process
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&header);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &shm_fd, sizeof(int));
+
+	if (sendmsg(loader->sock, &header, MSG_NOSIGNAL) != (ssize_t) msg_len)
+		return OPH_IO_SERVER_NC_LOADER_ERROR;
+
+	return OPH_IO_SERVER_NC_LOADER_SUCCESS;
+}
+
+int oph_io_server_nc_loader_read(int shm_fd, oph_io_server_nc_loader_request * request)
+{
+	if ((shm_fd < 0) || !request || !request->start || !request->count || !request->src_path || !request->measure_name
+	    || ((request->tuples > 1) && (!request->sizemax || !request->dims_index || !request->dims_start))) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		return OPH_IO_SERVER_NC_LOADER_NULL_PARAM;
+	}
+
+	size_t msg[OPH_IO_SERVER_NC_LOADER_MSG_LEN / sizeof(size_t)], msg_len = 0;
+	if (_oph_io_server_nc_loader_pack(request, msg, sizeof(msg), &msg_len)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to setup message for loader process\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Unable to setup message for loader process\n");
+		return OPH_IO_SERVER_NC_LOADER_ERROR;
+	}
+
+	//Reserve an idle loader
+	unsigned int i = 0;
+	pthread_mutex_lock(&nc_loader_lock);
+	while (nc_loaders) {
+		for (i = 0; i < nc_loader_num; i++)
+			if (!nc_loaders[i].busy)
+				break;
+		if (i < nc_loader_num)
+			break;
+		pthread_cond_wait(&nc_loader_cond, &nc_loader_lock);
+	}
+	if (!nc_loaders) {
+		pthread_mutex_unlock(&nc_loader_lock);
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Loader processes are not running\n");
+		logging(LOG_ERROR, __FILE__, __LINE__, "Loader processes are not running\n");
+		return OPH_IO_SERVER_NC_LOADER_ERROR;
+	}
+	oph_io_server_nc_loader *loader = nc_loaders + i;
+	loader->busy = 1;
+	pthread_mutex_unlock(&nc_loader_lock);
+
+	int res = OPH_IO_SERVER_NC_LOADER_ERROR, status = 0, attempt;
+	ssize_t n = 0;
+	//A loader found dead before the request is delivered is restarted once
+	for (attempt = 0; attempt < 2; attempt++) {
+		if ((loader->sock < 0) && _oph_io_server_nc_loader_spawn(loader))
+			break;
+		if (_oph_io_server_nc_loader_send(loader, shm_fd, msg, msg_len)) {
+			pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to send request to loader process %d: %s\n", (int) loader->pid, strerror(errno));
+			logging(LOG_WARNING, __FILE__, __LINE__, "Unable to send request to loader process %d: %s\n", (int) loader->pid, strerror(errno));
+			_oph_io_server_nc_loader_stop(loader, 1);
+			continue;
+		}
+		while (((n = recv(loader->sock, &status, sizeof(int), 0)) < 0) && (errno == EINTR));
+		if (n != sizeof(int)) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Loader process %d terminated while reading '%s'\n", (int) loader->pid, request->src_path);
+			logging(LOG_ERROR, __FILE__, __LINE__, "Loader process %d terminated while reading '%s'\n", (int) loader->pid, request->src_path);
+			_oph_io_server_nc_loader_stop(loader, 1);
+			break;
+		}
+		if (status) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, "Error in binary array filling: %d\n", status);
+			logging(LOG_ERROR, __FILE__, __LINE__, "Error in binary array filling: %d\n", status);
+		} else
+			res = OPH_IO_SERVER_NC_LOADER_SUCCESS;
+		break;
+	}
+
+	pthread_mutex_lock(&nc_loader_lock);
+	loader->busy = 0;
+	pthread_cond_signal(&nc_loader_cond);
+	pthread_mutex_unlock(&nc_loader_lock);
+
+	return res;
+}
+
+int oph_io_server_nc_loader_recv(int sock, size_t * msg, size_t msg_size, int *shm_fd, oph_io_server_nc_loader_request * request)
+{
+	if (!msg || !shm_fd || !request) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Null input parameter\n");
+		return OPH_IO_SERVER_NC_LOADER_NULL_PARAM;
+	}
+	struct iovec iov;
+	char control[CMSG_SPACE(sizeof(int))];
+	struct msghdr header;
+	struct cmsghdr *cmsg = NULL;
+	ssize_t n = 0;
+
+	for (;;) {
+		*shm_fd = -1;
+		iov.iov_base = msg;
+		iov.iov_len = msg_size;
+		memset(&header, 0, sizeof(struct msghdr));
+		header.msg_iov = &iov;
+		header.msg_iovlen = 1;
+		header.msg_control = control;
+		header.msg_controllen = sizeof(control);
+
+		while (((n = recvmsg(sock, &header, MSG_CMSG_CLOEXEC)) < 0) && (errno == EINTR));
+		if (n <= 0)
+			return OPH_IO_SERVER_NC_LOADER_ERROR;
+
+		cmsg = CMSG_FIRSTHDR(&header);
+		if (cmsg && (cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS) && (cmsg->cmsg_len == CMSG_LEN(sizeof(int))))
+			memcpy(shm_fd, CMSG_DATA(cmsg), sizeof(int));
+		if ((*shm_fd >= 0) && !(header.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) && !_oph_io_server_nc_loader_unpack(msg, (size_t) n, request))
+			break;
+
+		//The request is rejected, but the loader can serve the next ones
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to parse message from master process\n");
+		if (*shm_fd >= 0)
+			close(*shm_fd);
+		if (oph_io_server_nc_loader_reply(sock, OPH_IO_SERVER_NC_LOADER_ERROR))
+			return OPH_IO_SERVER_NC_LOADER_ERROR;
+	}
+
+	return OPH_IO_SERVER_NC_LOADER_SUCCESS;
+}
+
+int oph_io_server_nc_loader_reply(int sock, int status)
+{
+	if (send(sock, &status, sizeof(int), MSG_NOSIGNAL) != sizeof(int)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, "Unable to send result to master process: %s\n", strerror(errno));
+		return OPH_IO_SERVER_NC_LOADER_ERROR;
+	}
+	return OPH_IO_SERVER_NC_LOADER_SUCCESS;
+}
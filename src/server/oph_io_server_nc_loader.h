@@ -0,0 +1,105 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPH_IO_SERVER_NC_LOADER_H
+#define OPH_IO_SERVER_NC_LOADER_H
+
+#include <stddef.h>
+
+#define OPH_IO_SERVER_NC_LOADER_SUCCESS			0
+#define OPH_IO_SERVER_NC_LOADER_NULL_PARAM		1
+#define OPH_IO_SERVER_NC_LOADER_MEMORY_ERROR	2
+#define OPH_IO_SERVER_NC_LOADER_ERROR			3
+
+#define OPH_IO_SERVER_NC_LOADER_EXEC OPH_IO_SERVER_PREFIX "/bin/oph_io_server_nc_load"
+
+//Maximum length of a request sent to a loader process
+#define OPH_IO_SERVER_NC_LOADER_MSG_LEN			4096
+
+/**
+ * \brief			            Hyperslab to be read by a loader process into a shared memory area
+ * \param ndims           Number of dimensions of the variable
+ * \param nexp            Number of explicit dimensions (used only if tuples > 1)
+ * \param offset          Position (in values) of the area where the first value is written
+ * \param tuples          Number of tuples to be read, one hyperslab per tuple
+ * \param id_dim          Identifier of the first tuple (used only if tuples > 1)
+ * \param start           Array of ndims start indexes of the hyperslab
+ * \param count           Array of ndims counts of the hyperslab
+ * \param sizemax         Array of nexp sizes of the explicit dimensions (used only if tuples > 1)
+ * \param dims_index      Array of ndims positions of the explicit dimensions, -1 for implicit dimensions (used only if tuples > 1)
+ * \param dims_start      Array of ndims start indexes of the subset (used only if tuples > 1)
+ * \param src_path        Path of the NetCDF file
+ * \param measure_name    Name of the variable
+ */
+typedef struct _oph_io_server_nc_loader_request {
+	int ndims;
+	int nexp;
+	unsigned long long offset;
+	unsigned long long tuples;
+	unsigned long long id_dim;
+	size_t *start;
+	size_t *count;
+	unsigned int *sizemax;
+	int *dims_index;
+	int *dims_start;
+	char *src_path;
+	char *measure_name;
+} oph_io_server_nc_loader_request;
+
+/**
+ * \brief               Function used to start the pool of processes reading NetCDF files on behalf of the server
+ * \param exec_path     Path of the loader executable
+ * \param loader_num    Number of loader processes
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_nc_loader_init(const char *exec_path, unsigned int loader_num);
+
+/**
+ * \brief               Function used to stop the loader processes
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_nc_loader_finalize();
+
+/**
+ * \brief               Function used to read a hyperslab into a shared memory area by means of an idle loader process. Loader processes which terminate are restarted
+ * \param shm_fd        Descriptor of the shared memory area created with oph_iob_bin_array_shared_create
+ * \param request       Hyperslab to be read
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_nc_loader_read(int shm_fd, oph_io_server_nc_loader_request * request);
+
+/**
+ * \brief               Function used by a loader process to wait for the next request
+ * \param sock          Socket connected to the server
+ * \param msg           Buffer (aligned to size_t) used to store the request
+ * \param msg_size      Size of the buffer
+ * \param shm_fd        Pointer to be filled with the descriptor of the shared memory area
+ * \param request       Request to be filled; its arrays point into msg
+ * \return              0 if successfull, non-0 otherwise (also when the server closed the connection)
+ */
+int oph_io_server_nc_loader_recv(int sock, size_t * msg, size_t msg_size, int *shm_fd, oph_io_server_nc_loader_request * request);
+
+/**
+ * \brief               Function used by a loader process to send the result of a request
+ * \param sock          Socket connected to the server
+ * \param status        0 if the request has been successfully executed, non-0 otherwise
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_nc_loader_reply(int sock, int status);
+
+#endif				/* OPH_IO_SERVER_NC_LOADER_H */
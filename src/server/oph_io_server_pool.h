@@ -0,0 +1,106 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPH_IO_SERVER_POOL_H
+#define OPH_IO_SERVER_POOL_H
+
+#include <pthread.h>
+#include <time.h>
+
+#include "oph_io_server_thread.h"
+#include "oph_network.h"
+
+#define OPH_IO_SERVER_POOL_SUCCESS			0
+#define OPH_IO_SERVER_POOL_NULL_PARAM		1
+#define OPH_IO_SERVER_POOL_MEMORY_ERROR		2
+#define OPH_IO_SERVER_POOL_ERROR			3
+
+#define OPH_IO_SERVER_POOL_MAX_EVENTS		64
+#define OPH_IO_SERVER_POOL_WAIT_TIMEOUT		1000
+#define OPH_IO_SERVER_POOL_TABLE_SIZE		1024
+
+/**
+ * \brief			            Structure to contain info about a client connection
+ * \param sockfd          Socket descriptor of the connection
+ * \param reader          Buffered reader where the requests of the connection are received without blocking
+ * \param busy            Flag set while a worker is serving a request of the connection
+ * \param last_access     Time of the last data received or request served (used to apply CLIENT_TTL)
+ * \param status          Status of the connection (current db, last result set, running statement, etc.)
+ * \param next            Next connection in the queue of connections ready to be served
+ */
+typedef struct _oph_io_server_connection {
+	int sockfd;
+	oph_net_reader *reader;
+	char busy;
+	time_t last_access;
+	oph_io_server_thread_status status;
+	struct _oph_io_server_connection *next;
+} oph_io_server_connection;
+
+/**
+ * \brief			            Structure of the event loop and of the worker pool
+ * \param listenfd        Socket descriptor of the listening socket
+ * \param epollfd         Descriptor of the epoll instance
+ * \param worker_num      Number of workers
+ * \param workers         Array of worker thread IDs
+ * \param connections     Connection table indexed by socket descriptor
+ * \param table_size      Size of the connection table
+ * \param queue_head      First connection ready to be served
+ * \param queue_tail      Last connection ready to be served
+ * \param lock            Mutex protecting connection table and queue
+ * \param cond            Condition used to wake up the workers
+ * \param stop            Flag set to stop the workers
+ */
+typedef struct {
+	int listenfd;
+	int epollfd;
+	unsigned int worker_num;
+	pthread_t *workers;
+	oph_io_server_connection **connections;
+	int table_size;
+	oph_io_server_connection *queue_head;
+	oph_io_server_connection *queue_tail;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	char stop;
+} oph_io_server_pool;
+
+/**
+ * \brief               Function used to create the event loop and start the workers
+ * \param listenfd      Socket descriptor of the listening socket
+ * \param worker_num    Number of workers to be started
+ * \param pool          Pool to be created
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_pool_start(int listenfd, unsigned int worker_num, oph_io_server_pool ** pool);
+
+/**
+ * \brief               Function used to run the event loop: it accepts new connections, hands ready connections to the workers and closes idle ones
+ * \param pool          Pool to be used
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_pool_run(oph_io_server_pool * pool);
+
+/**
+ * \brief               Function used to stop the workers, close all the connections and release the pool
+ * \param pool          Pool to be released
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_pool_stop(oph_io_server_pool ** pool);
+
+#endif				/* OPH_IO_SERVER_POOL_H */
@@ -32,10 +32,47 @@
 extern int msglevel;
 //extern pthread_mutex_t metadb_mutex;
 extern unsigned short omp_threads;
-extern HASHTBL *plugin_table;
+extern oph_server_hashmap *plugin_table;
 
-int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, HASHTBL * query_args,
-			     HASHTBL * plugin_table)
+oph_io_server_operation oph_io_server_get_operation(const char *query_oper)
+{
+	if (!query_oper)
+		return OPH_IO_SERVER_OP_UNKNOWN;
+
+	if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_CREATE_FRAG_SELECT) == 0)
+		return OPH_IO_SERVER_OP_CREATE_FRAG_SELECT;
+	else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_CREATE_FRAG_SELECT_FILE) == 0)
+		return OPH_IO_SERVER_OP_CREATE_FRAG_SELECT_FILE;
+	else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_CREATE_FRAG_SELECT_ESDM) == 0)
+		return OPH_IO_SERVER_OP_CREATE_FRAG_SELECT_ESDM;
+	else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_SELECT) == 0)
+		return OPH_IO_SERVER_OP_SELECT;
+	else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_INSERT) == 0)
+		return OPH_IO_SERVER_OP_INSERT;
+	else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_MULTI_INSERT) == 0)
+		return OPH_IO_SERVER_OP_MULTI_INSERT;
+	else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_FILE_IMPORT) == 0)
+		return OPH_IO_SERVER_OP_FILE_IMPORT;
+	else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_ESDM_IMPORT) == 0)
+		return OPH_IO_SERVER_OP_ESDM_IMPORT;
+	else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_RAND_IMPORT) == 0)
+		return OPH_IO_SERVER_OP_RAND_IMPORT;
+	else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_CREATE_FRAG) == 0)
+		return OPH_IO_SERVER_OP_CREATE_FRAG;
+	else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_DROP_FRAG) == 0)
+		return OPH_IO_SERVER_OP_DROP_FRAG;
+	else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_CREATE_DB) == 0)
+		return OPH_IO_SERVER_OP_CREATE_DB;
+	else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_DROP_DB) == 0)
+		return OPH_IO_SERVER_OP_DROP_DB;
+	else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_FUNCTION) == 0)
+		return OPH_IO_SERVER_OP_FUNCTION;
+
+	return OPH_IO_SERVER_OP_UNKNOWN;
+}
+
+int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, oph_server_hashmap * query_args,
+			     oph_server_hashmap * plugin_table, oph_io_server_prepared_stmt * stmt)
 {
 	if (!query_args || !plugin_table || !thread_status || !meta_db) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -43,16 +80,17 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 		return OPH_IO_SERVER_NULL_PARAM;
 	}
 	//Retrieve operation type
-	char *query_oper = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_OPERATION);
+	char *query_oper = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_OPERATION);
 	if (!query_oper) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, "OPERATION");
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, "OPERATION");
 		return OPH_IO_SERVER_EXEC_ERROR;
 	}
+	oph_io_server_operation operation = stmt ? (oph_io_server_operation) stmt->operation : oph_io_server_get_operation(query_oper);
 	//TODO manage exclusive execution of blocks (delete or read/insert)
 
 	//SWITCH on operation
-	if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_CREATE_FRAG_SELECT) == 0) {
+	if (operation == OPH_IO_SERVER_OP_CREATE_FRAG_SELECT) {
 		//Execute create + select fragment query  
 
 		//Check if current DB is setted
@@ -63,13 +101,13 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 			return OPH_IO_SERVER_METADB_ERROR;
 		}
 
-		if (oph_io_server_run_create_as_select_table(meta_db, dev_handle, thread_status->current_db, args, query_args)) {
+		if (oph_io_server_run_create_as_select_table(meta_db, dev_handle, thread_status->current_db, args, query_args, thread_status->query_arena, stmt ? &(stmt->exprs) : NULL)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Create as Select Table");
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Create as Select Table");
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
 #ifdef OPH_IO_SERVER_NETCDF
-	} else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_CREATE_FRAG_SELECT_FILE) == 0) {
+	} else if (operation == OPH_IO_SERVER_OP_CREATE_FRAG_SELECT_FILE) {
 		//Execute create + select fragment query + load from file 
 
 		//Check if current DB is setted
@@ -80,14 +118,14 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 			return OPH_IO_SERVER_METADB_ERROR;
 		}
 
-		if (oph_io_server_run_create_as_select_file(meta_db, dev_handle, thread_status->current_db, args, query_args)) {
+		if (oph_io_server_run_create_as_select_file(meta_db, dev_handle, thread_status->current_db, args, query_args, thread_status->query_arena, stmt ? &(stmt->exprs) : NULL)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Create as Select File");
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Create as Select File");
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
 #endif
 #ifdef OPH_IO_SERVER_ESDM
-	} else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_CREATE_FRAG_SELECT_ESDM) == 0) {
+	} else if (operation == OPH_IO_SERVER_OP_CREATE_FRAG_SELECT_ESDM) {
 		//Execute create + select fragment query + load from file 
 
 		//Check if current DB is setted
@@ -98,13 +136,13 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 			return OPH_IO_SERVER_METADB_ERROR;
 		}
 
-		if (oph_io_server_run_create_as_select_esdm(meta_db, dev_handle, thread_status->current_db, args, query_args)) {
+		if (oph_io_server_run_create_as_select_esdm(meta_db, dev_handle, thread_status->current_db, args, query_args, thread_status->query_arena, stmt ? &(stmt->exprs) : NULL)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Create as Select File");
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Create as Select File");
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
 #endif
-	} else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_SELECT) == 0) {
+	} else if (operation == OPH_IO_SERVER_OP_SELECT) {
 		//Execute select fragment query  
 
 		//First delete last result set
@@ -126,13 +164,13 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 		}
 
 		oph_iostore_frag_record_set *rs = NULL;
-		if (oph_io_server_run_select(meta_db, dev_handle, thread_status->current_db, args, query_args, &rs)) {
+		if (oph_io_server_run_select(meta_db, dev_handle, thread_status->current_db, args, query_args, &rs, thread_status->query_arena, stmt ? &(stmt->exprs) : NULL)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Select");
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Select");
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
 		thread_status->last_result_set = rs;
-	} else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_INSERT) == 0) {
+	} else if (operation == OPH_IO_SERVER_OP_INSERT) {
 		//Execute insert query 
 
 		//Check if current DB is setted
@@ -152,7 +190,7 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 		oph_iostore_frag_record_set *tmp = thread_status->curr_stmt->partial_result_set;
 
 		//Read frag_name
-		char *frag_name = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
+		char *frag_name = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
 		if (frag_name == NULL) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
@@ -202,7 +240,7 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 		unsigned long long row_size = 0;
 		if (oph_io_server_run_insert
 		    (meta_db, dev_handle, thread_status->curr_stmt->partial_result_set, ((thread_status->curr_stmt->curr_run ? thread_status->curr_stmt->curr_run : 1) - 1), args, query_args,
-		     &row_size)) {
+		     stmt, &row_size)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Insert Row");
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Insert Row");
 			return OPH_IO_SERVER_EXEC_ERROR;
@@ -229,7 +267,7 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 				return OPH_IO_SERVER_EXEC_ERROR;
 			}
 		}
-	} else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_MULTI_INSERT) == 0) {
+	} else if (operation == OPH_IO_SERVER_OP_MULTI_INSERT) {
 		//Execute insert query 
 
 		//Check if current DB is setted
@@ -250,7 +288,7 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
 		//Read frag_name
-		char *frag_name = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
+		char *frag_name = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
 		if (frag_name == NULL) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
@@ -288,7 +326,7 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 		unsigned int insert_num = 0;
 		unsigned long long row_size = 0;
 
-		if (oph_io_server_run_multi_insert(meta_db, dev_handle, thread_status, args, query_args, &insert_num, &row_size)) {
+		if (oph_io_server_run_multi_insert(meta_db, dev_handle, thread_status, args, query_args, stmt, &insert_num, &row_size)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Multi-insert Row");
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Multi-insert Row");
 			return OPH_IO_SERVER_EXEC_ERROR;
@@ -300,7 +338,7 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 			//THIS BLOCK IS PERFORMED AT THE VERY LAST INSERT 
 
 			//Check if last statement
-			char *final_stmt = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FINAL_STATEMENT);
+			char *final_stmt = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FINAL_STATEMENT);
 			if (final_stmt == NULL) {
 				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FINAL_STATEMENT);
 				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FINAL_STATEMENT);
@@ -338,7 +376,7 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 			}
 		}
 #ifdef OPH_IO_SERVER_NETCDF
-	} else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_FILE_IMPORT) == 0) {
+	} else if (operation == OPH_IO_SERVER_OP_FILE_IMPORT) {
 		//Execute insert from file query 
 
 		//Check if current DB is setted
@@ -356,7 +394,7 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 		}
 #endif
 #ifdef OPH_IO_SERVER_ESDM
-	} else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_ESDM_IMPORT) == 0) {
+	} else if (operation == OPH_IO_SERVER_OP_ESDM_IMPORT) {
 		//Execute insert from file query 
 
 		//Check if current DB is setted
@@ -373,7 +411,7 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
 #endif
-	} else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_RAND_IMPORT) == 0) {
+	} else if (operation == OPH_IO_SERVER_OP_RAND_IMPORT) {
 		//Execute insert from random data query 
 
 		//Check if current DB is setted
@@ -389,7 +427,7 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Random import");
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
-	} else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_CREATE_FRAG) == 0) {
+	} else if (operation == OPH_IO_SERVER_OP_CREATE_FRAG) {
 		//Execute create fragment query  
 
 		//Check if current DB is setted
@@ -445,7 +483,7 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
-	} else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_DROP_FRAG) == 0) {
+	} else if (operation == OPH_IO_SERVER_OP_DROP_FRAG) {
 		//Execute drop frag 
 
 		//Check if current DB is setted
@@ -461,14 +499,14 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Drop Fragment");
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
-	} else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_CREATE_DB) == 0) {
+	} else if (operation == OPH_IO_SERVER_OP_CREATE_DB) {
 		//Execute create database query  
 		if (oph_io_server_run_create_db(meta_db, dev_handle, query_args)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Create DB");
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Create DB");
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
-	} else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_DROP_DB) == 0) {
+	} else if (operation == OPH_IO_SERVER_OP_DROP_DB) {
 		//Execute drop DB 
 		char *db_name = NULL;
 		if (oph_io_server_run_drop_db(meta_db, dev_handle, query_args, &db_name)) {
@@ -481,11 +519,11 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 			free(thread_status->current_db);
 			thread_status->current_db = NULL;
 		}
-	} else if (STRCMP(query_oper, OPH_QUERY_ENGINE_LANG_OP_FUNCTION) == 0) {
+	} else if (operation == OPH_IO_SERVER_OP_FUNCTION) {
 		//Compose query by selecting fields in the right order 
 
 		//Fetch procedure name
-		char *function_name = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FUNC);
+		char *function_name = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FUNC);
 		if (function_name == NULL) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FUNC);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FUNC);
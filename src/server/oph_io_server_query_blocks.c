@@ -27,6 +27,9 @@
 #include <debug.h>
 #include <errno.h>
 #include <pthread.h>
+#ifdef OPH_OMP
+#include <omp.h>
+#endif
 
 #include "oph_server_utility.h"
 #include "oph_query_engine_language.h"
@@ -38,196 +41,25 @@
 extern int msglevel;
 //extern pthread_mutex_t metadb_mutex;
 extern pthread_rwlock_t rwlock;
-extern HASHTBL *plugin_table;
-
-//Internal structures used to manage group of rows
-typedef struct oph_ioserver_group_elem {
-	long long elem_index;
-	struct oph_ioserver_group_elem *next;
-} oph_ioserver_group_elem;
-
-typedef struct oph_ioserver_group_elem_list {
-	struct oph_ioserver_group_elem *last;
-	struct oph_ioserver_group_elem *first;
-	long long length;
-} oph_ioserver_group_elem_list;
-
-typedef struct oph_ioserver_group {
-	oph_ioserver_group_elem_list *group_list;
-	struct oph_ioserver_group *next;
-} oph_ioserver_group;
-
-int _oph_ioserver_query_add_group_elem(oph_ioserver_group_elem_list * list, long long index)
-{
-	if (!list) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
-		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
-		return OPH_IO_SERVER_NULL_PARAM;
-	}
-
-	oph_ioserver_group_elem *tmp = (oph_ioserver_group_elem *) malloc(sizeof(oph_ioserver_group_elem));
-	if (!tmp) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-		return OPH_IO_SERVER_MEMORY_ERROR;
-	}
-	tmp->next = NULL;
-	tmp->elem_index = index;
-
-	if (list->first == NULL) {
-		list->first = tmp;
-	} else {
-		list->last->next = tmp;
-	}
-	list->last = tmp;
-	list->length++;
-
-	return OPH_IO_SERVER_SUCCESS;
-}
-
-int _oph_ioserver_query_add_group(oph_ioserver_group ** current, oph_ioserver_group_elem_list * index)
-{
-	if (!current || !index) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
-		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
-		return OPH_IO_SERVER_NULL_PARAM;
-	}
-
-	oph_ioserver_group *tmp = (oph_ioserver_group *) malloc(sizeof(oph_ioserver_group));
-	if (!tmp) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-		return OPH_IO_SERVER_MEMORY_ERROR;
-	}
-	tmp->next = NULL;
-	tmp->group_list = index;
-
-	if (*current != NULL) {
-		(*current)->next = tmp;
-	}
-	*current = tmp;
-
-	return OPH_IO_SERVER_SUCCESS;
-}
-
-int _oph_ioserver_query_delete_group_elem_list(oph_ioserver_group_elem_list * list)
-{
-	if (!list) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
-		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
-		return OPH_IO_SERVER_NULL_PARAM;
-	}
-
-	oph_ioserver_group_elem *tmp = NULL;
-	while (list->first) {
-		tmp = list->first;
-		list->first = list->first->next;
-		free(tmp);
-	}
-	free(list);
-
-	return OPH_IO_SERVER_SUCCESS;
-}
-
+extern oph_server_hashmap *plugin_table;
 
-int _oph_ioserver_query_build_groups(HASHTBL * query_groups, char *group, long long row, oph_ioserver_group ** head_group, oph_ioserver_group ** current_group, long long *group_num)
+int _oph_ioserver_query_get_groups(oph_server_hashmap * query_args, long long total_row_number, oph_query_arg ** args, oph_iostore_frag_record_set ** inputs, int table_num, long long *output_row_num,
+				   oph_ioserver_groups ** groups, oph_ioserver_query_expr ** exprs)
 {
-	if (!query_groups || !group || !head_group || !current_group || !group_num) {
+	if (!query_args || !total_row_number || !table_num || !inputs || !output_row_num || !groups) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
 		return OPH_IO_SERVER_NULL_PARAM;
 	}
 
-	if (!(*head_group)) {
-		//Create first group list
-		oph_ioserver_group_elem_list *list = (oph_ioserver_group_elem_list *) malloc(sizeof(oph_ioserver_group_elem_list));
-		if (!list) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-			return OPH_IO_SERVER_MEMORY_ERROR;
-		}
-		list->first = list->last = NULL;
-		list->length = 0;
-		if (_oph_ioserver_query_add_group_elem(list, row)) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-			free(list);
-			return OPH_IO_SERVER_MEMORY_ERROR;
-		}
-		if (_oph_ioserver_query_add_group(head_group, list)) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-			free(list);
-			_oph_ioserver_query_delete_group_elem_list(list);
-			return OPH_IO_SERVER_MEMORY_ERROR;
-		}
-		*current_group = *head_group;
-		hashtbl_insert(query_groups, (char *) group, (void *) (*current_group));
-		(*group_num)++;
-	} else {
-		if (!(*current_group)) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
-			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
-			return OPH_IO_SERVER_NULL_PARAM;
-		}
-		//Check if group is already available
-		oph_ioserver_group *group_index = (oph_ioserver_group *) hashtbl_get(query_groups, group);
-		if (!group_index) {
-			//Add group to hash table
-			oph_ioserver_group_elem_list *list = (oph_ioserver_group_elem_list *) malloc(sizeof(oph_ioserver_group_elem_list));
-			if (!list) {
-				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-				return OPH_IO_SERVER_MEMORY_ERROR;
-			}
-			list->first = list->last = NULL;
-			list->length = 0;
-			if (_oph_ioserver_query_add_group_elem(list, row)) {
-				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-				free(list);
-				return OPH_IO_SERVER_MEMORY_ERROR;
-			}
-			if (_oph_ioserver_query_add_group(current_group, list)) {
-				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-				free(list);
-				_oph_ioserver_query_delete_group_elem_list(list);
-				return OPH_IO_SERVER_MEMORY_ERROR;
-			}
-			hashtbl_insert(query_groups, (char *) group, (void *) (*current_group));
-			(*group_num)++;
-		} else {
-			//Simply extend the group list
-			if (_oph_ioserver_query_add_group_elem(group_index->group_list, row)) {
-				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-				return OPH_IO_SERVER_MEMORY_ERROR;
-			}
-
-		}
-	}
-
-	return OPH_IO_SERVER_SUCCESS;
-}
-
-int _oph_ioserver_query_get_groups(HASHTBL * query_args, long long total_row_number, oph_query_arg ** args, oph_iostore_frag_record_set ** inputs, int table_num, long long *output_row_num,
-				   oph_ioserver_group_elem_list *** group_lists)
-{
-	if (!query_args || !total_row_number || !table_num || !inputs || !output_row_num || !group_lists) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
-		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
-		return OPH_IO_SERVER_NULL_PARAM;
-	}
-
-	int k, l, i;
+	int l, i;
 	long long j;
 
 	*output_row_num = 0;
-	*group_lists = NULL;
+	*groups = NULL;
 
 	// Check group by clause
-	char *group_by = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_GROUP);
+	char *group_by = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_GROUP);
 	if (group_by) {
 		//Extract groups
 		char **group_list = NULL;
@@ -268,180 +100,124 @@ int _oph_ioserver_query_get_groups(HASHTBL * query_args, long long total_row_num
 			}
 		}
 
-		oph_query_expr_node *e = NULL;
-
-		if (oph_query_expr_get_ast(group_by, &e) != 0) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, group_by);
-			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, group_by);
-			return OPH_IO_SERVER_PARSE_ERROR;
-		}
-
-		oph_query_expr_symtable *table;
-		if (oph_query_expr_create_symtable(&table, OPH_QUERY_ENGINE_MAX_PLUGIN_NUMBER)) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-			oph_query_expr_delete_node(e, table);
-			return OPH_IO_SERVER_MEMORY_ERROR;
-		}
-
-		int var_count = 0;
-		char **var_list = NULL;
-
-		//Read all variables and link them to input record set fields
-		if (oph_query_expr_get_variables(e, &var_list, &var_count)) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, group_by);
-			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, group_by);
-			oph_query_expr_delete_node(e, table);
-			oph_query_expr_destroy_symtable(table);
-			return OPH_IO_SERVER_EXEC_ERROR;
-		}
-
-		unsigned int field_indexes[var_count];
-		int frag_indexes[var_count];
-		char field_binary[var_count];
+		oph_ioserver_query_expr *expr = NULL;
+		int res_expr = _oph_ioserver_query_get_expr(exprs, group_by, OPH_IO_SERVER_EXPR_ID, arg_count, inputs, table_num, id_indexes, &expr);
+		if (res_expr)
+			return res_expr;
 
-		if (var_count > 0) {
-			if (_oph_ioserver_query_get_variable_indexes(arg_count, var_list, var_count, inputs, table_num, field_indexes, frag_indexes, field_binary, 1, id_indexes)) {
-				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_VARIABLE_MATCH_ERROR, group_by);
-				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_VARIABLE_MATCH_ERROR, group_by);
-				oph_query_expr_delete_node(e, table);
-				oph_query_expr_destroy_symtable(table);
-				free(var_list);
-				return OPH_IO_SERVER_EXEC_ERROR;
-			}
-		} else {
+		if (!expr->var_count) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NO_VARIABLE_FOR_GROUP, group_by);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NO_VARIABLE_FOR_GROUP, group_by);
-			oph_query_expr_delete_node(e, table);
-			oph_query_expr_destroy_symtable(table);
-			free(var_list);
+			_oph_ioserver_query_release_expr(exprs, expr, 1);
 			return OPH_IO_SERVER_PARSE_ERROR;
 		}
 
-		oph_query_expr_value *res = NULL;
+		oph_query_expr_program *program = expr->program;
+		int var_count = expr->var_count;
+		unsigned int *field_indexes = expr->field_indexes;
+		int *frag_indexes = expr->frag_indexes;
+		char *field_binary = expr->field_binary;
+
+		oph_query_expr_value res_value, *res = &res_value;
 
 		//TODO Count actual number of string/binary variables
 		oph_query_arg val_b[var_count];
 
 		//Create group hash table
-		HASHTBL *query_groups = hashtbl_create(2 * total_row_number, NULL);
-		if (!query_groups) {
+		oph_ioserver_group_table *group_table = NULL;
+		if (_oph_ioserver_query_create_group_table(total_row_number, &group_table)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			_oph_ioserver_query_release_expr(exprs, expr, 1);
 			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
 
-		oph_ioserver_group *head = NULL, *current = NULL;
-		long long group_number = 0;
+		int error = OPH_IO_SERVER_SUCCESS;
+		j = 0;
 
-		char result[OPH_IO_SERVER_BUFFER] = { '\0' };
+		//Evaluate blocks of rows when the expression only involves numeric fields
+		if (_oph_ioserver_query_is_batchable(program, var_count, inputs, field_indexes, frag_indexes, field_binary)) {
+			long long *long_columns = (long long *) malloc((size_t) var_count * OPH_QUERY_EXPR_BATCH_SIZE * sizeof(long long));
+			double *double_columns = (double *) malloc((size_t) var_count * OPH_QUERY_EXPR_BATCH_SIZE * sizeof(double));
+			if (!long_columns || !double_columns)
+				error = OPH_IO_SERVER_MEMORY_ERROR;
 
-		for (j = 0; j < total_row_number; j++) {
-			if (_oph_ioserver_query_set_parser_variables(args, var_list, var_count, inputs, table, field_indexes, frag_indexes, field_binary, val_b, group_by, j, NULL)) {
-				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, group_by);
-				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, group_by);
-				oph_query_expr_delete_node(e, table);
-				oph_query_expr_destroy_symtable(table);
-				free(var_list);
-				for (current = head; current; current = current->next)
-					if (current->group_list)
-						_oph_ioserver_query_delete_group_elem_list(current->group_list);
-				hashtbl_destroy(query_groups);
-				return OPH_IO_SERVER_PARSE_ERROR;
-			}
-
-			if (e != NULL && !oph_query_expr_eval_expression(e, &res, table)) {
-				//Create index record
-				switch (res->type) {
-					case OPH_QUERY_EXPR_TYPE_DOUBLE:
-						{
-							snprintf(result, OPH_IO_SERVER_BUFFER - 1, "%f", res->data.double_value);
-							free(res);
-							break;
-						}
-					case OPH_QUERY_EXPR_TYPE_LONG:
-						{
-							snprintf(result, OPH_IO_SERVER_BUFFER - 1, "%lld", res->data.long_value);
-							free(res);
-							break;
-						}
-					default:
-						{
-							pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, group_by);
-							logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, group_by);
-							free(res);
-							oph_query_expr_delete_node(e, table);
-							oph_query_expr_destroy_symtable(table);
-							free(var_list);
-							for (current = head; current; current = current->next)
-								if (current->group_list)
-									_oph_ioserver_query_delete_group_elem_list(current->group_list);
-							hashtbl_destroy(query_groups);
-							return OPH_IO_SERVER_PARSE_ERROR;
-						}
-				}
+			oph_query_expr_column *res_column = NULL;
+			long long batch_rows = 0;
+			int b = 0;
 
-				//Add row to correct group
-				if (_oph_ioserver_query_build_groups(query_groups, result, j, &head, &current, &group_number)) {
+			for (; !error && j < total_row_number; j += batch_rows) {
+				batch_rows = (total_row_number - j < OPH_QUERY_EXPR_BATCH_SIZE ? total_row_number - j : OPH_QUERY_EXPR_BATCH_SIZE);
 
-					pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-					logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-					oph_query_expr_delete_node(e, table);
-					oph_query_expr_destroy_symtable(table);
-					free(var_list);
-					for (current = head; current; current = current->next)
-						if (current->group_list)
-							_oph_ioserver_query_delete_group_elem_list(current->group_list);
-					hashtbl_destroy(query_groups);
-					return OPH_IO_SERVER_MEMORY_ERROR;
+				if (_oph_ioserver_query_set_parser_columns(program, var_count, inputs, field_indexes, frag_indexes, long_columns, double_columns, group_by, j, batch_rows, NULL)
+				    || oph_query_expr_run_batch(program, batch_rows, &res_column)) {
+					error = OPH_IO_SERVER_PARSE_ERROR;
+					break;
 				}
-			} else {
-				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, group_by);
-				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, group_by);
-				free(var_list);
-				oph_query_expr_delete_node(e, table);
-				oph_query_expr_destroy_symtable(table);
-				for (current = head; current; current = current->next)
-					if (current->group_list)
-						_oph_ioserver_query_delete_group_elem_list(current->group_list);
-				hashtbl_destroy(query_groups);
-				return OPH_IO_SERVER_PARSE_ERROR;
+				for (b = 0; b < batch_rows; b++) {
+					if (res_column->type == OPH_QUERY_EXPR_TYPE_LONG)
+						error = _oph_ioserver_query_add_group_key(group_table, j + b, OPH_QUERY_EXPR_TYPE_LONG, res_column->long_value[b], 0);
+					else
+						error = _oph_ioserver_query_add_group_key(group_table, j + b, OPH_QUERY_EXPR_TYPE_DOUBLE, 0, res_column->double_value[b]);
+					if (error)
+						break;
+				}
+			}
+			if (long_columns)
+				free(long_columns);
+			if (double_columns)
+				free(double_columns);
+		}
+
+		for (; !error && j < total_row_number; j++) {
+			if (_oph_ioserver_query_set_parser_variables(args, program, var_count, inputs, field_indexes, frag_indexes, field_binary, val_b, group_by, j, NULL)
+			    || oph_query_expr_run_program(program, res)) {
+				error = OPH_IO_SERVER_PARSE_ERROR;
+				break;
+			}
+			//Assign row to its group
+			switch (res->type) {
+				case OPH_QUERY_EXPR_TYPE_DOUBLE:
+					error = _oph_ioserver_query_add_group_key(group_table, j, OPH_QUERY_EXPR_TYPE_DOUBLE, 0, res->data.double_value);
+					break;
+				case OPH_QUERY_EXPR_TYPE_LONG:
+					error = _oph_ioserver_query_add_group_key(group_table, j, OPH_QUERY_EXPR_TYPE_LONG, res->data.long_value, 0);
+					break;
+				default:
+					error = OPH_IO_SERVER_PARSE_ERROR;
 			}
 		}
-		free(var_list);
-		oph_query_expr_delete_node(e, table);
-		oph_query_expr_destroy_symtable(table);
+		_oph_ioserver_query_release_expr(exprs, expr, error != OPH_IO_SERVER_SUCCESS);
 
-		oph_ioserver_group_elem_list **groups = (oph_ioserver_group_elem_list **) malloc(group_number * sizeof(oph_ioserver_group_elem_list *));
-		if (!groups) {
+		if (error) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, group_by);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, group_by);
+			_oph_ioserver_query_destroy_group_table(group_table);
+			return error;
+		}
+
+		//Sort rows by group
+		oph_ioserver_groups *tmp_groups = NULL;
+		if (_oph_ioserver_query_sort_groups(group_table, &tmp_groups)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-			for (current = head; current; current = current->next)
-				if (current->group_list)
-					_oph_ioserver_query_delete_group_elem_list(current->group_list);
-			hashtbl_destroy(query_groups);
+			_oph_ioserver_query_destroy_group_table(group_table);
 			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
-
-		for (k = 0; k < group_number; k++) {
-			groups[k] = head->group_list;
-			head = head->next;
-		}
-		hashtbl_destroy(query_groups);
+		_oph_ioserver_query_destroy_group_table(group_table);
 
 		//Return groups
-		*output_row_num = group_number;
-		*group_lists = groups;
-
+		*output_row_num = tmp_groups->group_num;
+		*groups = tmp_groups;
 	}
 
 	return OPH_IO_SERVER_SUCCESS;
 }
 
-int _oph_ioserver_query_set_parser_variables(oph_query_arg ** args, char **var_list, unsigned int var_count, oph_iostore_frag_record_set ** inputs, oph_query_expr_symtable * table,
+int _oph_ioserver_query_set_parser_variables(oph_query_arg ** args, oph_query_expr_program * program, unsigned int var_count, oph_iostore_frag_record_set ** inputs,
 					     unsigned int *field_indexes, int *frag_indexes, char *field_binary, oph_query_arg * binary_var, char *field, long long row, long long *where_start_id)
 {
-	if (!var_list || !var_count || !inputs || !table || !field_indexes || !frag_indexes || !field_binary || !binary_var || !field) {
+	if (!program || !var_count || !inputs || !field_indexes || !frag_indexes || !field_binary || !binary_var || !field) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
 		return OPH_IO_SERVER_NULL_PARAM;
@@ -452,7 +228,7 @@ int _oph_ioserver_query_set_parser_variables(oph_query_arg ** args, char **var_l
 	for (k = 0; k < var_count; k++) {
 		if (field_binary[k]) {
 			if (args) {
-				if (oph_query_expr_add_binary(var_list[k], args[field_indexes[k]], table)) {
+				if (oph_query_expr_set_binary(program, k, args[field_indexes[k]])) {
 					pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field);
 					logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field);
 					return OPH_IO_SERVER_EXEC_ERROR;
@@ -466,10 +242,9 @@ int _oph_ioserver_query_set_parser_variables(oph_query_arg ** args, char **var_l
 			switch (inputs[frag_indexes[k]]->field_type[field_indexes[k]]) {
 				case OPH_IOSTORE_LONG_TYPE:
 					{
-						if (oph_query_expr_add_long
-						    (var_list[k],
-						     *((long long *) inputs[frag_indexes[k]]->record_set[(where_start_id ? where_start_id[frag_indexes[k]] + row : row)]->field[field_indexes[k]]),
-						     table)) {
+						if (oph_query_expr_set_long
+						    (program, k,
+						     *((long long *) inputs[frag_indexes[k]]->record_set[(where_start_id ? where_start_id[frag_indexes[k]] + row : row)]->field[field_indexes[k]]))) {
 							pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field);
 							logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field);
 							return OPH_IO_SERVER_EXEC_ERROR;
@@ -478,10 +253,9 @@ int _oph_ioserver_query_set_parser_variables(oph_query_arg ** args, char **var_l
 					}
 				case OPH_IOSTORE_REAL_TYPE:
 					{
-						if (oph_query_expr_add_double
-						    (var_list[k],
-						     *((double *) inputs[frag_indexes[k]]->record_set[(where_start_id ? where_start_id[frag_indexes[k]] + row : row)]->field[field_indexes[k]]),
-						     table)) {
+						if (oph_query_expr_set_double
+						    (program, k,
+						     *((double *) inputs[frag_indexes[k]]->record_set[(where_start_id ? where_start_id[frag_indexes[k]] + row : row)]->field[field_indexes[k]]))) {
 							pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field);
 							logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field);
 							return OPH_IO_SERVER_EXEC_ERROR;
@@ -494,7 +268,7 @@ int _oph_ioserver_query_set_parser_variables(oph_query_arg ** args, char **var_l
 						binary_var[k].arg = inputs[frag_indexes[k]]->record_set[(where_start_id ? where_start_id[frag_indexes[k]] + row : row)]->field[field_indexes[k]];
 						binary_var[k].arg_length =
 						    inputs[frag_indexes[k]]->record_set[(where_start_id ? where_start_id[frag_indexes[k]] + row : row)]->field_length[field_indexes[k]];
-						if (oph_query_expr_add_binary(var_list[k], &(binary_var[k]), table)) {
+						if (oph_query_expr_set_binary(program, k, &(binary_var[k]))) {
 							pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field);
 							logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field);
 							return OPH_IO_SERVER_EXEC_ERROR;
@@ -508,6 +282,274 @@ int _oph_ioserver_query_set_parser_variables(oph_query_arg ** args, char **var_l
 	return OPH_IO_SERVER_SUCCESS;
 }
 
+int _oph_ioserver_query_is_batchable(oph_query_expr_program * program, unsigned int var_count, oph_iostore_frag_record_set ** inputs, unsigned int *field_indexes, int *frag_indexes,
+				     char *field_binary)
+{
+	if (!program || !var_count || !inputs || !field_indexes || !frag_indexes || !field_binary || disable_batch_eval)
+		return 0;
+
+	if (!oph_query_expr_is_batchable(program))
+		return 0;
+
+	//Only numeric fields can be evaluated by columns
+	unsigned int k;
+	for (k = 0; k < var_count; k++) {
+		if (field_binary[k])
+			return 0;
+		if (inputs[frag_indexes[k]]->field_type[field_indexes[k]] != OPH_IOSTORE_LONG_TYPE && inputs[frag_indexes[k]]->field_type[field_indexes[k]] != OPH_IOSTORE_REAL_TYPE)
+			return 0;
+	}
+
+	return 1;
+}
+
+int _oph_ioserver_query_set_parser_columns(oph_query_expr_program * program, unsigned int var_count, oph_iostore_frag_record_set ** inputs, unsigned int *field_indexes, int *frag_indexes,
+					   long long *long_columns, double *double_columns, char *field, long long row, int row_num, long long *where_start_id)
+{
+	if (!program || !var_count || !inputs || !field_indexes || !frag_indexes || !long_columns || !double_columns || !field || row_num > OPH_QUERY_EXPR_BATCH_SIZE) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	unsigned int k;
+	int b;
+	oph_iostore_frag_record **records = NULL;
+
+	for (k = 0; k < var_count; k++) {
+		records = inputs[frag_indexes[k]]->record_set + (where_start_id ? where_start_id[frag_indexes[k]] + row : row);
+		switch (inputs[frag_indexes[k]]->field_type[field_indexes[k]]) {
+			case OPH_IOSTORE_LONG_TYPE:
+				{
+					long long *column = long_columns + (size_t) k *OPH_QUERY_EXPR_BATCH_SIZE;
+					for (b = 0; b < row_num; b++)
+						column[b] = *((long long *) records[b]->field[field_indexes[k]]);
+					if (oph_query_expr_set_long_column(program, k, column)) {
+						pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field);
+						logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field);
+						return OPH_IO_SERVER_EXEC_ERROR;
+					}
+					break;
+				}
+			case OPH_IOSTORE_REAL_TYPE:
+				{
+					double *column = double_columns + (size_t) k *OPH_QUERY_EXPR_BATCH_SIZE;
+					for (b = 0; b < row_num; b++)
+						column[b] = *((double *) records[b]->field[field_indexes[k]]);
+					if (oph_query_expr_set_double_column(program, k, column)) {
+						pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field);
+						logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field);
+						return OPH_IO_SERVER_EXEC_ERROR;
+					}
+					break;
+				}
+			default:
+				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field);
+				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field);
+				return OPH_IO_SERVER_EXEC_ERROR;
+		}
+	}
+
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+#ifdef OPH_OMP
+int _oph_ioserver_query_run_parallel_expression(char *expression, oph_query_arg ** args, unsigned int var_count, oph_iostore_frag_record_set ** inputs, unsigned int *field_indexes,
+						int *frag_indexes, char *field_binary, long long first_row, long long row_num, long long *where_start_id, oph_iostore_frag_record_set * output,
+						int output_field, long long first_output_row, char *selected)
+{
+	if (!expression || !var_count || !inputs || !field_indexes || !frag_indexes || !field_binary || (!output && !selected)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	int error = OPH_IO_SERVER_SUCCESS, thread_num = _oph_ioserver_query_get_thread_num(), t;
+	long long r;
+
+	//Results are stored in a buffer of each thread and copied into the output slab, in row order, after the parallel region
+	char **thread_buffer = NULL;
+	unsigned long long *cell_offset = NULL, *cell_length = NULL;
+	int *cell_thread = NULL;
+	char *cell_type = NULL;
+	if (output) {
+		thread_buffer = (char **) calloc(thread_num, sizeof(char *));
+		cell_offset = (unsigned long long *) malloc(row_num * sizeof(unsigned long long));
+		cell_length = (unsigned long long *) malloc(row_num * sizeof(unsigned long long));
+		cell_thread = (int *) malloc(row_num * sizeof(int));
+		cell_type = (char *) malloc(row_num * sizeof(char));
+		if (!thread_buffer || !cell_offset || !cell_length || !cell_thread || !cell_type) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			error = OPH_IO_SERVER_MEMORY_ERROR;
+		}
+	}
+
+	if (!error) {
+#pragma omp parallel num_threads(thread_num)
+		{
+			//Each thread parses its own syntax tree, since UDF descriptors are stored in the tree
+			oph_query_expr_node *e = NULL;
+			oph_query_expr_symtable *table = NULL;
+			oph_query_expr_program *program = NULL;
+			oph_query_expr_value res_value, *res = &res_value;
+			char **var_list = NULL;
+			int var_num = 0, res_error = 0, id = omp_get_thread_num();
+			oph_query_arg val_b[var_count];
+			char *buffer = NULL, *tmp = NULL;
+			unsigned long long buffer_size = 0, buffer_used = 0, length = 0;
+			void *value = NULL;
+			long long row;
+
+			if (oph_query_expr_create_symtable(&table, OPH_QUERY_ENGINE_MAX_PLUGIN_NUMBER)) {
+				table = NULL;
+				__atomic_store_n(&error, OPH_IO_SERVER_MEMORY_ERROR, __ATOMIC_RELAXED);
+			} else if (oph_query_expr_get_ast(expression, &e) || oph_query_expr_get_variables(e, &var_list, &var_num) || (unsigned int) var_num != var_count
+				   || oph_query_expr_compile(e, var_list, var_num, table, &program)) {
+				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, expression);
+				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, expression);
+				program = NULL;
+				__atomic_store_n(&error, OPH_IO_SERVER_PARSE_ERROR, __ATOMIC_RELAXED);
+			}
+#pragma omp for schedule(dynamic, OPH_IO_SERVER_PARALLEL_CHUNK)
+			for (row = 0; row < row_num; row++) {
+				if (__atomic_load_n(&error, __ATOMIC_RELAXED))
+					continue;
+
+				if (_oph_ioserver_query_set_parser_variables(args, program, var_count, inputs, field_indexes, frag_indexes, field_binary, val_b, expression, first_row + row, where_start_id)
+				    || oph_query_expr_run_program(program, res) || res->jump_flag) {
+					pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, expression);
+					logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, expression);
+					__atomic_store_n(&error, OPH_IO_SERVER_PARSE_ERROR, __ATOMIC_RELAXED);
+					continue;
+				}
+
+				if (selected) {
+					switch (res->type) {
+						case OPH_QUERY_EXPR_TYPE_DOUBLE:
+							selected[row] = ((long long) res->data.double_value != 0);
+							break;
+						case OPH_QUERY_EXPR_TYPE_LONG:
+							selected[row] = (res->data.long_value != 0);
+							break;
+						default:
+							res_error = 1;
+					}
+				} else {
+					value = NULL;
+					switch (res->type) {
+						case OPH_QUERY_EXPR_TYPE_DOUBLE:
+							cell_type[row] = OPH_IOSTORE_REAL_TYPE;
+							value = &(res->data.double_value);
+							length = sizeof(double);
+							break;
+						case OPH_QUERY_EXPR_TYPE_LONG:
+							cell_type[row] = OPH_IOSTORE_LONG_TYPE;
+							value = &(res->data.long_value);
+							length = sizeof(unsigned long long);
+							break;
+						case OPH_QUERY_EXPR_TYPE_STRING:
+							cell_type[row] = OPH_IOSTORE_STRING_TYPE;
+#ifdef PLUGIN_RES_COPY
+							//Result buffers are kept: rows are distinct, so they can be set directly
+							output->record_set[first_output_row + row]->field[output_field] = (void *) res->data.string_value;
+							output->record_set[first_output_row + row]->field_length[output_field] = strlen(res->data.string_value) + 1;
+							cell_thread[row] = -1;
+#else
+							value = res->data.string_value;
+							length = strlen(res->data.string_value) + 1;
+#endif
+							break;
+						case OPH_QUERY_EXPR_TYPE_BINARY:
+							cell_type[row] = OPH_IOSTORE_STRING_TYPE;
+#ifdef PLUGIN_RES_COPY
+							output->record_set[first_output_row + row]->field[output_field] = (void *) res->data.binary_value->arg;
+							output->record_set[first_output_row + row]->field_length[output_field] = res->data.binary_value->arg_length;
+							cell_thread[row] = -1;
+#else
+							value = res->data.binary_value->arg;
+							length = res->data.binary_value->arg_length;
+#endif
+							break;
+						default:
+							res_error = 1;
+					}
+					if (value) {
+						if (buffer_used + length > buffer_size) {
+							buffer_size = 2 * (buffer_used + length) + OPH_IO_SERVER_PARALLEL_CHUNK * sizeof(double);
+							if (!(tmp = (char *) realloc(buffer, buffer_size))) {
+								pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+								logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+								__atomic_store_n(&error, OPH_IO_SERVER_MEMORY_ERROR, __ATOMIC_RELAXED);
+								value = NULL;
+							} else
+								buffer = tmp;
+						}
+						if (value) {
+							memcpy(buffer + buffer_used, value, length);
+							cell_thread[row] = id;
+							cell_offset[row] = buffer_used;
+							cell_length[row] = length;
+							buffer_used += length;
+						}
+					}
+					if (res->type == OPH_QUERY_EXPR_TYPE_BINARY)
+						free(res->data.binary_value);
+				}
+				if (res_error) {
+					pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, expression);
+					logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, expression);
+					__atomic_store_n(&error, OPH_IO_SERVER_EXEC_ERROR, __ATOMIC_RELAXED);
+				}
+			}
+
+			if (output)
+				thread_buffer[id] = buffer;
+			if (program)
+				oph_query_expr_destroy_program(program);
+			if (e)
+				oph_query_expr_delete_node(e, table);
+			if (table)
+				oph_query_expr_destroy_symtable(table);
+			if (var_list)
+				free(var_list);
+		}
+	}
+	//Copy results into the output slab, in row order
+	if (output && !error) {
+		if (row_num > 0)
+			output->field_type[output_field] = cell_type[0];
+		for (r = 0; r < row_num; r++) {
+			if (cell_thread[r] < 0)
+				continue;
+			if (oph_iostore_set_frag_cell(output, first_output_row + r, output_field, thread_buffer[cell_thread[r]] + cell_offset[r], cell_length[r])) {
+				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+				error = OPH_IO_SERVER_MEMORY_ERROR;
+				break;
+			}
+		}
+	}
+
+	if (thread_buffer) {
+		for (t = 0; t < thread_num; t++)
+			if (thread_buffer[t])
+				free(thread_buffer[t]);
+		free(thread_buffer);
+	}
+	if (cell_offset)
+		free(cell_offset);
+	if (cell_length)
+		free(cell_length);
+	if (cell_thread)
+		free(cell_thread);
+	if (cell_type)
+		free(cell_type);
+
+	return error;
+}
+#endif
+
 int _oph_ioserver_query_get_variable_indexes(unsigned int arg_count, char **var_list, unsigned int var_count, oph_iostore_frag_record_set ** inputs, unsigned int table_num,
 					     unsigned int *field_indexes, int *frag_indexes, char *field_binary, char only_id, short int *id_indexes)
 {
@@ -696,7 +738,7 @@ int _oph_ioserver_query_get_variable_indexes(unsigned int arg_count, char **var_
 	return OPH_IO_SERVER_SUCCESS;
 }
 
-int _oph_io_server_query_compute_limits(HASHTBL * query_args, long long *offset, long long *limit)
+int _oph_io_server_query_compute_limits(oph_server_hashmap * query_args, long long *offset, long long *limit)
 {
 	if (!query_args || !offset || !limit) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -707,7 +749,7 @@ int _oph_io_server_query_compute_limits(HASHTBL * query_args, long long *offset,
 	*limit = 0;
 	*offset = 0;
 
-	char *limits = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_LIMIT);
+	char *limits = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_LIMIT);
 	if (limits) {
 		char **limit_list = NULL;
 		int limit_list_num = 0;
@@ -744,7 +786,7 @@ int _oph_io_server_query_compute_limits(HASHTBL * query_args, long long *offset,
 	return OPH_IO_SERVER_SUCCESS;
 }
 
-int _oph_io_server_query_order_output(HASHTBL * query_args, oph_iostore_frag_record_set * rs)
+int _oph_io_server_query_order_output(oph_server_hashmap * query_args, oph_iostore_frag_record_set * rs)
 {
 	if (!query_args || !rs || !rs->record_set) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -752,67 +794,95 @@ int _oph_io_server_query_order_output(HASHTBL * query_args, oph_iostore_frag_rec
 		return OPH_IO_SERVER_NULL_PARAM;
 	}
 
-	char *order = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ORDER);
-	if (order) {
-		int i = 0;
-		long long j = 1, l = 0;
-		oph_iostore_frag_record *tmp = NULL;
-		for (i = 0; i < rs->field_num; i++) {
-			if (!STRCMP(order, rs->field_name[i])) {
-				//If single row, then no order required
-				if (!rs->record_set[j])
-					break;
+	char *order = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ORDER);
+	if (!order)
+		return OPH_IO_SERVER_SUCCESS;
+	char *order_dir = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ORDER_DIR);
 
-				switch (rs->field_type[i]) {
-					case OPH_IOSTORE_REAL_TYPE:
-						{
-							//Run insertion sort routine
-							while (rs->record_set[j]) {
-								tmp = rs->record_set[j];
-								for (l = j - 1; l >= 0; l--) {
-									if (*((double *) tmp->field[i]) >= *((double *) rs->record_set[l]->field[i]))
-										break;
-									else
-										rs->record_set[l + 1] = rs->record_set[l];
-								}
-								rs->record_set[l + 1] = tmp;
-								j++;
-							}
-							break;
-						}
-					case OPH_IOSTORE_LONG_TYPE:
-						{
-							//Run insertion sort routine
-							while (rs->record_set[j]) {
-								tmp = rs->record_set[j];
-								for (l = j - 1; l >= 0; l--) {
-									if (*((long long *) tmp->field[i]) >= *((long long *) rs->record_set[l]->field[i]))
-										break;
-									else
-										rs->record_set[l + 1] = rs->record_set[l];
-								}
-								rs->record_set[l + 1] = tmp;
-								j++;
-							}
-							break;
-						}
-					default:
-						{
-							pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_ORDER_TYPE_ERROR);
-							logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_ORDER_TYPE_ERROR);
-							return OPH_IO_SERVER_EXEC_ERROR;
-						}
-				}
+	//Split private copies, since the parser modifies its input
+	char *orders = strdup(order), *dirs = order_dir ? strdup(order_dir) : NULL;
+	if (!orders || (order_dir && !dirs)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		if (orders)
+			free(orders);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+
+	char **order_list = NULL, **dir_list = NULL;
+	int order_num = 0, dir_num = 0;
+	const char *wrong_arg = NULL;
+	if (oph_query_parse_multivalue_arg(orders, &order_list, &order_num) || !order_num)
+		wrong_arg = OPH_QUERY_ENGINE_LANG_ARG_ORDER;
+	else if (dirs && oph_query_parse_multivalue_arg(dirs, &dir_list, &dir_num))
+		wrong_arg = OPH_QUERY_ENGINE_LANG_ARG_ORDER_DIR;
+	if (wrong_arg) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_MULTIVAL_PARSE_ERROR, wrong_arg);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_MULTIVAL_PARSE_ERROR, wrong_arg);
+		if (order_list)
+			free(order_list);
+		if (dir_list)
+			free(dir_list);
+		free(orders);
+		if (dirs)
+			free(dirs);
+		return OPH_IO_SERVER_EXEC_ERROR;
+	}
+
+	oph_ioserver_sort_key keys[order_num];
+	int i = 0, k = 0, error = OPH_IO_SERVER_SUCCESS;
+	const char *dir = NULL;
+	for (k = 0; k < order_num && !error; k++) {
+		for (i = 0; i < rs->field_num; i++)
+			if (!STRCMP(order_list[k], rs->field_name[i]))
 				break;
-			}
-		}
 		if (i == rs->field_num) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELD_NAME_UNKNOWN, order);
-			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELD_NAME_UNKNOWN, order);
-			return OPH_IO_SERVER_EXEC_ERROR;
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELD_NAME_UNKNOWN, order_list[k]);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELD_NAME_UNKNOWN, order_list[k]);
+			error = OPH_IO_SERVER_EXEC_ERROR;
+			break;
+		}
+		if (rs->field_type[i] != OPH_IOSTORE_LONG_TYPE && rs->field_type[i] != OPH_IOSTORE_REAL_TYPE) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_ORDER_TYPE_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_ORDER_TYPE_ERROR);
+			error = OPH_IO_SERVER_EXEC_ERROR;
+			break;
+		}
+		keys[k].field = i;
+		keys[k].type = rs->field_type[i];
+
+		//A single direction is applied to all the fields, missing directions are ascending
+		dir = dir_num == 1 ? dir_list[0] : (k < dir_num ? dir_list[k] : NULL);
+		if (!dir || !strcasecmp(dir, "ASC"))
+			keys[k].desc = 0;
+		else if (!strcasecmp(dir, "DESC"))
+			keys[k].desc = 1;
+		else {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_ORDER_DIR_ERROR, dir);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_ORDER_DIR_ERROR, dir);
+			error = OPH_IO_SERVER_EXEC_ERROR;
 		}
 	}
 
+	free(order_list);
+	if (dir_list)
+		free(dir_list);
+	free(orders);
+	if (dirs)
+		free(dirs);
+	if (error)
+		return error;
+
+	long long row_num = 0;
+	while (rs->record_set[row_num])
+		row_num++;
+
+	if (_oph_ioserver_query_sort_rows(rs->record_set, row_num, keys, order_num)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_ORDER_EXEC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_ORDER_EXEC_ERROR);
+		return OPH_IO_SERVER_EXEC_ERROR;
+	}
+
 	return OPH_IO_SERVER_SUCCESS;
 }
 
@@ -842,217 +912,164 @@ int _oph_ioserver_query_release_input_record_set(oph_iostore_handler * dev_handl
 	return OPH_IO_SERVER_SUCCESS;
 }
 
-int _oph_ioserver_query_multi_table_where_assert(int table_num, short int *id_indexes, long long *start_row_indexes, long long *input_row_num, oph_iostore_frag_record_set ** in_record_set)
+static int _oph_ioserver_query_filter_rows(char *where_string, oph_query_arg ** args, unsigned int arg_count, int table_num, oph_iostore_frag_record_set ** stored_rs, short int *id_indexes,
+					   long long *input_row_num, oph_iostore_frag_record_set ** input_rs, oph_ioserver_query_expr ** exprs)
 {
-	if (!table_num || !id_indexes || !start_row_indexes || !input_row_num || !in_record_set) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
-		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
-		return OPH_IO_SERVER_NULL_PARAM;
-	}
-	//Assume to have only inner join where clauses with unique and sorted ids 
-	char id_error_flag = 0;
-	long long a, b, j;
-	long long table_min[table_num];
-	long long table_max[table_num];
 	int l;
+	long long j = 0;
 
-	for (l = 0; l < table_num; l++) {
-		table_min[l] = *((long long *) in_record_set[l]->record_set[0]->field[id_indexes[l]]);
-		for (j = 1; in_record_set[l]->record_set[j]; j++) {
-			//Verify order, uniqueness and no values missing
-			b = *((long long *) in_record_set[l]->record_set[j]->field[id_indexes[l]]);
-			a = *((long long *) in_record_set[l]->record_set[j - 1]->field[id_indexes[l]]);
-			if ((b <= a) || (b - a) != 1) {
-				id_error_flag = 1;
-				break;
-			}
-		}
-		if (id_error_flag == 1) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_ID_MULTITABLE_CONSTRAINT_ERROR, in_record_set[l]->frag_name);
-			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_ID_MULTITABLE_CONSTRAINT_ERROR, in_record_set[l]->frag_name);
-			return OPH_IO_SERVER_EXEC_ERROR;
-		}
-		table_max[l] = *((long long *) in_record_set[l]->record_set[j - 1]->field[id_indexes[l]]);
-	}
-
-	//Get min and max idvalues
-	long long tmp_min = table_min[l - 1], tmp_max = table_max[l - 1];
-	for (l = 1; l < table_num; l++) {
-		if (table_min[l] < table_min[l - 1])
-			tmp_min = table_min[l];
-		if (table_max[l] > table_max[l - 1])
-			tmp_max = table_max[l];
-	}
-
-	//Check table overlap and return empty set in case
-	for (l = 0; l < table_num; l++) {
-		if ((table_min[l] > tmp_max) || (table_max[l] < tmp_min)) {
-			//Update output argument with actual value
-			*input_row_num = 0;
-			return OPH_IO_SERVER_SUCCESS;
-		}
-	}
+	//Rows of different tables are already aligned
+	long long start_row_indexes[table_num];
+	for (l = 0; l < table_num; l++)
+		start_row_indexes[l] = 0;
 
-	//Find index of minimum value in each table
-	for (l = 0; l < table_num; l++) {
-		for (j = 0; in_record_set[l]->record_set[j]; j++) {
-			a = *((long long *) in_record_set[l]->record_set[j]->field[id_indexes[l]]);
-			if (a == tmp_min) {
-				start_row_indexes[l] = j;
-				break;
+	//No rows found simply return empty set
+	if ((*input_row_num) == 0)
+		return OPH_IO_SERVER_SUCCESS;
+	//Use the zone map of the fragment to restrict evaluation to the rows within the id_dim range selected by the where clause
+	char mode = ((table_num == 1) && stored_rs[0]->zone_map.valid && stored_rs[0]->zone_map.sorted
+		     && (stored_rs[0]->zone_map.row_num == *input_row_num)) ? OPH_IO_SERVER_EXPR_ID_RANGE : OPH_IO_SERVER_EXPR_ID;
+
+	oph_ioserver_query_expr *expr = NULL;
+	int res_expr = _oph_ioserver_query_get_expr(exprs, where_string, mode, arg_count, input_rs, table_num, id_indexes, &expr);
+	if (res_expr)
+		return res_expr;
+
+	if (mode == OPH_IO_SERVER_EXPR_ID_RANGE) {
+		oph_ioserver_id_range range = expr->range;
+		if (range.found) {
+			int res = range.residual ? _oph_ioserver_query_get_id_rows(stored_rs[0], &range, start_row_indexes, input_row_num)
+			    : _oph_ioserver_query_select_id_range(stored_rs[0], &range, input_rs[0], input_row_num);
+			if (res || !range.residual) {
+				if (res) {
+					pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, where_string);
+					logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, where_string);
+				}
+				_oph_ioserver_query_release_expr(exprs, expr, res != 0);
+				return res ? OPH_IO_SERVER_EXEC_ERROR : OPH_IO_SERVER_SUCCESS;
 			}
 		}
 	}
 
-	*input_row_num = tmp_max - tmp_min + 1;
-
-	return OPH_IO_SERVER_SUCCESS;
-}
-
-int _oph_ioserver_query_run_where_clause(char *where_string, oph_query_arg ** args, int table_num, oph_iostore_frag_record_set ** stored_rs, long long *input_row_num,
-					 oph_iostore_frag_record_set ** input_rs)
-{
-	if (!where_string || !table_num || !stored_rs || !input_row_num || !input_rs) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
-		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
-		return OPH_IO_SERVER_NULL_PARAM;
+	if (!expr->var_count && table_num > 1) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_WHERE_MULTITABLE);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_WHERE_MULTITABLE);
+		_oph_ioserver_query_release_expr(exprs, expr, 1);
+		return OPH_IO_SERVER_PARSE_ERROR;
 	}
 
-	int l, i;
-	long long j;
+	oph_query_expr_program *program = expr->program;
+	int var_count = expr->var_count;
+	unsigned int *field_indexes = expr->field_indexes;
+	int *frag_indexes = expr->frag_indexes;
+	char *field_binary = expr->field_binary;
 
-	//Check binary fields if available
-	unsigned int arg_count = 0;
-	i = 0;
-	if (args != NULL) {
-		while (args[i++])
-			arg_count++;
-	}
-	//Find id columns in each table
-	short int id_indexes[table_num];
-	for (l = 0; l < table_num; l++) {
-		for (i = 0; i < stored_rs[l]->field_num; i++) {
-			if (!STRCMP(stored_rs[l]->field_name[i], OPH_NAME_ID)) {
-				id_indexes[l] = i;
-				break;
-			}
-		}
-		//Id not found  
-		if (i == stored_rs[l]->field_num) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELD_NAME_UNKNOWN, OPH_NAME_ID);
-			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELD_NAME_UNKNOWN, OPH_NAME_ID);
-			return OPH_IO_SERVER_EXEC_ERROR;
-		}
-	}
+	oph_query_expr_value res_value, *res = &res_value;
 
-	long long start_row_indexes[table_num];
+	//TODO Count actual number of string/binary variables
+	oph_query_arg val_b[var_count];
+	long long curr_row = 0, batch_rows = 0;
 
-	if (table_num > 1) {
-		if (_oph_ioserver_query_multi_table_where_assert(table_num, id_indexes, start_row_indexes, input_row_num, stored_rs)) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_ID_MULTITABLE_CONSTRAINT_ERROR, stored_rs[l]->frag_name);
-			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_ID_MULTITABLE_CONSTRAINT_ERROR, stored_rs[l]->frag_name);
-			return OPH_IO_SERVER_EXEC_ERROR;
+	//Evaluate blocks of rows when the expression only involves numeric fields
+	if (_oph_ioserver_query_is_batchable(program, var_count, stored_rs, field_indexes, frag_indexes, field_binary)) {
+		long long *long_columns = (long long *) malloc((size_t) var_count * OPH_QUERY_EXPR_BATCH_SIZE * sizeof(long long));
+		double *double_columns = (double *) malloc((size_t) var_count * OPH_QUERY_EXPR_BATCH_SIZE * sizeof(double));
+		if (!long_columns || !double_columns) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			if (long_columns)
+				free(long_columns);
+			if (double_columns)
+				free(double_columns);
+			_oph_ioserver_query_release_expr(exprs, expr, 1);
+			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
-	} else {
-		start_row_indexes[0] = 0;
-	}
-	//No rows found simply return empty set
-	if ((*input_row_num) == 0)
-		return OPH_IO_SERVER_SUCCESS;
-
-	oph_query_expr_node *e = NULL;
-
-	if (oph_query_expr_get_ast(where_string, &e) != 0) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, where_string);
-		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, where_string);
-		return OPH_IO_SERVER_PARSE_ERROR;
-	}
 
-	oph_query_expr_symtable *table;
-	if (oph_query_expr_create_symtable(&table, OPH_QUERY_ENGINE_MAX_PLUGIN_NUMBER)) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-		oph_query_expr_delete_node(e, table);
-		return OPH_IO_SERVER_MEMORY_ERROR;
-	}
+		oph_query_expr_column *res_column = NULL;
+		int b = 0;
 
-	int var_count = 0;
-	char **var_list = NULL;
+		for (j = 0; j < (*input_row_num); j += batch_rows) {
+			batch_rows = ((*input_row_num) - j < OPH_QUERY_EXPR_BATCH_SIZE ? (*input_row_num) - j : OPH_QUERY_EXPR_BATCH_SIZE);
 
-	//Read all variables and link them to input record set fields
-	if (oph_query_expr_get_variables(e, &var_list, &var_count)) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, where_string);
-		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, where_string);
-		oph_query_expr_delete_node(e, table);
-		oph_query_expr_destroy_symtable(table);
-		return OPH_IO_SERVER_EXEC_ERROR;
+			if (_oph_ioserver_query_set_parser_columns(program, var_count, stored_rs, field_indexes, frag_indexes, long_columns, double_columns, where_string, j, batch_rows, start_row_indexes)
+			    || oph_query_expr_run_batch(program, batch_rows, &res_column)) {
+				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, where_string);
+				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, where_string);
+				free(long_columns);
+				free(double_columns);
+				_oph_ioserver_query_release_expr(exprs, expr, 1);
+				return OPH_IO_SERVER_PARSE_ERROR;
+			}
+			//Add selected rows to each index table
+			for (b = 0; b < batch_rows; b++) {
+				if (res_column->type == OPH_QUERY_EXPR_TYPE_LONG ? res_column->long_value[b] != 0 : (long long) res_column->double_value[b] != 0) {
+					for (l = 0; l < table_num; l++)
+						input_rs[l]->record_set[curr_row] = stored_rs[l]->record_set[start_row_indexes[l] + j + b];
+					curr_row++;
+				}
+			}
+		}
+		free(long_columns);
+		free(double_columns);
 	}
-
-	unsigned int field_indexes[var_count];
-	int frag_indexes[var_count];
-	char field_binary[var_count];
-
-	if (var_count > 0) {
-		if (_oph_ioserver_query_get_variable_indexes(arg_count, var_list, var_count, input_rs, table_num, field_indexes, frag_indexes, field_binary, 1, id_indexes)) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_VARIABLE_MATCH_ERROR, where_string);
-			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_VARIABLE_MATCH_ERROR, where_string);
-			oph_query_expr_delete_node(e, table);
-			oph_query_expr_destroy_symtable(table);
-			free(var_list);
-			return OPH_IO_SERVER_EXEC_ERROR;
+#ifdef OPH_OMP
+	//Split rows among threads when functions do not keep state across rows
+	else if (((*input_row_num) > 1) && (_oph_ioserver_query_get_thread_num() > 1) && (var_count > 0) && !oph_query_expr_has_aggregate(program)) {
+		char *selected = (char *) calloc(*input_row_num, sizeof(char));
+		if (!selected) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			_oph_ioserver_query_release_expr(exprs, expr, 1);
+			return OPH_IO_SERVER_MEMORY_ERROR;
 		}
-	} else {
-		if (table_num > 1) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_WHERE_MULTITABLE);
-			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_WHERE_MULTITABLE);
-			oph_query_expr_delete_node(e, table);
-			oph_query_expr_destroy_symtable(table);
-			free(var_list);
+		if (_oph_ioserver_query_run_parallel_expression
+		    (where_string, args, var_count, stored_rs, field_indexes, frag_indexes, field_binary, 0, *input_row_num, start_row_indexes, NULL, 0, 0, selected)) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, where_string);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, where_string);
+			free(selected);
+			_oph_ioserver_query_release_expr(exprs, expr, 1);
 			return OPH_IO_SERVER_PARSE_ERROR;
 		}
-	}
-
-	oph_query_expr_value *res = NULL;
-
-	//TODO Count actual number of string/binary variables
-	oph_query_arg val_b[var_count];
-	long long curr_row = 0;
+		//Add selected rows to each index table, preserving their order
+		for (j = 0; j < (*input_row_num); j++) {
+			if (selected[j]) {
+				for (l = 0; l < table_num; l++)
+					input_rs[l]->record_set[curr_row] = stored_rs[l]->record_set[start_row_indexes[l] + j];
+				curr_row++;
+			}
+		}
+		free(selected);
+	}
+#endif
 
-	for (j = 0; j < (*input_row_num); j++) {
+	for (; j < (*input_row_num); j++) {
 
-		if (_oph_ioserver_query_set_parser_variables(args, var_list, var_count, stored_rs, table, field_indexes, frag_indexes, field_binary, val_b, where_string, j, start_row_indexes)) {
+		if (_oph_ioserver_query_set_parser_variables(args, program, var_count, stored_rs, field_indexes, frag_indexes, field_binary, val_b, where_string, j, start_row_indexes)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, where_string);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, where_string);
-			oph_query_expr_delete_node(e, table);
-			oph_query_expr_destroy_symtable(table);
-			free(var_list);
+			_oph_ioserver_query_release_expr(exprs, expr, 1);
 			return OPH_IO_SERVER_PARSE_ERROR;
 		}
 
-		if (e != NULL && !oph_query_expr_eval_expression(e, &res, table)) {
+		if (!oph_query_expr_run_program(program, res)) {
 			//Create index record
 			long long result = 0;
 			switch (res->type) {
 				case OPH_QUERY_EXPR_TYPE_DOUBLE:
 					{
 						result = (long long) res->data.double_value;
-						free(res);
 						break;
 					}
 				case OPH_QUERY_EXPR_TYPE_LONG:
 					{
 						result = res->data.long_value;
-						free(res);
 						break;
 					}
 				default:
 					{
 						pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, where_string);
 						logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, where_string);
-						free(res);
-						oph_query_expr_delete_node(e, table);
-						oph_query_expr_destroy_symtable(table);
-						free(var_list);
+						_oph_ioserver_query_release_expr(exprs, expr, 1);
 						return OPH_IO_SERVER_PARSE_ERROR;
 					}
 			}
@@ -1067,22 +1084,101 @@ int _oph_ioserver_query_run_where_clause(char *where_string, oph_query_arg ** ar
 		} else {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, where_string);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, where_string);
-			free(var_list);
-			oph_query_expr_delete_node(e, table);
-			oph_query_expr_destroy_symtable(table);
+			_oph_ioserver_query_release_expr(exprs, expr, 1);
 			return OPH_IO_SERVER_PARSE_ERROR;
 		}
 	}
-	free(var_list);
-	oph_query_expr_delete_node(e, table);
-	oph_query_expr_destroy_symtable(table);
+	_oph_ioserver_query_release_expr(exprs, expr, 0);
 	*input_row_num = curr_row;
 
 	return OPH_IO_SERVER_SUCCESS;
 }
 
+int _oph_ioserver_query_run_where_clause(char *where_string, oph_query_arg ** args, int table_num, oph_iostore_frag_record_set ** stored_rs, long long *input_row_num,
+					 oph_iostore_frag_record_set ** input_rs, oph_ioserver_query_expr ** exprs)
+{
+	if (!where_string || !table_num || !stored_rs || !input_row_num || !input_rs) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	int l, i;
+	long long j = 0;
+
+	//Check binary fields if available
+	unsigned int arg_count = 0;
+	i = 0;
+	if (args != NULL) {
+		while (args[i++])
+			arg_count++;
+	}
+	//Find id columns in each table
+	short int id_indexes[table_num];
+	for (l = 0; l < table_num; l++) {
+		for (i = 0; i < stored_rs[l]->field_num; i++) {
+			if (!STRCMP(stored_rs[l]->field_name[i], OPH_NAME_ID)) {
+				id_indexes[l] = i;
+				break;
+			}
+		}
+		//Id not found  
+		if (i == stored_rs[l]->field_num) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELD_NAME_UNKNOWN, OPH_NAME_ID);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELD_NAME_UNKNOWN, OPH_NAME_ID);
+			return OPH_IO_SERVER_EXEC_ERROR;
+		}
+	}
+
+	if (table_num == 1)
+		return _oph_ioserver_query_filter_rows(where_string, args, arg_count, table_num, stored_rs, id_indexes, input_row_num, input_rs, exprs);
+
+	//Join tables on id_dim, then evaluate the where clause on the joined rows
+	long long *join_rows[table_num];
+	long long join_row_num = 0;
+	if (_oph_ioserver_query_join_tables(table_num, id_indexes, stored_rs, join_rows, &join_row_num)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, where_string);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, where_string);
+		return OPH_IO_SERVER_EXEC_ERROR;
+	}
+
+	//Joined tables share fields with stored ones, only the arrays of records are built
+	oph_iostore_frag_record_set joined[table_num], *joined_rs[table_num];
+	int res = OPH_IO_SERVER_SUCCESS;
+	for (l = 0; l < table_num; l++) {
+		joined[l] = *(stored_rs[l]);
+		joined[l].slab = NULL;
+		joined[l].zone_map.valid = 0;
+		joined_rs[l] = joined + l;
+		if (!res && !(joined[l].record_set = (oph_iostore_frag_record **) malloc((join_row_num + 1) * sizeof(oph_iostore_frag_record *))))
+			res = OPH_IO_SERVER_MEMORY_ERROR;
+		else if (!res) {
+			for (j = 0; j < join_row_num; j++)
+				joined[l].record_set[j] = stored_rs[l]->record_set[join_rows[l][j]];
+			joined[l].record_set[join_row_num] = NULL;
+		} else
+			joined[l].record_set = NULL;
+		if (join_rows[l])
+			free(join_rows[l]);
+	}
+
+	if (!res) {
+		*input_row_num = join_row_num;
+		res = _oph_ioserver_query_filter_rows(where_string, args, arg_count, table_num, joined_rs, id_indexes, input_row_num, input_rs, exprs);
+	} else {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+	}
+
+	for (l = 0; l < table_num; l++)
+		if (joined[l].record_set)
+			free(joined[l].record_set);
+
+	return res;
+}
+
 #ifdef OPH_IO_SERVER_NETCDF
-int _oph_io_server_query_load_from_file(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, HASHTBL * query_args, oph_iostore_frag_record_set ** loaded_record_sets,
+int _oph_io_server_query_load_from_file(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_server_hashmap * query_args, oph_iostore_frag_record_set ** loaded_record_sets,
 					unsigned long long *loaded_frag_size)
 {
 	if (!query_args || !dev_handle || !current_db || !meta_db || !query_args) {
@@ -1104,14 +1200,14 @@ int _oph_io_server_query_load_from_file(oph_metadb_db_row ** meta_db, oph_iostor
 	int i;
 
 	//Get import specific arguments
-	char *src_path = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_PATH);
+	char *src_path = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_PATH);
 	if (!src_path) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_PATH);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_PATH);
 		oph_iostore_destroy_frag_recordset(&record_sets);
 		return OPH_IO_SERVER_EXEC_ERROR;
 	}
-	char *measure = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_MEASURE);
+	char *measure = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_MEASURE);
 	if (!measure) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_MEASURE);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_MEASURE);
@@ -1120,7 +1216,7 @@ int _oph_io_server_query_load_from_file(oph_metadb_db_row ** meta_db, oph_iostor
 	}
 
 	unsigned long long row_num = 0;
-	char *nrows = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_NROW);
+	char *nrows = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_NROW);
 	if (!nrows) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_NROW);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_NROW);
@@ -1137,7 +1233,7 @@ int _oph_io_server_query_load_from_file(oph_metadb_db_row ** meta_db, oph_iostor
 	}
 
 	long long frag_start = 0;
-	char *row_start = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ROW_START);
+	char *row_start = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ROW_START);
 	if (!row_start) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_ROW_START);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_ROW_START);
@@ -1153,7 +1249,7 @@ int _oph_io_server_query_load_from_file(oph_metadb_db_row ** meta_db, oph_iostor
 		}
 	}
 
-	char *compression = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_COMPRESSED);
+	char *compression = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_COMPRESSED);
 	if (compression == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_COMPRESSED);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_COMPRESSED);
@@ -1164,7 +1260,7 @@ int _oph_io_server_query_load_from_file(oph_metadb_db_row ** meta_db, oph_iostor
 	char compressed_flag = (STRCMP(compression, OPH_QUERY_ENGINE_LANG_VAL_YES) == 0);
 
 
-	char *dim_type = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_TYPE);
+	char *dim_type = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_TYPE);
 	if (!dim_type) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DIM_TYPE);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DIM_TYPE);
@@ -1201,7 +1297,7 @@ int _oph_io_server_query_load_from_file(oph_metadb_db_row ** meta_db, oph_iostor
 	}
 	free(dim_type_list);
 
-	char *dim_index = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_INDEX);
+	char *dim_index = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_INDEX);
 	if (!dim_index) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DIM_INDEX);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DIM_INDEX);
@@ -1251,7 +1347,7 @@ int _oph_io_server_query_load_from_file(oph_metadb_db_row ** meta_db, oph_iostor
 	free(dim_index_list);
 
 
-	char *dim_start = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_START);
+	char *dim_start = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_START);
 	if (!dim_start) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DIM_START);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DIM_START);
@@ -1306,7 +1402,7 @@ int _oph_io_server_query_load_from_file(oph_metadb_db_row ** meta_db, oph_iostor
 	}
 	free(dim_start_list);
 
-	char *dim_end = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_END);
+	char *dim_end = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_END);
 	if (!dim_end) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DIM_END);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DIM_END);
@@ -1379,7 +1475,7 @@ int _oph_io_server_query_load_from_file(oph_metadb_db_row ** meta_db, oph_iostor
 	}
 
 	int dim_unlim = -1;
-	char *dim_unlimited = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_UNLIM);
+	char *dim_unlimited = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_UNLIM);
 	if (dim_unlimited)
 		dim_unlim = (int) strtol(dim_unlimited, NULL, 10);
 
@@ -1402,6 +1498,13 @@ int _oph_io_server_query_load_from_file(oph_metadb_db_row ** meta_db, oph_iostor
 	free(dims_start);
 	free(dims_end);
 
+	if (oph_iostore_update_frag_zone_map(record_sets)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_IO_API_ERROR, "update_frag_zone_map");
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_IO_API_ERROR, "update_frag_zone_map");
+		oph_iostore_destroy_frag_recordset(&record_sets);
+		return OPH_IO_SERVER_API_ERROR;
+	}
+
 	*loaded_frag_size = frag_size;
 	*loaded_record_sets = record_sets;
 
@@ -1411,7 +1514,7 @@ int _oph_io_server_query_load_from_file(oph_metadb_db_row ** meta_db, oph_iostor
 
 
 #ifdef OPH_IO_SERVER_ESDM
-int _oph_io_server_query_load_from_esdm(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, HASHTBL * query_args, oph_iostore_frag_record_set ** loaded_record_sets,
+int _oph_io_server_query_load_from_esdm(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_server_hashmap * query_args, oph_iostore_frag_record_set ** loaded_record_sets,
 					unsigned long long *loaded_frag_size)
 {
 	if (!query_args || !dev_handle || !current_db || !meta_db || !query_args) {
@@ -1433,14 +1536,14 @@ int _oph_io_server_query_load_from_esdm(oph_metadb_db_row ** meta_db, oph_iostor
 	int i;
 
 	//Get import specific arguments
-	char *src_path = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_PATH);
+	char *src_path = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_PATH);
 	if (!src_path) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_PATH);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_PATH);
 		oph_iostore_destroy_frag_recordset(&record_sets);
 		return OPH_IO_SERVER_EXEC_ERROR;
 	}
-	char *measure = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_MEASURE);
+	char *measure = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_MEASURE);
 	if (!measure) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_MEASURE);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_MEASURE);
@@ -1449,7 +1552,7 @@ int _oph_io_server_query_load_from_esdm(oph_metadb_db_row ** meta_db, oph_iostor
 	}
 
 	unsigned long long row_num = 0;
-	char *nrows = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_NROW);
+	char *nrows = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_NROW);
 	if (!nrows) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_NROW);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_NROW);
@@ -1466,7 +1569,7 @@ int _oph_io_server_query_load_from_esdm(oph_metadb_db_row ** meta_db, oph_iostor
 	}
 
 	long long frag_start = 0;
-	char *row_start = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ROW_START);
+	char *row_start = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ROW_START);
 	if (!row_start) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_ROW_START);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_ROW_START);
@@ -1482,7 +1585,7 @@ int _oph_io_server_query_load_from_esdm(oph_metadb_db_row ** meta_db, oph_iostor
 		}
 	}
 
-	char *compression = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_COMPRESSED);
+	char *compression = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_COMPRESSED);
 	if (compression == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_COMPRESSED);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_COMPRESSED);
@@ -1493,7 +1596,7 @@ int _oph_io_server_query_load_from_esdm(oph_metadb_db_row ** meta_db, oph_iostor
 	char compressed_flag = (STRCMP(compression, OPH_QUERY_ENGINE_LANG_VAL_YES) == 0);
 
 
-	char *dim_type = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_TYPE);
+	char *dim_type = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_TYPE);
 	if (!dim_type) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DIM_TYPE);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DIM_TYPE);
@@ -1530,7 +1633,7 @@ int _oph_io_server_query_load_from_esdm(oph_metadb_db_row ** meta_db, oph_iostor
 	}
 	free(dim_type_list);
 
-	char *dim_index = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_INDEX);
+	char *dim_index = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_INDEX);
 	if (!dim_index) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DIM_INDEX);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DIM_INDEX);
@@ -1580,7 +1683,7 @@ int _oph_io_server_query_load_from_esdm(oph_metadb_db_row ** meta_db, oph_iostor
 	free(dim_index_list);
 
 
-	char *dim_start = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_START);
+	char *dim_start = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_START);
 	if (!dim_start) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DIM_START);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DIM_START);
@@ -1636,7 +1739,7 @@ int _oph_io_server_query_load_from_esdm(oph_metadb_db_row ** meta_db, oph_iostor
 	free(dim_start_list);
 
 
-	char *dim_end = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_END);
+	char *dim_end = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DIM_END);
 	if (!dim_end) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DIM_END);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DIM_END);
@@ -1708,10 +1811,10 @@ int _oph_io_server_query_load_from_esdm(oph_metadb_db_row ** meta_db, oph_iostor
 		return OPH_IO_SERVER_MEMORY_ERROR;
 	}
 
-	char *sub_operation = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_OPERATION);
+	char *sub_operation = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_OPERATION);
 	if (sub_operation && !strcmp(sub_operation, OPH_QUERY_ENGINE_LANG_VAL_NONE))
 		sub_operation = NULL;
-	char *sub_args = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ARGS);
+	char *sub_args = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ARGS);
 
 	//Define record struct
 	unsigned long long frag_size = 0;
@@ -1733,6 +1836,13 @@ int _oph_io_server_query_load_from_esdm(oph_metadb_db_row ** meta_db, oph_iostor
 	free(dims_start);
 	free(dims_end);
 
+	if (oph_iostore_update_frag_zone_map(record_sets)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_IO_API_ERROR, "update_frag_zone_map");
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_IO_API_ERROR, "update_frag_zone_map");
+		oph_iostore_destroy_frag_recordset(&record_sets);
+		return OPH_IO_SERVER_API_ERROR;
+	}
+
 	*loaded_frag_size = frag_size;
 	*loaded_record_sets = record_sets;
 
@@ -1741,9 +1851,9 @@ int _oph_io_server_query_load_from_esdm(oph_metadb_db_row ** meta_db, oph_iostor
 #endif
 
 
-int _oph_ioserver_query_build_input_record_set(HASHTBL * query_args, oph_query_arg ** args, oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db,
+int _oph_ioserver_query_build_input_record_set(oph_server_hashmap * query_args, oph_query_arg ** args, oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db,
 					       oph_iostore_frag_record_set *** stored_rs, long long *input_row_num, oph_iostore_frag_record_set *** input_rs, char *out_db_name, char *out_frag_name,
-					       char file_load_flag)
+					       char file_load_flag, oph_ioserver_query_expr ** exprs)
 {
 	if (!dev_handle || !query_args || !stored_rs || !input_row_num || !input_rs || !meta_db || !current_db) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -1758,7 +1868,7 @@ int _oph_ioserver_query_build_input_record_set(HASHTBL * query_args, oph_query_a
 	char create_flag = (out_db_name != NULL && out_frag_name != NULL);
 
 	//Extract frag_name arg from query args
-	char *from_frag_name = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FROM);
+	char *from_frag_name = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FROM);
 	if (from_frag_name == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FROM);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FROM);
@@ -2021,7 +2131,7 @@ int _oph_ioserver_query_build_input_record_set(HASHTBL * query_args, oph_query_a
 
 	char **alias_list = NULL;
 	int alias_num = 0;
-	char *from_aliases = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FROM_ALIAS);
+	char *from_aliases = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FROM_ALIAS);
 	if (from_aliases == NULL && table_list_num > 1) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FROM_ALIAS);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FROM_ALIAS);
@@ -2074,11 +2184,11 @@ int _oph_ioserver_query_build_input_record_set(HASHTBL * query_args, oph_query_a
 		free(alias_list);
 
 	// Check where clause
-	char *where = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_WHERE);
+	char *where = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_WHERE);
 	if (table_list_num == 1 || file_load_flag != 0) {
 		if (where) {
 			//Apply where condition
-			if (_oph_ioserver_query_run_where_clause(where, args, table_list_num, orig_record_sets, &total_row_number, record_sets)) {
+			if (_oph_ioserver_query_run_where_clause(where, args, table_list_num, orig_record_sets, &total_row_number, record_sets, exprs)) {
 				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, where);
 				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, where);
 				_oph_ioserver_query_release_input_record_set(dev_handle, orig_record_sets, record_sets);
@@ -2093,7 +2203,7 @@ int _oph_ioserver_query_build_input_record_set(HASHTBL * query_args, oph_query_a
 	} else {
 		if (where) {
 			//Apply where condition
-			if (_oph_ioserver_query_run_where_clause(where, args, table_list_num, orig_record_sets, &total_row_number, record_sets)) {
+			if (_oph_ioserver_query_run_where_clause(where, args, table_list_num, orig_record_sets, &total_row_number, record_sets, exprs)) {
 				pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, where);
 				logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, where);
 				_oph_ioserver_query_release_input_record_set(dev_handle, orig_record_sets, record_sets);
@@ -2116,33 +2226,40 @@ int _oph_ioserver_query_build_input_record_set(HASHTBL * query_args, oph_query_a
 	return OPH_IO_SERVER_SUCCESS;
 }
 
-int _oph_ioserver_query_build_input_record_set_create(HASHTBL * query_args, oph_query_arg ** args, oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *out_db_name,
+int _oph_ioserver_query_build_input_record_set_create(oph_server_hashmap * query_args, oph_query_arg ** args, oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *out_db_name,
 						      char *out_frag_name, char *current_db, oph_iostore_frag_record_set *** stored_rs, long long *input_row_num,
-						      oph_iostore_frag_record_set *** input_rs, char file_load_flag)
+						      oph_iostore_frag_record_set *** input_rs, char file_load_flag, oph_ioserver_query_expr ** exprs)
 {
-	return _oph_ioserver_query_build_input_record_set(query_args, args, meta_db, dev_handle, current_db, stored_rs, input_row_num, input_rs, out_db_name, out_frag_name, file_load_flag);
+	return _oph_ioserver_query_build_input_record_set(query_args, args, meta_db, dev_handle, current_db, stored_rs, input_row_num, input_rs, out_db_name, out_frag_name, file_load_flag, exprs);
 }
 
-int _oph_ioserver_query_build_input_record_set_select(HASHTBL * query_args, oph_query_arg ** args, oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db,
-						      oph_iostore_frag_record_set *** stored_rs, long long *input_row_num, oph_iostore_frag_record_set *** input_rs)
+int _oph_ioserver_query_build_input_record_set_select(oph_server_hashmap * query_args, oph_query_arg ** args, oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db,
+						      oph_iostore_frag_record_set *** stored_rs, long long *input_row_num, oph_iostore_frag_record_set *** input_rs,
+						      oph_ioserver_query_expr ** exprs)
 {
-	return _oph_ioserver_query_build_input_record_set(query_args, args, meta_db, dev_handle, current_db, stored_rs, input_row_num, input_rs, NULL, NULL, 0);
+	return _oph_ioserver_query_build_input_record_set(query_args, args, meta_db, dev_handle, current_db, stored_rs, input_row_num, input_rs, NULL, NULL, 0, exprs);
 }
 
-int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_list, int field_list_num, long long offset, long long total_row_number, oph_query_arg ** args,
-					     oph_iostore_frag_record_set ** inputs, oph_iostore_frag_record_set * output)
+int _oph_ioserver_query_build_select_columns(oph_server_hashmap * query_args, char **field_list, int field_list_num, long long offset, long long total_row_number, oph_query_arg ** args,
+					     oph_iostore_frag_record_set ** inputs, oph_iostore_frag_record_set ** sources, oph_iostore_frag_record_set * output, oph_server_arena * arena,
+					     oph_ioserver_query_expr ** exprs)
 {
 	if (!query_args || !field_list || !field_list_num || !total_row_number || !inputs || !output) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
 		return OPH_IO_SERVER_NULL_PARAM;
 	}
+	//Check available memory once per fragment (output cells are accounted by the record set)
+	if (memory_check()) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
 
 	int i = 0, k = 0;
 	long long j = 0, l = 0;
 	unsigned long long id = 0;
 	int var_count = 0;
-	char **var_list = NULL;
 
 	oph_query_field_types field_type[field_list_num];
 
@@ -2155,11 +2272,16 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
 	//Temp variables used to assign values to result set
 	double val_d = 0;
 	unsigned long long val_l = 0;
+	int cell_error = 0;
+	oph_server_arena_mark arena_mark;
+	oph_iostore_frag_record_set *source = NULL;
+	oph_iostore_frag_record *record = NULL;
 
 	//Used for internal parser
+	oph_ioserver_query_expr *expr = NULL;
 	oph_query_expr_node *e = NULL;
-	oph_query_expr_symtable *table = NULL;
-	oph_query_expr_value *res = NULL;
+	oph_query_expr_value res_value, *res = &res_value;
+	oph_query_expr_program *program = NULL;
 	unsigned int binary_index = 0;
 
 	long long actual_rows = 0, rows = 0;
@@ -2173,7 +2295,7 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
 	//Check if sequential ID are used
 	char sequential_id = 0;
 	long long start_id = 0;
-	char *sid = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_SEQUENTIAL);
+	char *sid = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_SEQUENTIAL);
 	if (sid != NULL) {
 		sequential_id = 1;
 		char *end = NULL;
@@ -2196,8 +2318,8 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
 	}
 
 	//Check group by
-	oph_ioserver_group_elem_list **group_lists = NULL;
-	if (_oph_ioserver_query_get_groups(query_args, total_row_number, args, inputs, table_num, &actual_rows, &group_lists)) {
+	oph_ioserver_groups *groups = NULL;
+	if (_oph_ioserver_query_get_groups(query_args, total_row_number, args, inputs, table_num, &actual_rows, &groups, exprs)) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_GROUP_ERROR);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_GROUP_ERROR);
 		return OPH_IO_SERVER_PARSE_ERROR;
@@ -2209,34 +2331,21 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
 				{
 					pmesg(LOG_ERROR, __FILE__, __LINE__, "Unsupported execution of %s\n", field_list[i]);
 					logging(LOG_ERROR, __FILE__, __LINE__, "Unsupported execution of %s\n", field_list[i]);
-					if (group_lists) {
-						for (k = 0; k < actual_rows; k++)
-							if (group_lists[k])
-								_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-						free(group_lists);
-					}
+					if (groups)
+						_oph_ioserver_query_destroy_groups(groups);
 					return OPH_IO_SERVER_EXEC_ERROR;
 				}
 			case OPH_QUERY_FIELD_TYPE_DOUBLE:
 				{
 					val_d = strtod((char *) (field_list[i]), NULL);
-					//Simply copy the value on each row
+					//Store the value once and share it among all rows
 					rows = (actual_rows ? actual_rows : total_row_number);
-					for (j = 0; j < rows; j++) {
-						if (memory_check()) {
-							pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-							logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-							if (group_lists) {
-								for (k = 0; k < actual_rows; k++)
-									if (group_lists[k])
-										_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-								free(group_lists);
-							}
-							return OPH_IO_SERVER_MEMORY_ERROR;
-						}
-
-						output->record_set[j]->field[i] = (void *) memdup((const void *) &val_d, sizeof(double));
-						output->record_set[j]->field_length[i] = sizeof(double);
+					if (oph_iostore_set_frag_column_constant(output, i, rows, &val_d, sizeof(double))) {
+						pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+						logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+						if (groups)
+							_oph_ioserver_query_destroy_groups(groups);
+						return OPH_IO_SERVER_MEMORY_ERROR;
 					}
 					output->field_type[i] = OPH_IOSTORE_REAL_TYPE;
 					break;
@@ -2244,46 +2353,28 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
 			case OPH_QUERY_FIELD_TYPE_LONG:
 				{
 					val_l = strtoll((char *) (field_list[i]), NULL, 10);
-					//Simply copy the value on each row
+					//Store the value once and share it among all rows
 					rows = (actual_rows ? actual_rows : total_row_number);
-					for (j = 0; j < rows; j++) {
-						if (memory_check()) {
-							pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-							logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-							if (group_lists) {
-								for (k = 0; k < actual_rows; k++)
-									if (group_lists[k])
-										_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-								free(group_lists);
-							}
-							return OPH_IO_SERVER_MEMORY_ERROR;
-						}
-
-						output->record_set[j]->field[i] = (void *) memdup((const void *) &val_l, sizeof(unsigned long long));
-						output->record_set[j]->field_length[i] = sizeof(unsigned long long);
+					if (oph_iostore_set_frag_column_constant(output, i, rows, &val_l, sizeof(unsigned long long))) {
+						pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+						logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+						if (groups)
+							_oph_ioserver_query_destroy_groups(groups);
+						return OPH_IO_SERVER_MEMORY_ERROR;
 					}
 					output->field_type[i] = OPH_IOSTORE_LONG_TYPE;
 					break;
 				}
 			case OPH_QUERY_FIELD_TYPE_STRING:
 				{
-					//Simply copy the value on each row
+					//Store the value once and share it among all rows
 					rows = (actual_rows ? actual_rows : total_row_number);
-					for (j = 0; j < rows; j++) {
-						if (memory_check()) {
-							pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-							logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-							if (group_lists) {
-								for (k = 0; k < actual_rows; k++)
-									if (group_lists[k])
-										_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-								free(group_lists);
-							}
-							return OPH_IO_SERVER_MEMORY_ERROR;
-						}
-
-						output->record_set[j]->field[i] = (void *) memdup((const void *) (field_list[i]), strlen(field_list[i]) + 1);
-						output->record_set[j]->field_length[i] = strlen(field_list[i]) + 1;
+					if (oph_iostore_set_frag_column_constant(output, i, rows, field_list[i], strlen(field_list[i]) + 1)) {
+						pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+						logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+						if (groups)
+							_oph_ioserver_query_destroy_groups(groups);
+						return OPH_IO_SERVER_MEMORY_ERROR;
 					}
 					output->field_type[i] = OPH_IOSTORE_REAL_TYPE;
 					break;
@@ -2294,31 +2385,18 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
 					if (binary_index >= arg_count) {
 						pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELD_NAME_UNKNOWN, field_list[i]);
 						logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELD_NAME_UNKNOWN, field_list[i]);
-						if (group_lists) {
-							for (k = 0; k < actual_rows; k++)
-								if (group_lists[k])
-									_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-							free(group_lists);
-						}
+						if (groups)
+							_oph_ioserver_query_destroy_groups(groups);
 						return OPH_IO_SERVER_PARSE_ERROR;
 					}
-					//Simply copy the value on each row
+					//Store the value once and share it among all rows
 					rows = (actual_rows ? actual_rows : total_row_number);
-					for (j = 0; j < rows; j++) {
-						if (memory_check()) {
-							pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-							logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-							if (group_lists) {
-								for (k = 0; k < actual_rows; k++)
-									if (group_lists[k])
-										_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-								free(group_lists);
-							}
-							return OPH_IO_SERVER_MEMORY_ERROR;
-						}
-
-						output->record_set[j]->field[i] = (void *) memdup((const void *) (args[binary_index]->arg), args[binary_index]->arg_length);
-						output->record_set[j]->field_length[i] = args[binary_index]->arg_length;
+					if (oph_iostore_set_frag_column_constant(output, i, rows, args[binary_index]->arg, args[binary_index]->arg_length)) {
+						pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+						logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+						if (groups)
+							_oph_ioserver_query_destroy_groups(groups);
+						return OPH_IO_SERVER_MEMORY_ERROR;
 					}
 					switch (args[binary_index]->arg_type) {
 						case OPH_QUERY_TYPE_LONG:
@@ -2349,12 +2427,8 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
 					if (oph_query_parse_hierarchical_args(field_list[i], &field_components, &field_components_num)) {
 						pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_HIERARCHY_PARSE_ERROR, field_list[i]);
 						logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_HIERARCHY_PARSE_ERROR, field_list[i]);
-						if (group_lists) {
-							for (k = 0; k < actual_rows; k++)
-								if (group_lists[k])
-									_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-							free(group_lists);
-						}
+						if (groups)
+							_oph_ioserver_query_destroy_groups(groups);
 						return OPH_IO_SERVER_PARSE_ERROR;
 					}
 
@@ -2362,12 +2436,8 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
 						pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_HIERARCHY_PARSE_ERROR, field_list[i]);
 						logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_HIERARCHY_PARSE_ERROR, field_list[i]);
 						free(field_components);
-						if (group_lists) {
-							for (k = 0; k < actual_rows; k++)
-								if (group_lists[k])
-									_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-							free(group_lists);
-						}
+						if (groups)
+							_oph_ioserver_query_destroy_groups(groups);
 						return OPH_IO_SERVER_PARSE_ERROR;
 					}
 					//Match table
@@ -2388,12 +2458,8 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
 								pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELD_NAME_UNKNOWN, field_list[i]);
 								logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELD_NAME_UNKNOWN, field_list[i]);
 								free(field_components);
-								if (group_lists) {
-									for (k = 0; k < actual_rows; k++)
-										if (group_lists[k])
-											_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-									free(group_lists);
-								}
+								if (groups)
+									_oph_ioserver_query_destroy_groups(groups);
 								return OPH_IO_SERVER_PARSE_ERROR;
 							}
 							break;
@@ -2403,76 +2469,48 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
 						pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELD_NAME_UNKNOWN, field_list[i]);
 						logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELD_NAME_UNKNOWN, field_list[i]);
 						free(field_components);
-						if (group_lists) {
-							for (k = 0; k < actual_rows; k++)
-								if (group_lists[k])
-									_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-							free(group_lists);
-						}
+						if (groups)
+							_oph_ioserver_query_destroy_groups(groups);
 						return OPH_IO_SERVER_PARSE_ERROR;
 					}
 					free(field_components);
 
 					rows = (actual_rows ? actual_rows : total_row_number);
 					if (!use_seq_id) {
-						if (!group_lists) {
+						//Cells of fragments kept in memory are referenced instead of being copied
+						source = (sources && sources[frag_index] && !sources[frag_index]->tmp_flag ? sources[frag_index] : NULL);
+						if (!groups) {
 							id = offset;
 							for (j = 0; j < rows; j++, id++) {
-								if (memory_check()) {
+								record = inputs[frag_index]->record_set[id];
+								if (source ? oph_iostore_borrow_frag_cell(output, j, i, source, record->field[field_index], record->field_length[field_index])
+								    : oph_iostore_set_frag_cell(output, j, i, record->field[field_index], record->field_length[field_index])) {
 									pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 									logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-									if (group_lists) {
-										for (k = 0; k < actual_rows; k++)
-											if (group_lists[k])
-												_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-										free(group_lists);
-									}
 									return OPH_IO_SERVER_MEMORY_ERROR;
 								}
-								output->record_set[j]->field[i] =
-								    inputs[frag_index]->record_set[id]->field_length[field_index] ?
-								    memdup(inputs[frag_index]->record_set[id]->field[field_index],
-									   inputs[frag_index]->record_set[id]->field_length[field_index]) : NULL;
-								output->record_set[j]->field_length[i] = inputs[frag_index]->record_set[id]->field_length[field_index];
 							}
 						} else {
 							//Aggregation is used, no offset allowed
 							for (j = 0; j < rows; j++) {
-								if (memory_check()) {
+								record = inputs[frag_index]->record_set[groups->row_index[groups->group_start[j]]];
+								if (source ? oph_iostore_borrow_frag_cell(output, j, i, source, record->field[field_index], record->field_length[field_index])
+								    : oph_iostore_set_frag_cell(output, j, i, record->field[field_index], record->field_length[field_index])) {
 									pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 									logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-									if (group_lists) {
-										for (k = 0; k < actual_rows; k++)
-											if (group_lists[k])
-												_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-										free(group_lists);
-									}
+									_oph_ioserver_query_destroy_groups(groups);
 									return OPH_IO_SERVER_MEMORY_ERROR;
 								}
-								output->record_set[j]->field[i] =
-								    inputs[frag_index]->record_set[group_lists[j]->first->elem_index]->field_length[field_index] ?
-								    memdup(inputs[frag_index]->record_set[group_lists[j]->first->elem_index]->field[field_index],
-									   inputs[frag_index]->record_set[group_lists[j]->first->elem_index]->field_length[field_index]) : NULL;
-								output->record_set[j]->field_length[i] = inputs[frag_index]->record_set[group_lists[j]->first->elem_index]->field_length[field_index];
 							}
 						}
 					} else {
-						//Use sequential IDs instead
-						for (j = 0; j < rows; j++) {
-							if (memory_check()) {
-								pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-								logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-								if (group_lists) {
-									for (k = 0; k < actual_rows; k++)
-										if (group_lists[k])
-											_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-									free(group_lists);
-								}
-								return OPH_IO_SERVER_MEMORY_ERROR;
-							}
-							val_l = start_id + j;
-							output->record_set[j]->field[i] = memdup(&val_l, sizeof(unsigned long long));
-							output->record_set[j]->field_length[i] = sizeof(unsigned long long);
+						//Use sequential IDs instead, generated in a single buffer
+						if (oph_iostore_set_frag_column_sequence(output, i, rows, start_id, 1)) {
+							pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+							logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+							if (groups)
+								_oph_ioserver_query_destroy_groups(groups);
+							return OPH_IO_SERVER_MEMORY_ERROR;
 						}
 					}
 					output->field_type[i] = inputs[frag_index]->field_type[field_index];
@@ -2480,103 +2518,113 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
 				}
 			case OPH_QUERY_FIELD_TYPE_FUNCTION:
 				{
-					//Reset values
-					var_list = NULL;
-					var_count = 0;
-					e = NULL;
-					table = NULL;
-					res = NULL;
-
-					if (oph_query_expr_create_symtable(&table, OPH_QUERY_ENGINE_MAX_PLUGIN_NUMBER)) {
-						pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, field_list[i]);
-						logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, field_list[i]);
-						if (group_lists) {
-							for (k = 0; k < actual_rows; k++)
-								if (group_lists[k])
-									_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-							free(group_lists);
-						}
-						return OPH_IO_SERVER_EXEC_ERROR;
-					}
-
-					if (oph_query_expr_get_ast(field_list[i], &e) != 0) {
-						pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, field_list[i]);
-						logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, field_list[i]);
-						oph_query_expr_destroy_symtable(table);
-						if (group_lists) {
-							for (k = 0; k < actual_rows; k++)
-								if (group_lists[k])
-									_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-							free(group_lists);
-						}
-						return OPH_IO_SERVER_EXEC_ERROR;
-					}
-					//Read all variables and link them to input record set fields
-					if (oph_query_expr_get_variables(e, &var_list, &var_count)) {
+					if (_oph_ioserver_query_get_expr(exprs, field_list[i], OPH_IO_SERVER_EXPR_FIELD, arg_count, inputs, table_num, NULL, &expr)) {
 						pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, field_list[i]);
 						logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, field_list[i]);
-						oph_query_expr_delete_node(e, table);
-						oph_query_expr_destroy_symtable(table);
-						if (group_lists) {
-							for (k = 0; k < actual_rows; k++)
-								if (group_lists[k])
-									_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-							free(group_lists);
-						}
+						if (groups)
+							_oph_ioserver_query_destroy_groups(groups);
 						return OPH_IO_SERVER_EXEC_ERROR;
 					}
-
-					unsigned int field_indexes[var_count];
-					int frag_indexes[var_count];
-					//Match binary with 1
-					char field_binary[var_count];
+					e = expr->e;
+					program = expr->program;
+					var_count = expr->var_count;
+					unsigned int *field_indexes = expr->field_indexes;
+					int *frag_indexes = expr->frag_indexes;
+					char *field_binary = expr->field_binary;
 					binary_index = 0;
 
 					//TODO Count actual number of string/binary variables
 					oph_query_arg val_b[var_count];
 
-
-					if (var_count > 0) {
-						if (_oph_ioserver_query_get_variable_indexes(arg_count, var_list, var_count, inputs, table_num, field_indexes, frag_indexes, field_binary, 0, NULL)) {
-							pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_VARIABLE_MATCH_ERROR, field_list[i]);
-							logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_VARIABLE_MATCH_ERROR, field_list[i]);
-							oph_query_expr_delete_node(e, table);
-							oph_query_expr_destroy_symtable(table);
-							free(var_list);
-							if (group_lists) {
-								for (k = 0; k < actual_rows; k++)
-									if (group_lists[k])
-										_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-								free(group_lists);
-							}
-							return OPH_IO_SERVER_EXEC_ERROR;
-						}
-					}
+					//Transient values are taken from the query arena and released row by row
+					expr->table->arena = arena;
+					if (arena)
+						oph_server_arena_get_mark(arena, &arena_mark);
 
 					long long function_row_number = 0;
-					if (!group_lists) {
+					if (!groups) {
 						//No group by provided  
 						char is_aggregate = 0;
 						id = offset;
+						j = 0;
 
-						for (j = 0; j < total_row_number; j++, id++) {
-							if (memory_check()) {
+						//Evaluate blocks of rows when the expression only involves numeric fields
+						if (_oph_ioserver_query_is_batchable(program, var_count, inputs, field_indexes, frag_indexes, field_binary)) {
+							long long *long_columns = (long long *) malloc((size_t) var_count * OPH_QUERY_EXPR_BATCH_SIZE * sizeof(long long));
+							double *double_columns = (double *) malloc((size_t) var_count * OPH_QUERY_EXPR_BATCH_SIZE * sizeof(double));
+							if (!long_columns || !double_columns) {
 								pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 								logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-								oph_query_expr_delete_node(e, table);
-								oph_query_expr_destroy_symtable(table);
-								free(var_list);
+								if (long_columns)
+									free(long_columns);
+								if (double_columns)
+									free(double_columns);
+								_oph_ioserver_query_release_expr(exprs, expr, 1);
 								return OPH_IO_SERVER_MEMORY_ERROR;
 							}
 
+							oph_query_expr_column *res_column = NULL;
+							long long batch_rows = 0;
+							int b = 0;
+
+							for (; j < total_row_number; j += batch_rows, id += batch_rows) {
+								batch_rows = (total_row_number - j < OPH_QUERY_EXPR_BATCH_SIZE ? total_row_number - j : OPH_QUERY_EXPR_BATCH_SIZE);
+
+								if (_oph_ioserver_query_set_parser_columns
+								    (program, var_count, inputs, field_indexes, frag_indexes, long_columns, double_columns, field_list[i], id, batch_rows, NULL)
+								    || oph_query_expr_run_batch(program, batch_rows, &res_column)) {
+									pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
+									logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
+									free(long_columns);
+									free(double_columns);
+									_oph_ioserver_query_release_expr(exprs, expr, 1);
+									return OPH_IO_SERVER_PARSE_ERROR;
+								}
+
+								output->field_type[i] = (res_column->type == OPH_QUERY_EXPR_TYPE_LONG ? OPH_IOSTORE_LONG_TYPE : OPH_IOSTORE_REAL_TYPE);
+								for (b = 0; b < batch_rows && !cell_error; b++, function_row_number++) {
+									if (res_column->type == OPH_QUERY_EXPR_TYPE_LONG)
+										cell_error = oph_iostore_set_frag_cell(output, function_row_number, i, &(res_column->long_value[b]), sizeof(unsigned long long));
+									else
+										cell_error = oph_iostore_set_frag_cell(output, function_row_number, i, &(res_column->double_value[b]), sizeof(double));
+								}
+								if (cell_error) {
+									pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+									logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+									free(long_columns);
+									free(double_columns);
+									_oph_ioserver_query_release_expr(exprs, expr, 1);
+									return OPH_IO_SERVER_MEMORY_ERROR;
+								}
+							}
+							free(long_columns);
+							free(double_columns);
+						}
+#ifdef OPH_OMP
+						//Split rows among threads when functions do not keep state across rows
+						if ((j < total_row_number - 1) && (_oph_ioserver_query_get_thread_num() > 1) && (var_count > 0) && !oph_query_expr_has_aggregate(program)) {
+							if (_oph_ioserver_query_run_parallel_expression
+							    (field_list[i], args, var_count, inputs, field_indexes, frag_indexes, field_binary, id, total_row_number - j, NULL, output, i, function_row_number, NULL)) {
+								pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
+								logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
+								_oph_ioserver_query_release_expr(exprs, expr, 1);
+								return OPH_IO_SERVER_EXEC_ERROR;
+							}
+							function_row_number += total_row_number - j;
+							j = total_row_number;
+						}
+#endif
+
+						for (; j < total_row_number; j++, id++) {
+							if (arena)
+								oph_server_arena_rewind(arena, &arena_mark);
+
 							if (var_count > 0) {
 								if (_oph_ioserver_query_set_parser_variables
-								    (args, var_list, var_count, inputs, table, field_indexes, frag_indexes, field_binary, val_b, field_list[i], id, NULL)) {
+								    (args, program, var_count, inputs, field_indexes, frag_indexes, field_binary, val_b, field_list[i], id, NULL)) {
 									pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
 									logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
-									oph_query_expr_delete_node(e, table);
-									oph_query_expr_destroy_symtable(table);
-									free(var_list);
+									_oph_ioserver_query_release_expr(exprs, expr, 1);
 									return OPH_IO_SERVER_PARSE_ERROR;
 								}
 							}
@@ -2585,34 +2633,26 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
 								if (oph_query_expr_change_group(e)) {
 									pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
 									logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
-									oph_query_expr_delete_node(e, table);
-									oph_query_expr_destroy_symtable(table);
-									free(var_list);
+									_oph_ioserver_query_release_expr(exprs, expr, 1);
 									return OPH_IO_SERVER_PARSE_ERROR;
 								}
 							}
 
-							if (e != NULL && !oph_query_expr_eval_expression(e, &res, table)) {
+							if (!oph_query_expr_run_program(program, res)) {
 								if (res->jump_flag == 0) {
 									switch (res->type) {
 										case OPH_QUERY_EXPR_TYPE_DOUBLE:
 											{
 												if (!function_row_number)
 													output->field_type[i] = OPH_IOSTORE_REAL_TYPE;
-												output->record_set[function_row_number]->field[i] =
-												    (void *) memdup((const void *) &(res->data.double_value), sizeof(double));
-												output->record_set[function_row_number]->field_length[i] = sizeof(double);
-												free(res);
+												cell_error = oph_iostore_set_frag_cell(output, function_row_number, i, &(res->data.double_value), sizeof(double));
 												break;
 											}
 										case OPH_QUERY_EXPR_TYPE_LONG:
 											{
 												if (!function_row_number)
 													output->field_type[i] = OPH_IOSTORE_LONG_TYPE;
-												output->record_set[function_row_number]->field[i] =
-												    (void *) memdup((const void *) &(res->data.long_value), sizeof(unsigned long long));
-												output->record_set[function_row_number]->field_length[i] = sizeof(unsigned long long);
-												free(res);
+												cell_error = oph_iostore_set_frag_cell(output, function_row_number, i, &(res->data.long_value), sizeof(unsigned long long));
 												break;
 											}
 										case OPH_QUERY_EXPR_TYPE_STRING:
@@ -2621,12 +2661,10 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
 													output->field_type[i] = OPH_IOSTORE_STRING_TYPE;
 #ifdef PLUGIN_RES_COPY
 												output->record_set[function_row_number]->field[i] = (void *) res->data.string_value;
+												output->record_set[function_row_number]->field_length[i] = strlen(res->data.string_value) + 1;
 #else
-												output->record_set[function_row_number]->field[i] =
-												    (void *) memdup((const void *) res->data.string_value, strlen(res->data.string_value) + 1);
+												cell_error = oph_iostore_set_frag_cell(output, function_row_number, i, res->data.string_value, strlen(res->data.string_value) + 1);
 #endif
-												output->record_set[function_row_number]->field_length[i] = strlen(res->data.string_value) + 1;
-												free(res);
 												break;
 											}
 										case OPH_QUERY_EXPR_TYPE_BINARY:
@@ -2635,120 +2673,91 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
 													output->field_type[i] = OPH_IOSTORE_STRING_TYPE;
 #ifdef PLUGIN_RES_COPY
 												output->record_set[function_row_number]->field[i] = (void *) res->data.binary_value->arg;
+												output->record_set[function_row_number]->field_length[i] = res->data.binary_value->arg_length;
 #else
-												output->record_set[function_row_number]->field[i] =
-												    (void *) memdup((const void *) res->data.binary_value->arg, res->data.binary_value->arg_length);
+												cell_error = oph_iostore_set_frag_cell(output, function_row_number, i, res->data.binary_value->arg, res->data.binary_value->arg_length);
 #endif
-												output->record_set[function_row_number]->field_length[i] = res->data.binary_value->arg_length;
 												free(res->data.binary_value);
-												free(res);
 												break;
 											}
 										default:
 											{
 												pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
 												logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
-												free(res);
-												oph_query_expr_delete_node(e, table);
-												oph_query_expr_destroy_symtable(table);
-												free(var_list);
+												_oph_ioserver_query_release_expr(exprs, expr, 1);
 												return OPH_IO_SERVER_EXEC_ERROR;
 											}
 									}
+									if (cell_error) {
+										pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+										logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+										_oph_ioserver_query_release_expr(exprs, expr, 1);
+										return OPH_IO_SERVER_MEMORY_ERROR;
+									}
 									function_row_number++;
 								} else {
-									free(res);
 									is_aggregate = 1;
 								}
 							} else {
 								pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
 								logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
-								oph_query_expr_delete_node(e, table);
-								oph_query_expr_destroy_symtable(table);
-								free(var_list);
+								_oph_ioserver_query_release_expr(exprs, expr, 1);
 								return OPH_IO_SERVER_PARSE_ERROR;
 							}
 						}
 
 					} else {
 						//Group by is provided, no offset allowed 
-						oph_ioserver_group_elem *tmp = NULL;
+						long long group_row = 0;
 						char jump_flag = 1;
 
 						for (k = 0; k < actual_rows; k++) {
 							//Loop on groups
-							for (tmp = group_lists[k]->first, j = 0; tmp; tmp = tmp->next, j++) {
+							for (group_row = groups->group_start[k], j = 0; group_row < groups->group_start[k + 1]; group_row++, j++) {
 								jump_flag = 1;
+								if (arena)
+									oph_server_arena_rewind(arena, &arena_mark);
 
 								//Loop on rows                                          
-								if (memory_check()) {
-									pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-									logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-									oph_query_expr_delete_node(e, table);
-									oph_query_expr_destroy_symtable(table);
-									free(var_list);
-									for (k = 0; k < actual_rows; k++)
-										if (group_lists[k])
-											_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-									free(group_lists);
-									return OPH_IO_SERVER_MEMORY_ERROR;
-								}
-
 								if (var_count > 0) {
 									if (_oph_ioserver_query_set_parser_variables
-									    (args, var_list, var_count, inputs, table, field_indexes, frag_indexes, field_binary, val_b, field_list[i], tmp->elem_index,
+									    (args, program, var_count, inputs, field_indexes, frag_indexes, field_binary, val_b, field_list[i], groups->row_index[group_row],
 									     NULL)) {
 										pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
 										logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
-										oph_query_expr_delete_node(e, table);
-										oph_query_expr_destroy_symtable(table);
-										free(var_list);
-										for (k = 0; k < actual_rows; k++)
-											if (group_lists[k])
-												_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-										free(group_lists);
+										_oph_ioserver_query_release_expr(exprs, expr, 1);
+										_oph_ioserver_query_destroy_groups(groups);
 										return OPH_IO_SERVER_PARSE_ERROR;
 									}
 								}
 								//IF last row of group  
-								if (tmp->next == NULL) {
+								if (group_row == groups->group_start[k + 1] - 1) {
 									if (oph_query_expr_change_group(e)) {
 										pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
 										logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
-										oph_query_expr_delete_node(e, table);
-										oph_query_expr_destroy_symtable(table);
-										free(var_list);
-										for (k = 0; k < actual_rows; k++)
-											if (group_lists[k])
-												_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-										free(group_lists);
+										_oph_ioserver_query_release_expr(exprs, expr, 1);
+										_oph_ioserver_query_destroy_groups(groups);
 										return OPH_IO_SERVER_PARSE_ERROR;
 									}
 									//Unset internal jump flag for non-aggregating functions
 									jump_flag = 0;
 								}
 
-								if (e != NULL && !oph_query_expr_eval_expression(e, &res, table)) {
+								if (!oph_query_expr_run_program(program, res)) {
 									if (res->jump_flag == 0 && jump_flag == 0) {
 										switch (res->type) {
 											case OPH_QUERY_EXPR_TYPE_DOUBLE:
 												{
 													if (!function_row_number)
 														output->field_type[i] = OPH_IOSTORE_REAL_TYPE;
-													output->record_set[function_row_number]->field[i] =
-													    (void *) memdup((const void *) &(res->data.double_value), sizeof(double));
-													output->record_set[function_row_number]->field_length[i] = sizeof(double);
-													free(res);
+													cell_error = oph_iostore_set_frag_cell(output, function_row_number, i, &(res->data.double_value), sizeof(double));
 													break;
 												}
 											case OPH_QUERY_EXPR_TYPE_LONG:
 												{
 													if (!function_row_number)
 														output->field_type[i] = OPH_IOSTORE_LONG_TYPE;
-													output->record_set[function_row_number]->field[i] =
-													    (void *) memdup((const void *) &(res->data.long_value), sizeof(unsigned long long));
-													output->record_set[function_row_number]->field_length[i] = sizeof(unsigned long long);
-													free(res);
+													cell_error = oph_iostore_set_frag_cell(output, function_row_number, i, &(res->data.long_value), sizeof(unsigned long long));
 													break;
 												}
 											case OPH_QUERY_EXPR_TYPE_STRING:
@@ -2757,12 +2766,10 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
 														output->field_type[i] = OPH_IOSTORE_STRING_TYPE;
 #ifdef PLUGIN_RES_COPY
 													output->record_set[function_row_number]->field[i] = (void *) res->data.string_value;
+													output->record_set[function_row_number]->field_length[i] = strlen(res->data.string_value) + 1;
 #else
-													output->record_set[function_row_number]->field[i] =
-													    (void *) memdup((const void *) res->data.string_value, strlen(res->data.string_value) + 1);
+													cell_error = oph_iostore_set_frag_cell(output, function_row_number, i, res->data.string_value, strlen(res->data.string_value) + 1);
 #endif
-													output->record_set[function_row_number]->field_length[i] = strlen(res->data.string_value) + 1;
-													free(res);
 													break;
 												}
 											case OPH_QUERY_EXPR_TYPE_BINARY:
@@ -2771,64 +2778,49 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
 														output->field_type[i] = OPH_IOSTORE_STRING_TYPE;
 #ifdef PLUGIN_RES_COPY
 													output->record_set[function_row_number]->field[i] = (void *) res->data.binary_value->arg;
+													output->record_set[function_row_number]->field_length[i] = res->data.binary_value->arg_length;
 #else
-													output->record_set[function_row_number]->field[i] =
-													    (void *) memdup((const void *) res->data.binary_value->arg,
-															    res->data.binary_value->arg_length);
+													cell_error = oph_iostore_set_frag_cell(output, function_row_number, i, res->data.binary_value->arg, res->data.binary_value->arg_length);
 #endif
-													output->record_set[function_row_number]->field_length[i] = res->data.binary_value->arg_length;
 													free(res->data.binary_value);
-													free(res);
 													break;
 												}
 											default:
 												{
 													pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
 													logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
-													free(res);
-													oph_query_expr_delete_node(e, table);
-													oph_query_expr_destroy_symtable(table);
-													free(var_list);
-													for (k = 0; k < actual_rows; k++)
-														if (group_lists[k])
-															_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-													free(group_lists);
+													_oph_ioserver_query_release_expr(exprs, expr, 1);
+													_oph_ioserver_query_destroy_groups(groups);
 													return OPH_IO_SERVER_EXEC_ERROR;
 												}
 										}
+										if (cell_error) {
+											pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+											logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+											_oph_ioserver_query_release_expr(exprs, expr, 1);
+											_oph_ioserver_query_destroy_groups(groups);
+											return OPH_IO_SERVER_MEMORY_ERROR;
+										}
 										function_row_number++;
-									} else {
-										free(res);
 									}
 								} else {
 									pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
 									logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
-									oph_query_expr_delete_node(e, table);
-									oph_query_expr_destroy_symtable(table);
-									free(var_list);
-									for (k = 0; k < actual_rows; k++)
-										if (group_lists[k])
-											_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-									free(group_lists);
+									_oph_ioserver_query_release_expr(exprs, expr, 1);
+									_oph_ioserver_query_destroy_groups(groups);
 									return OPH_IO_SERVER_PARSE_ERROR;
 								}
 							}
 						}
 					}
-					oph_query_expr_delete_node(e, table);
-					oph_query_expr_destroy_symtable(table);
-					free(var_list);
+					_oph_ioserver_query_release_expr(exprs, expr, 0);
 
 					//Check row number
 					if (function_row_number == 0 || (function_row_number != actual_rows && actual_rows != 0)) {
 						pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
 						logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, field_list[i]);
-						if (group_lists) {
-							for (k = 0; k < actual_rows; k++)
-								if (group_lists[k])
-									_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-							free(group_lists);
-						}
+						if (groups)
+							_oph_ioserver_query_destroy_groups(groups);
 						return OPH_IO_SERVER_PARSE_ERROR;
 					}
 					actual_rows = function_row_number;
@@ -2836,35 +2828,69 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
 		}
 	}
 
-	if (group_lists) {
-		for (k = 0; k < actual_rows; k++)
-			if (group_lists[k])
-				_oph_ioserver_query_delete_group_elem_list(group_lists[k]);
-		free(group_lists);
-	}
+	if (groups)
+		_oph_ioserver_query_destroy_groups(groups);
 
 	actual_rows = (actual_rows ? actual_rows : total_row_number);
-	if (actual_rows != total_row_number) {
-		//Remove unnecessary rows
-		for (j = actual_rows; j < total_row_number; j++) {
-			oph_iostore_destroy_frag_record(&(output->record_set[j]), output->field_num);
-		}
-		//Realloc record set array
-		oph_iostore_frag_record **tmp = (oph_iostore_frag_record **) realloc(output->record_set, (actual_rows + 1) * sizeof(oph_iostore_frag_record *));
-		if (tmp == NULL) {
-			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
-			return OPH_IO_SERVER_MEMORY_ERROR;
-		}
-		//Set last element of record to NULL
-		tmp[actual_rows] = NULL;
-		output->record_set = tmp;
+	//Remove unnecessary rows and give back the arena that has not been used
+	if (oph_iostore_trim_frag_recordset(output, actual_rows)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		return OPH_IO_SERVER_MEMORY_ERROR;
 	}
 
 	return OPH_IO_SERVER_SUCCESS;
 }
 
-int _oph_ioserver_query_set_column_info(HASHTBL * query_args, char **field_list, int field_list_num, oph_iostore_frag_record_set * rs)
+unsigned long long _oph_ioserver_query_estimate_row_size(oph_server_hashmap * query_args, char **field_list, int field_list_num, oph_iostore_frag_record_set ** inputs,
+							 oph_iostore_frag_record_set ** sources, long long row)
+{
+	if (!field_list || !inputs)
+		return 0;
+
+	unsigned long long row_size = 0;
+	int i = 0, l = 0, j = 0;
+	const char *field_name = NULL, *separator = NULL;
+	oph_query_field_types field_type;
+	oph_iostore_frag_record_set *source = NULL;
+	char sequential_id = (query_args && oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_SEQUENTIAL));
+	for (i = 0; i < field_list_num; i++) {
+		//Constant columns are shared and the size of function results is not known in advance: the arena grows when they are stored
+		if (oph_query_field_type(field_list[i], &field_type) || (field_type != OPH_QUERY_FIELD_TYPE_VARIABLE))
+			continue;
+
+		//Field names are not split in place, since the list is parsed again to build the columns
+		field_name = field_list[i];
+		separator = strchr(field_name, OPH_QUERY_ENGINE_LANG_HIERARCHY_SEPARATOR);
+		for (l = 0; inputs[l]; l++) {
+			if (!separator || (inputs[l]->frag_name && (strlen(inputs[l]->frag_name) == (size_t) (separator - field_name))
+					   && !strncasecmp(inputs[l]->frag_name, field_name, separator - field_name)))
+				break;
+		}
+		if (!inputs[l] || !inputs[l]->record_set || !inputs[l]->record_set[row])
+			continue;
+		if (separator)
+			field_name = separator + 1;
+		//Sequential ids are generated in a shared buffer
+		if (sequential_id && !STRCMP(OPH_NAME_ID, field_name))
+			continue;
+		//Cells are borrowed from a single source, the columns of other record sets are copied
+		if (sources && sources[l] && !sources[l]->tmp_flag && (!source || (source == sources[l]))) {
+			source = sources[l];
+			continue;
+		}
+		for (j = 0; j < inputs[l]->field_num; j++) {
+			if (inputs[l]->field_name[j] && !STRCMP(field_name, inputs[l]->field_name[j])) {
+				row_size += inputs[l]->record_set[row]->field_length[j];
+				break;
+			}
+		}
+	}
+
+	return row_size;
+}
+
+int _oph_ioserver_query_set_column_info(oph_server_hashmap * query_args, char **field_list, int field_list_num, oph_iostore_frag_record_set * rs)
 {
 	if (!query_args || !field_list || !field_list_num || !rs) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -2876,7 +2902,7 @@ int _oph_ioserver_query_set_column_info(HASHTBL * query_args, char **field_list,
 	char **field_alias_list = NULL;
 	int field_alias_list_num = 0;
 	//Fields section
-	char *fields_alias = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FIELD_ALIAS);
+	char *fields_alias = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FIELD_ALIAS);
 	if (fields_alias != NULL) {
 		if (oph_query_parse_multivalue_arg(fields_alias, &field_alias_list, &field_alias_list_num) || !field_alias_list_num) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FIELD_ALIAS);
@@ -2912,6 +2938,17 @@ int _oph_ioserver_query_set_column_info(HASHTBL * query_args, char **field_list,
 	}
 	rs->field_type[i] = OPH_IOSTORE_STRING_TYPE;
 
+	//Store id_dim values in the contiguous id column of the slab
+	if (rs->slab) {
+		rs->slab->id_index = -1;
+		for (i = 0; i < field_list_num; i++) {
+			if (rs->field_name[i] && !STRCMP(rs->field_name[i], OPH_NAME_ID)) {
+				rs->slab->id_index = i;
+				break;
+			}
+		}
+	}
+
 	return OPH_IO_SERVER_SUCCESS;
 }
 
@@ -2938,6 +2975,13 @@ int _oph_ioserver_query_store_fragment(oph_metadb_db_row ** meta_db, oph_iostore
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_METADB_ERROR, "DB find");
 		return OPH_IO_SERVER_METADB_ERROR;
 	}
+	//Summarize id_dim values before the fragment becomes visible to readers
+	if (oph_iostore_update_frag_zone_map(*final_result_set)) {
+		pthread_rwlock_unlock(&rwlock);
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_IO_API_ERROR, "update_frag_zone_map");
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_IO_API_ERROR, "update_frag_zone_map");
+		return OPH_IO_SERVER_API_ERROR;
+	}
 	//Call API to insert Frag
 	oph_iostore_resource_id *frag_id = NULL;
 	if (oph_iostore_put_frag(dev_handle, *final_result_set, &frag_id) != 0) {
@@ -3257,3 +3301,42 @@ int _oph_ioserver_query_build_row(unsigned int arg_count, unsigned long long *ro
 
 	return OPH_IO_SERVER_SUCCESS;
 }
+
+int _oph_ioserver_query_store_row(unsigned int arg_count, unsigned long long *row_size, oph_iostore_frag_record_set * partial_result_set, oph_query_arg ** args, long long row, long long row_num)
+{
+	if (!arg_count || !row_size || !partial_result_set || !args || (row < 0) || (row >= row_num) || (arg_count < partial_result_set->field_num)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	int i = 0, id_index = -1;
+	unsigned long long arena_size = 0;
+
+	//Attach the slab when the first row is stored
+	if (!partial_result_set->slab) {
+		for (i = 0; i < partial_result_set->field_num; i++) {
+			if (!STRCMP(partial_result_set->field_name[i], OPH_NAME_ID) && (args[i]->arg_length == sizeof(unsigned long long)))
+				id_index = i;
+			else
+				arena_size += args[i]->arg_length;
+		}
+		if (oph_iostore_create_frag_slab(partial_result_set, row_num, id_index, row_num * arena_size)) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			return OPH_IO_SERVER_MEMORY_ERROR;
+		}
+	}
+
+	(*row_size) = sizeof(oph_iostore_frag_record);
+	for (i = 0; i < partial_result_set->field_num; i++) {
+		if (args[i]->arg_is_null || oph_iostore_set_frag_cell(partial_result_set, row, i, args[i]->arg, args[i]->arg_length)) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			return OPH_IO_SERVER_MEMORY_ERROR;
+		}
+		(*row_size) += (args[i]->arg_length + sizeof(unsigned long long) + sizeof(void *));
+	}
+
+	return OPH_IO_SERVER_SUCCESS;
+}
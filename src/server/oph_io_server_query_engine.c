@@ -32,7 +32,8 @@
 extern int msglevel;
 extern pthread_rwlock_t rwlock;
 
-int _oph_io_server_run_create_as_select(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, HASHTBL * query_args, char file_load_flag)
+int _oph_io_server_run_create_as_select(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, oph_server_hashmap * query_args, char file_load_flag,
+					oph_server_arena * arena, oph_ioserver_query_expr ** exprs)
 {
 	if (!query_args || !dev_handle || !current_db || !meta_db) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -49,7 +50,7 @@ int _oph_io_server_run_create_as_select(oph_metadb_db_row ** meta_db, oph_iostor
 	char *out_db_name = NULL;
 
 	//Extract new frag_name arg from query args
-	out_frag_name = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
+	out_frag_name = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
 	if (out_frag_name == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
@@ -80,14 +81,14 @@ int _oph_io_server_run_create_as_select(oph_metadb_db_row ** meta_db, oph_iostor
 	}
 
 	if (_oph_ioserver_query_build_input_record_set_create
-	    (query_args, args, meta_db, dev_handle, out_db_name, out_frag_name, current_db, &orig_record_sets, &row_number, &record_sets, file_load_flag)) {
+	    (query_args, args, meta_db, dev_handle, out_db_name, out_frag_name, current_db, &orig_record_sets, &row_number, &record_sets, file_load_flag, exprs)) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_SELECTION_ERROR);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_SELECTION_ERROR);
 		free(frag_components);
 		return OPH_IO_SERVER_EXEC_ERROR;
 	}
 
-	char *fields = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
+	char *fields = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
 	if (fields == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
@@ -129,6 +130,8 @@ int _oph_io_server_run_create_as_select(oph_metadb_db_row ** meta_db, oph_iostor
 	}
 	//Prepare output record set
 	oph_iostore_frag_record_set *rs = NULL;
+	//Pass-through columns reference fragments kept in memory
+	oph_iostore_frag_record_set **sources = (dev_handle->is_persistent ? NULL : orig_record_sets);
 	int i = 0;
 	long long j = 0, total_row_number = 0;
 
@@ -143,7 +146,8 @@ int _oph_io_server_run_create_as_select(oph_metadb_db_row ** meta_db, oph_iostor
 			}
 		}
 		//Create output record set
-		if (oph_iostore_create_frag_recordset(&rs, total_row_number, field_list_num)) {
+		unsigned long long arena_size = (total_row_number ? total_row_number * _oph_ioserver_query_estimate_row_size(query_args, field_list, field_list_num, record_sets, sources, offset) : 0);
+		if (oph_iostore_create_frag_recordset_slab(&rs, total_row_number, field_list_num, -1, arena_size)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 			_oph_ioserver_query_release_input_record_set(dev_handle, orig_record_sets, record_sets);
@@ -168,7 +172,7 @@ int _oph_io_server_run_create_as_select(oph_metadb_db_row ** meta_db, oph_iostor
 			return OPH_IO_SERVER_EXEC_ERROR;
 		}
 		//Process each column
-		if (_oph_ioserver_query_build_select_columns(query_args, field_list, field_list_num, offset, total_row_number, args, record_sets, rs)) {
+		if (_oph_ioserver_query_build_select_columns(query_args, field_list, field_list_num, offset, total_row_number, args, record_sets, sources, rs, arena, exprs)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELDS_EXEC_ERROR);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELDS_EXEC_ERROR);
 			_oph_ioserver_query_release_input_record_set(dev_handle, orig_record_sets, record_sets);
@@ -236,26 +240,30 @@ int _oph_io_server_run_create_as_select(oph_metadb_db_row ** meta_db, oph_iostor
 	return OPH_IO_SERVER_SUCCESS;
 }
 
-int oph_io_server_run_create_as_select_table(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, HASHTBL * query_args)
+int oph_io_server_run_create_as_select_table(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, oph_server_hashmap * query_args, oph_server_arena * arena,
+					     oph_ioserver_query_expr ** exprs)
 {
-	return _oph_io_server_run_create_as_select(meta_db, dev_handle, current_db, args, query_args, 0);
+	return _oph_io_server_run_create_as_select(meta_db, dev_handle, current_db, args, query_args, 0, arena, exprs);
 }
 
 #ifdef OPH_IO_SERVER_NETCDF
-int oph_io_server_run_create_as_select_file(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, HASHTBL * query_args)
+int oph_io_server_run_create_as_select_file(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, oph_server_hashmap * query_args, oph_server_arena * arena,
+					    oph_ioserver_query_expr ** exprs)
 {
-	return _oph_io_server_run_create_as_select(meta_db, dev_handle, current_db, args, query_args, 1);
+	return _oph_io_server_run_create_as_select(meta_db, dev_handle, current_db, args, query_args, 1, arena, exprs);
 }
 #endif
 
 #ifdef OPH_IO_SERVER_ESDM
-int oph_io_server_run_create_as_select_esdm(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, HASHTBL * query_args)
+int oph_io_server_run_create_as_select_esdm(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, oph_server_hashmap * query_args, oph_server_arena * arena,
+					    oph_ioserver_query_expr ** exprs)
 {
-	return _oph_io_server_run_create_as_select(meta_db, dev_handle, current_db, args, query_args, 2);
+	return _oph_io_server_run_create_as_select(meta_db, dev_handle, current_db, args, query_args, 2, arena, exprs);
 }
 #endif
 
-int oph_io_server_run_select(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, HASHTBL * query_args, oph_iostore_frag_record_set ** output_rs)
+int oph_io_server_run_select(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, oph_server_hashmap * query_args, oph_iostore_frag_record_set ** output_rs,
+			     oph_server_arena * arena, oph_ioserver_query_expr ** exprs)
 {
 	if (!query_args || !dev_handle || !current_db || !meta_db || !output_rs) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -268,7 +276,7 @@ int oph_io_server_run_select(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 	*output_rs = NULL;
 	long long row_number = 0;
 
-	if (_oph_ioserver_query_build_input_record_set_select(query_args, args, meta_db, dev_handle, current_db, &orig_record_sets, &row_number, &record_sets)) {
+	if (_oph_ioserver_query_build_input_record_set_select(query_args, args, meta_db, dev_handle, current_db, &orig_record_sets, &row_number, &record_sets, exprs)) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_SELECTION_ERROR);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_SELECTION_ERROR);
 		return OPH_IO_SERVER_EXEC_ERROR;
@@ -277,7 +285,7 @@ int oph_io_server_run_select(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 	char **field_list = NULL;
 	int field_list_num = 0;
 	//Fields section
-	char *fields = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
+	char *fields = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
 	if (fields == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
@@ -304,6 +312,8 @@ int oph_io_server_run_select(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 	}
 	//Prepare output record set
 	oph_iostore_frag_record_set *rs = NULL;
+	//Pass-through columns reference fragments kept in memory
+	oph_iostore_frag_record_set **sources = (dev_handle->is_persistent ? NULL : orig_record_sets);
 	long long j = 0, total_row_number = 0;
 	int error = 0;
 
@@ -319,7 +329,8 @@ int oph_io_server_run_select(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 			}
 		}
 		//Create output record set
-		if (oph_iostore_create_frag_recordset(&rs, total_row_number, field_list_num)) {
+		unsigned long long arena_size = (total_row_number ? total_row_number * _oph_ioserver_query_estimate_row_size(query_args, field_list, field_list_num, record_sets, sources, offset) : 0);
+		if (oph_iostore_create_frag_recordset_slab(&rs, total_row_number, field_list_num, -1, arena_size)) {
 			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
 			error = OPH_IO_SERVER_MEMORY_ERROR;
@@ -335,7 +346,7 @@ int oph_io_server_run_select(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 				error = OPH_IO_SERVER_EXEC_ERROR;
 			} else {
 				//Process each column
-				if (_oph_ioserver_query_build_select_columns(query_args, field_list, field_list_num, offset, total_row_number, args, record_sets, rs)) {
+				if (_oph_ioserver_query_build_select_columns(query_args, field_list, field_list_num, offset, total_row_number, args, record_sets, sources, rs, arena, exprs)) {
 					pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELDS_EXEC_ERROR);
 					logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_FIELDS_EXEC_ERROR);
 					error = OPH_IO_SERVER_EXEC_ERROR;
@@ -384,51 +395,80 @@ int oph_io_server_run_select(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 	return OPH_IO_SERVER_SUCCESS;
 }
 
-int oph_io_server_run_insert(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_iostore_frag_record_set * rs, unsigned long long rs_index, oph_query_arg ** args, HASHTBL * query_args,
-			     unsigned long long *size)
+static int _oph_io_server_query_get_insert_lists(oph_server_hashmap * query_args, oph_io_server_prepared_stmt * stmt, char ***field_list, int *field_list_num, char ***value_list, int *value_list_num)
 {
-	if (!query_args || !dev_handle || !rs || !meta_db || !size) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
-		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
-		return OPH_IO_SERVER_NULL_PARAM;
+	if (stmt && stmt->field_list && stmt->value_list) {
+		//Lists have been split at preparation time: only pointer arrays are copied, since callers release them
+		*field_list = (char **) malloc(stmt->field_list_num * sizeof(char *));
+		*value_list = (char **) malloc(stmt->value_list_num * sizeof(char *));
+		if (!*field_list || !*value_list) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			if (*field_list)
+				free(*field_list);
+			if (*value_list)
+				free(*value_list);
+			*field_list = *value_list = NULL;
+			return OPH_IO_SERVER_MEMORY_ERROR;
+		}
+		memcpy(*field_list, stmt->field_list, stmt->field_list_num * sizeof(char *));
+		memcpy(*value_list, stmt->value_list, stmt->value_list_num * sizeof(char *));
+		*field_list_num = stmt->field_list_num;
+		*value_list_num = stmt->value_list_num;
+		return OPH_IO_SERVER_SUCCESS;
 	}
 
-	*size = 0;
-	char **field_list = NULL, **value_list = NULL;
-	int field_list_num = 0, value_list_num = 0;
 	//Fields section
-	char *fields = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
+	char *fields = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
 	if (fields == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
 		return OPH_IO_SERVER_EXEC_ERROR;
 	}
-	if (oph_query_parse_multivalue_arg(fields, &field_list, &field_list_num)) {
+	if (oph_query_parse_multivalue_arg(fields, field_list, field_list_num)) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_MULTIVAL_PARSE_ERROR, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_MULTIVAL_PARSE_ERROR, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
-		if (field_list)
-			free(field_list);
+		if (*field_list)
+			free(*field_list);
 		return OPH_IO_SERVER_EXEC_ERROR;
 	}
 	//Values section
-	char *values = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_VALUE);
+	char *values = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_VALUE);
 	if (!values) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_VALUE);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_VALUE);
-		if (field_list)
-			free(field_list);
+		if (*field_list)
+			free(*field_list);
 		return OPH_IO_SERVER_EXEC_ERROR;
 	}
-	if (oph_query_parse_multivalue_arg(values, &value_list, &value_list_num)) {
+	if (oph_query_parse_multivalue_arg(values, value_list, value_list_num)) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_MULTIVAL_PARSE_ERROR, OPH_QUERY_ENGINE_LANG_ARG_VALUE);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_MULTIVAL_PARSE_ERROR, OPH_QUERY_ENGINE_LANG_ARG_VALUE);
-		if (field_list)
-			free(field_list);
-		if (value_list)
-			free(value_list);
+		if (*field_list)
+			free(*field_list);
+		if (*value_list)
+			free(*value_list);
 		return OPH_IO_SERVER_EXEC_ERROR;
 	}
 
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+int oph_io_server_run_insert(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_iostore_frag_record_set * rs, unsigned long long rs_index, oph_query_arg ** args, oph_server_hashmap * query_args,
+			     oph_io_server_prepared_stmt * stmt, unsigned long long *size)
+{
+	if (!query_args || !dev_handle || !rs || !meta_db || !size) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	*size = 0;
+	char **field_list = NULL, **value_list = NULL;
+	int field_list_num = 0, value_list_num = 0;
+	if (_oph_io_server_query_get_insert_lists(query_args, stmt, &field_list, &field_list_num, &value_list, &value_list_num))
+		return OPH_IO_SERVER_EXEC_ERROR;
+
 	if (value_list_num != field_list_num || value_list_num != rs->field_num) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_MULTIVAL_ARGS_DIFFER, OPH_QUERY_ENGINE_LANG_OP_INSERT);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_MULTIVAL_ARGS_DIFFER, OPH_QUERY_ENGINE_LANG_OP_INSERT);
@@ -471,8 +511,8 @@ int oph_io_server_run_insert(oph_metadb_db_row ** meta_db, oph_iostore_handler *
 	return OPH_IO_SERVER_SUCCESS;
 }
 
-int oph_io_server_run_multi_insert(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, HASHTBL * query_args,
-				   unsigned int *num_insert, unsigned long long *size)
+int oph_io_server_run_multi_insert(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, oph_server_hashmap * query_args,
+				   oph_io_server_prepared_stmt * stmt, unsigned int *num_insert, unsigned long long *size)
 {
 	if (!query_args || !dev_handle || !thread_status || !meta_db || !num_insert || !size) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -487,38 +527,8 @@ int oph_io_server_run_multi_insert(oph_metadb_db_row ** meta_db, oph_iostore_han
 
 	char **field_list = NULL, **value_list = NULL;
 	int field_list_num = 0, value_list_num = 0;
-	//Fields section
-	char *fields = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
-	if (fields == NULL) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
-		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
-		return OPH_IO_SERVER_EXEC_ERROR;
-	}
-	if (oph_query_parse_multivalue_arg(fields, &field_list, &field_list_num)) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_MULTIVAL_PARSE_ERROR, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
-		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_MULTIVAL_PARSE_ERROR, OPH_QUERY_ENGINE_LANG_ARG_FIELD);
-		if (field_list)
-			free(field_list);
-		return OPH_IO_SERVER_EXEC_ERROR;
-	}
-	//Values section
-	char *values = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_VALUE);
-	if (!values) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_VALUE);
-		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_VALUE);
-		if (field_list)
-			free(field_list);
-		return OPH_IO_SERVER_EXEC_ERROR;
-	}
-	if (oph_query_parse_multivalue_arg(values, &value_list, &value_list_num)) {
-		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_MULTIVAL_PARSE_ERROR, OPH_QUERY_ENGINE_LANG_ARG_VALUE);
-		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_MULTIVAL_PARSE_ERROR, OPH_QUERY_ENGINE_LANG_ARG_VALUE);
-		if (field_list)
-			free(field_list);
-		if (value_list)
-			free(value_list);
+	if (_oph_io_server_query_get_insert_lists(query_args, stmt, &field_list, &field_list_num, &value_list, &value_list_num))
 		return OPH_IO_SERVER_EXEC_ERROR;
-	}
 	//Check if values number is a multiple of field number
 	if (value_list_num < field_list_num || (value_list_num % field_list_num != 0) || field_list_num != tmp->field_num) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_MULTIVAL_ARGS_DIFFER, OPH_QUERY_ENGINE_LANG_OP_INSERT);
@@ -614,7 +624,7 @@ int oph_io_server_run_multi_insert(oph_metadb_db_row ** meta_db, oph_iostore_han
 }
 
 #ifdef OPH_IO_SERVER_NETCDF
-int oph_io_server_run_insert_from_file(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, HASHTBL * query_args)
+int oph_io_server_run_insert_from_file(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_server_hashmap * query_args)
 {
 	if (!query_args || !dev_handle || !current_db || !meta_db || !query_args) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -649,7 +659,7 @@ int oph_io_server_run_insert_from_file(oph_metadb_db_row ** meta_db, oph_iostore
 #endif
 
 #ifdef OPH_IO_SERVER_ESDM
-int oph_io_server_run_insert_from_esdm(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, HASHTBL * query_args)
+int oph_io_server_run_insert_from_esdm(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_server_hashmap * query_args)
 {
 	if (!query_args || !dev_handle || !current_db || !meta_db || !query_args) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -683,7 +693,7 @@ int oph_io_server_run_insert_from_esdm(oph_metadb_db_row ** meta_db, oph_iostore
 }
 #endif
 
-int oph_io_server_run_random_insert(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, HASHTBL * query_args)
+int oph_io_server_run_random_insert(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_server_hashmap * query_args)
 {
 	if (!query_args || !dev_handle || !current_db || !meta_db || !query_args) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -699,14 +709,14 @@ int oph_io_server_run_random_insert(oph_metadb_db_row ** meta_db, oph_iostore_ha
 		return OPH_IO_SERVER_EXEC_ERROR;
 	}
 	//Get randcube specific arguments
-	char *mes_type = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_MEASURE_TYPE);
+	char *mes_type = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_MEASURE_TYPE);
 	if (!mes_type) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_MEASURE_TYPE);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_MEASURE_TYPE);
 		oph_iostore_destroy_frag_recordset(&record_sets);
 		return OPH_IO_SERVER_EXEC_ERROR;
 	}
-	char *algorithm = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ALGORITHM);
+	char *algorithm = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ALGORITHM);
 	if (!algorithm) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_ALGORITHM);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_ALGORITHM);
@@ -715,7 +725,7 @@ int oph_io_server_run_random_insert(oph_metadb_db_row ** meta_db, oph_iostore_ha
 	}
 
 	long long row_num = 0;
-	char *nrows = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_NROW);
+	char *nrows = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_NROW);
 	if (!nrows) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_NROW);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_NROW);
@@ -732,7 +742,7 @@ int oph_io_server_run_random_insert(oph_metadb_db_row ** meta_db, oph_iostore_ha
 	}
 
 	long long frag_start = 0;
-	char *row_start = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ROW_START);
+	char *row_start = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ROW_START);
 	if (!row_start) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_ROW_START);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_ROW_START);
@@ -749,7 +759,7 @@ int oph_io_server_run_random_insert(oph_metadb_db_row ** meta_db, oph_iostore_ha
 	}
 
 	long long array_length = 0;
-	char *arrlen = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ARRAY_LEN);
+	char *arrlen = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ARRAY_LEN);
 	if (!arrlen) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_ARRAY_LEN);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_ARRAY_LEN);
@@ -765,7 +775,7 @@ int oph_io_server_run_random_insert(oph_metadb_db_row ** meta_db, oph_iostore_ha
 		}
 	}
 
-	char *compression = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_COMPRESSED);
+	char *compression = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_COMPRESSED);
 	if (compression == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_COMPRESSED);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_COMPRESSED);
@@ -807,7 +817,7 @@ int oph_io_server_run_random_insert(oph_metadb_db_row ** meta_db, oph_iostore_ha
 	return OPH_IO_SERVER_SUCCESS;
 }
 
-int oph_io_server_run_create_empty_frag(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, HASHTBL * query_args, oph_iostore_frag_record_set ** output_rs)
+int oph_io_server_run_create_empty_frag(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_server_hashmap * query_args, oph_iostore_frag_record_set ** output_rs)
 {
 	if (!query_args || !dev_handle || !current_db || !meta_db || !output_rs) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -818,7 +828,7 @@ int oph_io_server_run_create_empty_frag(oph_metadb_db_row ** meta_db, oph_iostor
 	*output_rs = NULL;
 
 	//Extract frag_name arg from query args
-	char *frag_name = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
+	char *frag_name = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
 	if (frag_name == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
@@ -892,7 +902,7 @@ int oph_io_server_run_create_empty_frag(oph_metadb_db_row ** meta_db, oph_iostor
 		return OPH_IO_SERVER_MEMORY_ERROR;
 	}
 	//Extract frag column name from query args
-	char *frag_column_names = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_COLUMN_NAME);
+	char *frag_column_names = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_COLUMN_NAME);
 	if (frag_column_names == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_COLUMN_NAME);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_COLUMN_NAME);
@@ -919,7 +929,7 @@ int oph_io_server_run_create_empty_frag(oph_metadb_db_row ** meta_db, oph_iostor
 		return OPH_IO_SERVER_EXEC_ERROR;
 	}
 	//Extract frag column types from query args
-	char *frag_column_types = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_COLUMN_TYPE);
+	char *frag_column_types = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_COLUMN_TYPE);
 	char **column_type_list = NULL;
 	int column_type_num = 0;
 	if (frag_column_types == NULL) {
@@ -1010,7 +1020,7 @@ int oph_io_server_run_create_empty_frag(oph_metadb_db_row ** meta_db, oph_iostor
 	return OPH_IO_SERVER_SUCCESS;
 }
 
-int oph_io_server_run_drop_frag(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, HASHTBL * query_args)
+int oph_io_server_run_drop_frag(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_server_hashmap * query_args)
 {
 	if (!query_args || !dev_handle || !current_db || !meta_db) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -1018,7 +1028,7 @@ int oph_io_server_run_drop_frag(oph_metadb_db_row ** meta_db, oph_iostore_handle
 		return OPH_IO_SERVER_NULL_PARAM;
 	}
 	//Extract frag_name arg from query args
-	char *frag_name = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
+	char *frag_name = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
 	if (frag_name == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_FRAG);
@@ -1101,7 +1111,7 @@ int oph_io_server_run_drop_frag(oph_metadb_db_row ** meta_db, oph_iostore_handle
 	return OPH_IO_SERVER_SUCCESS;
 }
 
-int oph_io_server_run_create_db(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, HASHTBL * query_args)
+int oph_io_server_run_create_db(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_server_hashmap * query_args)
 {
 	if (!query_args || !dev_handle || !meta_db) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -1109,7 +1119,7 @@ int oph_io_server_run_create_db(oph_metadb_db_row ** meta_db, oph_iostore_handle
 		return OPH_IO_SERVER_NULL_PARAM;
 	}
 	//Extract db_name arg from query args
-	char *db_name = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DB);
+	char *db_name = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DB);
 	if (db_name == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DB);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DB);
@@ -1187,7 +1197,7 @@ int oph_io_server_run_create_db(oph_metadb_db_row ** meta_db, oph_iostore_handle
 	return OPH_IO_SERVER_SUCCESS;
 }
 
-int oph_io_server_run_drop_db(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, HASHTBL * query_args, char **deleted_db)
+int oph_io_server_run_drop_db(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_server_hashmap * query_args, char **deleted_db)
 {
 	if (!query_args || !dev_handle || !meta_db || !deleted_db) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -1195,7 +1205,7 @@ int oph_io_server_run_drop_db(oph_metadb_db_row ** meta_db, oph_iostore_handler
 		return OPH_IO_SERVER_NULL_PARAM;
 	}
 	//Extract DB name from query args
-	char *db_name = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DB);
+	char *db_name = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_DB);
 	if (db_name == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DB);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_DB);
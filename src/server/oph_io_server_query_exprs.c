@@ -0,0 +1,289 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "oph_io_server_query_manager.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <debug.h>
+
+#include "oph_server_utility.h"
+#include "oph_query_plugin_loader.h"
+
+extern int msglevel;
+
+static void _oph_ioserver_query_free_names(oph_ioserver_query_expr * expr)
+{
+	int k;
+	for (k = 0; k < expr->var_count; k++) {
+		if (expr->field_names && expr->field_names[k])
+			free(expr->field_names[k]);
+		if (expr->frag_names && expr->frag_names[k])
+			free(expr->frag_names[k]);
+	}
+}
+
+static void _oph_ioserver_query_free_expr(oph_ioserver_query_expr * expr)
+{
+	if (!expr)
+		return;
+
+	if (expr->program)
+		oph_query_expr_destroy_program(expr->program);
+	if (expr->e)
+		oph_query_expr_delete_node(expr->e, expr->table);
+	if (expr->table)
+		oph_query_expr_destroy_symtable(expr->table);
+	_oph_ioserver_query_free_names(expr);
+	if (expr->var_list)
+		free(expr->var_list);
+	if (expr->field_indexes)
+		free(expr->field_indexes);
+	if (expr->frag_indexes)
+		free(expr->frag_indexes);
+	if (expr->field_binary)
+		free(expr->field_binary);
+	if (expr->field_names)
+		free(expr->field_names);
+	if (expr->frag_names)
+		free(expr->frag_names);
+	if (expr->expression)
+		free(expr->expression);
+	free(expr);
+}
+
+static int _oph_ioserver_query_same_name(const char *name, const char *kept_name)
+{
+	if (!name || !kept_name)
+		return !name && !kept_name;
+	return !STRCMP(name, kept_name);
+}
+
+//Check if variables still refer to fields with the same names
+static int _oph_ioserver_query_check_expr(oph_ioserver_query_expr * expr, unsigned int arg_count, oph_iostore_frag_record_set ** inputs, int table_num)
+{
+	if (expr->arg_count != arg_count || expr->table_num != table_num)
+		return 0;
+
+	int k;
+	oph_iostore_frag_record_set *rs = NULL;
+	for (k = 0; k < expr->var_count; k++) {
+		if (expr->field_binary[k])
+			continue;
+		rs = inputs[expr->frag_indexes[k]];
+		if (expr->field_indexes[k] >= (unsigned int) rs->field_num || !_oph_ioserver_query_same_name(rs->field_name[expr->field_indexes[k]], expr->field_names[k])
+		    || !_oph_ioserver_query_same_name(rs->frag_name, expr->frag_names[k]))
+			return 0;
+	}
+
+	return 1;
+}
+
+static int _oph_ioserver_query_resolve_expr(oph_ioserver_query_expr * expr, char keep, unsigned int arg_count, oph_iostore_frag_record_set ** inputs, int table_num, short int *id_indexes)
+{
+	if (expr->var_count > 0
+	    && _oph_ioserver_query_get_variable_indexes(arg_count, expr->var_list, expr->var_count, inputs, table_num, expr->field_indexes, expr->frag_indexes, expr->field_binary,
+							 expr->mode != OPH_IO_SERVER_EXPR_FIELD, id_indexes)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_VARIABLE_MATCH_ERROR, expr->expression);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_VARIABLE_MATCH_ERROR, expr->expression);
+		return OPH_IO_SERVER_EXEC_ERROR;
+	}
+	expr->arg_count = arg_count;
+	expr->table_num = table_num;
+
+	//Names are needed only to check the fields of the following executions
+	if (!keep)
+		return OPH_IO_SERVER_SUCCESS;
+
+	_oph_ioserver_query_free_names(expr);
+	int k;
+	oph_iostore_frag_record_set *rs = NULL;
+	for (k = 0; k < expr->var_count; k++) {
+		expr->field_names[k] = expr->frag_names[k] = NULL;
+		if (expr->field_binary[k])
+			continue;
+		rs = inputs[expr->frag_indexes[k]];
+		if ((rs->field_name[expr->field_indexes[k]] && !(expr->field_names[k] = strdup(rs->field_name[expr->field_indexes[k]])))
+		    || (rs->frag_name && !(expr->frag_names[k] = strdup(rs->frag_name)))) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			return OPH_IO_SERVER_MEMORY_ERROR;
+		}
+	}
+
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+static void _oph_ioserver_query_add_expr(oph_ioserver_query_expr ** exprs, oph_ioserver_query_expr * expr)
+{
+	if (exprs) {
+		expr->next = *exprs;
+		*exprs = expr;
+	}
+}
+
+int _oph_ioserver_query_get_expr(oph_ioserver_query_expr ** exprs, char *expression, char mode, unsigned int arg_count, oph_iostore_frag_record_set ** inputs, int table_num, short int *id_indexes,
+				 oph_ioserver_query_expr ** expr)
+{
+	if (!expression || !inputs || !table_num || (mode != OPH_IO_SERVER_EXPR_FIELD && !id_indexes) || !expr) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	*expr = NULL;
+
+	oph_ioserver_query_expr *tmp = NULL;
+	if (exprs) {
+		for (tmp = *exprs; tmp; tmp = tmp->next)
+			if (tmp->mode == mode && !strcmp(tmp->expression, expression))
+				break;
+		if (tmp) {
+			int res = OPH_IO_SERVER_SUCCESS;
+			//Input fields may have changed since the previous execution
+			if (!_oph_ioserver_query_check_expr(tmp, arg_count, inputs, table_num) && (res = _oph_ioserver_query_resolve_expr(tmp, 1, arg_count, inputs, table_num, id_indexes))) {
+				_oph_ioserver_query_release_expr(exprs, tmp, 1);
+				return res;
+			}
+			*expr = tmp;
+			return OPH_IO_SERVER_SUCCESS;
+		}
+	}
+
+	tmp = (oph_ioserver_query_expr *) calloc(1, sizeof(oph_ioserver_query_expr));
+	if (!tmp || !(tmp->expression = strdup(expression))) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		_oph_ioserver_query_free_expr(tmp);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+	tmp->mode = mode;
+
+	if (oph_query_expr_get_ast(expression, &(tmp->e)) != 0) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, expression);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, expression);
+		_oph_ioserver_query_free_expr(tmp);
+		return OPH_IO_SERVER_PARSE_ERROR;
+	}
+
+	if (oph_query_expr_create_symtable(&(tmp->table), OPH_QUERY_ENGINE_MAX_PLUGIN_NUMBER)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		_oph_ioserver_query_free_expr(tmp);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+	//Predicates on id_dim translated into the range are not compiled
+	if (mode == OPH_IO_SERVER_EXPR_ID_RANGE && _oph_ioserver_query_get_id_range(&(tmp->e), tmp->table, &(tmp->range))) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, expression);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, expression);
+		_oph_ioserver_query_free_expr(tmp);
+		return OPH_IO_SERVER_EXEC_ERROR;
+	}
+	//The range alone selects the rows, so there is nothing to evaluate
+	if (mode == OPH_IO_SERVER_EXPR_ID_RANGE && tmp->range.found && !tmp->range.residual) {
+		tmp->arg_count = arg_count;
+		tmp->table_num = table_num;
+		_oph_ioserver_query_add_expr(exprs, tmp);
+		*expr = tmp;
+		return OPH_IO_SERVER_SUCCESS;
+	}
+	//Read all variables and link them to input record set fields
+	if (oph_query_expr_get_variables(tmp->e, &(tmp->var_list), &(tmp->var_count))) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, expression);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, expression);
+		_oph_ioserver_query_free_expr(tmp);
+		return OPH_IO_SERVER_EXEC_ERROR;
+	}
+
+	size_t var_num = (tmp->var_count ? tmp->var_count : 1);
+	tmp->field_indexes = (unsigned int *) malloc(var_num * sizeof(unsigned int));
+	tmp->frag_indexes = (int *) malloc(var_num * sizeof(int));
+	tmp->field_binary = (char *) malloc(var_num * sizeof(char));
+	tmp->field_names = (char **) calloc(var_num, sizeof(char *));
+	tmp->frag_names = (char **) calloc(var_num, sizeof(char *));
+	if (!tmp->field_indexes || !tmp->frag_indexes || !tmp->field_binary || !tmp->field_names || !tmp->frag_names) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		_oph_ioserver_query_free_expr(tmp);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+
+	int res = _oph_ioserver_query_resolve_expr(tmp, exprs != NULL, arg_count, inputs, table_num, id_indexes);
+	if (res) {
+		_oph_ioserver_query_free_expr(tmp);
+		return res;
+	}
+
+	if (oph_query_expr_compile(tmp->e, tmp->var_list, tmp->var_count, tmp->table, &(tmp->program))) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, expression);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ENGINE_ERROR, expression);
+		_oph_ioserver_query_free_expr(tmp);
+		return OPH_IO_SERVER_PARSE_ERROR;
+	}
+
+	_oph_ioserver_query_add_expr(exprs, tmp);
+	*expr = tmp;
+
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+int _oph_ioserver_query_release_expr(oph_ioserver_query_expr ** exprs, oph_ioserver_query_expr * expr, char error)
+{
+	if (!expr) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+	//The arena belongs to the execution
+	if (expr->table)
+		expr->table->arena = NULL;
+
+	if (exprs) {
+		if (!error)
+			return OPH_IO_SERVER_SUCCESS;
+		oph_ioserver_query_expr **tmp = exprs;
+		while (*tmp && *tmp != expr)
+			tmp = &((*tmp)->next);
+		if (*tmp)
+			*tmp = expr->next;
+	}
+	_oph_ioserver_query_free_expr(expr);
+
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+int _oph_ioserver_query_destroy_exprs(oph_ioserver_query_expr ** exprs)
+{
+	if (!exprs) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	oph_ioserver_query_expr *tmp = NULL;
+	while (*exprs) {
+		tmp = (*exprs)->next;
+		_oph_ioserver_query_free_expr(*exprs);
+		*exprs = tmp;
+	}
+
+	return OPH_IO_SERVER_SUCCESS;
+}
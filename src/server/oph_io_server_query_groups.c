@@ -0,0 +1,188 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "oph_io_server_query_manager.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <debug.h>
+
+extern int msglevel;
+
+int _oph_ioserver_query_create_group_table(long long row_num, oph_ioserver_group_table ** table)
+{
+	if (row_num <= 0 || row_num > OPH_IO_SERVER_MAX_GROUP_ROWS || !table) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+	*table = NULL;
+
+	oph_ioserver_group_table *tmp = (oph_ioserver_group_table *) calloc(1, sizeof(oph_ioserver_group_table));
+	if (!tmp) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+
+	tmp->row_num = row_num;
+	tmp->group_id = (int *) malloc(row_num * sizeof(int));
+	tmp->long_keys = oph_server_hashmap64_create(OPH_IO_SERVER_GROUP_TABLE_SIZE);
+	tmp->double_keys = oph_server_hashmap64_create(OPH_IO_SERVER_GROUP_TABLE_SIZE);
+	if (!tmp->group_id || !tmp->long_keys || !tmp->double_keys) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		_oph_ioserver_query_destroy_group_table(tmp);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+
+	*table = tmp;
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+int _oph_ioserver_query_add_group_key(oph_ioserver_group_table * table, long long row, oph_query_expr_value_type type, long long long_value, double double_value)
+{
+	if (!table || row < 0 || row >= table->row_num) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	long long key = 0, group = table->group_num;
+	oph_server_hashmap64 *keys = NULL;
+	switch (type) {
+		case OPH_QUERY_EXPR_TYPE_LONG:
+			key = long_value;
+			keys = table->long_keys;
+			break;
+		case OPH_QUERY_EXPR_TYPE_DOUBLE:
+			//Positive and negative zero belong to the same group
+			if (double_value == 0)
+				double_value = 0;
+			memcpy(&key, &double_value, sizeof(long long));
+			keys = table->double_keys;
+			break;
+		default:
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+			return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	switch (oph_server_hashmap64_get_or_insert(keys, key, &group)) {
+		case OPH_SERVER_HASHMAP_SUCCESS:
+			table->group_num++;
+			break;
+		case OPH_SERVER_HASHMAP_KEY_EXISTS:
+			break;
+		default:
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+	table->group_id[row] = (int) group;
+
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+int _oph_ioserver_query_sort_groups(oph_ioserver_group_table * table, oph_ioserver_groups ** groups)
+{
+	if (!table || !groups) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+	*groups = NULL;
+
+	oph_ioserver_groups *tmp = (oph_ioserver_groups *) calloc(1, sizeof(oph_ioserver_groups));
+	if (!tmp) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+	tmp->group_num = table->group_num;
+	tmp->group_start = (long long *) calloc(table->group_num + 1, sizeof(long long));
+	tmp->row_index = (long long *) malloc(table->row_num * sizeof(long long));
+	if (!tmp->group_start || !tmp->row_index) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		_oph_ioserver_query_destroy_groups(tmp);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+
+	long long j, k;
+
+	//Counting sort: rows keep their original order inside each group
+	for (j = 0; j < table->row_num; j++)
+		tmp->group_start[table->group_id[j] + 1]++;
+	for (k = 0; k < table->group_num; k++)
+		tmp->group_start[k + 1] += tmp->group_start[k];
+
+	long long *next = (long long *) malloc((table->group_num ? table->group_num : 1) * sizeof(long long));
+	if (!next) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		_oph_ioserver_query_destroy_groups(tmp);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+	memcpy(next, tmp->group_start, table->group_num * sizeof(long long));
+	for (j = 0; j < table->row_num; j++)
+		tmp->row_index[next[table->group_id[j]]++] = j;
+	free(next);
+
+	*groups = tmp;
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+int _oph_ioserver_query_destroy_group_table(oph_ioserver_group_table * table)
+{
+	if (!table) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	if (table->group_id)
+		free(table->group_id);
+	if (table->long_keys)
+		oph_server_hashmap64_destroy(table->long_keys);
+	if (table->double_keys)
+		oph_server_hashmap64_destroy(table->double_keys);
+	free(table);
+
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+int _oph_ioserver_query_destroy_groups(oph_ioserver_groups * groups)
+{
+	if (!groups) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	if (groups->group_start)
+		free(groups->group_start);
+	if (groups->row_index)
+		free(groups->row_index);
+	free(groups);
+
+	return OPH_IO_SERVER_SUCCESS;
+}
@@ -0,0 +1,302 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "oph_io_server_query_manager.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <debug.h>
+#ifdef OPH_OMP
+#include <omp.h>
+#endif
+
+extern int msglevel;
+
+static inline long long _oph_ioserver_query_join_id(oph_iostore_frag_record_set * rs, short int id_index, long long row)
+{
+	long long id = 0;
+	memcpy(&id, rs->record_set[row]->field[id_index], sizeof(long long));
+	return id;
+}
+
+//Summarize the ids of a fragment: the zone map is used when available, ids are scanned otherwise
+static void _oph_ioserver_query_join_get_zone_map(oph_iostore_frag_record_set * rs, short int id_index, oph_iostore_frag_zone_map * zone_map)
+{
+	if (rs->zone_map.valid && (rs->zone_map.id_index == id_index)) {
+		*zone_map = rs->zone_map;
+		return;
+	}
+
+	long long j, id;
+	memset(zone_map, 0, sizeof(oph_iostore_frag_zone_map));
+	zone_map->id_index = id_index;
+	zone_map->sorted = 1;
+	for (j = 0; rs->record_set && rs->record_set[j]; j++) {
+		id = _oph_ioserver_query_join_id(rs, id_index, j);
+		if (!j)
+			zone_map->min_id = zone_map->max_id = id;
+		else {
+			if (id <= zone_map->max_id)
+				zone_map->sorted = 0;
+			if (id < zone_map->min_id)
+				zone_map->min_id = id;
+			if (id > zone_map->max_id)
+				zone_map->max_id = id;
+		}
+	}
+	zone_map->row_num = j;
+	zone_map->dense = zone_map->sorted && (!j || (zone_map->max_id - zone_map->min_id == j - 1));
+	zone_map->valid = 1;
+}
+
+//Index of the first row in [first, last) with an id greater than (strict = 1) or not less than (strict = 0) the value
+static long long _oph_ioserver_query_join_bound(oph_iostore_frag_record_set * rs, short int id_index, long long first, long long last, long long value, char strict)
+{
+	long long middle, id;
+	while (first < last) {
+		middle = first + (last - first) / 2;
+		id = _oph_ioserver_query_join_id(rs, id_index, middle);
+		if (id < value || (strict && (id == value)))
+			first = middle + 1;
+		else
+			last = middle;
+	}
+	return first;
+}
+
+//Merge the rows [first_row, last_row) of the driver table with the other tables. Matching rows are written from position out_row; return the number of rows joined
+static long long _oph_ioserver_query_merge_chunk(int table_num, short int *id_indexes, oph_iostore_frag_record_set ** stored_rs, oph_iostore_frag_zone_map * zone_maps, long long *first,
+						 long long *last, int driver, long long first_row, long long last_row, long long **join_rows, long long out_row)
+{
+	long long pos[table_num];
+	long long i, id, row_num = 0;
+	int l;
+
+	if (first_row >= last_row)
+		return 0;
+
+	id = _oph_ioserver_query_join_id(stored_rs[driver], id_indexes[driver], first_row);
+	for (l = 0; l < table_num; l++)
+		if ((l != driver) && !zone_maps[l].dense)
+			pos[l] = _oph_ioserver_query_join_bound(stored_rs[l], id_indexes[l], first[l], last[l], id, 0);
+
+	for (i = first_row; i < last_row; i++) {
+		id = _oph_ioserver_query_join_id(stored_rs[driver], id_indexes[driver], i);
+		for (l = 0; l < table_num; l++) {
+			if (l == driver)
+				continue;
+			if (zone_maps[l].dense) {
+				pos[l] = id - zone_maps[l].min_id;
+				continue;
+			}
+			while ((pos[l] < last[l]) && (_oph_ioserver_query_join_id(stored_rs[l], id_indexes[l], pos[l]) < id))
+				pos[l]++;
+			//No more ids to be matched in this table
+			if (pos[l] == last[l])
+				return row_num;
+			if (_oph_ioserver_query_join_id(stored_rs[l], id_indexes[l], pos[l]) != id)
+				break;
+		}
+		if (l < table_num)
+			continue;
+
+		for (l = 0; l < table_num; l++)
+			join_rows[l][out_row + row_num] = (l == driver ? i : pos[l]);
+		row_num++;
+	}
+
+	return row_num;
+}
+
+static int _oph_ioserver_query_merge_join(int table_num, short int *id_indexes, oph_iostore_frag_record_set ** stored_rs, oph_iostore_frag_zone_map * zone_maps, long long min_id, long long max_id,
+					  long long **join_rows, long long *join_row_num)
+{
+	long long first[table_num], last[table_num];
+	int l, driver = 0;
+
+	//The first table is the driver until a table with fewer rows is found
+	first[0] = last[0] = 0;
+
+	//Restrict each table to the rows within the common range of ids
+	for (l = 0; l < table_num; l++) {
+		if (zone_maps[l].dense) {
+			first[l] = min_id - zone_maps[l].min_id;
+			last[l] = max_id - zone_maps[l].min_id + 1;
+		} else {
+			first[l] = _oph_ioserver_query_join_bound(stored_rs[l], id_indexes[l], 0, zone_maps[l].row_num, min_id, 0);
+			last[l] = _oph_ioserver_query_join_bound(stored_rs[l], id_indexes[l], first[l], zone_maps[l].row_num, max_id, 1);
+		}
+		if (last[l] - first[l] < last[driver] - first[driver])
+			driver = l;
+	}
+
+	long long driver_rows = last[driver] - first[driver];
+	if (driver_rows <= 0)
+		return OPH_IO_SERVER_SUCCESS;
+
+	for (l = 0; l < table_num; l++) {
+		if (!(join_rows[l] = (long long *) malloc(driver_rows * sizeof(long long)))) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+			return OPH_IO_SERVER_MEMORY_ERROR;
+		}
+	}
+
+	int thread_num = 1;
+#ifdef OPH_OMP
+	if (driver_rows >= OPH_IO_SERVER_JOIN_PARALLEL_ROWS)
+		thread_num = _oph_ioserver_query_get_thread_num();
+#endif
+
+	if (thread_num == 1) {
+		*join_row_num = _oph_ioserver_query_merge_chunk(table_num, id_indexes, stored_rs, zone_maps, first, last, driver, first[driver], last[driver], join_rows, 0);
+		return OPH_IO_SERVER_SUCCESS;
+	}
+#ifdef OPH_OMP
+	//Each partition of the driver rows writes its results from the position of its first row, then results are compacted
+	long long chunk_rows[thread_num];
+	int t;
+#pragma omp parallel for num_threads(thread_num) schedule(static, 1)
+	for (t = 0; t < thread_num; t++) {
+		long long first_row = first[driver] + driver_rows * t / thread_num, last_row = first[driver] + driver_rows * (t + 1) / thread_num;
+		chunk_rows[t] = _oph_ioserver_query_merge_chunk(table_num, id_indexes, stored_rs, zone_maps, first, last, driver, first_row, last_row, join_rows, first_row - first[driver]);
+	}
+
+	long long row_num = chunk_rows[0];
+	for (t = 1; t < thread_num; t++) {
+		long long out_row = driver_rows * t / thread_num;
+		if (out_row != row_num)
+			for (l = 0; l < table_num; l++)
+				memmove(join_rows[l] + row_num, join_rows[l] + out_row, chunk_rows[t] * sizeof(long long));
+		row_num += chunk_rows[t];
+	}
+	*join_row_num = row_num;
+#endif
+
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+static int _oph_ioserver_query_hash_join(int table_num, short int *id_indexes, oph_iostore_frag_record_set ** stored_rs, oph_iostore_frag_zone_map * zone_maps, long long min_id, long long max_id,
+					 long long **join_rows, long long *join_row_num)
+{
+	oph_server_hashmap64 *maps[table_num];
+	long long j, id, row;
+	int l, res = OPH_IO_SERVER_SUCCESS;
+
+	memset(maps, 0, table_num * sizeof(oph_server_hashmap64 *));
+
+	//Build a map from id to row for each table: the first one drives the output order, so its map is only used to detect duplicate ids
+	for (l = 0; (l < table_num) && !res; l++) {
+		if (!(maps[l] = oph_server_hashmap64_create(zone_maps[l].row_num))) {
+			res = OPH_IO_SERVER_MEMORY_ERROR;
+			break;
+		}
+		for (j = 0; j < zone_maps[l].row_num; j++) {
+			id = _oph_ioserver_query_join_id(stored_rs[l], id_indexes[l], j);
+			if ((id < min_id) || (id > max_id))
+				continue;
+			row = j;
+			if ((res = oph_server_hashmap64_get_or_insert(maps[l], id, &row))) {
+				if (res == OPH_SERVER_HASHMAP_KEY_EXISTS) {
+					pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_ID_MULTITABLE_CONSTRAINT_ERROR, stored_rs[l]->frag_name);
+					logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_ID_MULTITABLE_CONSTRAINT_ERROR, stored_rs[l]->frag_name);
+					res = OPH_IO_SERVER_EXEC_ERROR;
+				} else
+					res = OPH_IO_SERVER_MEMORY_ERROR;
+				break;
+			}
+		}
+	}
+
+	for (l = 0; (l < table_num) && !res; l++)
+		if (!(join_rows[l] = (long long *) malloc(zone_maps[0].row_num * sizeof(long long))))
+			res = OPH_IO_SERVER_MEMORY_ERROR;
+
+	if (res == OPH_IO_SERVER_MEMORY_ERROR) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+	}
+
+	long long row_num = 0;
+	for (j = 0; (j < zone_maps[0].row_num) && !res; j++) {
+		id = _oph_ioserver_query_join_id(stored_rs[0], id_indexes[0], j);
+		if ((id < min_id) || (id > max_id))
+			continue;
+		for (l = 1; l < table_num; l++) {
+			if (oph_server_hashmap64_get(maps[l], id, &row))
+				break;
+			join_rows[l][row_num] = row;
+		}
+		if (l < table_num)
+			continue;
+		join_rows[0][row_num++] = j;
+	}
+	*join_row_num = row_num;
+
+	for (l = 0; l < table_num; l++)
+		if (maps[l])
+			oph_server_hashmap64_destroy(maps[l]);
+
+	return res;
+}
+
+int _oph_ioserver_query_join_tables(int table_num, short int *id_indexes, oph_iostore_frag_record_set ** stored_rs, long long **join_rows, long long *join_row_num)
+{
+	if (!table_num || !id_indexes || !stored_rs || !join_rows || !join_row_num) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	oph_iostore_frag_zone_map zone_maps[table_num];
+	long long min_id = 0, max_id = 0;
+	char sorted = 1;
+	int l;
+
+	*join_row_num = 0;
+	for (l = 0; l < table_num; l++) {
+		join_rows[l] = NULL;
+		_oph_ioserver_query_join_get_zone_map(stored_rs[l], id_indexes[l], zone_maps + l);
+		//Tables without rows or without common ids produce an empty set
+		if (!zone_maps[l].row_num)
+			return OPH_IO_SERVER_SUCCESS;
+		if (!l || (zone_maps[l].min_id > min_id))
+			min_id = zone_maps[l].min_id;
+		if (!l || (zone_maps[l].max_id < max_id))
+			max_id = zone_maps[l].max_id;
+		sorted = sorted && zone_maps[l].sorted;
+	}
+	if (min_id > max_id)
+		return OPH_IO_SERVER_SUCCESS;
+
+	int res = sorted ? _oph_ioserver_query_merge_join(table_num, id_indexes, stored_rs, zone_maps, min_id, max_id, join_rows, join_row_num)
+	    : _oph_ioserver_query_hash_join(table_num, id_indexes, stored_rs, zone_maps, min_id, max_id, join_rows, join_row_num);
+	if (res) {
+		for (l = 0; l < table_num; l++) {
+			if (join_rows[l])
+				free(join_rows[l]);
+			join_rows[l] = NULL;
+		}
+		*join_row_num = 0;
+	}
+
+	return res;
+}
@@ -27,13 +27,14 @@
 #ifdef OPH_IO_SERVER_ESDM
 #include <esdm.h>
 #endif
-#include "hashtbl.h"
+#include "oph_server_hashmap.h"
 #include "oph_io_server_thread.h"
 #include "oph_iostorage_data.h"
 #include "oph_iostorage_interface.h"
 #include "oph_query_parser.h"
 #include "oph_metadb_interface.h"
 #include "oph_query_expression_evaluator.h"
+#include "oph_query_expression_compiler.h"
 
 // error codes
 #define OPH_IO_SERVER_SUCCESS						0
@@ -99,6 +100,7 @@
 #define OPH_IO_SERVER_LOG_ARG_NO_LONG						"Argument %s is not a valid integer\n"
 #define OPH_IO_SERVER_LOG_ORDER_TYPE_ERROR					"Only numeric (int or real) columns can be used for sorting\n"
 #define OPH_IO_SERVER_LOG_ORDER_EXEC_ERROR					"Unable to perform row sorting\n"
+#define OPH_IO_SERVER_LOG_ORDER_DIR_ERROR					"Order direction not valid: %s\n"
 #define OPH_IO_SERVER_LOG_TOO_MANY_GROUPS					"Only one single group clause is supported: %s\n"
 #define OPH_IO_SERVER_LOG_NO_VARIABLE_FOR_GROUP				"At least one variable is required in group by clause: %s\n"
 #define OPH_IO_SERVER_LOG_GROUP_ERROR						"Error interpreting group by clause\n"
@@ -108,8 +110,164 @@
 #define OPH_IO_SERVER_LOG_INVALID_QUERY_VALUE				"%s argument in query is not valid: %s\n"
 #define OPH_IO_SERVER_LOG_MEMORY_NOT_AVAIL_ERROR			"Unable to create fragment in memory. Memory required is: %lld\n"
 
+#define OPH_IO_SERVER_LOG_STMT_NOT_FOUND				"Prepared statement %llu not found\n"
+#define OPH_IO_SERVER_LOG_STMT_EVICTED					"Too many prepared statements: releasing statement %llu\n"
+
 #define OPH_IO_SERVER_BUFFER 1024
 
+//Number of rows assigned at once to each OpenMP thread
+#define OPH_IO_SERVER_PARALLEL_CHUNK 64
+
+extern unsigned short omp_threads;
+//Number of workers currently serving a request (updated atomically by the worker pool)
+extern unsigned int active_workers;
+//Expressions are evaluated row by row when set (used to compare the two evaluation paths)
+extern unsigned short disable_batch_eval;
+
+/**
+ * \brief               Function used to get the number of OpenMP threads of a parallel region: OPENMP_THREADS threads are shared among the workers serving a request
+ * \return              Number of threads to be used (at least 1)
+ */
+static inline int _oph_ioserver_query_get_thread_num()
+{
+	unsigned int workers = __atomic_load_n(&active_workers, __ATOMIC_RELAXED);
+	int thread_num = (int) omp_threads / (int) (workers > 1 ? workers : 1);
+	return thread_num > 1 ? thread_num : 1;
+}
+
+//operation codes (resolved once per query or per prepared statement)
+typedef enum {
+	OPH_IO_SERVER_OP_UNKNOWN = 0,
+	OPH_IO_SERVER_OP_CREATE_FRAG_SELECT,
+	OPH_IO_SERVER_OP_CREATE_FRAG_SELECT_FILE,
+	OPH_IO_SERVER_OP_CREATE_FRAG_SELECT_ESDM,
+	OPH_IO_SERVER_OP_SELECT,
+	OPH_IO_SERVER_OP_INSERT,
+	OPH_IO_SERVER_OP_MULTI_INSERT,
+	OPH_IO_SERVER_OP_FILE_IMPORT,
+	OPH_IO_SERVER_OP_ESDM_IMPORT,
+	OPH_IO_SERVER_OP_RAND_IMPORT,
+	OPH_IO_SERVER_OP_CREATE_FRAG,
+	OPH_IO_SERVER_OP_DROP_FRAG,
+	OPH_IO_SERVER_OP_CREATE_DB,
+	OPH_IO_SERVER_OP_DROP_DB,
+	OPH_IO_SERVER_OP_FUNCTION
+} oph_io_server_operation;
+
+//Initial number of slots of the group hash table (power of 2)
+#define OPH_IO_SERVER_GROUP_TABLE_SIZE 1024
+//Maximum number of rows that can be grouped (group ids are stored as int)
+#define OPH_IO_SERVER_MAX_GROUP_ROWS 2147483647LL
+
+/**
+ * \brief               Hash table used to assign a dense group id to each row
+ * \param row_num       Number of rows to be grouped
+ * \param group_id      Array of group ids (one for each row); groups are numbered by first occurrence
+ * \param group_num     Number of groups found
+ * \param long_keys     Map from long keys to group ids
+ * \param double_keys   Map from bit patterns of double keys to group ids
+ */
+typedef struct {
+	long long row_num;
+	int *group_id;
+	long long group_num;
+	oph_server_hashmap64 *long_keys;
+	oph_server_hashmap64 *double_keys;
+} oph_ioserver_group_table;
+
+//Number of bits of the key sorted by each radix pass
+#define OPH_IO_SERVER_SORT_RADIX_BITS 8
+#define OPH_IO_SERVER_SORT_RADIX_SIZE 256
+//Minimum number of rows sorted with multiple threads
+#define OPH_IO_SERVER_SORT_PARALLEL_ROWS 65536
+//Minimum number of rows joined with multiple threads
+#define OPH_IO_SERVER_JOIN_PARALLEL_ROWS 65536
+
+/**
+ * \brief               Key used to sort rows
+ * \param field         Index of the field to be compared
+ * \param type          Type of the field (OPH_IOSTORE_LONG_TYPE or OPH_IOSTORE_REAL_TYPE)
+ * \param desc          Flag set for descending order
+ */
+typedef struct {
+	int field;
+	oph_iostore_field_type type;
+	char desc;
+} oph_ioserver_sort_key;
+
+/**
+ * \brief               Rows sorted by group: rows of group k are row_index[group_start[k]] ... row_index[group_start[k + 1] - 1], in their original order
+ * \param group_num     Number of groups
+ * \param group_start   Array of group_num + 1 offsets in row_index
+ * \param row_index     Array of row indexes sorted by group
+ */
+typedef struct {
+	long long group_num;
+	long long *group_start;
+	long long *row_index;
+} oph_ioserver_groups;
+
+/**
+ * \brief               Range of id_dim values selected by a where clause: ids from min_id to max_id (included) such that (id - start) is a multiple of step
+ * \param found         Flag set if at least one predicate on id_dim has been recognized
+ * \param residual      Flag set if other predicates have still to be evaluated on each row
+ * \param min_id        Minimum id selected
+ * \param max_id        Maximum id selected
+ * \param start         First id of the stride
+ * \param step          Stride between ids (1 for contiguous ranges)
+ */
+typedef struct {
+	char found;
+	char residual;
+	long long min_id;
+	long long max_id;
+	long long start;
+	long long step;
+} oph_ioserver_id_range;
+
+//Variables of compiled expressions can refer to any field (selection fields) or only to id_dim (where and group by clauses). The id_dim range of a where clause may be extracted before compiling it
+#define OPH_IO_SERVER_EXPR_FIELD 0
+#define OPH_IO_SERVER_EXPR_ID 1
+#define OPH_IO_SERVER_EXPR_ID_RANGE 2
+
+/**
+ * \brief               Expression compiled with its variables resolved to the fields of the input record sets. Expressions of prepared statements are kept between executions
+ * \param expression    Expression string
+ * \param mode          Mode used to resolve variables (OPH_IO_SERVER_EXPR_FIELD, OPH_IO_SERVER_EXPR_ID or OPH_IO_SERVER_EXPR_ID_RANGE)
+ * \param range         Range of id_dim values extracted from the expression (only in mode OPH_IO_SERVER_EXPR_ID_RANGE)
+ * \param e             Syntax tree of the expression (it contains the state of UDFs)
+ * \param table         Symtable of the expression
+ * \param program       Compiled expression
+ * \param var_list      List of variables
+ * \param var_count     Number of variables
+ * \param field_indexes Array of field indexes related to variables
+ * \param frag_indexes  Array of fragment indexes related to variables
+ * \param field_binary  Array of binary flag related to variables
+ * \param field_names   Names of the fields variables are resolved to (only for kept expressions)
+ * \param frag_names    Names of the fragments variables are resolved to (only for kept expressions)
+ * \param arg_count     Number of additional args when variables have been resolved
+ * \param table_num     Number of input record sets when variables have been resolved
+ * \param next          Next expression of the list
+ */
+typedef struct _oph_ioserver_query_expr {
+	char *expression;
+	char mode;
+	oph_ioserver_id_range range;
+	oph_query_expr_node *e;
+	oph_query_expr_symtable *table;
+	oph_query_expr_program *program;
+	char **var_list;
+	int var_count;
+	unsigned int *field_indexes;
+	int *frag_indexes;
+	char *field_binary;
+	char **field_names;
+	char **frag_names;
+	unsigned int arg_count;
+	int table_num;
+	struct _oph_ioserver_query_expr *next;
+} oph_ioserver_query_expr;
+
 //procedures names
 
 #define OPH_IO_SERVER_PROCEDURE_SUBSET "oph_subset"
@@ -125,20 +283,219 @@
  * \param args          Additional query arguments
  * \param query_args    Hash table containing args to be selected
  * \param plugin_table  Hash table with plugin
+ * \param stmt          Prepared statement the query args are bound to (can be NULL)
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, oph_server_hashmap * query_args,
+			     oph_server_hashmap * plugin_table, oph_io_server_prepared_stmt * stmt);
+
+//Prepared statements
+
+/**
+ * \brief               Function used to resolve the operation code of a query
+ * \param query_oper    Operation string of the query
+ * \return              Operation code, OPH_IO_SERVER_OP_UNKNOWN if the operation is not valid
+ */
+oph_io_server_operation oph_io_server_get_operation(const char *query_oper);
+
+/**
+ * \brief               Function used to parse a query once and add it to the prepared statements of the connection. The oldest statement is released when OPH_IO_SERVER_MAX_PREPARED_STMTS is reached
+ * \param thread_status Status of the connection
+ * \param query         Query to be prepared (it will be modified)
+ * \param handle        Handle assigned to the statement
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_prepare_stmt(oph_io_server_thread_status * thread_status, char *query, unsigned long long *handle);
+
+/**
+ * \brief               Function used to get a prepared statement from its handle
+ * \param thread_status Status of the connection
+ * \param handle        Handle of the statement
+ * \param stmt          Statement found
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_find_stmt(oph_io_server_thread_status * thread_status, unsigned long long handle, oph_io_server_prepared_stmt ** stmt);
+
+/**
+ * \brief               Function used to get the args of a single execution of a prepared statement. Since executors modify query args in place, a private copy is kept by the statement and its values are restored at each binding; pre-split insert lists are not copied
+ * \param stmt          Prepared statement
+ * \param query_args    Hash table owned by the statement (it must not be released)
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_bind_stmt(oph_io_server_prepared_stmt * stmt, oph_server_hashmap ** query_args);
+
+/**
+ * \brief               Function used to release a prepared statement
+ * \param thread_status Status of the connection
+ * \param handle        Handle of the statement
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_release_stmt(oph_io_server_thread_status * thread_status, unsigned long long handle);
+
+/**
+ * \brief               Function used to release all the prepared statements of a connection
+ * \param thread_status Status of the connection
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_free_stmts(oph_io_server_thread_status * thread_status);
+
+//Group by engine
+
+/**
+ * \brief               Function used to create a group hash table
+ * \param row_num       Number of rows to be grouped (at most OPH_IO_SERVER_MAX_GROUP_ROWS)
+ * \param table         Table to be created
+ * \return              0 if successfull, non-0 otherwise
+ */
+int _oph_ioserver_query_create_group_table(long long row_num, oph_ioserver_group_table ** table);
+
+/**
+ * \brief               Function used to assign a row to the group related to its key, creating the group if needed
+ * \param table         Group hash table
+ * \param row           Row to be assigned
+ * \param type          Type of the key (OPH_QUERY_EXPR_TYPE_LONG or OPH_QUERY_EXPR_TYPE_DOUBLE)
+ * \param long_value    Key value if type is long
+ * \param double_value  Key value if type is double
+ * \return              0 if successfull, non-0 otherwise
+ */
+int _oph_ioserver_query_add_group_key(oph_ioserver_group_table * table, long long row, oph_query_expr_value_type type, long long long_value, double double_value);
+
+/**
+ * \brief               Function used to sort rows by group id with a counting sort
+ * \param table         Group hash table with all the rows assigned
+ * \param groups        Groups to be created
+ * \return              0 if successfull, non-0 otherwise
+ */
+int _oph_ioserver_query_sort_groups(oph_ioserver_group_table * table, oph_ioserver_groups ** groups);
+
+/**
+ * \brief               Function used to release a group hash table
+ * \param table         Table to be released
+ * \return              0 if successfull, non-0 otherwise
+ */
+int _oph_ioserver_query_destroy_group_table(oph_ioserver_group_table * table);
+
+/**
+ * \brief               Function used to release groups
+ * \param groups        Groups to be released
+ * \return              0 if successfull, non-0 otherwise
+ */
+int _oph_ioserver_query_destroy_groups(oph_ioserver_groups * groups);
+
+//Sort engine
+
+/**
+ * \brief               Function used to sort rows with a stable LSD radix sort. Keys are compared in order, rows already sorted are left untouched
+ * \param record_set    Array of rows to be sorted (it will be modified)
+ * \param row_num       Number of rows
+ * \param keys          Array of sort keys (the first one is the most significant)
+ * \param key_num       Number of sort keys
+ * \return              0 if successfull, non-0 otherwise
+ */
+int _oph_ioserver_query_sort_rows(oph_iostore_frag_record ** record_set, long long row_num, oph_ioserver_sort_key * keys, int key_num);
+
+//Zone map pruning
+
+/**
+ * \brief               Function used to extract id_dim ranges from the top-level conjuncts of a where clause (id_dim = C and oph_is_in_subset(id_dim, start, step, max) with constant arguments).
+ *                      Predicates translated into the range are replaced by the constant 1, the other ones are left unchanged
+ * \param e             Pointer to root of the where clause AST (it may be modified)
+ * \param table         Symtable used to release replaced nodes
+ * \param range         Range extracted
+ * \return              0 if successfull, non-0 otherwise
+ */
+int _oph_ioserver_query_get_id_range(oph_query_expr_node ** e, oph_query_expr_symtable * table, oph_ioserver_id_range * range);
+
+/**
+ * \brief               Function used to find the rows of a fragment whose id is within a range, by direct offset for dense ids or binary search for sorted ids
+ * \param rs            Fragment with a valid and sorted zone map
+ * \param range         Range of ids
+ * \param first_row     Index of the first row in the range
+ * \param row_num       Number of rows from first_row to the last row in the range (0 if no row is selected)
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, HASHTBL * query_args,
-			     HASHTBL * plugin_table);
+int _oph_ioserver_query_get_id_rows(oph_iostore_frag_record_set * rs, oph_ioserver_id_range * range, long long *first_row, long long *row_num);
+
+/**
+ * \brief               Function used to select the rows of a fragment within a range without evaluating any expression
+ * \param stored_rs     Fragment with a valid and sorted zone map
+ * \param range         Range of ids (without residual predicates)
+ * \param input_rs      Record set to be filled with selected rows
+ * \param row_num       Number of rows selected
+ * \return              0 if successfull, non-0 otherwise
+ */
+int _oph_ioserver_query_select_id_range(oph_iostore_frag_record_set * stored_rs, oph_ioserver_id_range * range, oph_iostore_frag_record_set * input_rs, long long *row_num);
+
+//Compiled expressions
+
+/**
+ * \brief               Function used to get an expression compiled with its variables resolved to the fields of the input record sets. When a list of kept expressions is provided,
+ *                      an expression already compiled is reused (its variables are resolved again only if the fields they refer to have moved) and a new one is added to the list
+ * \param exprs         List of expressions kept between executions (can be NULL)
+ * \param expression    Expression string
+ * \param mode          Mode used to resolve variables (OPH_IO_SERVER_EXPR_FIELD, OPH_IO_SERVER_EXPR_ID or OPH_IO_SERVER_EXPR_ID_RANGE)
+ * \param arg_count     Number of additional args used in prepared statements (can be 0)
+ * \param inputs        Input record sets
+ * \param table_num     Number of input record sets
+ * \param id_indexes    Index of id_dim in each input record set (only for modes OPH_IO_SERVER_EXPR_ID and OPH_IO_SERVER_EXPR_ID_RANGE)
+ * \param expr          Expression compiled (to be released with _oph_ioserver_query_release_expr)
+ * \return              0 if successfull, non-0 otherwise
+ */
+int _oph_ioserver_query_get_expr(oph_ioserver_query_expr ** exprs, char *expression, char mode, unsigned int arg_count, oph_iostore_frag_record_set ** inputs, int table_num, short int *id_indexes,
+				 oph_ioserver_query_expr ** expr);
+
+/**
+ * \brief               Function used to release an expression got with _oph_ioserver_query_get_expr: kept expressions are destroyed only if their execution failed, since UDFs may be left in a partial state
+ * \param exprs         List of expressions kept between executions (can be NULL)
+ * \param expr          Expression to be released
+ * \param error         Flag set if the execution of the expression failed
+ * \return              0 if successfull, non-0 otherwise
+ */
+int _oph_ioserver_query_release_expr(oph_ioserver_query_expr ** exprs, oph_ioserver_query_expr * expr, char error);
+
+/**
+ * \brief               Function used to destroy a list of kept expressions
+ * \param exprs         List of expressions to be destroyed
+ * \return              0 if successfull, non-0 otherwise
+ */
+int _oph_ioserver_query_destroy_exprs(oph_ioserver_query_expr ** exprs);
+
+//Join engine
+
+/**
+ * \brief               Function used to join fragments on id_dim (inner join). Ids are matched with a merge-join when they are sorted in every fragment (in parallel over partitions of the rows), with a hash-join otherwise.
+ *                      Rows outside the range of ids shared by all fragments are skipped
+ * \param table_num     Number of fragments
+ * \param id_indexes    Index of id_dim in each fragment
+ * \param stored_rs     Fragments to be joined
+ * \param join_rows     Array of table_num pointers set to the indexes of the rows joined in each fragment (to be freed by the caller, NULL if no row is joined)
+ * \param join_row_num  Number of rows joined
+ * \return              0 if successfull, non-0 otherwise
+ */
+int _oph_ioserver_query_join_tables(int table_num, short int *id_indexes, oph_iostore_frag_record_set ** stored_rs, long long **join_rows, long long *join_row_num);
+
+/**
+ * \brief               Function used to select the rows of one or more fragments (joined on id_dim) that satisfy a where clause
+ * \param where_string  Where clause
+ * \param args          Null terminated list of query arguments (may be NULL)
+ * \param table_num     Number of fragments
+ * \param stored_rs     Fragments to be filtered
+ * \param input_row_num Number of rows of the fragments, set to the number of rows selected
+ * \param input_rs      Record sets (one for each fragment) to be filled with selected rows
+ * \param exprs         List of expressions compiled by previous executions of a prepared statement (can be NULL)
+ * \return              0 if successfull, non-0 otherwise
+ */
+int _oph_ioserver_query_run_where_clause(char *where_string, oph_query_arg ** args, int table_num, oph_iostore_frag_record_set ** stored_rs, long long *input_row_num,
+					 oph_iostore_frag_record_set ** input_rs, oph_ioserver_query_expr ** exprs);
 
 //Internal functions used to execute query main blocks
 
 /**
  * \brief               	Support function used to set variables for expression parser function
  * \param args 				Additional args used in prepared statements (can be NULL)
- * \param var_list    		List of function variables
+ * \param program    		Compiled expression whose variable slots have to be set
  * \param var_count   		Number of function variables
  * \param inputs   			Null terminated list of input record sets
- * \param table 			Symtable related to expression
  * \param field_indexes 	Array of field indexes related to variables
  * \param frag_indexes 		Array of fragment indexes related to variables
  * \param field_binary 		Array of binary flag related to variables
@@ -148,9 +505,64 @@ int oph_io_server_dispatcher(oph_metadb_db_row ** meta_db, oph_iostore_handler *
  * \param where_start_id 	Array used for where starting point (can be null)
  * \return              	0 if successfull, non-0 otherwise
  */
-int _oph_ioserver_query_set_parser_variables(oph_query_arg ** args, char **var_list, unsigned int var_count, oph_iostore_frag_record_set ** inputs, oph_query_expr_symtable * table,
+int _oph_ioserver_query_set_parser_variables(oph_query_arg ** args, oph_query_expr_program * program, unsigned int var_count, oph_iostore_frag_record_set ** inputs,
 					     unsigned int *field_indexes, int *frag_indexes, char *field_binary, oph_query_arg * binary_var, char *field, long long row, long long *where_start_id);
 
+/**
+ * \brief               	Support function used to check if an expression can be evaluated on blocks of rows
+ * \param program    		Compiled expression
+ * \param var_count   		Number of function variables
+ * \param inputs   			Null terminated list of input record sets
+ * \param field_indexes 	Array of field indexes related to variables
+ * \param frag_indexes 		Array of fragment indexes related to variables
+ * \param field_binary 		Array of binary flag related to variables
+ * \return              	1 if the expression can be evaluated on blocks of rows, 0 otherwise
+ */
+int _oph_ioserver_query_is_batchable(oph_query_expr_program * program, unsigned int var_count, oph_iostore_frag_record_set ** inputs, unsigned int *field_indexes, int *frag_indexes,
+				     char *field_binary);
+
+/**
+ * \brief               	Support function used to set the variable columns of a compiled expression for a block of rows
+ * \param program    		Compiled expression whose variable slots have to be set
+ * \param var_count   		Number of function variables
+ * \param inputs   			Null terminated list of input record sets
+ * \param field_indexes 	Array of field indexes related to variables
+ * \param frag_indexes 		Array of fragment indexes related to variables
+ * \param long_columns 		Buffer of var_count * OPH_QUERY_EXPR_BATCH_SIZE values used for long columns (must be already allocated)
+ * \param double_columns 	Buffer of var_count * OPH_QUERY_EXPR_BATCH_SIZE values used for double columns (must be already allocated)
+ * \param field 			Expression being evaluated
+ * \param row 				First input row of the block
+ * \param row_num 			Number of rows of the block (at most OPH_QUERY_EXPR_BATCH_SIZE)
+ * \param where_start_id 	Array used for where starting point (can be null)
+ * \return              	0 if successfull, non-0 otherwise
+ */
+int _oph_ioserver_query_set_parser_columns(oph_query_expr_program * program, unsigned int var_count, oph_iostore_frag_record_set ** inputs, unsigned int *field_indexes, int *frag_indexes,
+					   long long *long_columns, double *double_columns, char *field, long long row, int row_num, long long *where_start_id);
+
+#ifdef OPH_OMP
+/**
+ * \brief               	Support function used to evaluate an expression on a range of rows with OPENMP_THREADS threads. Each thread uses its own syntax tree, so it must not contain aggregating functions
+ * \param expression		Expression to be evaluated
+ * \param args 				Additional args used in prepared statements (can be NULL)
+ * \param var_count   		Number of function variables
+ * \param inputs   			Null terminated list of input record sets
+ * \param field_indexes 	Array of field indexes related to variables
+ * \param frag_indexes 		Array of fragment indexes related to variables
+ * \param field_binary 		Array of binary flag related to variables
+ * \param first_row 		First input row considered
+ * \param row_num 			Number of input rows considered
+ * \param where_start_id 	Array used for where starting point (can be null)
+ * \param output 			Record set where results are stored (can be NULL if selected is given)
+ * \param output_field 		Field of output record set where results are stored
+ * \param first_output_row	Row of output record set where the result of first input row is stored
+ * \param selected			Array of row_num flags set to 1 for rows where the expression is true (can be NULL if output is given)
+ * \return              	0 if successfull, non-0 otherwise
+ */
+int _oph_ioserver_query_run_parallel_expression(char *expression, oph_query_arg ** args, unsigned int var_count, oph_iostore_frag_record_set ** inputs, unsigned int *field_indexes,
+						int *frag_indexes, char *field_binary, long long first_row, long long row_num, long long *where_start_id, oph_iostore_frag_record_set * output,
+						int output_field, long long first_output_row, char *selected);
+#endif
+
 /**
  * \brief               	Support function used to set index of variables used in expression parser
  * \param arg_count 		Number of additional args used in prepared statements (can be 0)
@@ -175,15 +587,15 @@ int _oph_ioserver_query_get_variable_indexes(unsigned int arg_count, char **var_
  * \param limit 		Arg to be filled with limit value
  * \return              0 if successfull, non-0 otherwise
  */
-int _oph_io_server_query_compute_limits(HASHTBL * query_args, long long *offset, long long *limit);
+int _oph_io_server_query_compute_limits(oph_server_hashmap * query_args, long long *offset, long long *limit);
 
 /**
- * \brief               Internal function used to order output recordset (ORDER block)
+ * \brief               Internal function used to order output recordset (ORDER block). Multiple order fields and directions (ASC or DESC) can be given as multi-value args
  * \param query_args    Hash table containing args to be selected
  * \param rs 			Recordset to be sorted (it will be modified)
  * \return              0 if successfull, non-0 otherwise
  */
-int _oph_io_server_query_order_output(HASHTBL * query_args, oph_iostore_frag_record_set * rs);
+int _oph_io_server_query_order_output(oph_server_hashmap * query_args, oph_iostore_frag_record_set * rs);
 
 /**
  * \brief               Internal function used to release memory for input record sets of a query (FROM and WHERE blocks). Used in case of select and create as select. 
@@ -207,11 +619,12 @@ int _oph_ioserver_query_release_input_record_set(oph_iostore_handler * dev_handl
  * \param input_row_num Arg to be filled with total number of rows in filtered recordset 
  * \param input_rs 		Pointer to be filled with list of filtered recordset (null terminated list)
  * \param file_load_flag Flag set to 1 if query contains also data loading from file 
+ * \param exprs         List of expressions compiled by previous executions of a prepared statement (can be NULL)
  * \return              0 if successfull, non-0 otherwise
  */
-int _oph_ioserver_query_build_input_record_set_create(HASHTBL * query_args, oph_query_arg ** args, oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *out_db_name,
+int _oph_ioserver_query_build_input_record_set_create(oph_server_hashmap * query_args, oph_query_arg ** args, oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *out_db_name,
 						      char *out_frag_name, char *current_db, oph_iostore_frag_record_set *** stored_rs, long long *input_row_num,
-						      oph_iostore_frag_record_set *** input_rs, char file_load_flag);
+						      oph_iostore_frag_record_set *** input_rs, char file_load_flag, oph_ioserver_query_expr ** exprs);
 
 /**
  * \brief               Internal function used to select and filter input record set of a query (FROM and WHERE blocks). Used in case of select. 
@@ -223,10 +636,12 @@ int _oph_ioserver_query_build_input_record_set_create(HASHTBL * query_args, oph_
  * \param stored_rs    	Pointer to be filled with list of original stored recordsets (null terminated list)
  * \param input_row_num Arg to be filled with total number of rows in filtered recordset
  * \param input_rs 		Pointer to be filled with list of filtered recordset (null terminated list)
+ * \param exprs         List of expressions compiled by previous executions of a prepared statement (can be NULL)
  * \return              0 if successfull, non-0 otherwise
  */
-int _oph_ioserver_query_build_input_record_set_select(HASHTBL * query_args, oph_query_arg ** args, oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db,
-						      oph_iostore_frag_record_set *** stored_rs, long long *input_row_num, oph_iostore_frag_record_set *** input_rs);
+int _oph_ioserver_query_build_input_record_set_select(oph_server_hashmap * query_args, oph_query_arg ** args, oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db,
+						      oph_iostore_frag_record_set *** stored_rs, long long *input_row_num, oph_iostore_frag_record_set *** input_rs,
+						      oph_ioserver_query_expr ** exprs);
 
 #ifdef OPH_IO_SERVER_NETCDF
 /**
@@ -239,7 +654,7 @@ int _oph_ioserver_query_build_input_record_set_select(HASHTBL * query_args, oph_
  * \param loaded_frag_size 		Size of loaded fragment
  * \return              0 if successfull, non-0 otherwise
  */
-int _oph_io_server_query_load_from_file(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, HASHTBL * query_args, oph_iostore_frag_record_set ** loaded_record_sets,
+int _oph_io_server_query_load_from_file(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_server_hashmap * query_args, oph_iostore_frag_record_set ** loaded_record_sets,
 					unsigned long long *loaded_frag_size);
 #endif
 
@@ -254,7 +669,7 @@ int _oph_io_server_query_load_from_file(oph_metadb_db_row ** meta_db, oph_iostor
  * \param loaded_frag_size 		Size of loaded fragment
  * \return              0 if successfull, non-0 otherwise
  */
-int _oph_io_server_query_load_from_esdm(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, HASHTBL * query_args, oph_iostore_frag_record_set ** loaded_record_sets,
+int _oph_io_server_query_load_from_esdm(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_server_hashmap * query_args, oph_iostore_frag_record_set ** loaded_record_sets,
 					unsigned long long *loaded_frag_size);
 #endif
 
@@ -267,11 +682,29 @@ int _oph_io_server_query_load_from_esdm(oph_metadb_db_row ** meta_db, oph_iostor
  * \param total_row_number 	Total numbers of row to be processed from input
  * \param args 				Additional args used in prepared statements (can be NULL)
  * \param inputs   			Null terminated list of input record sets
+ * \param sources 			Null terminated list of stored record sets owning the cells of inputs, referenced by pass-through columns instead of being copied (can be NULL)
  * \param output 			Output recordset to be filled (must be already allocated)
+ * \param arena 			Query arena used for transient values (can be NULL)
+ * \param exprs 			List of expressions compiled by previous executions of a prepared statement (can be NULL)
  * \return              	0 if successfull, non-0 otherwise
  */
-int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_list, int field_list_num, long long offset, long long total_row_number, oph_query_arg ** args,
-					     oph_iostore_frag_record_set ** inputs, oph_iostore_frag_record_set * output);
+int _oph_ioserver_query_build_select_columns(oph_server_hashmap * query_args, char **field_list, int field_list_num, long long offset, long long total_row_number, oph_query_arg ** args,
+					     oph_iostore_frag_record_set ** inputs, oph_iostore_frag_record_set ** sources, oph_iostore_frag_record_set * output, oph_server_arena * arena,
+					     oph_ioserver_query_expr ** exprs);
+
+/**
+ * \brief               	Internal function used to estimate the size of the cells of an output row to be stored in the slab arena. Used to size the slab of select results.
+ *                          Only columns copied from input record sets are considered (borrowed and shared columns are not stored in the arena), the arena is extended while the other cells are stored
+ * \param query_args    	Hash table containing args to be selected
+ * \param field_list 		List of output fields
+ * \param field_list_num 	Number of output fields
+ * \param inputs 			NULL terminated array of input record sets
+ * \param sources 			Null terminated list of stored record sets owning the cells of inputs, referenced by pass-through columns instead of being copied (can be NULL)
+ * \param row 				Index of the input row to be considered
+ * \return              	Sum of the lengths of the input cells copied in the output row (0 if not available)
+ */
+unsigned long long _oph_ioserver_query_estimate_row_size(oph_server_hashmap * query_args, char **field_list, int field_list_num, oph_iostore_frag_record_set ** inputs,
+							 oph_iostore_frag_record_set ** sources, long long row);
 
 /**
  * \brief               	Internal function used to set column name/alias and default types. Used in case of select or create as select. 
@@ -281,7 +714,7 @@ int _oph_ioserver_query_build_select_columns(HASHTBL * query_args, char **field_
  * \param rs 				Recordset to be filled (must be already allocated)
  * \return              	0 if successfull, non-0 otherwise
  */
-int _oph_ioserver_query_set_column_info(HASHTBL * query_args, char **field_list, int field_list_num, oph_iostore_frag_record_set * rs);
+int _oph_ioserver_query_set_column_info(oph_server_hashmap * query_args, char **field_list, int field_list_num, oph_iostore_frag_record_set * rs);
 
 /**
  * \brief               Internal function used to store the final record set. Used in case of insert and multi-insert. 
@@ -308,6 +741,18 @@ int _oph_ioserver_query_store_fragment(oph_metadb_db_row ** meta_db, oph_iostore
 int _oph_ioserver_query_build_row(unsigned int arg_count, unsigned long long *row_size, oph_iostore_frag_record_set * partial_result_set, char **field_list, char **value_list, oph_query_arg ** args,
 				  oph_iostore_frag_record ** new_record);
 
+/**
+ * \brief               Internal function used to store a row of plain arguments (no UDF) in the slab of a record set. Used in case of uncompressed imports.
+ * \param arg_count     Number of total arguments available (args[i] is stored in i-th field)
+ * \param row_size 		Variable used to save row size
+ * \param partial_result_set 	Pointer with partial recordset being created in the IO server (the slab is attached on first call)
+ * \param args 			Arguments to be stored
+ * \param row 			Index of the row to be set
+ * \param row_num 		Total number of rows of the record set
+ * \return              0 if successfull, non-0 otherwise
+ */
+int _oph_ioserver_query_store_row(unsigned int arg_count, unsigned long long *row_size, oph_iostore_frag_record_set * partial_result_set, oph_query_arg ** args, long long row, long long row_num);
+
 #ifdef OPH_IO_SERVER_NETCDF
 /**
  * \brief Create fragment from NetCDF file
@@ -375,9 +820,12 @@ int _oph_ioserver_rand_data(long long tuplexfrag_number, long long frag_key_star
  * \param current_db 	Name of DB currently selected
  * \param query_args    Hash table containing args to be selected
  * \param args 			Additional args used in prepared statements (can be NULL)
+ * \param arena 		Query arena used for transient allocations (can be NULL)
+ * \param exprs 		List of expressions compiled by previous executions of a prepared statement (can be NULL)
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_io_server_run_create_as_select_table(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, HASHTBL * query_args);
+int oph_io_server_run_create_as_select_table(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, oph_server_hashmap * query_args, oph_server_arena * arena,
+					     oph_ioserver_query_expr ** exprs);
 
 #ifdef OPH_IO_SERVER_NETCDF
 /**
@@ -387,9 +835,12 @@ int oph_io_server_run_create_as_select_table(oph_metadb_db_row ** meta_db, oph_i
  * \param current_db 	Name of DB currently selected
  * \param query_args    Hash table containing args to be selected
  * \param args 			Additional args used in prepared statements (can be NULL)
+ * \param arena 		Query arena used for transient allocations (can be NULL)
+ * \param exprs 		List of expressions compiled by previous executions of a prepared statement (can be NULL)
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_io_server_run_create_as_select_file(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, HASHTBL * query_args);
+int oph_io_server_run_create_as_select_file(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, oph_server_hashmap * query_args, oph_server_arena * arena,
+					    oph_ioserver_query_expr ** exprs);
 #endif
 
 #ifdef OPH_IO_SERVER_ESDM
@@ -400,9 +851,12 @@ int oph_io_server_run_create_as_select_file(oph_metadb_db_row ** meta_db, oph_io
  * \param current_db 	Name of DB currently selected
  * \param query_args    Hash table containing args to be selected
  * \param args 			Additional args used in prepared statements (can be NULL)
+ * \param arena 		Query arena used for transient allocations (can be NULL)
+ * \param exprs 		List of expressions compiled by previous executions of a prepared statement (can be NULL)
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_io_server_run_create_as_select_esdm(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, HASHTBL * query_args);
+int oph_io_server_run_create_as_select_esdm(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, oph_server_hashmap * query_args, oph_server_arena * arena,
+					    oph_ioserver_query_expr ** exprs);
 #endif
 
 /**
@@ -413,9 +867,12 @@ int oph_io_server_run_create_as_select_esdm(oph_metadb_db_row ** meta_db, oph_io
  * \param query_args    Hash table containing args to be selected
  * \param args 			Additional args used in prepared statements (can be NULL)
  * \param output_rs 	Output record set to be filled
+ * \param arena 		Query arena used for transient allocations (can be NULL)
+ * \param exprs 		List of expressions compiled by previous executions of a prepared statement (can be NULL)
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_io_server_run_select(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, HASHTBL * query_args, oph_iostore_frag_record_set ** output_rs);
+int oph_io_server_run_select(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_query_arg ** args, oph_server_hashmap * query_args, oph_iostore_frag_record_set ** output_rs,
+			     oph_server_arena * arena, oph_ioserver_query_expr ** exprs);
 
 /**
  * \brief               Internal function used to execute insert operation 
@@ -425,11 +882,12 @@ int oph_io_server_run_select(oph_metadb_db_row ** meta_db, oph_iostore_handler *
  * \param rs_index 		Record set index used by the record
  * \param query_args    Hash table containing args to be selected
  * \param args 			Additional args used in prepared statements (can be NULL)
+ * \param stmt 			Prepared statement providing pre-split field and value lists (can be NULL)
  * \param size 			Record size
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_io_server_run_insert(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_iostore_frag_record_set * rs, unsigned long long rs_index, oph_query_arg ** args, HASHTBL * query_args,
-			     unsigned long long *size);
+int oph_io_server_run_insert(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_iostore_frag_record_set * rs, unsigned long long rs_index, oph_query_arg ** args, oph_server_hashmap * query_args,
+			     oph_io_server_prepared_stmt * stmt, unsigned long long *size);
 
 /**
  * \brief               Internal function used to execute multi-insert operation 
@@ -438,12 +896,13 @@ int oph_io_server_run_insert(oph_metadb_db_row ** meta_db, oph_iostore_handler *
  * \param thread_status	Pointer to thread structure
  * \param args 			Additional args used in prepared statements (can be NULL)
  * \param query_args    Hash table containing args to be selected
+ * \param stmt 			Prepared statement providing pre-split field and value lists (can be NULL)
  * \param num_insert 	Number of insert performed
  * \param size 			Record size
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_io_server_run_multi_insert(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, HASHTBL * query_args,
-				   unsigned int *num_insert, unsigned long long *size);
+int oph_io_server_run_multi_insert(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, oph_server_hashmap * query_args,
+				   oph_io_server_prepared_stmt * stmt, unsigned int *num_insert, unsigned long long *size);
 
 #ifdef OPH_IO_SERVER_NETCDF
 /**
@@ -454,7 +913,7 @@ int oph_io_server_run_multi_insert(oph_metadb_db_row ** meta_db, oph_iostore_han
  * \param query_args    Hash table containing args to be selected
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_io_server_run_insert_from_file(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, HASHTBL * query_args);
+int oph_io_server_run_insert_from_file(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_server_hashmap * query_args);
 #endif
 
 #ifdef OPH_IO_SERVER_ESDM
@@ -466,7 +925,7 @@ int oph_io_server_run_insert_from_file(oph_metadb_db_row ** meta_db, oph_iostore
  * \param query_args    Hash table containing args to be selected
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_io_server_run_insert_from_esdm(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, HASHTBL * query_args);
+int oph_io_server_run_insert_from_esdm(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_server_hashmap * query_args);
 #endif
 
 /**
@@ -477,7 +936,7 @@ int oph_io_server_run_insert_from_esdm(oph_metadb_db_row ** meta_db, oph_iostore
  * \param query_args    Hash table containing args to be selected
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_io_server_run_random_insert(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, HASHTBL * query_args);
+int oph_io_server_run_random_insert(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_server_hashmap * query_args);
 
 /**
  * \brief               Internal function used to execute create fragment operation 
@@ -488,7 +947,7 @@ int oph_io_server_run_random_insert(oph_metadb_db_row ** meta_db, oph_iostore_ha
  * \param output_rs 	Output record set to be filled
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_io_server_run_create_empty_frag(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, HASHTBL * query_args, oph_iostore_frag_record_set ** output_rs);
+int oph_io_server_run_create_empty_frag(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_server_hashmap * query_args, oph_iostore_frag_record_set ** output_rs);
 
 /**
  * \brief               Internal function used to execute drop fragment operation 
@@ -498,7 +957,7 @@ int oph_io_server_run_create_empty_frag(oph_metadb_db_row ** meta_db, oph_iostor
  * \param query_args    Hash table containing args to be selected
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_io_server_run_drop_frag(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, HASHTBL * query_args);
+int oph_io_server_run_drop_frag(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, char *current_db, oph_server_hashmap * query_args);
 
 /**
  * \brief               Internal function used to execute create database operation 
@@ -507,7 +966,7 @@ int oph_io_server_run_drop_frag(oph_metadb_db_row ** meta_db, oph_iostore_handle
  * \param query_args    Hash table containing args to be selected
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_io_server_run_create_db(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, HASHTBL * query_args);
+int oph_io_server_run_create_db(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_server_hashmap * query_args);
 
 /**
  * \brief               Internal function used to execute drop database operation 
@@ -517,7 +976,7 @@ int oph_io_server_run_create_db(oph_metadb_db_row ** meta_db, oph_iostore_handle
  * \param deleted_db 	Name of DB just deleted
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_io_server_run_drop_db(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, HASHTBL * query_args, char **deleted_db);
+int oph_io_server_run_drop_db(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_server_hashmap * query_args, char **deleted_db);
 
 //Internal server procedures
 /**
@@ -529,7 +988,7 @@ int oph_io_server_run_drop_db(oph_metadb_db_row ** meta_db, oph_iostore_handler
  * \param query_args    Hash table containing args to be selected
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_io_server_run_subset_procedure(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, HASHTBL * query_args);
+int oph_io_server_run_subset_procedure(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, oph_server_hashmap * query_args);
 
 /**
  * \brief               Internal function used to perform export function 
@@ -540,7 +999,7 @@ int oph_io_server_run_subset_procedure(oph_metadb_db_row ** meta_db, oph_iostore
  * \param query_args    Hash table containing args to be selected
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_io_server_run_export_procedure(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, HASHTBL * query_args);
+int oph_io_server_run_export_procedure(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, oph_server_hashmap * query_args);
 
 /**
  * \brief               Internal function used to perform size function 
@@ -551,6 +1010,6 @@ int oph_io_server_run_export_procedure(oph_metadb_db_row ** meta_db, oph_iostore
  * \param query_args    Hash table containing args to be selected
  * \return              0 if successfull, non-0 otherwise
  */
-int oph_io_server_run_size_procedure(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, HASHTBL * query_args);
+int oph_io_server_run_size_procedure(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, oph_server_hashmap * query_args);
 
 #endif				/* OPH_IO_SERVER_QUERY_MANAGER_H */
@@ -34,7 +34,7 @@ extern int msglevel;
 extern pthread_rwlock_t rwlock;
 
 //Procedure OPH_IO_SERVER_PROCEDURE_SUBSET
-int oph_io_server_run_subset_procedure(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, HASHTBL * query_args)
+int oph_io_server_run_subset_procedure(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, oph_server_hashmap * query_args)
 {
 	if (!query_args || !dev_handle || !thread_status || !meta_db) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -49,7 +49,7 @@ int oph_io_server_run_subset_procedure(oph_metadb_db_row ** meta_db, oph_iostore
 		return OPH_IO_SERVER_METADB_ERROR;
 	}
 	//Fetch function arguments
-	char *function_args = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ARG);
+	char *function_args = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ARG);
 	if (function_args == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_ARG);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_ARG);
@@ -200,25 +200,25 @@ int oph_io_server_run_subset_procedure(oph_metadb_db_row ** meta_db, oph_iostore
 	free(func_args_list);
 
 	//Parse internal query
-	HASHTBL *procedure_query_args = NULL;
+	oph_server_hashmap *procedure_query_args = NULL;
 	if (oph_query_parser(new_query, &procedure_query_args)) {
 		pmesg(LOG_WARNING, __FILE__, __LINE__, "Unable to run query\n");
 		logging(LOG_WARNING, __FILE__, __LINE__, "Unable to run query\n");
 	}
 	//Run create as select block
-	if (oph_io_server_run_create_as_select_table(meta_db, dev_handle, thread_status->current_db, args, procedure_query_args)) {
+	if (oph_io_server_run_create_as_select_table(meta_db, dev_handle, thread_status->current_db, args, procedure_query_args, thread_status->query_arena, NULL)) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Create as Select");
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_DISPATCH_ERROR, "Create as Select");
-		hashtbl_destroy(procedure_query_args);
+		oph_server_hashmap_destroy(procedure_query_args);
 		return OPH_IO_SERVER_EXEC_ERROR;
 	}
-	hashtbl_destroy(procedure_query_args);
+	oph_server_hashmap_destroy(procedure_query_args);
 
 	return OPH_IO_SERVER_SUCCESS;
 }
 
 //Function for EXPORTNC
-int oph_io_server_run_export_procedure(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, HASHTBL * query_args)
+int oph_io_server_run_export_procedure(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, oph_server_hashmap * query_args)
 {
 	if (!query_args || !dev_handle || !thread_status || !meta_db) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -243,7 +243,7 @@ int oph_io_server_run_export_procedure(oph_metadb_db_row ** meta_db, oph_iostore
 	thread_status->delete_only_rs = 0;
 
 	//Fetch function arguments
-	char *function_args = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ARG);
+	char *function_args = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ARG);
 	if (function_args == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_ARG);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_ARG);
@@ -266,9 +266,11 @@ int oph_io_server_run_export_procedure(oph_metadb_db_row ** meta_db, oph_iostore
 	}
 	//Add fragment and order id
 	char *fragment = (char *) strndup(func_args_list[0], (strlen(func_args_list[0]) + 1) * sizeof(char));
-	hashtbl_insert(query_args, OPH_QUERY_ENGINE_LANG_ARG_FROM, (char *) fragment);
+	if (oph_server_hashmap_insert(query_args, OPH_QUERY_ENGINE_LANG_ARG_FROM, (char *) fragment))
+		free(fragment);
 	char *id = (char *) strndup(OPH_NAME_ID, (strlen(OPH_NAME_ID) + 1) * sizeof(char));
-	hashtbl_insert(query_args, OPH_QUERY_ENGINE_LANG_ARG_ORDER, (char *) id);
+	if (oph_server_hashmap_insert(query_args, OPH_QUERY_ENGINE_LANG_ARG_ORDER, (char *) id))
+		free(id);
 
 	free(func_args_list);
 
@@ -276,7 +278,7 @@ int oph_io_server_run_export_procedure(oph_metadb_db_row ** meta_db, oph_iostore
 	oph_iostore_frag_record_set **record_sets = NULL;
 	long long row_number = 0;
 
-	if (_oph_ioserver_query_build_input_record_set_select(query_args, args, meta_db, dev_handle, thread_status->current_db, &orig_record_sets, &row_number, &record_sets)) {
+	if (_oph_ioserver_query_build_input_record_set_select(query_args, args, meta_db, dev_handle, thread_status->current_db, &orig_record_sets, &row_number, &record_sets, NULL)) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_SELECTION_ERROR);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_SELECTION_ERROR);
 		return OPH_IO_SERVER_EXEC_ERROR;
@@ -325,7 +327,7 @@ int oph_io_server_run_export_procedure(oph_metadb_db_row ** meta_db, oph_iostore
 }
 
 //Function for CUBESIZE
-int oph_io_server_run_size_procedure(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, HASHTBL * query_args)
+int oph_io_server_run_size_procedure(oph_metadb_db_row ** meta_db, oph_iostore_handler * dev_handle, oph_io_server_thread_status * thread_status, oph_query_arg ** args, oph_server_hashmap * query_args)
 {
 	if (!query_args || !thread_status || !meta_db) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
@@ -347,7 +349,7 @@ int oph_io_server_run_size_procedure(oph_metadb_db_row ** meta_db, oph_iostore_h
 	thread_status->delete_only_rs = 0;
 
 	//Fetch function arguments
-	char *function_args = hashtbl_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ARG);
+	char *function_args = oph_server_hashmap_get(query_args, OPH_QUERY_ENGINE_LANG_ARG_ARG);
 	if (function_args == NULL) {
 		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_ARG);
 		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, OPH_QUERY_ENGINE_LANG_ARG_ARG);
@@ -0,0 +1,219 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "oph_io_server_query_manager.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <debug.h>
+#ifdef OPH_OMP
+#include <omp.h>
+#endif
+
+extern int msglevel;
+
+#define OPH_IO_SERVER_SORT_SIGN_BIT 0x8000000000000000ULL
+
+//Map a key to an unsigned code with the same order: sign bit flipped for long values, all bits flipped for negative double values
+static inline unsigned long long _oph_ioserver_query_sort_code(oph_iostore_frag_record * record, oph_ioserver_sort_key * key)
+{
+	unsigned long long code = 0;
+	if (key->type == OPH_IOSTORE_REAL_TYPE) {
+		double value = 0;
+		memcpy(&value, record->field[key->field], sizeof(double));
+		//Positive and negative zero are equal
+		if (value == 0)
+			value = 0;
+		memcpy(&code, &value, sizeof(unsigned long long));
+		code = (code & OPH_IO_SERVER_SORT_SIGN_BIT) ? ~code : code | OPH_IO_SERVER_SORT_SIGN_BIT;
+	} else {
+		long long value = 0;
+		memcpy(&value, record->field[key->field], sizeof(long long));
+		code = (unsigned long long) value ^ OPH_IO_SERVER_SORT_SIGN_BIT;
+	}
+	return key->desc ? ~code : code;
+}
+
+static int _oph_ioserver_query_is_sorted(oph_iostore_frag_record ** record_set, long long row_num, oph_ioserver_sort_key * keys, int key_num)
+{
+	long long j;
+	int k;
+	unsigned long long a, b;
+	for (j = 1; j < row_num; j++) {
+		for (k = 0; k < key_num; k++) {
+			a = _oph_ioserver_query_sort_code(record_set[j - 1], keys + k);
+			b = _oph_ioserver_query_sort_code(record_set[j], keys + k);
+			if (a < b)
+				break;
+			if (a > b)
+				return 0;
+		}
+	}
+	return 1;
+}
+
+static inline void _oph_ioserver_query_sort_count(unsigned long long *codes, long long first, long long last, int shift, long long *hist)
+{
+	long long j;
+	memset(hist, 0, OPH_IO_SERVER_SORT_RADIX_SIZE * sizeof(long long));
+	for (j = first; j < last; j++)
+		hist[(codes[j] >> shift) & (OPH_IO_SERVER_SORT_RADIX_SIZE - 1)]++;
+}
+
+//Turn the histograms of the threads into scatter offsets (bucket-major, thread-minor to keep the sort stable). Return 1 if all the rows share the same digit
+static int _oph_ioserver_query_sort_offsets(long long *hist, int thread_num, long long row_num)
+{
+	long long offset = 0, count;
+	int b, t;
+	for (b = 0; b < OPH_IO_SERVER_SORT_RADIX_SIZE; b++) {
+		for (t = 0, count = 0; t < thread_num; t++)
+			count += hist[t * OPH_IO_SERVER_SORT_RADIX_SIZE + b];
+		if (count == row_num)
+			return 1;
+		if (count)
+			break;
+	}
+	for (b = 0; b < OPH_IO_SERVER_SORT_RADIX_SIZE; b++) {
+		for (t = 0; t < thread_num; t++) {
+			count = hist[t * OPH_IO_SERVER_SORT_RADIX_SIZE + b];
+			hist[t * OPH_IO_SERVER_SORT_RADIX_SIZE + b] = offset;
+			offset += count;
+		}
+	}
+	return 0;
+}
+
+static inline void _oph_ioserver_query_sort_scatter(unsigned long long *codes, long long *index, long long first, long long last, int shift, long long *offsets, unsigned long long *out_codes,
+						     long long *out_index)
+{
+	long long j, pos;
+	for (j = first; j < last; j++) {
+		pos = offsets[(codes[j] >> shift) & (OPH_IO_SERVER_SORT_RADIX_SIZE - 1)]++;
+		out_codes[pos] = codes[j];
+		out_index[pos] = index[j];
+	}
+}
+
+int _oph_ioserver_query_sort_rows(oph_iostore_frag_record ** record_set, long long row_num, oph_ioserver_sort_key * keys, int key_num)
+{
+	if (!record_set || !keys || key_num <= 0) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	if (row_num < 2 || _oph_ioserver_query_is_sorted(record_set, row_num, keys, key_num))
+		return OPH_IO_SERVER_SUCCESS;
+
+	int thread_num = 1;
+#ifdef OPH_OMP
+	if (row_num >= OPH_IO_SERVER_SORT_PARALLEL_ROWS)
+		thread_num = _oph_ioserver_query_get_thread_num();
+#endif
+
+	unsigned long long *codes = (unsigned long long *) malloc(row_num * sizeof(unsigned long long));
+	unsigned long long *tmp_codes = (unsigned long long *) malloc(row_num * sizeof(unsigned long long));
+	long long *index = (long long *) malloc(row_num * sizeof(long long));
+	long long *tmp_index = (long long *) malloc(row_num * sizeof(long long));
+	long long *hist = (long long *) malloc(thread_num * OPH_IO_SERVER_SORT_RADIX_SIZE * sizeof(long long));
+	oph_iostore_frag_record **sorted = (oph_iostore_frag_record **) malloc(row_num * sizeof(oph_iostore_frag_record *));
+	if (!codes || !tmp_codes || !index || !tmp_index || !hist || !sorted) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		if (codes)
+			free(codes);
+		if (tmp_codes)
+			free(tmp_codes);
+		if (index)
+			free(index);
+		if (tmp_index)
+			free(tmp_index);
+		if (hist)
+			free(hist);
+		if (sorted)
+			free(sorted);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+
+	long long j;
+	int k, shift, skip;
+	unsigned long long *swap_codes;
+	long long *swap_index;
+
+	for (j = 0; j < row_num; j++)
+		index[j] = j;
+
+	//LSD order: the least significant key is sorted first, each stable pass keeps the order of the previous ones
+	for (k = key_num - 1; k >= 0; k--) {
+#ifdef OPH_OMP
+#pragma omp parallel for num_threads(thread_num) schedule(static)
+#endif
+		for (j = 0; j < row_num; j++)
+			codes[j] = _oph_ioserver_query_sort_code(record_set[index[j]], keys + k);
+
+		for (shift = 0; shift < (int) (8 * sizeof(unsigned long long)); shift += OPH_IO_SERVER_SORT_RADIX_BITS) {
+			if (thread_num == 1) {
+				_oph_ioserver_query_sort_count(codes, 0, row_num, shift, hist);
+				if ((skip = _oph_ioserver_query_sort_offsets(hist, 1, row_num)))
+					continue;
+				_oph_ioserver_query_sort_scatter(codes, index, 0, row_num, shift, hist, tmp_codes, tmp_index);
+			}
+#ifdef OPH_OMP
+			else {
+				skip = 0;
+#pragma omp parallel num_threads(thread_num)
+				{
+					int t = omp_get_thread_num(), nt = omp_get_num_threads();
+					long long first = row_num * t / nt, last = row_num * (t + 1) / nt;
+					_oph_ioserver_query_sort_count(codes, first, last, shift, hist + t * OPH_IO_SERVER_SORT_RADIX_SIZE);
+#pragma omp barrier
+#pragma omp single
+					skip = _oph_ioserver_query_sort_offsets(hist, nt, row_num);
+					if (!skip)
+						_oph_ioserver_query_sort_scatter(codes, index, first, last, shift, hist + t * OPH_IO_SERVER_SORT_RADIX_SIZE, tmp_codes, tmp_index);
+				}
+				if (skip)
+					continue;
+			}
+#endif
+
+			swap_codes = codes;
+			codes = tmp_codes;
+			tmp_codes = swap_codes;
+			swap_index = index;
+			index = tmp_index;
+			tmp_index = swap_index;
+		}
+	}
+
+	for (j = 0; j < row_num; j++)
+		sorted[j] = record_set[index[j]];
+	memcpy(record_set, sorted, row_num * sizeof(oph_iostore_frag_record *));
+
+	free(codes);
+	free(tmp_codes);
+	free(index);
+	free(tmp_index);
+	free(hist);
+	free(sorted);
+
+	return OPH_IO_SERVER_SUCCESS;
+}
@@ -0,0 +1,277 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "oph_io_server_query_manager.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <debug.h>
+
+#include "oph_server_utility.h"
+#include "oph_query_engine_language.h"
+
+extern int msglevel;
+
+static void _oph_io_server_destroy_stmt(oph_io_server_prepared_stmt * stmt)
+{
+	if (!stmt)
+		return;
+
+	if (stmt->query_args)
+		oph_server_hashmap_destroy(stmt->query_args);
+	if (stmt->bound_args)
+		oph_server_hashmap_destroy(stmt->bound_args);
+	if (stmt->exprs)
+		_oph_ioserver_query_destroy_exprs(&(stmt->exprs));
+	if (stmt->fields)
+		free(stmt->fields);
+	if (stmt->field_list)
+		free(stmt->field_list);
+	if (stmt->values)
+		free(stmt->values);
+	if (stmt->value_list)
+		free(stmt->value_list);
+	free(stmt);
+}
+
+static int _oph_io_server_split_stmt_arg(oph_server_hashmap * query_args, const char *key, char **buffer, char ***list, int *list_num)
+{
+	char *arg = oph_server_hashmap_get(query_args, key);
+	if (!arg) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, key);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MISSING_QUERY_ARGUMENT, key);
+		return OPH_IO_SERVER_EXEC_ERROR;
+	}
+	//Split a private copy, since the parser modifies its input
+	*buffer = strdup(arg);
+	if (!*buffer) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+	if (oph_query_parse_multivalue_arg(*buffer, list, list_num)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_MULTIVAL_PARSE_ERROR, key);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_MULTIVAL_PARSE_ERROR, key);
+		return OPH_IO_SERVER_EXEC_ERROR;
+	}
+
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+int oph_io_server_prepare_stmt(oph_io_server_thread_status * thread_status, char *query, unsigned long long *handle)
+{
+	if (!thread_status || !query || !handle) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	*handle = 0;
+
+	oph_io_server_prepared_stmt *stmt = (oph_io_server_prepared_stmt *) calloc(1, sizeof(oph_io_server_prepared_stmt));
+	if (!stmt) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+
+	if (oph_query_parser(query, &stmt->query_args)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, query);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_PARSING_ERROR, query);
+		_oph_io_server_destroy_stmt(stmt);
+		return OPH_IO_SERVER_PARSE_ERROR;
+	}
+
+	char *query_oper = oph_server_hashmap_get(stmt->query_args, OPH_QUERY_ENGINE_LANG_OPERATION);
+	stmt->operation = oph_io_server_get_operation(query_oper);
+	if (stmt->operation == OPH_IO_SERVER_OP_UNKNOWN) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_OPERATION_UNKNOWN, query_oper ? query_oper : "");
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_OPERATION_UNKNOWN, query_oper ? query_oper : "");
+		_oph_io_server_destroy_stmt(stmt);
+		return OPH_IO_SERVER_PARSE_ERROR;
+	}
+	//Field and value lists of inserts are split once for all the runs
+	if (stmt->operation == OPH_IO_SERVER_OP_INSERT || stmt->operation == OPH_IO_SERVER_OP_MULTI_INSERT) {
+		if (_oph_io_server_split_stmt_arg(stmt->query_args, OPH_QUERY_ENGINE_LANG_ARG_FIELD, &stmt->fields, &stmt->field_list, &stmt->field_list_num)
+		    || _oph_io_server_split_stmt_arg(stmt->query_args, OPH_QUERY_ENGINE_LANG_ARG_VALUE, &stmt->values, &stmt->value_list, &stmt->value_list_num)) {
+			_oph_io_server_destroy_stmt(stmt);
+			return OPH_IO_SERVER_PARSE_ERROR;
+		}
+	}
+	//Release the oldest statement when the limit is reached
+	if (thread_status->prepared_stmt_num >= OPH_IO_SERVER_MAX_PREPARED_STMTS) {
+		oph_io_server_prepared_stmt *oldest = thread_status->prepared_stmts;
+		while (oldest && oldest->next)
+			oldest = oldest->next;
+		if (oldest) {
+			pmesg(LOG_WARNING, __FILE__, __LINE__, OPH_IO_SERVER_LOG_STMT_EVICTED, oldest->handle);
+			oph_io_server_release_stmt(thread_status, oldest->handle);
+		}
+	}
+
+	stmt->handle = ++thread_status->last_stmt_handle;
+	stmt->next = thread_status->prepared_stmts;
+	thread_status->prepared_stmts = stmt;
+	thread_status->prepared_stmt_num++;
+
+	*handle = stmt->handle;
+
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+int oph_io_server_find_stmt(oph_io_server_thread_status * thread_status, unsigned long long handle, oph_io_server_prepared_stmt ** stmt)
+{
+	if (!thread_status || !stmt) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	oph_io_server_prepared_stmt *tmp = NULL;
+	for (tmp = thread_status->prepared_stmts; tmp; tmp = tmp->next)
+		if (tmp->handle == handle)
+			break;
+
+	*stmt = tmp;
+	if (!tmp) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_STMT_NOT_FOUND, handle);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_STMT_NOT_FOUND, handle);
+		return OPH_IO_SERVER_ERROR;
+	}
+
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+int oph_io_server_bind_stmt(oph_io_server_prepared_stmt * stmt, oph_server_hashmap ** query_args)
+{
+	if (!stmt || !stmt->query_args || !query_args) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	*query_args = NULL;
+
+	unsigned long long iter = 0;
+	const char *key = NULL;
+	void *value = NULL;
+	char *data = NULL;
+
+	//Pre-split lists are used in place of field and value args
+	unsigned long long arg_num = stmt->query_args->count - (stmt->value_list ? 2 : 0);
+
+	//Executors only split args by writing into them, so the previous values are restored in place
+	if (stmt->bound_args && stmt->bound_args->count == arg_num) {
+		char restored = 1;
+		while (restored && oph_server_hashmap_next(stmt->query_args, &iter, &key, &value)) {
+			if (stmt->value_list && (!strcmp(key, OPH_QUERY_ENGINE_LANG_ARG_FIELD) || !strcmp(key, OPH_QUERY_ENGINE_LANG_ARG_VALUE)))
+				continue;
+			if ((data = oph_server_hashmap_get(stmt->bound_args, key)))
+				memcpy(data, value, strlen((char *) value) + 1);
+			else
+				restored = 0;
+		}
+		if (restored) {
+			*query_args = stmt->bound_args;
+			return OPH_IO_SERVER_SUCCESS;
+		}
+	}
+	//Args have been added by an execution (or this is the first binding): build them again
+	if (stmt->bound_args) {
+		oph_server_hashmap_destroy(stmt->bound_args);
+		stmt->bound_args = NULL;
+	}
+
+	stmt->bound_args = oph_server_hashmap_create(stmt->query_args->count, stmt->query_args->flags);
+	if (!stmt->bound_args) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_HASHTBL_CREATE_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_HASHTBL_CREATE_ERROR);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+
+	iter = 0;
+	while (oph_server_hashmap_next(stmt->query_args, &iter, &key, &value)) {
+		if (stmt->value_list && (!strcmp(key, OPH_QUERY_ENGINE_LANG_ARG_FIELD) || !strcmp(key, OPH_QUERY_ENGINE_LANG_ARG_VALUE)))
+			continue;
+		data = strdup((char *) value);
+		if (!data || oph_server_hashmap_insert(stmt->bound_args, key, data)) {
+			pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ARG_LOAD_ERROR);
+			logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_QUERY_ARG_LOAD_ERROR);
+			if (data)
+				free(data);
+			oph_server_hashmap_destroy(stmt->bound_args);
+			stmt->bound_args = NULL;
+			return OPH_IO_SERVER_MEMORY_ERROR;
+		}
+	}
+
+	*query_args = stmt->bound_args;
+
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+int oph_io_server_release_stmt(oph_io_server_thread_status * thread_status, unsigned long long handle)
+{
+	if (!thread_status) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	oph_io_server_prepared_stmt *tmp = thread_status->prepared_stmts, *prev = NULL;
+	while (tmp && tmp->handle != handle) {
+		prev = tmp;
+		tmp = tmp->next;
+	}
+	if (!tmp) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_STMT_NOT_FOUND, handle);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_STMT_NOT_FOUND, handle);
+		return OPH_IO_SERVER_ERROR;
+	}
+
+	if (prev)
+		prev->next = tmp->next;
+	else
+		thread_status->prepared_stmts = tmp->next;
+	thread_status->prepared_stmt_num--;
+	_oph_io_server_destroy_stmt(tmp);
+
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+int oph_io_server_free_stmts(oph_io_server_thread_status * thread_status)
+{
+	if (!thread_status) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	oph_io_server_prepared_stmt *tmp = NULL;
+	while (thread_status->prepared_stmts) {
+		tmp = thread_status->prepared_stmts->next;
+		_oph_io_server_destroy_stmt(thread_status->prepared_stmts);
+		thread_status->prepared_stmts = tmp;
+	}
+	thread_status->prepared_stmt_num = 0;
+
+	return OPH_IO_SERVER_SUCCESS;
+}
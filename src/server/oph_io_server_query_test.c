@@ -0,0 +1,1032 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "oph_io_server_query_manager.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "oph_server_utility.h"
+#include "oph_query_engine_language.h"
+#include "oph_query_parser.h"
+#include "oph_query_plugin_loader.h"
+
+//Global server variables used by the query engine
+unsigned long long max_packet_length = 0;
+unsigned short omp_threads = 4;
+unsigned int active_workers = 0;
+unsigned short client_ttl = 0;
+unsigned short disable_mem_check = 1;
+unsigned short disable_batch_eval = 0;
+unsigned long long memory_buffer = 0;
+unsigned short cache_line_size = 0;
+unsigned long long cache_size = 0;
+pthread_rwlock_t rwlock = PTHREAD_RWLOCK_INITIALIZER;
+pthread_mutex_t libtool_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t nc_lock = PTHREAD_MUTEX_INITIALIZER;
+oph_server_hashmap *plugin_table = NULL;
+oph_query_expr_symtable *oph_function_table = NULL;
+
+//Large record sets are sorted and joined with multiple threads
+#define OPH_IO_SERVER_QUERY_TEST_RUNS		40
+#define OPH_IO_SERVER_QUERY_TEST_LARGE_ROWS	100000
+#define OPH_IO_SERVER_QUERY_TEST_SMALL_ROWS	300
+
+static unsigned long long _oph_io_server_query_test_seed = 1;
+
+static long long _oph_io_server_query_test_rand(long long max)
+{
+	_oph_io_server_query_test_seed = _oph_io_server_query_test_seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return (long long) ((_oph_io_server_query_test_seed >> 33) % (unsigned long long) max);
+}
+
+//Create a fragment whose first field is id_dim
+static oph_iostore_frag_record_set *_oph_io_server_query_test_fragment(long long row_num, long long *ids)
+{
+	oph_iostore_frag_record_set *rs = NULL;
+	if (oph_iostore_create_frag_recordset_slab(&rs, row_num, 2, 0, 0))
+		return NULL;
+	rs->frag_name = strdup("frag");
+	rs->field_name[0] = strdup(OPH_NAME_ID);
+	rs->field_name[1] = strdup(OPH_NAME_MEASURE);
+	rs->field_type[0] = OPH_IOSTORE_LONG_TYPE;
+	rs->field_type[1] = OPH_IOSTORE_LONG_TYPE;
+
+	long long j;
+	for (j = 0; j < row_num; j++)
+		if (oph_iostore_set_frag_cell(rs, j, 0, ids + j, sizeof(long long)) || oph_iostore_set_frag_cell(rs, j, 1, &j, sizeof(long long))) {
+			oph_iostore_destroy_frag_recordset(&rs);
+			return NULL;
+		}
+	oph_iostore_update_frag_zone_map(rs);
+
+	return rs;
+}
+
+//Sort
+
+typedef struct {
+	oph_iostore_frag_record *record;
+	long long position;
+} oph_io_server_query_test_item;
+
+static oph_ioserver_sort_key *_oph_io_server_query_test_keys = NULL;
+static int _oph_io_server_query_test_key_num = 0;
+
+//Reference order: keys compared as numbers, ties broken by the original position
+static int _oph_io_server_query_test_compare(const void *a, const void *b)
+{
+	const oph_io_server_query_test_item *x = (const oph_io_server_query_test_item *) a, *y = (const oph_io_server_query_test_item *) b;
+	int k, field, res;
+	for (k = 0; k < _oph_io_server_query_test_key_num; k++) {
+		field = _oph_io_server_query_test_keys[k].field;
+		if (_oph_io_server_query_test_keys[k].type == OPH_IOSTORE_REAL_TYPE) {
+			double u = *((double *) x->record->field[field]), v = *((double *) y->record->field[field]);
+			res = (u > v) - (u < v);
+		} else {
+			long long u = *((long long *) x->record->field[field]), v = *((long long *) y->record->field[field]);
+			res = (u > v) - (u < v);
+		}
+		if (res)
+			return _oph_io_server_query_test_keys[k].desc ? -res : res;
+	}
+	return (x->position > y->position) - (x->position < y->position);
+}
+
+static int _oph_io_server_query_test_sort()
+{
+	oph_ioserver_sort_key keys[3] = { {0, OPH_IOSTORE_LONG_TYPE, 1}, {1, OPH_IOSTORE_REAL_TYPE, 0}, {2, OPH_IOSTORE_LONG_TYPE, 1} };
+	long long row_nums[2] = { OPH_IO_SERVER_QUERY_TEST_SMALL_ROWS, OPH_IO_SERVER_QUERY_TEST_LARGE_ROWS }, row_num, j;
+	int r, key_num, res = 0;
+	oph_iostore_frag_record_set *rs = NULL;
+	oph_iostore_frag_record **rows = NULL;
+	oph_io_server_query_test_item *items = NULL;
+
+	for (r = 0; !res && r < 2; r++) {
+		row_num = row_nums[r];
+		rows = (oph_iostore_frag_record **) malloc((row_num + 1) * sizeof(oph_iostore_frag_record *));
+		items = (oph_io_server_query_test_item *) malloc(row_num * sizeof(oph_io_server_query_test_item));
+		if (!rows || !items || oph_iostore_create_frag_recordset_slab(&rs, row_num, 3, -1, 0)) {
+			fprintf(stderr, "Unable to allocate rows to be sorted\n");
+			res = 1;
+			break;
+		}
+		//Few distinct values of the first key, signed zeros and large values of opposite sign
+		for (j = 0; !res && j < row_num; j++) {
+			long long long_value = _oph_io_server_query_test_rand(50) - 25, large_value = (_oph_io_server_query_test_rand(1LL << 40) - (1LL << 39)) * (1LL << 20);
+			double real_value = (j % 97 ? (_oph_io_server_query_test_rand(2000) - 1000) / 7.0 : (j % 2 ? -0.0 : 0.0));
+			res = oph_iostore_set_frag_cell(rs, j, 0, &long_value, sizeof(long long)) || oph_iostore_set_frag_cell(rs, j, 1, &real_value, sizeof(double))
+			    || oph_iostore_set_frag_cell(rs, j, 2, &large_value, sizeof(long long));
+		}
+		for (key_num = 1; !res && key_num <= 3; key_num++) {
+			for (j = 0; j < row_num; j++) {
+				rows[j] = items[j].record = rs->record_set[(j * 7919) % row_num];
+				items[j].position = j;
+			}
+			rows[row_num] = NULL;
+			_oph_io_server_query_test_keys = keys;
+			_oph_io_server_query_test_key_num = key_num;
+			qsort(items, row_num, sizeof(oph_io_server_query_test_item), _oph_io_server_query_test_compare);
+
+			if (_oph_ioserver_query_sort_rows(rows, row_num, keys, key_num)) {
+				fprintf(stderr, "Unable to sort %lld rows\n", row_num);
+				res = 1;
+			}
+			for (j = 0; !res && j < row_num; j++)
+				if (rows[j] != items[j].record) {
+					fprintf(stderr, "Wrong order of %lld rows sorted by %d keys at row %lld\n", row_num, key_num, j);
+					res = 1;
+				}
+			//Sorting again has to leave rows unchanged
+			if (!res && _oph_ioserver_query_sort_rows(rows, row_num, keys, key_num))
+				res = 1;
+			for (j = 0; !res && j < row_num; j++)
+				if (rows[j] != items[j].record) {
+					fprintf(stderr, "Sorted rows changed by a second sort\n");
+					res = 1;
+				}
+		}
+		if (rs)
+			oph_iostore_destroy_frag_recordset(&rs);
+		if (rows)
+			free(rows);
+		if (items)
+			free(items);
+		rows = NULL;
+		items = NULL;
+	}
+
+	return res;
+}
+
+//Group by
+
+typedef struct {
+	oph_query_expr_value_type type;
+	long long long_value;
+	double double_value;
+} oph_io_server_query_test_key;
+
+//Keys are equal if they have the same type and value (positive and negative zero are equal)
+static int _oph_io_server_query_test_same_key(oph_io_server_query_test_key * x, oph_io_server_query_test_key * y)
+{
+	if (x->type != y->type)
+		return 0;
+	return x->type == OPH_QUERY_EXPR_TYPE_LONG ? x->long_value == y->long_value : x->double_value == y->double_value;
+}
+
+//Groups have to be numbered by first occurrence of their keys and rows have to keep their original order inside each group
+static int _oph_io_server_query_test_check_groups(oph_io_server_query_test_key * keys, long long row_num, long long expected_group_num)
+{
+	oph_ioserver_group_table *table = NULL;
+	oph_ioserver_groups *groups = NULL;
+	long long *first_rows = (long long *) malloc(row_num * sizeof(long long)), group_num = 0, j, k, g;
+	int res = 0;
+
+	if (!first_rows || _oph_ioserver_query_create_group_table(row_num, &table)) {
+		fprintf(stderr, "Unable to create a group table of %lld rows\n", row_num);
+		res = 1;
+	}
+	for (j = 0; !res && j < row_num; j++)
+		if (_oph_ioserver_query_add_group_key(table, j, keys[j].type, keys[j].long_value, keys[j].double_value)) {
+			fprintf(stderr, "Unable to group row %lld\n", j);
+			res = 1;
+		}
+	if (!res && _oph_ioserver_query_sort_groups(table, &groups)) {
+		fprintf(stderr, "Unable to sort %lld rows by group\n", row_num);
+		res = 1;
+	}
+
+	for (j = 0; !res && j < row_num; j++) {
+		for (g = 0; g < group_num; g++)
+			if (_oph_io_server_query_test_same_key(keys + first_rows[g], keys + j))
+				break;
+		if (g == group_num)
+			first_rows[group_num++] = j;
+		if (table->group_id[j] != g) {
+			fprintf(stderr, "Row %lld assigned to group %d instead of %lld\n", j, table->group_id[j], g);
+			res = 1;
+		}
+	}
+	if (!res && (table->group_num != group_num || groups->group_num != group_num || (expected_group_num && group_num != expected_group_num))) {
+		fprintf(stderr, "%lld groups found in %lld rows instead of %lld\n", groups->group_num, row_num, group_num);
+		res = 1;
+	}
+	for (k = 0, j = 0; !res && k < group_num; k++) {
+		if (groups->group_start[k] != j || groups->row_index[j] != first_rows[k]) {
+			fprintf(stderr, "Group %lld does not start with its first row\n", k);
+			res = 1;
+		}
+		for (j = groups->group_start[k]; !res && j < groups->group_start[k + 1]; j++)
+			if (table->group_id[groups->row_index[j]] != k || (j > groups->group_start[k] && groups->row_index[j] <= groups->row_index[j - 1])) {
+				fprintf(stderr, "Row %lld out of order in group %lld\n", groups->row_index[j], k);
+				res = 1;
+			}
+	}
+	if (!res && groups->group_start[group_num] != row_num) {
+		fprintf(stderr, "%lld rows sorted by group instead of %lld\n", groups->group_start[group_num], row_num);
+		res = 1;
+	}
+
+	if (groups)
+		_oph_ioserver_query_destroy_groups(groups);
+	if (table)
+		_oph_ioserver_query_destroy_group_table(table);
+	if (first_rows)
+		free(first_rows);
+
+	return res;
+}
+
+static int _oph_io_server_query_test_groups()
+{
+	long long row_nums[2] = { OPH_IO_SERVER_QUERY_TEST_SMALL_ROWS, OPH_IO_SERVER_QUERY_TEST_LARGE_ROWS }, row_num, j;
+	oph_io_server_query_test_key *keys = (oph_io_server_query_test_key *) calloc(OPH_IO_SERVER_QUERY_TEST_LARGE_ROWS, sizeof(oph_io_server_query_test_key));
+	int r, run, res = 0;
+
+	if (!keys)
+		return 1;
+
+	//Long and double keys with the same value, positive and negative zero
+	oph_io_server_query_test_key mixed[8] = { {OPH_QUERY_EXPR_TYPE_DOUBLE, 0, -0.0}, {OPH_QUERY_EXPR_TYPE_LONG, 3, 0}, {OPH_QUERY_EXPR_TYPE_DOUBLE, 0, 3.0},
+	{OPH_QUERY_EXPR_TYPE_LONG, 0, 0}, {OPH_QUERY_EXPR_TYPE_DOUBLE, 0, 0.0}, {OPH_QUERY_EXPR_TYPE_LONG, 3, 0}, {OPH_QUERY_EXPR_TYPE_DOUBLE, 0, 3.0},
+	{OPH_QUERY_EXPR_TYPE_LONG, 0, 0}
+	};
+	res |= _oph_io_server_query_test_check_groups(mixed, 8, 4);
+
+	//A single group and all rows in different groups (the table grows beyond its initial size)
+	for (r = 0; !res && r < 2; r++) {
+		row_num = row_nums[r];
+		for (j = 0; j < row_num; j++) {
+			keys[j].type = OPH_QUERY_EXPR_TYPE_LONG;
+			keys[j].long_value = 7;
+		}
+		res |= _oph_io_server_query_test_check_groups(keys, row_num, 1);
+		for (j = 0; j < row_num; j++) {
+			keys[j].type = (j % 2 ? OPH_QUERY_EXPR_TYPE_DOUBLE : OPH_QUERY_EXPR_TYPE_LONG);
+			keys[j].long_value = row_num - j;
+			keys[j].double_value = (double) j / 2;
+		}
+		res |= _oph_io_server_query_test_check_groups(keys, row_num, row_num);
+	}
+
+	//Random keys of both types
+	for (run = 0; !res && run < OPH_IO_SERVER_QUERY_TEST_RUNS; run++) {
+		row_num = (run % 5 ? 1 + _oph_io_server_query_test_rand(OPH_IO_SERVER_QUERY_TEST_SMALL_ROWS) : OPH_IO_SERVER_QUERY_TEST_LARGE_ROWS);
+		for (j = 0; j < row_num; j++) {
+			keys[j].type = (_oph_io_server_query_test_rand(2) ? OPH_QUERY_EXPR_TYPE_DOUBLE : OPH_QUERY_EXPR_TYPE_LONG);
+			keys[j].long_value = _oph_io_server_query_test_rand(21) - 10;
+			keys[j].double_value = (double) keys[j].long_value / 4;
+			if (!keys[j].long_value && _oph_io_server_query_test_rand(2))
+				keys[j].double_value = -0.0;
+		}
+		res |= _oph_io_server_query_test_check_groups(keys, row_num, 0);
+	}
+
+	free(keys);
+
+	return res;
+}
+
+//Zone map pruning
+
+//The start of the range is checked only for strides
+static int _oph_io_server_query_test_id_range(const char *where, char found, char residual, long long min_id, long long max_id, long long start, long long step)
+{
+	oph_query_expr_node *e = NULL;
+	oph_query_expr_symtable *table = NULL;
+	oph_ioserver_id_range range;
+	int res = 0;
+
+	if (oph_query_expr_create_symtable(&table, OPH_QUERY_ENGINE_MAX_PLUGIN_NUMBER) || oph_query_expr_get_ast(where, &e) || _oph_ioserver_query_get_id_range(&e, table, &range)) {
+		fprintf(stderr, "Unable to extract id range from '%s'\n", where);
+		res = 1;
+	} else if (range.found != found || (found && (range.residual != residual || range.min_id != min_id || range.max_id != max_id || range.step != step || (step > 1 && range.start != start)))) {
+		fprintf(stderr, "Wrong id range extracted from '%s': found %d, residual %d, ids %lld-%lld, start %lld, step %lld\n", where, range.found, range.residual, range.min_id, range.max_id,
+			range.start, range.step);
+		res = 1;
+	}
+
+	if (e)
+		oph_query_expr_delete_node(e, table);
+	if (table)
+		oph_query_expr_destroy_symtable(table);
+
+	return res;
+}
+
+static int _oph_io_server_query_test_zone()
+{
+	int res = 0, run;
+
+	//Predicates on id_dim found in the top-level conjuncts of a where clause
+	res |= _oph_io_server_query_test_id_range("id_dim = 5", 1, 0, 5, 5, 0, 1);
+	res |= _oph_io_server_query_test_id_range("-4 = id_dim", 1, 0, -4, -4, 0, 1);
+	res |= _oph_io_server_query_test_id_range("oph_is_in_subset(id_dim, 3, 2, 21)", 1, 0, 3, 21, 3, 2);
+	res |= _oph_io_server_query_test_id_range("id_dim = 5 AND measure = 2", 1, 1, 5, 5, 0, 1);
+	res |= _oph_io_server_query_test_id_range("oph_is_in_subset(id_dim, 1, 2, 9) AND oph_is_in_subset(id_dim, 3, 3, 30)", 1, 1, 3, 9, 0, 1);
+	res |= _oph_io_server_query_test_id_range("measure = 1", 0, 0, 0, 0, 0, 0);
+	res |= _oph_io_server_query_test_id_range("id_dim = 5 | measure = 1", 0, 0, 0, 0, 0, 0);
+
+	//Rows selected with the zone map compared with a scan of the whole fragment
+	for (run = 0; !res && run < OPH_IO_SERVER_QUERY_TEST_RUNS; run++) {
+		long long row_num = 1 + _oph_io_server_query_test_rand(OPH_IO_SERVER_QUERY_TEST_SMALL_ROWS), first_id = _oph_io_server_query_test_rand(100) - 50, j, id, selected = 0, expected = 0;
+		long long *ids = (long long *) malloc(row_num * sizeof(long long));
+		oph_iostore_frag_record_set *rs = NULL, *input_rs = NULL;
+		if (!ids) {
+			res = 1;
+			break;
+		}
+		//Dense or sorted with gaps
+		char dense = run % 2;
+		for (j = 0, id = first_id; j < row_num; j++, id += (dense ? 1 : 1 + _oph_io_server_query_test_rand(4)))
+			ids[j] = id;
+		oph_ioserver_id_range range;
+		range.found = 1;
+		range.residual = 0;
+		range.min_id = first_id + _oph_io_server_query_test_rand(row_num + 20) - 10;
+		range.max_id = _oph_io_server_query_test_rand(5) ? range.min_id + _oph_io_server_query_test_rand(2 * row_num) : LLONG_MAX;
+		range.start = range.min_id + _oph_io_server_query_test_rand(3);
+		range.step = 1 + _oph_io_server_query_test_rand(5);
+		if (range.step == 1)
+			range.start = range.min_id;
+
+		if (!(rs = _oph_io_server_query_test_fragment(row_num, ids)) || oph_iostore_create_frag_recordset_only(&input_rs, row_num, 2)
+		    || !rs->zone_map.valid || !rs->zone_map.sorted || _oph_ioserver_query_select_id_range(rs, &range, input_rs, &selected)) {
+			fprintf(stderr, "Unable to select rows with the zone map\n");
+			res = 1;
+		}
+		for (j = 0; !res && j < row_num; j++)
+			if ((ids[j] >= range.min_id) && (ids[j] <= range.max_id) && !((ids[j] - range.start) % range.step)) {
+				if ((expected >= selected) || (input_rs->record_set[expected] != rs->record_set[j])) {
+					fprintf(stderr, "Row with id %lld not selected by range %lld-%lld (start %lld, step %lld)\n", ids[j], range.min_id, range.max_id, range.start, range.step);
+					res = 1;
+				}
+				expected++;
+			}
+		if (!res && (expected != selected)) {
+			fprintf(stderr, "%lld rows selected instead of %lld\n", selected, expected);
+			res = 1;
+		}
+
+		if (input_rs)
+			oph_iostore_destroy_frag_recordset_only(&input_rs);
+		if (rs)
+			oph_iostore_destroy_frag_recordset(&rs);
+		free(ids);
+	}
+
+	return res;
+}
+
+//Batch evaluation
+
+//Row counts around multiples of OPH_QUERY_EXPR_BATCH_SIZE leave partial last batches
+static const long long _oph_io_server_query_test_batch_rows[] = { 1, 2, OPH_QUERY_EXPR_BATCH_SIZE - 1, OPH_QUERY_EXPR_BATCH_SIZE, OPH_QUERY_EXPR_BATCH_SIZE + 1,
+	2 * OPH_QUERY_EXPR_BATCH_SIZE + 451, 3 * OPH_QUERY_EXPR_BATCH_SIZE - 1
+};
+
+//Where clauses can only refer to id_dim: long and double values are mixed by constants and divisions
+static const char *_oph_io_server_query_test_batch_wheres[] = {
+	"(id_dim % 3) = 1", "id_dim / 2.5", "id_dim * 0.75 - 20", "id_dim / 4 = 2.5 | (id_dim % 7) = 0", "!(id_dim / 2.0 = id_dim / 2)", "id_dim - 500.5",
+	"-id_dim / 3 + 200", "NOT (id_dim % 2) AND id_dim / 10.0"
+};
+
+//Selection fields on long (id_dim and count) and double (measure) columns: brackets mark them as expressions
+static const char *_oph_io_server_query_test_batch_fields[] = {
+	"(measure * count)", "(count / 3)", "(measure - id_dim)", "(count % 4) = 1 | measure", "measure / (count - 11)", "(id_dim / 2 + measure / 2)", "(!measure AND count)"
+};
+
+//Create a fragment with a long id_dim (not sorted), a double measure and a long count
+static oph_iostore_frag_record_set *_oph_io_server_query_test_mixed_fragment(long long row_num)
+{
+	oph_iostore_frag_record_set *rs = NULL;
+	if (oph_iostore_create_frag_recordset_slab(&rs, row_num, 3, 0, 0))
+		return NULL;
+	rs->frag_name = strdup("frag");
+	rs->field_name[0] = strdup(OPH_NAME_ID);
+	rs->field_name[1] = strdup(OPH_NAME_MEASURE);
+	rs->field_name[2] = strdup("count");
+	rs->field_type[0] = OPH_IOSTORE_LONG_TYPE;
+	rs->field_type[1] = OPH_IOSTORE_REAL_TYPE;
+	rs->field_type[2] = OPH_IOSTORE_LONG_TYPE;
+
+	long long j, id, count;
+	double measure;
+	for (j = 0; j < row_num; j++) {
+		id = (j * 7919) % row_num + 1;
+		measure = (double) (_oph_io_server_query_test_rand(41) - 20) / 2;
+		count = _oph_io_server_query_test_rand(21) - 10;
+		if (oph_iostore_set_frag_cell(rs, j, 0, &id, sizeof(long long)) || oph_iostore_set_frag_cell(rs, j, 1, &measure, sizeof(double))
+		    || oph_iostore_set_frag_cell(rs, j, 2, &count, sizeof(long long))) {
+			oph_iostore_destroy_frag_recordset(&rs);
+			return NULL;
+		}
+	}
+
+	return rs;
+}
+
+//Evaluation paths: rows one at a time by a single thread (reference), blocks of rows, rows split among threads
+static const char *_oph_io_server_query_test_batch_modes[] = { "row by row", "by blocks", "with multiple threads" };
+
+static void _oph_io_server_query_test_batch_mode(int mode)
+{
+	disable_batch_eval = (mode != 1);
+	omp_threads = (mode ? 4 : 1);
+}
+
+static int _oph_io_server_query_test_batch_where(oph_iostore_frag_record_set * rs, long long row_num, const char *where)
+{
+	oph_iostore_frag_record_set *input_rs[3] = { NULL, NULL, NULL };
+	long long selected[3], j;
+	int mode, res = 0;
+
+	for (mode = 0; !res && mode < 3; mode++) {
+		selected[mode] = row_num;
+		_oph_io_server_query_test_batch_mode(mode);
+		if (oph_iostore_copy_frag_record_set_only(rs, input_rs + mode, 0, 0)
+		    || _oph_ioserver_query_run_where_clause((char *) where, NULL, 1, &rs, selected + mode, input_rs + mode, NULL)) {
+			fprintf(stderr, "Unable to evaluate '%s' %s on %lld rows\n", where, _oph_io_server_query_test_batch_modes[mode], row_num);
+			res = 1;
+		} else if (selected[mode] != selected[0]) {
+			fprintf(stderr, "'%s' selected %lld rows %s instead of %lld on %lld rows\n", where, selected[mode], _oph_io_server_query_test_batch_modes[mode], selected[0], row_num);
+			res = 1;
+		}
+		for (j = 0; !res && j < selected[mode]; j++)
+			if (input_rs[mode]->record_set[j] != input_rs[0]->record_set[j]) {
+				fprintf(stderr, "'%s' selected a different row %lld %s on %lld rows\n", where, j, _oph_io_server_query_test_batch_modes[mode], row_num);
+				res = 1;
+			}
+	}
+	_oph_io_server_query_test_batch_mode(2);
+	disable_batch_eval = 0;
+
+	for (mode = 0; mode < 3; mode++)
+		if (input_rs[mode])
+			oph_iostore_destroy_frag_recordset_only(input_rs + mode);
+
+	return res;
+}
+
+static int _oph_io_server_query_test_batch_select(oph_iostore_frag_record_set * rs, long long row_num)
+{
+	int field_num = sizeof(_oph_io_server_query_test_batch_fields) / sizeof(char *), mode, i, res = 0;
+	oph_iostore_frag_record_set *inputs[2] = { NULL, NULL }, *output[3] = { NULL, NULL, NULL };
+	oph_server_hashmap *query_args = oph_server_hashmap_create(4, 0);
+	long long j;
+
+	if (!query_args || oph_iostore_copy_frag_record_set_only(rs, inputs, 0, 0)) {
+		fprintf(stderr, "Unable to select %lld rows\n", row_num);
+		res = 1;
+	}
+	for (j = 0; !res && j < row_num; j++)
+		inputs[0]->record_set[j] = rs->record_set[j];
+
+	for (mode = 0; !res && mode < 3; mode++) {
+		_oph_io_server_query_test_batch_mode(mode);
+		if (oph_iostore_create_frag_recordset_slab(output + mode, row_num, field_num, -1, 0)
+		    || _oph_ioserver_query_build_select_columns(query_args, (char **) _oph_io_server_query_test_batch_fields, field_num, 0, row_num, NULL, inputs, NULL, output[mode], NULL, NULL)) {
+			fprintf(stderr, "Unable to build columns %s on %lld rows\n", _oph_io_server_query_test_batch_modes[mode], row_num);
+			res = 1;
+		}
+		for (i = 0; !res && i < field_num; i++) {
+			if (output[mode]->field_type[i] != output[0]->field_type[i]) {
+				fprintf(stderr, "'%s' computed with a different type %s on %lld rows\n", _oph_io_server_query_test_batch_fields[i], _oph_io_server_query_test_batch_modes[mode], row_num);
+				res = 1;
+			}
+			for (j = 0; !res && j < row_num; j++)
+				if (output[0]->field_type[i] == OPH_IOSTORE_REAL_TYPE ? *((double *) output[mode]->record_set[j]->field[i]) != *((double *) output[0]->record_set[j]->field[i])
+				    : *((long long *) output[mode]->record_set[j]->field[i]) != *((long long *) output[0]->record_set[j]->field[i])) {
+					fprintf(stderr, "'%s' computed a different value at row %lld %s on %lld rows\n", _oph_io_server_query_test_batch_fields[i], j,
+						_oph_io_server_query_test_batch_modes[mode], row_num);
+					res = 1;
+				}
+		}
+	}
+	_oph_io_server_query_test_batch_mode(2);
+	disable_batch_eval = 0;
+
+	for (mode = 0; mode < 3; mode++)
+		if (output[mode])
+			oph_iostore_destroy_frag_recordset(output + mode);
+	if (inputs[0])
+		oph_iostore_destroy_frag_recordset_only(inputs);
+	if (query_args)
+		oph_server_hashmap_destroy(query_args);
+
+	return res;
+}
+
+static int _oph_io_server_query_test_batch()
+{
+	oph_query_expr_node *e = NULL;
+	oph_query_expr_program *program = NULL;
+	oph_iostore_frag_record_set *rs = NULL;
+	char **var_list = NULL;
+	const char *expr;
+	int var_count = 0, res = 0;
+	size_t r, w, expr_num = sizeof(_oph_io_server_query_test_batch_wheres) / sizeof(char *), field_num = sizeof(_oph_io_server_query_test_batch_fields) / sizeof(char *);
+
+	//Every expression has to be evaluated by blocks of rows when allowed
+	for (w = 0; !res && w < expr_num + field_num; w++) {
+		expr = (w < expr_num ? _oph_io_server_query_test_batch_wheres[w] : _oph_io_server_query_test_batch_fields[w - expr_num]);
+		if (oph_query_expr_get_ast(expr, &e) || oph_query_expr_get_variables(e, &var_list, &var_count) || oph_query_expr_compile(e, var_list, var_count, NULL, &program)
+		    || !oph_query_expr_is_batchable(program)) {
+			fprintf(stderr, "Expression '%s' cannot be evaluated by blocks of rows\n", expr);
+			res = 1;
+		}
+		if (program)
+			oph_query_expr_destroy_program(program);
+		if (var_list)
+			free(var_list);
+		if (e)
+			oph_query_expr_delete_node(e, NULL);
+		program = NULL;
+		var_list = NULL;
+		e = NULL;
+	}
+
+	for (r = 0; !res && r < sizeof(_oph_io_server_query_test_batch_rows) / sizeof(long long); r++) {
+		if (!(rs = _oph_io_server_query_test_mixed_fragment(_oph_io_server_query_test_batch_rows[r]))) {
+			fprintf(stderr, "Unable to create a fragment of %lld rows\n", _oph_io_server_query_test_batch_rows[r]);
+			res = 1;
+			break;
+		}
+		for (w = 0; !res && w < expr_num; w++)
+			res = _oph_io_server_query_test_batch_where(rs, _oph_io_server_query_test_batch_rows[r], _oph_io_server_query_test_batch_wheres[w]);
+		if (!res)
+			res = _oph_io_server_query_test_batch_select(rs, _oph_io_server_query_test_batch_rows[r]);
+		oph_iostore_destroy_frag_recordset(&rs);
+	}
+
+	return res;
+}
+
+//Join
+
+static int _oph_io_server_query_test_join()
+{
+	int res = 0, run, table_num, l, kind;
+	long long *ids[3] = { NULL, NULL, NULL }, id_num[3], *join_rows[3] = { NULL, NULL, NULL }, join_row_num = 0, row_num, range, start, id, j, k, expected;
+	oph_iostore_frag_record_set *rs[3] = { NULL, NULL, NULL };
+	short int id_indexes[3] = { 0, 0, 0 };
+	char *found = NULL;
+
+	for (run = 0; !res && run < OPH_IO_SERVER_QUERY_TEST_RUNS; run++) {
+		table_num = 2 + run % 2;
+		row_num = (run % 5 ? 1 + _oph_io_server_query_test_rand(OPH_IO_SERVER_QUERY_TEST_SMALL_ROWS) : OPH_IO_SERVER_QUERY_TEST_LARGE_ROWS);
+		range = row_num * (1 + _oph_io_server_query_test_rand(3));
+		//Tables with dense, sorted with gaps (merge join) or shuffled ids (hash join)
+		for (l = 0; !res && l < table_num; l++) {
+			kind = _oph_io_server_query_test_rand(3);
+			start = _oph_io_server_query_test_rand(row_num / 2 + 1);
+			if (!(ids[l] = (long long *) malloc(range * sizeof(long long)))) {
+				res = 1;
+				break;
+			}
+			id_num[l] = 0;
+			for (id = start; id < start + range; id++)
+				if (!kind || _oph_io_server_query_test_rand(3))
+					ids[l][id_num[l]++] = id;
+			if (!kind && id_num[l] > row_num)
+				id_num[l] = row_num;
+			if (kind == 2)
+				for (k = id_num[l] - 1; k > 0; k--) {
+					j = _oph_io_server_query_test_rand(k + 1);
+					id = ids[l][k];
+					ids[l][k] = ids[l][j];
+					ids[l][j] = id;
+				}
+			if (!(rs[l] = _oph_io_server_query_test_fragment(id_num[l], ids[l])))
+				res = 1;
+		}
+		if (!res && _oph_ioserver_query_join_tables(table_num, id_indexes, rs, join_rows, &join_row_num)) {
+			fprintf(stderr, "Unable to join %d tables\n", table_num);
+			res = 1;
+		}
+		//Reference: ids found in every table (each id appears once in a table)
+		if (!res && !(found = (char *) calloc(range + row_num, sizeof(char))))
+			res = 1;
+		for (l = 0; !res && l < table_num; l++)
+			for (k = 0; k < id_num[l]; k++)
+				found[ids[l][k]]++;
+		for (k = 0, expected = 0; !res && k < range + row_num; k++)
+			if (found[k] == table_num)
+				expected++;
+		//Each joined row has to match a distinct id found in every table
+		for (k = 0; !res && k < join_row_num; k++) {
+			id = ids[0][join_rows[0][k]];
+			for (l = 1; !res && l < table_num; l++)
+				if (ids[l][join_rows[l][k]] != id) {
+					fprintf(stderr, "Rows with different ids joined\n");
+					res = 1;
+				}
+			if (!res && found[id] != table_num) {
+				fprintf(stderr, "Id %lld joined more than once\n", id);
+				res = 1;
+			}
+			found[id] = 0;
+		}
+		if (!res && (expected != join_row_num)) {
+			fprintf(stderr, "%lld rows joined instead of %lld\n", join_row_num, expected);
+			res = 1;
+		}
+
+		for (l = 0; l < table_num; l++) {
+			if (join_rows[l])
+				free(join_rows[l]);
+			join_rows[l] = NULL;
+			if (rs[l])
+				oph_iostore_destroy_frag_recordset(&rs[l]);
+			if (ids[l])
+				free(ids[l]);
+			rs[l] = NULL;
+			ids[l] = NULL;
+		}
+		if (found)
+			free(found);
+		found = NULL;
+	}
+
+	//Duplicate ids cannot be joined, in any table
+	long long duplicated[4] = { 3, 1, 2, 3 }, unique[3] = { 1, 2, 3 };
+	oph_iostore_frag_record_set *dup_rs[2] = { _oph_io_server_query_test_fragment(4, duplicated), _oph_io_server_query_test_fragment(3, unique) };
+	oph_iostore_frag_record_set *swapped_rs[2] = { dup_rs[1], dup_rs[0] };
+	if (!res && (!dup_rs[0] || !dup_rs[1] || !_oph_ioserver_query_join_tables(2, id_indexes, dup_rs, join_rows, &join_row_num)
+		     || !_oph_ioserver_query_join_tables(2, id_indexes, swapped_rs, join_rows, &join_row_num))) {
+		fprintf(stderr, "Duplicate ids joined\n");
+		res = 1;
+	}
+	if (dup_rs[0])
+		oph_iostore_destroy_frag_recordset(&dup_rs[0]);
+	if (dup_rs[1])
+		oph_iostore_destroy_frag_recordset(&dup_rs[1]);
+
+	return res;
+}
+
+//Prepared statements
+
+//A bound statement has to contain the args parsed from the query, except the lists split at preparation time
+static int _oph_io_server_query_test_check_bound(oph_io_server_prepared_stmt * stmt, oph_server_hashmap * reference, oph_server_hashmap * query_args, char split, const char *query)
+{
+	unsigned long long iter = 0, count = 0;
+	const char *key = NULL;
+	void *value = NULL;
+	int res = 0;
+
+	while (!res && oph_server_hashmap_next(reference, &iter, &key, &value)) {
+		char *bound = (char *) oph_server_hashmap_get(query_args, key);
+		if (split && (!strcmp(key, OPH_QUERY_ENGINE_LANG_ARG_FIELD) || !strcmp(key, OPH_QUERY_ENGINE_LANG_ARG_VALUE))) {
+			char **list = NULL, **stmt_list = (!strcmp(key, OPH_QUERY_ENGINE_LANG_ARG_FIELD) ? stmt->field_list : stmt->value_list);
+			int list_num = 0, stmt_list_num = (!strcmp(key, OPH_QUERY_ENGINE_LANG_ARG_FIELD) ? stmt->field_list_num : stmt->value_list_num), i;
+			char *buffer = strdup((char *) value);
+			if (bound || !buffer || oph_query_parse_multivalue_arg(buffer, &list, &list_num) || list_num != stmt_list_num)
+				res = 1;
+			for (i = 0; !res && i < list_num; i++)
+				if (strcmp(list[i], stmt_list[i]))
+					res = 1;
+			if (list)
+				free(list);
+			if (buffer)
+				free(buffer);
+		} else {
+			if (!bound || strcmp(bound, (char *) value))
+				res = 1;
+			count++;
+		}
+		if (res)
+			fprintf(stderr, "Wrong value of arg %s of query %s\n", key, query);
+	}
+	if (!res && query_args->count != count) {
+		fprintf(stderr, "Wrong number of args bound to query %s\n", query);
+		res = 1;
+	}
+
+	return res;
+}
+
+static int _oph_io_server_query_test_bind(oph_io_server_thread_status * status, const char *query, char split)
+{
+	char *buffer = strdup(query), *reference_buffer = strdup(query);
+	oph_server_hashmap *reference = NULL, *query_args = NULL, *bound_args = NULL;
+	oph_io_server_prepared_stmt *stmt = NULL;
+	unsigned long long handle = 0, iter = 0;
+	void *value = NULL;
+	int res = 0;
+
+	if (!buffer || !reference_buffer || oph_query_parser(reference_buffer, &reference) || oph_io_server_prepare_stmt(status, buffer, &handle)
+	    || oph_io_server_find_stmt(status, handle, &stmt) || oph_io_server_bind_stmt(stmt, &query_args)) {
+		fprintf(stderr, "Unable to prepare query %s\n", query);
+		res = 1;
+	}
+	if (!res)
+		res = _oph_io_server_query_test_check_bound(stmt, reference, query_args, split, query);
+
+	//Args split in place by an execution are restored by the next binding, without building them again
+	while (!res && oph_server_hashmap_next(query_args, &iter, NULL, &value))
+		if (*((char *) value))
+			((char *) value)[strlen((char *) value) / 2] = 0;
+	if (!res && (oph_io_server_bind_stmt(stmt, &bound_args) || bound_args != query_args)) {
+		fprintf(stderr, "Args of query %s bound again\n", query);
+		res = 1;
+	}
+	if (!res)
+		res = _oph_io_server_query_test_check_bound(stmt, reference, bound_args, split, query);
+
+	//Args added by an execution are removed
+	if (!res && (oph_server_hashmap_insert(query_args, OPH_QUERY_ENGINE_LANG_ARG_ORDER "_test", strdup(OPH_NAME_ID)) || oph_io_server_bind_stmt(stmt, &bound_args)
+		     || _oph_io_server_query_test_check_bound(stmt, reference, bound_args, split, query))) {
+		fprintf(stderr, "Args added to query %s not removed\n", query);
+		res = 1;
+	}
+
+	if (reference)
+		oph_server_hashmap_destroy(reference);
+	if (buffer)
+		free(buffer);
+	if (reference_buffer)
+		free(reference_buffer);
+
+	return res;
+}
+
+static int _oph_io_server_query_test_count_exprs(oph_ioserver_query_expr * exprs)
+{
+	int expr_num = 0;
+	for (; exprs; exprs = exprs->next)
+		expr_num++;
+	return expr_num;
+}
+
+//Rows selected by a where clause compiled by a previous execution have to be the rows selected by a new compilation
+static int _oph_io_server_query_test_cached_where(oph_iostore_frag_record_set * rs, long long row_num, const char *where, oph_ioserver_query_expr ** exprs)
+{
+	oph_iostore_frag_record_set *input_rs[2] = { NULL, NULL };
+	long long selected[2] = { row_num, row_num }, j;
+	int k, res = 0;
+
+	for (k = 0; !res && k < 2; k++)
+		if (oph_iostore_copy_frag_record_set_only(rs, input_rs + k, 0, 0)
+		    || _oph_ioserver_query_run_where_clause((char *) where, NULL, 1, &rs, selected + k, input_rs + k, k ? exprs : NULL)) {
+			fprintf(stderr, "Unable to evaluate '%s' on %lld rows\n", where, row_num);
+			res = 1;
+		}
+	if (!res && selected[1] != selected[0]) {
+		fprintf(stderr, "'%s' compiled once selected %lld rows instead of %lld\n", where, selected[1], selected[0]);
+		res = 1;
+	}
+	for (j = 0; !res && j < selected[0]; j++)
+		if (input_rs[1]->record_set[j] != input_rs[0]->record_set[j]) {
+			fprintf(stderr, "'%s' compiled once selected a different row %lld\n", where, j);
+			res = 1;
+		}
+
+	for (k = 0; k < 2; k++)
+		if (input_rs[k])
+			oph_iostore_destroy_frag_recordset_only(input_rs + k);
+
+	return res;
+}
+
+//Columns computed by expressions compiled by a previous execution have to be the columns computed by a new compilation
+static int _oph_io_server_query_test_cached_select(oph_iostore_frag_record_set * rs, long long row_num, oph_ioserver_query_expr ** exprs)
+{
+	int field_num = sizeof(_oph_io_server_query_test_batch_fields) / sizeof(char *), k, i, res = 0;
+	oph_iostore_frag_record_set *inputs[2] = { NULL, NULL }, *output[2] = { NULL, NULL };
+	oph_server_hashmap *query_args = oph_server_hashmap_create(4, 0);
+	long long j;
+
+	if (!query_args || oph_iostore_copy_frag_record_set_only(rs, inputs, 0, 0)) {
+		fprintf(stderr, "Unable to select %lld rows\n", row_num);
+		res = 1;
+	}
+	for (j = 0; !res && j < row_num; j++)
+		inputs[0]->record_set[j] = rs->record_set[j];
+
+	for (k = 0; !res && k < 2; k++)
+		if (oph_iostore_create_frag_recordset_slab(output + k, row_num, field_num, -1, 0)
+		    || _oph_ioserver_query_build_select_columns(query_args, (char **) _oph_io_server_query_test_batch_fields, field_num, 0, row_num, NULL, inputs, NULL, output[k], NULL,
+								k ? exprs : NULL)) {
+			fprintf(stderr, "Unable to build columns on %lld rows\n", row_num);
+			res = 1;
+		}
+	for (i = 0; !res && i < field_num; i++) {
+		if (output[1]->field_type[i] != output[0]->field_type[i]) {
+			fprintf(stderr, "'%s' compiled once computed a different type\n", _oph_io_server_query_test_batch_fields[i]);
+			res = 1;
+		}
+		for (j = 0; !res && j < row_num; j++)
+			if (output[0]->field_type[i] == OPH_IOSTORE_REAL_TYPE ? *((double *) output[1]->record_set[j]->field[i]) != *((double *) output[0]->record_set[j]->field[i])
+			    : *((long long *) output[1]->record_set[j]->field[i]) != *((long long *) output[0]->record_set[j]->field[i])) {
+				fprintf(stderr, "'%s' compiled once computed a different value at row %lld\n", _oph_io_server_query_test_batch_fields[i], j);
+				res = 1;
+			}
+	}
+
+	for (k = 0; k < 2; k++)
+		if (output[k])
+			oph_iostore_destroy_frag_recordset(output + k);
+	if (inputs[0])
+		oph_iostore_destroy_frag_recordset_only(inputs);
+	if (query_args)
+		oph_server_hashmap_destroy(query_args);
+
+	return res;
+}
+
+static int _oph_io_server_query_test_exprs()
+{
+	int where_num = sizeof(_oph_io_server_query_test_batch_wheres) / sizeof(char *), field_num = sizeof(_oph_io_server_query_test_batch_fields) / sizeof(char *);
+	int expr_num = where_num + 2 + field_num, run, w, res = 0;
+	long long row_num = 2 * OPH_QUERY_EXPR_BATCH_SIZE + 451, ids[OPH_IO_SERVER_QUERY_TEST_SMALL_ROWS], j;
+	oph_iostore_frag_record_set *rs = NULL, *sorted_rs = NULL, *swapped_rs = NULL, *other_rs = NULL;
+	oph_ioserver_query_expr *exprs = NULL, *first = NULL, *expr = NULL;
+	char *name = NULL;
+
+	for (j = 0; j < OPH_IO_SERVER_QUERY_TEST_SMALL_ROWS; j++)
+		ids[j] = j + 1;
+	if (!(rs = _oph_io_server_query_test_mixed_fragment(row_num)) || !(sorted_rs = _oph_io_server_query_test_fragment(OPH_IO_SERVER_QUERY_TEST_SMALL_ROWS, ids))
+	    || !(swapped_rs = _oph_io_server_query_test_mixed_fragment(row_num)) || !(other_rs = _oph_io_server_query_test_fragment(row_num < OPH_IO_SERVER_QUERY_TEST_SMALL_ROWS ? row_num : OPH_IO_SERVER_QUERY_TEST_SMALL_ROWS, ids))) {
+		fprintf(stderr, "Unable to create fragments\n");
+		res = 1;
+	}
+
+	//Following executions (row by row or by blocks) reuse the expressions compiled by the first one
+	for (run = 0; !res && run < 3; run++) {
+		disable_batch_eval = (run == 1);
+		for (w = 0; !res && w < where_num; w++)
+			res = _oph_io_server_query_test_cached_where(rs, row_num, _oph_io_server_query_test_batch_wheres[w], &exprs);
+		//Predicates on id_dim translated into a range of the zone map, alone or with other predicates
+		if (!res)
+			res = _oph_io_server_query_test_cached_where(sorted_rs, OPH_IO_SERVER_QUERY_TEST_SMALL_ROWS, "id_dim = 5", &exprs);
+		if (!res)
+			res = _oph_io_server_query_test_cached_where(sorted_rs, OPH_IO_SERVER_QUERY_TEST_SMALL_ROWS, "id_dim = 5 AND (id_dim % 2) = 1", &exprs);
+		if (!res)
+			res = _oph_io_server_query_test_cached_select(rs, row_num, &exprs);
+		if (!run)
+			first = exprs;
+		if (!res && (exprs != first || _oph_io_server_query_test_count_exprs(exprs) != expr_num)) {
+			fprintf(stderr, "%d expressions compiled instead of %d\n", _oph_io_server_query_test_count_exprs(exprs), expr_num);
+			res = 1;
+		}
+	}
+	disable_batch_eval = 0;
+
+	//Variables are linked again to the fields when they are moved
+	if (!res) {
+		name = swapped_rs->field_name[1];
+		swapped_rs->field_name[1] = swapped_rs->field_name[2];
+		swapped_rs->field_name[2] = name;
+		swapped_rs->field_type[1] = OPH_IOSTORE_LONG_TYPE;
+		swapped_rs->field_type[2] = OPH_IOSTORE_REAL_TYPE;
+		for (j = 0; j < row_num; j++) {
+			double measure = (double) *((long long *) swapped_rs->record_set[j]->field[2]);
+			long long count = (long long) *((double *) swapped_rs->record_set[j]->field[1]);
+			memcpy(swapped_rs->record_set[j]->field[1], &count, sizeof(long long));
+			memcpy(swapped_rs->record_set[j]->field[2], &measure, sizeof(double));
+		}
+		res = _oph_io_server_query_test_cached_select(swapped_rs, row_num, &exprs);
+		if (!res && _oph_io_server_query_test_count_exprs(exprs) != expr_num) {
+			fprintf(stderr, "Expressions compiled again when fields are moved\n");
+			res = 1;
+		}
+	}
+	//Expressions that cannot be evaluated any more are released
+	if (!res) {
+		oph_iostore_frag_record_set *inputs[2] = { other_rs, NULL }, *output = NULL;
+		oph_server_hashmap *query_args = oph_server_hashmap_create(4, 0);
+		long long other_row_num = (row_num < OPH_IO_SERVER_QUERY_TEST_SMALL_ROWS ? row_num : OPH_IO_SERVER_QUERY_TEST_SMALL_ROWS);
+		if (!query_args || oph_iostore_create_frag_recordset_slab(&output, other_row_num, field_num, -1, 0)
+		    || !_oph_ioserver_query_build_select_columns(query_args, (char **) _oph_io_server_query_test_batch_fields, field_num, 0, other_row_num, NULL, inputs, NULL, output, NULL, &exprs)) {
+			fprintf(stderr, "Columns built without count field\n");
+			res = 1;
+		}
+		for (expr = exprs; !res && expr; expr = expr->next)
+			if (!strcmp(expr->expression, _oph_io_server_query_test_batch_fields[0]))
+				res = 1;
+		if (!res && _oph_io_server_query_test_count_exprs(exprs) != expr_num - 1)
+			res = 1;
+		if (res)
+			fprintf(stderr, "Expression not released after a failed execution\n");
+		if (output)
+			oph_iostore_destroy_frag_recordset(&output);
+		if (query_args)
+			oph_server_hashmap_destroy(query_args);
+	}
+
+	if (_oph_ioserver_query_destroy_exprs(&exprs) || exprs) {
+		fprintf(stderr, "Expressions not released\n");
+		res = 1;
+	}
+	if (rs)
+		oph_iostore_destroy_frag_recordset(&rs);
+	if (sorted_rs)
+		oph_iostore_destroy_frag_recordset(&sorted_rs);
+	if (swapped_rs)
+		oph_iostore_destroy_frag_recordset(&swapped_rs);
+	if (other_rs)
+		oph_iostore_destroy_frag_recordset(&other_rs);
+
+	return res;
+}
+
+static int _oph_io_server_query_test_stmt()
+{
+	oph_io_server_thread_status status;
+	oph_io_server_prepared_stmt *stmt = NULL;
+	unsigned long long handle = 0, first = 0;
+	char query[OPH_IO_SERVER_BUFFER];
+	int res = 0, i;
+
+	memset(&status, 0, sizeof(oph_io_server_thread_status));
+
+	res |= _oph_io_server_query_test_exprs();
+	res |= _oph_io_server_query_test_bind(&status, "operation=select;field=id_dim|measure;from=frag;where=id_dim>1;", 0);
+	res |= _oph_io_server_query_test_bind(&status, "operation=insert;field=id_dim|measure;value=?1|?2;", 1);
+	res |= _oph_io_server_query_test_bind(&status, "operation=multi_insert;field=id_dim|measure;value=1|'a'|2|'b';", 1);
+
+	//Invalid operations are not prepared
+	snprintf(query, OPH_IO_SERVER_BUFFER, "operation=unknown;");
+	if (!oph_io_server_prepare_stmt(&status, query, &handle) || status.prepared_stmt_num != 3) {
+		fprintf(stderr, "Invalid statement prepared\n");
+		res = 1;
+	}
+	//The oldest statement is released when too many statements are prepared
+	for (i = 0; !res && i < OPH_IO_SERVER_MAX_PREPARED_STMTS; i++) {
+		snprintf(query, OPH_IO_SERVER_BUFFER, "operation=select;field=measure;from=frag%d;", i);
+		if (oph_io_server_prepare_stmt(&status, query, &handle))
+			res = 1;
+		if (!i)
+			first = handle;
+	}
+	if (!res && (status.prepared_stmt_num != OPH_IO_SERVER_MAX_PREPARED_STMTS || !oph_io_server_find_stmt(&status, 1, &stmt) || oph_io_server_find_stmt(&status, first, &stmt))) {
+		fprintf(stderr, "Wrong statements released when the limit is reached\n");
+		res = 1;
+	}
+	if (!res && (oph_io_server_release_stmt(&status, first) || !oph_io_server_find_stmt(&status, first, &stmt) || !oph_io_server_release_stmt(&status, first)
+		     || status.prepared_stmt_num != OPH_IO_SERVER_MAX_PREPARED_STMTS - 1)) {
+		fprintf(stderr, "Statement %llu not released\n", first);
+		res = 1;
+	}
+
+	oph_io_server_free_stmts(&status);
+	if (status.prepared_stmts || status.prepared_stmt_num) {
+		fprintf(stderr, "Statements not released\n");
+		res = 1;
+	}
+
+	return res;
+}
+
+int main()
+{
+	int res = 0;
+
+	if (_oph_io_server_query_test_sort()) {
+		fprintf(stderr, "Sort: FAILED\n");
+		res = 1;
+	}
+	if (_oph_io_server_query_test_groups()) {
+		fprintf(stderr, "Group by: FAILED\n");
+		res = 1;
+	}
+	if (_oph_io_server_query_test_zone()) {
+		fprintf(stderr, "Zone map pruning: FAILED\n");
+		res = 1;
+	}
+	if (_oph_io_server_query_test_batch()) {
+		fprintf(stderr, "Batch evaluation: FAILED\n");
+		res = 1;
+	}
+	if (_oph_io_server_query_test_join()) {
+		fprintf(stderr, "Join: FAILED\n");
+		res = 1;
+	}
+	if (_oph_io_server_query_test_stmt()) {
+		fprintf(stderr, "Prepared statements: FAILED\n");
+		res = 1;
+	}
+
+	return res;
+}
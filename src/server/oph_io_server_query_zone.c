@@ -0,0 +1,265 @@
+/*
+    Ophidia IO Server
+    Copyright (C) 2014-2023 CMCC Foundation
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include "oph_io_server_query_manager.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <debug.h>
+
+#include "oph_server_utility.h"
+
+extern int msglevel;
+
+#define OPH_IO_SERVER_SUBSET_FUNCTION "oph_is_in_subset"
+#define OPH_IO_SERVER_SUBSET_ARG_NUM 4
+
+static int _oph_ioserver_query_is_id(oph_query_expr_node * e)
+{
+	return e && (e->type == eVAR) && e->name && !STRCMP(e->name, OPH_NAME_ID);
+}
+
+static int _oph_ioserver_query_get_constant(oph_query_expr_node * e, long long *value)
+{
+	if (!e)
+		return 0;
+	if ((e->type == eVALUE) && (e->value.type == OPH_QUERY_EXPR_TYPE_LONG)) {
+		*value = e->value.data.long_value;
+		return 1;
+	}
+	if ((e->type == eNEG) && _oph_ioserver_query_get_constant(e->right, value) && (*value != LLONG_MIN)) {
+		*value = -(*value);
+		return 1;
+	}
+	return 0;
+}
+
+//Check if a predicate selects a range of ids: id_dim = C, C = id_dim or oph_is_in_subset(id_dim, start, step, max)
+static int _oph_ioserver_query_match_id_predicate(oph_query_expr_node * e, oph_ioserver_id_range * range)
+{
+	long long value = 0;
+
+	if (e->type == eEQUAL) {
+		if ((_oph_ioserver_query_is_id(e->left) && _oph_ioserver_query_get_constant(e->right, &value))
+		    || (_oph_ioserver_query_is_id(e->right) && _oph_ioserver_query_get_constant(e->left, &value))) {
+			range->min_id = range->max_id = range->start = value;
+			range->step = 1;
+			return 1;
+		}
+		return 0;
+	}
+
+	if ((e->type == eFUN) && e->name && !STRCMP(e->name, OPH_IO_SERVER_SUBSET_FUNCTION)) {
+		//Arguments are linked in reverse order
+		oph_query_expr_node *args[OPH_IO_SERVER_SUBSET_ARG_NUM], *cur = e->left;
+		int n = 0;
+		for (; cur && (cur->type == eARG); cur = cur->right) {
+			if (n == OPH_IO_SERVER_SUBSET_ARG_NUM)
+				return 0;
+			args[OPH_IO_SERVER_SUBSET_ARG_NUM - 1 - n++] = cur->left;
+		}
+		long long start = 0, step = 0, max = 0;
+		if ((n != OPH_IO_SERVER_SUBSET_ARG_NUM) || cur || !_oph_ioserver_query_is_id(args[0]) || !_oph_ioserver_query_get_constant(args[1], &start)
+		    || !_oph_ioserver_query_get_constant(args[2], &step) || !_oph_ioserver_query_get_constant(args[3], &max) || (step <= 0))
+			return 0;
+		range->min_id = range->start = start;
+		range->max_id = max;
+		range->step = step;
+		return 1;
+	}
+
+	return 0;
+}
+
+static void _oph_ioserver_query_scan_conjuncts(oph_query_expr_node * e, oph_ioserver_id_range * range, int *strided_num, int *residual_num)
+{
+	if (!e) {
+		(*residual_num)++;
+		return;
+	}
+	if (e->type == eAND) {
+		_oph_ioserver_query_scan_conjuncts(e->left, range, strided_num, residual_num);
+		_oph_ioserver_query_scan_conjuncts(e->right, range, strided_num, residual_num);
+		return;
+	}
+
+	oph_ioserver_id_range tmp;
+	if (!_oph_ioserver_query_match_id_predicate(e, &tmp)) {
+		(*residual_num)++;
+		return;
+	}
+	range->found = 1;
+	if (tmp.min_id > range->min_id)
+		range->min_id = tmp.min_id;
+	if (tmp.max_id < range->max_id)
+		range->max_id = tmp.max_id;
+	if (tmp.step > 1) {
+		(*strided_num)++;
+		range->start = tmp.start;
+		range->step = tmp.step;
+	}
+}
+
+//Replace predicates included in the range with the constant 1, so that AND keeps its semantics on the other operand
+static int _oph_ioserver_query_replace_conjuncts(oph_query_expr_node ** e, oph_query_expr_symtable * table, char keep_strided)
+{
+	if (!*e)
+		return OPH_IO_SERVER_SUCCESS;
+	if ((*e)->type == eAND) {
+		if (_oph_ioserver_query_replace_conjuncts(&((*e)->left), table, keep_strided))
+			return OPH_IO_SERVER_MEMORY_ERROR;
+		return _oph_ioserver_query_replace_conjuncts(&((*e)->right), table, keep_strided);
+	}
+
+	oph_ioserver_id_range tmp;
+	if (!_oph_ioserver_query_match_id_predicate(*e, &tmp) || ((tmp.step > 1) && keep_strided))
+		return OPH_IO_SERVER_SUCCESS;
+
+	oph_query_expr_node *constant = oph_query_expr_create_long(1);
+	if (!constant)
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	oph_query_expr_delete_node(*e, table);
+	*e = constant;
+
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+int _oph_ioserver_query_get_id_range(oph_query_expr_node ** e, oph_query_expr_symtable * table, oph_ioserver_id_range * range)
+{
+	if (!e || !*e || !range) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	range->found = 0;
+	range->residual = 0;
+	range->min_id = LLONG_MIN;
+	range->max_id = LLONG_MAX;
+	range->start = 0;
+	range->step = 1;
+
+	int strided_num = 0, residual_num = 0;
+	_oph_ioserver_query_scan_conjuncts(*e, range, &strided_num, &residual_num);
+	if (!range->found)
+		return OPH_IO_SERVER_SUCCESS;
+
+	//Only one stride can be applied directly, when no other predicate has to be evaluated
+	char keep_strided = (strided_num > 1) || (strided_num && residual_num);
+	if (keep_strided) {
+		range->start = range->min_id;
+		range->step = 1;
+		residual_num += strided_num;
+	}
+	range->residual = (residual_num > 0);
+
+	if (range->residual && _oph_ioserver_query_replace_conjuncts(e, table, keep_strided)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_MEMORY_ALLOC_ERROR);
+		return OPH_IO_SERVER_MEMORY_ERROR;
+	}
+
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+static inline long long _oph_ioserver_query_get_row_id(oph_iostore_frag_record_set * rs, long long row)
+{
+	long long id = 0;
+	memcpy(&id, rs->record_set[row]->field[rs->zone_map.id_index], sizeof(long long));
+	return id;
+}
+
+//Index of the first row with an id not less than the value
+static long long _oph_ioserver_query_lower_bound(oph_iostore_frag_record_set * rs, long long value)
+{
+	long long first = 0, last = rs->zone_map.row_num, middle;
+	while (first < last) {
+		middle = first + (last - first) / 2;
+		if (_oph_ioserver_query_get_row_id(rs, middle) < value)
+			first = middle + 1;
+		else
+			last = middle;
+	}
+	return first;
+}
+
+int _oph_ioserver_query_get_id_rows(oph_iostore_frag_record_set * rs, oph_ioserver_id_range * range, long long *first_row, long long *row_num)
+{
+	if (!rs || !range || !first_row || !row_num || !rs->zone_map.valid || !rs->zone_map.sorted) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	oph_iostore_frag_zone_map *zone_map = &(rs->zone_map);
+	long long min_id = (range->min_id > zone_map->min_id ? range->min_id : zone_map->min_id);
+	long long max_id = (range->max_id < zone_map->max_id ? range->max_id : zone_map->max_id);
+
+	*first_row = 0;
+	*row_num = 0;
+	if (!zone_map->row_num || (min_id > max_id))
+		return OPH_IO_SERVER_SUCCESS;
+
+	if (zone_map->dense) {
+		*first_row = min_id - zone_map->min_id;
+		*row_num = max_id - min_id + 1;
+	} else {
+		*first_row = _oph_ioserver_query_lower_bound(rs, min_id);
+		*row_num = (max_id == LLONG_MAX ? zone_map->row_num : _oph_ioserver_query_lower_bound(rs, max_id + 1)) - *first_row;
+	}
+
+	return OPH_IO_SERVER_SUCCESS;
+}
+
+int _oph_ioserver_query_select_id_range(oph_iostore_frag_record_set * stored_rs, oph_ioserver_id_range * range, oph_iostore_frag_record_set * input_rs, long long *row_num)
+{
+	if (!stored_rs || !range || !input_rs || !input_rs->record_set || !row_num || (range->step <= 0)) {
+		pmesg(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		logging(LOG_ERROR, __FILE__, __LINE__, OPH_IO_SERVER_LOG_NULL_INPUT_PARAM);
+		return OPH_IO_SERVER_NULL_PARAM;
+	}
+
+	long long first_row = 0, range_rows = 0;
+	if (_oph_ioserver_query_get_id_rows(stored_rs, range, &first_row, &range_rows))
+		return OPH_IO_SERVER_EXEC_ERROR;
+
+	long long j, curr_row = 0, last_row = first_row + range_rows;
+	if (range->step == 1) {
+		memcpy(input_rs->record_set, stored_rs->record_set + first_row, range_rows * sizeof(oph_iostore_frag_record *));
+		curr_row = range_rows;
+	} else if (range_rows && stored_rs->zone_map.dense) {
+		//Jump to the first id of the stride, then move by step rows
+		long long offset = (range->start - (stored_rs->zone_map.min_id + first_row)) % range->step;
+		if (offset < 0)
+			offset += range->step;
+		for (j = first_row + offset; j < last_row; j += range->step)
+			input_rs->record_set[curr_row++] = stored_rs->record_set[j];
+	} else {
+		for (j = first_row; j < last_row; j++)
+			if (!((_oph_ioserver_query_get_row_id(stored_rs, j) - range->start) % range->step))
+				input_rs->record_set[curr_row++] = stored_rs->record_set[j];
+	}
+
+	*row_num = curr_row;
+
+	return OPH_IO_SERVER_SUCCESS;
+}
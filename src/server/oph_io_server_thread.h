@@ -22,8 +22,15 @@
 // Prototypes
 
 #include "oph_iostorage_interface.h"
+#include "oph_server_arena.h"
+#include "oph_server_hashmap.h"
 #include <pthread.h>
 
+//Buffered socket reader (defined in oph_network.h)
+struct _oph_net_reader;
+//Compiled expression (defined in oph_io_server_query_manager.h)
+struct _oph_ioserver_query_expr;
+
 //Packet codes
 
 #define OPH_IO_SERVER_MSG_TYPE_LEN 2
@@ -32,6 +39,7 @@
 
 #define OPH_IO_SERVER_MSG_PING "PG"
 #define OPH_IO_SERVER_MSG_RESULT "RS"
+#define OPH_IO_SERVER_MSG_RESULT_BINARY "RB"
 #define OPH_IO_SERVER_MSG_USE_DB "UD"
 #define OPH_IO_SERVER_MSG_SET_QUERY "SQ"
 #define OPH_IO_SERVER_MSG_EXEC_QUERY "EQ"
@@ -44,10 +52,37 @@
 
 #define OPH_IO_SERVER_REQ_ERROR   "ER"
 
+//Outcome of the check of a request received from a connection
+#define OPH_IO_SERVER_FRAME_COMPLETE	0
+#define OPH_IO_SERVER_FRAME_INCOMPLETE	1
+#define OPH_IO_SERVER_FRAME_INVALID		2
+
+//Maximum size of a request, in units of MAX_PACKET_LEN (each length field is also limited to MAX_PACKET_LEN)
+#define OPH_IO_SERVER_MAX_FRAME_PACKETS	4
+
 // enum and struct
 #define OPH_IO_SERVER_MAX_LONG_LEN 24
 #define OPH_IO_SERVER_MAX_DOUBLE_LEN 32
 
+//Number of cells sent with a single writev when streaming a result set
+#define OPH_IO_SERVER_RS_BATCH_CELLS 256
+
+//Binary result set packet (RB): numeric cells are sent as 8-byte little-endian values
+/*
+---------------------------------------------------------------------------------------------------------------------------------------------------
+| char type[2]| uint64 payload_len| uint64 nrows| uint32 nfields| uint8 field1_type| ...| uint8 fieldN_type| char field11[8]| uint64 field12_len| char *field12| ...|
+---------------------------------------------------------------------------------------------------------------------------------------------------
+*/
+#define OPH_IO_SERVER_MSG_BINARY_VALUE_LEN sizeof(unsigned long long)
+
+//Prepared statements (SQ): the query is parsed once and executed by EQ through its handle
+/*
+SQ request:  | char type[2]| uint64 QUERY_LEN| char *QUERY|                          (QUERY_LEN = 0 is followed by uint64 HANDLE of the statement to be released)
+SQ reply:    | char type[2]| uint64 HANDLE|
+EQ request:  | char type[2]| uint32 ARG_NUMBER| uint64 0| uint64 HANDLE| uint64 DEV_LEN| char *DEV| ...|   (same as a plain EQ, with the handle in place of the query)
+*/
+#define OPH_IO_SERVER_MAX_PREPARED_STMTS 32
+
 /**
  * \brief			            Structure to contain info about a running statement (query executed in multiple runs)
  * \param tot_run         Total number of times the query should be executed
@@ -67,6 +102,36 @@ typedef struct {
 	unsigned long long mi_prev_rows;
 } oph_io_server_running_stmt;
 
+/**
+ * \brief			            Structure to contain a prepared statement (query parsed once and executed several times)
+ * \param handle          Handle used by the client to refer to the statement
+ * \param operation       Operation code resolved at preparation time
+ * \param query_args      Hash table containing the parsed args of the query (never modified by executions)
+ * \param fields          Buffer containing the field list of insert operations
+ * \param field_list      Field list of insert operations, split once at preparation time
+ * \param field_list_num  Number of items in field_list
+ * \param values          Buffer containing the value list of insert operations
+ * \param value_list      Value list of insert operations, split once at preparation time
+ * \param value_list_num  Number of items in value_list
+ * \param bound_args      Hash table of the args of an execution, restored from query_args by each binding
+ * \param exprs           Expressions compiled by the first execution and reused by the following ones
+ * \param next            Next prepared statement of the connection
+ */
+typedef struct _oph_io_server_prepared_stmt {
+	unsigned long long handle;
+	int operation;
+	oph_server_hashmap *query_args;
+	char *fields;
+	char **field_list;
+	int field_list_num;
+	char *values;
+	char **value_list;
+	int value_list_num;
+	oph_server_hashmap *bound_args;
+	struct _oph_ioserver_query_expr *exprs;
+	struct _oph_io_server_prepared_stmt *next;
+} oph_io_server_prepared_stmt;
+
 /**
  * \brief			            Structure to store thread status info
  * \param current_db 	    Pointer to current (default) database, if defined
@@ -74,6 +139,10 @@ typedef struct {
  * \param delete_only_rs	Flag set to 1 if only record set structure should be deleted
  * \param device        	Device selected for operations
  * \param curr_stmt       Current statement being executed, if any
+ * \param query_arena     Arena for transient allocations of the query being executed (owned by the worker serving the request and reset at query end)
+ * \param prepared_stmts  List of statements prepared with SQ, most recent first
+ * \param prepared_stmt_num Number of prepared statements in the list
+ * \param last_stmt_handle Last handle assigned to a prepared statement
  */
 typedef struct {
 	//oph_metadb_db_row *current_db; 
@@ -82,8 +151,19 @@ typedef struct {
 	char delete_only_rs;
 	char *device;
 	oph_io_server_running_stmt *curr_stmt;
+	oph_server_arena *query_arena;
+	oph_io_server_prepared_stmt *prepared_stmts;
+	unsigned int prepared_stmt_num;
+	unsigned long long last_stmt_handle;
 } oph_io_server_thread_status;
 
+/**
+ * \brief               Function used to initialize thread status
+ * \param status        Thread status
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_init_status(oph_io_server_thread_status * status);
+
 /**
  * \brief               Function used to release thread status resources
  * \param status        Thread status
@@ -92,11 +172,40 @@ typedef struct {
 int oph_io_server_free_status(oph_io_server_thread_status * status);
 
 /**
- * \brief               Thread function used by IO server
- * \param sockfd        Socket descriptor related to thread
- * \param tid        Thread ID
+ * \brief               Function used to stream a result set to the client without building the whole packet in memory
+ * \param sockfd        Socket descriptor related to the connection
+ * \param rs            Result set to be sent
+ * \param binary        If set, the result set is sent as RB message (numeric cells in binary format), otherwise as RS message (numeric cells as text)
+ * \return              0 if successfull, non-0 otherwise
+ */
+int oph_io_server_send_result_set(int sockfd, oph_iostore_frag_record_set * rs, char binary);
+
+/**
+ * \brief               Function used to send an error message to the client
+ * \param sockfd        Socket descriptor related to the connection
  * \return              0 if successfull, non-0 otherwise
  */
-void oph_io_server_thread(int sockfd, pthread_t tid);
+int oph_io_server_send_error(int sockfd);
+
+/**
+ * \brief               Function used to check if a whole request has been received, without consuming it
+ * \param buffer        Data received and not yet served
+ * \param size          Number of bytes in buffer
+ * \param length        Pointer to be filled with the length of the request if it is complete, or with the number of bytes needed to go on with the check otherwise
+ * \return              OPH_IO_SERVER_FRAME_COMPLETE, OPH_IO_SERVER_FRAME_INCOMPLETE or OPH_IO_SERVER_FRAME_INVALID (a length field or the whole request is too long)
+ */
+int oph_io_server_check_frame(const char *buffer, size_t size, size_t * length);
+
+/**
+ * \brief               Function used by IO server workers to read and serve a request from a connection
+ * \param sockfd        Socket descriptor related to the connection
+ * \param reader        Buffered reader of the connection
+ * \param tid           Thread ID
+ * \param status        Status of the connection
+ * \param line          Communication buffer of MAX_PACKET_LEN bytes owned by the worker
+ * \param result        Communication buffer of MAX_PACKET_LEN bytes owned by the worker
+ * \return              0 if the connection can be kept open, non-0 if it has to be closed
+ */
+int oph_io_server_process_request(int sockfd, struct _oph_net_reader *reader, pthread_t tid, oph_io_server_thread_status * status, char *line, char *result);
 
 #endif				/* OPH_IO_SERVER_THREAD_H */